@@ -0,0 +1,421 @@
+/**
+ * \file		framer_bench.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Stress benchmark of the packet framer.
+ *
+ * A stream of DATA packets (8 channels, 6 samples per packet, i.e., what the coordinator sends at 500 Hz) is generated with
+ * a fixed seed and damaged in the ways the serial link damages it:
+ *	- bit errors, injected at the requested bit error rate;
+ *	- dropped bytes (e.g., UART overruns), injected at the requested rate per byte;
+ *	- false preambles, i.e., two consecutive 0xFFFF measurement samples, which form the 0xFF x 4 preamble pattern inside
+ *	  the payload; they are placed in the requested fraction of the packets before the checksums are computed, so the
+ *	  packets themselves are valid.
+ * The stream is then framed in chunks of the requested length, exactly as serial_ReceivePackets() frames the data of the
+ * reader thread, and the framed packets are matched with the generated ones by their time stamps. The benchmark reports:
+ *	- the number of packets recovered, the number of intact packets that were lost (i.e., the cost of resynchronizing)
+ *	  and the number of corrupted packets that were accepted;
+ *	- the number of checksum errors, each of which is attributed to the generated packet where the failed packet starts;
+ *	  no packet may be reported more than once, because the sample thread aborts the recording after MAX_RETRIES
+ *	  consecutive checksum errors (the benchmark exits with 2 otherwise);
+ *	- the resynchronization latency: the distance from each error to the start of the next recovered packet, in bytes
+ *	  and in time at the link's nominal speed;
+ *	- the framing throughput (packets/s and MB/s of framer time only; generating the stream is not timed).
+ *
+ * Usage: framer_bench [--packets n = 200000] [--bit-error-rate p = 0] [--drop-rate p = 0] [--false-preamble-rate p = 0]
+ *					   [--chunk n = 512] [--seed n = 1]
+ *
+ * $Id$
+ */
+
+# include <chrono>
+# include <math.h>
+# include <stddef.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+# include "serialV4.h"
+# include "simd.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define BENCH_NCHANNELS			8
+# define BENCH_NSAMPLES				6
+# define BENCH_PAYLOAD_LENGTH		(offsetof (tPacket_DATA, Measurements) + BENCH_NCHANNELS*BENCH_NSAMPLES*sizeof (WORD))
+# define BENCH_PACKET_LENGTH		(SERHDR_SIZE + BENCH_PAYLOAD_LENGTH + 1)
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static unsigned int			m_uintSeed;
+static tReceivedData		m_rdReceive;
+static tPacketView			m_tpvPackets [SERBUF_MAXPACKETS];
+
+//---------------------------------------------------------------------------
+//							Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Returns a pseudo-random number in [0, 1).
+ */
+static double bench_Random (void)
+{
+	m_uintSeed = m_uintSeed*1103515245 + 12345;
+	return (double) (m_uintSeed >> 8) / 16777216.0;
+}
+
+/**
+ * \brief Returns the distance to the next event of a Bernoulli process with the given rate (geometric distribution).
+ */
+static double bench_NextEvent (double dblRate)
+{
+	return 1.0 - log (1.0 - bench_Random ())/dblRate;
+}
+
+/**
+ * \brief Compares two error positions (qsort() callback).
+ */
+static int bench_ComparePositions (const void * pvdA, const void * pvdB)
+{
+	DWORD dwrdA = *(const DWORD *) pvdA, dwrdB = *(const DWORD *) pvdB;
+
+	return (dwrdA > dwrdB) - (dwrdA < dwrdB);
+}
+
+/**
+ * \brief Converts a position in the transmitted stream into the corresponding position in the generated stream.
+ *
+ * \param[in]	dwrdPosition	position in the transmitted stream
+ * \param[in]	pdwrdDrops		positions (in the generated stream) of the dropped bytes, in ascending order
+ * \param[in]	uintNDrops		number of elements in pdwrdDrops
+ * \return Position in the generated stream.
+ */
+static DWORD bench_SentToGenerated (DWORD dwrdPosition, const DWORD * pdwrdDrops, unsigned int uintNDrops)
+{
+	unsigned int uintLow, uintHigh, uintMiddle;
+
+	// number of dropped bytes that precede the byte; drop k leaves pdwrdDrops [k] - k bytes before it in the transmitted stream
+	uintLow = 0;
+	uintHigh = uintNDrops;
+	while (uintLow < uintHigh)
+	{
+		uintMiddle = (uintLow + uintHigh)/2;
+		if (pdwrdDrops [uintMiddle] - uintMiddle <= dwrdPosition)
+			uintLow = uintMiddle + 1;
+		else
+			uintHigh = uintMiddle;
+	}
+
+	return dwrdPosition + uintLow;
+}
+
+/**
+ * \brief Generates the stream of packets.
+ *
+ * \param[out]	pbytStream				buffer of uintNPackets*BENCH_PACKET_LENGTH bytes where the stream is to be stored
+ * \param[in]	uintNPackets			number of packets
+ * \param[in]	dblFalsePreambleRate	fraction of the packets whose measurements contain a preamble pattern
+ * \return Number of packets that contain a false preamble.
+ */
+static unsigned int bench_GenerateStream (BYTE * pbytStream, unsigned int uintNPackets, double dblFalsePreambleRate)
+{
+	tPacket_DATA tpdPayload;
+	BYTE bytChecksum;
+	unsigned int i, j, uintNFalsePreambles;
+
+	memset (&tpdPayload, 0, sizeof (tpdPayload));
+	tpdPayload.ChannelMask = 0xFF;
+	tpdPayload.BatteryLevel = 3700;
+	uintNFalsePreambles = 0;
+
+	for (i = 0; i < uintNPackets; i++, pbytStream += BENCH_PACKET_LENGTH)
+	{
+		tpdPayload.TimeStamp = i*BENCH_NSAMPLES;
+		for (j = 0; j < ACCCHANNELS; j++)
+			tpdPayload.Accelerometers [j] = (WORD) (512 + (bench_Random () - 0.5)*64);
+
+		// offset-binary samples; a full-scale sample is 0xFFFF, so two of them in a row form a preamble
+		for (j = 0; j < BENCH_NCHANNELS*BENCH_NSAMPLES; j++)
+			tpdPayload.Measurements [j] = (WORD) (bench_Random ()*65536.0);
+		if (dblFalsePreambleRate > 0.0 && bench_Random () < dblFalsePreambleRate)
+		{
+			j = (unsigned int) (bench_Random ()*(BENCH_NCHANNELS*BENCH_NSAMPLES - 1));
+			tpdPayload.Measurements [j] = tpdPayload.Measurements [j + 1] = 0xFFFF;
+			uintNFalsePreambles++;
+		}
+
+		pbytStream [0] = pbytStream [1] = pbytStream [2] = pbytStream [3] = PREAMBLE;
+		pbytStream [4] = SER_DATA;
+		pbytStream [5] = (BYTE) BENCH_PAYLOAD_LENGTH;
+		memcpy (pbytStream + SERHDR_SIZE, &tpdPayload, BENCH_PAYLOAD_LENGTH);
+
+		bytChecksum = 0;
+		for (j = 4; j < SERHDR_SIZE + BENCH_PAYLOAD_LENGTH; j++)
+			bytChecksum += pbytStream [j];
+		pbytStream [SERHDR_SIZE + BENCH_PAYLOAD_LENGTH] = (BYTE) ~bytChecksum;
+	}
+
+	return uintNFalsePreambles;
+}
+
+/**
+ * \brief Prints the usage of the benchmark.
+ */
+static void bench_PrintUsage (void)
+{
+	fprintf (stderr, "Usage: framer_bench [--packets n] [--bit-error-rate p] [--drop-rate p] [--false-preamble-rate p]\n"
+					 "                    [--chunk n (1 - %d)] [--seed n]\n", SERBUF_RECVSTATE);
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+int main (int argc, char * argv [])
+{
+	BYTE * pbytClean, * pbytStream, * pbytPacketErrors, * pbytPacketHit, * pbytRecovered, * pbytChecksumErrors;
+	DWORD * pdwrdErrors, * pdwrdDrops;
+	DWORD dwrdStreamLength, dwrdSentLength, dwrdNErrors, dwrdMaxErrors, dwrdPosition, dwrdNBytes, dwrdChunkLength, dwrdTimeStamp, i;
+	double dblBitErrorRate, dblDropRate, dblFalsePreambleRate, dblEvent, dblTime, dblLatencySum;
+	unsigned int uintNPackets, uintNFramed, uintNRecovered, uintNCorruptedAccepted, uintNChecksumErrors, uintNIntactLost;
+	unsigned int uintNFalsePreambles, uintNDamaged, uintNHit, uintNBitErrors, uintNDrops, uintNRepeated, j;
+	unsigned long ulngLatency, ulngMaxLatency, ulngNLatencies;
+	ULONGLONG ullngBufferOffset;
+	std::chrono::steady_clock::time_point tpStart;
+	SerialReaderStatistics srsStatistics;
+	int k;
+
+	// parameters
+	uintNPackets = 200000;
+	dblBitErrorRate = dblDropRate = dblFalsePreambleRate = 0.0;
+	dwrdChunkLength = 512;
+	m_uintSeed = 1;
+	for (k = 1; k < argc; k += 2)
+	{
+		if (k + 1 == argc)
+		{
+			bench_PrintUsage ();
+			return 1;
+		}
+
+		if (strcmp (argv [k], "--packets") == 0)
+			uintNPackets = (unsigned int) strtoul (argv [k + 1], NULL, 10);
+		else if (strcmp (argv [k], "--bit-error-rate") == 0)
+			dblBitErrorRate = atof (argv [k + 1]);
+		else if (strcmp (argv [k], "--drop-rate") == 0)
+			dblDropRate = atof (argv [k + 1]);
+		else if (strcmp (argv [k], "--false-preamble-rate") == 0)
+			dblFalsePreambleRate = atof (argv [k + 1]);
+		else if (strcmp (argv [k], "--chunk") == 0)
+			dwrdChunkLength = (DWORD) strtoul (argv [k + 1], NULL, 10);
+		else if (strcmp (argv [k], "--seed") == 0)
+			m_uintSeed = (unsigned int) strtoul (argv [k + 1], NULL, 10);
+		else
+		{
+			bench_PrintUsage ();
+			return 1;
+		}
+	}
+	if (uintNPackets == 0 || dblBitErrorRate < 0.0 || dblBitErrorRate >= 1.0 || dblDropRate < 0.0 || dblDropRate >= 1.0 ||
+		dblFalsePreambleRate < 0.0 || dblFalsePreambleRate > 1.0 || dwrdChunkLength == 0 || dwrdChunkLength > SERBUF_RECVSTATE)
+	{
+		bench_PrintUsage ();
+		return 1;
+	}
+
+	printf ("SIMD level\t\t: %d\n", (int) simd_init ());
+
+	// the error positions are drawn from the geometric distribution of the gaps between errors and are kept in the
+	// coordinates of the generated stream
+	dwrdStreamLength = uintNPackets*BENCH_PACKET_LENGTH;
+	dwrdMaxErrors = (DWORD) (dwrdStreamLength*(8.0*dblBitErrorRate + dblDropRate)*2.0) + 16;
+	pbytClean = (BYTE *) malloc (dwrdStreamLength);
+	pbytStream = (BYTE *) malloc (dwrdStreamLength);
+	pbytPacketErrors = (BYTE *) calloc (uintNPackets, 1);
+	pbytPacketHit = (BYTE *) calloc (uintNPackets, 1);
+	pbytRecovered = (BYTE *) calloc (uintNPackets, 1);
+	pbytChecksumErrors = (BYTE *) calloc (uintNPackets, 1);
+	pdwrdErrors = (DWORD *) malloc (dwrdMaxErrors*sizeof (DWORD));
+	if (pbytClean == NULL || pbytStream == NULL || pbytPacketErrors == NULL || pbytPacketHit == NULL || pbytRecovered == NULL || pbytChecksumErrors == NULL ||
+		pdwrdErrors == NULL)
+	{
+		fprintf (stderr, "framer_bench: out of memory\n");
+		return 1;
+	}
+	uintNFalsePreambles = bench_GenerateStream (pbytClean, uintNPackets, dblFalsePreambleRate);
+	memcpy (pbytStream, pbytClean, dwrdStreamLength);
+
+	// bit errors; a corrupted preamble only costs the packet its framing, the contents are intact
+	dwrdNErrors = 0;
+	if (dblBitErrorRate > 0.0)
+	{
+		for (dblEvent = bench_NextEvent (dblBitErrorRate) - 1.0; dblEvent < dwrdStreamLength*8.0 && dwrdNErrors < dwrdMaxErrors;
+			 dblEvent += bench_NextEvent (dblBitErrorRate))
+		{
+			dwrdPosition = (DWORD) (dblEvent/8.0);
+			pbytStream [dwrdPosition] ^= (BYTE) (1 << ((DWORD) dblEvent & 7));
+
+			if (dwrdPosition % BENCH_PACKET_LENGTH >= 4)
+				pbytPacketErrors [dwrdPosition/BENCH_PACKET_LENGTH] = 1;
+			pbytPacketHit [dwrdPosition/BENCH_PACKET_LENGTH] = 1;
+			pdwrdErrors [dwrdNErrors++] = dwrdPosition;
+		}
+	}
+	uintNBitErrors = dwrdNErrors;
+
+	// dropped bytes; the stream is compacted in place
+	dwrdSentLength = dwrdStreamLength;
+	if (dblDropRate > 0.0)
+	{
+		dblEvent = bench_NextEvent (dblDropRate) - 1.0;
+		for (i = 0, dwrdSentLength = 0; i < dwrdStreamLength; i++)
+		{
+			if (dblEvent < i + 1.0 && dwrdNErrors < dwrdMaxErrors)
+			{
+				if (i % BENCH_PACKET_LENGTH >= 4)
+					pbytPacketErrors [i/BENCH_PACKET_LENGTH] = 1;
+				pbytPacketHit [i/BENCH_PACKET_LENGTH] = 1;
+				pdwrdErrors [dwrdNErrors++] = i;
+
+				while (dblEvent < i + 1.0)
+					dblEvent += bench_NextEvent (dblDropRate);
+				continue;
+			}
+			pbytStream [dwrdSentLength++] = pbytStream [i];
+		}
+	}
+	uintNDrops = dwrdNErrors - uintNBitErrors;
+	pdwrdDrops = (DWORD *) malloc ((uintNDrops + 1)*sizeof (DWORD));
+	if (pdwrdDrops == NULL)
+	{
+		fprintf (stderr, "framer_bench: out of memory\n");
+		return 1;
+	}
+	memcpy (pdwrdDrops, pdwrdErrors + uintNBitErrors, uintNDrops*sizeof (DWORD));
+	qsort (pdwrdErrors, dwrdNErrors, sizeof (DWORD), bench_ComparePositions);
+
+	// frame the stream as serial_ReceivePackets() frames the data of the reader thread
+	memset (&m_rdReceive, 0, sizeof (m_rdReceive));
+	memset (&srsStatistics, 0, sizeof (srsStatistics));
+	ullngBufferOffset = 0;
+	uintNFramed = uintNRecovered = uintNCorruptedAccepted = uintNChecksumErrors = 0;
+	tpStart = std::chrono::steady_clock::now ();
+
+	dwrdPosition = 0;
+	while (dwrdPosition < dwrdSentLength || uintNFramed > 0)
+	{
+		ullngBufferOffset += m_rdReceive.BufferPos;
+		serial_DiscardFramedBytes (&m_rdReceive);
+
+		dwrdNBytes = dwrdSentLength - dwrdPosition;
+		if (dwrdNBytes > dwrdChunkLength)
+			dwrdNBytes = dwrdChunkLength;
+		if (dwrdNBytes > SERBUF_RECVSTATE - m_rdReceive.BufferLen)
+			dwrdNBytes = SERBUF_RECVSTATE - m_rdReceive.BufferLen;
+		memcpy (m_rdReceive.Buffer + m_rdReceive.BufferLen, pbytStream + dwrdPosition, dwrdNBytes);
+		m_rdReceive.BufferLen += dwrdNBytes;
+		dwrdPosition += dwrdNBytes;
+
+		uintNFramed = serial_FramePackets (&m_rdReceive, m_tpvPackets, SERBUF_MAXPACKETS, &srsStatistics);
+
+		// match the framed packets with the generated ones by their time stamps
+		for (j = 0; j < uintNFramed; j++)
+		{
+			if (m_tpvPackets [j].Result != ERR_NOERROR)
+			{
+				uintNChecksumErrors++;
+
+				// attribute the error to the generated packet where the failed packet starts
+				i = bench_SentToGenerated ((DWORD) (ullngBufferOffset + (m_tpvPackets [j].PacketData - m_rdReceive.Buffer) - SERHDR_SIZE),
+										   pdwrdDrops, uintNDrops)/BENCH_PACKET_LENGTH;
+				if (pbytChecksumErrors [i] < 255)
+					pbytChecksumErrors [i]++;
+				continue;
+			}
+
+			memcpy (&dwrdTimeStamp, m_tpvPackets [j].PacketData + offsetof (tPacket_DATA, TimeStamp), sizeof (DWORD));
+			i = dwrdTimeStamp/BENCH_NSAMPLES;
+			if (m_tpvPackets [j].PacketType != SER_DATA || m_tpvPackets [j].PacketDataLen != BENCH_PAYLOAD_LENGTH ||
+				dwrdTimeStamp % BENCH_NSAMPLES != 0 || i >= uintNPackets || pbytRecovered [i] ||
+				memcmp (m_tpvPackets [j].PacketData, pbytClean + i*BENCH_PACKET_LENGTH + SERHDR_SIZE, BENCH_PAYLOAD_LENGTH) != 0)
+			{
+				uintNCorruptedAccepted++;
+			}
+			else
+			{
+				pbytRecovered [i] = 1;
+				uintNRecovered++;
+			}
+		}
+	}
+
+	dblTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - tpStart).count ();
+
+	// intact packets that were not recovered were skipped while resynchronizing
+	uintNIntactLost = uintNDamaged = uintNHit = uintNRepeated = 0;
+	for (j = 0; j < uintNPackets; j++)
+	{
+		if (pbytChecksumErrors [j] > 1)
+			uintNRepeated++;
+		if (!pbytPacketErrors [j] && !pbytRecovered [j])
+			uintNIntactLost++;
+		uintNDamaged += pbytPacketErrors [j];
+		uintNHit += pbytPacketHit [j];
+	}
+
+	// resynchronization latency: from each error to the start of the next recovered packet
+	dblLatencySum = 0.0;
+	ulngMaxLatency = ulngNLatencies = 0;
+	for (i = 0, j = 0; i < dwrdNErrors; i++)
+	{
+		while (j < uintNPackets && (j*BENCH_PACKET_LENGTH <= pdwrdErrors [i] || !pbytRecovered [j]))
+			j++;
+		if (j == uintNPackets)
+			break;
+
+		ulngLatency = j*BENCH_PACKET_LENGTH - pdwrdErrors [i];
+		dblLatencySum += ulngLatency;
+		if (ulngLatency > ulngMaxLatency)
+			ulngMaxLatency = ulngLatency;
+		ulngNLatencies++;
+	}
+
+	printf ("Packets sent\t\t: %u (%lu bytes, %u bit errors, %u bytes dropped, %u false preambles)\n", uintNPackets,
+			(unsigned long) dwrdStreamLength, uintNBitErrors, uintNDrops, uintNFalsePreambles);
+	printf ("Packets damaged\t\t: %u with corrupted contents, %u with any error\n", uintNDamaged, uintNHit);
+	printf ("Packets recovered\t: %u\n", uintNRecovered);
+	printf ("Intact packets lost\t: %u\n", uintNIntactLost);
+	printf ("Corrupted accepted\t: %u\n", uintNCorruptedAccepted);
+	printf ("Checksum errors\t\t: %u (%u packets reported more than once)\n", uintNChecksumErrors, uintNRepeated);
+	printf ("Resyncs\t\t\t: %ld (%ld bytes skipped)\n", srsStatistics.NResyncs, srsStatistics.NBytesSkipped);
+	if (ulngNLatencies > 0)
+	{
+		printf ("Resync latency\t\t: mean %.1f bytes (%.3f ms), max %lu bytes (%.3f ms) at %d baud\n",
+				dblLatencySum/ulngNLatencies, dblLatencySum/ulngNLatencies*10000.0/SERPORT_SPEED,
+				ulngMaxLatency, ulngMaxLatency*10000.0/SERPORT_SPEED, SERPORT_SPEED);
+	}
+	if (dblTime > 0.0)
+	{
+		printf ("Throughput\t\t: %.0f packets/s, %.1f MB/s (%.3f s)\n", uintNPackets/dblTime,
+				dwrdSentLength/dblTime/1048576.0, dblTime);
+	}
+
+	free (pbytClean);
+	free (pbytStream);
+	free (pbytPacketErrors);
+	free (pbytPacketHit);
+	free (pbytRecovered);
+	free (pbytChecksumErrors);
+	free (pdwrdErrors);
+	free (pdwrdDrops);
+
+	if (uintNRepeated > 0)
+	{
+		fprintf (stderr, "framer_bench: %u packets caused more than one checksum error\n", uintNRepeated);
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,189 @@
+/**
+ * \file		framer_fuzz.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Fuzz target of the packet framer.
+ *
+ * The input is appended to a receive buffer in chunks, exactly as serial_ReceivePackets() appends the data of the reader
+ * thread, and the buffer is framed after every chunk. The first two bytes of the input select the chunk length and the
+ * maximum number of packets framed per call, so that the fuzzer also explores packets that are split across reads and
+ * framing that stops half-way through the buffer. After every call the target checks that:
+ *	- the framed packets lie inside the received data, follow a preamble and have a plausible header,
+ *	- the checksum result of each packet matches a byte-wise reference computation,
+ *	- a packet that fails its checksum never starts inside the previous one that failed (a false preamble inside a
+ *	  corrupted packet must not be reported as another checksum error),
+ *	- the framing position never passes the end of the data, and
+ *	- the framer always makes progress when the receive buffer is full (otherwise the link would stall).
+ *
+ * A violated check aborts the process, which the fuzzers report as a crash.
+ *
+ * $Id$
+ */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+# include "serialV4.h"
+# include "simd.h"
+
+# define FRAMER_CHECK(x)		do { if (!(x)) { fprintf (stderr, "framer_fuzz: check failed: %s (line %d)\n", #x, __LINE__); abort (); } } while (0)
+
+static tReceivedData			m_rdReceive;
+static tPacketView				m_tpvPackets [SERBUF_MAXPACKETS];
+static ULONGLONG				m_ullngBufferOffset;				///< position of the receive buffer in the input
+static ULONGLONG				m_ullngBadPacketEnd;				///< end of the last packet that failed its checksum, in the input
+
+/**
+ * \brief Checks the packets framed by one call of serial_FramePackets().
+ */
+static void framer_CheckPackets (unsigned int uintNPackets)
+{
+	BYTE bytChecksum;
+	DWORD dwrdOffset;
+	unsigned int i, j;
+
+	for (i = 0; i < uintNPackets; i++)
+	{
+		FRAMER_CHECK (m_tpvPackets [i].PacketData >= m_rdReceive.Buffer + SERHDR_SIZE);
+		dwrdOffset = (DWORD) (m_tpvPackets [i].PacketData - m_rdReceive.Buffer) - SERHDR_SIZE;
+
+		// the whole packet, including its checksum, has been received
+		FRAMER_CHECK (dwrdOffset + SERHDR_SIZE + m_tpvPackets [i].PacketDataLen + 1 <= m_rdReceive.BufferLen);
+
+		// it starts with a preamble and its header is plausible
+		for (j = 0; j < 4; j++)
+			FRAMER_CHECK (m_rdReceive.Buffer [dwrdOffset + j] == PREAMBLE);
+		FRAMER_CHECK (m_rdReceive.Buffer [dwrdOffset + 4] == m_tpvPackets [i].PacketType);
+		FRAMER_CHECK (m_rdReceive.Buffer [dwrdOffset + 5] == m_tpvPackets [i].PacketDataLen);
+		FRAMER_CHECK (serial_IsValidHeader (m_tpvPackets [i].PacketType, m_tpvPackets [i].PacketDataLen));
+
+		// checksum result against a byte-wise computation
+		bytChecksum = 0;
+		for (j = 4; j < SERHDR_SIZE + (unsigned int) m_tpvPackets [i].PacketDataLen; j++)
+			bytChecksum += m_rdReceive.Buffer [dwrdOffset + j];
+		FRAMER_CHECK ((m_tpvPackets [i].Result == ERR_NOERROR) ==
+					  ((BYTE) ~bytChecksum == m_rdReceive.Buffer [dwrdOffset + SERHDR_SIZE + m_tpvPackets [i].PacketDataLen]));
+		FRAMER_CHECK (m_tpvPackets [i].Result == ERR_NOERROR || m_tpvPackets [i].Result == ERR_CHECKSUM);
+		if (m_tpvPackets [i].Result == ERR_CHECKSUM)
+		{
+			FRAMER_CHECK (m_ullngBufferOffset + dwrdOffset >= m_ullngBadPacketEnd);
+			m_ullngBadPacketEnd = m_ullngBufferOffset + dwrdOffset + SERHDR_SIZE + m_tpvPackets [i].PacketDataLen + 1;
+		}
+
+		// packets are returned in stream order
+		if (i > 0)
+			FRAMER_CHECK (m_tpvPackets [i].PacketData > m_tpvPackets [i - 1].PacketData);
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput (const BYTE * pbytData, size_t sztLength)
+{
+	SerialReaderStatistics srsStatistics;
+	DWORD dwrdChunkLength, dwrdNBytes, dwrdNBytesAppended;
+	unsigned int uintMaxNPackets, uintNPackets;
+	BOOL blnBufferFull;
+
+	if (sztLength < 2)
+		return 0;
+
+	// chunk length: 1 - 256 bytes (a read of the reader thread); packets per call: 1 - SERBUF_MAXPACKETS
+	dwrdChunkLength = (DWORD) pbytData [0] + 1;
+	uintMaxNPackets = (pbytData [1] & 0x80) ? SERBUF_MAXPACKETS : (unsigned int) (pbytData [1] & 0x7F) + 1;
+	pbytData += 2;
+	sztLength -= 2;
+
+	memset (&m_rdReceive, 0, sizeof (m_rdReceive));
+	memset (&srsStatistics, 0, sizeof (srsStatistics));
+	m_ullngBufferOffset = m_ullngBadPacketEnd = 0;
+
+	dwrdNBytesAppended = 0;
+	while (dwrdNBytesAppended < sztLength || m_rdReceive.BufferPos < m_rdReceive.BufferLen)
+	{
+		m_ullngBufferOffset += m_rdReceive.BufferPos;
+		serial_DiscardFramedBytes (&m_rdReceive);
+		FRAMER_CHECK (m_rdReceive.BufferPos == 0 && m_rdReceive.BufferLen <= SERBUF_RECVSTATE);
+
+		// append the next chunk
+		dwrdNBytes = (DWORD) (sztLength - dwrdNBytesAppended);
+		if (dwrdNBytes > dwrdChunkLength)
+			dwrdNBytes = dwrdChunkLength;
+		if (dwrdNBytes > SERBUF_RECVSTATE - m_rdReceive.BufferLen)
+			dwrdNBytes = SERBUF_RECVSTATE - m_rdReceive.BufferLen;
+		memcpy (m_rdReceive.Buffer + m_rdReceive.BufferLen, pbytData + dwrdNBytesAppended, dwrdNBytes);
+		m_rdReceive.BufferLen += dwrdNBytes;
+		dwrdNBytesAppended += dwrdNBytes;
+		blnBufferFull = (m_rdReceive.BufferLen == SERBUF_RECVSTATE);
+
+		uintNPackets = serial_FramePackets (&m_rdReceive, m_tpvPackets, uintMaxNPackets, &srsStatistics);
+		FRAMER_CHECK (uintNPackets <= uintMaxNPackets);
+		FRAMER_CHECK (m_rdReceive.BufferPos <= m_rdReceive.BufferLen);
+		framer_CheckPackets (uintNPackets);
+
+		// a full buffer always contains either a complete packet or bytes that can be skipped
+		if (blnBufferFull)
+			FRAMER_CHECK (uintNPackets > 0 || m_rdReceive.BufferPos > 0);
+
+		// all data has been appended: stop once the framer is only waiting for the rest of a packet
+		if (dwrdNBytesAppended == sztLength && uintNPackets == 0)
+			break;
+	}
+
+	FRAMER_CHECK ((DWORD) srsStatistics.NBytesSkipped <= sztLength);
+
+	return 0;
+}
+
+# ifndef FRAMER_LIBFUZZER
+/**
+ * \brief Runs the fuzz target on each of the files given on the command line (corpus replay, AFL/WinAFL with @@).
+ */
+int main (int argc, char * argv [])
+{
+	BYTE * pbytData;
+	FILE * pFile;
+	long lngLength;
+	int i;
+
+	simd_init ();
+
+	for (i = 1; i < argc; i++)
+	{
+		pFile = fopen (argv [i], "rb");
+		if (pFile == NULL)
+		{
+			fprintf (stderr, "framer_fuzz: cannot open %s\n", argv [i]);
+			return 1;
+		}
+
+		fseek (pFile, 0, SEEK_END);
+		lngLength = ftell (pFile);
+		fseek (pFile, 0, SEEK_SET);
+		pbytData = (BYTE *) malloc (lngLength > 0 ? lngLength : 1);
+		if (pbytData == NULL || fread (pbytData, 1, lngLength, pFile) != (size_t) lngLength)
+		{
+			fprintf (stderr, "framer_fuzz: cannot read %s\n", argv [i]);
+			fclose (pFile);
+			free (pbytData);
+			return 1;
+		}
+		fclose (pFile);
+
+		LLVMFuzzerTestOneInput (pbytData, (size_t) lngLength);
+		free (pbytData);
+	}
+
+	return 0;
+}
+# else
+/**
+ * \brief Selects the SIMD kernels before the first input is run.
+ */
+extern "C" int LLVMFuzzerInitialize (int * pintArgc, char *** pppstrArgv)
+{
+	simd_init ();
+	return 0;
+}
+# endif
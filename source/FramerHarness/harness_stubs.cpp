@@ -0,0 +1,40 @@
+/**
+ * \file		harness_stubs.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Stand-ins for the application modules that the framer, the SIMD kernels and the serial link report to.
+ *
+ * $Id$
+ */
+
+# include <stdio.h>
+
+# include "compat.h"
+# include "applog.h"
+# include "capture.h"
+# include "latency.h"
+
+/**
+ * \brief Prints the event to the standard error instead of the application log.
+ */
+void applog_logevent(LogEventType letType, TCHAR * pstrModule, TCHAR * pstrMessage, int intCode, BOOL blnAddTimestamp)
+{
+	_ftprintf (stderr, TEXT("[%s] %s (%d)\n"), pstrModule, pstrMessage, intCode);
+}
+
+/**
+ * \brief Discards the data instead of capturing it (capture is off).
+ */
+void capture_Record (CaptureDirection cdDirection, const BYTE * pbytData, DWORD dwrdLength)
+{
+}
+
+/**
+ * \brief Returns 0, as latency_Now() does while the latency probes are off.
+ */
+DWORD latency_Now (void)
+{
+	return 0;
+}
@@ -0,0 +1,337 @@
+/**
+ * \file		link_test.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Load test of the serial link on POSIX systems: reader thread, ring buffer and packet framer (eeg/serialV4.cpp).
+ *
+ * A coordinator thread plays the WEEG coordinator on the master side of a pseudo-terminal: it acknowledges the POLL,
+ * DEVMASK, CHMASK and PARAMS packets and, once sampling has been started, streams DATA packets with consecutive time
+ * stamps and samples derived from them. The link is opened on the slave side with serial_OpenPort() and
+ * serial_StartSampling(), and the packets are received as the sample thread does (serial_WaitForData() and
+ * serial_ReceivePackets()). The test checks that:
+ *	- every packet arrives in order, intact (checksum and samples) and exactly once, unless the reader reports dropped
+ *	  bytes (ring buffer full), in which case the missing packets must be accounted for by them,
+ *	- the reader thread blocks in poll() between chunks of data instead of spinning (reader wake-ups),
+ *	- closing the master side (the adapter is unplugged) is reported by serial_IsLinkClosed(), and serial_ClosePort()
+ *	  stops the reader thread.
+ * The throughput and the reader statistics are printed. The test exits with 1 if any check fails.
+ *
+ * Usage: link_test [number of packets = 20000] [packets per second = 0 (as fast as possible)]
+ *
+ * $Id$
+ */
+
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+# ifdef __APPLE__
+# include <util.h>
+# else
+# include <pty.h>
+# endif
+
+# include "serialV4.h"
+# include "simd.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define TEST_NMEASUREMENTS			48					///< samples per DATA packet (8 channels x 6 samples)
+# define TEST_START_DELAY			100					///< time between the ACK of PARAMS and the first DATA packet, in ms
+# define TEST_TIMEOUT				5000				///< maximum time without a new packet, in ms
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static int					m_intMaster;				// master side of the pseudo-terminal (coordinator)
+static volatile LONG		m_lngStop;					// TRUE when the coordinator thread has to exit
+static unsigned long		m_ulngNPackets;				// number of DATA packets to send
+static unsigned long		m_ulngPacketRate;			// DATA packets per second (0: as fast as possible)
+static unsigned int			m_uintNFailures;
+
+//---------------------------------------------------------------------------
+//							Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Counts and reports a failed check.
+ */
+static void test_Check (BOOL blnPassed, const char * strCheck)
+{
+	printf ("%-60s: %s\n", strCheck, blnPassed ? "ok" : "FAILED");
+	if (!blnPassed)
+		m_uintNFailures++;
+}
+
+/**
+ * \brief Returns the value of a sample of a DATA packet.
+ *
+ * The samples stay below 0x4000, so they never contain the preamble pattern.
+ */
+static WORD test_Sample (DWORD dwrdTimeStamp, unsigned int uintIndex)
+{
+	return (WORD) ((dwrdTimeStamp*7 + uintIndex*31) & 0x3FFF);
+}
+
+/**
+ * \brief Assembles a packet: preamble, header, payload and checksum.
+ *
+ * \return Length of the packet, in bytes.
+ */
+static DWORD test_BuildPacket (BYTE bytPacketType, const void * pPayload, BYTE bytDataLength, BYTE * pbytPacket)
+{
+	pbytPacket [0] = pbytPacket [1] = pbytPacket [2] = pbytPacket [3] = PREAMBLE;
+	pbytPacket [4] = bytPacketType;
+	pbytPacket [5] = bytDataLength;
+	memcpy (pbytPacket + SERHDR_SIZE, pPayload, bytDataLength);
+	pbytPacket [SERHDR_SIZE + bytDataLength] = (BYTE) ~simd_ByteSum (pbytPacket + 4, SERHDR_SIZE - 4 + bytDataLength);
+
+	return SERHDR_SIZE + bytDataLength + 1;
+}
+
+/**
+ * \brief Writes the whole buffer to the master side; returns FALSE if the coordinator has to exit.
+ */
+static BOOL test_Send (const BYTE * pbytData, DWORD dwrdLength)
+{
+	struct pollfd pfdWrite;
+	ssize_t sztNBytesWritten;
+
+	while (dwrdLength > 0)
+	{
+		sztNBytesWritten = write (m_intMaster, pbytData, dwrdLength);
+		if (sztNBytesWritten > 0)
+		{
+			pbytData += sztNBytesWritten;
+			dwrdLength -= (DWORD) sztNBytesWritten;
+			continue;
+		}
+		if (sztNBytesWritten < 0 && errno != EAGAIN && errno != EINTR)
+			return FALSE;
+		if (m_lngStop)
+			return FALSE;
+
+		// the reader has fallen behind: wait for room in the pseudo-terminal
+		pfdWrite.fd = m_intMaster;
+		pfdWrite.events = POLLOUT;
+		poll (&pfdWrite, 1, 10);
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Coordinator thread: acknowledges the commands and streams DATA packets after the PARAMS command.
+ *
+ * \param[in]	lpParam		not used
+ * \return 0.
+ */
+static DWORD WINAPI test_Coordinator (LPVOID lpParam)
+{
+	BYTE bytCommands [1024], bytPacket [SERHDR_SIZE + 256], bytAck [SERHDR_SIZE + 1];
+	DWORD dwrdNCommandBytes, dwrdPacketLength, dwrdStartTime, dwrdAckLength, i;
+	unsigned long ulngNSent;
+	tPacket_DATA tpdData;
+	BOOL blnStreaming;
+	ssize_t sztNBytesRead;
+	struct pollfd pfdRead;
+	unsigned int k;
+
+	dwrdAckLength = test_BuildPacket (SER_ACK, NULL, 0, bytAck);
+	dwrdNCommandBytes = 0;
+	dwrdStartTime = 0;
+	ulngNSent = 0;
+	blnStreaming = FALSE;
+
+	memset (&tpdData, 0, sizeof (tpdData));
+	tpdData.DeviceNr = 0;
+	tpdData.ChannelMask = 0xFF;
+	tpdData.BatteryLevel = 3700;
+
+	while (!m_lngStop)
+	{
+		//
+		// commands
+		//
+		pfdRead.fd = m_intMaster;
+		pfdRead.events = POLLIN;
+		if (poll (&pfdRead, 1, (blnStreaming && ulngNSent < m_ulngNPackets) ? 0 : 10) > 0)
+		{
+			sztNBytesRead = read (m_intMaster, bytCommands + dwrdNCommandBytes, sizeof (bytCommands) - dwrdNCommandBytes);
+			if (sztNBytesRead > 0)
+				dwrdNCommandBytes += (DWORD) sztNBytesRead;
+		}
+
+		// frame the commands (they are sent in one piece and are never corrupted)
+		for (i = 0; i + SERHDR_SIZE < dwrdNCommandBytes; )
+		{
+			if (memcmp (bytCommands + i, bytAck, 4) != 0)
+			{
+				i++;
+				continue;
+			}
+			dwrdPacketLength = SERHDR_SIZE + bytCommands [i + 5] + 1;
+			if (i + dwrdPacketLength > dwrdNCommandBytes)
+				break;
+
+			if (bytCommands [i + 4] == SER_PARAMS)
+			{
+				blnStreaming = (bytCommands [i + SERHDR_SIZE] != 0);
+				dwrdStartTime = GetTickCount () + TEST_START_DELAY;
+			}
+			if (!test_Send (bytAck, dwrdAckLength))
+				return 0;
+			i += dwrdPacketLength;
+		}
+		memmove (bytCommands, bytCommands + i, dwrdNCommandBytes - i);
+		dwrdNCommandBytes -= i;
+
+		//
+		// measurement data
+		//
+		if (!blnStreaming || ulngNSent >= m_ulngNPackets || (LONG) (GetTickCount () - dwrdStartTime) < 0)
+			continue;
+		if (m_ulngPacketRate > 0 && (ULONGLONG) (GetTickCount () - dwrdStartTime)*m_ulngPacketRate < (ULONGLONG) ulngNSent*1000)
+		{
+			Sleep (1);
+			continue;
+		}
+
+		tpdData.TimeStamp = (DWORD) (ulngNSent*(TEST_NMEASUREMENTS/8));
+		for (k = 0; k < TEST_NMEASUREMENTS; k++)
+			tpdData.Measurements [k] = test_Sample (tpdData.TimeStamp, k);
+		dwrdPacketLength = test_BuildPacket (SER_DATA, &tpdData, (BYTE) (offsetof (tPacket_DATA, Measurements) + TEST_NMEASUREMENTS*sizeof (WORD)), bytPacket);
+		if (!test_Send (bytPacket, dwrdPacketLength))
+			return 0;
+		ulngNSent++;
+	}
+
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+int main (int argc, char * argv [])
+{
+	char strSlave [TRANSPORT_MAX_ADDRESS_LEN + 1];
+	tPacketView tpvPackets [SERBUF_MAXPACKETS];
+	static tReceivedData trdReceivedData;
+	const tPacket_DATA * ptpdData;
+	SerialReaderStatistics srsStatistics;
+	HANDLE hCoordinator;
+	DWORD dwrdStartTime, dwrdLastPacketTime, dwrdElapsedTime;
+	unsigned long ulngNReceived, ulngNMissing, ulngNChecksumErrors, ulngNCorrupted, ulngNOutOfOrder, ulngExpected, ulngIndex;
+	unsigned int uintNPackets, i, k;
+	int intSlave;
+	BOOL blnClosed;
+
+	m_ulngNPackets = (argc > 1) ? strtoul (argv [1], NULL, 10) : 20000;
+	m_ulngPacketRate = (argc > 2) ? strtoul (argv [2], NULL, 10) : 0;
+	simd_init ();
+
+	// the slave side stays open until the end, so that the master side does not hang up while the port is closed
+	if (openpty (&m_intMaster, &intSlave, strSlave, NULL, NULL) != 0)
+	{
+		printf ("openpty() failed\n");
+		return 1;
+	}
+	fcntl (m_intMaster, F_SETFL, fcntl (m_intMaster, F_GETFL) | O_NONBLOCK);
+	hCoordinator = CreateThread (NULL, 0, test_Coordinator, NULL, 0, NULL);
+
+	//
+	// open the link & start sampling
+	//
+	test_Check (serial_SetTransport (Transport_COMPort, strSlave, TRUE), "serial_SetTransport() selects the pseudo-terminal");
+	test_Check (serial_OpenPort (1) == ERROR_SUCCESS, "serial_OpenPort() gets the ACK of the POLL packet");
+	test_Check (serial_StartSampling (0x01, 0x1234, 0, 0xFF, 500) == ERROR_SUCCESS, "serial_StartSampling() gets the ACKs of DEVMASK and PARAMS");
+
+	//
+	// receive the DATA packets
+	//
+	ulngNReceived = ulngNChecksumErrors = ulngNCorrupted = ulngNOutOfOrder = ulngNMissing = 0;
+	ulngExpected = 0;
+	dwrdStartTime = dwrdLastPacketTime = GetTickCount ();
+	while (ulngExpected < m_ulngNPackets && GetTickCount () - dwrdLastPacketTime < TEST_TIMEOUT)
+	{
+		serial_WaitForData (TRANSFER_WAIT);
+		while ((uintNPackets = serial_ReceivePackets (&trdReceivedData, tpvPackets, SERBUF_MAXPACKETS)) > 0)
+		{
+			dwrdLastPacketTime = GetTickCount ();
+			for (i = 0; i < uintNPackets; i++)
+			{
+				if (tpvPackets [i].Result != ERR_NOERROR)
+				{
+					ulngNChecksumErrors++;
+					continue;
+				}
+				if (tpvPackets [i].PacketType != SER_DATA)
+					continue;
+
+				ptpdData = (const tPacket_DATA *) tpvPackets [i].PacketData;
+				ulngIndex = ptpdData->TimeStamp/(TEST_NMEASUREMENTS/8);
+				if (ulngIndex < ulngExpected)
+				{
+					ulngNOutOfOrder++;
+					continue;
+				}
+				ulngNMissing += ulngIndex - ulngExpected;
+				ulngExpected = ulngIndex + 1;
+				ulngNReceived++;
+
+				for (k = 0; k < TEST_NMEASUREMENTS; k++)
+				{
+					if (ptpdData->Measurements [k] != test_Sample (ptpdData->TimeStamp, k))
+					{
+						ulngNCorrupted++;
+						break;
+					}
+				}
+			}
+		}
+	}
+	dwrdElapsedTime = dwrdLastPacketTime - dwrdStartTime;
+	ulngNMissing += m_ulngNPackets - ulngExpected;
+	serial_GetReaderStatistics (&srsStatistics);
+	serial_StopSampling ();
+
+	printf ("%lu packets received in %u ms (%.0f packets/s, %.2f MB/s)\n", ulngNReceived, dwrdElapsedTime,
+			dwrdElapsedTime ? ulngNReceived*1000.0/dwrdElapsedTime : 0.0, dwrdElapsedTime ? srsStatistics.NBytesReceived/1000.0/dwrdElapsedTime : 0.0);
+	printf ("reader: %d bytes received, %d dropped, %d wake-ups, ring high-water mark %d bytes; framer: %d wake-ups, %d resyncs\n",
+			srsStatistics.NBytesReceived, srsStatistics.NBytesDropped, srsStatistics.NReaderWakeUps, srsStatistics.RingHighWaterMark,
+			srsStatistics.NFramerWakeUps, srsStatistics.NResyncs);
+
+	test_Check (ulngNChecksumErrors == 0 && ulngNCorrupted == 0, "packets arrive intact");
+	test_Check (ulngNOutOfOrder == 0, "packets arrive in order and exactly once");
+	test_Check (ulngNMissing == 0 || srsStatistics.NBytesDropped > 0, "packets are only missing if the reader dropped bytes");
+	test_Check (ulngNReceived > 0 && (ulngNMissing == 0 || ulngNMissing*(SERHDR_SIZE + offsetof (tPacket_DATA, Measurements) + TEST_NMEASUREMENTS*sizeof (WORD) + 1) <=
+				(unsigned long) srsStatistics.NBytesDropped + SERBUF_RECVSTATE), "missing packets are accounted for by the dropped bytes");
+	test_Check (srsStatistics.NReaderWakeUps < srsStatistics.NBytesReceived/64 + 100, "reader thread blocks between chunks of data");
+
+	//
+	// unplug the adapter
+	//
+	InterlockedExchange (&m_lngStop, TRUE);
+	WaitForSingleObject (hCoordinator, INFINITE);
+	CloseHandle (hCoordinator);
+	close (m_intMaster);
+
+	blnClosed = FALSE;
+	dwrdStartTime = GetTickCount ();
+	while (!(blnClosed = serial_IsLinkClosed ()) && GetTickCount () - dwrdStartTime < 1000)
+		serial_WaitForData (TRANSFER_WAIT);
+	test_Check (blnClosed, "serial_IsLinkClosed() reports the hang-up");
+
+	serial_ClosePort ();
+	test_Check (!serial_IsLinkClosed (), "serial_ClosePort() stops the reader thread");
+	close (intSlave);
+
+	printf ("%u checks failed\n", m_uintNFailures);
+
+	return (m_uintNFailures > 0) ? 1 : 0;
+}
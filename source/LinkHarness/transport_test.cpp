@@ -0,0 +1,246 @@
+/**
+ * \file		transport_test.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Test of the POSIX serial port and TCP transports (eeg/transport_posix.cpp).
+ *
+ * The serial port transport is opened on the slave side of a pseudo-terminal, whose master side plays the coordinator;
+ * the TCP transport connects to a listening socket on the loopback interface. For both, the test checks that:
+ *	- WaitForData() times out while the link is idle and returns as soon as data arrives or the stop event is signaled,
+ *	- all 256 byte values pass unchanged in both directions (the port is raw: no flow control characters, no newline
+ *	  translation, no echo),
+ *	- Read() reports TRANSPORT_CLOSED instead of 0 once the peer has closed the connection (for TCP, only after the data
+ *	  that the peer sent before closing it has been delivered; a hang-up of a terminal discards its unread input).
+ * The test exits with 1 if any check fails.
+ *
+ * Usage: transport_test
+ *
+ * $Id$
+ */
+
+# include <arpa/inet.h>
+# include <fcntl.h>
+# include <netinet/in.h>
+# include <stdio.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <unistd.h>
+# ifdef __APPLE__
+# include <util.h>
+# else
+# include <pty.h>
+# endif
+
+# include "serialV4.h"
+# include "transport.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define TEST_WAIT					2000				///< maximum time the test waits for data that has been sent, in ms
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static unsigned int			m_uintNFailures;
+
+//---------------------------------------------------------------------------
+//							Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Counts and reports a failed check.
+ */
+static void test_Check (BOOL blnPassed, const char * strTransport, const char * strCheck)
+{
+	printf ("%-4s %-52s: %s\n", strTransport, strCheck, blnPassed ? "ok" : "FAILED");
+	if (!blnPassed)
+		m_uintNFailures++;
+}
+
+/**
+ * \brief Reads from the transport until the expected number of bytes has been received, the connection is gone or TEST_WAIT ms have elapsed.
+ *
+ * \return Number of bytes received, or TRANSPORT_CLOSED if the transport reported the closure before any data.
+ */
+static DWORD test_Receive (const Transport * ptTransport, HANDLE hevStop, BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	DWORD dwrdNBytes, dwrdNBytesRead, dwrdStartTime;
+
+	dwrdNBytes = 0;
+	dwrdStartTime = GetTickCount ();
+	while (dwrdNBytes < dwrdLength && GetTickCount () - dwrdStartTime < TEST_WAIT)
+	{
+		dwrdNBytesRead = ptTransport->Read (pbytBuffer + dwrdNBytes, dwrdLength - dwrdNBytes);
+		if (dwrdNBytesRead == TRANSPORT_CLOSED)
+			return (dwrdNBytes > 0) ? dwrdNBytes : TRANSPORT_CLOSED;
+		dwrdNBytes += dwrdNBytesRead;
+		if (dwrdNBytesRead == 0)
+			ptTransport->WaitForData (hevStop, 100);
+	}
+
+	return dwrdNBytes;
+}
+
+/**
+ * \brief Reads from a file descriptor until the expected number of bytes has been received or TEST_WAIT ms have elapsed.
+ */
+static DWORD test_ReceivePeer (int intFD, BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	DWORD dwrdNBytes, dwrdStartTime;
+	ssize_t sztNBytesRead;
+
+	dwrdNBytes = 0;
+	dwrdStartTime = GetTickCount ();
+	while (dwrdNBytes < dwrdLength && GetTickCount () - dwrdStartTime < TEST_WAIT)
+	{
+		sztNBytesRead = read (intFD, pbytBuffer + dwrdNBytes, dwrdLength - dwrdNBytes);
+		if (sztNBytesRead > 0)
+			dwrdNBytes += (DWORD) sztNBytesRead;
+		else
+			Sleep (1);
+	}
+
+	return dwrdNBytes;
+}
+
+/**
+ * \brief Runs the checks on an open transport whose peer is \c intPeer; closes the peer.
+ *
+ * \param[in]	strTransport		name of the transport
+ * \param[in]	ptTransport			transport
+ * \param[in]	intPeer				peer of the transport (non-blocking mode is set)
+ * \param[in]	blnOrderlyClose		TRUE if the data sent before the peer closes the connection is still delivered
+ */
+static void test_Transport (const char * strTransport, const Transport * ptTransport, int intPeer, BOOL blnOrderlyClose)
+{
+	BYTE bytPattern [256], bytBuffer [512];
+	DWORD dwrdStartTime, dwrdWaitResult;
+	HANDLE hevStop;
+	unsigned int i;
+
+	for (i = 0; i < sizeof (bytPattern); i++)
+		bytPattern [i] = (BYTE) i;
+	fcntl (intPeer, F_SETFL, fcntl (intPeer, F_GETFL) | O_NONBLOCK);
+	hevStop = CreateEvent (NULL, TRUE, FALSE, NULL);
+
+	// idle link
+	dwrdStartTime = GetTickCount ();
+	dwrdWaitResult = ptTransport->WaitForData (hevStop, 50);
+	test_Check (dwrdWaitResult == WAIT_TIMEOUT && GetTickCount () - dwrdStartTime >= 40, strTransport, "WaitForData() times out on an idle link");
+	test_Check (ptTransport->Read (bytBuffer, sizeof (bytBuffer)) == 0, strTransport, "Read() returns 0 on an idle link");
+
+	// peer -> transport
+	test_Check (write (intPeer, bytPattern, sizeof (bytPattern)) == (ssize_t) sizeof (bytPattern), strTransport, "peer sends all byte values");
+	test_Check (ptTransport->WaitForData (hevStop, TEST_WAIT) == WAIT_OBJECT_0, strTransport, "WaitForData() returns when data arrives");
+	test_Check (test_Receive (ptTransport, hevStop, bytBuffer, sizeof (bytPattern)) == sizeof (bytPattern) &&
+				memcmp (bytBuffer, bytPattern, sizeof (bytPattern)) == 0, strTransport, "received bytes are unchanged");
+
+	// transport -> peer
+	test_Check (ptTransport->Write (bytPattern, sizeof (bytPattern)), strTransport, "Write() succeeds");
+	test_Check (test_ReceivePeer (intPeer, bytBuffer, sizeof (bytPattern)) == sizeof (bytPattern) &&
+				memcmp (bytBuffer, bytPattern, sizeof (bytPattern)) == 0, strTransport, "sent bytes are unchanged");
+	Sleep (50);
+	test_Check (ptTransport->Read (bytBuffer, sizeof (bytBuffer)) == 0, strTransport, "sent bytes are not echoed");
+
+	// stop event
+	SetEvent (hevStop);
+	test_Check (ptTransport->WaitForData (hevStop, TEST_WAIT) == WAIT_OBJECT_0 + 1, strTransport, "WaitForData() returns when the reader is stopped");
+	ResetEvent (hevStop);
+
+	// closure of the connection (preceded by data if the transport delivers it)
+	if (blnOrderlyClose)
+	{
+		test_Check (write (intPeer, bytPattern, 16) == 16, strTransport, "peer sends data before closing the connection");
+		Sleep (50);
+	}
+	close (intPeer);
+	test_Check (ptTransport->WaitForData (hevStop, TEST_WAIT) == WAIT_OBJECT_0, strTransport, "WaitForData() returns when the connection is closed");
+	if (blnOrderlyClose)
+		test_Check (test_Receive (ptTransport, hevStop, bytBuffer, 16) == 16 && memcmp (bytBuffer, bytPattern, 16) == 0,
+					strTransport, "data sent before the closure is delivered");
+	test_Check (test_Receive (ptTransport, hevStop, bytBuffer, 1) == TRANSPORT_CLOSED, strTransport, "Read() reports TRANSPORT_CLOSED after the closure");
+
+	CloseHandle (hevStop);
+}
+
+/**
+ * \brief Tests the serial port transport on a pseudo-terminal.
+ */
+static void test_COMPort (void)
+{
+	const Transport * ptTransport;
+	int intMaster, intSlave;
+	char strSlave [TRANSPORT_MAX_ADDRESS_LEN + 1];
+
+	ptTransport = transport_Get (Transport_COMPort);
+	test_Check (ptTransport->Open ("/dev/null") != ERROR_SUCCESS, "COM", "Open() fails on a file that is not a terminal");
+
+	if (openpty (&intMaster, &intSlave, strSlave, NULL, NULL) != 0)
+	{
+		test_Check (FALSE, "COM", "openpty()");
+		return;
+	}
+
+	test_Check (ptTransport->Open (strSlave) == ERROR_SUCCESS, "COM", "Open() succeeds on a pseudo-terminal");
+	test_Transport ("COM", ptTransport, intMaster, FALSE);
+	ptTransport->Close ();
+	close (intSlave);
+}
+
+/**
+ * \brief Tests the TCP transport on the loopback interface.
+ */
+static void test_TCP (void)
+{
+	const Transport * ptTransport;
+	struct sockaddr_in saiAddress;
+	socklen_t sltLength;
+	int intListener, intPeer;
+	char strAddress [64];
+
+	ptTransport = transport_Get (Transport_TCP);
+	test_Check (ptTransport->Open ("127.0.0.1") == ERROR_INVALID_PARAMETER, "TCP", "Open() rejects an address without a port");
+
+	intListener = socket (AF_INET, SOCK_STREAM, 0);
+	memset (&saiAddress, 0, sizeof (saiAddress));
+	saiAddress.sin_family = AF_INET;
+	saiAddress.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	sltLength = sizeof (saiAddress);
+	if (intListener < 0 || bind (intListener, (struct sockaddr *) &saiAddress, sizeof (saiAddress)) != 0 ||
+		listen (intListener, 1) != 0 || getsockname (intListener, (struct sockaddr *) &saiAddress, &sltLength) != 0)
+	{
+		test_Check (FALSE, "TCP", "listening socket");
+		return;
+	}
+
+	snprintf (strAddress, sizeof (strAddress), "127.0.0.1:%u", ntohs (saiAddress.sin_port));
+	test_Check (ptTransport->Open (strAddress) == ERROR_SUCCESS, "TCP", "Open() connects to the server");
+	intPeer = accept (intListener, NULL, NULL);
+	close (intListener);
+	if (intPeer < 0)
+	{
+		test_Check (FALSE, "TCP", "accept()");
+		ptTransport->Close ();
+		return;
+	}
+
+	test_Transport ("TCP", ptTransport, intPeer, TRUE);
+	ptTransport->Close ();
+
+	test_Check (ptTransport->Open (strAddress) != ERROR_SUCCESS, "TCP", "Open() fails when the server is gone");
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+int main (int argc, char * argv [])
+{
+	test_COMPort ();
+	test_TCP ();
+
+	printf ("%u checks failed\n", m_uintNFailures);
+
+	return (m_uintNFailures > 0) ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+/**
+ * \file		recorder.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Command-line recorder: records the WEEG system into an EDF+ file with the acquisition engine, without the
+ *				main window.
+ *
+ * The recorder reads the same configuration file as the GUI, checks the WEEG system, records for the given number of
+ * seconds (or until Ctrl+C is pressed, or until the engine stops the recording) and prints the events of the engine to
+ * the console. When an EDF+ file is given, it is replayed in the Simulation mode instead.
+ *
+ * Usage: recorder [duration in seconds (0 = until Ctrl+C)] [EDF+ file to replay]
+ *
+ * The recorder is built for Windows only (Recorder.vcxproj), like the engine it links: the engine and the acquisition
+ * threads use Win32 facilities that the POSIX shim of the WEEG link (compat.h) does not provide (critical sections,
+ * SignalObjectAndWait(), overlapped file I/O, the shell path and folder functions, the console control handler) as well
+ * as the Win32 builds of libEDF and Vortex. On other systems, only the WEEG link can be built (see LinkHarness).
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   								Libraries
+//---------------------------------------------------------------------------
+// custom
+#pragma comment(lib, "libmath.lib")
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <tchar.h>
+
+// program headers
+#include "globals.h"
+#include "applog.h"
+#include "config.h"
+#include "edfPlus.h"
+#include "engine.h"
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static CONFIGURATION			m_cfgConfiguration;
+static EngineSession *			m_pesEngine;
+static HANDLE					m_hevStop;						///< event that is set when the recording has to be stopped
+static volatile LONG			m_lngStopCode = Stop_Normal;	///< member of the StopCode enum with which the recording is stopped
+
+//---------------------------------------------------------------------------
+//							Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Stops the recording when Ctrl+C is pressed or the console is closed.
+ *
+ * \param[in]	dwrdCtrlType	type of control signal
+ *
+ * \return TRUE (the signal has been handled).
+ */
+static BOOL WINAPI recorder_ConsoleCtrlHandler(DWORD dwrdCtrlType)
+{
+	SetEvent(m_hevStop);
+	return TRUE;
+}
+
+/**
+ * \brief Prints the events of the acquisition threads to the console.
+ *
+ * Called in the context of the thread that raises the event (see engine.h).
+ *
+ * \param[in]	eeEvent		event
+ * \param[in]	wParam		event-specific parameter
+ * \param[in]	lParam		event-specific parameter
+ * \param[in]	pContext	not used
+ */
+static void recorder_EngineEventHandler(EngineEvent eeEvent, WPARAM wParam, LPARAM lParam, void * pContext)
+{
+	switch(eeEvent)
+	{
+		case EngineEvent_Stop:
+			_tprintf(TEXT("\nThe engine stopped the recording (stop code %d).\n"), (int) wParam);
+			InterlockedExchange(&m_lngStopCode, (LONG) wParam);
+			SetEvent(m_hevStop);
+		break;
+
+		case EngineEvent_Error:
+			_ftprintf(stderr, TEXT("\nError: %s\n"), (TCHAR *) lParam);
+		break;
+
+		case EngineEvent_Annotation:
+			printf("\nAnnotation: %s\n", (char *) lParam);
+		break;
+
+		case EngineEvent_ReplayStatus:
+			_tprintf(TEXT("\rReading data record: %d/%d (%d records/s)"), (int) wParam, engine_GetNSimulationDataRecords(m_pesEngine), (int) lParam);
+		break;
+
+		case EngineEvent_StreamingStatus:
+			_tprintf(TEXT("\nStreaming client state: %d\n"), (int) wParam);
+		break;
+	}
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Entry point of the recorder.
+ *
+ * \param[in]	argc	number of command-line arguments
+ * \param[in]	argv	command-line arguments (see the usage in the file description)
+ *
+ * \return 0 if the recording was saved, 1 otherwise.
+ */
+int _tmain(int argc, TCHAR * argv[])
+{
+	char					strSimulationEDFFile[MAX_PATH + 1];
+	DWORD					dwrdDuration = INFINITE;
+	EngineStatus			esStatus;
+	HDC						hDC;
+	int						intReturnValue = 0;
+	PatientIdentification	piPatientInfo;
+	RecordingIdentification	riRecordingInfo;
+	size_t					sztLength;
+	TCHAR					strFinalEDFFilePath[MAX_PATH + 1];
+	WEEGSystemCheckCode		wsccCheckCode;
+
+	// command line
+	if(argc > 3 || (argc > 1 && _tcscmp(argv[1], TEXT("/?")) == 0))
+	{
+		_tprintf(TEXT("Usage: %s [duration in seconds (0 = until Ctrl+C)] [EDF+ file to replay]\n"), argv[0]);
+		return 1;
+	}
+	if(argc > 1 && _ttoi(argv[1]) > 0)
+		dwrdDuration = (DWORD) _ttoi(argv[1])*1000;
+
+	//
+	// Read settings from configuration file
+	//
+	hDC = GetDC(NULL);
+	config_init(GetSystemMetrics(SM_CXSCREEN),
+				GetSystemMetrics(SM_CYSCREEN),
+				GetDeviceCaps(hDC, HORZSIZE),
+				GetDeviceCaps(hDC, VERTSIZE));
+	ReleaseDC(NULL, hDC);
+	config_load(&m_cfgConfiguration);
+
+	// the EDF+ file given on the command line is replayed in the Simulation mode
+	m_cfgConfiguration.SimulationMode = (argc > 2);
+
+	// initialize application log
+	applog_init(NULL, m_cfgConfiguration.ApplicationDataPath, NULL, 0);
+
+	// the events of the acquisition threads are printed to the console
+	m_hevStop = CreateEvent(NULL, TRUE, FALSE, NULL);
+	SetConsoleCtrlHandler(recorder_ConsoleCtrlHandler, TRUE);
+	engine_SetEventHandler(recorder_EngineEventHandler, NULL);
+
+	// create the acquisition threads (the samples are not displayed)
+	m_pesEngine = engine_CreateSession(&m_cfgConfiguration, FALSE);
+	if(m_pesEngine == NULL)
+	{
+		applog_close();
+		return 1;
+	}
+
+	if(m_cfgConfiguration.SimulationMode)
+	{
+		wcstombs_s(&sztLength, strSimulationEDFFile, sizeof(strSimulationEDFFile), argv[2], sizeof(strSimulationEDFFile) - 1);
+		engine_SetSimulationFile(m_pesEngine, strSimulationEDFFile);
+	}
+	else
+	{
+		// check WEEG system
+		_tprintf(TEXT("Checking WEEG system...\n"));
+		wsccCheckCode = engine_CheckWEEGSystem(m_pesEngine);
+		if(wsccCheckCode != WEEGSystem_OK)
+		{
+			_ftprintf(stderr, TEXT("The WEEG system is not ready for recording (check code %d).\n"), wsccCheckCode);
+			engine_DestroySession(m_pesEngine);
+			applog_close();
+			return 1;
+		}
+	}
+
+	//
+	// record until the duration has elapsed, Ctrl+C is pressed or the engine stops the recording
+	//
+	memset(&piPatientInfo, 0, sizeof(piPatientInfo));
+	memset(&riRecordingInfo, 0, sizeof(riRecordingInfo));
+	if(engine_StartRecording(m_pesEngine, &piPatientInfo, &riRecordingInfo))
+	{
+		_tprintf(TEXT("Recording... (press Ctrl+C to stop)\n"));
+		WaitForSingleObject(m_hevStop, dwrdDuration);
+	}
+	else
+	{
+		m_lngStopCode = Stop_Abort;
+	}
+
+	if(engine_StopRecording(m_pesEngine, (StopCode) m_lngStopCode, strFinalEDFFilePath, _countof(strFinalEDFFilePath)))
+	{
+		engine_GetStatus(m_pesEngine, &esStatus);
+		_tprintf(TEXT("\nRecording saved in %s (%d data records, %d packets received, %d errors).\n"),
+				 strFinalEDFFilePath, esStatus.NDataRecords, esStatus.NPacketsReceived,
+				 esStatus.NPacketChecksumErrors + esStatus.NPacketsLost);
+	}
+	else
+	{
+		_ftprintf(stderr, TEXT("\nThe recording was not saved.\n"));
+		intReturnValue = 1;
+	}
+
+	// clean-up
+	engine_DestroySession(m_pesEngine);
+	CloseHandle(m_hevStop);
+	applog_close();
+
+	return intReturnValue;
+}
@@ -0,0 +1,231 @@
+/**
+ * \file		simd_test.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Comparison of the SIMD kernel variants.
+ *
+ * Every kernel of every instruction set that the processor supports is run on random inputs (random lengths, unaligned
+ * buffers, full value ranges) and its results are compared with those of the scalar reference kernel:
+ *	- integer results and integer-to-floating-point conversions must be identical, and the kernels must not write past
+ *	  the end of their destination buffers;
+ *	- floating-point sums may only differ by the rounding caused by the different order of the additions.
+ * The test exits with 1 if any variant differs from the reference.
+ *
+ * Usage: simd_test [number of trials = 2000] [seed = 1]
+ *
+ * $Id$
+ */
+
+# include <math.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+# include "compat.h"
+# include "simd.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define TEST_MAX_LENGTH			1031				///< longest vector (covers all remainder cases of every kernel)
+# define TEST_GUARD					16					///< elements after the end of each destination that must not be written
+# define TEST_TOLERANCE				1e-12				///< maximum difference of floating-point sums, relative to the sum of magnitudes
+# define TEST_NKERNELS				5
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static unsigned int			m_uintSeed;
+static const char *			mc_strLevels [SIMDLevel_Count] = {"scalar", "SSE2", "SSSE3", "AVX"};
+static const char *			mc_strKernels [TEST_NKERNELS] = {"DotProduct", "ShortToDouble", "ByteSum", "DecodeSamples", "WelfordUpdate"};
+
+// inputs (one extra element so that the kernels can be run on unaligned buffers)
+static double				m_dblA [TEST_MAX_LENGTH + 1], m_dblB [TEST_MAX_LENGTH + 1];
+static short				m_shrSource [TEST_MAX_LENGTH + 1];
+static unsigned char		m_uchrBytes [TEST_MAX_LENGTH + 1];
+static WORD					m_wrdInterleaved [TEST_MAX_LENGTH + SIMD_DECODE_MAX_CHANNELS];
+
+// results of the reference kernels and of the tested variant
+static double				m_dblReference [TEST_MAX_LENGTH + TEST_GUARD], m_dblResult [TEST_MAX_LENGTH + TEST_GUARD];
+static double				m_dblReferenceM2 [TEST_MAX_LENGTH + TEST_GUARD], m_dblResultM2 [TEST_MAX_LENGTH + TEST_GUARD];
+static short				m_shrDecodedReference [SIMD_DECODE_MAX_CHANNELS][TEST_MAX_LENGTH + TEST_GUARD];
+static short				m_shrDecodedResult [SIMD_DECODE_MAX_CHANNELS][TEST_MAX_LENGTH + TEST_GUARD];
+
+//---------------------------------------------------------------------------
+//							Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Returns a pseudo-random 16 bit number.
+ */
+static unsigned int test_Random (void)
+{
+	m_uintSeed = m_uintSeed*1103515245 + 12345;
+	return m_uintSeed >> 16;
+}
+
+/**
+ * \brief Runs one kernel of the selected instruction set on the current inputs.
+ *
+ * \param[in]	intKernel		kernel (index into mc_strKernels)
+ * \param[in]	uintLength		number of elements
+ * \param[in]	uintOffset		offset of the inputs from the start of the input buffers (0 or 1)
+ * \param[in]	uintNChannels	number of interleaved channels (DecodeSamples only)
+ * \param[in]	uintIndex		destination index (DecodeSamples only)
+ * \param[out]	pdblResult		result buffer (TEST_MAX_LENGTH + TEST_GUARD elements; element 0 holds scalar results)
+ * \param[out]	pdblResultM2	second result buffer (WelfordUpdate only)
+ * \param[out]	pshrDecoded		decoded channels (DecodeSamples only)
+ */
+static void test_RunKernel (int intKernel, unsigned int uintLength, unsigned int uintOffset, unsigned int uintNChannels, unsigned int uintIndex,
+							double * pdblResult, double * pdblResultM2, short (* pshrDecoded) [TEST_MAX_LENGTH + TEST_GUARD])
+{
+	short * ppshrDestination [SIMD_DECODE_MAX_CHANNELS];
+	unsigned int i;
+
+	for (i = 0; i < TEST_MAX_LENGTH + TEST_GUARD; i++)
+		pdblResult [i] = pdblResultM2 [i] = -1.5;
+
+	switch (intKernel)
+	{
+		case 0:
+			pdblResult [0] = simd_DotProduct (m_dblA + uintOffset, m_dblB + uintOffset, uintLength);
+			break;
+
+		case 1:
+			simd_ShortToDouble (m_shrSource + uintOffset, pdblResult, uintLength);
+			break;
+
+		case 2:
+			pdblResult [0] = (double) simd_ByteSum (m_uchrBytes + uintOffset, uintLength);
+			break;
+
+		case 3:
+			memset (pshrDecoded, 0x55, sizeof (m_shrDecodedResult));
+			for (i = 0; i < SIMD_DECODE_MAX_CHANNELS; i++)
+				ppshrDestination [i] = pshrDecoded [i];
+			simd_DecodeSamples (m_wrdInterleaved + uintOffset, uintNChannels, uintLength/uintNChannels, ppshrDestination, uintIndex);
+			break;
+
+		case 4:
+			for (i = 0; i < uintLength; i++)
+			{
+				pdblResult [i] = m_dblB [i + uintOffset];
+				pdblResultM2 [i] = fabs (m_dblA [i + uintOffset]);
+			}
+			simd_WelfordUpdate (m_dblA + uintOffset, pdblResult, pdblResultM2, 1.0/7.0, uintLength);
+			break;
+	}
+}
+
+/**
+ * \brief Compares the results of a variant with those of the reference kernel.
+ *
+ * \return TRUE if the results match, FALSE otherwise.
+ */
+static BOOL test_CompareResults (int intKernel, unsigned int uintLength, unsigned int uintOffset)
+{
+	double dblMagnitude;
+	unsigned int i;
+
+	switch (intKernel)
+	{
+		case 0:
+			dblMagnitude = 0.0;
+			for (i = 0; i < uintLength; i++)
+				dblMagnitude += fabs (m_dblA [i + uintOffset]*m_dblB [i + uintOffset]);
+			return fabs (m_dblResult [0] - m_dblReference [0]) <= TEST_TOLERANCE*dblMagnitude;
+
+		case 1:
+		case 2:
+			return memcmp (m_dblResult, m_dblReference, sizeof (m_dblResult)) == 0;
+
+		case 3:
+			return memcmp (m_shrDecodedResult, m_shrDecodedReference, sizeof (m_shrDecodedResult)) == 0;
+
+		case 4:
+			for (i = 0; i < TEST_MAX_LENGTH + TEST_GUARD; i++)
+			{
+				if (fabs (m_dblResult [i] - m_dblReference [i]) > TEST_TOLERANCE*(fabs (m_dblReference [i]) + 1.0) ||
+					fabs (m_dblResultM2 [i] - m_dblReferenceM2 [i]) > TEST_TOLERANCE*(fabs (m_dblReferenceM2 [i]) + 1.0))
+					return FALSE;
+			}
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+int main (int argc, char * argv [])
+{
+	unsigned long ulngMismatches [SIMDLevel_Count][TEST_NKERNELS];
+	unsigned int uintNTrials, uintTrial, uintLength, uintOffset, uintNChannels, uintIndex, i;
+	int intMaxLevel, intLevel, intKernel;
+	BOOL blnFailed;
+
+	uintNTrials = (argc > 1) ? (unsigned int) strtoul (argv [1], NULL, 10) : 2000;
+	m_uintSeed = (argc > 2) ? (unsigned int) strtoul (argv [2], NULL, 10) : 1;
+
+	intMaxLevel = (int) simd_init ();
+	memset (ulngMismatches, 0, sizeof (ulngMismatches));
+
+	for (uintTrial = 0; uintTrial < uintNTrials; uintTrial++)
+	{
+		// inputs over the full value ranges
+		for (i = 0; i < TEST_MAX_LENGTH + 1; i++)
+		{
+			m_shrSource [i] = (short) test_Random ();
+			m_uchrBytes [i] = (unsigned char) test_Random ();
+			m_dblA [i] = (double) (short) test_Random ()/1000.0;
+			m_dblB [i] = (double) (short) test_Random ()/32768.0;
+		}
+		for (i = 0; i < TEST_MAX_LENGTH + SIMD_DECODE_MAX_CHANNELS; i++)
+			m_wrdInterleaved [i] = (WORD) test_Random ();
+
+		// short vectors are where the remainder handling differs between the variants
+		uintLength = (uintTrial & 1) ? test_Random () % 80 : test_Random () % (TEST_MAX_LENGTH + 1);
+		uintOffset = test_Random () & 1;
+		uintNChannels = test_Random () % SIMD_DECODE_MAX_CHANNELS + 1;
+		uintIndex = test_Random () % TEST_GUARD;
+		if (uintLength/uintNChannels + uintIndex > TEST_MAX_LENGTH + TEST_GUARD)
+			uintIndex = 0;
+
+		for (intKernel = 0; intKernel < TEST_NKERNELS; intKernel++)
+		{
+			simd_SetLevel (SIMDLevel_Scalar);
+			test_RunKernel (intKernel, uintLength, uintOffset, uintNChannels, uintIndex, m_dblReference, m_dblReferenceM2, m_shrDecodedReference);
+
+			for (intLevel = SIMDLevel_SSE2; intLevel <= intMaxLevel; intLevel++)
+			{
+				simd_SetLevel ((SIMDLevel) intLevel);
+				test_RunKernel (intKernel, uintLength, uintOffset, uintNChannels, uintIndex, m_dblResult, m_dblResultM2, m_shrDecodedResult);
+				if (!test_CompareResults (intKernel, uintLength, uintOffset))
+					ulngMismatches [intLevel][intKernel]++;
+			}
+		}
+	}
+
+	blnFailed = FALSE;
+	printf ("%u trials, instruction sets up to %s\n", uintNTrials, mc_strLevels [intMaxLevel]);
+	for (intLevel = SIMDLevel_SSE2; intLevel < SIMDLevel_Count; intLevel++)
+	{
+		for (intKernel = 0; intKernel < TEST_NKERNELS; intKernel++)
+		{
+			if (intLevel > intMaxLevel)
+				printf ("%-6s %-14s: not supported\n", mc_strLevels [intLevel], mc_strKernels [intKernel]);
+			else
+			{
+				printf ("%-6s %-14s: %s (%lu mismatches)\n", mc_strLevels [intLevel], mc_strKernels [intKernel],
+						ulngMismatches [intLevel][intKernel] ? "FAILED" : "ok", ulngMismatches [intLevel][intKernel]);
+				blnFailed |= (ulngMismatches [intLevel][intKernel] != 0);
+			}
+		}
+	}
+
+	simd_SetLevel ((SIMDLevel) intMaxLevel);
+
+	return blnFailed ? 1 : 0;
+}
@@ -20,8 +20,7 @@
 //---------------------------------------------------------------------------
 # define ANNOTATION_MAX_TYPES			7					// Number of different possible annotations
 # define ANNOTATION_MAX_CHARS			60					// Maximum number of characters per annotation (needs to be an even number)
-# define ANNOTATION_MAX_NO  			3					// Maximum # of annotations per datarecord
-# define ANNOTATION_TOTAL_NCHARS		192					// Number of bytes per data record [has to be >= than ANNOTATION_MAX_NO * (ANNOTATION_MAX_CHARS + 1) + 9] -> +7*24*3600__ = 9 chars
+# define ANNOTATION_TOTAL_NCHARS		192					// Number of bytes per data record [has to be >= than 9 + ANNOTATION_MAX_CHARS + 14] -> time-keeping TAL +7*24*3600__ = 9 chars, annotation TAL +7*24*3600.0000__ + separator = 14 chars
 # define ANNOTATION_MUTEX_TIMEOUT		1 					// 
 
 # endif
\ No newline at end of file
@@ -0,0 +1,223 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		annotqueue.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Queue that passes annotations to the sample thread, which stores them in the data records.
+ *
+ * Annotations are made by the GUI thread (user annotations, coordinator hot-plugging) and by the sample thread
+ * (communication failures). Each one carries the index of the sample at which it was made. When the sample thread
+ * completes a data record, it packs the time-keeping TAL and as many of the waiting annotations as fit into the record's
+ * annotation signal, each as a TAL with its own onset; the annotations that do not fit wait for the next record.
+ *
+ * The queue is a fixed array of slots that are claimed with an interlocked compare-and-exchange, so adding an annotation
+ * takes a bounded number of steps and never waits for another thread: a producer tries each slot at most once, starting
+ * at the slot of the next ticket, and drops the annotation if all of them are taken. Once it holds a slot, the producer
+ * takes a ticket, so every ticket belongs to a slot that is being written or is ready. The sample thread packs the
+ * annotations in ticket order and stops at the first ticket that is not ready yet, so they are stored in the order in
+ * which they were made.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdio.h>
+#include <string.h>
+#include <tchar.h>
+#include <time.h>
+
+// program headers
+#include "annotations.h"
+#include "annotqueue.h"
+#include "edfPlus.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define ANNOTQUEUE_FREE				0						///< slot can be claimed by a producer
+# define ANNOTQUEUE_WRITING				1						///< slot is being filled by a producer
+# define ANNOTQUEUE_READY				2						///< slot holds an annotation waiting to be stored
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Slot of the annotation queue.
+ */
+typedef struct
+{
+	volatile LONG	State;											///< ANNOTQUEUE_FREE, ANNOTQUEUE_WRITING or ANNOTQUEUE_READY
+	LONG			Ticket;											///< order in which the annotation was queued
+	LONGLONG		Sample;											///< index of the sample at which the annotation was made
+	char			Text[ANNOTATION_MAX_CHARS + 1];
+}
+AnnotationSlot;
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static AnnotationSlot		m_asSlots[ANNOTQUEUE_LENGTH];
+static volatile LONG		m_lngNextTicket;
+static LONG					m_lngNextPackedTicket;						///< ticket of the next annotation to be stored (only accessed by the sample thread)
+static volatile LONG		m_lngNDropped;
+static long					m_lngNCarried;								///< only accessed by the sample thread
+static int					m_intSamplingFrequency;
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Reads the counters of the queue.
+ *
+ * \param[out]	paqsStatistics	buffer where the counters are to be stored
+ * \return Nothing.
+ */
+void annotqueue_GetStatistics(AnnotationQueueStatistics * paqsStatistics)
+{
+	paqsStatistics->NQueued = m_lngNextTicket;
+	paqsStatistics->NDropped = m_lngNDropped;
+	paqsStatistics->NCarried = m_lngNCarried;
+}
+
+/**
+ * \brief Fills the annotation signal of a data record: the time-keeping TAL followed by as many of the waiting
+ * annotations as fit, oldest first, each in a TAL of its own.
+ *
+ * Must only be called by the sample thread. The annotations that do not fit stay in the queue, as do the ones that
+ * were queued after an annotation that is still being written.
+ *
+ * \param[out]	strSignal			annotation signal of the data record (the unused part is zeroed)
+ * \param[in]	uintSignalLen		size of strSignal, in bytes
+ * \param[in]	uintTimeKeepingTAL	onset of the data record (s)
+ * \return Number of annotations stored.
+ */
+unsigned int annotqueue_Pack(char * strSignal, unsigned int uintSignalLen, unsigned int uintTimeKeepingTAL)
+{
+	AnnotationSlot * pasReady[ANNOTQUEUE_LENGTH], * pasTemp;
+	char strTAL[ANNOTATION_MAX_CHARS + 24];
+	unsigned int uintNReady, uintNStored, uintNBytesUsed, uintLength, i, j;
+	LONGLONG llngOnset;
+
+	SecureZeroMemory(strSignal, uintSignalLen);
+	sprintf_s(strSignal, uintSignalLen, "+%u%c%c", uintTimeKeepingTAL, (char) 20, (char) 20);
+	uintNBytesUsed = (unsigned int) strlen(strSignal) + 1;
+
+	// waiting annotations, sorted by ticket (the slots are only released by this thread, so the list stays valid)
+	uintNReady = 0;
+	for(i = 0; i < ANNOTQUEUE_LENGTH; i++)
+	{
+		if(m_asSlots[i].State != ANNOTQUEUE_READY)
+			continue;
+
+		pasReady[uintNReady] = &m_asSlots[i];
+		for(j = uintNReady; j > 0 && pasReady[j - 1]->Ticket - pasReady[j]->Ticket > 0; j--)
+		{
+			pasTemp = pasReady[j - 1];
+			pasReady[j - 1] = pasReady[j];
+			pasReady[j] = pasTemp;
+		}
+		uintNReady++;
+	}
+	MemoryBarrier();
+
+	// pack the TALs until one does not fit or a ticket is missing, i.e., an earlier annotation is still being written (the
+	// rest are carried over, so the order is kept)
+	for(uintNStored = 0; uintNStored < uintNReady; uintNStored++)
+	{
+		if(pasReady[uintNStored]->Ticket != m_lngNextPackedTicket)
+			break;
+
+		// onset in units of 100 us, rounded to the nearest unit
+		llngOnset = (pasReady[uintNStored]->Sample*EDFDURATIONOFRECORD*10000 + m_intSamplingFrequency/2)/m_intSamplingFrequency;
+		sprintf_s(strTAL, _countof(strTAL), "+%lu.%04lu%c%s%c",
+				  (unsigned long) (llngOnset/10000), (unsigned long) (llngOnset%10000), (char) 20, pasReady[uintNStored]->Text, (char) 20);
+		uintLength = (unsigned int) strlen(strTAL) + 1;
+		if(uintNBytesUsed + uintLength > uintSignalLen)
+			break;
+
+		memcpy(strSignal + uintNBytesUsed, strTAL, uintLength);
+		uintNBytesUsed += uintLength;
+
+		InterlockedExchange(&pasReady[uintNStored]->State, ANNOTQUEUE_FREE);
+		m_lngNextPackedTicket++;
+	}
+	m_lngNCarried += uintNReady - uintNStored;
+
+	return uintNStored;
+}
+
+/**
+ * \brief Queues an annotation.
+ *
+ * Can be called from any thread; never waits for another thread.
+ *
+ * \param[in]	llngSample		index, in the recording, of the sample at which the annotation was made
+ * \param[in]	strText			text of the annotation (truncated to ANNOTATION_MAX_CHARS characters)
+ * \return TRUE if the annotation was queued, FALSE if the queue was full.
+ */
+BOOL annotqueue_Push(LONGLONG llngSample, const char * strText)
+{
+	AnnotationSlot * pasSlot;
+	LONG lngTicket;
+	unsigned int i;
+
+	// the next ticket only spreads the producers over the slots; the ticket is taken once a slot is held, so a dropped
+	// annotation leaves no gap in the tickets
+	lngTicket = m_lngNextTicket + 1;
+	for(i = 0; i < ANNOTQUEUE_LENGTH; i++)
+	{
+		pasSlot = &m_asSlots[(lngTicket + i) & (ANNOTQUEUE_LENGTH - 1)];
+		if(InterlockedCompareExchange(&pasSlot->State, ANNOTQUEUE_WRITING, ANNOTQUEUE_FREE) != ANNOTQUEUE_FREE)
+			continue;
+
+		pasSlot->Ticket = InterlockedIncrement(&m_lngNextTicket);
+		pasSlot->Sample = (llngSample > 0) ? llngSample : 0;
+		strncpy_s(pasSlot->Text, _countof(pasSlot->Text), strText, _TRUNCATE);
+
+		// publishes the contents of the slot
+		InterlockedExchange(&pasSlot->State, ANNOTQUEUE_READY);
+		return TRUE;
+	}
+
+	InterlockedIncrement(&m_lngNDropped);
+	return FALSE;
+}
+
+/**
+ * \brief Empties the queue at the start of a recording.
+ *
+ * Must only be called while no other thread uses the queue.
+ *
+ * \param[in]	intSamplingFrequency	sampling frequency of the recording (Hz)
+ * \return Nothing.
+ */
+void annotqueue_Reset(int intSamplingFrequency)
+{
+	SecureZeroMemory(m_asSlots, sizeof(m_asSlots));
+	m_lngNextTicket = m_lngNDropped = 0;
+	m_lngNextPackedTicket = 1;
+	m_lngNCarried = 0;
+	m_intSamplingFrequency = (intSamplingFrequency > 0) ? intSamplingFrequency : 1;
+}
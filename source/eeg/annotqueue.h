@@ -0,0 +1,47 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		annotqueue.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the queue that passes annotations to the sample thread, which stores them in the data records.
+ *
+ * $Id$
+ */
+
+# ifndef __ANNOTQUEUE_H__
+# define __ANNOTQUEUE_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define ANNOTQUEUE_LENGTH				64						///< number of annotations that can wait to be stored (must be a power of 2)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Counters of the annotation queue.
+ */
+typedef struct
+{
+	long	NQueued;												///< number of annotations queued
+	long	NDropped;												///< number of annotations dropped because the queue was full
+	long	NCarried;												///< number of times an annotation did not fit in a data record and was carried over to the next one
+}
+AnnotationQueueStatistics;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+void			annotqueue_GetStatistics(AnnotationQueueStatistics * paqsStatistics);
+unsigned int	annotqueue_Pack(char * strSignal, unsigned int uintSignalLen, unsigned int uintTimeKeepingTAL);
+BOOL			annotqueue_Push(LONGLONG llngSample, const char * strText);
+void			annotqueue_Reset(int intSamplingFrequency);
+
+# endif
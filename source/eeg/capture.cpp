@@ -0,0 +1,281 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		capture.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that captures the raw traffic of the WEEG link to a file.
+ *
+ * Every block of bytes received by the serial reader thread and every packet sent by serial_SendPacket() is stored as a
+ * record with a microsecond-resolution host timestamp (see CaptureRecordHeader). Records are appended to one of two
+ * in-memory buffers; a low-priority writer thread swaps the buffers and writes the full one to disk, so the link is never
+ * stalled by disk I/O. If the writer falls behind and the buffer fills up, records are dropped and counted instead.
+ *
+ * Capture files are replayed by the capture file transport (see transport.cpp).
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+
+// program headers
+#include "applog.h"
+#include "capture.h"
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+static long WINAPI	capture_WriterThread(LPARAM lParam);
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static volatile BOOL		m_blnActive = FALSE;						///< TRUE while records are being accepted
+static HANDLE				m_hFile = INVALID_HANDLE_VALUE;
+static HANDLE				m_hWriterThread = NULL;
+static HANDLE				m_hevWriterStop = NULL;
+static CRITICAL_SECTION		m_csBufferGuard;							///< protects the active buffer (records come from the reader thread and from the sending thread)
+static BYTE *				m_pbytBuffers[2];
+static DWORD				m_dwrdBufferLength;							///< number of bytes in the active buffer
+static unsigned int			m_uintActiveBuffer;							///< index of the buffer to which records are appended
+static LARGE_INTEGER		m_liFrequency;								///< frequency of the performance counter
+static LONGLONG				m_llngLastRecordTime;						///< time of the previous record, in us since the start of the capture
+static LARGE_INTEGER		m_liStartCounter;
+static long					m_lngNBytesDropped;							///< number of data bytes that could not be buffered
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Writes the inactive buffer to the capture file.
+ *
+ * The buffers are swapped under the lock, so the (possibly slow) write does not block the link.
+ *
+ * \return Nothing.
+ */
+static void capture_Flush(void)
+{
+	BYTE * pbytData;
+	DWORD dwrdLength, dwrdNBytesWritten;
+
+	EnterCriticalSection(&m_csBufferGuard);
+	pbytData = m_pbytBuffers[m_uintActiveBuffer];
+	dwrdLength = m_dwrdBufferLength;
+	m_uintActiveBuffer ^= 1;
+	m_dwrdBufferLength = 0;
+	LeaveCriticalSection(&m_csBufferGuard);
+
+	if(dwrdLength > 0)
+		WriteFile(m_hFile, pbytData, dwrdLength, &dwrdNBytesWritten, NULL);
+}
+
+/**
+ * \brief Function executed by the capture writer thread.
+ *
+ * \param[in]	lParam		not used
+ * \return 0.
+ */
+static long WINAPI capture_WriterThread(LPARAM lParam)
+{
+	while(WaitForSingleObject(m_hevWriterStop, CAPTURE_FLUSH_INTERVAL) == WAIT_TIMEOUT)
+		capture_Flush();
+
+	// write whatever is left in the active buffer
+	capture_Flush();
+
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Creates a capture file and starts capturing the traffic of the WEEG link.
+ *
+ * \param[in]	strFilePath		path of the capture file (an existing file is overwritten)
+ * \return TRUE if successful, FALSE otherwise.
+ */
+BOOL capture_Open(const TCHAR * strFilePath)
+{
+	CaptureFileHeader cfhHeader;
+	DWORD dwrdNBytesWritten;
+
+	if(m_hFile != INVALID_HANDLE_VALUE)
+		capture_Close();
+
+	// create file & write header
+	m_hFile = CreateFile(strFilePath, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(m_hFile == INVALID_HANDLE_VALUE)
+		return FALSE;
+
+	SecureZeroMemory(&cfhHeader, sizeof(cfhHeader));
+	memcpy(cfhHeader.Magic, CAPTURE_MAGIC, sizeof(cfhHeader.Magic));
+	cfhHeader.Version = CAPTURE_VERSION;
+	GetSystemTimeAsFileTime(&cfhHeader.StartTime);
+	if(!WriteFile(m_hFile, &cfhHeader, sizeof(cfhHeader), &dwrdNBytesWritten, NULL) || dwrdNBytesWritten != sizeof(cfhHeader))
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+		return FALSE;
+	}
+
+	// allocate buffers
+	m_pbytBuffers[0] = (BYTE *) malloc(CAPTURE_BUFFER_LENGTH);
+	m_pbytBuffers[1] = (BYTE *) malloc(CAPTURE_BUFFER_LENGTH);
+	m_hevWriterStop = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if(m_pbytBuffers[0] == NULL || m_pbytBuffers[1] == NULL || m_hevWriterStop == NULL)
+	{
+		free(m_pbytBuffers[0]); m_pbytBuffers[0] = NULL;
+		free(m_pbytBuffers[1]); m_pbytBuffers[1] = NULL;
+		if(m_hevWriterStop != NULL)
+		{
+			CloseHandle(m_hevWriterStop);
+			m_hevWriterStop = NULL;
+		}
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+		return FALSE;
+	}
+
+	InitializeCriticalSection(&m_csBufferGuard);
+	m_dwrdBufferLength = 0;
+	m_uintActiveBuffer = 0;
+	m_lngNBytesDropped = 0;
+	m_llngLastRecordTime = 0;
+	QueryPerformanceFrequency(&m_liFrequency);
+	QueryPerformanceCounter(&m_liStartCounter);
+
+	// start writer thread
+	m_hWriterThread = CreateThread (NULL,										// handle cannot be inherited by child processes
+									4096,										// initial size of the stack, in bytes
+									(LPTHREAD_START_ROUTINE) capture_WriterThread,
+									NULL,										// no thread data
+									0,											// thread runs immediately after creation
+									NULL);										// thread identifier is not needed
+	if(m_hWriterThread == NULL)
+	{
+		DeleteCriticalSection(&m_csBufferGuard);
+		free(m_pbytBuffers[0]); m_pbytBuffers[0] = NULL;
+		free(m_pbytBuffers[1]); m_pbytBuffers[1] = NULL;
+		CloseHandle(m_hevWriterStop);
+		m_hevWriterStop = NULL;
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+		return FALSE;
+	}
+	SetThreadPriority(m_hWriterThread, THREAD_PRIORITY_BELOW_NORMAL);
+
+	m_blnActive = TRUE;
+
+	return TRUE;
+}
+
+/**
+ * \brief Stops capturing, writes the remaining records and closes the capture file.
+ *
+ * Must not be called while capture_Record() can still be called (i.e., close the link first).
+ *
+ * \return Nothing.
+ */
+void capture_Close(void)
+{
+	if(m_hFile == INVALID_HANDLE_VALUE)
+		return;
+
+	m_blnActive = FALSE;
+
+	// stop writer thread (it flushes the buffers before exiting)
+	SetEvent(m_hevWriterStop);
+	WaitForSingleObject(m_hWriterThread, INFINITE);
+	CloseHandle(m_hWriterThread);
+	m_hWriterThread = NULL;
+	CloseHandle(m_hevWriterStop);
+	m_hevWriterStop = NULL;
+
+	CloseHandle(m_hFile);
+	m_hFile = INVALID_HANDLE_VALUE;
+
+	DeleteCriticalSection(&m_csBufferGuard);
+	free(m_pbytBuffers[0]); m_pbytBuffers[0] = NULL;
+	free(m_pbytBuffers[1]); m_pbytBuffers[1] = NULL;
+
+	if(m_lngNBytesDropped > 0)
+		applog_logevent(SoftwareError, TEXT("Capture"), TEXT("capture_Close(): Number of link bytes that could not be captured"), m_lngNBytesDropped, TRUE);
+}
+
+/**
+ * \brief Appends a block of link traffic to the capture.
+ *
+ * Does nothing if no capture is in progress. Never blocks on disk I/O: if the active buffer is full, the data is dropped.
+ *
+ * \param[in]	cdDirection		direction of the traffic
+ * \param[in]	pbytData		data
+ * \param[in]	dwrdLength		number of bytes in pbytData
+ * \return Nothing.
+ */
+void capture_Record(CaptureDirection cdDirection, const BYTE * pbytData, DWORD dwrdLength)
+{
+	BYTE * pbytRecord;
+	CaptureRecordHeader crhHeader;
+	DWORD dwrdRecordLength;
+	LARGE_INTEGER liCounter;
+	LONGLONG llngTime;
+
+	if(!m_blnActive)
+		return;
+
+	EnterCriticalSection(&m_csBufferGuard);
+
+	// time stamp (taken under the lock, so that the records are in chronological order)
+	QueryPerformanceCounter(&liCounter);
+	llngTime = (liCounter.QuadPart - m_liStartCounter.QuadPart) * 1000000 / m_liFrequency.QuadPart;
+
+	while(dwrdLength > 0)
+	{
+		dwrdRecordLength = (dwrdLength > 0xFFFF) ? 0xFFFF : dwrdLength;
+		if(m_dwrdBufferLength + sizeof(CaptureRecordHeader) + dwrdRecordLength > CAPTURE_BUFFER_LENGTH)
+		{
+			m_lngNBytesDropped += dwrdLength;
+			break;
+		}
+
+		crhHeader.Direction = (BYTE) cdDirection;
+		crhHeader.Length = (WORD) dwrdRecordLength;
+		crhHeader.TimeDelta = (DWORD) (llngTime - m_llngLastRecordTime);
+		m_llngLastRecordTime = llngTime;
+
+		pbytRecord = m_pbytBuffers[m_uintActiveBuffer] + m_dwrdBufferLength;
+		memcpy(pbytRecord, &crhHeader, sizeof(crhHeader));
+		memcpy(pbytRecord + sizeof(crhHeader), pbytData, dwrdRecordLength);
+		m_dwrdBufferLength += sizeof(crhHeader) + dwrdRecordLength;
+
+		pbytData += dwrdRecordLength;
+		dwrdLength -= dwrdRecordLength;
+	}
+
+	LeaveCriticalSection(&m_csBufferGuard);
+}
@@ -0,0 +1,67 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		capture.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that captures the raw traffic of the WEEG link to a file.
+ *
+ * $Id$
+ */
+
+# ifndef __CAPTURE_H__
+# define __CAPTURE_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Includes
+//---------------------------------------------------------------------------
+# include "compat.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define CAPTURE_MAGIC					"WEEGCAP1"				///< first bytes of a capture file
+# define CAPTURE_VERSION				1
+# define CAPTURE_BUFFER_LENGTH			(256*1024)				///< size of each of the two in-memory buffers between the link and the writer thread, in bytes
+# define CAPTURE_FLUSH_INTERVAL			250						///< maximum time that captured data stays in memory, in ms
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+typedef enum {CaptureDirection_Received = 0,					///< bytes received from the coordinator
+			  CaptureDirection_Sent = 1							///< packet sent to the coordinator
+			 } CaptureDirection;
+
+# pragma pack (push, 1)
+// file header
+typedef struct
+{
+	char		Magic [8];										///< CAPTURE_MAGIC (not NULL-terminated)
+	DWORD		Version;										///< CAPTURE_VERSION
+	FILETIME	StartTime;										///< UTC time at which the capture was started
+}
+CaptureFileHeader;
+
+// header of each record; followed by Length bytes of data
+typedef struct
+{
+	BYTE		Direction;										///< see CaptureDirection
+	WORD		Length;											///< number of data bytes in the record
+	DWORD		TimeDelta;										///< time elapsed since the previous record (or since the start of the capture), in microseconds
+}
+CaptureRecordHeader;
+# pragma pack (pop)
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+BOOL	capture_Open(const TCHAR * strFilePath);
+void	capture_Close(void);
+void	capture_Record(CaptureDirection cdDirection, const BYTE * pbytData, DWORD dwrdLength);
+
+# endif
@@ -0,0 +1,323 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		clockdrift.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that estimates the drift between the clocks of the measurement device and the PC.
+ *
+ * The EDF+ time base assumes that the measurement device produces exactly SamplingFrequency samples per second of the
+ * PC's clock. The crystals of the two never agree exactly, so over a long recording the sample that is being recorded
+ * when the user enters an annotation drifts away from the one that the nominal time base predicts.
+ *
+ * The sample thread reports the time stamp of every in-sequence DATA packet of the primary measurement device together
+ * with the performance counter value at its reception. The time stamp gives the device time of the packet, and the
+ * difference between the elapsed PC time and the elapsed device time is the accumulated clock offset plus the latency of
+ * the packet. The latency is always positive and its spikes (radio retries, USB scheduling, a busy PC) are large
+ * compared to the drift, so a plain regression over all packets would be biased by them. Instead, the packets are
+ * grouped into blocks of CLOCKDRIFT_BLOCKLENGTH seconds of device time, only the packet with the smallest offset of
+ * each block is kept, and a least-squares line is fitted through the last CLOCKDRIFT_NBLOCKS block minima. The slope
+ * of the line is the rate error of the device clock and the excess of a packet's offset over the line is its
+ * acquisition latency above the minimum latency of the link.
+ *
+ * As in linkstats.cpp, the sample thread is the only writer and readers take lock-free snapshots guarded by a sequence
+ * counter.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdio.h>
+#include <tchar.h>
+
+// program headers
+#include "clockdrift.h"
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static ClockDriftEstimate	m_cdeEstimate;
+static volatile LONG		m_lngSequence;								///< odd while m_cdeEstimate is being updated
+
+// state of the writer (only accessed by the sample thread)
+static int					m_intSamplingFrequency;
+static DWORD				m_dwrdFirstTimeStamp;
+static double				m_dblBlockDeviceTime [CLOCKDRIFT_NBLOCKS];	///< device times of the block minima (s)
+static double				m_dblBlockOffset [CLOCKDRIFT_NBLOCKS];		///< PC time minus device time of the block minima (s)
+static long					m_lngCurrentBlock;							///< index of the block that is being filled (-1 before the first packet)
+static double				m_dblCurrentDeviceTime;						///< device time of the current block's minimum
+static double				m_dblCurrentOffset;							///< offset of the current block's minimum
+static double				m_dblLatencySum;							///< sum of the excess latencies (s)
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Marks the start of an update of the estimate.
+ *
+ * \return Nothing.
+ */
+static void clockdrift_BeginUpdate(void)
+{
+	InterlockedIncrement(&m_lngSequence);
+}
+
+/**
+ * \brief Marks the end of an update of the estimate.
+ *
+ * \return Nothing.
+ */
+static void clockdrift_EndUpdate(void)
+{
+	InterlockedIncrement(&m_lngSequence);
+}
+
+/**
+ * \brief Stores the minimum of the current block and fits the minimum-latency line through the stored block minima.
+ *
+ * Must be called between clockdrift_BeginUpdate() and clockdrift_EndUpdate().
+ *
+ * \return Nothing.
+ */
+static void clockdrift_CloseBlock(void)
+{
+	long i, lngNBlocks;
+	double dblMeanTime, dblMeanOffset, dblSxx, dblSxy;
+
+	m_dblBlockDeviceTime[m_cdeEstimate.NBlocks % CLOCKDRIFT_NBLOCKS] = m_dblCurrentDeviceTime;
+	m_dblBlockOffset[m_cdeEstimate.NBlocks % CLOCKDRIFT_NBLOCKS] = m_dblCurrentOffset;
+	m_cdeEstimate.NBlocks++;
+	if(m_cdeEstimate.NBlocks < 2)
+		return;
+
+	// least-squares fit (two passes, the window is short enough to be refitted from scratch)
+	lngNBlocks = (m_cdeEstimate.NBlocks < CLOCKDRIFT_NBLOCKS) ? m_cdeEstimate.NBlocks : CLOCKDRIFT_NBLOCKS;
+	dblMeanTime = dblMeanOffset = 0;
+	for(i = 0; i < lngNBlocks; i++)
+	{
+		dblMeanTime += m_dblBlockDeviceTime[i];
+		dblMeanOffset += m_dblBlockOffset[i];
+	}
+	dblMeanTime /= lngNBlocks;
+	dblMeanOffset /= lngNBlocks;
+
+	dblSxx = dblSxy = 0;
+	for(i = 0; i < lngNBlocks; i++)
+	{
+		dblSxx += (m_dblBlockDeviceTime[i] - dblMeanTime) * (m_dblBlockDeviceTime[i] - dblMeanTime);
+		dblSxy += (m_dblBlockDeviceTime[i] - dblMeanTime) * (m_dblBlockOffset[i] - dblMeanOffset);
+	}
+	if(dblSxx <= 0)
+		return;
+
+	m_cdeEstimate.Slope = dblSxy / dblSxx;
+	m_cdeEstimate.Intercept = dblMeanOffset - m_cdeEstimate.Slope * dblMeanTime;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Adds an in-sequence DATA packet of the primary measurement device to the estimate.
+ *
+ * Must be called as soon as possible after the packet was framed (the performance counter is read here), and only by
+ * the sample thread. Packets with a repeated or out-of-order time stamp must not be reported.
+ *
+ * \param[in]	dwrdTimeStamp		time stamp of the packet
+ * \param[in]	llngRecordSample	index, in the recording, of the first sample of the packet
+ * \return Nothing.
+ */
+void clockdrift_AddPacket(DWORD dwrdTimeStamp, LONGLONG llngRecordSample)
+{
+	LARGE_INTEGER liCounter;
+	double dblDeviceTime, dblOffset, dblLatency;
+	long lngBlock;
+
+	QueryPerformanceCounter(&liCounter);
+
+	clockdrift_BeginUpdate();
+
+	if(m_cdeEstimate.NPackets == 0)
+	{
+		m_dwrdFirstTimeStamp = dwrdTimeStamp;
+		m_cdeEstimate.FirstCounter = liCounter.QuadPart;
+	}
+	dblDeviceTime = (double) (dwrdTimeStamp - m_dwrdFirstTimeStamp) / m_intSamplingFrequency;
+	dblOffset = (double) (liCounter.QuadPart - m_cdeEstimate.FirstCounter) / m_cdeEstimate.Frequency - dblDeviceTime;
+
+	// keep the minimum offset of each block
+	lngBlock = (long) (dblDeviceTime / CLOCKDRIFT_BLOCKLENGTH);
+	if(lngBlock != m_lngCurrentBlock)
+	{
+		if(m_lngCurrentBlock >= 0)
+			clockdrift_CloseBlock();
+		m_lngCurrentBlock = lngBlock;
+		m_dblCurrentDeviceTime = dblDeviceTime;
+		m_dblCurrentOffset = dblOffset;
+	}
+	else if(dblOffset < m_dblCurrentOffset)
+	{
+		m_dblCurrentDeviceTime = dblDeviceTime;
+		m_dblCurrentOffset = dblOffset;
+	}
+
+	// until the drift can be fitted, the line is the flat minimum of the first block
+	if(m_cdeEstimate.NBlocks < 2)
+	{
+		m_cdeEstimate.Slope = 0;
+		m_cdeEstimate.Intercept = (m_cdeEstimate.NBlocks == 0) ? m_dblCurrentOffset : m_dblBlockOffset[0];
+	}
+
+	// excess latency over the minimum-latency line
+	dblLatency = dblOffset - (m_cdeEstimate.Intercept + m_cdeEstimate.Slope * dblDeviceTime);
+	if(dblLatency < 0)
+		dblLatency = 0;
+	m_dblLatencySum += dblLatency;
+
+	m_cdeEstimate.NPackets++;
+	m_cdeEstimate.LastDeviceTime = dblDeviceTime;
+	m_cdeEstimate.LastRecordSample = llngRecordSample;
+	m_cdeEstimate.DriftPPM = m_cdeEstimate.Slope * 1e6;
+	m_cdeEstimate.SamplingFrequency = m_intSamplingFrequency / (1 + m_cdeEstimate.Slope);
+	m_cdeEstimate.ClockOffset = m_cdeEstimate.Slope * dblDeviceTime * 1000;
+	m_cdeEstimate.Latency = dblLatency * 1000;
+	m_cdeEstimate.MeanLatency = m_dblLatencySum * 1000 / m_cdeEstimate.NPackets;
+	if(m_cdeEstimate.Latency > m_cdeEstimate.MaxLatency)
+		m_cdeEstimate.MaxLatency = m_cdeEstimate.Latency;
+
+	clockdrift_EndUpdate();
+}
+
+/**
+ * \brief Formats the estimate as text for display in a multi-line edit control.
+ *
+ * \param[in]	pcdeEstimate	estimate (see clockdrift_Get())
+ * \param[out]	strBuffer		buffer where the text is to be stored
+ * \param[in]	sztBufferLen	size of strBuffer, in characters (the text is truncated if it does not fit)
+ * \return Nothing.
+ */
+void clockdrift_Format(const ClockDriftEstimate * pcdeEstimate, TCHAR * strBuffer, size_t sztBufferLen)
+{
+	if(sztBufferLen == 0)
+		return;
+	strBuffer[0] = TEXT('\0');
+
+	if(pcdeEstimate->NPackets == 0)
+		return;
+
+	if(pcdeEstimate->NBlocks < 2)
+		_sntprintf_s(strBuffer, sztBufferLen, _TRUNCATE,
+					 TEXT("Clock drift\t\t: (measuring)\r\nLatency\t\t\t: %.1f ms (mean %.1f ms, max %.1f ms)\r\n"),
+					 pcdeEstimate->Latency, pcdeEstimate->MeanLatency, pcdeEstimate->MaxLatency);
+	else
+		_sntprintf_s(strBuffer, sztBufferLen, _TRUNCATE,
+					 TEXT("Clock drift\t\t: %+.2f ppm (%.4f Hz)\r\nTime base error\t\t: %+.1f ms\r\nLatency\t\t\t: %.1f ms (mean %.1f ms, max %.1f ms)\r\n"),
+					 pcdeEstimate->DriftPPM, pcdeEstimate->SamplingFrequency, pcdeEstimate->ClockOffset,
+					 pcdeEstimate->Latency, pcdeEstimate->MeanLatency, pcdeEstimate->MaxLatency);
+}
+
+/**
+ * \brief Takes a consistent snapshot of the estimate.
+ *
+ * Can be called from any thread; never blocks the sample thread.
+ *
+ * \param[out]	pcdeEstimate	buffer where the estimate is to be stored
+ * \return Nothing.
+ */
+void clockdrift_Get(ClockDriftEstimate * pcdeEstimate)
+{
+	LONG lngSequence;
+
+	for(;;)
+	{
+		lngSequence = m_lngSequence;
+		if(lngSequence & 1)
+		{
+			// update in progress
+			Sleep(0);
+			continue;
+		}
+
+		MemoryBarrier();
+		*pcdeEstimate = m_cdeEstimate;
+		MemoryBarrier();
+
+		if(lngSequence == m_lngSequence)
+			break;
+	}
+}
+
+/**
+ * \brief Estimates which sample of the recording the measurement device is acquiring now.
+ *
+ * The current PC time is converted to device time with the minimum-latency line and counted from the last received
+ * packet, so the result follows the device clock instead of the nominal sampling frequency. It is late by the minimum
+ * latency of the link, which cannot be measured on a one-way link.
+ *
+ * Can be called from any thread.
+ *
+ * \return Index of the sample, or -1 if no packets have been received since the last reset.
+ */
+LONGLONG clockdrift_GetRecordSample(void)
+{
+	ClockDriftEstimate cdeEstimate;
+	LARGE_INTEGER liCounter;
+	double dblHostTime, dblDeviceTime;
+	LONGLONG llngSample;
+
+	QueryPerformanceCounter(&liCounter);
+	clockdrift_Get(&cdeEstimate);
+	if(cdeEstimate.NPackets == 0)
+		return -1;
+
+	dblHostTime = (double) (liCounter.QuadPart - cdeEstimate.FirstCounter) / cdeEstimate.Frequency;
+	dblDeviceTime = (dblHostTime - cdeEstimate.Intercept) / (1 + cdeEstimate.Slope);
+	llngSample = cdeEstimate.LastRecordSample + (LONGLONG) ((dblDeviceTime - cdeEstimate.LastDeviceTime) * m_intSamplingFrequency + 0.5);
+
+	return (llngSample > 0) ? llngSample : 0;
+}
+
+/**
+ * \brief Clears the estimate at the start of a recording or after the time stamps of the device were restarted.
+ *
+ * Must only be called by the sample thread.
+ *
+ * \param[in]	intSamplingFrequency	nominal sampling frequency of the device (Hz)
+ * \return Nothing.
+ */
+void clockdrift_Reset(int intSamplingFrequency)
+{
+	LARGE_INTEGER liFrequency;
+
+	QueryPerformanceFrequency(&liFrequency);
+
+	clockdrift_BeginUpdate();
+	SecureZeroMemory(&m_cdeEstimate, sizeof(m_cdeEstimate));
+	m_cdeEstimate.Frequency = liFrequency.QuadPart;
+	m_intSamplingFrequency = (intSamplingFrequency > 0) ? intSamplingFrequency : 1;
+	clockdrift_EndUpdate();
+
+	m_lngCurrentBlock = -1;
+	m_dblLatencySum = 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		clockdrift.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that estimates the drift between the clocks of the measurement device and the PC.
+ *
+ * $Id$
+ */
+
+# ifndef __CLOCKDRIFT_H__
+# define __CLOCKDRIFT_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define CLOCKDRIFT_BLOCKLENGTH			10						///< length of the blocks whose minimum-latency packets are fitted (seconds of device time)
+# define CLOCKDRIFT_NBLOCKS				360						///< number of blocks in the regression window (older blocks are dropped)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Estimate of the drift between the device clock (packet time stamps at the nominal sampling frequency) and the PC's
+ * high-resolution clock, and of the acquisition latency of the packets. The structure can be copied as a whole.
+ */
+typedef struct
+{
+	long		NPackets;											///< number of DATA packets in the estimate
+	long		NBlocks;											///< number of blocks in the regression (the drift is only estimated from 2 blocks on)
+	double		DriftPPM;											///< rate error of the device clock, in ppm (positive: a device second lasts longer than a PC second)
+	double		SamplingFrequency;									///< actual sampling frequency of the device, measured with the PC's clock (Hz)
+	double		ClockOffset;										///< PC time minus device time elapsed since the first packet (ms), i.e. the error of nominal-rate EDF+ timing
+	double		Latency;											///< latency of the last packet in excess of the minimum-latency line (ms)
+	double		MeanLatency;										///< mean excess latency (ms)
+	double		MaxLatency;											///< largest excess latency (ms)
+
+	// minimum-latency line: PC time - device time = Intercept + Slope*(device time), in seconds since the first packet
+	double		Intercept;
+	double		Slope;
+	double		LastDeviceTime;										///< device time of the last packet (seconds since the first packet)
+	LONGLONG	LastRecordSample;									///< index of the last packet's first sample in the recording
+	LONGLONG	FirstCounter;										///< performance counter value at the first packet
+	LONGLONG	Frequency;											///< frequency of the performance counter
+}
+ClockDriftEstimate;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+void		clockdrift_AddPacket(DWORD dwrdTimeStamp, LONGLONG llngRecordSample);
+void		clockdrift_Format(const ClockDriftEstimate * pcdeEstimate, TCHAR * strBuffer, size_t sztBufferLen);
+void		clockdrift_Get(ClockDriftEstimate * pcdeEstimate);
+LONGLONG	clockdrift_GetRecordSample(void);
+void		clockdrift_Reset(int intSamplingFrequency);
+
+# endif
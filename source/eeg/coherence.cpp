@@ -0,0 +1,629 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		coherence.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that maintains the running zero-lag correlation and band-limited magnitude-squared coherence
+ *				between all pairs of EEG channels.
+ *
+ * The incoming samples are split into 50% overlapping, Hann-windowed frames whose length is the smallest power of two
+ * that covers one second of signal. Each frame is transformed once per channel (two channels per complex FFT) and the
+ * resulting spectra are used to update exponentially-averaged auto- and cross-spectral accumulators, which are kept
+ * already summed over the bins of each frequency band. The work done per frame is therefore O(C*N*log(N)) for the
+ * FFTs plus O(C^2*N/2) for the accumulators, and nothing is recomputed when an epoch is published.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+
+// program headers
+#include "globals.h"
+#include "coherence.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+#define COH_PI						3.14159265358979323846
+#define COH_NACCUMULATORS			(COH_NBANDS + 1)			///< band accumulators + broadband accumulator (used for the correlation)
+#define COH_BROADBAND				COH_NBANDS					///< index of the broadband accumulator
+
+//---------------------------------------------------------------------------
+//   								Constants
+//---------------------------------------------------------------------------
+static const double			mc_dblBandEdges[COH_NBANDS][2] = {{0.5, 4.0}, {4.0, 8.0}, {8.0, 13.0}, {13.0, 30.0}};	///< lower (inclusive) and upper (exclusive) edge of each band, in Hz
+static const TCHAR *		mc_strBandNames[COH_NBANDS] = {TEXT("Delta"), TEXT("Theta"), TEXT("Alpha"), TEXT("Beta")};		///< name of each band
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static BOOL					m_blnIsInit = FALSE;					///< TRUE if module has been initialized
+static unsigned int			m_uintNChannels;						///< number of channels being analysed
+static unsigned int			m_uintNPairs;							///< number of unique channel pairs
+static unsigned int			m_uintFFTLength;						///< length of the analysis frames, in samples (power of two)
+static unsigned int			m_uintHopLength;						///< number of new samples between two consecutive frames
+static unsigned int			m_uintBandBins[COH_NACCUMULATORS][2];	///< first (inclusive) and last (exclusive) FFT bin of each accumulator
+
+// FFT tables & work buffers
+static double *				m_pdblWindow;							///< Hann window
+static double *				m_pdblCos;								///< cosine twiddle factors
+static double *				m_pdblSin;								///< sine twiddle factors
+static unsigned int *		m_puintBitReverse;						///< bit-reversal permutation table
+static double *				m_pdblFFTRe;							///< real part of the FFT work buffer
+static double *				m_pdblFFTIm;							///< imaginary part of the FFT work buffer
+static double *				m_pdblSpectrumRe;						///< real part of the spectrum of each channel (m_uintNChannels x (m_uintFFTLength/2 + 1))
+static double *				m_pdblSpectrumIm;						///< imaginary part of the spectrum of each channel (m_uintNChannels x (m_uintFFTLength/2 + 1))
+
+// sample ring
+static double *				m_pdblRing;								///< last m_uintFFTLength samples of each channel (m_uintNChannels x m_uintFFTLength)
+static unsigned int			m_uintRingID;							///< index of the oldest sample in the ring (i.e., where the next sample is written)
+static unsigned int			m_uintNSamplesBuffered;					///< number of valid samples in the ring
+static unsigned int			m_uintNSamplesSinceFrame;				///< number of samples added since the last frame was processed
+
+// spectral accumulators
+static double *				m_pdblAutoSpectra;						///< averaged band power of each channel (m_uintNChannels x COH_NACCUMULATORS)
+static double *				m_pdblCrossSpectraRe;					///< averaged real part of the band cross-spectrum of each pair (m_uintNPairs x COH_NACCUMULATORS)
+static double *				m_pdblCrossSpectraIm;					///< averaged imaginary part of the band cross-spectrum of each pair (m_uintNPairs x COH_NACCUMULATORS)
+static unsigned int			m_uintNFrames;							///< number of frames that have been averaged
+static unsigned int			m_uintNFramesInEpoch;					///< number of frames processed since the last epoch was published
+
+// published results
+static CoherenceMatrix		m_cmPublished;							///< snapshot of the last completed epoch
+static CRITICAL_SECTION		m_csPublishedGuard;						///< prevents readers from accessing m_cmPublished while it is being updated
+
+//---------------------------------------------------------------------------
+//   						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief In-place iterative radix-2 FFT of the m_pdblFFTRe/m_pdblFFTIm work buffers.
+ */
+static void coh_FFT(void)
+{
+	double			dblTempRe, dblTempIm, dblTwiddleRe, dblTwiddleIm;
+	unsigned int	i, j, k, uintSpan, uintTwiddleStep;
+
+	// bit-reversal permutation
+	for(i = 0; i < m_uintFFTLength; i++)
+	{
+		j = m_puintBitReverse[i];
+		if(j > i)
+		{
+			dblTempRe = m_pdblFFTRe[i]; m_pdblFFTRe[i] = m_pdblFFTRe[j]; m_pdblFFTRe[j] = dblTempRe;
+			dblTempIm = m_pdblFFTIm[i]; m_pdblFFTIm[i] = m_pdblFFTIm[j]; m_pdblFFTIm[j] = dblTempIm;
+		}
+	}
+
+	// butterflies
+	for(uintSpan = 1; uintSpan < m_uintFFTLength; uintSpan <<= 1)
+	{
+		uintTwiddleStep = m_uintFFTLength/(2*uintSpan);
+		for(i = 0; i < m_uintFFTLength; i += 2*uintSpan)
+		{
+			for(k = 0; k < uintSpan; k++)
+			{
+				dblTwiddleRe = m_pdblCos[k*uintTwiddleStep];
+				dblTwiddleIm = -m_pdblSin[k*uintTwiddleStep];
+				j = i + k + uintSpan;
+
+				dblTempRe = dblTwiddleRe*m_pdblFFTRe[j] - dblTwiddleIm*m_pdblFFTIm[j];
+				dblTempIm = dblTwiddleRe*m_pdblFFTIm[j] + dblTwiddleIm*m_pdblFFTRe[j];
+
+				m_pdblFFTRe[j] = m_pdblFFTRe[i + k] - dblTempRe;
+				m_pdblFFTIm[j] = m_pdblFFTIm[i + k] - dblTempIm;
+				m_pdblFFTRe[i + k] += dblTempRe;
+				m_pdblFFTIm[i + k] += dblTempIm;
+			}
+		}
+	}
+}
+
+/**
+ * \brief Copies the windowed contents of a channel's ring into the FFT work buffer, oldest sample first.
+ *
+ * \param[out]	pdblDestination		m_pdblFFTRe or m_pdblFFTIm
+ * \param[in]	uintChannel			zero-based index of the channel
+ */
+static void coh_LoadFrame(double * pdblDestination, unsigned int uintChannel)
+{
+	double *		pdblRing;
+	unsigned int	i, n;
+
+	pdblRing = m_pdblRing + uintChannel*m_uintFFTLength;
+
+	// NOTE: two loops are used so that the modulo operation is not needed for every sample
+	n = 0;
+	for(i = m_uintRingID; i < m_uintFFTLength; i++, n++)
+		pdblDestination[n] = pdblRing[i]*m_pdblWindow[n];
+	for(i = 0; i < m_uintRingID; i++, n++)
+		pdblDestination[n] = pdblRing[i]*m_pdblWindow[n];
+}
+
+/**
+ * \brief Transforms the current frame of every channel and folds the resulting spectra into the band accumulators.
+ */
+static void coh_ProcessFrame(void)
+{
+	double			dblAlpha, dblSumRe, dblSumIm, dblSum;
+	double			* pdblARe, * pdblAIm, * pdblBRe, * pdblBIm;
+	unsigned int	uintNBins, i, j, k, b, p, nk;
+
+	uintNBins = m_uintFFTLength/2 + 1;
+
+	//
+	// compute spectra (two real channels are packed into each complex FFT)
+	//
+	for(i = 0; i < m_uintNChannels; i += 2)
+	{
+		coh_LoadFrame(m_pdblFFTRe, i);
+		if(i + 1 < m_uintNChannels)
+			coh_LoadFrame(m_pdblFFTIm, i + 1);
+		else
+			memset(m_pdblFFTIm, 0, m_uintFFTLength*sizeof(double));
+
+		coh_FFT();
+
+		// separate spectra: X_a[k] = (Z[k] + Z*[N-k])/2, X_b[k] = (Z[k] - Z*[N-k])/2i
+		pdblARe = m_pdblSpectrumRe + i*uintNBins;
+		pdblAIm = m_pdblSpectrumIm + i*uintNBins;
+		for(k = 0; k < uintNBins; k++)
+		{
+			nk = (m_uintFFTLength - k) & (m_uintFFTLength - 1);
+			pdblARe[k] = 0.5*(m_pdblFFTRe[k] + m_pdblFFTRe[nk]);
+			pdblAIm[k] = 0.5*(m_pdblFFTIm[k] - m_pdblFFTIm[nk]);
+		}
+
+		if(i + 1 < m_uintNChannels)
+		{
+			pdblBRe = m_pdblSpectrumRe + (i + 1)*uintNBins;
+			pdblBIm = m_pdblSpectrumIm + (i + 1)*uintNBins;
+			for(k = 0; k < uintNBins; k++)
+			{
+				nk = (m_uintFFTLength - k) & (m_uintFFTLength - 1);
+				pdblBRe[k] = 0.5*(m_pdblFFTIm[k] + m_pdblFFTIm[nk]);
+				pdblBIm[k] = -0.5*(m_pdblFFTRe[k] - m_pdblFFTRe[nk]);
+			}
+		}
+	}
+
+	// the first frame initializes the averages
+	dblAlpha = (m_uintNFrames == 0) ? 1.0 : COH_AVERAGING_FACTOR;
+
+	//
+	// update auto-spectra
+	//
+	for(i = 0; i < m_uintNChannels; i++)
+	{
+		pdblARe = m_pdblSpectrumRe + i*uintNBins;
+		pdblAIm = m_pdblSpectrumIm + i*uintNBins;
+
+		for(b = 0; b < COH_NACCUMULATORS; b++)
+		{
+			dblSum = 0.0;
+			for(k = m_uintBandBins[b][0]; k < m_uintBandBins[b][1]; k++)
+				dblSum += pdblARe[k]*pdblARe[k] + pdblAIm[k]*pdblAIm[k];
+
+			m_pdblAutoSpectra[i*COH_NACCUMULATORS + b] += dblAlpha*(dblSum - m_pdblAutoSpectra[i*COH_NACCUMULATORS + b]);
+		}
+	}
+
+	//
+	// update cross-spectra
+	//
+	p = 0;
+	for(i = 0; i < m_uintNChannels; i++)
+	{
+		pdblARe = m_pdblSpectrumRe + i*uintNBins;
+		pdblAIm = m_pdblSpectrumIm + i*uintNBins;
+
+		for(j = i + 1; j < m_uintNChannels; j++, p++)
+		{
+			pdblBRe = m_pdblSpectrumRe + j*uintNBins;
+			pdblBIm = m_pdblSpectrumIm + j*uintNBins;
+
+			for(b = 0; b < COH_NACCUMULATORS; b++)
+			{
+				// X_i[k]*conj(X_j[k]) summed over the band
+				dblSumRe = dblSumIm = 0.0;
+				for(k = m_uintBandBins[b][0]; k < m_uintBandBins[b][1]; k++)
+				{
+					dblSumRe += pdblARe[k]*pdblBRe[k] + pdblAIm[k]*pdblBIm[k];
+					dblSumIm += pdblAIm[k]*pdblBRe[k] - pdblARe[k]*pdblBIm[k];
+				}
+
+				m_pdblCrossSpectraRe[p*COH_NACCUMULATORS + b] += dblAlpha*(dblSumRe - m_pdblCrossSpectraRe[p*COH_NACCUMULATORS + b]);
+				m_pdblCrossSpectraIm[p*COH_NACCUMULATORS + b] += dblAlpha*(dblSumIm - m_pdblCrossSpectraIm[p*COH_NACCUMULATORS + b]);
+			}
+		}
+	}
+
+	m_uintNFrames++;
+	m_uintNFramesInEpoch++;
+}
+
+/**
+ * \brief Converts the current state of the accumulators into a CoherenceMatrix and publishes it.
+ */
+static void coh_PublishEpoch(void)
+{
+	double			dblDenominator, dblRe, dblIm;
+	unsigned int	i, j, b, p;
+
+	EnterCriticalSection(&m_csPublishedGuard);
+
+	p = 0;
+	for(i = 0; i < m_uintNChannels; i++)
+	{
+		for(j = i + 1; j < m_uintNChannels; j++, p++)
+		{
+			// band-limited magnitude-squared coherence: |Sij|^2/(Sii*Sjj)
+			for(b = 0; b < COH_NBANDS; b++)
+			{
+				dblDenominator = m_pdblAutoSpectra[i*COH_NACCUMULATORS + b]*m_pdblAutoSpectra[j*COH_NACCUMULATORS + b];
+				dblRe = m_pdblCrossSpectraRe[p*COH_NACCUMULATORS + b];
+				dblIm = m_pdblCrossSpectraIm[p*COH_NACCUMULATORS + b];
+
+				m_cmPublished.Coherence[b][p] = (dblDenominator > 0.0) ? (float) ((dblRe*dblRe + dblIm*dblIm)/dblDenominator) : 0.0f;
+			}
+
+			// zero-lag correlation of the windowed, DC-free signals (Parseval): Re(Sij)/sqrt(Sii*Sjj)
+			dblDenominator = m_pdblAutoSpectra[i*COH_NACCUMULATORS + COH_BROADBAND]*m_pdblAutoSpectra[j*COH_NACCUMULATORS + COH_BROADBAND];
+			m_cmPublished.Correlation[p] = (dblDenominator > 0.0) ? (float) (m_pdblCrossSpectraRe[p*COH_NACCUMULATORS + COH_BROADBAND]/sqrt(dblDenominator)) : 0.0f;
+		}
+	}
+
+	m_cmPublished.EpochID++;
+
+	LeaveCriticalSection(&m_csPublishedGuard);
+
+	m_uintNFramesInEpoch = 0;
+}
+
+//---------------------------------------------------------------------------
+//   						Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Allocates the FFT tables and accumulators of the module.
+ *
+ * If the module is already initialized (e.g. a new recording is started with a different montage), the resources
+ * of the previous initialization are released first.
+ *
+ * \param[in]	uintNChannels			number of channels that will be passed to coh_AddSamples() (at most COH_MAX_CHANNELS)
+ * \param[in]	uintSamplingFrequency	sampling frequency of the channels, in Hz
+ *
+ * \return TRUE if succesfull, FALSE otherwise.
+ */
+BOOL coh_init(unsigned int uintNChannels, unsigned int uintSamplingFrequency)
+{
+	BOOL			blnErrorOccured = FALSE;
+	unsigned int	uintNBins, uintLog2, i, j, b;
+
+	coh_cleanup();
+
+	if(uintNChannels < 2 || uintNChannels > COH_MAX_CHANNELS || uintSamplingFrequency == 0)
+		return FALSE;
+
+	// frame length: smallest power of two that covers one second of signal
+	m_uintFFTLength = COH_MIN_FFT_LENGTH;
+	while(m_uintFFTLength < uintSamplingFrequency && m_uintFFTLength < COH_MAX_FFT_LENGTH)
+		m_uintFFTLength <<= 1;
+	for(uintLog2 = 0; (1U << uintLog2) < m_uintFFTLength; uintLog2++);
+
+	m_uintNChannels = uintNChannels;
+	m_uintNPairs = (uintNChannels*(uintNChannels - 1))/2;
+	m_uintHopLength = m_uintFFTLength/2;
+	uintNBins = m_uintFFTLength/2 + 1;
+
+	// bins covered by each band (broadband accumulator spans everything except DC)
+	for(b = 0; b < COH_NBANDS; b++)
+	{
+		m_uintBandBins[b][0] = (unsigned int) ceil(mc_dblBandEdges[b][0]*m_uintFFTLength/uintSamplingFrequency);
+		m_uintBandBins[b][1] = (unsigned int) ceil(mc_dblBandEdges[b][1]*m_uintFFTLength/uintSamplingFrequency);
+		if(m_uintBandBins[b][0] < 1)
+			m_uintBandBins[b][0] = 1;
+		if(m_uintBandBins[b][1] > uintNBins)
+			m_uintBandBins[b][1] = uintNBins;
+	}
+	m_uintBandBins[COH_BROADBAND][0] = 1;
+	m_uintBandBins[COH_BROADBAND][1] = uintNBins;
+
+	// allocate memory
+	m_pdblWindow = (double *) malloc(m_uintFFTLength*sizeof(double));
+	m_pdblCos = (double *) malloc((m_uintFFTLength/2)*sizeof(double));
+	m_pdblSin = (double *) malloc((m_uintFFTLength/2)*sizeof(double));
+	m_puintBitReverse = (unsigned int *) malloc(m_uintFFTLength*sizeof(unsigned int));
+	m_pdblFFTRe = (double *) malloc(m_uintFFTLength*sizeof(double));
+	m_pdblFFTIm = (double *) malloc(m_uintFFTLength*sizeof(double));
+	m_pdblSpectrumRe = (double *) malloc(m_uintNChannels*uintNBins*sizeof(double));
+	m_pdblSpectrumIm = (double *) malloc(m_uintNChannels*uintNBins*sizeof(double));
+	m_pdblRing = (double *) malloc(m_uintNChannels*m_uintFFTLength*sizeof(double));
+	m_pdblAutoSpectra = (double *) malloc(m_uintNChannels*COH_NACCUMULATORS*sizeof(double));
+	m_pdblCrossSpectraRe = (double *) malloc(m_uintNPairs*COH_NACCUMULATORS*sizeof(double));
+	m_pdblCrossSpectraIm = (double *) malloc(m_uintNPairs*COH_NACCUMULATORS*sizeof(double));
+	if(m_pdblWindow == NULL || m_pdblCos == NULL || m_pdblSin == NULL || m_puintBitReverse == NULL ||
+	   m_pdblFFTRe == NULL || m_pdblFFTIm == NULL || m_pdblSpectrumRe == NULL || m_pdblSpectrumIm == NULL ||
+	   m_pdblRing == NULL || m_pdblAutoSpectra == NULL || m_pdblCrossSpectraRe == NULL || m_pdblCrossSpectraIm == NULL)
+	{
+		blnErrorOccured = TRUE;
+	}
+
+	if(!blnErrorOccured)
+	{
+		// Hann window
+		for(i = 0; i < m_uintFFTLength; i++)
+			m_pdblWindow[i] = 0.5*(1.0 - cos(2.0*COH_PI*i/m_uintFFTLength));
+
+		// twiddle factors
+		for(i = 0; i < m_uintFFTLength/2; i++)
+		{
+			m_pdblCos[i] = cos(2.0*COH_PI*i/m_uintFFTLength);
+			m_pdblSin[i] = sin(2.0*COH_PI*i/m_uintFFTLength);
+		}
+
+		// bit-reversal table
+		for(i = 0; i < m_uintFFTLength; i++)
+		{
+			m_puintBitReverse[i] = 0;
+			for(j = 0; j < uintLog2; j++)
+			{
+				if(i & (1U << j))
+					m_puintBitReverse[i] |= 1U << (uintLog2 - 1 - j);
+			}
+		}
+
+		InitializeCriticalSection(&m_csPublishedGuard);
+		m_blnIsInit = TRUE;
+
+		coh_reset();
+	}
+	else
+	{
+		coh_cleanup();
+	}
+
+	return !blnErrorOccured;
+}
+
+/**
+ * \brief Releases all of the resources allocated by coh_init().
+ */
+void coh_cleanup(void)
+{
+	if(m_blnIsInit)
+	{
+		DeleteCriticalSection(&m_csPublishedGuard);
+		m_blnIsInit = FALSE;
+	}
+
+	free(m_pdblWindow);				m_pdblWindow = NULL;
+	free(m_pdblCos);				m_pdblCos = NULL;
+	free(m_pdblSin);				m_pdblSin = NULL;
+	free(m_puintBitReverse);		m_puintBitReverse = NULL;
+	free(m_pdblFFTRe);				m_pdblFFTRe = NULL;
+	free(m_pdblFFTIm);				m_pdblFFTIm = NULL;
+	free(m_pdblSpectrumRe);			m_pdblSpectrumRe = NULL;
+	free(m_pdblSpectrumIm);			m_pdblSpectrumIm = NULL;
+	free(m_pdblRing);				m_pdblRing = NULL;
+	free(m_pdblAutoSpectra);		m_pdblAutoSpectra = NULL;
+	free(m_pdblCrossSpectraRe);		m_pdblCrossSpectraRe = NULL;
+	free(m_pdblCrossSpectraIm);		m_pdblCrossSpectraIm = NULL;
+}
+
+/**
+ * \brief Discards the buffered samples and the spectral averages, e.g. after a gap in the signal.
+ */
+void coh_reset(void)
+{
+	unsigned int b, p;
+
+	if(!m_blnIsInit)
+		return;
+
+	memset(m_pdblRing, 0, m_uintNChannels*m_uintFFTLength*sizeof(double));
+	memset(m_pdblAutoSpectra, 0, m_uintNChannels*COH_NACCUMULATORS*sizeof(double));
+	memset(m_pdblCrossSpectraRe, 0, m_uintNPairs*COH_NACCUMULATORS*sizeof(double));
+	memset(m_pdblCrossSpectraIm, 0, m_uintNPairs*COH_NACCUMULATORS*sizeof(double));
+	m_uintRingID = 0;
+	m_uintNSamplesBuffered = 0;
+	m_uintNSamplesSinceFrame = 0;
+	m_uintNFrames = 0;
+	m_uintNFramesInEpoch = 0;
+
+	EnterCriticalSection(&m_csPublishedGuard);
+	m_cmPublished.EpochID = 0;
+	m_cmPublished.NChannels = m_uintNChannels;
+	m_cmPublished.NPairs = m_uintNPairs;
+	for(p = 0; p < m_uintNPairs; p++)
+	{
+		m_cmPublished.Correlation[p] = 0.0f;
+		for(b = 0; b < COH_NBANDS; b++)
+			m_cmPublished.Coherence[b][p] = 0.0f;
+	}
+	LeaveCriticalSection(&m_csPublishedGuard);
+}
+
+/**
+ * \brief Adds a block of samples to the analysis and publishes a new epoch once the block has been processed.
+ *
+ * The function is meant to be called once per data record, so that each published epoch corresponds to one data record.
+ * Function executes in the execution context of the calling thread (i.e., the sample thread).
+ *
+ * \param[in]	pshrChannelData		array of m_uintNChannels pointers to the new samples of each channel
+ * \param[in]	uintNNewSamples		number of new samples per channel
+ *
+ * \return TRUE if a new epoch was published, FALSE otherwise.
+ */
+BOOL coh_AddSamples(short ** pshrChannelData, unsigned int uintNNewSamples)
+{
+	unsigned int i, n;
+
+	if(!m_blnIsInit)
+		return FALSE;
+
+	for(i = 0; i < uintNNewSamples; i++)
+	{
+		for(n = 0; n < m_uintNChannels; n++)
+			m_pdblRing[n*m_uintFFTLength + m_uintRingID] = (double) pshrChannelData[n][i];
+
+		if(++m_uintRingID == m_uintFFTLength)
+			m_uintRingID = 0;
+
+		if(m_uintNSamplesBuffered < m_uintFFTLength)
+			m_uintNSamplesBuffered++;
+
+		// process frame once the ring is full and a hop's worth of new samples is available
+		if(++m_uintNSamplesSinceFrame >= m_uintHopLength && m_uintNSamplesBuffered == m_uintFFTLength)
+		{
+			coh_ProcessFrame();
+			m_uintNSamplesSinceFrame = 0;
+		}
+	}
+
+	if(m_uintNFramesInEpoch == 0)
+		return FALSE;
+
+	coh_PublishEpoch();
+	return TRUE;
+}
+
+/**
+ * \brief Formats a summary of the matrices as text for display in a multi-line edit control.
+ *
+ * Only the mean over all channel pairs and the most coherent pair of each band are listed, since the full matrices
+ * do not fit on the screen for large montages.
+ *
+ * \param[in]	pcmMatrix		snapshot (see coh_GetMatrix())
+ * \param[out]	strBuffer		buffer where the text is to be stored
+ * \param[in]	sztBufferLen	size of strBuffer, in characters (the text is truncated if it does not fit)
+ * \return Nothing.
+ */
+void coh_Format(const CoherenceMatrix * pcmMatrix, TCHAR * strBuffer, size_t sztBufferLen)
+{
+	double			dblMean;
+	float			fltMax;
+	size_t			sztLength;
+	unsigned int	b, i, j, p, uintMaxI, uintMaxJ;
+
+	if(sztBufferLen == 0)
+		return;
+	strBuffer[0] = TEXT('\0');
+
+	if(pcmMatrix->EpochID == 0 || pcmMatrix->NPairs == 0)
+		return;
+
+	for(dblMean = 0, p = 0; p < pcmMatrix->NPairs; p++)
+		dblMean += pcmMatrix->Correlation[p];
+	_sntprintf_s(strBuffer, sztBufferLen, _TRUNCATE,
+				 TEXT("Coherence epoch\t\t: %u (%u channels)\r\nMean correlation\t: %.2f\r\n"),
+				 pcmMatrix->EpochID, pcmMatrix->NChannels, dblMean/pcmMatrix->NPairs);
+
+	for(b = 0; b < COH_NBANDS; b++)
+	{
+		dblMean = 0;
+		fltMax = -1.0f;
+		uintMaxI = uintMaxJ = 0;
+		for(p = 0, i = 0; i < pcmMatrix->NChannels; i++)
+		{
+			for(j = i + 1; j < pcmMatrix->NChannels; j++, p++)
+			{
+				dblMean += pcmMatrix->Coherence[b][p];
+				if(pcmMatrix->Coherence[b][p] > fltMax)
+				{
+					fltMax = pcmMatrix->Coherence[b][p];
+					uintMaxI = i;
+					uintMaxJ = j;
+				}
+			}
+		}
+
+		sztLength = _tcslen(strBuffer);
+		_sntprintf_s(strBuffer + sztLength, sztBufferLen - sztLength, _TRUNCATE,
+					 TEXT("%s coherence\t: mean %.2f, max %.2f (signals %u-%u)\r\n"),
+					 mc_strBandNames[b], dblMean/pcmMatrix->NPairs, fltMax, uintMaxI + 1, uintMaxJ + 1);
+	}
+}
+
+/**
+ * \brief Returns a copy of the matrices of the last completed epoch. Can be called from any thread.
+ *
+ * \param[out]	pcmMatrix		buffer where the snapshot is to be stored
+ *
+ * \return TRUE if at least one epoch has been completed, FALSE otherwise.
+ */
+BOOL coh_GetMatrix(CoherenceMatrix * pcmMatrix)
+{
+	BOOL blnResult = FALSE;
+
+	if(!m_blnIsInit || pcmMatrix == NULL)
+		return FALSE;
+
+	EnterCriticalSection(&m_csPublishedGuard);
+	if(m_cmPublished.EpochID > 0)
+	{
+		memcpy(pcmMatrix, &m_cmPublished, sizeof(CoherenceMatrix));
+		blnResult = TRUE;
+	}
+	LeaveCriticalSection(&m_csPublishedGuard);
+
+	return blnResult;
+}
+
+/**
+ * \brief Stores the matrices in a compact, byte-oriented form (e.g. as the payload of a streamed packet).
+ *
+ * The layout is EpochID, NChannels and NPairs as 32-bit unsigned integers followed by the NPairs correlation
+ * coefficients and the NPairs coherences of each band as 32-bit floats, all in the byte order of the host.
+ *
+ * \param[in]	pcmMatrix		snapshot (see coh_GetMatrix())
+ * \param[out]	pBuffer			buffer where the matrices are to be stored
+ * \param[in]	uintBufferLen	size of pBuffer, in bytes (has to be at least COH_SERIALIZED_LENGTH(pcmMatrix->NPairs))
+ *
+ * \return Number of bytes stored in pBuffer, or 0 if the buffer is too small.
+ */
+unsigned int coh_Serialize(const CoherenceMatrix * pcmMatrix, void * pBuffer, unsigned int uintBufferLen)
+{
+	BYTE *			pbytBuffer = (BYTE *) pBuffer;
+	unsigned int	b, uintLength;
+
+	uintLength = COH_SERIALIZED_LENGTH(pcmMatrix->NPairs);
+	if(uintBufferLen < uintLength)
+		return 0;
+
+	memcpy(pbytBuffer, &pcmMatrix->EpochID, sizeof(unsigned int));								pbytBuffer += sizeof(unsigned int);
+	memcpy(pbytBuffer, &pcmMatrix->NChannels, sizeof(unsigned int));							pbytBuffer += sizeof(unsigned int);
+	memcpy(pbytBuffer, &pcmMatrix->NPairs, sizeof(unsigned int));								pbytBuffer += sizeof(unsigned int);
+	memcpy(pbytBuffer, pcmMatrix->Correlation, pcmMatrix->NPairs*sizeof(float));				pbytBuffer += pcmMatrix->NPairs*sizeof(float);
+	for(b = 0; b < COH_NBANDS; b++)
+	{
+		memcpy(pbytBuffer, pcmMatrix->Coherence[b], pcmMatrix->NPairs*sizeof(float));
+		pbytBuffer += pcmMatrix->NPairs*sizeof(float);
+	}
+
+	return uintLength;
+}
@@ -0,0 +1,68 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		coherence.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that computes the running inter-channel correlation and coherence of the EEG signals.
+ *
+ * $Id$
+ */
+
+# ifndef __COHERENCE_H__
+# define __COHERENCE_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define COH_MAX_CHANNELS			32												///< maximum number of channels supported by the module
+# define COH_MAX_NPAIRS				((COH_MAX_CHANNELS*(COH_MAX_CHANNELS - 1))/2)	///< maximum number of unique channel pairs
+# define COH_MIN_FFT_LENGTH			64												///< shortest FFT frame, in samples
+# define COH_MAX_FFT_LENGTH			1024											///< longest FFT frame, in samples (has to be >= MAX_SAMPLERATE rounded up to a power of two)
+# define COH_AVERAGING_FACTOR		0.125											///< weight of the newest frame in the exponential average of the spectra (~8 frames)
+# define COH_NBANDS					4												///< number of frequency bands for which the coherence is computed
+
+# define COH_SERIALIZED_LENGTH(n)	(3*sizeof(unsigned int) + (COH_NBANDS + 1)*(n)*sizeof(float))		///< size, in bytes, of the output of coh_Serialize() for a matrix with n channel pairs
+
+# define COH_PAIR_INDEX(i, j, n)	((i)*(2*(n) - (i) - 1)/2 + ((j) - (i) - 1))		///< index of the (i, j), i < j, channel pair in the packed upper triangle of a n-channel matrix
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Frequency bands for which the magnitude-squared coherence is computed.
+ */
+typedef enum {CoherenceBand_Delta = 0,		///< 0.5 - 4 Hz
+			  CoherenceBand_Theta = 1,		///< 4 - 8 Hz
+			  CoherenceBand_Alpha = 2,		///< 8 - 13 Hz
+			  CoherenceBand_Beta = 3		///< 13 - 30 Hz
+} CoherenceBand;
+
+/**
+ * Per-epoch snapshot of the correlation and coherence between all channel pairs. Both matrices are symmetric
+ * and are therefore stored as packed upper triangles (see COH_PAIR_INDEX).
+ */
+typedef struct {unsigned int	EpochID;								///< one-based index of the epoch the snapshot belongs to (0 if no epoch has been completed yet)
+				unsigned int	NChannels;								///< number of channels
+				unsigned int	NPairs;									///< number of valid elements in each of the packed matrices
+				float			Correlation[COH_MAX_NPAIRS];			///< zero-lag correlation coefficient of each channel pair
+				float			Coherence[COH_NBANDS][COH_MAX_NPAIRS];	///< magnitude-squared coherence of each channel pair in each frequency band
+} CoherenceMatrix;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+BOOL			coh_init(unsigned int uintNChannels, unsigned int uintSamplingFrequency);
+void			coh_cleanup(void);
+void			coh_reset(void);
+BOOL			coh_AddSamples(short ** pshrChannelData, unsigned int uintNNewSamples);
+void			coh_Format(const CoherenceMatrix * pcmMatrix, TCHAR * strBuffer, size_t sztBufferLen);
+BOOL			coh_GetMatrix(CoherenceMatrix * pcmMatrix);
+unsigned int	coh_Serialize(const CoherenceMatrix * pcmMatrix, void * pBuffer, unsigned int uintBufferLen);
+
+# endif
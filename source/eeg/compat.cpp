@@ -0,0 +1,357 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		compat.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		POSIX implementation of the Win32 events, threads and timers used by the serial link (see compat.h).
+ *
+ * An event is a pipe plus a flag: the pipe holds one byte while the event is signaled, so that an event can be waited
+ * for with poll() together with a file descriptor (see compat_GetEventFD() and the POSIX transports). The flag and the
+ * byte are only changed under the event's mutex, which makes the auto-reset events wake exactly one waiter. A thread
+ * handle is a manual-reset event that is signaled when the thread function returns; the thread is detached and the
+ * handle is freed by whichever of CloseHandle() and the exiting thread comes last.
+ *
+ * Not part of the Win32 build.
+ *
+ * $Id$
+ */
+
+# ifndef _WIN32
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <pthread.h>
+# include <stdlib.h>
+# include <time.h>
+# include <unistd.h>
+
+# include "compat.h"
+
+//---------------------------------------------------------------------------
+//   								Structs
+//---------------------------------------------------------------------------
+// event or thread handle
+typedef struct
+{
+	int					Pipe [2];					// read & write end of the pipe that holds one byte while the object is signaled
+	pthread_mutex_t		Mutex;						// protects Signaled and the contents of the pipe
+	BOOL				Signaled;
+	BOOL				ManualReset;
+	volatile LONG		RefCount;					// handle + running thread
+	LPTHREAD_START_ROUTINE	StartAddress;			// thread function (thread handles only)
+	LPVOID				Parameter;
+}
+CompatObject;
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static __thread DWORD	m_dwrdLastError;
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Allocates an object in the non-signaled state.
+ *
+ * \return Pointer to the object, or NULL on failure (see GetLastError).
+ */
+static CompatObject * compat_CreateObject (BOOL blnManualReset, LONG lngRefCount)
+{
+	CompatObject * pcoObject;
+	int i;
+
+	pcoObject = (CompatObject *) calloc (1, sizeof (CompatObject));
+	if (pcoObject == NULL)
+	{
+		m_dwrdLastError = ERROR_NOT_ENOUGH_MEMORY;
+		return NULL;
+	}
+
+	if (pipe (pcoObject->Pipe) != 0)
+	{
+		m_dwrdLastError = (DWORD) errno;
+		free (pcoObject);
+		return NULL;
+	}
+	for (i = 0; i < 2; i++)
+	{
+		fcntl (pcoObject->Pipe [i], F_SETFL, fcntl (pcoObject->Pipe [i], F_GETFL) | O_NONBLOCK);
+		fcntl (pcoObject->Pipe [i], F_SETFD, FD_CLOEXEC);
+	}
+
+	pthread_mutex_init (&pcoObject->Mutex, NULL);
+	pcoObject->ManualReset = blnManualReset;
+	pcoObject->RefCount = lngRefCount;
+
+	return pcoObject;
+}
+
+/**
+ * \brief Releases a reference to an object, freeing it with the last reference.
+ */
+static void compat_ReleaseObject (CompatObject * pcoObject)
+{
+	if (InterlockedDecrement (&pcoObject->RefCount) == 0)
+	{
+		close (pcoObject->Pipe [0]);
+		close (pcoObject->Pipe [1]);
+		pthread_mutex_destroy (&pcoObject->Mutex);
+		free (pcoObject);
+	}
+}
+
+/**
+ * \brief Changes the state of an object.
+ *
+ * \param[in]	pcoObject		object
+ * \param[in]	blnSignaled		new state
+ * \return TRUE if the object was signaled before the call, FALSE otherwise.
+ */
+static BOOL compat_SetState (CompatObject * pcoObject, BOOL blnSignaled)
+{
+	BYTE bytToken;
+	BOOL blnWasSignaled;
+
+	pthread_mutex_lock (&pcoObject->Mutex);
+	blnWasSignaled = pcoObject->Signaled;
+	if (blnSignaled && !blnWasSignaled)
+	{
+		bytToken = 1;
+		while (write (pcoObject->Pipe [1], &bytToken, 1) != 1 && errno == EINTR);
+	}
+	else if (!blnSignaled && blnWasSignaled)
+		while (read (pcoObject->Pipe [0], &bytToken, 1) != 1 && errno == EINTR);
+	pcoObject->Signaled = blnSignaled;
+	pthread_mutex_unlock (&pcoObject->Mutex);
+
+	return blnWasSignaled;
+}
+
+/**
+ * \brief Function executed by the threads created with CreateThread(); signals the thread handle when the thread exits.
+ */
+static void * compat_ThreadMain (void * pParameter)
+{
+	CompatObject * pcoThread;
+
+	pcoThread = (CompatObject *) pParameter;
+	pcoThread->StartAddress (pcoThread->Parameter);
+
+	compat_SetState (pcoThread, TRUE);
+	compat_ReleaseObject (pcoThread);
+
+	return NULL;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+HANDLE CreateEvent (void * psaAttributes, BOOL blnManualReset, BOOL blnInitialState, const TCHAR * strName)
+{
+	CompatObject * pcoEvent;
+
+	if (strName != NULL)
+	{
+		m_dwrdLastError = ERROR_NOT_SUPPORTED;
+		return NULL;
+	}
+
+	pcoEvent = compat_CreateObject (blnManualReset, 1);
+	if (pcoEvent != NULL && blnInitialState)
+		compat_SetState (pcoEvent, TRUE);
+
+	return (HANDLE) pcoEvent;
+}
+
+BOOL SetEvent (HANDLE hEvent)
+{
+	compat_SetState ((CompatObject *) hEvent, TRUE);
+	return TRUE;
+}
+
+BOOL ResetEvent (HANDLE hEvent)
+{
+	compat_SetState ((CompatObject *) hEvent, FALSE);
+	return TRUE;
+}
+
+/**
+ * \brief Starts a detached thread.
+ *
+ * The stack size is only a hint on Windows; the default stack size is used here because the Win32 callers request stacks
+ * smaller than PTHREAD_STACK_MIN.
+ */
+HANDLE CreateThread (void * psaAttributes, size_t sztStackSize, LPTHREAD_START_ROUTINE pfnStartAddress, LPVOID lpParameter, DWORD dwrdFlags, DWORD * pdwrdThreadId)
+{
+	CompatObject * pcoThread;
+	pthread_attr_t paAttributes;
+	pthread_t ptThread;
+	int intRC;
+
+	pcoThread = compat_CreateObject (TRUE, 2);
+	if (pcoThread == NULL)
+		return NULL;
+	pcoThread->StartAddress = pfnStartAddress;
+	pcoThread->Parameter = lpParameter;
+
+	pthread_attr_init (&paAttributes);
+	pthread_attr_setdetachstate (&paAttributes, PTHREAD_CREATE_DETACHED);
+	intRC = pthread_create (&ptThread, &paAttributes, compat_ThreadMain, pcoThread);
+	pthread_attr_destroy (&paAttributes);
+	if (intRC != 0)
+	{
+		m_dwrdLastError = (DWORD) intRC;
+		pcoThread->RefCount = 1;
+		compat_ReleaseObject (pcoThread);
+		return NULL;
+	}
+
+	if (pdwrdThreadId != NULL)
+		*pdwrdThreadId = 0;
+
+	return (HANDLE) pcoThread;
+}
+
+BOOL SetThreadPriority (HANDLE hThread, int intPriority)
+{
+	return TRUE;
+}
+
+BOOL CloseHandle (HANDLE hObject)
+{
+	if (hObject == NULL || hObject == INVALID_HANDLE_VALUE)
+	{
+		m_dwrdLastError = ERROR_INVALID_HANDLE;
+		return FALSE;
+	}
+
+	compat_ReleaseObject ((CompatObject *) hObject);
+	return TRUE;
+}
+
+DWORD WaitForSingleObject (HANDLE hObject, DWORD dwrdTimeout)
+{
+	return WaitForMultipleObjects (1, &hObject, FALSE, dwrdTimeout);
+}
+
+/**
+ * \brief Waits until one of the objects is signaled or the timeout elapses.
+ *
+ * \return WAIT_OBJECT_0 + index of the lowest signaled object, WAIT_TIMEOUT or WAIT_FAILED.
+ */
+DWORD WaitForMultipleObjects (DWORD dwrdCount, const HANDLE * phObjects, BOOL blnWaitAll, DWORD dwrdTimeout)
+{
+	CompatObject * pcoObject;
+	DWORD dwrdStartTime, dwrdElapsedTime, i;
+	BOOL blnAcquired;
+	struct pollfd pfdObjects [MAXIMUM_WAIT_OBJECTS];
+	int intTimeout;
+
+	if (blnWaitAll || dwrdCount == 0 || dwrdCount > MAXIMUM_WAIT_OBJECTS)
+	{
+		m_dwrdLastError = ERROR_INVALID_PARAMETER;
+		return WAIT_FAILED;
+	}
+
+	for (i = 0; i < dwrdCount; i++)
+	{
+		pfdObjects [i].fd = ((CompatObject *) phObjects [i])->Pipe [0];
+		pfdObjects [i].events = POLLIN;
+	}
+
+	dwrdStartTime = GetTickCount ();
+	for (;;)
+	{
+		// take the first signaled object (an auto-reset event may have been taken by another waiter in the meantime)
+		for (i = 0; i < dwrdCount; i++)
+		{
+			pcoObject = (CompatObject *) phObjects [i];
+			pthread_mutex_lock (&pcoObject->Mutex);
+			blnAcquired = pcoObject->Signaled;
+			pthread_mutex_unlock (&pcoObject->Mutex);
+			if (blnAcquired && (pcoObject->ManualReset || compat_SetState (pcoObject, FALSE)))
+				return WAIT_OBJECT_0 + i;
+		}
+
+		if (dwrdTimeout == INFINITE)
+			intTimeout = -1;
+		else
+		{
+			dwrdElapsedTime = GetTickCount () - dwrdStartTime;
+			if (dwrdElapsedTime >= dwrdTimeout)
+				return WAIT_TIMEOUT;
+			intTimeout = (int) (dwrdTimeout - dwrdElapsedTime);
+		}
+
+		if (poll (pfdObjects, dwrdCount, intTimeout) < 0 && errno != EINTR)
+		{
+			m_dwrdLastError = (DWORD) errno;
+			return WAIT_FAILED;
+		}
+	}
+}
+
+/**
+ * \brief Returns a file descriptor that is readable while the object is signaled, for use with poll().
+ *
+ * Polling the descriptor does not reset an auto-reset event.
+ */
+int compat_GetEventFD (HANDLE hObject)
+{
+	return ((CompatObject *) hObject)->Pipe [0];
+}
+
+void Sleep (DWORD dwrdMilliseconds)
+{
+	struct timespec tsDelay;
+
+	tsDelay.tv_sec = dwrdMilliseconds/1000;
+	tsDelay.tv_nsec = (long) (dwrdMilliseconds % 1000)*1000000;
+	while (nanosleep (&tsDelay, &tsDelay) != 0 && errno == EINTR);
+}
+
+DWORD GetTickCount (void)
+{
+	struct timespec tsNow;
+
+	clock_gettime (CLOCK_MONOTONIC, &tsNow);
+
+	return (DWORD) ((ULONGLONG) tsNow.tv_sec*1000 + tsNow.tv_nsec/1000000);
+}
+
+BOOL QueryPerformanceCounter (LARGE_INTEGER * pliCount)
+{
+	struct timespec tsNow;
+
+	clock_gettime (CLOCK_MONOTONIC, &tsNow);
+	pliCount->QuadPart = (LONGLONG) tsNow.tv_sec*1000000 + tsNow.tv_nsec/1000;
+
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency (LARGE_INTEGER * pliFrequency)
+{
+	// microseconds, so that the callers' (count*1000000) conversions cannot overflow
+	pliFrequency->QuadPart = 1000000;
+	return TRUE;
+}
+
+DWORD GetLastError (void)
+{
+	return m_dwrdLastError;
+}
+
+void SetLastError (DWORD dwrdErrorCode)
+{
+	m_dwrdLastError = dwrdErrorCode;
+}
+
+# endif
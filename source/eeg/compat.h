@@ -0,0 +1,190 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		compat.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file that provides the Win32 definitions used by the modules that are also built on POSIX systems
+ *				(e.g., the packet framer and the SIMD kernels, see the FramerHarness project, and the serial link, see the
+ *				LinkHarness project).
+ *
+ * On Windows, the header only includes windows.h and tchar.h. Elsewhere, it defines the Win32 types with their Win32
+ * sizes (DWORD and LONG are 32 bits wide on LP64 systems as well), maps the generic-text macros to their char versions
+ * and declares the subset of the Win32 event, thread and timer functions that the serial link uses (see compat.cpp).
+ *
+ * $Id$
+ */
+
+# ifndef __COMPAT_H__
+# define __COMPAT_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+# ifdef _WIN32
+//---------------------------------------------------------------------------
+//   								Includes
+//---------------------------------------------------------------------------
+# include <windows.h>
+# include <tchar.h>
+
+# else
+//---------------------------------------------------------------------------
+//   								Includes
+//---------------------------------------------------------------------------
+# include <errno.h>
+# include <stddef.h>
+# include <stdint.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define TRUE					1
+# define FALSE					0
+# define MAX_PATH				260
+# define WINAPI
+# define INFINITE				0xFFFFFFFF
+# define INVALID_HANDLE_VALUE	((HANDLE) (intptr_t) -1)
+
+// wait results
+# define WAIT_OBJECT_0			0
+# define WAIT_TIMEOUT			258
+# define WAIT_FAILED			0xFFFFFFFF
+# define MAXIMUM_WAIT_OBJECTS	64
+
+// Win32 error codes returned by the portable modules (the POSIX transports return errno values)
+# define ERROR_SUCCESS			0
+# define ERROR_INVALID_HANDLE	6
+# define ERROR_NOT_ENOUGH_MEMORY	8
+# define ERROR_BAD_UNIT			20
+# define ERROR_NOT_SUPPORTED	50
+# define ERROR_INVALID_PARAMETER	87
+
+// thread priorities (ignored: real-time scheduling requires privileges on POSIX systems)
+# define THREAD_PRIORITY_NORMAL			0
+# define THREAD_PRIORITY_TIME_CRITICAL	15
+
+# ifndef max
+# define max(a, b)				(((a) > (b)) ? (a) : (b))
+# endif
+# ifndef min
+# define min(a, b)				(((a) < (b)) ? (a) : (b))
+# endif
+
+// generic-text mappings (TCHAR is always char)
+# define TEXT(s)				s
+# define _T(s)					s
+# define _ftprintf				fprintf
+# define _tprintf				printf
+# define _stprintf_s			snprintf
+# define _tcsrchr				strrchr
+# define _tcsstr				strstr
+# define _tcslen				strlen
+# define _tstoi					atoi
+# define _TRUNCATE				((size_t) -1)
+
+# define SecureZeroMemory(p, n)	memset ((p), 0, (n))
+
+//---------------------------------------------------------------------------
+//   								Types
+//---------------------------------------------------------------------------
+typedef unsigned char			BYTE;
+typedef BYTE *					LPBYTE;
+typedef unsigned short			WORD;
+typedef uint32_t				DWORD;
+typedef int32_t					LONG;
+typedef int64_t					LONGLONG;
+typedef uint64_t				ULONGLONG;
+typedef int						BOOL;
+typedef void *					HANDLE;
+typedef void *					HFONT;										///< GUI handles are only stored by the portable modules
+typedef void *					HICON;
+typedef void *					HMENU;
+typedef void *					HWND;
+typedef uintptr_t				WPARAM;
+typedef intptr_t				LPARAM;
+typedef char					TCHAR;
+typedef void *					LPVOID;
+typedef DWORD (WINAPI * LPTHREAD_START_ROUTINE) (LPVOID lpParameter);
+
+typedef struct
+{
+	LONGLONG QuadPart;
+}
+LARGE_INTEGER;
+
+typedef struct
+{
+	DWORD dwLowDateTime;
+	DWORD dwHighDateTime;
+}
+FILETIME;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+// events & threads (compat.cpp); only unnamed events and WaitForMultipleObjects() with bWaitAll == FALSE are supported
+HANDLE	CreateEvent (void * psaAttributes, BOOL blnManualReset, BOOL blnInitialState, const TCHAR * strName);
+BOOL	SetEvent (HANDLE hEvent);
+BOOL	ResetEvent (HANDLE hEvent);
+HANDLE	CreateThread (void * psaAttributes, size_t sztStackSize, LPTHREAD_START_ROUTINE pfnStartAddress, LPVOID lpParameter, DWORD dwrdFlags, DWORD * pdwrdThreadId);
+BOOL	SetThreadPriority (HANDLE hThread, int intPriority);
+BOOL	CloseHandle (HANDLE hObject);
+DWORD	WaitForSingleObject (HANDLE hObject, DWORD dwrdTimeout);
+DWORD	WaitForMultipleObjects (DWORD dwrdCount, const HANDLE * phObjects, BOOL blnWaitAll, DWORD dwrdTimeout);
+int		compat_GetEventFD (HANDLE hObject);
+
+// timers & errors
+void	Sleep (DWORD dwrdMilliseconds);
+DWORD	GetTickCount (void);
+BOOL	QueryPerformanceCounter (LARGE_INTEGER * pliCount);
+BOOL	QueryPerformanceFrequency (LARGE_INTEGER * pliFrequency);
+DWORD	GetLastError (void);
+void	SetLastError (DWORD dwrdErrorCode);
+
+//---------------------------------------------------------------------------
+//   								Inline functions
+//---------------------------------------------------------------------------
+// interlocked operations (full memory barriers, as on Windows)
+static inline LONG InterlockedExchange (volatile LONG * plngTarget, LONG lngValue)
+{
+	return __atomic_exchange_n (plngTarget, lngValue, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedIncrement (volatile LONG * plngTarget)
+{
+	return __atomic_add_fetch (plngTarget, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedDecrement (volatile LONG * plngTarget)
+{
+	return __atomic_sub_fetch (plngTarget, 1, __ATOMIC_SEQ_CST);
+}
+
+// copies at most sztCount characters (all of them with _TRUNCATE) and always terminates the destination
+static inline int _tcsncpy_s (TCHAR * strDestination, size_t sztDestinationLen, const TCHAR * strSource, size_t sztCount)
+{
+	size_t sztLength;
+
+	if (strDestination == NULL || sztDestinationLen == 0 || strSource == NULL)
+		return EINVAL;
+
+	sztLength = strlen (strSource);
+	if (sztCount != _TRUNCATE && sztCount < sztLength)
+		sztLength = sztCount;
+	if (sztLength > sztDestinationLen - 1)
+		sztLength = sztDestinationLen - 1;
+	memcpy (strDestination, strSource, sztLength);
+	strDestination [sztLength] = '\0';
+
+	return 0;
+}
+
+# endif
+
+# endif
@@ -27,7 +27,14 @@
 # include "annotations.h"
 # include "globals.h"
 # include "edfPlus.h"
+# include "engine.h"
+# include "erp.h"
+# include "ica.h"
 # include "iniFile.h"
+# include "sigproc.h"
+# include "serialV4.h"
+# include "devices.h"
+# include "transport.h"
 # include "util.h"
 # include "config.h"
 
@@ -37,6 +44,7 @@
 # define CONFIG_FILE								TEXT("\\config.ini")
 # define SECTION_CONFIG								TEXT("Configuration")
 # define KEY_SIMULATIONMODE							TEXT("UseSimulationMode")
+# define KEY_SIMULATIONSPEED							TEXT("SimulationSpeed")				// % of real time (0 = as fast as possible)
 # define KEY_SCREENWIDTH							TEXT("ScreenWidth")
 # define KEY_SCREENHEIGHT							TEXT("ScreenHeight")
 # define KEY_HORIZONTALDPC							TEXT("HorizontalDPC")
@@ -49,9 +57,14 @@
 # define KEY_TIMEBASE								TEXT("TimeBaseIndex")
 # define KEY_FILEPATH								TEXT("FilePath")					// Store file name
 # define KEY_LPFILTER								TEXT("LPFilterIndex")					
+# define KEY_BASELINEWINDOW							TEXT("BaselineRemovalWindow")
 # define KEY_CONNSCRIPT								TEXT("ConnectionScript")
 # define KEY_DIALCONNSCRIPT							TEXT("DialConnectionScript")
+# define KEY_LATENCYPROBES							TEXT("LatencyProbes")				// measure the latency of the acquisition pipeline (see latency.cpp)
 # define DEFAULT_SIMULATIONMODE						0
+# define DEFAULT_SIMULATIONSPEED						100
+# define MIN_SIMULATIONSPEED						25									// slowest replay speed (% of real time)
+# define DEFAULT_LATENCYPROBES						0
 # define DEFAULT_SERPORT							4									// Default serial port
 # define DEFAULT_DISPLAYCHMASK						0x3F								// Default channel mask value
 # define DEFAULT_SAMPLINGFREQUENCY					500									// Default sampling frequency (Hz)
@@ -59,6 +72,7 @@
 # define DEFAULT_SCALE								5									// Default scale that is used to display EEG signals
 # define DEFAULT_TIMEBASE							6									// Default time base that is used to display EEG signals
 # define DEFAULT_LPFILTER							0
+# define DEFAULT_BASELINEWINDOW						0									///< default length, in ms, of the running-median window used for baseline removal (0 = disabled)
 # define DEFAULT_DIALCONNSCRIPT						0
 
 # define SECTION_CHANNELDCOFFSET					TEXT("Channel DC Offset")
@@ -89,6 +103,7 @@
 # define KEY_STREAMING_SERVERPORT					TEXT("Port")
 # define KEY_STREAMING_MAXNSENDMSGFAILURES			TEXT("MaxNSendMsgFailures")
 # define KEY_STREAMING_MAXNWAIT4REPLYFAILURES		TEXT("MaxNWait4ReplyFailures")
+# define KEY_STREAMING_COHERENCE					TEXT("Coherence")
 # define DEFAULT_STREAMING_ENABLED					0
 # define DEFAULT_STREAMING_SERVERIPV4_FIELD0		0
 # define DEFAULT_STREAMING_SERVERIPV4_FIELD1		0
@@ -97,6 +112,53 @@
 # define DEFAULT_STREAMING_SERVERPORT				0
 # define DEFAULT_STREAMING_MAXNSENDMSGFAILURES		3
 # define DEFAULT_STREAMING_MAXNWAIT4REPLYFAILURES	3
+# define DEFAULT_STREAMING_COHERENCE				0
+
+# define SECTION_ERP								TEXT("Event-Related Potentials")
+# define KEY_ERP_PRETRIGGERTIME						TEXT("PreTriggerTime")
+# define KEY_ERP_POSTTRIGGERTIME					TEXT("PostTriggerTime")
+# define KEY_ERP_TRIGGERMASK						TEXT("TriggerMask")					// bit n = member n of the AnnotationType enum
+# define DEFAULT_ERP_PRETRIGGERTIME					200									///< default length of the averaging window preceding an annotation, in ms
+# define DEFAULT_ERP_POSTTRIGGERTIME				800									///< default length of the averaging window following an annotation, in ms
+# define DEFAULT_ERP_TRIGGERMASK					((1 << Now) | (1 << Regular))		///< by default, only the annotations inserted by the user trigger an epoch
+# define ERP_TRIGGERMASK_ALL						((1 << (Regular + 1)) - 1)			///< all of the annotation types
+
+# define SECTION_ICA								TEXT("Artifact Removal")
+# define KEY_ICA_ENABLED							TEXT("Enabled")
+# define KEY_ICA_WINDOWTIME							TEXT("WindowLength")
+# define KEY_ICA_UPDATEINTERVAL						TEXT("UpdateInterval")
+# define DEFAULT_ICA_ENABLED						0
+# define DEFAULT_ICA_WINDOWTIME						20									///< default length of the window over which the unmixing matrix is estimated, in s
+# define DEFAULT_ICA_UPDATEINTERVAL					5									///< default time between two estimates of the unmixing matrix, in s
+
+# define SECTION_LINK								TEXT("WEEG Link")
+# define KEY_LINK_TRANSPORT							TEXT("Transport")					// 0 = COM port, 1 = capture file, 2 = TCP, 3 = emulator
+# define KEY_LINK_ADDRESS							TEXT("Address")						// capture file path, host:port or EDF+ file sent by the emulator
+# define KEY_LINK_REPLAYREALTIME					TEXT("ReplayRealTime")
+# define KEY_LINK_CAPTURE							TEXT("Capture")
+# define KEY_LINK_DEVICEMASK						TEXT("DeviceMask")					// bit n = measurement device n
+# define KEY_LINK_PRIMARYDEVICE						TEXT("PrimaryDevice")				// device that is displayed (0-7)
+# define KEY_LINK_CORRECTANNOTATIONONSETS			TEXT("CorrectAnnotationOnsets")		// user annotations are placed at the sample given by the device clock
+# define DEFAULT_LINK_TRANSPORT						Transport_COMPort
+# define DEFAULT_LINK_REPLAYREALTIME				1
+# define DEFAULT_LINK_CAPTURE						0
+# define DEFAULT_LINK_DEVICEMASK					WEEG_DEVICENR
+# define DEFAULT_LINK_PRIMARYDEVICE					0
+# define DEFAULT_LINK_CORRECTANNOTATIONONSETS		0
+
+# define SECTION_EMULATOR							TEXT("WEEG Emulator")
+# define KEY_EMULATOR_PACKETLOSSRATE				TEXT("PacketLossRate")				// ppm of the DATA packets
+# define KEY_EMULATOR_CORRUPTIONRATE				TEXT("CorruptionRate")				// ppm of the DATA packets
+# define KEY_EMULATOR_SPIKERATE						TEXT("LatencySpikeRate")			// ppm of the DATA packets
+# define KEY_EMULATOR_SPIKELENGTH					TEXT("LatencySpikeLength")			// ms
+# define KEY_EMULATOR_DISCONNECTINTERVAL			TEXT("DisconnectInterval")			// s (0 = never)
+# define KEY_EMULATOR_DISCONNECTLENGTH				TEXT("DisconnectLength")			// s
+# define DEFAULT_EMULATOR_PACKETLOSSRATE			0
+# define DEFAULT_EMULATOR_CORRUPTIONRATE			0
+# define DEFAULT_EMULATOR_SPIKERATE					0
+# define DEFAULT_EMULATOR_SPIKELENGTH				200
+# define DEFAULT_EMULATOR_DISCONNECTINTERVAL		0
+# define DEFAULT_EMULATOR_DISCONNECTLENGTH			5
 
 //---------------------------------------------------------------------------
 //   								Global variables
@@ -217,6 +279,12 @@ void config_load(CONFIGURATION * pcfgConfiguration)
 	// get general configuration data
 	//
 	iniFile_GetValueI(SECTION_CONFIG, KEY_SIMULATIONMODE, DEFAULT_SIMULATIONMODE, &pcfgConfiguration->SimulationMode);
+	iniFile_GetValueI(SECTION_CONFIG, KEY_SIMULATIONSPEED, DEFAULT_SIMULATIONSPEED, &pcfgConfiguration->SimulationSpeed);
+	if(pcfgConfiguration->SimulationSpeed < 0)
+		pcfgConfiguration->SimulationSpeed = DEFAULT_SIMULATIONSPEED;
+	else if(pcfgConfiguration->SimulationSpeed > 0 && pcfgConfiguration->SimulationSpeed < MIN_SIMULATIONSPEED)
+		pcfgConfiguration->SimulationSpeed = MIN_SIMULATIONSPEED;
+	iniFile_GetValueI(SECTION_CONFIG, KEY_LATENCYPROBES, DEFAULT_LATENCYPROBES, &pcfgConfiguration->LatencyProbes);
 
 	iniFile_GetValueI(SECTION_CONFIG, KEY_SERPORT, DEFAULT_SERPORT, &pcfgConfiguration->COMPortIndex);
 	if(pcfgConfiguration->COMPortIndex < 0 || pcfgConfiguration->COMPortIndex > (NSERPORTS - 1))
@@ -270,10 +338,21 @@ void config_load(CONFIGURATION * pcfgConfiguration)
 	if(pcfgConfiguration->LPFilterIndex < 0 || pcfgConfiguration->LPFilterIndex > (NLPFILTERS - 1))
 		pcfgConfiguration->LPFilterIndex = DEFAULT_LPFILTER;
 
+	iniFile_GetValueI(SECTION_CONFIG, KEY_BASELINEWINDOW, DEFAULT_BASELINEWINDOW, &pcfgConfiguration->BaselineWindowTime);
+	if(pcfgConfiguration->BaselineWindowTime < 0 || pcfgConfiguration->BaselineWindowTime*MAX_SAMPLERATE/1000 > MAX_BASELINE_WINDOW_LENGTH)
+		pcfgConfiguration->BaselineWindowTime = DEFAULT_BASELINEWINDOW;
+
 	iniFile_GetValueI(SECTION_CONFIG, KEY_SAMPLINGFREQUENCY, DEFAULT_SAMPLINGFREQUENCY, &pcfgConfiguration->SamplingFrequency);
 	if(pcfgConfiguration->SamplingFrequency < MIN_SAMPLERATE || pcfgConfiguration->SamplingFrequency > MAX_SAMPLERATE)
 		pcfgConfiguration->SamplingFrequency = DEFAULT_SAMPLINGFREQUENCY;
 
+	// the selected channels have to exist and fit into the throughput of the WEEG system at the selected sampling frequency
+	pcfgConfiguration->DisplayChannelMask &= MCHANNELMASK;
+	if(pcfgConfiguration->DisplayChannelMask == 0)
+		pcfgConfiguration->DisplayChannelMask = DEFAULT_DISPLAYCHMASK;
+	if(util_IsMaxNChannelsExceeded(pcfgConfiguration->SamplingFrequency, pcfgConfiguration->DisplayChannelMask, (unsigned int *) &i))
+		pcfgConfiguration->SamplingFrequency = DEFAULT_SAMPLINGFREQUENCY;
+
 	//
 	// get DC offsets
 	//
@@ -357,6 +436,64 @@ void config_load(CONFIGURATION * pcfgConfiguration)
 	if(pcfgConfiguration->Streaming_MaxNWait4ReplyFailures < 0)
 		pcfgConfiguration->Streaming_MaxNWait4ReplyFailures = DEFAULT_STREAMING_MAXNWAIT4REPLYFAILURES;
 
+	iniFile_GetValueI(SECTION_STREAMING, KEY_STREAMING_COHERENCE, DEFAULT_STREAMING_COHERENCE, &pcfgConfiguration->Streaming_Coherence);
+
+	//
+	// get event-related potential configuration
+	//
+	iniFile_GetValueI(SECTION_ERP, KEY_ERP_PRETRIGGERTIME, DEFAULT_ERP_PRETRIGGERTIME, &pcfgConfiguration->ERP_PreTriggerTime);
+	iniFile_GetValueI(SECTION_ERP, KEY_ERP_POSTTRIGGERTIME, DEFAULT_ERP_POSTTRIGGERTIME, &pcfgConfiguration->ERP_PostTriggerTime);
+	if(pcfgConfiguration->ERP_PreTriggerTime < 0 || pcfgConfiguration->ERP_PostTriggerTime <= 0 ||
+	   (pcfgConfiguration->ERP_PreTriggerTime + pcfgConfiguration->ERP_PostTriggerTime) > ERP_MAX_EPOCH_TIME)
+	{
+		pcfgConfiguration->ERP_PreTriggerTime = DEFAULT_ERP_PRETRIGGERTIME;
+		pcfgConfiguration->ERP_PostTriggerTime = DEFAULT_ERP_POSTTRIGGERTIME;
+	}
+
+	iniFile_GetValueI(SECTION_ERP, KEY_ERP_TRIGGERMASK, DEFAULT_ERP_TRIGGERMASK, &pcfgConfiguration->ERP_TriggerMask);
+	pcfgConfiguration->ERP_TriggerMask &= ERP_TRIGGERMASK_ALL;
+
+	//
+	// get artifact removal configuration
+	//
+	iniFile_GetValueI(SECTION_ICA, KEY_ICA_ENABLED, DEFAULT_ICA_ENABLED, &pcfgConfiguration->ICA_Enabled);
+
+	iniFile_GetValueI(SECTION_ICA, KEY_ICA_WINDOWTIME, DEFAULT_ICA_WINDOWTIME, &pcfgConfiguration->ICA_WindowTime);
+	if(pcfgConfiguration->ICA_WindowTime < ICA_MIN_WINDOW_TIME || pcfgConfiguration->ICA_WindowTime > ICA_MAX_WINDOW_TIME)
+		pcfgConfiguration->ICA_WindowTime = DEFAULT_ICA_WINDOWTIME;
+
+	iniFile_GetValueI(SECTION_ICA, KEY_ICA_UPDATEINTERVAL, DEFAULT_ICA_UPDATEINTERVAL, &pcfgConfiguration->ICA_UpdateInterval);
+	if(pcfgConfiguration->ICA_UpdateInterval <= 0 || pcfgConfiguration->ICA_UpdateInterval > pcfgConfiguration->ICA_WindowTime)
+		pcfgConfiguration->ICA_UpdateInterval = DEFAULT_ICA_UPDATEINTERVAL;
+
+	//
+	// get WEEG link configuration
+	//
+	iniFile_GetValueI(SECTION_LINK, KEY_LINK_TRANSPORT, DEFAULT_LINK_TRANSPORT, &pcfgConfiguration->Link_Transport);
+	if(pcfgConfiguration->Link_Transport < 0 || pcfgConfiguration->Link_Transport >= Transport_NTypes)
+		pcfgConfiguration->Link_Transport = DEFAULT_LINK_TRANSPORT;
+	iniFile_GetValueS(SECTION_LINK, KEY_LINK_ADDRESS, NULL, pcfgConfiguration->Link_Address, sizeof(pcfgConfiguration->Link_Address)/sizeof(TCHAR));
+	iniFile_GetValueI(SECTION_LINK, KEY_LINK_REPLAYREALTIME, DEFAULT_LINK_REPLAYREALTIME, &pcfgConfiguration->Link_ReplayRealTime);
+	iniFile_GetValueI(SECTION_LINK, KEY_LINK_CAPTURE, DEFAULT_LINK_CAPTURE, &pcfgConfiguration->Link_Capture);
+	iniFile_GetValueI(SECTION_LINK, KEY_LINK_PRIMARYDEVICE, DEFAULT_LINK_PRIMARYDEVICE, &pcfgConfiguration->Link_PrimaryDevice);
+	if(pcfgConfiguration->Link_PrimaryDevice < 0 || pcfgConfiguration->Link_PrimaryDevice >= DEVICE_MAXDEVICES)
+		pcfgConfiguration->Link_PrimaryDevice = DEFAULT_LINK_PRIMARYDEVICE;
+	iniFile_GetValueI(SECTION_LINK, KEY_LINK_DEVICEMASK, DEFAULT_LINK_DEVICEMASK, &pcfgConfiguration->Link_DeviceMask);
+	pcfgConfiguration->Link_DeviceMask = (pcfgConfiguration->Link_DeviceMask & 0xFF) | (1 << pcfgConfiguration->Link_PrimaryDevice);
+	iniFile_GetValueI(SECTION_LINK, KEY_LINK_CORRECTANNOTATIONONSETS, DEFAULT_LINK_CORRECTANNOTATIONONSETS, &pcfgConfiguration->Link_CorrectAnnotationOnsets);
+
+	//
+	// get coordinator emulator configuration
+	//
+	iniFile_GetValueI(SECTION_EMULATOR, KEY_EMULATOR_PACKETLOSSRATE, DEFAULT_EMULATOR_PACKETLOSSRATE, &pcfgConfiguration->Emulator_PacketLossRate);
+	iniFile_GetValueI(SECTION_EMULATOR, KEY_EMULATOR_CORRUPTIONRATE, DEFAULT_EMULATOR_CORRUPTIONRATE, &pcfgConfiguration->Emulator_CorruptionRate);
+	iniFile_GetValueI(SECTION_EMULATOR, KEY_EMULATOR_SPIKERATE, DEFAULT_EMULATOR_SPIKERATE, &pcfgConfiguration->Emulator_SpikeRate);
+	iniFile_GetValueI(SECTION_EMULATOR, KEY_EMULATOR_SPIKELENGTH, DEFAULT_EMULATOR_SPIKELENGTH, &pcfgConfiguration->Emulator_SpikeLength);
+	if(pcfgConfiguration->Emulator_SpikeLength < 0)
+		pcfgConfiguration->Emulator_SpikeLength = DEFAULT_EMULATOR_SPIKELENGTH;
+	iniFile_GetValueI(SECTION_EMULATOR, KEY_EMULATOR_DISCONNECTINTERVAL, DEFAULT_EMULATOR_DISCONNECTINTERVAL, &pcfgConfiguration->Emulator_DisconnectInterval);
+	iniFile_GetValueI(SECTION_EMULATOR, KEY_EMULATOR_DISCONNECTLENGTH, DEFAULT_EMULATOR_DISCONNECTLENGTH, &pcfgConfiguration->Emulator_DisconnectLength);
+
 	//
 	// get misc. configuration
 	//
@@ -387,6 +524,8 @@ void config_store(CONFIGURATION cfgConfiguration)
 	{
 		// Store configuration data
 		iniFile_SetValueI(SECTION_CONFIG, KEY_SIMULATIONMODE, cfgConfiguration.SimulationMode, TRUE);
+		iniFile_SetValueI(SECTION_CONFIG, KEY_SIMULATIONSPEED, cfgConfiguration.SimulationSpeed, TRUE);
+		iniFile_SetValueI(SECTION_CONFIG, KEY_LATENCYPROBES, (int) cfgConfiguration.LatencyProbes, TRUE);
 		iniFile_SetValueI(SECTION_CONFIG, KEY_SCREENWIDTH, cfgConfiguration.ScreenWidth, TRUE);
 		iniFile_SetValueI(SECTION_CONFIG, KEY_SCREENHEIGHT, cfgConfiguration.ScreenHeight, TRUE);
 		iniFile_SetValueI(SECTION_CONFIG, KEY_HORIZONTALDPC, cfgConfiguration.HorizontalDPC, TRUE);
@@ -395,6 +534,7 @@ void config_store(CONFIGURATION cfgConfiguration)
 		iniFile_SetValueH(SECTION_CONFIG, KEY_DISPLAYCHMASK, i, TRUE);
 		iniFile_SetValueI(SECTION_CONFIG, KEY_SERPORT, cfgConfiguration.COMPortIndex, TRUE);
 		iniFile_SetValueI(SECTION_CONFIG, KEY_LPFILTER, cfgConfiguration.LPFilterIndex, TRUE);
+		iniFile_SetValueI(SECTION_CONFIG, KEY_BASELINEWINDOW, cfgConfiguration.BaselineWindowTime, TRUE);
 		iniFile_SetValue(SECTION_CONFIG, KEY_FILEPATH, cfgConfiguration.DestinationFolder, TRUE);
 		iniFile_SetValue(SECTION_CONFIG, KEY_ELECTRODETYPE, cfgConfiguration.ElectrodeType, TRUE);
 		iniFile_SetValueI(SECTION_CONFIG, KEY_SCALE, cfgConfiguration.ScaleIndex, TRUE);
@@ -435,6 +575,34 @@ void config_store(CONFIGURATION cfgConfiguration)
 		iniFile_SetValueI(SECTION_STREAMING, KEY_STREAMING_SERVERPORT, cfgConfiguration.Streaming_Server_Port, TRUE);
 		iniFile_SetValueI(SECTION_STREAMING, KEY_STREAMING_MAXNSENDMSGFAILURES, cfgConfiguration.Streaming_MaxNSendMsgFailures, TRUE);
 		iniFile_SetValueI(SECTION_STREAMING, KEY_STREAMING_MAXNWAIT4REPLYFAILURES, cfgConfiguration.Streaming_MaxNWait4ReplyFailures, TRUE);
+		iniFile_SetValueI(SECTION_STREAMING, KEY_STREAMING_COHERENCE, (int) cfgConfiguration.Streaming_Coherence, TRUE);
+
+		// store event-related potential configuration
+		iniFile_SetValueI(SECTION_ERP, KEY_ERP_PRETRIGGERTIME, cfgConfiguration.ERP_PreTriggerTime, TRUE);
+		iniFile_SetValueI(SECTION_ERP, KEY_ERP_POSTTRIGGERTIME, cfgConfiguration.ERP_PostTriggerTime, TRUE);
+		iniFile_SetValueI(SECTION_ERP, KEY_ERP_TRIGGERMASK, cfgConfiguration.ERP_TriggerMask, TRUE);
+
+		// store artifact removal configuration
+		iniFile_SetValueI(SECTION_ICA, KEY_ICA_ENABLED, (int) cfgConfiguration.ICA_Enabled, TRUE);
+		iniFile_SetValueI(SECTION_ICA, KEY_ICA_WINDOWTIME, cfgConfiguration.ICA_WindowTime, TRUE);
+		iniFile_SetValueI(SECTION_ICA, KEY_ICA_UPDATEINTERVAL, cfgConfiguration.ICA_UpdateInterval, TRUE);
+
+		// store WEEG link configuration
+		iniFile_SetValueI(SECTION_LINK, KEY_LINK_TRANSPORT, cfgConfiguration.Link_Transport, TRUE);
+		iniFile_SetValue(SECTION_LINK, KEY_LINK_ADDRESS, cfgConfiguration.Link_Address, TRUE);
+		iniFile_SetValueI(SECTION_LINK, KEY_LINK_REPLAYREALTIME, (int) cfgConfiguration.Link_ReplayRealTime, TRUE);
+		iniFile_SetValueI(SECTION_LINK, KEY_LINK_CAPTURE, (int) cfgConfiguration.Link_Capture, TRUE);
+		iniFile_SetValueI(SECTION_LINK, KEY_LINK_DEVICEMASK, cfgConfiguration.Link_DeviceMask, TRUE);
+		iniFile_SetValueI(SECTION_LINK, KEY_LINK_PRIMARYDEVICE, cfgConfiguration.Link_PrimaryDevice, TRUE);
+		iniFile_SetValueI(SECTION_LINK, KEY_LINK_CORRECTANNOTATIONONSETS, (int) cfgConfiguration.Link_CorrectAnnotationOnsets, TRUE);
+
+		// store coordinator emulator configuration
+		iniFile_SetValueI(SECTION_EMULATOR, KEY_EMULATOR_PACKETLOSSRATE, cfgConfiguration.Emulator_PacketLossRate, TRUE);
+		iniFile_SetValueI(SECTION_EMULATOR, KEY_EMULATOR_CORRUPTIONRATE, cfgConfiguration.Emulator_CorruptionRate, TRUE);
+		iniFile_SetValueI(SECTION_EMULATOR, KEY_EMULATOR_SPIKERATE, cfgConfiguration.Emulator_SpikeRate, TRUE);
+		iniFile_SetValueI(SECTION_EMULATOR, KEY_EMULATOR_SPIKELENGTH, cfgConfiguration.Emulator_SpikeLength, TRUE);
+		iniFile_SetValueI(SECTION_EMULATOR, KEY_EMULATOR_DISCONNECTINTERVAL, cfgConfiguration.Emulator_DisconnectInterval, TRUE);
+		iniFile_SetValueI(SECTION_EMULATOR, KEY_EMULATOR_DISCONNECTLENGTH, cfgConfiguration.Emulator_DisconnectLength, TRUE);
 	}
 }
 
@@ -0,0 +1,695 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		devices.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that records the additional WEEG measurement devices of a multi-device network.
+ *
+ * One coordinator can collect the DATA packets of up to eight measurement devices (see tPacket_DEVMASK). The primary
+ * device is displayed and recorded by the sample thread as before; the DATA packets of every other device in the device
+ * mask are handed to device_Dispatch(), which queues them to a stream of their own. Each stream has a worker thread that
+ * tracks the device's time stamps, assembles its data records and writes them to a separate EDF+ file, so that a slow or
+ * silent device never holds up the primary one.
+ *
+ * Lost packets and communication blackouts are filled in with invalid samples sized from the time stamps, so that every
+ * sample of a device's file stays at the position given by its time stamp and the files of all devices remain aligned
+ * with each other. Each stream also has filters of its own (see sigproc.h), which run over the samples of the device as
+ * the display filters do over those of the primary device; the filtered signals can be retrieved with device_GetSignals().
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+#include <time.h>
+
+// custom libraries
+#include <eegem_beep.h>
+
+// program headers
+#include "globals.h"
+#include "annotations.h"
+#include "applog.h"
+#include "edfPlus.h"
+#include "engine.h"
+#include "recpool.h"
+#include "serialV4.h"
+#include "sigproc.h"
+#include "simd.h"
+#include "thread_storage.h"
+#include "thread_stream.h"
+#include "thread_sample.h"
+#include "util.h"
+#include "devices.h"
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Stream of one additional measurement device.
+ */
+typedef struct
+{
+	BYTE				DeviceNr;
+	HANDLE				hWorkerThread;
+	HANDLE				hevDataReady;							///< signaled when packets have been queued (or when the worker has to exit)
+	volatile BOOL		StopWorker;
+
+	// packet queue (single producer: sample thread, single consumer: worker thread)
+	tPacket_DATA		Queue [DEVICE_QUEUE_LENGTH];
+	volatile LONG		QueueHead;								///< total number of packets queued (modified only by the sample thread)
+	volatile LONG		QueueTail;								///< total number of packets processed (modified only by the worker thread)
+
+	// time stamp tracking
+	DWORD				LastTimeStamp;
+	DWORD				LastPacketTime;							///< GetTickCount() value at which the last packet was processed
+	BOOL				CommunicationBlackout;
+	unsigned int		NBlackoutSamples;						///< number of invalid samples stored since the last packet because of a communication blackout
+
+	// data record assembly & storage
+	SampleDataRecord	DataRecord;
+	int					NSamplesDataRecord;
+	unsigned int		TimeKeepingTAL;
+	HANDLE				hEDFPlusFile;
+	BOOL				WriteErrorOccured;
+
+	// filters
+	SigProcContext *	pFilters;								///< filters of the device's EEG signals (same settings as those of the displayed signals)
+	double *			FilteredSignals [EEGCHANNELS];			///< last second of each filtered EEG signal (ring; rows of the channels that are not measured stay zero)
+	unsigned int		FilteredSignalsID;						///< index of the oldest sample in FilteredSignals
+
+	CRITICAL_SECTION	csGuard;								///< protects Statistics and FilteredSignals, which are read by other threads
+	DeviceStatistics	Statistics;
+	volatile LONG		NPacketsDropped;						///< counted by device_Dispatch() without taking csGuard (see DeviceStatistics::NPacketsDropped)
+}
+DeviceStream;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+static void			device_CloseStream(DeviceStream * pdsStream);
+static void			device_FillGap(DeviceStream * pdsStream, unsigned int uintNSamples);
+static void			device_FilterSamples(DeviceStream * pdsStream, unsigned int uintNSamples);
+static BOOL			device_OpenStream(DeviceStream * pdsStream, BYTE bytDeviceNr, const TCHAR * strFilePathPrefix);
+static void			device_ProcessDataPacket(DeviceStream * pdsStream, const tPacket_DATA * ptpMeasurementData);
+static void			device_StoreDataRecord(DeviceStream * pdsStream);
+static long WINAPI	device_WorkerThread(LPARAM lParam);
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static DeviceStream				m_dsStreams [DEVICE_MAXDEVICES];
+static BYTE						m_bytDeviceMask = 0;			///< devices whose streams are open
+static int						m_intSamplingFrequency;
+static BYTE						m_bytEEGChannelMask;			///< EEG channels sent by the devices (the same for all devices of the network)
+static unsigned int				m_uintNEEGChannels;				///< number of EEG signals in the data records
+static unsigned int				m_uintEEGChannelIDs [EEGCHANNELS];	///< channel number of each EEG signal of the data records
+static unsigned int				m_uintBaselineWindowLength;		///< length of the running-median window of the filters, in samples (0 = disabled)
+static const short				mc_shrUnmeasured [SAMPLES_PER_PACKET] = {0};	///< samples passed to the filters of the channels that are not measured
+static unsigned int				m_uintNSamplesPerPacket;		///< number of samples per channel in a DATA packet
+static PatientIdentification	m_piPatientInfo;				///< the patient information entered in the GUI belongs to the primary device, so the other files are anonymous
+static RecordingIdentification	m_riRecordingInfo;
+static TCHAR *					m_strElectrodeType;
+static char *					m_pEDFPlusHeaderBuffer = NULL;
+static unsigned short			m_ushrEDFPlusHeaderBufferLen;
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Stops the worker thread of a stream, completes the header record of its EDF+ file and releases its resources.
+ *
+ * Executes in the context of the thread that opened the streams.
+ *
+ * \param[in]	pdsStream		stream to be closed
+ * \return Nothing.
+ */
+static void device_CloseStream(DeviceStream * pdsStream)
+{
+	DWORD dwrdNBytesWritten;
+	TCHAR strBuffer[256];
+
+	// stop worker thread (it processes the packets that are still queued before exiting)
+	if(pdsStream->hWorkerThread != NULL)
+	{
+		pdsStream->StopWorker = TRUE;
+		SetEvent(pdsStream->hevDataReady);
+		WaitForSingleObject(pdsStream->hWorkerThread, INFINITE);
+		CloseHandle(pdsStream->hWorkerThread);
+		pdsStream->hWorkerThread = NULL;
+	}
+	if(pdsStream->hevDataReady != NULL)
+	{
+		CloseHandle(pdsStream->hevDataReady);
+		pdsStream->hevDataReady = NULL;
+	}
+
+	// store the final number of data records in the header record
+	if(pdsStream->hEDFPlusFile != INVALID_HANDLE_VALUE)
+	{
+		if(edf_GenerateEDFplusHeaderRecord(FALSE, m_piPatientInfo, m_riRecordingInfo, m_intSamplingFrequency,
+										   pdsStream->Statistics.NDataRecords, m_bytEEGChannelMask, ACCCHANNELS, m_strElectrodeType,
+										   m_pEDFPlusHeaderBuffer, m_ushrEDFPlusHeaderBufferLen + 1))		// +1 for terminating null character
+		{
+			SetFilePointer(pdsStream->hEDFPlusFile, 0, NULL, FILE_BEGIN);
+			if(!WriteFile(pdsStream->hEDFPlusFile, m_pEDFPlusHeaderBuffer, m_ushrEDFPlusHeaderBufferLen, &dwrdNBytesWritten, NULL))
+				applog_logevent(SoftwareError, TEXT("Devices"), TEXT("device_CloseStream(): Unable to store final EDF+ header record. (GetLastError #)"), GetLastError(), TRUE);
+		}
+		CloseHandle(pdsStream->hEDFPlusFile);
+		pdsStream->hEDFPlusFile = INVALID_HANDLE_VALUE;
+
+		_stprintf_s(strBuffer, sizeof(strBuffer)/sizeof(TCHAR),
+					TEXT("device_CloseStream(): Device %d: %ld packets received, %ld lost, %ld dropped; number of data records"),
+					pdsStream->DeviceNr, pdsStream->Statistics.NPacketsReceived, pdsStream->Statistics.NPacketsLost, pdsStream->NPacketsDropped);
+		applog_logevent(General, TEXT("Devices"), strBuffer, pdsStream->Statistics.NDataRecords, TRUE);
+	}
+
+	Sample_FreeDataRecord(&pdsStream->DataRecord);
+	pdsStream->DataRecord.MeasurementData = NULL;
+	pdsStream->DataRecord.WriteBuffer = NULL;
+
+	if(pdsStream->pFilters != NULL)
+	{
+		sp_DestroyContext(pdsStream->pFilters);
+		pdsStream->pFilters = NULL;
+	}
+	free(pdsStream->FilteredSignals[0]);
+	pdsStream->FilteredSignals[0] = NULL;
+
+	DeleteCriticalSection(&pdsStream->csGuard);
+}
+
+/**
+ * \brief Fills a gap in the signals of a device with invalid samples.
+ *
+ * Every data record that is completed by the gap is stored. Executes in the context of the stream's worker thread.
+ *
+ * \param[in]	pdsStream		stream of the device
+ * \param[in]	uintNSamples	number of samples (per signal) that are missing
+ * \return Nothing.
+ */
+static void device_FillGap(DeviceStream * pdsStream, unsigned int uintNSamples)
+{
+	int j;
+	unsigned int k, uintNFilled;
+
+	for(; uintNSamples > 0; uintNSamples -= uintNFilled)
+	{
+		uintNFilled = min(uintNSamples, (unsigned int) (m_intSamplingFrequency - pdsStream->NSamplesDataRecord));
+		for(k = 0; k < (ACCCHANNELS + m_uintNEEGChannels); k++)
+		{
+			for(j = pdsStream->NSamplesDataRecord; j < pdsStream->NSamplesDataRecord + (int) uintNFilled; j++)
+				pdsStream->DataRecord.MeasurementData[k][j] = (k < ACCCHANNELS) ? INVALID_ACC_SAMPLE : INVALID_EEG_SAMPLE;
+		}
+
+		pdsStream->NSamplesDataRecord += uintNFilled;
+		if(pdsStream->NSamplesDataRecord == m_intSamplingFrequency)
+			device_StoreDataRecord(pdsStream);
+	}
+}
+
+/**
+ * \brief Runs the filters of a device over the EEG samples that have just been added to its data record.
+ *
+ * Executes in the context of the stream's worker thread.
+ *
+ * \param[in]	pdsStream		stream of the device
+ * \param[in]	uintNSamples	number of new samples (at most SAMPLES_PER_PACKET), which end at NSamplesDataRecord
+ * \return Nothing.
+ */
+static void device_FilterSamples(DeviceStream * pdsStream, unsigned int uintNSamples)
+{
+	short * ppshrSamples [EEGCHANNELS];
+	unsigned int k;
+
+	for(k = 0; k < EEGCHANNELS; k++)
+		ppshrSamples[k] = (short *) mc_shrUnmeasured;
+	for(k = 0; k < m_uintNEEGChannels; k++)
+		ppshrSamples[m_uintEEGChannelIDs[k]] = pdsStream->DataRecord.MeasurementData[ACCCHANNELS + k] + pdsStream->NSamplesDataRecord - uintNSamples;
+
+	EnterCriticalSection(&pdsStream->csGuard);
+	sp_FilterAllPass(pdsStream->pFilters, ppshrSamples, pdsStream->FilteredSignals, m_intSamplingFrequency, &pdsStream->FilteredSignalsID, uintNSamples);
+	LeaveCriticalSection(&pdsStream->csGuard);
+}
+
+/**
+ * \brief Creates the EDF+ file of a device and starts the worker thread of its stream.
+ *
+ * \param[out]	pdsStream			stream to be opened
+ * \param[in]	bytDeviceNr			number of the measurement device (0-7)
+ * \param[in]	strFilePathPrefix	path and base name of the EDF+ file (the device number and extension are appended)
+ * \return TRUE if successful, FALSE otherwise.
+ */
+static BOOL device_OpenStream(DeviceStream * pdsStream, BYTE bytDeviceNr, const TCHAR * strFilePathPrefix)
+{
+	DWORD dwrdNBytesWritten;
+	TCHAR strFilePath[MAX_PATH + 1];
+
+	unsigned int k;
+
+	// variable initialization
+	SecureZeroMemory(pdsStream, sizeof(DeviceStream));
+	pdsStream->DeviceNr = bytDeviceNr;
+	pdsStream->hEDFPlusFile = INVALID_HANDLE_VALUE;
+	InitializeCriticalSection(&pdsStream->csGuard);
+
+	if(!Sample_InitDataRecord(&pdsStream->DataRecord, m_intSamplingFrequency, m_uintNEEGChannels))
+	{
+		pdsStream->DataRecord.MeasurementData = NULL;
+		pdsStream->DataRecord.WriteBuffer = NULL;
+		return FALSE;
+	}
+
+	// filters & filtered signals (one second of each EEG channel)
+	pdsStream->pFilters = sp_CreateContext(m_uintBaselineWindowLength);
+	pdsStream->FilteredSignals[0] = (double *) calloc(EEGCHANNELS*m_intSamplingFrequency, sizeof(double));
+	if(pdsStream->pFilters == NULL || pdsStream->FilteredSignals[0] == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Devices"), TEXT("device_OpenStream(): Failed to allocate memory for the filters. (errno #)"), errno, TRUE);
+		return FALSE;
+	}
+	for(k = 1; k < EEGCHANNELS; k++)
+		pdsStream->FilteredSignals[k] = pdsStream->FilteredSignals[0] + k*m_intSamplingFrequency;
+
+	// create EDF+ file and write its header record (the number of data records is stored once the stream is closed)
+	_stprintf_s(strFilePath, sizeof(strFilePath)/sizeof(TCHAR), TEXT("%s (device %d).edf"), strFilePathPrefix, bytDeviceNr);
+	pdsStream->hEDFPlusFile = CreateFile(strFilePath, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(pdsStream->hEDFPlusFile == INVALID_HANDLE_VALUE)
+	{
+		applog_logevent(SoftwareError, TEXT("Devices"), TEXT("device_OpenStream(): Unable to create EDF+ file. (GetLastError #)"), GetLastError(), TRUE);
+		return FALSE;
+	}
+	if(!edf_GenerateEDFplusHeaderRecord(FALSE, m_piPatientInfo, m_riRecordingInfo, m_intSamplingFrequency,
+										EDFLENGTHDURINGRECORD, m_bytEEGChannelMask, ACCCHANNELS, m_strElectrodeType,
+										m_pEDFPlusHeaderBuffer, m_ushrEDFPlusHeaderBufferLen + 1) ||		// +1 for terminating null character
+	   !WriteFile(pdsStream->hEDFPlusFile, m_pEDFPlusHeaderBuffer, m_ushrEDFPlusHeaderBufferLen, &dwrdNBytesWritten, NULL))
+	{
+		applog_logevent(SoftwareError, TEXT("Devices"), TEXT("device_OpenStream(): Unable to store EDF+ header record. (GetLastError #)"), GetLastError(), TRUE);
+		return FALSE;
+	}
+
+	// initialize the annotation signal of the first data record
+	sprintf_s((char *) pdsStream->DataRecord.WriteBuffer + (m_uintNEEGChannels + ACCCHANNELS)*m_intSamplingFrequency*sizeof(short), ANNOTATION_TOTAL_NCHARS,
+			  "+%d%c%c", pdsStream->TimeKeepingTAL, (char) 20, (char) 20);
+
+	// start worker thread
+	pdsStream->LastPacketTime = GetTickCount();
+	pdsStream->hevDataReady = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if(pdsStream->hevDataReady == NULL)
+		return FALSE;
+	pdsStream->hWorkerThread = CreateThread (NULL,										// handle cannot be inherited by child processes
+											 4096,										// initial size of the stack, in bytes
+											 (LPTHREAD_START_ROUTINE) device_WorkerThread,
+											 pdsStream,									// stream processed by the thread
+											 0,											// thread runs immediately after creation
+											 NULL);										// thread identifier is not needed
+	if(pdsStream->hWorkerThread == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Devices"), TEXT("device_OpenStream(): Failed to create worker thread. (GetLastError #)"), GetLastError(), TRUE);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Checks the time stamp of a DATA packet and adds its samples to the data record of the device.
+ *
+ * The samples missing before the packet (lost packets, or a communication blackout that lasted longer than the invalid
+ * samples already stored for it) are filled in with invalid samples first; samples of the packet that have already been
+ * covered by the invalid samples of a blackout are skipped. If the device has restarted its time stamps during a blackout,
+ * the gap is sized from the elapsed time instead. Executes in the context of the stream's worker thread.
+ *
+ * \param[in]	pdsStream				stream of the device that sent the packet
+ * \param[in]	ptpMeasurementData		DATA packet
+ * \return Nothing.
+ */
+static void device_ProcessDataPacket(DeviceStream * pdsStream, const tPacket_DATA * ptpMeasurementData)
+{
+	short ** ppshrData;
+	int j, k;
+	LONG lngNMissing, lngGap;
+	DWORD dwrdWallClockGap;
+	unsigned int uintFirstSample, uintNDecoded;
+	TCHAR strBuffer[256];
+
+	// check the packet's time stamp
+	uintFirstSample = 0;
+	if(pdsStream->Statistics.NPacketsReceived > 0)
+	{
+		// number of samples missing between the previous packet and this one
+		lngNMissing = (LONG) (ptpMeasurementData->TimeStamp - pdsStream->LastTimeStamp - m_uintNSamplesPerPacket);
+		if(pdsStream->CommunicationBlackout)
+		{
+			dwrdWallClockGap = (DWORD) (((ULONGLONG) (GetTickCount() - pdsStream->LastPacketTime))*m_intSamplingFrequency/1000);
+			if(ptpMeasurementData->TimeStamp <= pdsStream->LastTimeStamp || lngNMissing > (LONG) (dwrdWallClockGap + m_intSamplingFrequency))
+			{
+				// the device clock has started over
+				lngNMissing = (LONG) dwrdWallClockGap - (LONG) m_uintNSamplesPerPacket;
+			}
+		}
+		else if(ptpMeasurementData->TimeStamp <= pdsStream->LastTimeStamp)
+			return;
+		else if(lngNMissing > 0)
+		{
+			_stprintf_s(strBuffer,
+						sizeof(strBuffer)/sizeof(TCHAR),
+						TEXT("device_ProcessDataPacket(): Device %d: Packet Timestamp Error: was expecting %u, received %u."),
+						pdsStream->DeviceNr,
+						pdsStream->LastTimeStamp + m_uintNSamplesPerPacket,
+						ptpMeasurementData->TimeStamp);
+			applog_logevent(SoftwareError, TEXT("Devices"), strBuffer, 0, TRUE);
+		}
+
+		// fill in the samples that are still missing, or skip those that a blackout has already covered
+		lngGap = lngNMissing - (LONG) pdsStream->NBlackoutSamples;
+		if(lngGap > 0)
+			device_FillGap(pdsStream, (unsigned int) lngGap);
+		else
+			uintFirstSample = min((unsigned int) -lngGap, m_uintNSamplesPerPacket);
+
+		if(lngNMissing > 0)
+		{
+			EnterCriticalSection(&pdsStream->csGuard);
+			pdsStream->Statistics.NPacketsLost += lngNMissing/m_uintNSamplesPerPacket;
+			LeaveCriticalSection(&pdsStream->csGuard);
+		}
+	}
+	pdsStream->LastTimeStamp = ptpMeasurementData->TimeStamp;
+	pdsStream->LastPacketTime = GetTickCount();
+	pdsStream->CommunicationBlackout = FALSE;
+	pdsStream->NBlackoutSamples = 0;
+
+	EnterCriticalSection(&pdsStream->csGuard);
+	pdsStream->Statistics.NPacketsReceived++;
+	pdsStream->Statistics.BatteryLevel = ptpMeasurementData->BatteryLevel;
+	LeaveCriticalSection(&pdsStream->csGuard);
+
+	// decode samples straight into the data record (same signal order as the data records of the primary device)
+	ppshrData = pdsStream->DataRecord.MeasurementData;
+	for (; uintFirstSample < m_uintNSamplesPerPacket; uintFirstSample += uintNDecoded)
+	{
+		uintNDecoded = min(m_uintNSamplesPerPacket - uintFirstSample, (unsigned int) (m_intSamplingFrequency - pdsStream->NSamplesDataRecord));
+
+		simd_DecodeSamples(ptpMeasurementData->Measurements + uintFirstSample*m_uintNEEGChannels, m_uintNEEGChannels, uintNDecoded,
+						   &ppshrData[ACCCHANNELS], pdsStream->NSamplesDataRecord);
+		for (k = 0; k < ACCCHANNELS; k++)
+		{
+			for (j = 0; j < (int) uintNDecoded; j++)
+				ppshrData[k][pdsStream->NSamplesDataRecord + j] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[k]);
+		}
+
+		pdsStream->NSamplesDataRecord += uintNDecoded;
+		device_FilterSamples(pdsStream, uintNDecoded);
+		if (pdsStream->NSamplesDataRecord == m_intSamplingFrequency)
+			device_StoreDataRecord(pdsStream);
+	}
+}
+
+/**
+ * \brief Appends the completed data record of a device to its EDF+ file.
+ *
+ * Executes in the context of the stream's worker thread.
+ *
+ * \param[in]	pdsStream		stream whose data record is complete
+ * \return Nothing.
+ */
+static void device_StoreDataRecord(DeviceStream * pdsStream)
+{
+	char *			strAnnotation;
+	DWORD			dwrdNBytesWritten;
+	unsigned int	uintSignalLength;
+
+	// the signals (views of WriteBuffer) and the annotation signal are already in place
+	uintSignalLength = m_intSamplingFrequency*sizeof(short);
+
+	// write data record; after the first failure the stream is only tracked, not stored
+	if(!pdsStream->WriteErrorOccured)
+	{
+		if(WriteFile(pdsStream->hEDFPlusFile, pdsStream->DataRecord.WriteBuffer, pdsStream->DataRecord.WriteBufferLen, &dwrdNBytesWritten, NULL) &&
+		   dwrdNBytesWritten == pdsStream->DataRecord.WriteBufferLen)
+		{
+			EnterCriticalSection(&pdsStream->csGuard);
+			pdsStream->Statistics.NDataRecords++;
+			LeaveCriticalSection(&pdsStream->csGuard);
+		}
+		else
+		{
+			applog_logevent(SoftwareError, TEXT("Devices"), TEXT("device_StoreDataRecord(): Unable to store data record. (GetLastError #)"), GetLastError(), TRUE);
+			pdsStream->WriteErrorOccured = TRUE;
+		}
+	}
+
+	// initialize the annotation signal of the next data record
+	pdsStream->TimeKeepingTAL += EDFDURATIONOFRECORD;
+	strAnnotation = (char *) pdsStream->DataRecord.WriteBuffer + (m_uintNEEGChannels + ACCCHANNELS)*uintSignalLength;
+	SecureZeroMemory(strAnnotation, ANNOTATION_TOTAL_NCHARS*sizeof(char));
+	sprintf_s(strAnnotation, ANNOTATION_TOTAL_NCHARS, "+%d%c%c", pdsStream->TimeKeepingTAL, (char) 20, (char) 20);
+
+	pdsStream->NSamplesDataRecord = 0;
+}
+
+/**
+ * \brief Function executed by the worker thread of a device stream.
+ *
+ * \param[in]	lParam		pointer to the DeviceStream processed by the thread
+ * \return 0.
+ */
+static long WINAPI device_WorkerThread(LPARAM lParam)
+{
+	DeviceStream *	pdsStream;
+	DWORD			dwrdTail;
+
+	pdsStream = (DeviceStream *) lParam;
+
+	while(1)
+	{
+		WaitForSingleObject(pdsStream->hevDataReady, TRANSFER_PACKWAIT);
+
+		// process the queued packets
+		dwrdTail = (DWORD) pdsStream->QueueTail;
+		while(dwrdTail != (DWORD) pdsStream->QueueHead)
+		{
+			device_ProcessDataPacket(pdsStream, &pdsStream->Queue[dwrdTail & (DEVICE_QUEUE_LENGTH - 1)]);
+			InterlockedExchange(&pdsStream->QueueTail, (LONG) ++dwrdTail);
+		}
+
+		if(pdsStream->StopWorker)
+			break;
+
+		// if the device has gone silent, complete the current data record with invalid samples (once per blackout); the
+		// rest of the blackout is filled in from the time stamps once the device is heard from again
+		if(!pdsStream->CommunicationBlackout && GetTickCount() - pdsStream->LastPacketTime > TRANSFER_PACKWAIT)
+		{
+			pdsStream->CommunicationBlackout = TRUE;
+			pdsStream->NBlackoutSamples = m_intSamplingFrequency - pdsStream->NSamplesDataRecord;
+			device_FillGap(pdsStream, pdsStream->NBlackoutSamples);
+		}
+	}
+
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Opens a stream, with its own EDF+ file and worker thread, for each of the specified measurement devices.
+ *
+ * Must be called after the header record of the primary device's EDF+ file has been generated, since the files of the
+ * additional devices share its start date & time.
+ *
+ * \param[in]	bytDeviceMask			devices to be recorded (bit n = device n); must not include the primary device
+ * \param[in]	strFilePathPrefix		path and base name of the EDF+ files (" (device n).edf" is appended)
+ * \param[in]	riRecordingInfo			information stored in the 'local recording identification' field of the files
+ * \param[in]	intSamplingFrequency	sampling frequency of the devices, in Hz
+ * \param[in]	bytEEGChannelMask		EEG channels sent by the devices (bit n = channel n)
+ * \param[in]	strElectrodeType		type of electrode used to measure the EEG signals
+ * \param[in]	uintBaselineWindowLength	length of the running-median window of the devices' filters, in samples (0 = disabled)
+ * \return TRUE if all of the streams were opened, FALSE otherwise (no stream is left open).
+ */
+BOOL device_Open(BYTE bytDeviceMask, const TCHAR * strFilePathPrefix, RecordingIdentification riRecordingInfo, int intSamplingFrequency, BYTE bytEEGChannelMask, TCHAR * strElectrodeType,
+				 unsigned int uintBaselineWindowLength)
+{
+	BYTE i;
+
+	if(m_bytDeviceMask != 0)
+		device_Close();
+
+	// variable initialization
+	m_intSamplingFrequency = intSamplingFrequency;
+	m_bytEEGChannelMask = bytEEGChannelMask & MCHANNELMASK;
+	m_uintNEEGChannels = 0;
+	for(i = 0; i < EEGCHANNELS; i++)
+	{
+		if(m_bytEEGChannelMask & (1 << i))
+			m_uintEEGChannelIDs[m_uintNEEGChannels++] = i;
+	}
+	m_uintNSamplesPerPacket = SAMPLES_PER_PACKET/m_uintNEEGChannels;
+	m_uintBaselineWindowLength = uintBaselineWindowLength;
+	m_riRecordingInfo = riRecordingInfo;
+	m_strElectrodeType = strElectrodeType;
+	edf_InitHeaderStructures(&m_piPatientInfo, NULL);
+
+	// allocate header record buffer
+	m_ushrEDFPlusHeaderBufferLen = edf_CalculateEDFplusHeaderRecord(m_uintNEEGChannels + ACCCHANNELS + 1);	// +1 for annotations signal
+	m_pEDFPlusHeaderBuffer = (char *) malloc(m_ushrEDFPlusHeaderBufferLen + 1);							// +1 for terminating null character
+	if(m_pEDFPlusHeaderBuffer == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Devices"), TEXT("device_Open(): Failed to allocate memory for the EDF+ header record. (errno #)"), errno, TRUE);
+		return FALSE;
+	}
+
+	// open streams
+	for(i = 0; i < DEVICE_MAXDEVICES; i++)
+	{
+		if(bytDeviceMask & (1 << i))
+		{
+			m_bytDeviceMask |= (1 << i);
+			if(!device_OpenStream(&m_dsStreams[i], i, strFilePathPrefix))
+			{
+				device_Close();
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Closes all of the open device streams.
+ *
+ * Must be called after the link has been closed (i.e., once device_Dispatch() is no longer called).
+ *
+ * \return Nothing.
+ */
+void device_Close(void)
+{
+	BYTE i;
+
+	for(i = 0; i < DEVICE_MAXDEVICES; i++)
+	{
+		if(m_bytDeviceMask & (1 << i))
+			device_CloseStream(&m_dsStreams[i]);
+	}
+	m_bytDeviceMask = 0;
+
+	if(m_pEDFPlusHeaderBuffer != NULL)
+	{
+		free(m_pEDFPlusHeaderBuffer);
+		m_pEDFPlusHeaderBuffer = NULL;
+	}
+}
+
+/**
+ * \brief Queues a DATA packet to the stream of the device that sent it.
+ *
+ * Called by the sample thread. Packets of devices without an open stream are ignored. Never blocks: if the worker
+ * thread of the stream has fallen behind and its queue is full, the packet is dropped and counted (without taking the
+ * guard of the stream).
+ *
+ * \param[in]	ptpMeasurementData		DATA packet (it is copied)
+ * \return Nothing.
+ */
+void device_Dispatch(const tPacket_DATA * ptpMeasurementData)
+{
+	DeviceStream *	pdsStream;
+	DWORD			dwrdHead;
+
+	if(ptpMeasurementData->DeviceNr >= DEVICE_MAXDEVICES || !(m_bytDeviceMask & (1 << ptpMeasurementData->DeviceNr)))
+		return;
+
+	pdsStream = &m_dsStreams[ptpMeasurementData->DeviceNr];
+	dwrdHead = (DWORD) pdsStream->QueueHead;
+	if(dwrdHead - (DWORD) pdsStream->QueueTail == DEVICE_QUEUE_LENGTH)
+	{
+		InterlockedIncrement(&pdsStream->NPacketsDropped);
+		return;
+	}
+
+	memcpy(&pdsStream->Queue[dwrdHead & (DEVICE_QUEUE_LENGTH - 1)], ptpMeasurementData, sizeof(tPacket_DATA));
+	InterlockedExchange(&pdsStream->QueueHead, (LONG) (dwrdHead + 1));
+	SetEvent(pdsStream->hevDataReady);
+}
+
+/**
+ * \brief Retrieves the statistics of the stream of a measurement device.
+ *
+ * \param[in]	bytDeviceNr			number of the measurement device (0-7)
+ * \param[out]	pdsStatistics		receives the statistics
+ * \return TRUE if the device has an open stream, FALSE otherwise.
+ */
+BOOL device_GetStatistics(BYTE bytDeviceNr, DeviceStatistics * pdsStatistics)
+{
+	DeviceStream * pdsStream;
+
+	if(bytDeviceNr >= DEVICE_MAXDEVICES || !(m_bytDeviceMask & (1 << bytDeviceNr)))
+		return FALSE;
+
+	pdsStream = &m_dsStreams[bytDeviceNr];
+	EnterCriticalSection(&pdsStream->csGuard);
+	*pdsStatistics = pdsStream->Statistics;
+	LeaveCriticalSection(&pdsStream->csGuard);
+	pdsStatistics->NPacketsDropped = pdsStream->NPacketsDropped;
+
+	return TRUE;
+}
+
+/**
+ * \brief Retrieves the last filtered samples of the EEG signals of a measurement device.
+ *
+ * \param[in]	bytDeviceNr			number of the measurement device (0-7)
+ * \param[out]	ppdblSignals		EEGCHANNELS buffers that receive the samples, oldest first (the buffers of the channels
+ *									that are not measured are zeroed)
+ * \param[in]	uintLength			number of samples to retrieve per signal
+ * \return Number of samples stored in each buffer (at most one second of signal), 0 if the device has no open stream.
+ */
+unsigned int device_GetSignals(BYTE bytDeviceNr, double ** ppdblSignals, unsigned int uintLength)
+{
+	DeviceStream *	pdsStream;
+	unsigned int	uintStart, uintNFirst, k;
+
+	if(bytDeviceNr >= DEVICE_MAXDEVICES || !(m_bytDeviceMask & (1 << bytDeviceNr)))
+		return 0;
+
+	pdsStream = &m_dsStreams[bytDeviceNr];
+	uintLength = min(uintLength, (unsigned int) m_intSamplingFrequency);
+
+	EnterCriticalSection(&pdsStream->csGuard);
+	uintStart = (pdsStream->FilteredSignalsID + m_intSamplingFrequency - uintLength) % m_intSamplingFrequency;
+	uintNFirst = min(uintLength, m_intSamplingFrequency - uintStart);
+	for(k = 0; k < EEGCHANNELS; k++)
+	{
+		memcpy(ppdblSignals[k], pdsStream->FilteredSignals[k] + uintStart, uintNFirst*sizeof(double));
+		memcpy(ppdblSignals[k] + uintNFirst, pdsStream->FilteredSignals[k], (uintLength - uintNFirst)*sizeof(double));
+	}
+	LeaveCriticalSection(&pdsStream->csGuard);
+
+	return uintLength;
+}
@@ -0,0 +1,57 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		devices.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that records the additional WEEG measurement devices of a multi-device network.
+ *
+ * $Id$
+ */
+
+# ifndef __DEVICES_H__
+# define __DEVICES_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Includes
+//---------------------------------------------------------------------------
+# include "serialV4.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define DEVICE_MAXDEVICES				8						///< number of device numbers supported by the WEEG protocol (0-7)
+# define DEVICE_QUEUE_LENGTH			64						///< number of DATA packets that can wait in the queue of a device stream (must be a power of 2)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Statistics of the stream of one measurement device.
+ */
+typedef struct
+{
+	long	NPacketsReceived;									///< number of DATA packets processed
+	long	NPacketsLost;										///< number of DATA packets missing from the time stamp sequence
+	long	NPacketsDropped;									///< number of DATA packets that did not fit into the queue of the stream
+	int		NDataRecords;										///< number of data records stored in the device's EDF+ file
+	WORD	BatteryLevel;										///< last reported battery level, in mV
+}
+DeviceStatistics;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+BOOL			device_Open(BYTE bytDeviceMask, const TCHAR * strFilePathPrefix, RecordingIdentification riRecordingInfo, int intSamplingFrequency, BYTE bytEEGChannelMask, TCHAR * strElectrodeType,
+							unsigned int uintBaselineWindowLength);
+void			device_Close(void);
+void			device_Dispatch(const tPacket_DATA * ptpMeasurementData);
+BOOL			device_GetStatistics(BYTE bytDeviceNr, DeviceStatistics * pdsStatistics);
+unsigned int	device_GetSignals(BYTE bytDeviceNr, double ** ppdblSignals, unsigned int uintLength);
+
+# endif
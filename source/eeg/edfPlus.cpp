@@ -188,7 +188,7 @@ void edf_CorrectSpecialCharacters(TCHAR * strString, BOOL blnIsAnnotation)
 * \param	riRecordingInfo			RecordingIdentification structure containing the the information to be stored in the 'local recording identification' field
 * \param	intSamplingFrequency	frequency at which the EEG and acceleration signals are sampled, in Hz
 * \param	intNDataRecords			amount of data records in the EDF+ file
-* \param	uintNEEGChannels		amount of EEG signals
+* \param	bytEEGChannelMask		EEG channels contained in the data records (bit n = channel n, see MCHANNELMASK)
 * \param	uintNAccChannels		amount of acceleration signals
 * \param	pstrElectrodeType		pointer to null-terminated string containing the type of electrode used to measure the EEG signals
 * \param	HeaderBuffer			pointer to char buffer where header record is to be stored
@@ -197,7 +197,7 @@ void edf_CorrectSpecialCharacters(TCHAR * strString, BOOL blnIsAnnotation)
 * \return TRUE if header record was succesfully generated, FALSE otherwise.
 */
 BOOL edf_GenerateEDFplusHeaderRecord(BOOL blnSetStartDateTime, PatientIdentification piPatientInfo, RecordingIdentification riRecordingInfo,
-									 int intSamplingFrequency, int intNDataRecords, unsigned int uintNEEGChannels, unsigned int uintNAccChannels,
+									 int intSamplingFrequency, int intNDataRecords, BYTE bytEEGChannelMask, unsigned int uintNAccChannels,
 									 TCHAR * pstrElectrodeType, char * HeaderBuffer, unsigned int uintHeaderBufferLen)
 {
 	char *				strBuffer1;
@@ -206,12 +206,15 @@ BOOL edf_GenerateEDFplusHeaderRecord(BOOL blnSetStartDateTime, PatientIdentifica
 	size_t				sztBuffer1Byt;
 	size_t				stSize;
 	static struct tm	tmCurrentDateTime;
-	unsigned int		i;
+	unsigned int		i, j, k;
 	unsigned int		uintHeaderSizeByt;
+	unsigned int		uintNEEGChannels;
 	unsigned int		uintNSignals;
 
 	// variable init
 	strEmpty = "X ";
+	bytEEGChannelMask &= MCHANNELMASK;
+	uintNEEGChannels = util_GetNOfSelectedChannels(bytEEGChannelMask);
 	uintNSignals = uintNEEGChannels + uintNAccChannels + 1;				// +1 for EDF+ Annotations channel
 	if(blnSetStartDateTime)
 		tmCurrentDateTime = tmCurrentDateTime = util_GetCurrentDateTime();
@@ -399,10 +402,20 @@ BOOL edf_GenerateEDFplusHeaderRecord(BOOL blnSetStartDateTime, PatientIdentifica
 	//
 	// Parse Signal Header Fields
 	//
-	// 'label'
-	for ( i = 0; i < uintNSignals; ++i )
+	// 'label' (acceleration signals, selected EEG channels in ascending order, annotations signal)
+	for ( i = 0, j = ACCCHANNELS; i < uintNSignals; ++i )
 	{
-		edf_PadHeaderString(m_strChannelLabels[i], (int) strlen(m_strChannelLabels[i]), EDFLABELFORSIGNALLENGTH, strBuffer1);
+		if(i < uintNAccChannels)
+			k = i;
+		else if(i < (uintNSignals - 1))
+		{
+			while(!(bytEEGChannelMask & (0x01 << (j - ACCCHANNELS))))
+				j++;
+			k = j++;
+		}
+		else
+			k = ACCCHANNELS + EEGCHANNELS;
+		edf_PadHeaderString(m_strChannelLabels[k], (int) strlen(m_strChannelLabels[k]), EDFLABELFORSIGNALLENGTH, strBuffer1);
 		strncat_s(HeaderBuffer, uintHeaderBufferLen, strBuffer1, EDFLABELFORSIGNALLENGTH);
 	}
 
@@ -506,6 +519,31 @@ BOOL edf_GenerateEDFplusHeaderRecord(BOOL blnSetStartDateTime, PatientIdentifica
 	return TRUE;
 }
 
+/**
+* \brief Identifies a signal of an EDF+ file recorded by the software from its label.
+*
+* \param	strLabel		label of the signal (trailing spaces are ignored)
+*
+* \return Index of the signal in a data record with all of the channels (see m_strChannelLabels), -1 if the label is unknown.
+*/
+int edf_GetChannelIndex(const char * strLabel)
+{
+	size_t sztLabelLen;
+	int k;
+
+	sztLabelLen = strlen(strLabel);
+	while(sztLabelLen > 0 && strLabel[sztLabelLen - 1] == ' ')
+		sztLabelLen--;
+
+	for(k = 0; k <= ACCCHANNELS + EEGCHANNELS; k++)
+	{
+		if(strlen(m_strChannelLabels[k]) == sztLabelLen && strncmp(strLabel, m_strChannelLabels[k], sztLabelLen) == 0)
+			return k;
+	}
+
+	return -1;
+}
+
 /**
 * \brief Initializes the members of the provided PatientIdentification structure and/or RecordingIdentification structure.
 
@@ -174,7 +174,7 @@ void			edf_CorrectSpecialCharacters(TCHAR * strString, BOOL blnIsAnnotation);
 * \param	riRecordingInfo			RecordingIdentification structure containing the the information to be stored in the 'local recording identification' field
 * \param	intSamplingFrequency	frequency at which the EEG and acceleration signals are sampled, in Hz
 * \param	intNDataRecords			amount of data records in the EDF+ file
-* \param	uintNEEGChannels		amount of EEG signals
+* \param	bytEEGChannelMask		EEG channels contained in the data records (bit n = channel n, see MCHANNELMASK)
 * \param	uintNAccChannels		amount of acceleration signals
 * \param	pstrElectrodeType		pointer to null-terminated string containing the type of electrode used to measure the EEG signals
 * \param	HeaderBuffer			pointer to char buffer where header record is to be stored
@@ -183,9 +183,19 @@ void			edf_CorrectSpecialCharacters(TCHAR * strString, BOOL blnIsAnnotation);
 * \return TRUE if header record was succesfully generated, FALSE otherwise.
 */
 BOOL edf_GenerateEDFplusHeaderRecord(BOOL blnSetStartDateTime, PatientIdentification piPatientInfo, RecordingIdentification riRecordingInfo,
-									 int intSamplingFrequency, int intNDataRecords, unsigned int uintNEEGChannels, unsigned int uintNAccChannels,
+									 int intSamplingFrequency, int intNDataRecords, BYTE bytEEGChannelMask, unsigned int uintNAccChannels,
 									 TCHAR * pstrElectrodeType, char * HeaderBuffer, unsigned int uintHeaderBufferLen);
 
+/**
+* \brief Identifies a signal of an EDF+ file recorded by the software from its label.
+*
+* \param	strLabel		label of the signal (trailing spaces are ignored)
+*
+* \return Index of the signal in a data record with all of the channels (0 to ACCCHANNELS - 1: acceleration signals,
+* ACCCHANNELS + n: EEG channel n, ACCCHANNELS + EEGCHANNELS: annotations signal), -1 if the label is unknown.
+*/
+int				edf_GetChannelIndex(const char * strLabel);
+
 /**
 * \brief Initializes the members of the provided PatientIdentification structure and/or RecordingIdentification structure.
 *
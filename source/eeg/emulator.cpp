@@ -0,0 +1,663 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		emulator.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that emulates a WEEG coordinator and its measurement devices.
+ *
+ * The emulator is a byte transport (see transport.h): the packets that the serial module sends to it are answered the
+ * way the coordinator answers them (POLL, DEVMASK, CHMASK and PARAMS are acknowledged, STATUSQUERY, CHANNELQUERY and
+ * BEACONCMD are replied to) and, once sampling has been started with a PARAMS packet, every measurement device of the
+ * device mask streams DATA packets with the requested channel mask and sampling rate.
+ *
+ * The EEG and accelerometer signals are either synthetic (alpha rhythm, slower background activity and noise) or read
+ * from an EDF+ file (the address of the transport), which is replayed in a loop. The radio link can be impaired with
+ * packet loss, corrupted packets, latency spikes and periodic disconnections of the measurement devices (see
+ * EmulatorImpairments); the impairments are drawn from a fixed-seed pseudo-random sequence, so a run can be repeated.
+ *
+ * Packets are generated when they become due by the host's clock, so the emulator loads the acquisition pipeline exactly
+ * like the hardware does, without needing it.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+
+// custom libraries
+#include <libEDF.h>
+
+// program headers
+#include "serialV4.h"
+#include "emulator.h"
+#include "simd.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+#define EMULATOR_SEED					0x2545F491				///< seed of the pseudo-random sequence (must not be 0)
+#define EMULATOR_PI						3.14159265358979323846
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static CRITICAL_SECTION		m_csEmulatorGuard;							///< protects the state below (commands come from the link's owner, reads from the serial reader thread)
+static HANDLE				m_hevEmulatorData = NULL;					///< auto-reset event signaled when a reply has been queued
+static EmulatorImpairments	m_eiImpairments;
+
+// bytes waiting to be read
+static BYTE					m_bytQueue [EMULATOR_QUEUE_LENGTH];
+static DWORD				m_dwrdQueueHead;							///< total number of bytes queued
+static DWORD				m_dwrdQueueTail;							///< total number of bytes read
+
+// measurement
+static BYTE					m_bytDeviceMask;
+static BYTE					m_bytChannelMask;
+static unsigned int			m_uintNChannels;
+static unsigned int			m_uintChannelIDs [NCHANNELSINMASK];
+static unsigned int			m_uintNSamplesPerPacket;
+static int					m_intSamplingFrequency;
+static BOOL					m_blnStreaming;
+static LARGE_INTEGER		m_liFrequency;								///< frequency of the performance counter
+static LARGE_INTEGER		m_liStreamStart;							///< performance counter value when sampling was started
+static LONGLONG				m_llngNPacketPeriods;						///< number of packet periods that have been generated since sampling was started
+static LONGLONG				m_llngSpikeEnd;								///< time at which the current latency spike ends (us since sampling was started)
+static DWORD				m_dwrdRandom;								///< state of the pseudo-random sequence
+
+// signal source
+static EDFFileHandle *		m_hEDFFile = NULL;							///< EDF+ file whose signals are sent (NULL: synthetic signals)
+static int					m_intEDFDataRecord;							///< zero-based index of the data record in m_hEDFFile->DataRecord
+static int					m_intEDFSample;								///< index of the next sample in the data record
+static short				m_shrEEG [SAMPLES_PER_PACKET][NCHANNELSINMASK];	///< EEG samples of the current packet period
+static short				m_shrAcc [ACCCHANNELS];						///< accelerometer sample of the current packet period
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Returns the next number of the pseudo-random sequence (xorshift32).
+ *
+ * \return Pseudo-random number.
+ */
+static DWORD emulator_Random(void)
+{
+	m_dwrdRandom ^= m_dwrdRandom << 13;
+	m_dwrdRandom ^= m_dwrdRandom >> 17;
+	m_dwrdRandom ^= m_dwrdRandom << 5;
+
+	return m_dwrdRandom;
+}
+
+/**
+ * \brief Draws an event that occurs with the given rate.
+ *
+ * \param[in]	intRate		rate of the event, in parts per million
+ * \return TRUE if the event occurs, FALSE otherwise.
+ */
+static BOOL emulator_Occurs(int intRate)
+{
+	return intRate > 0 && (int) (emulator_Random() % 1000000) < intRate;
+}
+
+/**
+ * \brief Returns the time elapsed since sampling was started, in microseconds.
+ */
+static LONGLONG emulator_GetTime(void)
+{
+	LARGE_INTEGER liCounter;
+
+	QueryPerformanceCounter (&liCounter);
+
+	return (liCounter.QuadPart - m_liStreamStart.QuadPart) * 1000000 / m_liFrequency.QuadPart;
+}
+
+/**
+ * \brief Returns the time at which a packet period becomes due, in microseconds since sampling was started.
+ */
+static LONGLONG emulator_GetPeriodTime(LONGLONG llngPeriod)
+{
+	return llngPeriod * m_uintNSamplesPerPacket * 1000000 / m_intSamplingFrequency;
+}
+
+/**
+ * \brief Returns the number of bytes that can still be queued.
+ */
+static DWORD emulator_GetQueueSpace(void)
+{
+	return EMULATOR_QUEUE_LENGTH - (m_dwrdQueueHead - m_dwrdQueueTail);
+}
+
+/**
+ * \brief Queues a packet (preamble, header, payload and checksum) to be read.
+ *
+ * The caller must hold m_csEmulatorGuard and must have checked that the packet fits into the queue.
+ *
+ * \param[in]	bytPacketType	packet type
+ * \param[in]	pbytPayload		payload (may be NULL if bytDataLength is 0)
+ * \param[in]	bytDataLength	number of bytes in pbytPayload
+ * \return Nothing.
+ */
+static void emulator_QueuePacket(BYTE bytPacketType, const BYTE * pbytPayload, BYTE bytDataLength)
+{
+	BYTE bytChecksum, bytHeader [SERHDR_SIZE];
+	unsigned int i;
+
+	bytHeader[0] = bytHeader[1] = bytHeader[2] = bytHeader[3] = PREAMBLE;
+	bytHeader[4] = bytPacketType;
+	bytHeader[5] = bytDataLength;
+	bytChecksum = bytPacketType + bytDataLength;
+	if(bytDataLength > 0)
+		bytChecksum += (BYTE) simd_ByteSum(pbytPayload, bytDataLength);
+
+	for(i = 0; i < SERHDR_SIZE; i++)
+		m_bytQueue[(m_dwrdQueueHead++) & (EMULATOR_QUEUE_LENGTH - 1)] = bytHeader[i];
+	for(i = 0; i < bytDataLength; i++)
+		m_bytQueue[(m_dwrdQueueHead++) & (EMULATOR_QUEUE_LENGTH - 1)] = pbytPayload[i];
+	m_bytQueue[(m_dwrdQueueHead++) & (EMULATOR_QUEUE_LENGTH - 1)] = (BYTE) ~bytChecksum;
+}
+
+/**
+ * \brief Clips a sample so that it can never form a preamble once it has been converted to an unsigned WORD.
+ */
+static short emulator_ClipSample(int intSample)
+{
+	if(intSample > 32766)
+		return 32766;
+	if(intSample < -32768)
+		return -32768;
+
+	return (short) intSample;
+}
+
+/**
+ * \brief Fills m_shrEEG and m_shrAcc with the signals of the next packet period.
+ *
+ * \param[in]	llngFirstSample		index of the first sample of the packet period since sampling was started
+ * \return Nothing.
+ */
+static void emulator_GenerateSamples(LONGLONG llngFirstSample)
+{
+	double dblTime;
+	int intSignal;
+	unsigned int i, k;
+
+	for(i = 0; i < m_uintNSamplesPerPacket; i++)
+	{
+		if(m_hEDFFile != NULL)
+		{
+			// next sample of the EDF+ file (accelerometer signals first, then EEG signals; the file is replayed in a loop)
+			if(m_intEDFSample >= m_hEDFFile->SignalHeaders[0].NSamplesPerDataRecord)
+			{
+				m_intEDFDataRecord = (m_intEDFDataRecord + 1) % m_hEDFFile->FileHeader.NDataRecords;
+				libEDF_getDataRecord(m_hEDFFile, m_intEDFDataRecord + 1);
+				m_intEDFSample = 0;
+			}
+
+			for(k = 0; k < NCHANNELSINMASK; k++)
+			{
+				intSignal = ACCCHANNELS + k;
+				m_shrEEG[i][k] = (intSignal < m_hEDFFile->FileHeader.NSignalsPerDataRecord) ? emulator_ClipSample(m_hEDFFile->DataRecord.Data[intSignal][m_intEDFSample]) : 0;
+			}
+			if(i == 0)
+			{
+				for(k = 0; k < ACCCHANNELS; k++)
+					m_shrAcc[k] = (k < (unsigned int) m_hEDFFile->FileHeader.NSignalsPerDataRecord) ? m_hEDFFile->DataRecord.Data[k][m_intEDFSample] : 0;
+			}
+			m_intEDFSample++;
+		}
+		else
+		{
+			// synthetic signals: ~50 uV alpha rhythm, slower background activity and noise; slow head movements
+			dblTime = (double) (llngFirstSample + i) / m_intSamplingFrequency;
+			for(k = 0; k < NCHANNELSINMASK; k++)
+			{
+				m_shrEEG[i][k] = emulator_ClipSample((int) (2000*sin(2*EMULATOR_PI*10*dblTime + 0.7*k) +
+															 600*sin(2*EMULATOR_PI*3.1*dblTime + k)) +
+													 (int) (emulator_Random() % 801) - 400);
+			}
+			if(i == 0)
+			{
+				for(k = 0; k < ACCCHANNELS; k++)
+					m_shrAcc[k] = (short) (100*sin(2*EMULATOR_PI*0.2*dblTime + 2.1*k));
+			}
+		}
+	}
+}
+
+/**
+ * \brief Queues the DATA packets of all of the measurement devices that have become due.
+ *
+ * The caller must hold m_csEmulatorGuard. Generation pauses during a latency spike and while the queue is full; the
+ * packets that become due meanwhile are sent in a burst afterwards.
+ *
+ * \return Nothing.
+ */
+static void emulator_Generate(void)
+{
+	tPacket_DATA tpdPacket;
+	BYTE bytDataLength, bytDevice;
+	DWORD dwrdDisconnectPeriod;
+	LONGLONG llngNow, llngPeriodTime;
+	unsigned int i, k, uintNDevices;
+
+	if(!m_blnStreaming)
+		return;
+
+	llngNow = emulator_GetTime();
+	if(llngNow < m_llngSpikeEnd)
+		return;
+
+	bytDataLength = (BYTE) (offsetof(tPacket_DATA, Measurements) + m_uintNSamplesPerPacket*m_uintNChannels*sizeof(WORD));
+	for(uintNDevices = 0, bytDevice = 0; bytDevice < 8; bytDevice++)
+		uintNDevices += (m_bytDeviceMask >> bytDevice) & 0x01;
+
+	while((llngPeriodTime = emulator_GetPeriodTime(m_llngNPacketPeriods)) <= llngNow &&
+		  emulator_GetQueueSpace() >= uintNDevices*(SERHDR_SIZE + bytDataLength + 1))
+	{
+		emulator_GenerateSamples(m_llngNPacketPeriods*m_uintNSamplesPerPacket);
+
+		// the measurement devices are periodically out of reach
+		dwrdDisconnectPeriod = m_eiImpairments.DisconnectInterval + m_eiImpairments.DisconnectLength;
+		if(m_eiImpairments.DisconnectInterval <= 0 || m_eiImpairments.DisconnectLength <= 0 ||
+		   (DWORD) ((llngPeriodTime/1000000) % dwrdDisconnectPeriod) < (DWORD) m_eiImpairments.DisconnectInterval)
+		{
+			SecureZeroMemory(&tpdPacket, sizeof(tpdPacket));
+			tpdPacket.ChannelMask = m_bytChannelMask;
+			tpdPacket.TimeStamp = (DWORD) (m_llngNPacketPeriods*m_uintNSamplesPerPacket);
+			tpdPacket.BatteryLevel = (WORD) (EMULATOR_BATTERY_START - llngPeriodTime/(EMULATOR_BATTERY_DRAIN*1000000LL));
+			for(k = 0; k < ACCCHANNELS; k++)
+				tpdPacket.Accelerometers[k] = CAST_10b_S2US(m_shrAcc[k]);
+			for(i = 0; i < m_uintNSamplesPerPacket; i++)
+			{
+				for(k = 0; k < m_uintNChannels; k++)
+					tpdPacket.Measurements[i*m_uintNChannels + k] = CAST_16b_S2US(m_shrEEG[i][m_uintChannelIDs[k]]);
+			}
+
+			for(bytDevice = 0; bytDevice < 8; bytDevice++)
+			{
+				if(!(m_bytDeviceMask & (1 << bytDevice)) || emulator_Occurs(m_eiImpairments.PacketLossRate))
+					continue;
+
+				tpdPacket.DeviceNr = bytDevice;
+				emulator_QueuePacket(SER_DATA, (BYTE *) &tpdPacket, bytDataLength);
+
+				// corrupt one of the bytes following the packet type (the packet then fails its checksum)
+				if(emulator_Occurs(m_eiImpairments.CorruptionRate))
+					m_bytQueue[(m_dwrdQueueHead - 1 - emulator_Random() % (bytDataLength + 2)) & (EMULATOR_QUEUE_LENGTH - 1)] ^= (BYTE) (1 << (emulator_Random() % 8));
+			}
+		}
+		m_llngNPacketPeriods++;
+
+		// latency spike: the coordinator stalls
+		if(emulator_Occurs(m_eiImpairments.SpikeRate))
+		{
+			m_llngSpikeEnd = llngNow + m_eiImpairments.SpikeLength*1000LL;
+			break;
+		}
+	}
+}
+
+/**
+ * \brief Handles a packet received by the emulated coordinator and queues its reply.
+ *
+ * The caller must hold m_csEmulatorGuard.
+ *
+ * \param[in]	bytPacketType	packet type
+ * \param[in]	pbytPayload		payload
+ * \param[in]	bytDataLength	number of bytes in pbytPayload
+ * \return Nothing.
+ */
+static void emulator_HandlePacket(BYTE bytPacketType, const BYTE * pbytPayload, BYTE bytDataLength)
+{
+	BYTE bytChannel, bytChannelMask;
+	tPacket_PARAMS tppParameters;
+	unsigned int k, uintNChannels;
+
+	if(emulator_GetQueueSpace() < 2*(SERHDR_SIZE + 255 + 1))
+		return;
+
+	switch(bytPacketType)
+	{
+		case SER_POLL:
+		case SER_CHMASK:
+			emulator_QueuePacket(SER_ACK, NULL, 0);
+		break;
+
+		case SER_DEVMASK:
+			if(bytDataLength < sizeof(tPacket_DEVMASK))
+			{
+				emulator_QueuePacket(SER_NACK, NULL, 0);
+				break;
+			}
+			m_bytDeviceMask = ((const tPacket_DEVMASK *) pbytPayload)->DeviceMask;
+			emulator_QueuePacket(SER_ACK, NULL, 0);
+		break;
+
+		case SER_PARAMS:
+			if(bytDataLength < sizeof(tPacket_PARAMS))
+			{
+				emulator_QueuePacket(SER_NACK, NULL, 0);
+				break;
+			}
+			memcpy(&tppParameters, pbytPayload, sizeof(tppParameters));
+
+			// a zero channel mask or sampling rate stops the measurement
+			if(tppParameters.ChannelMask == 0 || tppParameters.SampleRate == 0)
+			{
+				m_blnStreaming = FALSE;
+				emulator_QueuePacket(SER_ACK, NULL, 0);
+				break;
+			}
+
+			// the devices' throughput is limited
+			bytChannelMask = tppParameters.ChannelMask;
+			for(uintNChannels = 0, k = 0; k < NCHANNELSINMASK; k++)
+				uintNChannels += (bytChannelMask >> k) & 0x01;
+			if(tppParameters.SampleRate < MIN_SAMPLERATE || tppParameters.SampleRate > MAX_SAMPLERATE ||
+			   uintNChannels*tppParameters.SampleRate > MAXNMEASUREMENTS)
+			{
+				emulator_QueuePacket(SER_NACK, NULL, 0);
+				break;
+			}
+
+			m_bytChannelMask = bytChannelMask;
+			for(m_uintNChannels = 0, k = 0; k < NCHANNELSINMASK; k++)
+			{
+				if(bytChannelMask & (1 << k))
+					m_uintChannelIDs[m_uintNChannels++] = k;
+			}
+			m_uintNSamplesPerPacket = SAMPLES_PER_PACKET/m_uintNChannels;
+			m_intSamplingFrequency = tppParameters.SampleRate;
+			m_llngNPacketPeriods = 0;
+			m_llngSpikeEnd = 0;
+			QueryPerformanceCounter(&m_liStreamStart);
+			m_blnStreaming = TRUE;
+			emulator_QueuePacket(SER_ACK, NULL, 0);
+		break;
+
+		case SER_STATUSQRY:
+			// status: mask of the measurement devices in the network
+			emulator_QueuePacket(SER_STATUSRPL, &m_bytDeviceMask, 1);
+		break;
+
+		case SER_CHANQRY:
+			bytChannel = EMULATOR_RADIOCHANNEL;
+			emulator_QueuePacket(SER_CHANRPL, &bytChannel, 1);
+		break;
+
+		case SER_BEACONCMD:
+			// the measurement devices echo the free-format command
+			emulator_QueuePacket(SER_BEACONRPL, pbytPayload, bytDataLength);
+		break;
+
+		default:
+			emulator_QueuePacket(SER_NACK, NULL, 0);
+	}
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Closes the emulated coordinator.
+ *
+ * \return Nothing.
+ */
+void emulator_Close(void)
+{
+	if(m_hevEmulatorData == NULL)
+		return;
+
+	m_blnStreaming = FALSE;
+	DeleteCriticalSection(&m_csEmulatorGuard);
+	CloseHandle(m_hevEmulatorData);
+	m_hevEmulatorData = NULL;
+
+	if(m_hEDFFile != NULL)
+	{
+		libEDF_closeFile(m_hEDFFile);
+		m_hEDFFile = NULL;
+	}
+}
+
+/**
+ * \brief Opens the emulated coordinator.
+ *
+ * \param[in]	strAddress		path of the EDF+ file whose signals are sent, or an empty string for synthetic signals
+ * \return ERROR_SUCCESS if successful, otherwise a Win32 error code.
+ */
+DWORD emulator_Open(const TCHAR * strAddress)
+{
+	char strEDFFile [MAX_PATH + 1];
+	size_t sztLength;
+
+	// signal source
+	if(strAddress != NULL && strAddress[0] != TEXT('\0'))
+	{
+#ifdef _UNICODE
+		if(wcstombs_s(&sztLength, strEDFFile, sizeof(strEDFFile), strAddress, _TRUNCATE) != 0)
+			return ERROR_INVALID_PARAMETER;
+#else
+		strcpy_s(strEDFFile, sizeof(strEDFFile), strAddress);
+#endif
+		m_hEDFFile = libEDF_openFile(strEDFFile);
+		if(m_hEDFFile == NULL)
+			return ERROR_FILE_NOT_FOUND;
+		if(m_hEDFFile->FileHeader.NSignalsPerDataRecord <= 0 || m_hEDFFile->FileHeader.NDataRecords <= 0 ||
+		   libEDF_getDataRecord(m_hEDFFile, 1) != LEDF_OK)
+		{
+			libEDF_closeFile(m_hEDFFile);
+			m_hEDFFile = NULL;
+			return ERROR_INVALID_DATA;
+		}
+		m_intEDFDataRecord = 0;
+		m_intEDFSample = 0;
+	}
+
+	m_hevEmulatorData = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if(m_hevEmulatorData == NULL)
+	{
+		if(m_hEDFFile != NULL)
+		{
+			libEDF_closeFile(m_hEDFFile);
+			m_hEDFFile = NULL;
+		}
+		return GetLastError();
+	}
+	InitializeCriticalSection(&m_csEmulatorGuard);
+
+	m_dwrdQueueHead = m_dwrdQueueTail = 0;
+	m_bytDeviceMask = WEEG_DEVICENR;
+	m_blnStreaming = FALSE;
+	m_dwrdRandom = EMULATOR_SEED;
+	QueryPerformanceFrequency(&m_liFrequency);
+
+	return ERROR_SUCCESS;
+}
+
+/**
+ * \brief Discards the bytes that have not been read yet.
+ *
+ * \return TRUE.
+ */
+BOOL emulator_Purge(void)
+{
+	EnterCriticalSection(&m_csEmulatorGuard);
+	m_dwrdQueueTail = m_dwrdQueueHead;
+	LeaveCriticalSection(&m_csEmulatorGuard);
+
+	return TRUE;
+}
+
+/**
+ * \brief Reads the replies and the DATA packets that the emulated coordinator has sent by now.
+ *
+ * \param[out]	pbytBuffer		buffer where the data is to be stored
+ * \param[in]	dwrdLength		size of pbytBuffer, in bytes
+ * \return Number of bytes read.
+ */
+DWORD emulator_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	DWORD dwrdNBytes, dwrdOffset, dwrdPart;
+
+	EnterCriticalSection(&m_csEmulatorGuard);
+
+	emulator_Generate();
+
+	dwrdNBytes = m_dwrdQueueHead - m_dwrdQueueTail;
+	if(dwrdNBytes > dwrdLength)
+		dwrdNBytes = dwrdLength;
+
+	// the queued bytes may wrap around the end of the queue
+	dwrdOffset = m_dwrdQueueTail & (EMULATOR_QUEUE_LENGTH - 1);
+	dwrdPart = EMULATOR_QUEUE_LENGTH - dwrdOffset;
+	if(dwrdPart > dwrdNBytes)
+		dwrdPart = dwrdNBytes;
+	memcpy(pbytBuffer, m_bytQueue + dwrdOffset, dwrdPart);
+	memcpy(pbytBuffer + dwrdPart, m_bytQueue, dwrdNBytes - dwrdPart);
+	m_dwrdQueueTail += dwrdNBytes;
+
+	LeaveCriticalSection(&m_csEmulatorGuard);
+
+	return dwrdNBytes;
+}
+
+/**
+ * \brief Sets the impairments of the emulated radio link.
+ *
+ * May be called at any time; the new impairments apply to the packets generated from then on.
+ *
+ * \param[in]	peiImpairments		impairments
+ * \return Nothing.
+ */
+void emulator_SetImpairments(const EmulatorImpairments * peiImpairments)
+{
+	m_eiImpairments = *peiImpairments;
+}
+
+/**
+ * \brief Blocks until a reply has been queued or the next DATA packet becomes due.
+ *
+ * \param[in]	hevStop			event that stops the wait
+ * \param[in]	dwrdTimeout		maximum wait time, in milliseconds
+ * \return WAIT_OBJECT_0 if data may be available, WAIT_OBJECT_0 + 1 if hevStop was signaled or WAIT_TIMEOUT.
+ */
+DWORD emulator_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	BOOL blnPacketDue;
+	DWORD dwrdWaitResult, dwrdWaitTime;
+	HANDLE hEvents [2];
+	LONGLONG llngWaitTime;
+
+	// time until the next packet becomes due
+	EnterCriticalSection(&m_csEmulatorGuard);
+	if(m_dwrdQueueHead != m_dwrdQueueTail)
+	{
+		LeaveCriticalSection(&m_csEmulatorGuard);
+		return WAIT_OBJECT_0;
+	}
+
+	blnPacketDue = FALSE;
+	dwrdWaitTime = dwrdTimeout;
+	if(m_blnStreaming)
+	{
+		llngWaitTime = emulator_GetPeriodTime(m_llngNPacketPeriods);
+		if(llngWaitTime < m_llngSpikeEnd)
+			llngWaitTime = m_llngSpikeEnd;
+		llngWaitTime = (llngWaitTime - emulator_GetTime() + 999)/1000;
+		if(llngWaitTime < dwrdTimeout)
+		{
+			dwrdWaitTime = (llngWaitTime > 0) ? (DWORD) llngWaitTime : 0;
+			blnPacketDue = TRUE;
+		}
+	}
+	LeaveCriticalSection(&m_csEmulatorGuard);
+
+	hEvents[0] = m_hevEmulatorData;
+	hEvents[1] = hevStop;
+	dwrdWaitResult = WaitForMultipleObjects(2, hEvents, FALSE, dwrdWaitTime);
+	if(dwrdWaitResult == WAIT_TIMEOUT && blnPacketDue)
+		dwrdWaitResult = WAIT_OBJECT_0;
+	else if(dwrdWaitResult != WAIT_OBJECT_0 && dwrdWaitResult != WAIT_OBJECT_0 + 1)
+		dwrdWaitResult = WAIT_TIMEOUT;
+
+	return dwrdWaitResult;
+}
+
+/**
+ * \brief Sends data to the emulated coordinator.
+ *
+ * The data is scanned for packets, which are answered immediately; packets with a wrong checksum are answered with a
+ * NACK, incomplete packets are ignored (serial_SendPacket() always sends whole packets).
+ *
+ * \param[in]	pBuffer			data
+ * \param[in]	dwrdLength		number of bytes in pBuffer
+ * \return TRUE.
+ */
+BOOL emulator_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	BYTE bytChecksum, bytDataLength;
+	const BYTE * pbytData;
+	DWORD dwrdPosition;
+
+	pbytData = (const BYTE *) pBuffer;
+
+	EnterCriticalSection(&m_csEmulatorGuard);
+
+	dwrdPosition = 0;
+	while(dwrdPosition + SERHDR_SIZE + 1 <= dwrdLength)
+	{
+		// find preamble
+		if(pbytData[dwrdPosition] != PREAMBLE || pbytData[dwrdPosition + 1] != PREAMBLE ||
+		   pbytData[dwrdPosition + 2] != PREAMBLE || pbytData[dwrdPosition + 3] != PREAMBLE)
+		{
+			dwrdPosition++;
+			continue;
+		}
+
+		bytDataLength = pbytData[dwrdPosition + SERHDR_SIZE - 1];
+		if(dwrdPosition + SERHDR_SIZE + bytDataLength + 1 > dwrdLength)
+			break;
+
+		bytChecksum = (BYTE) simd_ByteSum(pbytData + dwrdPosition + 4, SERHDR_SIZE - 4 + bytDataLength);
+
+		if((BYTE) ~bytChecksum == pbytData[dwrdPosition + SERHDR_SIZE + bytDataLength])
+			emulator_HandlePacket(pbytData[dwrdPosition + 4], pbytData + dwrdPosition + SERHDR_SIZE, bytDataLength);
+		else if(emulator_GetQueueSpace() >= SERHDR_SIZE + 1)
+			emulator_QueuePacket(SER_NACK, NULL, 0);
+
+		dwrdPosition += SERHDR_SIZE + bytDataLength + 1;
+	}
+
+	LeaveCriticalSection(&m_csEmulatorGuard);
+
+	SetEvent(m_hevEmulatorData);
+
+	return TRUE;
+}
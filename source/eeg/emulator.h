@@ -0,0 +1,57 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		emulator.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that emulates a WEEG coordinator and its measurement devices.
+ *
+ * $Id$
+ */
+
+# ifndef __EMULATOR_H__
+# define __EMULATOR_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define EMULATOR_QUEUE_LENGTH			65536					///< number of bytes that can wait to be read from the emulated coordinator (must be a power of 2)
+# define EMULATOR_RADIOCHANNEL			15						///< radio channel reported in CHANNELREPLY packets
+# define EMULATOR_BATTERY_START			4100					///< battery level of the emulated devices at the start of a measurement (mV)
+# define EMULATOR_BATTERY_DRAIN			60						///< time in which the battery level of the emulated devices drops by 1 mV (s)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Impairments of the emulated radio link. Rates are given in parts per million of the DATA packets; each measurement
+ * device is impaired independently, except for latency spikes, which delay the whole coordinator.
+ */
+typedef struct
+{
+	int		PacketLossRate;										///< DATA packets that are not sent (ppm)
+	int		CorruptionRate;										///< DATA packets sent with a corrupted byte, i.e., a checksum error (ppm)
+	int		SpikeRate;											///< DATA packets after which the coordinator stalls (ppm)
+	int		SpikeLength;										///< duration of a stall (ms); the packets that became due meanwhile are sent in a burst afterwards
+	int		DisconnectInterval;									///< time between two disconnections of the measurement devices (s, 0 = never disconnected)
+	int		DisconnectLength;									///< duration of a disconnection (s); the packets that became due meanwhile are lost
+}
+EmulatorImpairments;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+void	emulator_Close(void);
+DWORD	emulator_Open(const TCHAR * strAddress);
+BOOL	emulator_Purge(void);
+DWORD	emulator_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+void	emulator_SetImpairments(const EmulatorImpairments * peiImpairments);
+DWORD	emulator_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+BOOL	emulator_Write(const void * pBuffer, DWORD dwrdLength);
+
+# endif
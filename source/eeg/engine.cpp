@@ -0,0 +1,1058 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		engine.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Acquisition engine: runs the recordings of the sample, storage and streaming threads for the program that
+ *				hosts them.
+ *
+ * The acquisition threads of a WEEG system and the state of its current recording form a session. The host creates the
+ * session with engine_CreateSession(), checks the WEEG system with engine_CheckWEEGSystem(), starts and stops recordings
+ * with engine_StartRecording() and engine_StopRecording(), and destroys the session with engine_DestroySession(); the
+ * EDF+ file is stored and streamed without any window.
+ *
+ * Only one session can exist per process: the session groups the state of the engine and of the storage and streaming
+ * threads, but the WEEG link, the sample ring, the annotation queue, the record pool, the analyses of the sample thread,
+ * the device streams and the event handler are still shared by the whole process.
+ *
+ * The engine is part of the Win32 build only (the application and the command-line recorder): unlike the WEEG link, the
+ * acquisition threads have no POSIX build.
+ *
+ * The sample, storage and streaming threads do not know about the host either: they report stop requests, errors,
+ * annotations and status changes as events, which are passed to the handler installed by the host. The GUI translates
+ * them into window messages and message boxes; a host without a window (e.g. the command-line recorder) can print them
+ * or ignore them. When no handler is installed, the events are dropped (the threads log their errors themselves).
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+#include <shlwapi.h>
+
+// CRT libraries
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <tchar.h>
+#include <time.h>
+
+// custom libraries
+#include <eegem_beep.h>
+#include <libEDF.h>
+
+// program headers
+#include "globals.h"
+#include "annotqueue.h"
+#include "applog.h"
+#include "coherence.h"
+#include "edfPlus.h"
+#include "emulator.h"
+#include "engine.h"
+#include "erp.h"
+#include "latency.h"
+#include "recpool.h"
+#include "samplering.h"
+#include "serialV4.h"
+#include "simd.h"
+#include "thread_storage.h"
+#include "thread_stream.h"
+#include "thread_sample.h"
+#include "util.h"
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * State of an engine session: the acquisition threads of one WEEG system and the state of its current recording.
+ */
+struct _EngineSession
+{
+	CONFIGURATION *				pcfg;								///< configuration of the host
+	BOOL						DisplaySamples;						///< TRUE if the host displays the samples (i.e., reads them from the sample ring)
+
+	// sample thread
+	HANDLE						hSampleThread;						///< handle to Sampling thread
+	SampleThreadData			std;
+	SimulationModeData			smd;
+	int							NSimulationDataRecords;				///< number of data records in the EDF+ file replayed in the Simulation mode
+
+	// storage thread
+	HANDLE						hStorageThread;						///< handle to Storage thread
+	StorageThreadData			sttd;
+
+	// streaming thread
+	HANDLE						hStreamingThread;					///< handle to Streaming thread
+	StreamingClientThreadData	sctd;
+
+	// current recording
+	PatientIdentification *		pPatientInfo;						///< patient identification stored in the EDF+ header record
+	RecordingIdentification *	pRecordingInfo;						///< recording identification stored in the EDF+ header record
+	void *						pEDFPlusHeaderBuffer;				///< pointer to buffer where complete EDF+ header record is stored
+	unsigned short				EDFPlusHeaderBufferLenByt;			///< size of the \a pEDFPlusHeaderBuffer, in bytes
+	TCHAR						strFinalEDFFilePath[MAX_PATH + 1];	///< path where final EDF+ file will be stored
+	TCHAR						strTempEDFFilePath[MAX_PATH + 1];	///< path where temporary EDF+ file will be stored
+	struct tm					tmRecordingStartDateTime;			///< date & time at which the recording of the temporary EDF+ file was started (used when generating the file name of the final EDF+ file)
+};
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static EngineEventHandler			m_pfnEventHandler;					///< handler installed by the host (NULL = events are dropped)
+static void *						m_pEventHandlerContext;
+static volatile LONG				m_lngNSessions;						///< number of sessions that exist (see engine_CreateSession())
+
+//---------------------------------------------------------------------------
+//							Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+* \brief Generates the full path of the final EDF+ file.
+*
+* \param[in]	StartDateTime				date and time at which the recording of the temporary EDF+ file was started
+* \param[in]	strTempEDFFilePath			pointer to NULL-terminated string containing the full path of the temporary EDF+ file
+* \param[out]	strFinalEDFFilePath			pointer to NULL-terminated string where full path of the final EDF+ file is returned
+* \param[in]	uintFinalEDFFilePathLen		size of strFinalEDFFilePath string, in characters
+*/
+static void engine_GenerateFinalEDFFilePath(struct tm StartDateTime, TCHAR * strTempEDFFilePath, TCHAR * strFinalEDFFilePath, unsigned int uintFinalEDFFilePathLen)
+{
+	size_t				sztLength;
+	TCHAR				strBuffer[256];
+	TCHAR				strTemp[MAX_PATH + 1];
+	unsigned int		i;
+
+	// parse long folder path where EDF+ file will be stored
+	sztLength = _tcslen(strTempEDFFilePath) + 1;				// +1 for terminating NULL character
+	_stprintf_s(strTemp, sztLength, TEXT("%s"), strTempEDFFilePath);
+	PathRemoveFileSpec(strTemp);
+	PathAddBackslash(strTemp);
+
+	// parse EDF+ file name
+	_stprintf_s(strBuffer,
+				sizeof(strBuffer)/sizeof(WORD),
+				TEXT("%4d.%02d.%02d %02d-%02d"),
+				StartDateTime.tm_year+1900, StartDateTime.tm_mon+1, StartDateTime.tm_mday, StartDateTime.tm_hour, StartDateTime.tm_min);
+	
+	// Parse EDF+ file path; algorithm loops until the parsed filename is not found to be in use
+	i = 0;
+	_stprintf_s(strFinalEDFFilePath,
+				uintFinalEDFFilePathLen,
+				TEXT("%s%s.edf"),
+				strTemp, strBuffer);
+	while(PathFileExists(strFinalEDFFilePath))
+	{
+		_stprintf_s(strFinalEDFFilePath,
+					uintFinalEDFFilePathLen,
+					TEXT("%s%s (%02d).edf"),
+					strTemp, strBuffer, ++i);
+	};
+}
+
+/**
+* \brief Derives the EEG channels replayed in the Simulation mode from the signal labels of the EDF+ file.
+*
+* The file must have the layout of the files recorded by the software: the acceleration signals, the recorded EEG channels
+* in ascending order and, optionally, the annotations signal, all of them (except the annotations) sampled at the same rate.
+*
+* \param[in]	phEDFFile				EDF+ file to be replayed
+* \param[out]	pbytEEGChannelMask		receives the EEG channels stored in the file (bit n = channel n)
+*
+* \return TRUE if the file has the expected layout, FALSE otherwise.
+*/
+static BOOL engine_GetSimulationChannelMask(EDFFileHandle * phEDFFile, BYTE * pbytEEGChannelMask)
+{
+	int intChannel, intLastChannel, i;
+
+	*pbytEEGChannelMask = 0;
+	intLastChannel = -1;
+	for(i = 0; i < phEDFFile->FileHeader.NSignalsPerDataRecord; i++)
+	{
+		intChannel = edf_GetChannelIndex(phEDFFile->SignalHeaders[i].Label);
+
+		// the annotations signal can only be the last one
+		if(intChannel == ACCCHANNELS + EEGCHANNELS && i == phEDFFile->FileHeader.NSignalsPerDataRecord - 1 && i > ACCCHANNELS)
+			break;
+
+		// acceleration signals first, then EEG channels in ascending order
+		if(intChannel <= intLastChannel || intChannel >= ACCCHANNELS + EEGCHANNELS || (i < ACCCHANNELS) != (intChannel < ACCCHANNELS) ||
+		   phEDFFile->SignalHeaders[i].NSamplesPerDataRecord != phEDFFile->SignalHeaders[0].NSamplesPerDataRecord)
+		{
+			return FALSE;
+		}
+		if(intChannel >= ACCCHANNELS)
+			*pbytEEGChannelMask |= (BYTE) (0x01 << (intChannel - ACCCHANNELS));
+		intLastChannel = intChannel;
+	}
+
+	return (*pbytEEGChannelMask != 0);
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Tests whether the WEEG system is ready for recording.
+ *
+ * The test is run by the sample thread with the EEG channels selected in the configuration; it must not be run during a
+ * recording.
+ *
+ * \param[in]	pes		session
+ * \return A member of the WEEGSystemCheckCode enum (WEEGSystem_OK if the system is ready for recording).
+ */
+WEEGSystemCheckCode engine_CheckWEEGSystem(EngineSession * pes)
+{
+	Sample_SetEEGChannelMask(&pes->std, pes->pcfg->DisplayChannelMask);
+
+	// turn on testing and wait for completion
+	pes->std.Mode = SampleThreadMode_WEEGSystemCheck;
+	SignalObjectAndWait(pes->std.hevSampleThread_Start, pes->std.hevSampleThread_Idle, INFINITE, FALSE);
+
+	return pes->std.CheckCode;
+}
+
+/**
+ * \brief Creates a session: selects the transport of the WEEG link and creates the sample, storage and streaming threads
+ * of the session.
+ *
+ * The application log must have been initialized and the event handler installed (see engine_SetEventHandler()). Only
+ * one session can exist at a time, since the serial port, the sample ring, the annotation queue, the record pool and the
+ * analyses of the sample thread are still shared by the whole process.
+ *
+ * \param[in]	pcfg				pointer to the configuration of the session (must remain valid until the session is
+ *									destroyed; the engine updates the sampling frequency in the Simulation mode and
+ *									disables streaming when the streaming thread fails)
+ * \param[in]	blnDisplaySamples	TRUE if the host displays the samples, i.e., reads them from the sample ring during the
+ *									recordings
+ *
+ * \return Pointer to the session if all of its threads were created, NULL otherwise.
+ */
+EngineSession * engine_CreateSession(CONFIGURATION * pcfg, BOOL blnDisplaySamples)
+{
+	BOOL					blnSuccess = TRUE;
+	DWORD					ThreadId;
+	EmulatorImpairments		eiEmulatorImpairments;
+	EngineSession *			pes;
+
+	if(InterlockedIncrement(&m_lngNSessions) > 1)
+	{
+		InterlockedDecrement(&m_lngNSessions);
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): Only one session can exist at a time."), 0, TRUE);
+		return NULL;
+	}
+
+	pes = (EngineSession *) calloc(1, sizeof(EngineSession));
+	if(pes == NULL)
+	{
+		InterlockedDecrement(&m_lngNSessions);
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): Failed to allocate memory for the EngineSession structure. (errno #)"), errno, TRUE);
+		engine_ReportError(MB_ICONERROR, TEXT("engine_CreateSession(): Failed to allocate memory for the EngineSession structure. (errno #%d)\nPlease restart the software!"), errno);
+		return NULL;
+	}
+
+	pes->pcfg = pcfg;
+	pes->DisplaySamples = blnDisplaySamples;
+
+	// select the numeric kernels that match the processor
+	simd_init();
+
+	// select the transport over which the WEEG link is run
+	serial_SetTransport((TransportType) pcfg->Link_Transport, pcfg->Link_Address, pcfg->Link_ReplayRealTime);
+	eiEmulatorImpairments.PacketLossRate = pcfg->Emulator_PacketLossRate;
+	eiEmulatorImpairments.CorruptionRate = pcfg->Emulator_CorruptionRate;
+	eiEmulatorImpairments.SpikeRate = pcfg->Emulator_SpikeRate;
+	eiEmulatorImpairments.SpikeLength = pcfg->Emulator_SpikeLength;
+	eiEmulatorImpairments.DisconnectInterval = pcfg->Emulator_DisconnectInterval;
+	eiEmulatorImpairments.DisconnectLength = pcfg->Emulator_DisconnectLength;
+	emulator_SetImpairments(&eiEmulatorImpairments);
+
+	// latency probes (can also be switched in the link statistics dialog)
+	latency_Enable(pcfg->LatencyProbes);
+
+	//
+	// create sample thread and associated synchronization events
+	//
+	// initialize data structure that will be passed to the thread
+	pes->std.pSamplingFrequency = &pcfg->SamplingFrequency;
+	pes->std.pcfg = pcfg;
+	pes->std.DisplaySamples = blnDisplaySamples;
+	pes->std.CheckCode = WEEGSystem_INVALID;
+	pes->std.hevSampleThread_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->std.hevSampleThread_Idle = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->std.hevSampleThread_Init = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->std.hevCoordinatorArrival = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	// Create sample thread and set its priority
+	pes->hSampleThread = CreateThread (NULL,										// handle cannot be inherited by child processes
+									4096,										// initial size of the stack, in bytes
+									(LPTHREAD_START_ROUTINE) Sample_Thread,		// pointer to the function to be executed by the thread
+									&pes->std,									// pointer to a variable to be passed to the thread
+									0,											// thread runs immediately after creation
+									&ThreadId);									// variable where thread identifier is stored
+	if (pes->hSampleThread == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): Failed to create sample thread. (GetLastError #)"), GetLastError(), TRUE);
+		engine_ReportError(MB_ICONERROR, TEXT("engine_CreateSession(): Failed to create sample thread. (GetLastError #: %d)\nPlease restart the software!"), GetLastError());
+		blnSuccess = FALSE;
+	}
+	else
+	{
+		// set sample thread priority
+		SetThreadPriority (pes->hSampleThread, THREAD_PRIORITY_TIME_CRITICAL);
+
+		// ensure sample is in Idle state
+		WaitForSingleObject(pes->std.hevSampleThread_Idle, INFINITE);
+	}
+
+	//
+	// create storage thread and associated synchronization events
+	//
+	// create Storage thread events
+	pes->sttd.hevStorageThread_Idling = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sttd.hevStorageThread_Init_End = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sttd.hevStorageThread_Init_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sttd.hevStorageThread_Write = pes->std.hevStorageThread_Write = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sttd.StopStorage = FALSE;
+	pes->sttd.pcfg = pcfg;
+	pes->sttd.pSession = pes->std.pStorageSession = Storage_CreateSession();
+	if(pes->sttd.pSession == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): Failed to create storage session."), 0, TRUE);
+		engine_ReportError(MB_ICONERROR, TEXT("engine_CreateSession(): Failed to create storage session.\nPlease restart the software!"));
+		blnSuccess = FALSE;
+	}
+	else
+	{
+		// Create storage thread and set its priority
+		pes->hStorageThread = CreateThread (NULL,										// handle cannot be inherited by child processes
+										 4096,										// initial size of the stack, in bytes
+										 (LPTHREAD_START_ROUTINE) Storage_Thread,	// pointer to the function to be executed by the thread
+										 &pes->sttd,								// pointer to a variable to be passed to the thread
+										 0,											// thread runs immediately after creation
+										 &ThreadId);								// variable where thread identifier is stored
+		if (pes->hStorageThread == NULL)
+		{
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): Failed to create storage thread. (GetLastError #)"), GetLastError(), TRUE);
+			engine_ReportError(MB_ICONERROR, TEXT("engine_CreateSession(): Failed to create storage thread. (GetLastError #: %d)\nPlease restart the software!"), GetLastError());
+			blnSuccess = FALSE;
+		}
+		else
+		{
+			// set storage thread priority
+			SetThreadPriority (pes->hStorageThread, THREAD_PRIORITY_NORMAL);
+
+			// ensure storage thread is in Idle state
+			WaitForSingleObject(pes->sttd.hevStorageThread_Idling, INFINITE);
+		}
+	}
+
+	//
+	// create streaming thread and associated synchronization events
+	//
+	pes->sctd.ExitThread = FALSE;
+	pes->sctd.EndTransmission = FALSE;
+	pes->sctd.hevThreadInit_Complete = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.hevVortexClient_Connect_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.hevVortexClient_Connecting_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.hevVortexClient_Connecting_End = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.hevVortexClient_Exiting = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.hevVortexClient_Transmit = pes->std.hevVortexClient_Transmit = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.hevVortexClient_WaitingToConnect = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.hevVortexClient_WaitingToTransmit = CreateEvent(NULL, FALSE, FALSE, NULL);
+	pes->sctd.pMaxNSendMsgFailures = &pcfg->Streaming_MaxNSendMsgFailures;
+	pes->sctd.pMaxNWait4ReplyFailures = &pcfg->Streaming_MaxNWait4ReplyFailures;
+	pes->sctd.pServerIPv4Address_Field0 = &pcfg->Streaming_Server_IPv4_Field0;
+	pes->sctd.pServerIPv4Address_Field1 = &pcfg->Streaming_Server_IPv4_Field1;
+	pes->sctd.pServerIPv4Address_Field2 = &pcfg->Streaming_Server_IPv4_Field2;
+	pes->sctd.pServerIPv4Address_Field3 = &pcfg->Streaming_Server_IPv4_Field3;
+	pes->sctd.pServerPort = &pcfg->Streaming_Server_Port;
+
+	pes->sctd.pSession = pes->std.pStreamingSession = Streaming_CreateSession();
+	if(pes->sctd.pSession == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): Failed to create streaming session."), 0, TRUE);
+		engine_ReportError(MB_ICONERROR, TEXT("engine_CreateSession(): Failed to create streaming session.\nPlease restart the software!"));
+		blnSuccess = FALSE;
+	}
+	else
+	{
+		// create streaming thread
+		pes->hStreamingThread = CreateThread (NULL,										// pointer to a SECURITY_ATTRIBUTES structure that determines whether the returned handle can be inherited by child processes
+										   4096,										// initial size of the stack, in bytes
+										   (LPTHREAD_START_ROUTINE) Streaming_Thread,	// pointer to the application-defined function to be executed by the thread
+										   &pes->sctd,									// pointer to a variable to be passed to the thread
+										   0,											// flags that control the creation of the thread
+										   NULL);										// (optional) pointer to a variable that receives the thread identifier
+		if (pes->hStreamingThread == NULL)
+		{
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): Failed to create streaming thread. (GetLastError #)"), GetLastError(), TRUE);
+			engine_ReportError(MB_ICONERROR, TEXT("engine_CreateSession(): Failed to create streaming thread. (GetLastError #: %d)\nPlease restart the software!"), GetLastError());
+			blnSuccess = FALSE;
+		}
+		else
+		{
+			// set streaming thread priority
+			SetThreadPriority (pes->hStreamingThread, THREAD_PRIORITY_TIME_CRITICAL);
+
+			// ensure streaming thread is in Waiting2Connect state
+			WaitForSingleObject(pes->sctd.hevThreadInit_Complete, INFINITE);
+			if(WaitForSingleObject(pes->hStreamingThread, 250) == WAIT_OBJECT_0)
+			{
+				applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_CreateSession(): An error occured while creating the streaming thread."), 0, TRUE);
+				engine_ReportError(MB_ICONERROR, TEXT("engine_CreateSession(): An error occured while creating the streaming thread.\nPlease restart the software!"));
+				blnSuccess = FALSE;
+			}
+			else
+			{
+				WaitForSingleObject(pes->sctd.hevVortexClient_WaitingToConnect, INFINITE);
+			}
+		}
+	}
+
+	if(!blnSuccess)
+	{
+		engine_DestroySession(pes);
+		return NULL;
+	}
+
+	return pes;
+}
+
+/**
+ * \brief Makes the threads of a session exit and releases the session.
+ *
+ * Must not be called during a recording (see engine_StopRecording()).
+ *
+ * \param[in]	pes		session (can be NULL)
+ * \return Nothing.
+ */
+void engine_DestroySession(EngineSession * pes)
+{
+	if(pes == NULL)
+		return;
+
+	// streaming thread
+	if(pes->hStreamingThread != NULL)
+	{
+		if(WaitForSingleObject(pes->hStreamingThread, 0) == WAIT_TIMEOUT)
+		{
+			pes->sctd.ExitThread = TRUE;										// set flag that thread that should exist
+			SetEvent(pes->sctd.hevVortexClient_Connect_Start);					// make thread exit the Waiting2Connect state
+			WaitForSingleObject(pes->hStreamingThread, INFINITE);				// wait for thread to exit
+		}
+		CloseHandle (pes->hStreamingThread);
+	}
+
+	// storage thread (waits for the Init_Start event in its Idle state)
+	if(pes->hStorageThread != NULL)
+	{
+		pes->sttd.ExitThread = TRUE;
+		SetEvent(pes->sttd.hevStorageThread_Init_Start);
+		WaitForSingleObject(pes->hStorageThread, INFINITE);
+		CloseHandle (pes->hStorageThread);
+	}
+
+	// sample thread (waits for the Start event in its Idle state)
+	if(pes->hSampleThread != NULL)
+	{
+		pes->std.ExitThread = TRUE;
+		SetEvent(pes->std.hevSampleThread_Start);
+		WaitForSingleObject(pes->hSampleThread, INFINITE);
+		CloseHandle (pes->hSampleThread);
+	}
+
+	// release created events for sample thread
+	CloseHandle(pes->std.hevSampleThread_Start);
+	CloseHandle(pes->std.hevSampleThread_Idle);
+	CloseHandle(pes->std.hevSampleThread_Init);
+	CloseHandle(pes->std.hevCoordinatorArrival);
+
+	// release created events for storage thread
+	CloseHandle(pes->sttd.hevStorageThread_Idling);
+	CloseHandle(pes->sttd.hevStorageThread_Init_End);
+	CloseHandle(pes->sttd.hevStorageThread_Init_Start);
+	CloseHandle(pes->sttd.hevStorageThread_Write);
+	Storage_DestroySession(pes->sttd.pSession);
+
+	// release created events for streaming thread
+	CloseHandle(pes->sctd.hevThreadInit_Complete);
+	CloseHandle(pes->sctd.hevVortexClient_Connecting_Start);
+	CloseHandle(pes->sctd.hevVortexClient_Connecting_End);
+	CloseHandle(pes->sctd.hevVortexClient_Connect_Start);
+	CloseHandle(pes->sctd.hevVortexClient_Exiting);
+	CloseHandle(pes->sctd.hevVortexClient_Transmit);
+	CloseHandle(pes->sctd.hevVortexClient_WaitingToConnect);
+	CloseHandle(pes->sctd.hevVortexClient_WaitingToTransmit);
+	Streaming_DestroySession(pes->sctd.pSession);
+
+	free(pes);
+	InterlockedDecrement(&m_lngNSessions);
+}
+
+/**
+ * \brief Returns the EEG channels measured during the current recording.
+ *
+ * \param[in]	pes					session
+ * \param[out]	puintEEGChannelIDs	pointer to EEGCHANNELS-element array where the channel number of each EEG signal is
+ *									returned, in the order in which the signals are stored (can be NULL)
+ *
+ * \return Number of EEG signals.
+ */
+unsigned int engine_GetEEGChannels(EngineSession * pes, unsigned int * puintEEGChannelIDs)
+{
+	if(puintEEGChannelIDs != NULL)
+		memcpy(puintEEGChannelIDs, pes->std.EEGChannelIDs, sizeof(pes->std.EEGChannelIDs));
+
+	return pes->std.NEEGChannels;
+}
+
+/**
+ * \brief Returns the number of data records in the EDF+ file replayed in the Simulation mode.
+ *
+ * \param[in]	pes		session
+ * \return Number of data records (valid once the recording has been started).
+ */
+int engine_GetNSimulationDataRecords(EngineSession * pes)
+{
+	return pes->NSimulationDataRecords;
+}
+
+/**
+ * \brief Returns the status of the current recording.
+ *
+ * \param[in]	pes			session
+ * \param[out]	pesStatus	pointer to EngineStatus structure where the status is returned
+ * \return Nothing.
+ */
+void engine_GetStatus(EngineSession * pes, EngineStatus * pesStatus)
+{
+	pesStatus->NPacketsReceived = pes->std.NPacketsReceived;
+	pesStatus->NPacketChecksumErrors = pes->std.NPacketChecksumErrors;
+	pesStatus->NPacketsLost = pes->std.NPacketsLost;
+	pesStatus->NDataRecords = pes->std.NDataRecords;
+	pesStatus->TimeKeepingTAL = pes->std.TimeKeepingTAL;
+	pesStatus->BatteryLow = pes->std.BatteryLow;
+}
+
+/**
+ * \brief Queues an annotation, with the index of the sample being recorded at the time the annotation was made, for the
+ * sample thread to store.
+ *
+ * \param[in]	pes					session
+ * \param[in]	atAnnotationType	member of the AnnotationType enum indicating the type of annotation to be stored
+ * \param[in]	intAnnotationId		additional annotation-specific (depends on atAnnotationType)
+ * \return Nothing.
+ */
+void engine_InsertAnnotation(EngineSession * pes, AnnotationType atAnnotationType, int intAnnotationId)
+{
+	Sample_InsertAnnotation(&pes->std, atAnnotationType, intAnnotationId);
+}
+
+/**
+ * \brief Passes an event to the handler installed by the host.
+ *
+ * \param[in]	eeEvent		event
+ * \param[in]	wParam		event-specific parameter (see EngineEvent)
+ * \param[in]	lParam		event-specific parameter (see EngineEvent)
+ * \return Nothing.
+ */
+void engine_Notify(EngineEvent eeEvent, WPARAM wParam, LPARAM lParam)
+{
+	if(m_pfnEventHandler != NULL)
+		m_pfnEventHandler(eeEvent, wParam, lParam, m_pEventHandlerContext);
+}
+
+/**
+ * \brief Formats an error message and passes it to the handler installed by the host as an EngineEvent_Error event.
+ *
+ * \param[in]	intStyle	MessageBox icon style of the message
+ * \param[in]	strFormat	format of the message (the formatted message is truncated to ENGINE_MAXMESSAGELENGTH - 1 characters)
+ * \return Nothing.
+ */
+void engine_ReportError(int intStyle, TCHAR * strFormat, ...)
+{
+	va_list v;
+	TCHAR strMessage[ENGINE_MAXMESSAGELENGTH];
+
+	if(m_pfnEventHandler == NULL)
+		return;
+
+	va_start(v, strFormat);
+	_vsntprintf_s(strMessage, _countof(strMessage), _TRUNCATE, strFormat, v);
+	va_end(v);
+
+	m_pfnEventHandler(EngineEvent_Error, (WPARAM) intStyle, (LPARAM) strMessage, m_pEventHandlerContext);
+}
+
+/**
+ * \brief Tells the sample thread that the port of the WEEG coordinator has been removed or has (re-)appeared.
+ *
+ * \param[in]	pes			session
+ * \param[in]	blnPresent	TRUE if the port has (re-)appeared, FALSE if it has been removed
+ * \return Nothing.
+ */
+void engine_SetCoordinatorPresent(EngineSession * pes, BOOL blnPresent)
+{
+	if(blnPresent)
+		SetEvent(pes->std.hevCoordinatorArrival);
+	else
+		InterlockedExchange(&pes->std.CoordinatorRemoved, TRUE);
+}
+
+/**
+ * \brief Installs the handler of the events of the acquisition threads.
+ *
+ * Must be called before the session is created.
+ *
+ * \param[in]	pfnHandler	handler (NULL to drop the events)
+ * \param[in]	pContext	pointer that is passed to every call of the handler
+ * \return Nothing.
+ */
+void engine_SetEventHandler(EngineEventHandler pfnHandler, void * pContext)
+{
+	m_pEventHandlerContext = pContext;
+	m_pfnEventHandler = pfnHandler;
+}
+
+/**
+ * \brief Selects the EDF+ file that is replayed by the next recording in the Simulation mode.
+ *
+ * \param[in]	pes				session
+ * \param[in]	strEDFFilePath	pointer to NULL-terminated string containing the full path of the EDF+ file
+ * \return Nothing.
+ */
+void engine_SetSimulationFile(EngineSession * pes, char * strEDFFilePath)
+{
+	strcpy_s(pes->smd.strSimulationEDFFile, sizeof(pes->smd.strSimulationEDFFile), strEDFFilePath);
+}
+
+/**
+ * \brief Starts a recording: the EDF+ header record is stored in the temporary EDF+ file and sent to the streaming server
+ * (if enabled), and the sample thread starts recording (or replaying the simulation file, in the Simulation mode).
+ *
+ * The WEEG system should have been checked with engine_CheckWEEGSystem() first. The recording must be ended with
+ * engine_StopRecording() even if this function fails (with Stop_Abort), which releases whatever was set up.
+ *
+ * \param[in]	pes					session
+ * \param[in]	ppiPatientInfo		pointer to the patient identification stored in the EDF+ header record
+ * \param[in]	priRecordingInfo	pointer to the recording identification stored in the EDF+ header record (must
+ *									remain valid until engine_StopRecording() returns)
+ *
+ * \return TRUE if the recording has been started, FALSE otherwise.
+ */
+BOOL engine_StartRecording(EngineSession * pes, PatientIdentification * ppiPatientInfo, RecordingIdentification * priRecordingInfo)
+{
+	EDFFileHandle *			phEDFFile;
+	RecordBuffer *			prbEDFPlusHeader;					///< copy of the EDF+ header record that is shared by the storage and streaming threads
+	size_t					sztLength;
+	BYTE					bytEEGChannelMask;
+
+	// variable initialization required for each recording
+	pes->pPatientInfo = ppiPatientInfo;
+	pes->pRecordingInfo = pes->std.pRecordingInfo = priRecordingInfo;
+	pes->std.CommunicationBlackout = pes->std.BatteryLow = pes->std.DataRecordHasGap = FALSE;
+	pes->std.NSamplesDatarecord = pes->std.NDataRecords = 0;	// Set the counter of data records in EDF+ file to zero
+	Sample_SetEEGChannelMask(&pes->std, pes->pcfg->DisplayChannelMask);
+
+	// when in Simulation mode, sampling frequency used depends on the EDF+ file that is replayed
+	if(pes->pcfg->SimulationMode)
+	{
+		// check if simulation file has been loaded
+		if(strlen(pes->smd.strSimulationEDFFile) == 0)
+		{
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): No simulation file loaded."), 0, TRUE);
+			engine_ReportError(MB_ICONERROR, TEXT("engine_StartRecording(): No simulation file loaded."));
+			return FALSE;
+		}
+
+		phEDFFile = libEDF_openFile(pes->smd.strSimulationEDFFile);
+		if(phEDFFile == NULL)
+		{
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Could not load EDF+ file."), 0, TRUE);
+			engine_ReportError(MB_ICONSTOP, TEXT("engine_StartRecording(): Could not load EDF+ file."));
+			return FALSE;
+		}
+		// the EEG channels replayed are those stored in the file, not those selected for display
+		if(!engine_GetSimulationChannelMask(phEDFFile, &bytEEGChannelMask))
+		{
+			libEDF_closeFile(phEDFFile);
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): The signals of the EDF+ file do not match those recorded by the software."), 0, TRUE);
+			engine_ReportError(MB_ICONSTOP, TEXT("engine_StartRecording(): The signals of the EDF+ file do not match those recorded by the software."));
+			return FALSE;
+		}
+		Sample_SetEEGChannelMask(&pes->std, bytEEGChannelMask);
+
+		pes->pcfg->SamplingFrequency = phEDFFile->SignalHeaders[0].NSamplesPerDataRecord;
+		pes->NSimulationDataRecords = phEDFFile->FileHeader.NDataRecords;
+
+		// close EDF file
+		libEDF_closeFile(phEDFFile);
+	}
+
+	// initialize annotations-related variables
+	pes->std.TimeKeepingTAL = 0;
+	pes->std.NNowAnnotations = 0;
+	annotqueue_Reset(pes->pcfg->SamplingFrequency);
+
+	// start the latency measurements over
+	latency_Reset();
+
+	// initialize inter-channel coherence module (not used when a single EEG channel is measured)
+	if(pes->std.NEEGChannels > 1 && !coh_init(pes->std.NEEGChannels, pes->pcfg->SamplingFrequency))
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Failed to initialize coherence module."), 0, TRUE);
+		return FALSE;
+	}
+
+	// initialize event-related potential module
+	if(!erp_init(pes->std.NEEGChannels, pes->pcfg->SamplingFrequency, pes->pcfg->ERP_PreTriggerTime, pes->pcfg->ERP_PostTriggerTime))
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Failed to initialize event-related potential module."), 0, TRUE);
+		return FALSE;
+	}
+
+	// mark start of recording in application log & log start of recording
+	applog_startgrouping(TEXT("Recording"), TRUE);
+	applog_logevent(General, TEXT("Engine"), TEXT("Recording Started"), 0, TRUE);
+
+	// although the display shouldn't fall behind by more than about 100-150 samples
+	// the number of samples waiting to be displayed spikes sometimes when the system
+	// is busy with other high-priority tasks (was 400 for 200 Hz, i.e., should be about 2*sampling frequency)
+	if(pes->DisplaySamples && !samplering_Create(EEGCHANNELS + ACCCHANNELS, pes->pcfg->SamplingFrequency*3))
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Failed to allocate memory for the sample ring. (errno #)"), errno, TRUE);
+		return FALSE;
+	}
+
+	//
+	// signal storage thread to move to writing state
+	//
+	pes->sttd.StopStorage = FALSE;
+	SignalObjectAndWait(pes->sttd.hevStorageThread_Init_Start, pes->sttd.hevStorageThread_Init_End, INFINITE, FALSE);
+	if(Storage_GetMainFSMState(pes->sttd.pSession) != STS_Write)
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): An error occured while initializing the Storage thread."), 0, TRUE);
+		return FALSE;
+	}
+
+	// initialize EDF+ record storage structures
+	if(edf_InitHeaderStructures(pes->pPatientInfo, pes->pRecordingInfo) != 0)
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Failed to initialize EDF+ header structures."), 0, TRUE);
+		return FALSE;
+	}
+
+	//
+	// store EDF+ header in temporary file
+	//
+	// generate EDF+ header record
+	pes->EDFPlusHeaderBufferLenByt = edf_CalculateEDFplusHeaderRecord(pes->std.NEEGChannels + ACCCHANNELS + 1);	// +1 for annotations signal
+	pes->pEDFPlusHeaderBuffer = malloc(pes->EDFPlusHeaderBufferLenByt + 1);										// +1 for terminating null character
+	if(pes->pEDFPlusHeaderBuffer == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Failed to allocate memory for Buffer. (errno #)"), errno, TRUE);
+		engine_ReportError(MB_ICONSTOP, TEXT("engine_StartRecording(): Failed to allocate memory for Buffer. (errno #%d)."), errno);
+		return FALSE;
+	}
+
+	pes->tmRecordingStartDateTime = util_GetCurrentDateTime();
+	if(!edf_GenerateEDFplusHeaderRecord(TRUE, *pes->pPatientInfo, *pes->pRecordingInfo, pes->pcfg->SamplingFrequency,
+										pes->std.NDataRecords, pes->std.EEGChannelMask, ACCCHANNELS, pes->pcfg->ElectrodeType,
+										(char *) pes->pEDFPlusHeaderBuffer, pes->EDFPlusHeaderBufferLenByt + 1))	// +1 for terminating null character
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Unable to generate EDF+ header record."), 0, TRUE);
+		engine_ReportError(MB_ICONSTOP, TEXT("engine_StartRecording(): Unable to generate EDF+ header record."));
+		return FALSE;
+	}
+
+	// send to storage thread
+	prbEDFPlusHeader = recpool_Copy(pes->pEDFPlusHeaderBuffer, pes->EDFPlusHeaderBufferLenByt);
+	if(prbEDFPlusHeader == NULL || !Storage_AddToQueue(pes->sttd.pSession, prbEDFPlusHeader, TRUE, pes->sttd.hevStorageThread_Write))
+	{
+		recpool_Release(prbEDFPlusHeader);
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Unable to add EDF+ header record to the storage thread's write queue."), 0, TRUE);
+		engine_ReportError(MB_ICONSTOP, TEXT("engine_StartRecording(): Unable to add EDF+ header record to the storage thread's write queue."));
+		return FALSE;
+	}
+	recpool_Release(prbEDFPlusHeader);
+
+	//
+	// generate final EDF+ file name and path
+	//
+	// get full path of temporary EDF+ file from storage thread
+	if(!Storage_GetTemporaryEDFFilePath(pes->sttd.pSession, pes->strTempEDFFilePath, _countof(pes->strTempEDFFilePath)))
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): An error occured while retrieving the full path of the temporary EDF+ file from Storage thread."), 0, TRUE);
+		engine_ReportError(MB_ICONSTOP, TEXT("engine_StartRecording(): An error occured while retrieving the full path of the temporary EDF+ file from Storage thread."));
+		return FALSE;
+	}
+	engine_GenerateFinalEDFFilePath(pes->tmRecordingStartDateTime, pes->strTempEDFFilePath, pes->strFinalEDFFilePath, _countof(pes->strFinalEDFFilePath));
+
+	//
+	// signal streaming thread to start work (if streaming is enabled)
+	//
+	if(pes->pcfg->Streaming_Enabled)
+	{
+		// check if thread encountered an error and exited prematurely
+		if(WaitForSingleObject(pes->sctd.hevVortexClient_Exiting, 0) != WAIT_OBJECT_0)
+		{
+			// initialize StreamingClientThreadData structure
+			pes->sctd.EndTransmission = FALSE;
+			pes->sctd.ExitThread = FALSE;
+
+			// set EDF+ file name
+			wcstombs_s(&sztLength,
+						pes->sctd.EDFFileName, sizeof(pes->sctd.EDFFileName),
+						PathFindFileName(pes->strFinalEDFFilePath), (_countof(pes->sctd.EDFFileName) - 1)*sizeof(char));	// -1 because there has to be room for terminating NULL character
+
+			// signal streaming thread to start the connection process and wait until end of the process
+			SignalObjectAndWait(pes->sctd.hevVortexClient_Connect_Start, pes->sctd.hevVortexClient_Connecting_Start, INFINITE, FALSE);
+
+			// send EDF+ header record
+			prbEDFPlusHeader = recpool_Copy(pes->pEDFPlusHeaderBuffer, pes->EDFPlusHeaderBufferLenByt);
+			if(prbEDFPlusHeader != NULL)
+			{
+				Streaming_SendPacket(pes->sctd.pSession, EEGEMPacketType_EDFhdr, prbEDFPlusHeader, pes->sctd.hevVortexClient_Transmit);
+				recpool_Release(prbEDFPlusHeader);
+			}
+		}
+		else
+		{
+			// log error
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StartRecording(): Streaming thread has exited prematurely."), 0, TRUE);
+
+			// since connection was unsucessfull, disable streaming
+			pes->pcfg->Streaming_Enabled = FALSE;
+		}
+	}
+
+	//
+	// enable sampling
+	//
+	pes->std.EndActivity = FALSE;
+	pes->std.CoordinatorRemoved = FALSE;
+	ResetEvent(pes->std.hevCoordinatorArrival);
+	if(pes->pcfg->SimulationMode)
+	{
+		pes->std.Mode = SampleThreadMode_Simulation;
+		pes->std.pModeData = &pes->smd;
+		pes->smd.SpeedPercent = pes->pcfg->SimulationSpeed;
+	}
+	else
+	{
+		pes->std.Mode = SampleThreadMode_Recording;
+		pes->std.pModeData = NULL;
+	}
+
+	SetEvent(pes->std.hevSampleThread_Start);
+
+	return TRUE;
+}
+
+/**
+ * \brief Stops the current recording and, unless it is aborted, saves it in the final EDF+ file.
+ *
+ * \param[in]	pes							session
+ * \param[in]	scStopCode					member of the StopCode enum (with Stop_Abort, no EDF+ file is saved)
+ * \param[out]	strFinalEDFFilePath			pointer to string where the full path of the final EDF+ file is returned (can be NULL)
+ * \param[in]	uintFinalEDFFilePathLen		size of strFinalEDFFilePath string, in characters
+ *
+ * \return TRUE if the final EDF+ file has been saved, FALSE otherwise.
+ */
+BOOL engine_StopRecording(EngineSession * pes, StopCode scStopCode, TCHAR * strFinalEDFFilePath, unsigned int uintFinalEDFFilePathLen)
+{
+	BOOL						blnErrorOccured;
+	DWORD						dwReturnValue;
+	HANDLE						hEDFPlusFile;						///< handle for the final EDF+ file
+	RecordBuffer *				prbEDFPlusHeader;					///< copy of the EDF+ header record that is shared by the storage and streaming threads
+	SerialReaderStatistics		srsReaderStatistics;
+	SampleRingStatistics		srsSampleRing;
+	AnnotationQueueStatistics	aqsAnnotationQueue;
+
+	//
+	// wait for storage and streaming threads to reach idle states
+	//
+	// sample thread
+	if(Sample_GetMainFSMState(&pes->std) != SampleThreadState_Idle)
+	{
+		// signal Sampling thread to stop and wait until it does so
+		pes->std.EndActivity = TRUE;
+		WaitForSingleObject(pes->std.hevSampleThread_Idle, INFINITE);
+	}
+
+	// storage thread
+	if(Storage_GetMainFSMState(pes->sttd.pSession) != STS_Idle)
+	{
+		// signal Storage thread to stop and wait until it does so
+		pes->sttd.StopStorage = TRUE;
+		SignalObjectAndWait(pes->sttd.hevStorageThread_Write, pes->sttd.hevStorageThread_Idling, INFINITE, FALSE);
+	}
+
+	//
+	// clean up the analyses of the sample thread
+	//
+	coh_cleanup();
+	erp_cleanup();
+
+	//
+	// generate header record for the final EDF+ file
+	//
+	if(pes->pEDFPlusHeaderBuffer != NULL &&
+	   !edf_GenerateEDFplusHeaderRecord(FALSE, *pes->pPatientInfo, *pes->pRecordingInfo, pes->pcfg->SamplingFrequency,
+										pes->std.NDataRecords, pes->std.EEGChannelMask, ACCCHANNELS, pes->pcfg->ElectrodeType,
+										(char *) pes->pEDFPlusHeaderBuffer, pes->EDFPlusHeaderBufferLenByt + 1))		// +1 for terminating null character
+	{
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Unable to generate EDF+ header record for the final EDF+ file."), 0, TRUE);
+		free(pes->pEDFPlusHeaderBuffer);
+		pes->pEDFPlusHeaderBuffer = NULL;
+		pes->EDFPlusHeaderBufferLenByt = 0;
+	}
+
+	//
+	// transfer data from temporary EDF+ file to the final EDF+ file and update header record
+	//
+	blnErrorOccured = TRUE;
+	if((scStopCode == Stop_Normal || scStopCode == Stop_Cancel) && pes->pEDFPlusHeaderBuffer != NULL)
+	{
+		// copy EDF+ from temporary file to its parsed filename and correct header record
+		if(CopyFile(pes->strTempEDFFilePath, pes->strFinalEDFFilePath, TRUE))
+		{
+			// Open EDF+ file and correct header information
+			hEDFPlusFile = CreateFile(pes->strFinalEDFFilePath,
+										GENERIC_WRITE | GENERIC_READ,
+										0,
+										NULL,
+										OPEN_EXISTING,
+										FILE_ATTRIBUTE_NORMAL,
+										NULL);
+			if(hEDFPlusFile != INVALID_HANDLE_VALUE)
+			{
+				// write header record to file
+				if(WriteFile(hEDFPlusFile, pes->pEDFPlusHeaderBuffer, pes->EDFPlusHeaderBufferLenByt, &dwReturnValue, NULL))
+				{
+					if(dwReturnValue == pes->EDFPlusHeaderBufferLenByt)
+					{
+						blnErrorOccured = FALSE;
+					}
+					else
+					{
+						applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Erroneous amount of bytes written while attemtping to store EDF+ header record."), 0, TRUE);
+					}
+				}
+				else
+				{
+					applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Unable to store EDF+ header record in final EDF+ file (GetLastError() #)."), GetLastError(), TRUE);
+				}
+
+				// close final EDF+ file
+				CloseHandle (hEDFPlusFile);
+			}
+			else
+			{
+				applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Unable to open final EDF+ file (GetLastError() #)."), GetLastError(), TRUE);
+			}
+		}
+		else
+		{
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Unable to copy temporary EDF+ file into final EDF+ file (GetLastError() #)."), GetLastError(), TRUE);
+		}
+	}
+
+	//
+	// send final EDF+ header record to streaming server (if enabled)
+	//
+	if(pes->pcfg->Streaming_Enabled && pes->pEDFPlusHeaderBuffer != NULL)
+	{
+		// signal that the following packet will be the last one
+		pes->sctd.EndTransmission = TRUE;
+
+		// send header record (if it cannot be sent, the streaming thread is still woken up so that it ends the transmission)
+		prbEDFPlusHeader = recpool_Copy(pes->pEDFPlusHeaderBuffer, pes->EDFPlusHeaderBufferLenByt);
+		if(prbEDFPlusHeader != NULL)
+		{
+			Streaming_SendPacket(pes->sctd.pSession, EEGEMPacketType_EDFhdr, prbEDFPlusHeader, pes->sctd.hevVortexClient_Transmit);
+			recpool_Release(prbEDFPlusHeader);
+		}
+		else
+			SetEvent(pes->sctd.hevVortexClient_Transmit);
+
+		// wait for streaming thread to transition to an idle state
+		WaitForSingleObject(pes->sctd.hevVortexClient_WaitingToConnect, INFINITE);
+	}
+
+	//
+	// memory allocation clean-up
+	//
+	// free EDF+ header
+	if(pes->pEDFPlusHeaderBuffer != NULL)
+	{
+		free(pes->pEDFPlusHeaderBuffer);
+		pes->pEDFPlusHeaderBuffer = NULL;
+		pes->EDFPlusHeaderBufferLenByt = 0;
+	}
+
+	// free EDF+ record storage structures
+	if(pes->pRecordingInfo != NULL && pes->pRecordingInfo->Equipment != NULL)
+	{
+		free(pes->pRecordingInfo->Equipment);
+		pes->pRecordingInfo->Equipment = NULL;
+	}
+
+	// samples that the display could not keep up with
+	if(pes->DisplaySamples)
+	{
+		samplering_GetStatistics(&srsSampleRing);
+		if(srsSampleRing.NOverruns > 0)
+		{
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Sample ring overran, display fell behind. (# overruns)"), (int) srsSampleRing.NOverruns, TRUE);
+			applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Samples not displayed. (# samples)"), (int) srsSampleRing.NSamplesDropped, TRUE);
+		}
+		samplering_Destroy();
+	}
+
+	// buffers of the data records that are no longer referenced
+	recpool_Destroy();
+
+	// annotations that could not be stored
+	annotqueue_GetStatistics(&aqsAnnotationQueue);
+	if(aqsAnnotationQueue.NDropped > 0)
+		applog_logevent(SoftwareError, TEXT("Engine"), TEXT("engine_StopRecording(): Annotations dropped because the annotation queue was full. (#)"), (int) aqsAnnotationQueue.NDropped, TRUE);
+
+	// log amount of lost packets and checksum errors
+	applog_logevent(SoftwareError, TEXT("Engine"), TEXT("Number of packet checksum errors"), pes->std.NPacketChecksumErrors, TRUE);
+	applog_logevent(SoftwareError, TEXT("Engine"), TEXT("Number of lost packets"), pes->std.NPacketsLost, TRUE);
+
+	// log serial reader statistics
+	serial_GetReaderStatistics(&srsReaderStatistics);
+	applog_logevent(SoftwareError, TEXT("Engine"), TEXT("Number of serial reader wake-ups"), srsReaderStatistics.NReaderWakeUps, TRUE);
+	applog_logevent(SoftwareError, TEXT("Engine"), TEXT("Number of sample thread wake-ups"), srsReaderStatistics.NFramerWakeUps, TRUE);
+	applog_logevent(SoftwareError, TEXT("Engine"), TEXT("Serial ring buffer high-water mark (bytes)"), srsReaderStatistics.RingHighWaterMark, TRUE);
+	applog_logevent(SoftwareError, TEXT("Engine"), TEXT("Number of serial bytes dropped"), srsReaderStatistics.NBytesDropped, TRUE);
+	applog_logevent(SoftwareError, TEXT("Engine"), TEXT("Number of framer resynchronizations"), srsReaderStatistics.NResyncs, TRUE);
+
+	// log start of recording & mark end of recording in application log
+	applog_logevent(General, TEXT("Engine"), TEXT("Recording Ended"), 0, TRUE);
+	applog_endgrouping();
+
+	if(strFinalEDFFilePath != NULL && uintFinalEDFFilePathLen > 0)
+		_tcsncpy_s(strFinalEDFFilePath, uintFinalEDFFilePathLen, pes->strFinalEDFFilePath, _TRUNCATE);
+
+	return !blnErrorOccured;
+}
@@ -0,0 +1,120 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		engine.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the acquisition engine, i.e. of the module that runs the recordings of the sample, storage and
+ *				streaming threads for the program that hosts them.
+ *
+ * $Id$
+ */
+
+# ifndef __ENGINE_H__
+# define __ENGINE_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define ENGINE_MAXMESSAGELENGTH		256						///< maximum length of an error message, in TCHARs (including the terminating NULL character)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+// Annotations enumeration
+typedef enum {CommunicationFailure,
+			  CommunicationResume,
+			  CoordinatorRemoved,
+			  CoordinatorInserted,
+			  Now,
+			  Regular
+} AnnotationType;
+
+// Stop codes used by engine_StopRecording()
+typedef enum
+{
+	Stop_Normal = 0,			// user-started stop
+	Stop_Abort,					// 1: recording needs to be aborted due to major error; no EDF+ file saved
+	Stop_Cancel					// 2: recording needs to be stopped due to minor error; EDF+ file saved
+} StopCode;
+
+// return codes used when checking for the existence of the coordinator and of the measurement device
+typedef enum
+{
+	WEEGSystem_INVALID = -1,	// invalid value used to initialize variables
+	WEEGSystem_OK = 0,			// both the coordinator and measurement device were found and are functioning properly
+	WEEGSystem_COORD_NCOM,		// 1 = more than 1 COM port found for coordinator (should not happend under normal circumstances)
+	WEEGSystem_COORD_COM,		// 2 = could not open the WEEG COM port
+	WEEGSystem_COORD_DC,		// 3 = the coordinator is not connected to the PC
+	WEEGSystem_COORD_NA,		// 4 = the coordinator is not answering to the polling request
+	WEEGSystem_MEASDEV_CONFIG,	// 5 = the measurement device could not be configured
+	WEEGSystem_MEASDEV_TIMEOUT,	// 6 = the measurement device is not answering
+	WEEGSystem_MEASDEV_CHECKSUM	// 7 = the measurement device is communicating but there are a lot of checksum errors
+} WEEGSystemCheckCode;
+
+/**
+ * Events reported by the sample, storage and streaming threads.
+ */
+typedef enum {EngineEvent_Stop,							///< the recording has to be stopped (wParam is a member of the StopCode enum)
+			  EngineEvent_Error,						///< an error has to be shown to the user (wParam is the MessageBox icon style; lParam is a pointer to the NULL-terminated TCHAR message)
+			  EngineEvent_Annotation,					///< an annotation has been queued (lParam is a pointer to the NULL-terminated char text of the annotation)
+			  EngineEvent_ReplayStatus,					///< progress of the Simulation mode (wParam is the one-based index of the data record being replayed; lParam is the number of data records replayed per second)
+			  EngineEvent_StreamingStatus				///< state of the streaming thread has changed (wParam is a member of the StreamingClientState enum)
+} EngineEvent;
+
+/**
+ * Function that handles the events of the acquisition threads.
+ *
+ * The handler is called in the context of the thread that raises the event, and the pointers passed in lParam are only
+ * valid until the handler returns.
+ *
+ * \param[in]	eeEvent		event
+ * \param[in]	wParam		event-specific parameter
+ * \param[in]	lParam		event-specific parameter
+ * \param[in]	pContext	pointer that was passed to engine_SetEventHandler()
+ */
+typedef void (* EngineEventHandler)(EngineEvent eeEvent, WPARAM wParam, LPARAM lParam, void * pContext);
+
+/**
+ * State of a session, i.e. of the acquisition threads of one WEEG system and of its current recording (defined in
+ * engine.cpp).
+ */
+typedef struct _EngineSession EngineSession;
+
+/**
+ * Status of the current recording, as displayed by the host.
+ */
+typedef struct
+{
+	long			NPacketsReceived;						///< number of packets received
+	long			NPacketChecksumErrors;					///< number of packets received with a wrong checksum
+	long			NPacketsLost;							///< number of packets lost
+	int				NDataRecords;							///< number of data records completed since the start of the recording
+	unsigned int	TimeKeepingTAL;							///< onset of the current data record, in seconds
+	BOOL			BatteryLow;								///< TRUE if the battery of the WEEG measurement device is low
+} EngineStatus;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+WEEGSystemCheckCode	engine_CheckWEEGSystem(EngineSession * pes);
+EngineSession *		engine_CreateSession(CONFIGURATION * pcfg, BOOL blnDisplaySamples);
+void				engine_DestroySession(EngineSession * pes);
+unsigned int		engine_GetEEGChannels(EngineSession * pes, unsigned int * puintEEGChannelIDs);
+int					engine_GetNSimulationDataRecords(EngineSession * pes);
+void				engine_GetStatus(EngineSession * pes, EngineStatus * pesStatus);
+void				engine_InsertAnnotation(EngineSession * pes, AnnotationType atAnnotationType, int intAnnotationId);
+void				engine_Notify(EngineEvent eeEvent, WPARAM wParam, LPARAM lParam);
+void				engine_ReportError(int intStyle, TCHAR * strFormat, ...);
+void				engine_SetCoordinatorPresent(EngineSession * pes, BOOL blnPresent);
+void				engine_SetEventHandler(EngineEventHandler pfnHandler, void * pContext);
+void				engine_SetSimulationFile(EngineSession * pes, char * strEDFFilePath);
+BOOL				engine_StartRecording(EngineSession * pes, PatientIdentification * ppiPatientInfo, RecordingIdentification * priRecordingInfo);
+BOOL				engine_StopRecording(EngineSession * pes, StopCode scStopCode, TCHAR * strFinalEDFFilePath, unsigned int uintFinalEDFFilePathLen);
+
+# endif
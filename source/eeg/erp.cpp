@@ -0,0 +1,354 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		erp.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that computes annotation-triggered averages (event-related potentials) of the EEG signals.
+ *
+ * The raw samples of each channel are kept in a ring that is exactly one epoch (pre + post-trigger window) long. Triggers
+ * are registered with the index of the sample at which they occured and are completed as soon as the last sample of their
+ * post-trigger window has been written to the ring, at which point the ring holds the whole epoch. The epoch is then folded
+ * into a running mean and variance (Welford's method), so memory use depends only on the epoch length and not on the
+ * number of triggers.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdlib.h>
+#include <string.h>
+
+// program headers
+#include "globals.h"
+#include "erp.h"
+#include "simd.h"
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static BOOL					m_blnIsInit = FALSE;							///< TRUE if module has been initialized
+static unsigned int			m_uintNChannels;								///< number of channels being averaged
+static unsigned int			m_uintPreTriggerLength;							///< length of the pre-trigger window, in samples
+static unsigned int			m_uintEpochLength;								///< length of an epoch (pre + post-trigger window), in samples
+
+// raw sample ring
+static short *				m_pshrRing;										///< last m_uintEpochLength samples of each channel (m_uintNChannels x m_uintEpochLength)
+static unsigned int			m_uintRingID;									///< index of the oldest sample in the ring (i.e., where the next sample is written)
+static unsigned int			m_uintNContiguousSamples;						///< number of samples received since the last discontinuity (saturates at m_uintEpochLength)
+static unsigned long		m_ulngNextSampleID;								///< index of the sample that is expected next
+
+// triggers
+static unsigned long		m_ulngPendingTriggers[ERP_MAX_PENDING_TRIGGERS];	///< sample index at which each pending epoch ends (exclusive)
+static volatile LONG		m_lngNPendingTriggers;							///< number of valid elements in m_ulngPendingTriggers
+
+// running statistics
+static double *				m_pdblEpoch;									///< scratch buffer where the completed epoch of one channel is unwrapped
+static double *				m_pdblMean;										///< running mean (m_uintNChannels x m_uintEpochLength)
+static double *				m_pdblM2;										///< running sum of squared deviations from the mean (m_uintNChannels x m_uintEpochLength)
+static volatile LONG		m_lngNEpochs;									///< number of epochs that have been averaged
+
+static CRITICAL_SECTION		m_csGuard;										///< serializes access to the triggers and the running statistics
+
+//---------------------------------------------------------------------------
+//   						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Folds the epoch currently stored in the ring into the running mean and variance. Must be called with m_csGuard held.
+ */
+static void erp_AccumulateEpoch(void)
+{
+	double			dblReciprocalN;
+	short *			pshrRing;
+	unsigned int	n;
+
+	dblReciprocalN = 1.0/(m_lngNEpochs + 1);
+
+	for(n = 0; n < m_uintNChannels; n++)
+	{
+		// unwrap epoch (oldest sample first) so that the update below runs over contiguous memory
+		pshrRing = m_pshrRing + n*m_uintEpochLength;
+		simd_ShortToDouble(pshrRing + m_uintRingID, m_pdblEpoch, m_uintEpochLength - m_uintRingID);
+		simd_ShortToDouble(pshrRing, m_pdblEpoch + m_uintEpochLength - m_uintRingID, m_uintRingID);
+
+		// Welford update
+		simd_WelfordUpdate(m_pdblEpoch, m_pdblMean + n*m_uintEpochLength, m_pdblM2 + n*m_uintEpochLength, dblReciprocalN, m_uintEpochLength);
+	}
+
+	InterlockedIncrement(&m_lngNEpochs);
+}
+
+/**
+ * \brief Completes or discards the pending triggers whose post-trigger window ends at or before the current sample. Must be called with m_csGuard held.
+ */
+static void erp_ProcessTriggers(void)
+{
+	LONG i, j;
+
+	for(i = 0, j = 0; i < m_lngNPendingTriggers; i++)
+	{
+		if(m_ulngPendingTriggers[i] == m_ulngNextSampleID)
+		{
+			// epoch is complete; it is only usable if it does not contain a discontinuity
+			if(m_uintNContiguousSamples == m_uintEpochLength)
+				erp_AccumulateEpoch();
+		}
+		else if((long) (m_ulngPendingTriggers[i] - m_ulngNextSampleID) > 0)
+		{
+			// epoch not complete yet: keep trigger
+			m_ulngPendingTriggers[j++] = m_ulngPendingTriggers[i];
+		}
+		// else: end of epoch has been skipped over by a discontinuity -> discard trigger
+	}
+	m_lngNPendingTriggers = j;
+}
+
+//---------------------------------------------------------------------------
+//   						Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Allocates the sample ring and the running statistics of the module.
+ *
+ * If the module is already initialized (e.g. a new recording is started with a different montage or epoch length), the
+ * resources of the previous initialization are released first.
+ *
+ * \param[in]	uintNChannels			number of channels that will be passed to erp_AddSamples() (at most ERP_MAX_CHANNELS)
+ * \param[in]	uintSamplingFrequency	sampling frequency of the channels, in Hz
+ * \param[in]	uintPreTriggerTime		length of the window preceding the trigger, in ms
+ * \param[in]	uintPostTriggerTime		length of the window following the trigger, in ms
+ *
+ * \return TRUE if succesfull, FALSE otherwise.
+ */
+BOOL erp_init(unsigned int uintNChannels, unsigned int uintSamplingFrequency, unsigned int uintPreTriggerTime, unsigned int uintPostTriggerTime)
+{
+	BOOL blnErrorOccured = FALSE;
+
+	erp_cleanup();
+
+	if(uintNChannels == 0 || uintNChannels > ERP_MAX_CHANNELS || uintSamplingFrequency == 0 ||
+	   uintPostTriggerTime == 0 || (uintPreTriggerTime + uintPostTriggerTime) > ERP_MAX_EPOCH_TIME)
+	{
+		return FALSE;
+	}
+
+	m_uintNChannels = uintNChannels;
+	m_uintPreTriggerLength = (uintPreTriggerTime*uintSamplingFrequency)/1000;
+	m_uintEpochLength = m_uintPreTriggerLength + (uintPostTriggerTime*uintSamplingFrequency)/1000;
+	if(m_uintEpochLength <= m_uintPreTriggerLength)
+		return FALSE;
+
+	// allocate memory
+	m_pshrRing = (short *) malloc(m_uintNChannels*m_uintEpochLength*sizeof(short));
+	m_pdblEpoch = (double *) malloc(m_uintEpochLength*sizeof(double));
+	m_pdblMean = (double *) malloc(m_uintNChannels*m_uintEpochLength*sizeof(double));
+	m_pdblM2 = (double *) malloc(m_uintNChannels*m_uintEpochLength*sizeof(double));
+	if(m_pshrRing == NULL || m_pdblEpoch == NULL || m_pdblMean == NULL || m_pdblM2 == NULL)
+		blnErrorOccured = TRUE;
+
+	if(!blnErrorOccured)
+	{
+		InitializeCriticalSection(&m_csGuard);
+		m_blnIsInit = TRUE;
+
+		erp_reset();
+	}
+	else
+	{
+		erp_cleanup();
+	}
+
+	return !blnErrorOccured;
+}
+
+/**
+ * \brief Releases all of the resources allocated by erp_init().
+ */
+void erp_cleanup(void)
+{
+	if(m_blnIsInit)
+	{
+		DeleteCriticalSection(&m_csGuard);
+		m_blnIsInit = FALSE;
+	}
+
+	free(m_pshrRing);		m_pshrRing = NULL;
+	free(m_pdblEpoch);		m_pdblEpoch = NULL;
+	free(m_pdblMean);		m_pdblMean = NULL;
+	free(m_pdblM2);			m_pdblM2 = NULL;
+}
+
+/**
+ * \brief Discards the pending triggers and the averages.
+ */
+void erp_reset(void)
+{
+	if(!m_blnIsInit)
+		return;
+
+	EnterCriticalSection(&m_csGuard);
+
+	memset(m_pshrRing, 0, m_uintNChannels*m_uintEpochLength*sizeof(short));
+	memset(m_pdblMean, 0, m_uintNChannels*m_uintEpochLength*sizeof(double));
+	memset(m_pdblM2, 0, m_uintNChannels*m_uintEpochLength*sizeof(double));
+	m_uintRingID = 0;
+	m_uintNContiguousSamples = 0;
+	m_ulngNextSampleID = 0;
+	m_lngNPendingTriggers = 0;
+	m_lngNEpochs = 0;
+
+	LeaveCriticalSection(&m_csGuard);
+}
+
+/**
+ * \brief Registers a trigger. Can be called from any thread.
+ *
+ * The trigger is completed once the post-trigger window has been passed to erp_AddSamples(), and is discarded if the
+ * epoch contains a discontinuity.
+ *
+ * \param[in]	ulngOnsetSampleID	index of the sample at which the trigger occured
+ *
+ * \return TRUE if the trigger was registered, FALSE if too many triggers are pending.
+ */
+BOOL erp_AddTrigger(unsigned long ulngOnsetSampleID)
+{
+	BOOL blnResult = FALSE;
+
+	if(!m_blnIsInit)
+		return FALSE;
+
+	EnterCriticalSection(&m_csGuard);
+	if(m_lngNPendingTriggers < ERP_MAX_PENDING_TRIGGERS)
+	{
+		// store the index of the sample that follows the last sample of the epoch
+		m_ulngPendingTriggers[m_lngNPendingTriggers] = ulngOnsetSampleID + (m_uintEpochLength - m_uintPreTriggerLength);
+		m_lngNPendingTriggers++;
+		blnResult = TRUE;
+	}
+	LeaveCriticalSection(&m_csGuard);
+
+	return blnResult;
+}
+
+/**
+ * \brief Adds a block of samples to the ring and completes the triggers whose epoch has been fully received.
+ *
+ * Function executes in the execution context of the calling thread (i.e., the sample thread).
+ *
+ * \param[in]	pshrChannelData		array of m_uintNChannels pointers to the new samples of each channel
+ * \param[in]	uintNNewSamples		number of new samples per channel
+ * \param[in]	ulngFirstSampleID	index of the first sample in the block (a jump in the index is treated as a discontinuity)
+ */
+void erp_AddSamples(short ** pshrChannelData, unsigned int uintNNewSamples, unsigned long ulngFirstSampleID)
+{
+	unsigned int i, n;
+
+	if(!m_blnIsInit)
+		return;
+
+	// restart ring if block does not follow the previous one
+	if(ulngFirstSampleID != m_ulngNextSampleID)
+	{
+		m_uintNContiguousSamples = 0;
+		m_ulngNextSampleID = ulngFirstSampleID;
+	}
+
+	// the triggers are checked after every sample, so the guard is taken once for the whole block rather than per sample
+	EnterCriticalSection(&m_csGuard);
+
+	for(i = 0; i < uintNNewSamples; i++)
+	{
+		for(n = 0; n < m_uintNChannels; n++)
+			m_pshrRing[n*m_uintEpochLength + m_uintRingID] = pshrChannelData[n][i];
+
+		if(++m_uintRingID == m_uintEpochLength)
+			m_uintRingID = 0;
+		if(m_uintNContiguousSamples < m_uintEpochLength)
+			m_uintNContiguousSamples++;
+		m_ulngNextSampleID++;
+
+		if(m_lngNPendingTriggers > 0)
+			erp_ProcessTriggers();
+	}
+
+	LeaveCriticalSection(&m_csGuard);
+}
+
+/**
+ * \brief Returns the baseline-corrected average of each channel, resampled to the requested length. Can be called from any thread.
+ *
+ * The mean of the pre-trigger window of each channel is used as its baseline.
+ *
+ * \param[out]	pdblMean			array of m_uintNChannels pointers to buffers of uintOutputLength elements where the average is to be stored
+ * \param[out]	pdblVariance		array of m_uintNChannels pointers to buffers of uintOutputLength elements where the variance is to be stored (can be NULL)
+ * \param[in]	uintOutputLength	number of samples to be stored in each output buffer
+ *
+ * \return Number of epochs that have been averaged.
+ */
+unsigned int erp_GetAverage(double ** pdblMean, double ** pdblVariance, unsigned int uintOutputLength)
+{
+	double			dblBaseline;
+	double *		pdblChannelMean, * pdblChannelM2;
+	unsigned int	i, n, t, uintNEpochs;
+
+	if(!m_blnIsInit || uintOutputLength == 0)
+		return 0;
+
+	EnterCriticalSection(&m_csGuard);
+
+	uintNEpochs = (unsigned int) m_lngNEpochs;
+	for(n = 0; n < m_uintNChannels; n++)
+	{
+		pdblChannelMean = m_pdblMean + n*m_uintEpochLength;
+		pdblChannelM2 = m_pdblM2 + n*m_uintEpochLength;
+
+		dblBaseline = 0.0;
+		for(t = 0; t < m_uintPreTriggerLength; t++)
+			dblBaseline += pdblChannelMean[t];
+		if(m_uintPreTriggerLength > 0)
+			dblBaseline /= m_uintPreTriggerLength;
+
+		for(i = 0; i < uintOutputLength; i++)
+		{
+			t = (unsigned int) (((unsigned __int64) i*m_uintEpochLength)/uintOutputLength);
+
+			pdblMean[n][i] = pdblChannelMean[t] - dblBaseline;
+			if(pdblVariance != NULL)
+				pdblVariance[n][i] = (uintNEpochs > 1) ? pdblChannelM2[t]/(uintNEpochs - 1) : 0.0;
+		}
+	}
+
+	LeaveCriticalSection(&m_csGuard);
+
+	return uintNEpochs;
+}
+
+/**
+ * \brief Returns the number of epochs that have been averaged so far.
+ *
+ * \return Number of epochs.
+ */
+unsigned int erp_GetNEpochs(void)
+{
+	return m_blnIsInit ? (unsigned int) m_lngNEpochs : 0;
+}
@@ -0,0 +1,38 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		erp.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that computes annotation-triggered averages (event-related potentials) of the EEG signals.
+ *
+ * $Id$
+ */
+
+# ifndef __ERP_H__
+# define __ERP_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define ERP_MAX_CHANNELS				32				///< maximum number of channels supported by the module
+# define ERP_MAX_PENDING_TRIGGERS		16				///< maximum number of triggers whose post-trigger window has not been received yet
+# define ERP_MAX_EPOCH_TIME				10000			///< maximum length of an epoch (pre + post-trigger time), in ms
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+BOOL			erp_init(unsigned int uintNChannels, unsigned int uintSamplingFrequency, unsigned int uintPreTriggerTime, unsigned int uintPostTriggerTime);
+void			erp_cleanup(void);
+void			erp_reset(void);
+BOOL			erp_AddTrigger(unsigned long ulngOnsetSampleID);
+void			erp_AddSamples(short ** pshrChannelData, unsigned int uintNNewSamples, unsigned long ulngFirstSampleID);
+unsigned int	erp_GetAverage(double ** pdblMean, double ** pdblVariance, unsigned int uintOutputLength);
+unsigned int	erp_GetNEpochs(void);
+
+# endif
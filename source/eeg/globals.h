@@ -17,7 +17,7 @@
 //---------------------------------------------------------------------------
 //   								Includes
 //---------------------------------------------------------------------------
-# include <windows.h>
+# include "compat.h"
 
 # include "annotations.h"
 
@@ -72,22 +72,21 @@
 # define NGYROSAMPLES			1024				// # of gyro levels (2^(gyro word size))
 
 # define MIN_SAMPLERATE			200					// Minimum sample rate (Hz)
-//# define MAX_SAMPLERATE			1000				// Maximum sample rate (Hz)
-# define MAX_SAMPLERATE			666					// NOTE: the actual max. sampling rate of the system is 1000 Hz but the
-													// code that interfaces with the WEEG device is not set up to accept this yet.
+# define MAX_SAMPLERATE			1000				// Maximum sample rate (Hz); at this rate at most MAXNMEASUREMENTS/MAX_SAMPLERATE channels can be measured
 
 # define EEGCHANNELS			6					// Maximum number of EEG channels
 # define ACCCHANNELS			3					// three 10b accelrometer measurements per packet
 
 # define WEEG_NETNR				0x0000
-# define WEEG_DEVICENR			0x01
+# define WEEG_DEVICENR			0x01				// default device mask (device 0 only)
 
 # define ADC_RESOLUTION			(3.0/65536)			// resolution of the data samples (V/sample)
 # define SIGNAL_GAIN			1900				// amplification of the EEG signal
 # define WEEG_LSB_UV			(ADC_RESOLUTION/SIGNAL_GAIN)*1000000
 
 # define NCHANNELSINMASK		8
-# define MCHANNELMASK			0x3F				// measurement channels to be sent from the device (1 byte)
+# define MCHANNELMASK			0x3F				// measurement channels that the device can send (1 byte); the channels sent during a
+													// recording are selected with CONFIGURATION::DisplayChannelMask
 													// b0 : Channel 0
 													// b1 : Channel 1
 													// b2 : Channel 2
@@ -150,7 +149,8 @@ typedef enum
 	EEGEMMsg_ExitPermission_Clear		= 0x0401,	///< clear an exit permission (wParam specifies the member of the ExitPermission enum to be set)
 	EEGEMMsg_StatusBar_SetStatus		= 0x0402,	///< display a string in the status part of the main window's status bar (lParam is a pointer to the NULL-terminated string to be displayed)
 	EEGEMMsg_StatusBar_SetAnnotation	= 0x0403,	///< display a string in the annotations part main window's status bar (wParam is TRUE if lParam is a TCHAR string, FALSE otherwise; lParam is a pointer to the NULL-terminated string to be displayed)
-	EEGEMMsg_Streaming_DisplayStatus	= 0x0404	///< update streaming thread status displayed on the second line of the main window's rebar (wParam specifies the member of the StreamingClientState enum representing the current state of the streaming thread)
+	EEGEMMsg_Streaming_DisplayStatus	= 0x0404,	///< update streaming thread status displayed on the second line of the main window's rebar (wParam specifies the member of the StreamingClientState enum representing the current state of the streaming thread)
+	EEGEMMsg_StatusBar_SetReplayStatus	= 0x0405	///< display the progress of the Simulation mode in the status part of the main window's status bar (wParam is the one-based index of the data record being replayed; lParam is the number of data records replayed per second since the replay was started)
 } EEGEMMsg;
 
 /**
@@ -170,7 +170,7 @@ typedef enum
 typedef struct
 {
 	// General parameters
-	BYTE	DisplayChannelMask;												///< Mask for selected channels
+	BYTE	DisplayChannelMask;												///< Mask for selected channels (the EEG channels that are measured, recorded and displayed)
 	int		COMPortIndex;
 	int		SamplingFrequency;												// WEEG device sample rate (Hz) has to be in the range
 																			// 2001000 or zero. Please note that the maximum throughput is 4000
@@ -205,17 +205,48 @@ typedef struct
 	int		Streaming_Server_Port;
 	int		Streaming_MaxNSendMsgFailures;
 	int		Streaming_MaxNWait4ReplyFailures;
+	BOOL	Streaming_Coherence;											///< TRUE if the inter-channel coherence of each data record is streamed after the record
+
+	// Event-related potential parameters
+	int		ERP_PreTriggerTime;												///< length of the averaging window preceding an annotation, in ms
+	int		ERP_PostTriggerTime;											///< length of the averaging window following an annotation, in ms
+	int		ERP_TriggerMask;												///< annotation types that trigger the averaging of an epoch (bit n = member n of the AnnotationType enum)
+
+	// Artifact removal parameters
+	BOOL	ICA_Enabled;													///< TRUE if eye-blink and muscle artifacts are removed from the displayed EEG signals
+	int		ICA_WindowTime;													///< length of the window over which the unmixing matrix is estimated, in s
+	int		ICA_UpdateInterval;												///< time between two estimates of the unmixing matrix, in s
+
+	// WEEG link parameters
+	int		Link_Transport;													///< transport over which the WEEG link is run (see TransportType)
+	TCHAR	Link_Address[MAX_PATH + 1];										///< capture file path, host:port or EDF+ file path (emulator) of the transport (not used by the COM port transport)
+	BOOL	Link_ReplayRealTime;											///< TRUE if capture files are replayed at the link's speed, FALSE if as fast as possible
+	BOOL	Link_Capture;													///< TRUE if the traffic of the link is captured to a file in the destination folder during recordings
+	int		Link_DeviceMask;												///< measurement devices that are recorded (bit n = device n; always includes the primary device)
+	int		Link_PrimaryDevice;												///< measurement device that is displayed and recorded by the sample thread; the others are recorded by device streams
+	BOOL	Link_CorrectAnnotationOnsets;									///< TRUE if user annotations get their own onset, estimated with the device clock (see clockdrift.cpp), FALSE if they are placed at the next sample to be recorded
+
+	// WEEG coordinator emulator parameters (see EmulatorImpairments)
+	int		Emulator_PacketLossRate;										///< DATA packets that are not sent, in ppm
+	int		Emulator_CorruptionRate;										///< DATA packets sent with a corrupted byte, in ppm
+	int		Emulator_SpikeRate;												///< DATA packets after which the coordinator stalls, in ppm
+	int		Emulator_SpikeLength;											///< duration of a stall, in ms
+	int		Emulator_DisconnectInterval;									///< time between two disconnections of the measurement devices, in s (0 = never)
+	int		Emulator_DisconnectLength;										///< duration of a disconnection, in s
 	
 	// Annotations
 	TCHAR	Annotations[ANNOTATION_MAX_TYPES][ANNOTATION_MAX_CHARS + 1];	///<
 	
 	// GUI parameters
 	int		LPFilterIndex;	
+	int		BaselineWindowTime;												///< length, in ms, of the running-median window used for baseline removal (0 = disabled)
 	int		ScaleIndex;
 	int		TimeBaseIndex;
+	BOOL	LatencyProbes;													///< TRUE if the latency of the acquisition pipeline is measured (see latency.cpp)
 
 	// Members that can only be changed directly from configuration file
 	BOOL	SimulationMode;													///< Software used in Simulation mode when this member is TRUE 
+	int		SimulationSpeed;												///< speed at which the Simulation mode replays the EDF+ file, in % of real time (0 = as fast as possible)
     TCHAR	ElectrodeType[80 + 1];											///< type of transducer used to record the EEG (max length defined in the EDF standard)
 	int		ChannelDCOffset[EEGCHANNELS];
 
@@ -0,0 +1,684 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		ica.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that suppresses eye-blink and muscle artifacts in the EEG signals by means of online independent
+ *				component analysis (ICA).
+ *
+ * The last few seconds of signal are kept in a ring buffer. Every update interval, a snapshot of the ring is handed to a
+ * background thread that whitens it and re-estimates the unmixing matrix with symmetric FastICA (tanh non-linearity),
+ * using the previous estimate as the starting point. Each component is then classified: components with a high excess
+ * kurtosis that project mostly onto a frontal electrode are treated as eye blinks, and components whose mean frequency is
+ * high are treated as muscle activity. The artifact-free projection (mixing matrix x component mask x unmixing matrix)
+ * is published to the display path, which applies it to every new sample with one matrix-vector product.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// program headers
+#include "globals.h"
+#include "ica.h"
+#include "simd.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+#define ICA_PI						3.14159265358979323846
+#define ICA_MAX_NELEMENTS			(ICA_MAX_CHANNELS*ICA_MAX_CHANNELS)
+#define ICA_MAX_JACOBI_SWEEPS		50							///< maximum number of sweeps of the Jacobi eigenvalue algorithm
+#define ICA_MIN_EIGENVALUE			1e-9						///< eigenvalues smaller than this fraction of the largest one are treated as zero
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static BOOL					m_blnIsInit = FALSE;							///< TRUE if module has been initialized
+static unsigned int			m_uintNChannels;								///< number of channels being processed
+static unsigned int			m_uintSamplingFrequency;						///< sampling frequency of the channels, in Hz
+static unsigned int			m_uintWindowLength;								///< number of samples over which the unmixing matrix is estimated
+static unsigned int			m_uintUpdateLength;								///< number of new samples between two consecutive updates
+static unsigned long		m_ulngFrontalChannelMask;						///< bit n is set if channel n is a frontal electrode
+
+// sample ring (accessed only by the display path)
+static short *				m_pshrRing;										///< last m_uintWindowLength raw samples of each channel (m_uintNChannels x m_uintWindowLength)
+static unsigned int			m_uintRingID;									///< index of the oldest sample in the ring
+static unsigned int			m_uintNSamplesBuffered;							///< number of valid samples in the ring
+static unsigned int			m_uintNSamplesSinceUpdate;						///< number of samples added since the last update was requested
+
+// worker thread
+static HANDLE				m_hThread;										///< handle of the thread that re-estimates the unmixing matrix
+static HANDLE				m_hevUpdate;									///< signaled when a new snapshot is available in m_pdblWindow
+static volatile BOOL		m_blnExitThread;								///< set to make the worker thread exit
+static volatile LONG		m_lngWorkerBusy;								///< 1 while the worker thread owns m_pdblWindow
+
+// worker data (accessed only by the worker thread while m_lngWorkerBusy is set)
+static double *				m_pdblWindow;									///< snapshot of the ring in chronological order (m_uintNChannels x m_uintWindowLength)
+static double				m_dblMean[ICA_MAX_CHANNELS];					///< mean of each channel in the snapshot
+static double				m_dblWhitening[ICA_MAX_NELEMENTS];				///< whitening matrix
+static double				m_dblDewhitening[ICA_MAX_NELEMENTS];			///< inverse (pseudo-inverse) of the whitening matrix
+static double				m_dblRotation[ICA_MAX_NELEMENTS];				///< orthogonal unmixing matrix in the whitened space (kept between updates as a warm start)
+static double				m_dblRotationNew[ICA_MAX_NELEMENTS];
+static double				m_dblUnmixing[ICA_MAX_NELEMENTS];				///< unmixing matrix (rotation x whitening)
+static double				m_dblMixing[ICA_MAX_NELEMENTS];					///< mixing matrix (dewhitening x rotation')
+static double				m_dblScratchA[ICA_MAX_NELEMENTS];
+static double				m_dblScratchB[ICA_MAX_NELEMENTS];
+static double				m_dblEigenvalues[ICA_MAX_CHANNELS];
+static double *				m_pdblComponent;								///< one component over the whole snapshot
+
+// published results
+static double				m_dblProjection[ICA_MAX_NELEMENTS];				///< matrix that removes the rejected components from a sample vector
+static double				m_dblOffset[ICA_MAX_CHANNELS];					///< offset that restores the channel means removed before the projection
+static BOOL					m_blnProjectionValid;							///< TRUE once the first projection has been published
+static CRITICAL_SECTION		m_csProjectionGuard;							///< prevents the display path from reading the projection while it is being updated
+
+//---------------------------------------------------------------------------
+//   						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Computes the eigenvalues and eigenvectors of a symmetric matrix with the cyclic Jacobi method.
+ *
+ * \param[in,out]	pdblMatrix			n x n symmetric matrix (row-major); destroyed by the function
+ * \param[in]		n					order of the matrix
+ * \param[out]		pdblEigenvalues		eigenvalues
+ * \param[out]		pdblEigenvectors	n x n matrix whose columns are the eigenvectors
+ */
+static void ica_Eigen(double * pdblMatrix, unsigned int n, double * pdblEigenvalues, double * pdblEigenvectors)
+{
+	unsigned int	uintSweep, p, q, k;
+	double			dblOffDiagonal, dblNorm, dblTheta, t, c, s, x, y;
+
+	for(p = 0; p < n; p++)
+		for(q = 0; q < n; q++)
+			pdblEigenvectors[p*n + q] = (p == q) ? 1.0 : 0.0;
+
+	for(uintSweep = 0; uintSweep < ICA_MAX_JACOBI_SWEEPS; uintSweep++)
+	{
+		dblOffDiagonal = dblNorm = 0.0;
+		for(p = 0; p < n; p++)
+		{
+			dblNorm += pdblMatrix[p*n + p]*pdblMatrix[p*n + p];
+			for(q = p + 1; q < n; q++)
+				dblOffDiagonal += pdblMatrix[p*n + q]*pdblMatrix[p*n + q];
+		}
+		if(dblOffDiagonal <= 1e-24*dblNorm)
+			break;
+
+		for(p = 0; p < n; p++)
+		{
+			for(q = p + 1; q < n; q++)
+			{
+				if(pdblMatrix[p*n + q] == 0.0)
+					continue;
+
+				// rotation that zeroes element (p, q)
+				dblTheta = (pdblMatrix[q*n + q] - pdblMatrix[p*n + p])/(2.0*pdblMatrix[p*n + q]);
+				t = 1.0/(fabs(dblTheta) + sqrt(dblTheta*dblTheta + 1.0));
+				if(dblTheta < 0.0)
+					t = -t;
+				c = 1.0/sqrt(t*t + 1.0);
+				s = t*c;
+
+				for(k = 0; k < n; k++)
+				{
+					x = pdblMatrix[k*n + p];
+					y = pdblMatrix[k*n + q];
+					pdblMatrix[k*n + p] = c*x - s*y;
+					pdblMatrix[k*n + q] = s*x + c*y;
+				}
+				for(k = 0; k < n; k++)
+				{
+					x = pdblMatrix[p*n + k];
+					y = pdblMatrix[q*n + k];
+					pdblMatrix[p*n + k] = c*x - s*y;
+					pdblMatrix[q*n + k] = s*x + c*y;
+				}
+				for(k = 0; k < n; k++)
+				{
+					x = pdblEigenvectors[k*n + p];
+					y = pdblEigenvectors[k*n + q];
+					pdblEigenvectors[k*n + p] = c*x - s*y;
+					pdblEigenvectors[k*n + q] = s*x + c*y;
+				}
+			}
+		}
+	}
+
+	for(p = 0; p < n; p++)
+		pdblEigenvalues[p] = pdblMatrix[p*n + p];
+}
+
+/**
+ * \brief Orthogonalizes the rows of a matrix symmetrically, i.e., W = (W*W')^(-1/2)*W.
+ */
+static void ica_SymmetricDecorrelation(double * pdblMatrix)
+{
+	unsigned int	n, i, j, k;
+	double			dblSum;
+
+	n = m_uintNChannels;
+
+	// W*W'
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < n; j++)
+		{
+			dblSum = 0.0;
+			for(k = 0; k < n; k++)
+				dblSum += pdblMatrix[i*n + k]*pdblMatrix[j*n + k];
+			m_dblScratchA[i*n + j] = dblSum;
+		}
+	}
+	ica_Eigen(m_dblScratchA, n, m_dblEigenvalues, m_dblScratchB);
+
+	// (W*W')^(-1/2) = E*D^(-1/2)*E'
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < n; j++)
+		{
+			dblSum = 0.0;
+			for(k = 0; k < n; k++)
+			{
+				if(m_dblEigenvalues[k] > ICA_MIN_EIGENVALUE)
+					dblSum += m_dblScratchB[i*n + k]*m_dblScratchB[j*n + k]/sqrt(m_dblEigenvalues[k]);
+			}
+			m_dblScratchA[i*n + j] = dblSum;
+		}
+	}
+
+	// (W*W')^(-1/2)*W
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < n; j++)
+		{
+			dblSum = 0.0;
+			for(k = 0; k < n; k++)
+				dblSum += m_dblScratchA[i*n + k]*pdblMatrix[k*n + j];
+			m_dblScratchB[i*n + j] = dblSum;
+		}
+	}
+	memcpy(pdblMatrix, m_dblScratchB, n*n*sizeof(double));
+}
+
+/**
+ * \brief Centers and whitens the snapshot in m_pdblWindow (in place).
+ */
+static void ica_Whiten(void)
+{
+	unsigned int	n, L, i, j, k;
+	double			dblSum, dblMaxEigenvalue, dblScale;
+	double			dblSample[ICA_MAX_CHANNELS];
+
+	n = m_uintNChannels;
+	L = m_uintWindowLength;
+
+	// remove mean
+	for(i = 0; i < n; i++)
+	{
+		dblSum = 0.0;
+		for(k = 0; k < L; k++)
+			dblSum += m_pdblWindow[i*L + k];
+		m_dblMean[i] = dblSum/L;
+		for(k = 0; k < L; k++)
+			m_pdblWindow[i*L + k] -= m_dblMean[i];
+	}
+
+	// covariance matrix
+	for(i = 0; i < n; i++)
+	{
+		for(j = i; j < n; j++)
+		{
+			dblSum = 0.0;
+			for(k = 0; k < L; k++)
+				dblSum += m_pdblWindow[i*L + k]*m_pdblWindow[j*L + k];
+			m_dblScratchA[i*n + j] = m_dblScratchA[j*n + i] = dblSum/L;
+		}
+	}
+	ica_Eigen(m_dblScratchA, n, m_dblEigenvalues, m_dblScratchB);
+
+	// whitening = D^(-1/2)*E', dewhitening = E*D^(1/2) (directions without variance, e.g. flat channels, are dropped)
+	dblMaxEigenvalue = 0.0;
+	for(i = 0; i < n; i++)
+	{
+		if(m_dblEigenvalues[i] > dblMaxEigenvalue)
+			dblMaxEigenvalue = m_dblEigenvalues[i];
+	}
+	for(i = 0; i < n; i++)
+	{
+		dblScale = (m_dblEigenvalues[i] > ICA_MIN_EIGENVALUE*dblMaxEigenvalue && m_dblEigenvalues[i] > 0.0) ? sqrt(m_dblEigenvalues[i]) : 0.0;
+		for(j = 0; j < n; j++)
+		{
+			m_dblWhitening[i*n + j] = (dblScale > 0.0) ? m_dblScratchB[j*n + i]/dblScale : 0.0;
+			m_dblDewhitening[j*n + i] = m_dblScratchB[j*n + i]*dblScale;
+		}
+	}
+
+	// apply whitening
+	for(k = 0; k < L; k++)
+	{
+		for(i = 0; i < n; i++)
+			dblSample[i] = m_pdblWindow[i*L + k];
+		for(i = 0; i < n; i++)
+		{
+			dblSum = 0.0;
+			for(j = 0; j < n; j++)
+				dblSum += m_dblWhitening[i*n + j]*dblSample[j];
+			m_pdblWindow[i*L + k] = dblSum;
+		}
+	}
+}
+
+/**
+ * \brief Refines m_dblRotation with symmetric FastICA on the whitened snapshot.
+ */
+static void ica_FastICA(void)
+{
+	unsigned int	n, L, i, j, k, uintIteration;
+	double			dblY, dblG, dblSumDG, dblMaxChange, dblDot;
+
+	n = m_uintNChannels;
+	L = m_uintWindowLength;
+
+	for(uintIteration = 0; uintIteration < ICA_MAX_ITERATIONS && !m_blnExitThread; uintIteration++)
+	{
+		// w+ = E{z*g(w'z)} - E{g'(w'z)}*w, with g = tanh
+		for(i = 0; i < n; i++)
+		{
+			for(j = 0; j < n; j++)
+				m_dblRotationNew[i*n + j] = 0.0;
+			dblSumDG = 0.0;
+
+			for(k = 0; k < L; k++)
+			{
+				dblY = 0.0;
+				for(j = 0; j < n; j++)
+					dblY += m_dblRotation[i*n + j]*m_pdblWindow[j*L + k];
+				dblG = tanh(dblY);
+				dblSumDG += 1.0 - dblG*dblG;
+				for(j = 0; j < n; j++)
+					m_dblRotationNew[i*n + j] += m_pdblWindow[j*L + k]*dblG;
+			}
+
+			for(j = 0; j < n; j++)
+				m_dblRotationNew[i*n + j] = (m_dblRotationNew[i*n + j] - dblSumDG*m_dblRotation[i*n + j])/L;
+		}
+		ica_SymmetricDecorrelation(m_dblRotationNew);
+
+		// convergence: every row points (up to sign) in the same direction as before
+		dblMaxChange = 0.0;
+		for(i = 0; i < n; i++)
+		{
+			dblDot = 0.0;
+			for(j = 0; j < n; j++)
+				dblDot += m_dblRotationNew[i*n + j]*m_dblRotation[i*n + j];
+			if(1.0 - fabs(dblDot) > dblMaxChange)
+				dblMaxChange = 1.0 - fabs(dblDot);
+		}
+		memcpy(m_dblRotation, m_dblRotationNew, n*n*sizeof(double));
+
+		if(dblMaxChange < ICA_CONVERGENCE_TOLERANCE)
+			break;
+	}
+}
+
+/**
+ * \brief Re-estimates the unmixing matrix from the snapshot in m_pdblWindow and publishes the new artifact-free projection.
+ */
+static void ica_Update(void)
+{
+	unsigned int	n, L, i, j, k, m, uintArgMax, uintNRejected;
+	double			dblSum, dblM2, dblM4, dblMSD, dblKurtosis, dblFrequency, dblRatio, dblMax, dblBest;
+	double			dblScore[ICA_MAX_CHANNELS];
+	BOOL			blnReject[ICA_MAX_CHANNELS];
+
+	n = m_uintNChannels;
+	L = m_uintWindowLength;
+
+	ica_Whiten();
+	ica_FastICA();
+	if(m_blnExitThread)
+		return;
+
+	// unmixing = rotation*whitening, mixing = dewhitening*rotation'
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < n; j++)
+		{
+			dblSum = 0.0;
+			for(k = 0; k < n; k++)
+				dblSum += m_dblRotation[i*n + k]*m_dblWhitening[k*n + j];
+			m_dblUnmixing[i*n + j] = dblSum;
+
+			dblSum = 0.0;
+			for(k = 0; k < n; k++)
+				dblSum += m_dblDewhitening[i*n + k]*m_dblRotation[j*n + k];
+			m_dblMixing[i*n + j] = dblSum;
+		}
+	}
+
+	// classify components
+	for(m = 0; m < n; m++)
+	{
+		for(k = 0; k < L; k++)
+		{
+			dblSum = 0.0;
+			for(j = 0; j < n; j++)
+				dblSum += m_dblRotation[m*n + j]*m_pdblWindow[j*L + k];
+			m_pdblComponent[k] = dblSum;
+		}
+
+		dblM2 = dblM4 = dblMSD = 0.0;
+		for(k = 0; k < L; k++)
+		{
+			dblM2 += m_pdblComponent[k]*m_pdblComponent[k];
+			dblM4 += m_pdblComponent[k]*m_pdblComponent[k]*m_pdblComponent[k]*m_pdblComponent[k];
+			if(k > 0)
+				dblMSD += (m_pdblComponent[k] - m_pdblComponent[k - 1])*(m_pdblComponent[k] - m_pdblComponent[k - 1]);
+		}
+		dblM2 /= L;
+		dblM4 /= L;
+		dblMSD /= (L - 1);
+
+		dblScore[m] = 0.0;
+		if(dblM2 <= 0.0)
+			continue;
+
+		// eye blink: peaky component that projects mostly onto a frontal electrode
+		dblKurtosis = dblM4/(dblM2*dblM2) - 3.0;
+		dblMax = 0.0;
+		uintArgMax = 0;
+		for(i = 0; i < n; i++)
+		{
+			if(fabs(m_dblMixing[i*n + m]) > dblMax)
+			{
+				dblMax = fabs(m_dblMixing[i*n + m]);
+				uintArgMax = i;
+			}
+		}
+		if(dblKurtosis > ICA_BLINK_KURTOSIS && (m_ulngFrontalChannelMask & (1UL << uintArgMax)))
+			dblScore[m] = dblKurtosis/ICA_BLINK_KURTOSIS;
+
+		// muscle: mean frequency estimated from the power of the first difference (2*(1 - cos(w)) for a sinusoid)
+		dblRatio = dblMSD/dblM2;
+		if(dblRatio > 4.0)
+			dblRatio = 4.0;
+		dblFrequency = m_uintSamplingFrequency*acos(1.0 - dblRatio/2.0)/(2.0*ICA_PI);
+		if(dblFrequency > ICA_MUSCLE_FREQUENCY && dblFrequency/ICA_MUSCLE_FREQUENCY > dblScore[m])
+			dblScore[m] = dblFrequency/ICA_MUSCLE_FREQUENCY;
+	}
+
+	// reject the worst components, but never more than half of them
+	for(m = 0; m < n; m++)
+		blnReject[m] = FALSE;
+	for(uintNRejected = 0; uintNRejected < n/2; uintNRejected++)
+	{
+		dblBest = 0.0;
+		uintArgMax = n;
+		for(m = 0; m < n; m++)
+		{
+			if(!blnReject[m] && dblScore[m] > dblBest)
+			{
+				dblBest = dblScore[m];
+				uintArgMax = m;
+			}
+		}
+		if(uintArgMax == n)
+			break;
+		blnReject[uintArgMax] = TRUE;
+	}
+
+	// projection = mixing*diag(kept)*unmixing, offset = mean - projection*mean
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < n; j++)
+		{
+			dblSum = 0.0;
+			for(m = 0; m < n; m++)
+			{
+				if(!blnReject[m])
+					dblSum += m_dblMixing[i*n + m]*m_dblUnmixing[m*n + j];
+			}
+			m_dblScratchA[i*n + j] = dblSum;
+		}
+	}
+
+	EnterCriticalSection(&m_csProjectionGuard);
+	memcpy(m_dblProjection, m_dblScratchA, n*n*sizeof(double));
+	for(i = 0; i < n; i++)
+	{
+		dblSum = 0.0;
+		for(j = 0; j < n; j++)
+			dblSum += m_dblScratchA[i*n + j]*m_dblMean[j];
+		m_dblOffset[i] = m_dblMean[i] - dblSum;
+	}
+	m_blnProjectionValid = TRUE;
+	LeaveCriticalSection(&m_csProjectionGuard);
+}
+
+/**
+ * \brief Worker thread: waits for snapshots and re-estimates the unmixing matrix from them.
+ */
+static long WINAPI ica_Thread(LPARAM lParam)
+{
+	while(TRUE)
+	{
+		WaitForSingleObject(m_hevUpdate, INFINITE);
+		if(m_blnExitThread)
+			break;
+
+		ica_Update();
+		InterlockedExchange(&m_lngWorkerBusy, 0);
+	}
+
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+//   						Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Allocates the buffers of the module and starts the thread that estimates the unmixing matrix.
+ *
+ * \param[in]	uintNChannels			number of channels that will be passed to ica_Process() (at most ICA_MAX_CHANNELS)
+ * \param[in]	uintSamplingFrequency	sampling frequency of the channels, in Hz
+ * \param[in]	uintWindowTime			length of the window over which the unmixing matrix is estimated, in s
+ * \param[in]	uintUpdateInterval		time between two consecutive estimates, in s
+ * \param[in]	ulngFrontalChannelMask	bit n is set if channel n is a frontal (blink-prone) electrode
+ *
+ * \return TRUE if succesfull, FALSE otherwise.
+ */
+BOOL ica_init(unsigned int uintNChannels, unsigned int uintSamplingFrequency, unsigned int uintWindowTime, unsigned int uintUpdateInterval, unsigned long ulngFrontalChannelMask)
+{
+	DWORD			dwThreadID;
+	unsigned int	i;
+
+	if(uintNChannels < 2 || uintNChannels > ICA_MAX_CHANNELS || uintSamplingFrequency == 0 ||
+	   uintWindowTime < ICA_MIN_WINDOW_TIME || uintWindowTime > ICA_MAX_WINDOW_TIME || uintUpdateInterval == 0)
+	{
+		return FALSE;
+	}
+
+	m_uintNChannels = uintNChannels;
+	m_uintSamplingFrequency = uintSamplingFrequency;
+	m_uintWindowLength = uintWindowTime*uintSamplingFrequency;
+	m_uintUpdateLength = uintUpdateInterval*uintSamplingFrequency;
+	m_ulngFrontalChannelMask = ulngFrontalChannelMask;
+	m_uintRingID = 0;
+	m_uintNSamplesBuffered = 0;
+	m_uintNSamplesSinceUpdate = 0;
+	m_blnProjectionValid = FALSE;
+	m_blnExitThread = FALSE;
+	m_lngWorkerBusy = 0;
+
+	// FastICA starts from the identity
+	for(i = 0; i < uintNChannels*uintNChannels; i++)
+		m_dblRotation[i] = (i%(uintNChannels + 1) == 0) ? 1.0 : 0.0;
+
+	// allocate memory
+	m_pshrRing = (short *) malloc(m_uintNChannels*m_uintWindowLength*sizeof(short));
+	m_pdblWindow = (double *) malloc(m_uintNChannels*m_uintWindowLength*sizeof(double));
+	m_pdblComponent = (double *) malloc(m_uintWindowLength*sizeof(double));
+	if(m_pshrRing == NULL || m_pdblWindow == NULL || m_pdblComponent == NULL)
+	{
+		ica_cleanup();
+		return FALSE;
+	}
+
+	InitializeCriticalSection(&m_csProjectionGuard);
+	m_blnIsInit = TRUE;
+
+	// start worker thread
+	m_hevUpdate = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if(m_hevUpdate != NULL)
+	{
+		m_hThread = CreateThread (NULL,										// handle cannot be inherited by child processes
+								  4096,										// initial size of the stack, in bytes
+								  (LPTHREAD_START_ROUTINE) ica_Thread,		// pointer to the function to be executed by the thread
+								  NULL,										// pointer to a variable to be passed to the thread
+								  0,										// thread runs immediately after creation
+								  &dwThreadID);								// variable where thread identifier is stored
+	}
+	if(m_hevUpdate == NULL || m_hThread == NULL)
+	{
+		ica_cleanup();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Stops the worker thread and releases all of the resources allocated by ica_init().
+ */
+void ica_cleanup(void)
+{
+	if(m_hThread != NULL)
+	{
+		m_blnExitThread = TRUE;
+		SetEvent(m_hevUpdate);
+		WaitForSingleObject(m_hThread, INFINITE);
+		CloseHandle(m_hThread);
+		m_hThread = NULL;
+	}
+	if(m_hevUpdate != NULL)
+	{
+		CloseHandle(m_hevUpdate);
+		m_hevUpdate = NULL;
+	}
+
+	if(m_blnIsInit)
+	{
+		DeleteCriticalSection(&m_csProjectionGuard);
+		m_blnIsInit = FALSE;
+	}
+
+	free(m_pshrRing);			m_pshrRing = NULL;
+	free(m_pdblWindow);			m_pdblWindow = NULL;
+	free(m_pdblComponent);		m_pdblComponent = NULL;
+}
+
+/**
+ * \brief Removes the artifact components from a block of samples (in place) and feeds the raw samples to the estimator.
+ *
+ * Until the first estimate is available, the samples are left untouched. Function executes in the execution context of
+ * the calling thread (i.e., the display path); the estimation itself runs in the worker thread.
+ *
+ * \param[in,out]	pshrChannelData		array of m_uintNChannels pointers to the new samples of each channel
+ * \param[in]		uintNNewSamples		number of new samples per channel
+ */
+void ica_Process(short ** pshrChannelData, unsigned int uintNNewSamples)
+{
+	unsigned int	n, L, i, j, k;
+	double			dblProjection[ICA_MAX_NELEMENTS], dblOffset[ICA_MAX_CHANNELS], dblSample[ICA_MAX_CHANNELS];
+	double			dblSum;
+	BOOL			blnProjectionValid;
+
+	if(!m_blnIsInit)
+		return;
+
+	n = m_uintNChannels;
+	L = m_uintWindowLength;
+
+	// store raw samples
+	for(k = 0; k < uintNNewSamples; k++)
+	{
+		for(i = 0; i < n; i++)
+			m_pshrRing[i*L + m_uintRingID] = pshrChannelData[i][k];
+
+		if(++m_uintRingID == L)
+			m_uintRingID = 0;
+		if(m_uintNSamplesBuffered < L)
+			m_uintNSamplesBuffered++;
+		m_uintNSamplesSinceUpdate++;
+	}
+
+	// hand a snapshot over to the worker thread (skipped if the previous estimate is still being computed)
+	if(m_uintNSamplesBuffered == L && m_uintNSamplesSinceUpdate >= m_uintUpdateLength &&
+	   InterlockedCompareExchange(&m_lngWorkerBusy, 1, 0) == 0)
+	{
+		for(i = 0; i < n; i++)
+		{
+			simd_ShortToDouble(m_pshrRing + i*L + m_uintRingID, m_pdblWindow + i*L, L - m_uintRingID);
+			simd_ShortToDouble(m_pshrRing + i*L, m_pdblWindow + i*L + L - m_uintRingID, m_uintRingID);
+		}
+		m_uintNSamplesSinceUpdate = 0;
+		SetEvent(m_hevUpdate);
+	}
+
+	// get current projection
+	EnterCriticalSection(&m_csProjectionGuard);
+	blnProjectionValid = m_blnProjectionValid;
+	if(blnProjectionValid)
+	{
+		memcpy(dblProjection, m_dblProjection, n*n*sizeof(double));
+		memcpy(dblOffset, m_dblOffset, n*sizeof(double));
+	}
+	LeaveCriticalSection(&m_csProjectionGuard);
+
+	if(!blnProjectionValid)
+		return;
+
+	// remove rejected components
+	for(k = 0; k < uintNNewSamples; k++)
+	{
+		for(j = 0; j < n; j++)
+			dblSample[j] = pshrChannelData[j][k];
+
+		for(i = 0; i < n; i++)
+		{
+			dblSum = dblOffset[i] + simd_DotProduct(dblProjection + i*n, dblSample, n);
+
+			if(dblSum > 32767.0)
+				dblSum = 32767.0;
+			else if(dblSum < -32768.0)
+				dblSum = -32768.0;
+			pshrChannelData[i][k] = (short) floor(dblSum + 0.5);
+		}
+	}
+}
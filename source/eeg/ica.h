@@ -0,0 +1,39 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		ica.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that removes eye-blink and muscle artifacts from the EEG signals by means of
+ *				independent component analysis (ICA).
+ *
+ * $Id$
+ */
+
+# ifndef __ICA_H__
+# define __ICA_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define ICA_MAX_CHANNELS				32				///< maximum number of channels supported by the module
+# define ICA_MIN_WINDOW_TIME			5				///< shortest window over which the unmixing matrix is estimated, in s
+# define ICA_MAX_WINDOW_TIME			60				///< longest window over which the unmixing matrix is estimated, in s
+# define ICA_MAX_ITERATIONS				100				///< maximum number of FastICA iterations per update
+# define ICA_CONVERGENCE_TOLERANCE		1e-6			///< FastICA stops when every row of the unmixing matrix changes less than this (1 - |cos(angle)|)
+# define ICA_BLINK_KURTOSIS				5.0				///< minimum excess kurtosis of a component for it to be considered an eye blink
+# define ICA_MUSCLE_FREQUENCY			40.0			///< minimum mean frequency, in Hz, of a component for it to be considered muscle activity
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+BOOL	ica_init(unsigned int uintNChannels, unsigned int uintSamplingFrequency, unsigned int uintWindowTime, unsigned int uintUpdateInterval, unsigned long ulngFrontalChannelMask);
+void	ica_cleanup(void);
+void	ica_Process(short ** pshrChannelData, unsigned int uintNNewSamples);
+
+# endif
@@ -0,0 +1,442 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		latency.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that measures how long the received data takes to pass through the stages of the acquisition pipeline.
+ *
+ * The serial reader thread stamps the data it reads from the transport with the time of the read (latency_Now()). The
+ * stamp travels with the data: the framer copies it to the packets it frames, the sample thread passes the stamp of the
+ * packet that completes a data record to the storage and streaming queues, which keep it next to the record. Each stage
+ * calls latency_Record() with the stamp once it is done with the data, which adds the time elapsed since the read to
+ * the histogram of the stage. The display takes what is in the sample ring at each redraw, so it measures the oldest
+ * packet that it has not drawn yet (latency_Defer() and latency_Complete()).
+ *
+ * The histograms have the layout of an HDR histogram: latencies below 2^LATENCY_SUBBUCKETBITS us are counted exactly and
+ * the larger ones in buckets whose width is a fixed fraction of their value (about 3 %), so that a fixed array covers
+ * every latency from 1 us to 71 minutes with the same relative precision. Several threads record into the same
+ * histogram, so the buckets are incremented with interlocked operations and the maximum is kept with a compare-and-
+ * exchange loop; no thread ever waits for another. The readers add up the buckets as they find them, so a snapshot can
+ * be a few measurements behind.
+ *
+ * The probes are off by default. While they are off, latency_Now() returns 0, the data is not stamped, and every probe
+ * returns after reading a single flag. While they are on, a probe costs a performance counter read and two interlocked
+ * operations, and there are at most a few probes per DATA packet.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <intrin.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <tchar.h>
+
+// program headers
+#include "latency.h"
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static const TCHAR *	m_strStageNames [LATENCY_NSTAGES] = {TEXT("Framing"),
+															 TEXT("Processing"),
+															 TEXT("Record sealed"),
+															 TEXT("Storage queue"),
+															 TEXT("Disk write"),
+															 TEXT("Streaming queue"),
+															 TEXT("Streaming send"),
+															 TEXT("Server reply"),
+															 TEXT("Display")};
+
+static volatile LONG	m_lngEnabled;											///< TRUE while the probes are on
+static LONGLONG			m_llngEpoch;											///< performance counter value at which the latency clock was started
+static double			m_dblMicrosecondsPerTick;								///< 0 until the latency clock has been started
+static volatile LONG	m_lngHistogram [LATENCY_NSTAGES][LATENCY_NBUCKETS];
+static volatile LONG	m_lngMax [LATENCY_NSTAGES];								///< largest latency of each stage (us)
+static volatile LONG	m_lngDeferred [LATENCY_NSTAGES];						///< stamp of the oldest data that has not reached the stage yet (0 = none, see latency_Defer())
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Appends formatted text to a string buffer.
+ *
+ * \param[in,out]	strBuffer		null-terminated string
+ * \param[in]		sztBufferLen	size of strBuffer, in characters (the text is truncated if it does not fit)
+ * \param[in]		strFormat		format of the text
+ * \return Nothing.
+ */
+static void latency_Append(TCHAR * strBuffer, size_t sztBufferLen, const TCHAR * strFormat, ...)
+{
+	size_t sztLength;
+	va_list vaArguments;
+
+	sztLength = _tcslen(strBuffer);
+	if(sztLength + 1 >= sztBufferLen)
+		return;
+
+	va_start(vaArguments, strFormat);
+	_vsntprintf_s(strBuffer + sztLength, sztBufferLen - sztLength, _TRUNCATE, strFormat, vaArguments);
+	va_end(vaArguments);
+}
+
+/**
+ * \brief Returns the index of the bucket that counts a latency.
+ *
+ * \param[in]	dwrdLatency		latency (us)
+ * \return Index of the bucket.
+ */
+static unsigned int latency_BucketIndex(DWORD dwrdLatency)
+{
+	unsigned long ulngMSB;
+	unsigned int uintShift;
+
+	if(dwrdLatency < (1 << LATENCY_SUBBUCKETBITS))
+		return dwrdLatency;
+
+	// the LATENCY_SUBBUCKETBITS most significant bits select the bucket
+	_BitScanReverse(&ulngMSB, dwrdLatency);
+	uintShift = ulngMSB - (LATENCY_SUBBUCKETBITS - 1);
+
+	return (uintShift << (LATENCY_SUBBUCKETBITS - 1)) + (dwrdLatency >> uintShift);
+}
+
+/**
+ * \brief Returns the range of latencies counted by a bucket.
+ *
+ * \param[in]	uintIndex		index of the bucket
+ * \param[out]	pdwrdFrom		smallest latency of the bucket (us)
+ * \param[out]	pdwrdTo			largest latency of the bucket (us)
+ * \return Nothing.
+ */
+static void latency_BucketRange(unsigned int uintIndex, DWORD * pdwrdFrom, DWORD * pdwrdTo)
+{
+	unsigned int uintShift;
+
+	if(uintIndex < (1 << LATENCY_SUBBUCKETBITS))
+	{
+		*pdwrdFrom = *pdwrdTo = uintIndex;
+		return;
+	}
+
+	uintShift = (uintIndex >> (LATENCY_SUBBUCKETBITS - 1)) - 1;
+	*pdwrdFrom = (DWORD) (uintIndex - (uintShift << (LATENCY_SUBBUCKETBITS - 1))) << uintShift;
+	*pdwrdTo = *pdwrdFrom + ((1UL << uintShift) - 1);
+}
+
+/**
+ * \brief Reads the latency clock.
+ *
+ * \return Microseconds since the latency clock was started (modulo 2^32, never 0).
+ */
+static DWORD latency_Clock(void)
+{
+	LARGE_INTEGER liCounter;
+	DWORD dwrdTime;
+
+	QueryPerformanceCounter(&liCounter);
+	dwrdTime = (DWORD) (LONGLONG) ((liCounter.QuadPart - m_llngEpoch)*m_dblMicrosecondsPerTick);
+
+	return (dwrdTime != 0) ? dwrdTime : 1;
+}
+
+/**
+ * \brief Copies the histogram of a stage.
+ *
+ * \param[in]	lsStage			stage
+ * \param[out]	plngBuckets		buffer of LATENCY_NBUCKETS elements where the buckets are to be stored
+ * \return Number of measurements in the copy.
+ */
+static long latency_GetHistogram(LatencyStage lsStage, long * plngBuckets)
+{
+	long lngNValues;
+	unsigned int i;
+
+	lngNValues = 0;
+	for(i = 0; i < LATENCY_NBUCKETS; i++)
+	{
+		plngBuckets[i] = m_lngHistogram[lsStage][i];
+		lngNValues += plngBuckets[i];
+	}
+
+	return lngNValues;
+}
+
+/**
+ * \brief Finds a percentile of a histogram.
+ *
+ * \param[in]	plngBuckets		buckets of the histogram
+ * \param[in]	lngNValues		number of measurements in the histogram (> 0)
+ * \param[in]	dblFraction		percentile, as a fraction (0-1)
+ * \param[in]	dwrdMax			largest measurement of the histogram (us)
+ * \return Largest latency of the bucket that holds the percentile, but at most dwrdMax (us).
+ */
+static DWORD latency_Percentile(const long * plngBuckets, long lngNValues, double dblFraction, DWORD dwrdMax)
+{
+	DWORD dwrdFrom, dwrdTo;
+	long lngRank, lngNCounted;
+	unsigned int i;
+
+	lngRank = (long) (dblFraction*lngNValues + 0.999999);
+	if(lngRank < 1)
+		lngRank = 1;
+
+	lngNCounted = 0;
+	for(i = 0; i < LATENCY_NBUCKETS; i++)
+	{
+		lngNCounted += plngBuckets[i];
+		if(lngNCounted >= lngRank)
+			break;
+	}
+	if(i == LATENCY_NBUCKETS)
+		return dwrdMax;
+
+	latency_BucketRange(i, &dwrdFrom, &dwrdTo);
+	return (dwrdTo < dwrdMax) ? dwrdTo : dwrdMax;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Records the latency of the data whose measurement was deferred with latency_Defer().
+ *
+ * Must only be called by the thread that completes the stage.
+ *
+ * \param[in]	lsStage		stage that has been completed
+ * \return Nothing.
+ */
+void latency_Complete(LatencyStage lsStage)
+{
+	DWORD dwrdArrivalTime;
+
+	if(!m_lngEnabled || m_lngDeferred[lsStage] == 0)
+		return;
+
+	dwrdArrivalTime = (DWORD) InterlockedExchange(&m_lngDeferred[lsStage], 0);
+	latency_Record(lsStage, dwrdArrivalTime);
+}
+
+/**
+ * \brief Defers the measurement of a stage that takes up the data in batches (e.g., the display) until the stage calls
+ * latency_Complete().
+ *
+ * Only the first stamp after each latency_Complete() is kept, so the stage is measured with the oldest data of each
+ * batch. Can be called from any thread; never waits for another thread.
+ *
+ * \param[in]	lsStage				stage
+ * \param[in]	dwrdArrivalTime		stamp of the data (see latency_Now(); 0 if the data was not stamped)
+ * \return Nothing.
+ */
+void latency_Defer(LatencyStage lsStage, DWORD dwrdArrivalTime)
+{
+	if(!m_lngEnabled || dwrdArrivalTime == 0 || m_lngDeferred[lsStage] != 0)
+		return;
+
+	InterlockedCompareExchange(&m_lngDeferred[lsStage], (LONG) dwrdArrivalTime, 0);
+}
+
+/**
+ * \brief Stores the histograms in a CSV file.
+ *
+ * The file has one line for each non-empty bucket: the stage, the range of latencies of the bucket, the number of
+ * measurements in it and the fraction of the measurements of the stage up to and including the bucket.
+ *
+ * \param[in]	strFilePath		path of the file (overwritten if it exists)
+ * \return TRUE if successful, FALSE if the file could not be written.
+ */
+BOOL latency_Dump(const TCHAR * strFilePath)
+{
+	static long lngBuckets[LATENCY_NBUCKETS];
+	DWORD dwrdFrom, dwrdTo;
+	FILE * pflDump;
+	long lngNValues, lngNCounted;
+	unsigned int i, j;
+
+	if(_tfopen_s(&pflDump, strFilePath, TEXT("w")) != 0)
+		return FALSE;
+
+	_ftprintf(pflDump, TEXT("Stage,From (us),To (us),Count,Cumulative fraction\n"));
+	for(i = 0; i < LATENCY_NSTAGES; i++)
+	{
+		lngNValues = latency_GetHistogram((LatencyStage) i, lngBuckets);
+		lngNCounted = 0;
+		for(j = 0; j < LATENCY_NBUCKETS && lngNCounted < lngNValues; j++)
+		{
+			if(lngBuckets[j] == 0)
+				continue;
+
+			lngNCounted += lngBuckets[j];
+			latency_BucketRange(j, &dwrdFrom, &dwrdTo);
+			_ftprintf(pflDump, TEXT("%s,%lu,%lu,%ld,%.6f\n"), m_strStageNames[i], dwrdFrom, dwrdTo, lngBuckets[j], (double) lngNCounted/lngNValues);
+		}
+	}
+
+	return fclose(pflDump) == 0;
+}
+
+/**
+ * \brief Switches the probes on or off.
+ *
+ * Can be called at any time. The histograms are kept when the probes are switched off and on again; the measurements of
+ * the data that was received while they were off are not taken.
+ *
+ * \param[in]	blnEnable	TRUE to switch the probes on, FALSE to switch them off
+ * \return Nothing.
+ */
+void latency_Enable(BOOL blnEnable)
+{
+	// the latency clock is only started once, so that the stamps of the data in the pipeline stay valid
+	if(blnEnable && m_dblMicrosecondsPerTick == 0)
+		latency_Reset();
+
+	InterlockedExchange(&m_lngEnabled, blnEnable ? TRUE : FALSE);
+}
+
+/**
+ * \brief Formats a summary of the histograms as text for display in a multi-line edit control: number of
+ * measurements, mean, median, 99th and 99.9th percentiles and maximum of each stage that has been measured.
+ *
+ * \param[out]	strBuffer		buffer where the text is to be stored
+ * \param[in]	sztBufferLen	size of strBuffer, in characters (the text is truncated if it does not fit)
+ * \return Nothing.
+ */
+void latency_Format(TCHAR * strBuffer, size_t sztBufferLen)
+{
+	static long lngBuckets[LATENCY_NBUCKETS];
+	DWORD dwrdFrom, dwrdTo, dwrdMax;
+	double dblSum;
+	long lngNValues;
+	unsigned int i, j;
+
+	if(sztBufferLen == 0)
+		return;
+	strBuffer[0] = TEXT('\0');
+
+	// separated from the text that precedes and follows it by blank lines
+	latency_Append(strBuffer, sztBufferLen, TEXT("\r\nPipeline latency%s\r\n"), m_lngEnabled ? TEXT("") : TEXT(" (probes off)"));
+	latency_Append(strBuffer, sztBufferLen, TEXT("Stage\t\tcount\tmean\t50%%\t99%%\t99.9%%\tmax (ms)\r\n"));
+	for(i = 0; i < LATENCY_NSTAGES; i++)
+	{
+		lngNValues = latency_GetHistogram((LatencyStage) i, lngBuckets);
+		if(lngNValues == 0)
+			continue;
+
+		// mean of the bucket centres
+		dblSum = 0;
+		for(j = 0; j < LATENCY_NBUCKETS; j++)
+		{
+			if(lngBuckets[j] == 0)
+				continue;
+
+			latency_BucketRange(j, &dwrdFrom, &dwrdTo);
+			dblSum += lngBuckets[j]*(dwrdFrom + (dwrdTo - dwrdFrom)/2.0);
+		}
+
+		dwrdMax = (DWORD) m_lngMax[i];
+		latency_Append(strBuffer, sztBufferLen, TEXT("%s\t%ld\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\r\n"),
+					   m_strStageNames[i], lngNValues, dblSum/lngNValues/1000,
+					   latency_Percentile(lngBuckets, lngNValues, 0.5, dwrdMax)/1000.0,
+					   latency_Percentile(lngBuckets, lngNValues, 0.99, dwrdMax)/1000.0,
+					   latency_Percentile(lngBuckets, lngNValues, 0.999, dwrdMax)/1000.0,
+					   dwrdMax/1000.0);
+	}
+	latency_Append(strBuffer, sztBufferLen, TEXT("\r\n"));
+}
+
+/**
+ * \brief Tells whether the probes are on.
+ *
+ * \return TRUE if the probes are on, FALSE otherwise.
+ */
+BOOL latency_IsEnabled(void)
+{
+	return m_lngEnabled ? TRUE : FALSE;
+}
+
+/**
+ * \brief Returns the stamp of data that has just been received.
+ *
+ * Can be called from any thread.
+ *
+ * \return Time on the latency clock (us, modulo 2^32), or 0 while the probes are off.
+ */
+DWORD latency_Now(void)
+{
+	if(!m_lngEnabled)
+		return 0;
+
+	return latency_Clock();
+}
+
+/**
+ * \brief Adds the time elapsed since data was received to the histogram of a stage.
+ *
+ * Can be called from any thread; never waits for another thread.
+ *
+ * \param[in]	lsStage				stage that the data has passed
+ * \param[in]	dwrdArrivalTime		stamp of the data (see latency_Now(); 0 if the data was not stamped)
+ * \return Nothing.
+ */
+void latency_Record(LatencyStage lsStage, DWORD dwrdArrivalTime)
+{
+	DWORD dwrdLatency;
+	LONG lngMax;
+
+	if(!m_lngEnabled || dwrdArrivalTime == 0)
+		return;
+
+	dwrdLatency = latency_Clock() - dwrdArrivalTime;
+	InterlockedIncrement(&m_lngHistogram[lsStage][latency_BucketIndex(dwrdLatency)]);
+
+	do
+	{
+		lngMax = m_lngMax[lsStage];
+		if((DWORD) lngMax >= dwrdLatency)
+			break;
+	}
+	while(InterlockedCompareExchange(&m_lngMax[lsStage], (LONG) dwrdLatency, lngMax) != lngMax);
+}
+
+/**
+ * \brief Clears the histograms and restarts the latency clock at the start of a recording.
+ *
+ * Must only be called while no data is in the pipeline.
+ *
+ * \return Nothing.
+ */
+void latency_Reset(void)
+{
+	LARGE_INTEGER liCounter, liFrequency;
+
+	SecureZeroMemory((void *) m_lngHistogram, sizeof(m_lngHistogram));
+	SecureZeroMemory((void *) m_lngMax, sizeof(m_lngMax));
+	SecureZeroMemory((void *) m_lngDeferred, sizeof(m_lngDeferred));
+
+	QueryPerformanceFrequency(&liFrequency);
+	QueryPerformanceCounter(&liCounter);
+	m_llngEpoch = liCounter.QuadPart;
+	m_dblMicrosecondsPerTick = 1000000.0/liFrequency.QuadPart;
+}
@@ -0,0 +1,58 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		latency.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that measures how long the received data takes to pass through the stages of the acquisition pipeline.
+ *
+ * $Id$
+ */
+
+# ifndef __LATENCY_H__
+# define __LATENCY_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define LATENCY_NSTAGES				9						///< number of members of the LatencyStage enum
+# define LATENCY_SUBBUCKETBITS			6						///< latencies below 2^LATENCY_SUBBUCKETBITS us are counted exactly, larger ones in buckets that are 1/2^(LATENCY_SUBBUCKETBITS - 1) of their value wide
+# define LATENCY_NBUCKETS				((34 - LATENCY_SUBBUCKETBITS) << (LATENCY_SUBBUCKETBITS - 1))	///< number of buckets of a histogram (covers every DWORD latency)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Stages of the acquisition pipeline. The latency of a stage is the time from the moment the serial reader thread read the
+ * data from the transport (or, in Simulation mode, the moment the data record was due) to the end of the stage.
+ */
+typedef enum {LatencyStage_Framing,						///< DATA packet framed and handed to the sample thread
+			  LatencyStage_Processing,					///< Sample_ProcessDataPacket() done
+			  LatencyStage_Sealing,						///< data record completed, including its annotations (measured with the packet that completes it)
+			  LatencyStage_StorageQueue,				///< data record added to the write queue of the storage thread
+			  LatencyStage_DiskWrite,					///< write of the data record to the temporary EDF+ file completed
+			  LatencyStage_StreamQueue,					///< data record added to the transmission queue of the streaming thread
+			  LatencyStage_StreamSend,					///< data record sent to the streaming server
+			  LatencyStage_ServerReply,					///< reply of the streaming server received
+			  LatencyStage_Display						///< samples drawn on the screen (measured with the oldest packet not yet drawn)
+} LatencyStage;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+void	latency_Complete(LatencyStage lsStage);
+void	latency_Defer(LatencyStage lsStage, DWORD dwrdArrivalTime);
+BOOL	latency_Dump(const TCHAR * strFilePath);
+void	latency_Enable(BOOL blnEnable);
+void	latency_Format(TCHAR * strBuffer, size_t sztBufferLen);
+BOOL	latency_IsEnabled(void);
+DWORD	latency_Now(void);
+void	latency_Record(LatencyStage lsStage, DWORD dwrdArrivalTime);
+void	latency_Reset(void);
+
+# endif
@@ -0,0 +1,397 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		linkstats.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that collects the link-quality telemetry of a recording.
+ *
+ * The sample thread reports every DATA packet of the primary measurement device, every checksum error and the state of the
+ * serial link each time it wakes up. The module turns these into counters and fixed-size histograms (inter-packet
+ * interval, time stamp gaps, loss burst lengths and receive ring occupancy) and keeps a series of battery voltage
+ * samples.
+ *
+ * The sample thread is the only writer. Readers (the diagnostics dialog of the GUI thread) take consistent snapshots
+ * without locking: the writer increments a sequence counter before and after each update, and a reader retries its copy
+ * until it has seen the same even sequence number before and after copying. The sample thread is therefore never
+ * blocked by the GUI.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <tchar.h>
+
+// program headers
+#include "linkstats.h"
+#include "serialV4.h"
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static LinkStatistics		m_lsStatistics;
+static volatile LONG		m_lngSequence;								///< odd while m_lsStatistics is being updated
+
+// state of the writer (only accessed by the sample thread)
+static int					m_intNSamplesPerPacket;
+static DWORD				m_dwrdLastTimeStamp;
+static LARGE_INTEGER		m_liLastPacketCounter;						///< performance counter value at the previous packet
+static LARGE_INTEGER		m_liFrequency;								///< frequency of the performance counter
+static DWORD				m_dwrdStartTime;							///< tick count at linkstats_Reset()
+static DWORD				m_dwrdLastBatteryTime;						///< tick count of the previous battery voltage sample
+static long					m_lngNReceivedSinceLoss;					///< number of packets received since the last loss
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Marks the start of an update of the statistics.
+ *
+ * \return Nothing.
+ */
+static void linkstats_BeginUpdate(void)
+{
+	InterlockedIncrement(&m_lngSequence);
+}
+
+/**
+ * \brief Marks the end of an update of the statistics.
+ *
+ * \return Nothing.
+ */
+static void linkstats_EndUpdate(void)
+{
+	InterlockedIncrement(&m_lngSequence);
+}
+
+/**
+ * \brief Appends formatted text to a string buffer; the text is truncated if the buffer is full.
+ *
+ * \param[in,out]	strBuffer		null-terminated string
+ * \param[in]		sztBufferLen	size of strBuffer, in characters
+ * \param[in]		strFormat		format-control string
+ * \return Nothing.
+ */
+static void linkstats_Append(TCHAR * strBuffer, size_t sztBufferLen, const TCHAR * strFormat, ...)
+{
+	size_t sztLength;
+	va_list vaArguments;
+
+	sztLength = _tcslen(strBuffer);
+	if(sztLength + 1 >= sztBufferLen)
+		return;
+
+	va_start(vaArguments, strFormat);
+	_vsntprintf_s(strBuffer + sztLength, sztBufferLen - sztLength, _TRUNCATE, strFormat, vaArguments);
+	va_end(vaArguments);
+}
+
+/**
+ * \brief Appends the non-empty bins of a histogram to a string buffer.
+ *
+ * \param[in,out]	strBuffer		null-terminated string
+ * \param[in]		sztBufferLen	size of strBuffer, in characters
+ * \param[in]		strTitle		title of the histogram
+ * \param[in]		plngBins		bins of the histogram
+ * \param[in]		intNBins		number of bins (the last bin collects all larger values)
+ * \param[in]		lngBinWidth		width of a bin
+ * \param[in]		strNewLine		line separator
+ * \return Nothing.
+ */
+static void linkstats_AppendHistogram(TCHAR * strBuffer, size_t sztBufferLen, const TCHAR * strTitle, const long * plngBins, int intNBins, long lngBinWidth, const TCHAR * strNewLine)
+{
+	int i;
+
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("%s%s"), strTitle, strNewLine);
+	for(i = 0; i < intNBins; i++)
+	{
+		if(plngBins[i] == 0)
+			continue;
+
+		if(i == intNBins - 1)
+			linkstats_Append(strBuffer, sztBufferLen, TEXT("\t%ld+\t%ld%s"), i*lngBinWidth, plngBins[i], strNewLine);
+		else
+			linkstats_Append(strBuffer, sztBufferLen, TEXT("\t%ld\t%ld%s"), i*lngBinWidth, plngBins[i], strNewLine);
+	}
+}
+
+/**
+ * \brief Formats the statistics as text.
+ *
+ * \param[in]	plsStatistics	statistics
+ * \param[out]	strBuffer		buffer where the text is to be stored
+ * \param[in]	sztBufferLen	size of strBuffer, in characters
+ * \param[in]	strNewLine		line separator
+ * \return Nothing.
+ */
+static void linkstats_FormatText(const LinkStatistics * plsStatistics, TCHAR * strBuffer, size_t sztBufferLen, const TCHAR * strNewLine)
+{
+	if(sztBufferLen == 0)
+		return;
+	strBuffer[0] = TEXT('\0');
+
+	// counters
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("Packets received\t\t: %ld%s"), plsStatistics->NPacketsReceived, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("Packets lost\t\t: %ld%s"), plsStatistics->NPacketsLost, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("Checksum errors\t\t: %ld%s"), plsStatistics->NChecksumErrors, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("Resynchronizations\t: %ld (%ld bytes skipped)%s"), plsStatistics->NResyncs, plsStatistics->NBytesSkipped, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("Bytes dropped\t\t: %ld%s"), plsStatistics->NBytesDropped, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("Longest interval\t\t: %.1f ms%s"), plsStatistics->MaxInterval/1000.0, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, TEXT("Ring high-water mark\t: %lu bytes%s"), plsStatistics->MaxRingOccupancy, strNewLine);
+	if(plsStatistics->NBatterySamples > 0)
+		linkstats_Append(strBuffer, sztBufferLen, TEXT("Battery voltage\t\t: %u mV%s"),
+						 plsStatistics->BatteryLevel[(plsStatistics->NBatterySamples - 1) % LINKSTATS_NBATTERYSAMPLES], strNewLine);
+	if(plsStatistics->CurrentBurst > 0)
+		linkstats_Append(strBuffer, sztBufferLen, TEXT("Loss burst in progress\t: %ld packets%s"), plsStatistics->CurrentBurst, strNewLine);
+
+	// histograms
+	linkstats_Append(strBuffer, sztBufferLen, strNewLine);
+	linkstats_AppendHistogram(strBuffer, sztBufferLen, TEXT("Inter-packet interval (ms)\tcount"), plsStatistics->IntervalHistogram, LINKSTATS_NINTERVALBINS, 1, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, strNewLine);
+	linkstats_AppendHistogram(strBuffer, sztBufferLen, TEXT("Time stamp gap (packets)\tcount"), plsStatistics->GapHistogram, LINKSTATS_NGAPBINS, 1, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, strNewLine);
+	linkstats_AppendHistogram(strBuffer, sztBufferLen, TEXT("Loss burst length (packets)\tcount"), plsStatistics->BurstHistogram, LINKSTATS_NBURSTBINS, 1, strNewLine);
+	linkstats_Append(strBuffer, sztBufferLen, strNewLine);
+	linkstats_AppendHistogram(strBuffer, sztBufferLen, TEXT("Ring occupancy (bytes)\tcount"), plsStatistics->OccupancyHistogram, LINKSTATS_NOCCUPANCYBINS, SERBUF_RING/LINKSTATS_NOCCUPANCYBINS, strNewLine);
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Counts a packet that was received with a wrong checksum.
+ *
+ * Must only be called by the sample thread.
+ *
+ * \return Nothing.
+ */
+void linkstats_AddChecksumError(void)
+{
+	linkstats_BeginUpdate();
+	m_lsStatistics.NChecksumErrors++;
+	linkstats_EndUpdate();
+}
+
+/**
+ * \brief Adds a DATA packet of the primary measurement device to the statistics.
+ *
+ * Must be called for every DATA packet of the primary device, including the ones that are discarded because of a repeated
+ * or out-of-order time stamp, and only by the sample thread.
+ *
+ * \param[in]	dwrdTimeStamp		time stamp of the packet
+ * \param[in]	wrdBatteryLevel		battery level reported in the packet (mV)
+ * \return Nothing.
+ */
+void linkstats_AddPacket(DWORD dwrdTimeStamp, WORD wrdBatteryLevel)
+{
+	LARGE_INTEGER liCounter;
+	DWORD dwrdInterval, dwrdNPeriods, dwrdTime;
+	long lngNLost, lngBin;
+
+	QueryPerformanceCounter(&liCounter);
+	dwrdTime = GetTickCount();
+	lngNLost = 0;
+
+	linkstats_BeginUpdate();
+
+	if(m_lsStatistics.NPacketsReceived > 0)
+	{
+		// inter-packet interval
+		dwrdInterval = (DWORD) ((liCounter.QuadPart - m_liLastPacketCounter.QuadPart) * 1000000 / m_liFrequency.QuadPart);
+		lngBin = dwrdInterval / 1000;
+		m_lsStatistics.IntervalHistogram[lngBin < LINKSTATS_NINTERVALBINS ? lngBin : LINKSTATS_NINTERVALBINS - 1]++;
+		if(dwrdInterval > m_lsStatistics.MaxInterval)
+			m_lsStatistics.MaxInterval = dwrdInterval;
+
+		// time stamp gap (a repeated or out-of-order time stamp does not advance the sequence)
+		if(dwrdTimeStamp <= m_dwrdLastTimeStamp)
+			m_lsStatistics.GapHistogram[0]++;
+		else
+		{
+			dwrdNPeriods = (dwrdTimeStamp - m_dwrdLastTimeStamp + m_intNSamplesPerPacket/2) / m_intNSamplesPerPacket;
+			if(dwrdNPeriods == 0)
+				dwrdNPeriods = 1;
+			m_lsStatistics.GapHistogram[dwrdNPeriods < LINKSTATS_NGAPBINS ? dwrdNPeriods : LINKSTATS_NGAPBINS - 1]++;
+			lngNLost = (long) (dwrdNPeriods - 1);
+			m_dwrdLastTimeStamp = dwrdTimeStamp;
+		}
+	}
+	else
+		m_dwrdLastTimeStamp = dwrdTimeStamp;
+	m_liLastPacketCounter = liCounter;
+	m_lsStatistics.NPacketsReceived++;
+
+	// loss bursts: losses that are separated by fewer than LINKSTATS_BURSTGMIN received packets belong to the same burst
+	if(lngNLost > 0)
+	{
+		m_lsStatistics.NPacketsLost += lngNLost;
+		m_lsStatistics.CurrentBurst += lngNLost;
+		m_lngNReceivedSinceLoss = 0;
+	}
+	m_lngNReceivedSinceLoss++;
+	if(m_lsStatistics.CurrentBurst > 0 && m_lngNReceivedSinceLoss >= LINKSTATS_BURSTGMIN)
+	{
+		m_lsStatistics.BurstHistogram[m_lsStatistics.CurrentBurst < LINKSTATS_NBURSTBINS ? m_lsStatistics.CurrentBurst : LINKSTATS_NBURSTBINS - 1]++;
+		m_lsStatistics.CurrentBurst = 0;
+	}
+
+	// battery voltage series
+	if(m_lsStatistics.NBatterySamples == 0 || dwrdTime - m_dwrdLastBatteryTime >= LINKSTATS_BATTERYPERIOD)
+	{
+		m_lsStatistics.BatteryTime[m_lsStatistics.NBatterySamples % LINKSTATS_NBATTERYSAMPLES] = (dwrdTime - m_dwrdStartTime) / 1000;
+		m_lsStatistics.BatteryLevel[m_lsStatistics.NBatterySamples % LINKSTATS_NBATTERYSAMPLES] = wrdBatteryLevel;
+		m_lsStatistics.NBatterySamples++;
+		m_dwrdLastBatteryTime = dwrdTime;
+	}
+
+	linkstats_EndUpdate();
+}
+
+/**
+ * \brief Writes the statistics and the battery voltage series to a text file.
+ *
+ * \param[in]	strFilePath		path of the file (an existing file is overwritten)
+ * \return TRUE if successful, FALSE otherwise.
+ */
+BOOL linkstats_Dump(const TCHAR * strFilePath)
+{
+	static LinkStatistics lsStatistics;
+	static TCHAR strBuffer[8192];
+	FILE * pflDump;
+	long i, lngFirst, lngNSamples;
+
+	linkstats_Get(&lsStatistics);
+	linkstats_FormatText(&lsStatistics, strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("\n"));
+
+	if(_tfopen_s(&pflDump, strFilePath, TEXT("w")) != 0)
+		return FALSE;
+
+	_fputts(strBuffer, pflDump);
+
+	// battery voltage series, oldest sample first
+	lngNSamples = (lsStatistics.NBatterySamples < LINKSTATS_NBATTERYSAMPLES) ? lsStatistics.NBatterySamples : LINKSTATS_NBATTERYSAMPLES;
+	lngFirst = lsStatistics.NBatterySamples - lngNSamples;
+	_ftprintf(pflDump, TEXT("\nBattery voltage (s)\tmV\n"));
+	for(i = lngFirst; i < lngFirst + lngNSamples; i++)
+		_ftprintf(pflDump, TEXT("\t%lu\t%u\n"), lsStatistics.BatteryTime[i % LINKSTATS_NBATTERYSAMPLES], lsStatistics.BatteryLevel[i % LINKSTATS_NBATTERYSAMPLES]);
+
+	return fclose(pflDump) == 0;
+}
+
+/**
+ * \brief Formats the statistics as text for display in a multi-line edit control.
+ *
+ * \param[in]	plsStatistics	statistics (see linkstats_Get())
+ * \param[out]	strBuffer		buffer where the text is to be stored
+ * \param[in]	sztBufferLen	size of strBuffer, in characters (the text is truncated if it does not fit)
+ * \return Nothing.
+ */
+void linkstats_Format(const LinkStatistics * plsStatistics, TCHAR * strBuffer, size_t sztBufferLen)
+{
+	linkstats_FormatText(plsStatistics, strBuffer, sztBufferLen, TEXT("\r\n"));
+}
+
+/**
+ * \brief Takes a consistent snapshot of the statistics.
+ *
+ * Can be called from any thread; never blocks the sample thread.
+ *
+ * \param[out]	plsStatistics	buffer where the statistics are to be stored
+ * \return Nothing.
+ */
+void linkstats_Get(LinkStatistics * plsStatistics)
+{
+	LONG lngSequence;
+
+	for(;;)
+	{
+		lngSequence = m_lngSequence;
+		if(lngSequence & 1)
+		{
+			// update in progress
+			Sleep(0);
+			continue;
+		}
+
+		MemoryBarrier();
+		*plsStatistics = m_lsStatistics;
+		MemoryBarrier();
+
+		if(lngSequence == m_lngSequence)
+			break;
+	}
+}
+
+/**
+ * \brief Clears the statistics at the start of a recording.
+ *
+ * Must only be called by the sample thread.
+ *
+ * \param[in]	intNSamplesPerPacket	number of samples per channel in a DATA packet (time stamp increment of a packet)
+ * \return Nothing.
+ */
+void linkstats_Reset(int intNSamplesPerPacket)
+{
+	linkstats_BeginUpdate();
+	SecureZeroMemory(&m_lsStatistics, sizeof(m_lsStatistics));
+	linkstats_EndUpdate();
+
+	m_intNSamplesPerPacket = (intNSamplesPerPacket > 0) ? intNSamplesPerPacket : 1;
+	m_dwrdLastTimeStamp = 0;
+	m_lngNReceivedSinceLoss = 0;
+	QueryPerformanceFrequency(&m_liFrequency);
+	m_dwrdStartTime = m_dwrdLastBatteryTime = GetTickCount();
+}
+
+/**
+ * \brief Samples the state of the serial link: the occupancy of the receive ring and the framer's counters.
+ *
+ * Meant to be called by the sample thread each time it wakes up, before it frames the received data.
+ *
+ * \return Nothing.
+ */
+void linkstats_SampleLink(void)
+{
+	SerialReaderStatistics srsReaderStatistics;
+	DWORD dwrdOccupancy, dwrdBin;
+
+	dwrdOccupancy = serial_GetRingOccupancy();
+	serial_GetReaderStatistics(&srsReaderStatistics);
+
+	linkstats_BeginUpdate();
+
+	dwrdBin = dwrdOccupancy / (SERBUF_RING/LINKSTATS_NOCCUPANCYBINS);
+	m_lsStatistics.OccupancyHistogram[dwrdBin < LINKSTATS_NOCCUPANCYBINS ? dwrdBin : LINKSTATS_NOCCUPANCYBINS - 1]++;
+	if(dwrdOccupancy > m_lsStatistics.MaxRingOccupancy)
+		m_lsStatistics.MaxRingOccupancy = dwrdOccupancy;
+
+	m_lsStatistics.NResyncs = srsReaderStatistics.NResyncs;
+	m_lsStatistics.NBytesSkipped = srsReaderStatistics.NBytesSkipped;
+	m_lsStatistics.NBytesDropped = srsReaderStatistics.NBytesDropped;
+
+	linkstats_EndUpdate();
+}
@@ -0,0 +1,70 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		linkstats.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that collects the link-quality telemetry of a recording.
+ *
+ * $Id$
+ */
+
+# ifndef __LINKSTATS_H__
+# define __LINKSTATS_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define LINKSTATS_NINTERVALBINS		64						///< number of bins of the inter-packet interval histogram (1 ms per bin, the last bin collects all longer intervals)
+# define LINKSTATS_NGAPBINS				32						///< number of bins of the time stamp gap histogram (1 packet period per bin, the last bin collects all longer gaps)
+# define LINKSTATS_NBURSTBINS			32						///< number of bins of the burst-loss length histogram (1 lost packet per bin, the last bin collects all longer bursts)
+# define LINKSTATS_NOCCUPANCYBINS		16						///< number of bins of the receive ring occupancy histogram (each bin spans 1/16 of the ring)
+# define LINKSTATS_NBATTERYSAMPLES		720						///< number of battery voltage samples kept (older samples are overwritten)
+# define LINKSTATS_BATTERYPERIOD		10000					///< interval between battery voltage samples (milliseconds)
+# define LINKSTATS_BURSTGMIN			16						///< minimum number of consecutively received packets that ends a loss burst (Gmin of RFC 3611)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Link-quality telemetry of the primary measurement device's stream. All of the histograms are fixed-size arrays of
+ * counters, so the structure can be copied as a whole.
+ */
+typedef struct
+{
+	long	NPacketsReceived;									///< number of DATA packets received
+	long	NPacketsLost;										///< number of DATA packets missing from the time stamp sequence
+	long	NChecksumErrors;									///< number of packets received with a wrong checksum
+	long	NResyncs;											///< number of times the framer had to skip bytes to find a preamble
+	long	NBytesSkipped;										///< number of bytes skipped by the framer
+	long	NBytesDropped;										///< number of bytes discarded because the receive ring was full
+	DWORD	MaxInterval;										///< longest inter-packet interval (microseconds)
+	DWORD	MaxRingOccupancy;									///< largest number of bytes waiting in the receive ring
+	long	IntervalHistogram [LINKSTATS_NINTERVALBINS];		///< inter-packet intervals (bin i: i to i+1 ms)
+	long	GapHistogram [LINKSTATS_NGAPBINS];					///< time stamp increments in packet periods (bin 0: repeated or out-of-order time stamp, bin 1: in sequence)
+	long	BurstHistogram [LINKSTATS_NBURSTBINS];				///< lengths of the loss bursts, in lost packets (bin 0 is not used)
+	long	CurrentBurst;										///< number of packets lost in the burst that has not ended yet (not yet in BurstHistogram)
+	long	OccupancyHistogram [LINKSTATS_NOCCUPANCYBINS];		///< receive ring occupancy, sampled each time the sample thread wakes up
+	DWORD	BatteryTime [LINKSTATS_NBATTERYSAMPLES];			///< times of the battery voltage samples (seconds since the start of the recording)
+	WORD	BatteryLevel [LINKSTATS_NBATTERYSAMPLES];			///< battery voltage samples (mV)
+	long	NBatterySamples;									///< total number of battery voltage samples taken (the last LINKSTATS_NBATTERYSAMPLES are kept)
+}
+LinkStatistics;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+void	linkstats_AddChecksumError(void);
+void	linkstats_AddPacket(DWORD dwrdTimeStamp, WORD wrdBatteryLevel);
+BOOL	linkstats_Dump(const TCHAR * strFilePath);
+void	linkstats_Format(const LinkStatistics * plsStatistics, TCHAR * strBuffer, size_t sztBufferLen);
+void	linkstats_Get(LinkStatistics * plsStatistics);
+void	linkstats_Reset(int intNSamplesPerPacket);
+void	linkstats_SampleLink(void);
+
+# endif
@@ -38,6 +38,7 @@
 # include <Shellapi.h>
 # include <Ras.h>
 # include <RasError.h>
+# include <mmsystem.h>
 
 // CRT libraries
 # include <eh.h>
@@ -55,14 +56,28 @@
 // application headers
 # include "globals.h"
 # include "annotations.h"
+# include "annotqueue.h"
 # include "applog.h"
+# include "capture.h"
+# include "clockdrift.h"
+# include "coherence.h"
 # include "config.h"
 # include "edfPlus.h"
+# include "devices.h"
+# include "engine.h"
+# include "emulator.h"
+# include "erp.h"
 # include "graphics.h"
+# include "ica.h"
+# include "latency.h"
 # include "linkedlist.h"
+# include "linkstats.h"
+# include "recpool.h"
 # include "resource.h"
+# include "samplering.h"
 # include "serialV4.h"
 # include "sigproc.h"
+# include "simd.h"
 # include "thread_stream.h"
 # include "thread_storage.h"
 # include "thread_sample.h"
@@ -76,52 +91,45 @@
 //---------------------------------------------------------------------------
 // Windows
 #pragma comment(lib, "Rasapi32.lib")
-
-// custom
-#pragma comment(lib, "libEDF.lib")
+#pragma comment(lib, "winmm.lib")
 
 //---------------------------------------------------------------------------
 //   								Constants
 //---------------------------------------------------------------------------
-const SampleDataRecord			mc_sdrEmpty = {NULL, 0, NULL};		///< empty SampleDataRecord struct used to initialize all variables of this type
+const unsigned long				mc_ulngFrontalChannelMask = 0x1E;	///< EEG channels that are prone to eye-blink artifacts (F8, FP2, FP1 & F7)
 
 //---------------------------------------------------------------------------
 //   								Global variables
 //---------------------------------------------------------------------------
-static BOOL						m_blnCommunicationBlackout, m_blnBatteryLow, m_blnBatteryLowBlink;
+static BOOL						m_blnBatteryLowBlink;
 static BOOL						m_blnScreenSaverActive;
 static BOOL						m_blnUploadComplete;
 static CONFIGURATION			m_cfgConfiguration;
+static EngineSession *			m_pesEngine;
 static HANDLE					m_hEDFPlusFile;
 static HINSTANCE				m_hinMain;
-static int						m_intNSamplesDatarecord;	// Number of samples in current data record
 static PatientIdentification	m_piPatientInfo;
 static RecordingIdentification	m_riRecordingInfo;
-static short					** m_pshrSampleBuffer;														// Buffer for measurement data
 static SignalMode				m_smCurrentSignalMode;
-static unsigned int				m_uintNNewSamples;
-static unsigned int				m_uintSampleBufferLength;
-
-// Annotations
-static char						m_strCurrentDRAnnotations[ANNOTATION_TOTAL_NCHARS];		///< string buffer that stores the annotations for the current data record (NOTE: has to be global variable since it is accessed by both the main and sampling threads)
-static unsigned int				m_uintTimeKeepingTAL;									///< annotation time-stamp
-static int						m_intNAnnotationsBuffered;								///< amount of annotations stored in m_strCurrentDRAnnotations
-static int						m_intNNowAnnotations;									///< amount of 'Now' annotations since the start of the current recording
 
-// WEEG-related variables
-static WEEGSystemCheckCode		m_wsccCheckCode;
+// Measurement channels (copied from the engine at the start of a recording)
+static unsigned int				m_uintNEEGChannels;							///< number of EEG signals in the sample ring
+static unsigned int				m_uintEEGChannelIDs[EEGCHANNELS];			///< channel number of each EEG signal, in the order in which the signals are sent
 
 // Graphics engine
 static BOOL						m_blnDrawAccelerometerTraces;
 static double					m_dblEEGYScale;
 double 							** m_pdblEEGDisplayBuffer;
 double		 					** m_pdblAEEGDisplayBuffer;
+double		 					** m_pdblERPDisplayBuffer;
+static double					* m_pdblERPAverage[EEGCHANNELS];									// rows of m_pdblERPDisplayBuffer that receive the average of each EEG signal
 double 							* m_pdblDisplayBufferTemp;
 static unsigned int				m_uintEEGDisplayBufferID;											// m_dblEEGDisplayBuffer index from where new samples should be inserted
 static unsigned int				m_uintEEGDisplayBufferLength;
 static unsigned int				m_uintAEEGDisplayBufferID;											// m_dblEEGDisplayBuffer index from where new samples should be inserted
 static unsigned int				m_uintAEEGDisplayBufferLength;
 static unsigned int				m_uintNMaxSamples;
+static SigProcContext			* m_pspcDisplayFilters;												// filters of the displayed EEG signals
 
 // GUI Variables
 static BOOL						m_blnIsAnnotationsMenuDisplayed;
@@ -130,17 +138,6 @@ static BOOL						m_blnPortraitOrientation;
 static struct tm				m_tmRecordingTime;
 static HWND						m_hwndAnnotationsDisplay;
 
-// Statistics Variables
-static long						m_lngNPacketsReceived;			// # packets received
-static long						m_lngNPacketChecksumErrors;		// # packets received w/ wrong checksum
-static long						m_intNPacketsLost;				// # packets lost
-static int						m_intNDataRecords;				// Number of current data records
-
-// multithreading variables
-static SampleThreadState		m_stsCurrentSampleThreadState;	// Sampling thread's current mode
-static HANDLE					m_hMutexAnnotation;				// mutex used to prevent the GUI and Sample threads from using the annotation buffer at the same time
-static HANDLE					m_hMutexSampleBuffer;			// mutex used to prevent the GUI and Sample threads from using the data sample buffer at the same time
-
 //---------------------------------------------------------------------------------------------------------------------------------
 //   								Utility Functions
 //---------------------------------------------------------------------------------------------------------------------------------
@@ -149,12 +146,11 @@ static HANDLE					m_hMutexSampleBuffer;			// mutex used to prevent the GUI and S
  *
  * \param[out]	strErrorBuffer		pointer to NULL-terminated string that will contain the error code (if any)
  * \param[in]	uintErrorBufferLen	length of strErrorBuffer, in TCHARs
- * \param[in]	std					struct containing values passed to the sampling thread
  * \param[in]	gui					struct containing handles to the elements of the main window's GUI
  *
  * \return TRUE if system passed all tests and is ready for recording, FALSE otherwise.
  */
-static BOOL main_CheckWEEGSystem(TCHAR * strErrorBuffer, unsigned int uintErrorBufferLen, SampleThreadData * pstd, GUIElements gui)
+static BOOL main_CheckWEEGSystem(TCHAR * strErrorBuffer, unsigned int uintErrorBufferLen, GUIElements gui)
 {
 	BOOL blnSystemOK = FALSE;
 	TCHAR strBuffer[128];
@@ -168,12 +164,8 @@ static BOOL main_CheckWEEGSystem(TCHAR * strErrorBuffer, unsigned int uintErrorB
 	_stprintf_s(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("WEEG system in progress..."));
 	SendMessage(gui.hwndStatusBar, SB_SETTEXT, SB_ANNOTATIONS_PART, (LPARAM) strBuffer);
 		
-	// turn on testing and wait for completion
-	pstd->Mode = SampleThreadMode_WEEGSystemCheck;
-	SignalObjectAndWait(pstd->hevSampleThread_Start, pstd->hevSampleThread_Idle, INFINITE, FALSE);
-
-	// check result of system check
-	switch(m_wsccCheckCode)
+	// run the system check and check its result
+	switch(engine_CheckWEEGSystem(m_pesEngine))
 	{
 		case WEEGSystem_OK:
 			if(uintErrorBufferLen > 0 && strErrorBuffer != NULL)
@@ -291,7 +283,7 @@ static DWORD main_GetMaxAvailableRecordingTime(TCHAR * strPath, unsigned int * u
 		// retrieve amount of free disk space
 		if(GetDiskFreeSpaceEx(strPath,(PULARGE_INTEGER) &lngFreeBytesAvailable, NULL, NULL))
 		{
-			uintNBytesDataRecord = m_cfgConfiguration.SamplingFrequency*(EEGCHANNELS + ACCCHANNELS)*sizeof(short) + ANNOTATION_TOTAL_NCHARS*sizeof(char);
+			uintNBytesDataRecord = m_cfgConfiguration.SamplingFrequency*(util_GetNOfSelectedChannels(m_cfgConfiguration.DisplayChannelMask) + ACCCHANNELS)*sizeof(short) + ANNOTATION_TOTAL_NCHARS*sizeof(char);
 			uintAvailableRecordingTime[0] = (unsigned int) (lngFreeBytesAvailable/(uintNBytesDataRecord*3600));
 			uintAvailableRecordingTime[1] = (unsigned int) ((lngFreeBytesAvailable%(uintNBytesDataRecord*3600))/(uintNBytesDataRecord*60));
 		}
@@ -305,154 +297,42 @@ static DWORD main_GetMaxAvailableRecordingTime(TCHAR * strPath, unsigned int * u
 }
 
 /**
-* \brief Generates the full path of the final EDF+ file.
-*
-* \param[in]	StartDateTime				date and time at which the recording of the temporary EDF+ file was started
-* \param[in]	strTempEDFFilePath			pointer to NULL-terminated string containing the full path of the temporary EDF+ file
-* \param[out]	strFinalEDFFilePath			pointer to NULL-terminated string where full path of the final EDF+ file is returned
-* \param[in]	uintFinalEDFFilePathLen		size of strFinalEDFFilePath string, in characters
-*/
-static void main_GenerateFinalEDFFilePath(struct tm StartDateTime, TCHAR * strTempEDFFilePath, TCHAR * strFinalEDFFilePath, unsigned int uintFinalEDFFilePathLen)
-{
-	size_t				sztLength;
-	TCHAR				strBuffer[256];
-	TCHAR				strTemp[MAX_PATH + 1];
-	unsigned int		i;
-
-	// parse long folder path where EDF+ file will be stored
-	sztLength = _tcslen(strTempEDFFilePath) + 1;				// +1 for terminating NULL character
-	_stprintf_s(strTemp, sztLength, TEXT("%s"), strTempEDFFilePath);
-	PathRemoveFileSpec(strTemp);
-	PathAddBackslash(strTemp);
-
-	// parse EDF+ file name
-	_stprintf_s(strBuffer,
-				sizeof(strBuffer)/sizeof(WORD),
-				TEXT("%4d.%02d.%02d %02d-%02d"),
-				StartDateTime.tm_year+1900, StartDateTime.tm_mon+1, StartDateTime.tm_mday, StartDateTime.tm_hour, StartDateTime.tm_min);
-	
-	// Parse EDF+ file path; algorithm loops until the parsed filename is not found to be in use
-	i = 0;
-	_stprintf_s(strFinalEDFFilePath,
-				uintFinalEDFFilePathLen,
-				TEXT("%s%s.edf"),
-				strTemp, strBuffer);
-	while(PathFileExists(strFinalEDFFilePath))
-	{
-		_stprintf_s(strFinalEDFFilePath,
-					uintFinalEDFFilePathLen,
-					TEXT("%s%s (%02d).edf"),
-					strTemp, strBuffer, ++i);
-	};
-}
-
-/**
- * \brief Adds an annotation to the annotation buffer that will be stored with the data record being recorded at the time the annotation was made. 
+ * \brief Handles the events of the acquisition threads by passing them on to the main window.
  *
- * Function called either by the main thread or by the sample thread.
+ * Called in the context of the thread that raises the event (see engine.h).
  *
- * \param[in]	atAnnotationType	member of the AnnotationType enum indicating the type of annotation to be stored
- * \param[in]	intAnnotationId		additional annotation-specific (depends on atAnnotationType)
- * \param[in]	gui					struct containing handles to the elements of the main window's GUI
- * \param[in]	hwndMainWindow		handle to the main window
+ * \param[in]	eeEvent		event
+ * \param[in]	wParam		event-specific parameter
+ * \param[in]	lParam		event-specific parameter
+ * \param[in]	pContext	handle to the main window
  */
-static void main_InsertAnnotation(AnnotationType atAnnotationType, int intAnnotationId, GUIElements gui, HWND hwndMainWindow)
+static void main_EngineEventHandler(EngineEvent eeEvent, WPARAM wParam, LPARAM lParam, void * pContext)
 {
-	char		strCAnnotation[ANNOTATION_MAX_CHARS + 1];	///< buffer that stores char version of the annotation
-	char		strTemp[ANNOTATION_MAX_CHARS + 1];			///< temporary buffer used for converting TCHAR annotations stored stored in the CONFIGURATION structure to char strings (+1 for terminating NULL character)
-	size_t		sztNCharsConverted;							///< amount of characters converted by the wcstombs_s() function
-	struct tm	tmCurrentDateTime;							///< stores current date and time
+	HWND hwndMainWindow = (HWND) pContext;
 
-	// Variable initialization
-	tmCurrentDateTime = util_GetCurrentDateTime();
-	strCAnnotation[0] = '\0';
-
-	//
-	// parse annotation string
-	//
-	switch(atAnnotationType)
+	switch(eeEvent)
 	{
-		case CommunicationFailure:
-			sprintf_s(strCAnnotation, _countof(strCAnnotation),
-					  "%02d:%02d:%02d Communication failure%c",
-					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec, (char) 20);
-		break;
-		
-		case CommunicationResume:
-			sprintf_s(strCAnnotation, _countof(strCAnnotation),
-					  "%02d:%02d:%02d Communication restart%c",
-					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec, (char) 20);
+		case EngineEvent_Stop:
+			PostMessage(hwndMainWindow, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) wParam);
 		break;
 
-		case CoordinatorInserted:
-			sprintf_s(strCAnnotation, _countof(strCAnnotation),
-					  "%02d:%02d:%02d Coordinator plugged-in%c",
-					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec, (char) 20);
+		case EngineEvent_Error:
+			MsgPrintf(hwndMainWindow, (int) wParam, TEXT("%s"), (TCHAR *) lParam);
 		break;
 
-		case CoordinatorRemoved:
-			sprintf_s(strCAnnotation, _countof(strCAnnotation),
-					  "%02d:%02d:%02d Coordinator removed%c",
-					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec, (char) 20);
+		// the text has to be copied before the handler returns
+		case EngineEvent_Annotation:
+			SendMessage(hwndMainWindow, EEGEMMsg_StatusBar_SetAnnotation, FALSE, lParam);
 		break;
 
-		case Now:
-			sprintf_s(strCAnnotation, _countof(strCAnnotation),
-					  "Now %d%c",
-					  ++m_intNNowAnnotations, (char) 20);
+		case EngineEvent_ReplayStatus:
+			PostMessage(hwndMainWindow, EEGEMMsg_StatusBar_SetReplayStatus, wParam, lParam);
 		break;
 
-		case Regular:
-			wcstombs_s(&sztNCharsConverted, strTemp, sizeof(strTemp), m_cfgConfiguration.Annotations[intAnnotationId], sizeof(strTemp));
-			sprintf_s(strCAnnotation, _countof(strCAnnotation),
-					  "%s%c",
-					  strTemp, (char) 20);
+		case EngineEvent_StreamingStatus:
+			PostMessage(hwndMainWindow, EEGEMMsg_Streaming_DisplayStatus, wParam, 0);
 		break;
 	}
-
-	// Wait on annotation mutex
-	WaitForSingleObject(m_hMutexAnnotation, INFINITE);
-	
-	// Save annotation string to the annotation buffer
-	if(m_intNAnnotationsBuffered < ANNOTATION_MAX_NO)
-	{
-		strcat_s(m_strCurrentDRAnnotations, ANNOTATION_TOTAL_NCHARS, strCAnnotation);
-		m_intNAnnotationsBuffered++;
-	}
-	
-	ReleaseMutex(m_hMutexAnnotation);
-
-	// display annotation in status bar
-	SendMessage(hwndMainWindow, EEGEMMsg_StatusBar_SetAnnotation, FALSE, (LPARAM) strCAnnotation);
-}
-
-/**
- * \brief Initializes the annotations signal for the current data record.
- *
- * \param[in]	strAnnotation		char string where annotation signal is stored
- * \param[in]	uintAnnotationLen	size of strAnnotation, in characters
- * \param[in]	uintTAL				time-stamp of the current data record
- */
-static void main_InitAnnotationSignal(char * strAnnotation, unsigned int uintAnnotationLen, unsigned int uintTAL)
-{
-#ifdef _DEBUG
-	// needed because sprintf_s() fills buffer with garbage after the NULL character when in DEBUG mode
-	char strBuffer[ANNOTATION_TOTAL_NCHARS];
-	
-	// initialize annotation buffer
-	SecureZeroMemory(strAnnotation, uintAnnotationLen*sizeof(char));
-
-	// initialize signal
-	strAnnotation[0] = '\0';
-	sprintf_s(strBuffer, _countof(strBuffer), "+%d%c%c", uintTAL, (char) 20, (char) 20);
-	strcat_s(strAnnotation,
-			 (min(strlen(strBuffer) + 1, uintAnnotationLen))*sizeof(char),
-			 strBuffer);
-#else
-	// initialize signal
-	SecureZeroMemory(strAnnotation, uintAnnotationLen*sizeof(char));
-	sprintf_s(strAnnotation, uintAnnotationLen, "+%d%c%c", uintTAL, (char) 20, (char) 20);
-#endif
 }
 
 /**
@@ -666,7 +546,6 @@ int APIENTRY WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdL
 	m_blnPortraitOrientation = FALSE;
 	m_blnIsFullScreen = FALSE;
 	m_hinMain = hInstance;
-	m_wsccCheckCode = WEEGSystem_INVALID;
 
 	// install own abnormal termination routine (to catch unhandled errors)
 	set_terminate(main_AbnormalProgramTermination);
@@ -824,13 +703,12 @@ int APIENTRY WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdL
 static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG lParam)
 {
 	BOOL					blnErrorOccured = FALSE;
-	DWORD					ThreadId;
+	char					strCSimulationEDFFile[MAX_PATH + 1];	///< full path of the EDF+ file replayed in the Simulation mode
 	DWORD					dwReturnValue;
-	EDFFileHandle *			phEDFFile;
 	HDC						hDC;
 	HMODULE					hlibRichEditV2;
 	float					f;
-	HANDLE					hEDFPlusFile;						///< handle for the final EDF+ file
+	EngineStatus			esStatus;
 	int						i;
 	PAINTSTRUCT				PS;
 	PDEV_BROADCAST_PORT		pdbhPortBroadcast;
@@ -843,31 +721,14 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 	static GUIElements		gui;
 	static BYTE				epExitPermission = ExitPermission_Allowed;
 	static TCHAR			strFinalEDFFilePath[MAX_PATH + 1];	///< path where final EDF+ file will be stored
-	static TCHAR			strTempEDFFilePath[MAX_PATH + 1];	///< path where temporary EDF+ file will be stored
 	static TCHAR			strStatusBarStatus[256];			///< stores string to be displayed in the status bar's status part
 	static TCHAR			strStatusBarAnnotation[256];		///< stores string to be displayed in the status bar's annotation part
-	static unsigned short	ushrEDFPlusHeaderBufferLenByt = 0;	///< size of the \a pEDFPlusHeaderBuffer, in bytes
-	static void *			pEDFPlusHeaderBuffer;				///< pointer to buffer where complete EDF+ header record is stored
-	static struct tm		tmRecordingStartDateTime;			///< date & time at which the recording of the temporary EDF+ file was started (used when generating the file name of the final EDF+ file)
 	TCHAR					strBuffer[256], strRecordedEDFFilePath[MAX_PATH_UNICODE + 1];
 	TCHAR *					strTemp, * strTemp2;
 	unsigned int			j, k, l, uintNNewSamples;
 	UploadThreadData		utd;
 	WINDOWINFO				wi;
 	
-	// sample thread variables
-	static HANDLE						hSampleThread;				///< handle to Sampling thread
-	static SampleThreadData				std;
-
-	// storage thread variables
-	static HANDLE						hStorageThread;				///< handle to Storage thread
-	static StorageThreadData			sttd;
-
-	// streaming thread variables
-	static HANDLE						hStreamingThread;			///< handle to Streaming thread
-	static StreamingClientThreadData	sctd;
-	static SimulationModeData			smd;
-
 	// upload thread variables
 	static HANDLE						hUploadThread;				///< handle to Upload thread
 
@@ -876,13 +737,16 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 
 	static int LastNOfPackets = 0;
 
-	// Buffers for samples to be used when measuring and displaying simultenously
-	//static short shrSampleBuffer [EEGCHANNELS + ACCCHANNELS][SAMPLE_BUFFER_LENGTH];
-	static short ** pshrSampleBuffer;
+	// samples to be displayed, read in place from the sample ring
+	static short * pshrSampleBuffer[EEGCHANNELS + ACCCHANNELS];		///< first unread sample of each channel of the sample ring
+	static short * pshrEEGSamples[EEGCHANNELS];						///< rows of pshrSampleBuffer that contain the measured EEG channels
+	unsigned long ulngFrontalSignalMask;
 	
 	// Graphics variables
 	unsigned int uintEEGNewSamplesStartID;
 	unsigned int uintAEEGNewSamplesStartID;
+	static unsigned int uintERPNEpochsDisplayed = 0;
+	static BOOL blnRedrawERP = FALSE;
 
 	// GUI Variables
 	OPENFILENAME ofn;
@@ -892,10 +756,6 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 	switch (message)
 	{
 		case WM_CREATE:
-			// Create mutex objects for: annotations buffer, sample buffer and data records linked list
-			m_hMutexAnnotation = CreateMutex(NULL, FALSE, NULL);
-			m_hMutexSampleBuffer = CreateMutex(NULL, FALSE, NULL);
-
 			//
 			// Read settings from configuration file
 			//
@@ -912,120 +772,14 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 			//
 			applog_init(NULL, m_cfgConfiguration.ApplicationDataPath, NULL, 0);
 			applog_logevent(Version, TEXT("EEGEM"), SOFTWARE_VERSION, 0, FALSE);
-			
-			//
-			// create sample thread and associated synchronization events
-			//
-			// initialize data structure that will be passed to the thread
-			std.pgui = &gui;
-			std.pSamplingFrequency = &m_cfgConfiguration.SamplingFrequency;
-			std.hevSampleThread_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
-			std.hevSampleThread_Idle = CreateEvent(NULL, FALSE, FALSE, NULL);
-			std.hevSampleThread_Init = CreateEvent(NULL, FALSE, FALSE, NULL);
-			
-			// Create sample thread and set its priority
-			hSampleThread = CreateThread (NULL,										// handle cannot be inherited by child processes
-										  4096,										// initial size of the stack, in bytes
-										  (LPTHREAD_START_ROUTINE) Sample_Thread,	// pointer to the function to be executed by the thread
-										  &std,										// pointer to a variable to be passed to the thread
-										  0,										// thread runs immediately after creation
-										  &ThreadId);								// variable where thread identifier is stored
-			if (hSampleThread == NULL)
-			{
-				applog_logevent(SoftwareError, TEXT("Main"), TEXT("WM_CREATE: Failed to create sample thread. (GetLastError #)"), GetLastError(), TRUE);
-				MsgPrintf(NULL, MB_ICONERROR, TEXT("WM_CREATE: Failed to create sample thread. (GetLastError #: %d)\nPlease restart the software!"), GetLastError());
-			}
-			else
-			{
-				// set sample thread priority
-				SetThreadPriority (hSampleThread, THREAD_PRIORITY_TIME_CRITICAL);
-			
-				// ensure sample is in Idle state
-				WaitForSingleObject(std.hevSampleThread_Idle, INFINITE);
-			}
 
-			//
-			// create storage thread and associated synchronization events
-			//
-			// create Storage thread events
-			sttd.hevStorageThread_Idling = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sttd.hevStorageThread_Init_End = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sttd.hevStorageThread_Init_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sttd.hevStorageThread_Write = std.hevStorageThread_Write = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sttd.StopStorage = FALSE;
-			sttd.pcfg = &m_cfgConfiguration;
-
-			// Create storage thread and set its priority
-			hStorageThread = CreateThread (NULL,									// handle cannot be inherited by child processes
-										   4096,									// initial size of the stack, in bytes
-										   (LPTHREAD_START_ROUTINE) Storage_Thread,	// pointer to the function to be executed by the thread
-										   &sttd,									// pointer to a variable to be passed to the thread
-										   0,										// thread runs immediately after creation
-										   &ThreadId);								// variable where thread identifier is stored
-			if (hStorageThread == NULL)
-			{
-				applog_logevent(SoftwareError, TEXT("Main"), TEXT("WM_CREATE: Failed to create storage thread. (GetLastError #)"), GetLastError(), TRUE);
-				MsgPrintf(NULL, MB_ICONERROR, TEXT("WM_CREATE: Failed to create storage thread. (GetLastError #: %d)\nPlease restart the software!"), GetLastError());
-			}
-			else
-			{
-				// set storage thread priority
-				SetThreadPriority (hStorageThread, THREAD_PRIORITY_NORMAL);
-
-				// ensure storage thread is in Idle state
-				WaitForSingleObject(sttd.hevStorageThread_Idling, INFINITE);
-			}
-
-			//
-			// create streaming thread and associated synchronization events
-			//
-			sctd.ExitThread = FALSE;
-			sctd.EndTransmission = FALSE;
-			sctd.hevThreadInit_Complete = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.hevVortexClient_Connect_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.hevVortexClient_Connecting_Start = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.hevVortexClient_Connecting_End = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.hevVortexClient_Exiting = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.hevVortexClient_Transmit = std.hevVortexClient_Transmit = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.hevVortexClient_WaitingToConnect = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.hevVortexClient_WaitingToTransmit = CreateEvent(NULL, FALSE, FALSE, NULL);
-			sctd.pMaxNSendMsgFailures = &m_cfgConfiguration.Streaming_MaxNSendMsgFailures;
-			sctd.pMaxNWait4ReplyFailures = &m_cfgConfiguration.Streaming_MaxNWait4ReplyFailures;
-			sctd.pServerIPv4Address_Field0 = &m_cfgConfiguration.Streaming_Server_IPv4_Field0;
-			sctd.pServerIPv4Address_Field1 = &m_cfgConfiguration.Streaming_Server_IPv4_Field1;
-			sctd.pServerIPv4Address_Field2 = &m_cfgConfiguration.Streaming_Server_IPv4_Field2;
-			sctd.pServerIPv4Address_Field3 = &m_cfgConfiguration.Streaming_Server_IPv4_Field3;
-			sctd.pServerPort = &m_cfgConfiguration.Streaming_Server_Port;
-
-			// create streaming thread
-			hStreamingThread = CreateThread (NULL,											// pointer to a SECURITY_ATTRIBUTES structure that determines whether the returned handle can be inherited by child processes
-											 4096,											// initial size of the stack, in bytes
-											 (LPTHREAD_START_ROUTINE) Streaming_Thread,		// pointer to the application-defined function to be executed by the thread
-											 &sctd,											// pointer to a variable to be passed to the thread
-											 0,												// flags that control the creation of the thread
-											 NULL);											// (optional) pointer to a variable that receives the thread identifier
-			if (hStreamingThread == NULL)
-			{
-				applog_logevent(SoftwareError, TEXT("Main"), TEXT("WM_CREATE: Failed to create streaming thread. (GetLastError #)"), GetLastError(), TRUE);
-				MsgPrintf(NULL, MB_ICONERROR, TEXT("WM_CREATE: Failed to create streaming thread. (GetLastError #: %d)\nPlease restart the software!"), GetLastError());
-			}
-			else
-			{
-				// set storage thread priority
-				SetThreadPriority (hStreamingThread, THREAD_PRIORITY_TIME_CRITICAL);
+			// the acquisition threads report to the main window through the engine's events
+			engine_SetEventHandler(main_EngineEventHandler, hWnd);
 
-				// ensure streaming thread is in Waiting2Connect state
-				WaitForSingleObject(sctd.hevThreadInit_Complete, INFINITE);
-				if(WaitForSingleObject(hStreamingThread, 250) == WAIT_OBJECT_0)
-				{
-					applog_logevent(SoftwareError, TEXT("Main"), TEXT("WM_CREATE: An error occured while creating the streaming thread."), 0, TRUE);
-					MsgPrintf(NULL, MB_ICONERROR, TEXT("WM_CREATE: An error occured while creating the streaming thread.\nPlease restart the software!"), GetLastError());
-				}
-				else
-				{
-					WaitForSingleObject(sctd.hevVortexClient_WaitingToConnect, INFINITE);
-				}
-			}
+			// create the sample, storage and streaming threads (the engine reports its errors through the handler)
+			m_pesEngine = engine_CreateSession(&m_cfgConfiguration, TRUE);
+			if(m_pesEngine == NULL)
+				return -1;
 
 			//
 			// create WiFi thread and associated synchronization events
@@ -1106,6 +860,11 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 						GraphicsEngine_AEEG_DrawDynamicOld(hDC, m_pdblAEEGDisplayBuffer, m_uintAEEGDisplayBufferID);
 					break;
 
+					case SM_ERP:
+						GraphicsEngine_EEG_DrawStatic(hDC);
+						GraphicsEngine_EEG_DrawDynamicOld(hDC, m_pdblERPDisplayBuffer, m_uintEEGDisplayBufferLength, m_dblEEGYScale);
+					break;
+
 					default:
 						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - WM_PAINT: Invalid SignalMode code detected."), 0, TRUE);
 						MsgPrintf(hWnd, MB_ICONERROR, TEXT("%s"), TEXT("MainWndProc() - WM_PAINT: Invalid SignalMode code detected."));
@@ -1122,7 +881,7 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 
 				if(!m_cfgConfiguration.SimulationMode)
 				{
-					main_CheckWEEGSystem(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), &std, gui);
+					main_CheckWEEGSystem(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), gui);
 				}
 			}
 		break;
@@ -1203,24 +962,11 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					//
 					// display new signal samples
 					//
-					if(m_uintNNewSamples > 0)
+					// NOTE: the samples are processed in place and handed back to the sample ring once they have been displayed
+					if((uintNNewSamples = samplering_Peek(pshrSampleBuffer)) > 0)
 					{
-						// reserve m_shrSampleBuffer buffer so that data is not added by the sampling thread
-						WaitForSingleObject(m_hMutexSampleBuffer, INFINITE);
-
-						// copy m_uintSampleBufferLength * sizeof (short) bytes from m_shrSampleBuffer[i]
-						// to shrSampleBuffer [i] that is SAMPLE_BUFFER_LENGTH*sizeof(short) bytes large
-						for (i=0; i<(EEGCHANNELS + ACCCHANNELS); i++)
-						{
-							memcpy_s(pshrSampleBuffer [i], m_uintSampleBufferLength*sizeof(short),
-									 m_pshrSampleBuffer[i], m_uintNNewSamples*sizeof(short));
-						}
-						
-						uintNNewSamples = m_uintNNewSamples;
-						m_uintNNewSamples = 0;
-				
-						// release m_shrSampleBuffer buffer so that it can be used by the sampling thread
-						ReleaseMutex(m_hMutexSampleBuffer);
+						for (i = 0; i < (int) m_uintNEEGChannels; i++)
+							pshrEEGSamples[i] = pshrSampleBuffer[m_uintEEGChannelIDs[i]];
 
 						uintEEGNewSamplesStartID = m_uintEEGDisplayBufferID;
 						uintAEEGNewSamplesStartID = m_uintAEEGDisplayBufferID;
@@ -1243,10 +989,14 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 						// NOTE: -1 offset needed in order to compensate for the "Off" item
 						m_cfgConfiguration.LPFilterIndex = ((int) SendMessage(gui.hwndCMBLPFilters, CB_GETCURSEL, 0, 0)) - 1; 
 						
+						// remove eye-blink & muscle artifacts (no-op if module is disabled)
+						ica_Process(pshrEEGSamples, uintNNewSamples);
+
 						// Filter EEG samples
-						//sp_FilterEEGSignal(m_pshrSampleBuffer, m_pdblEEGDisplayBuffer, m_uintEEGDisplayBufferLength, &m_uintEEGDisplayBufferID, uintNNewSamples, m_cfgConfiguration.LPFilterIndex);
-						//sp_FilterAEEGSignal(m_pshrSampleBuffer, m_pdblAEEGDisplayBuffer, m_uintAEEGDisplayBufferLength, &m_uintAEEGDisplayBufferID, uintNNewSamples);
-						sp_FilterAllPass(m_pshrSampleBuffer, m_pdblEEGDisplayBuffer, m_uintEEGDisplayBufferLength, &m_uintEEGDisplayBufferID, uintNNewSamples);
+						// NOTE: the sample thread does not touch the samples until they are released
+						//sp_FilterEEGSignal(m_pspcDisplayFilters, pshrSampleBuffer, m_pdblEEGDisplayBuffer, m_uintEEGDisplayBufferLength, &m_uintEEGDisplayBufferID, uintNNewSamples, m_cfgConfiguration.LPFilterIndex);
+						//sp_FilterAEEGSignal(m_pspcDisplayFilters, pshrSampleBuffer, m_pdblAEEGDisplayBuffer, m_uintAEEGDisplayBufferLength, &m_uintAEEGDisplayBufferID, uintNNewSamples);
+						sp_FilterAllPass(m_pspcDisplayFilters, pshrSampleBuffer, m_pdblEEGDisplayBuffer, m_uintEEGDisplayBufferLength, &m_uintEEGDisplayBufferID, uintNNewSamples);
 
 						// Plot curves
 						hDC = GetDC (hWnd);
@@ -1262,31 +1012,59 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 								//GraphicsEngine_DrawDynamicNewAEEG(hDC, m_dblAEEGDisplayBuffer, uintAEEGNewSamplesStartID, uintNNewSamples);
 							break;
 
+							case SM_ERP:
+								// average is only redrawn when a new epoch has been added to it
+								if(erp_GetNEpochs() != uintERPNEpochsDisplayed)
+								{
+									uintERPNEpochsDisplayed = erp_GetAverage(m_pdblERPAverage, NULL, m_uintEEGDisplayBufferLength);
+									blnRedrawERP = TRUE;
+								}
+							break;
+
 							default:
 								applog_logevent(SoftwareError, TEXT("Main"), TEXT("IDT_REDRAW_TIMER: Invalid m_smCurrentSignalMode value."), 0, TRUE);
 						}
 						ReleaseDC (hWnd, hDC);
+						latency_Complete(LatencyStage_Display);
+
+						// erase window (triggers a WM_PAINT message i.e. redrawing of the updated average)
+						if(blnRedrawERP)
+						{
+							blnRedrawERP = FALSE;
+
+							rc = GraphicsEngine_GetDrawingRect();
+							rc.right++;
+							rc.bottom++;
+							RedrawWindow(hWnd, &rc, NULL, RDW_ERASE | RDW_INVALIDATE | RDW_UPDATENOW);
+
+							_stprintf_s (strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("ERP: %u epochs averaged"), uintERPNEpochsDisplayed);
+							SendMessage (hWnd, EEGEMMsg_StatusBar_SetAnnotation, TRUE, (LPARAM) strBuffer);
+						}
 
 						// Update status text
-						if (LastNOfPackets != m_lngNPacketsReceived)
+						engine_GetStatus(m_pesEngine, &esStatus);
+						if (LastNOfPackets != esStatus.NPacketsReceived)
 						{
 							// display recording status in the status bar
 							_stprintf_s (strBuffer,
 											sizeof(strBuffer)/sizeof(TCHAR),
 											TEXT("%d pkts., %d errs., %dHz"),
-											m_lngNPacketsReceived,
-											m_lngNPacketChecksumErrors + m_intNPacketsLost,
+											esStatus.NPacketsReceived,
+											esStatus.NPacketChecksumErrors + esStatus.NPacketsLost,
 											m_cfgConfiguration.SamplingFrequency);
 							SendMessage (hWnd, EEGEMMsg_StatusBar_SetStatus, 0, (LPARAM) strBuffer);
 
-							LastNOfPackets = m_lngNPacketsReceived;
+							LastNOfPackets = esStatus.NPacketsReceived;
 						}
+
+						samplering_Release(uintNNewSamples);
 					}
 				break;
 
 				case IDT_BATSTATUS_TIMER:
 					// set battery status icon
-					if(m_blnBatteryLow)
+					engine_GetStatus(m_pesEngine, &esStatus);
+					if(esStatus.BatteryLow)
 					{
 						if(m_blnBatteryLowBlink)
 							PostMessage (gui.hwndStatusBar, SB_SETICON, SB_BATTERYICON_PART, (LPARAM) gui.hIconsBatteryStates[1]);
@@ -1342,7 +1120,7 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 				i += wi.rcClient.left;
 				j += wi.rcClient.top;
 
-				GUI_DisplayAnnotationsContextMenu(hWnd, i, j, gui, hWnd);
+				GUI_DisplayAnnotationsContextMenu(hWnd, i, j, gui);
 			}
 		break;
 
@@ -1425,7 +1203,7 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 				case IDM_SYSTEMCHECK:
 					// check WEEG system
 					i = IDRETRY;
-					while(i == IDRETRY && !main_CheckWEEGSystem(strBuffer,sizeof(strBuffer)/sizeof(TCHAR), &std, gui))
+					while(i == IDRETRY && !main_CheckWEEGSystem(strBuffer,sizeof(strBuffer)/sizeof(TCHAR), gui))
 					{
 						i = MessageBox(hWnd,
 									   strBuffer,
@@ -1490,6 +1268,26 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 						break;
 
 						case SM_aEEG:
+							// change to ERP signal mode
+							m_smCurrentSignalMode = SM_ERP;
+
+							// fetch current average so that it is drawn by the WM_PAINT handler
+							uintERPNEpochsDisplayed = erp_GetNEpochs();
+							erp_GetAverage(m_pdblERPAverage, NULL, m_uintEEGDisplayBufferLength);
+
+							// disable timebase and filter selection combo boxes (time axis always spans one epoch)
+							ComboBox_Enable(gui.hwndCMBLPFilters, FALSE);
+							ComboBox_Enable(gui.hwndCMBTimebase, FALSE);
+
+							// erase window (triggers a WM_PAINT message i.e. drawing of the static components and of the current average)
+							// NOTE: RedrawWindow function does not take into account right and bottom border of rectangle => compensated with ++
+							rc = GraphicsEngine_GetDrawingRect();
+							rc.right++;
+							rc.bottom++;
+							RedrawWindow(hWnd, &rc, NULL, RDW_ERASE | RDW_INVALIDATE | RDW_UPDATENOW);
+						break;
+
+						case SM_ERP:
 							// change to EEG signal mode
 							m_smCurrentSignalMode = SM_EEG;
 
@@ -1539,7 +1337,8 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					if(GetOpenFileName(&ofn) == TRUE)
 					{
 						// convert path from TCHAR to char
-						wcstombs_s(&sztLength, smd.strSimulationEDFFile, sizeof(smd.strSimulationEDFFile), ofn.lpstrFile, sizeof(smd.strSimulationEDFFile));
+						wcstombs_s(&sztLength, strCSimulationEDFFile, sizeof(strCSimulationEDFFile), ofn.lpstrFile, sizeof(strCSimulationEDFFile));
+						engine_SetSimulationFile(m_pesEngine, strCSimulationEDFFile);
 					}
 				break;
 
@@ -1561,11 +1360,9 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					// TODO: clean-up code
 				break;
 
-				// Show error counters
+				// Show link statistics
 				case IDM_ERRORS:
-					MsgPrintf (hWnd, 0,
-							   TEXT("Checksum errors\t: %d\nLost packets\t: %d"),
-							   m_lngNPacketChecksumErrors, m_intNPacketsLost);
+					DialogBox (m_hinMain, MAKEINTRESOURCE (IDD_LINKSTATISTICS), hWnd, (DLGPROC) Dialog_LinkStatistics);
 				break;
 
 				// Close program; WM_DESTROY cleans things up
@@ -1575,60 +1372,24 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 
 				case IDM_SAMPLE_START:
 					// variable initialization required for each sampling run
-					m_blnIsAnnotationsMenuDisplayed = m_blnCommunicationBlackout = m_blnBatteryLowBlink = m_blnBatteryLow = FALSE;
+					m_blnIsAnnotationsMenuDisplayed = m_blnBatteryLowBlink = FALSE;
 					gui.hmnuAnnotations = NULL;
 					m_uintEEGDisplayBufferID = m_uintAEEGDisplayBufferID = 0;
-					m_intNSamplesDatarecord = m_intNDataRecords = 0; // Set the counter of data records in EDF+ file to zero
 					m_smCurrentSignalMode = SM_EEG;
-					m_uintNNewSamples = m_uintEEGDisplayBufferLength = 0;
+					m_uintEEGDisplayBufferLength = 0;
 					LastNOfPackets = 0;
 
-					// initialize annotations-related variables
-					m_uintTimeKeepingTAL = 0;
-					m_intNNowAnnotations = m_intNAnnotationsBuffered = 0;
-					main_InitAnnotationSignal(m_strCurrentDRAnnotations, _countof(m_strCurrentDRAnnotations), m_uintTimeKeepingTAL);
-
 					// initialize variable that will keep track of recording time
 					m_tmRecordingTime.tm_hour = 0;
 					m_tmRecordingTime.tm_min = 0;
 					m_tmRecordingTime.tm_sec = 0;
 
 					// check status of WEEG system (if not in Simulation mode)
-					if(m_cfgConfiguration.SimulationMode)
-					{
-						// check if simulation file has been loaded
-						if(strlen(smd.strSimulationEDFFile) > 0)
-						{
-							phEDFFile = libEDF_openFile(smd.strSimulationEDFFile);
-							if(phEDFFile != NULL)
-							{
-								// when in Simulation mode, sampling frequency used depends on the EDF+ file that is loaded
-								m_cfgConfiguration.SamplingFrequency = phEDFFile->SignalHeaders[0].NSamplesPerDataRecord;
-
-								// close EDF file
-								libEDF_closeFile(phEDFFile);
-							}
-							else
-							{
-								applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Could not load EDF+ file."), 0, TRUE);
-								MsgPrintf(hWnd, MB_ICONSTOP, TEXT("MainWndProc() - IDM_SAMPLE_START: Could not load EDF+ file."), 0);
-								PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-								break;
-							}
-						}
-						else
-						{
-							applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: No simulation file loaded."), 0, TRUE);
-							MsgPrintf(hWnd, MB_ICONERROR, TEXT("MainWndProc() - IDM_SAMPLE_START: No simulation file loaded."));
-							PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-							break;
-						}
-					}
-					else
+					if(!m_cfgConfiguration.SimulationMode)
 					{
 						// check WEEG system
 						i = IDRETRY; blnErrorOccured = FALSE;
-						while(i == IDRETRY && !main_CheckWEEGSystem(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), &std, gui))
+						while(i == IDRETRY && !main_CheckWEEGSystem(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), gui))
 						{
 							i = MessageBox(hWnd,
 										   strBuffer,
@@ -1648,9 +1409,18 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 
 					// set exit status
 					PostMessage(hWnd, EEGEMMsg_ExitPermission_Set, ExitPermission_Denied_Recording, 0);
-					
+
+					// start the recording: the engine stores the EDF+ header record, connects to the streaming server and starts the sample thread
+					if(!engine_StartRecording(m_pesEngine, &m_piPatientInfo, &m_riRecordingInfo))
+					{
+						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
+						break;
+					}
+					m_uintNEEGChannels = engine_GetEEGChannels(m_pesEngine, m_uintEEGChannelIDs);
+
 					// initialize signal processing module
-					if(!sp_init())
+					m_pspcDisplayFilters = sp_CreateContext((unsigned int) (m_cfgConfiguration.BaselineWindowTime*m_cfgConfiguration.SamplingFrequency/1000));
+					if(m_pspcDisplayFilters == NULL)
 					{
 						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to initialize signal processing module."), 0, TRUE);
 						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
@@ -1658,9 +1428,26 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 						break;
 					}
 
-					// mark start of recording in application log & log start of recording
-					applog_startgrouping(TEXT("Recording"), TRUE);
-					applog_logevent(General, TEXT("Main"), TEXT("Recording Started"), 0, TRUE);
+					// initialize artifact removal module (needs at least two EEG signals to separate)
+					if(m_cfgConfiguration.ICA_Enabled && m_uintNEEGChannels < 2)
+					{
+						applog_logevent(General, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Artifact removal disabled, since it requires at least two EEG channels."), 0, TRUE);
+					}
+					else if(m_cfgConfiguration.ICA_Enabled)
+					{
+						for(i = 0, ulngFrontalSignalMask = 0; i < (int) m_uintNEEGChannels; i++)
+						{
+							if(mc_ulngFrontalChannelMask & (0x01 << m_uintEEGChannelIDs[i]))
+								ulngFrontalSignalMask |= (0x01 << i);
+						}
+						if(!ica_init(m_uintNEEGChannels, m_cfgConfiguration.SamplingFrequency, m_cfgConfiguration.ICA_WindowTime, m_cfgConfiguration.ICA_UpdateInterval, ulngFrontalSignalMask))
+						{
+							applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to initialize artifact removal module."), 0, TRUE);
+							PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
+							blnErrorOccured = TRUE;
+							break;
+						}
+					}
 
 					// compute maximum number of data samples that can be stored in the display buffers at any one time if the longest
 					// timebase is selected
@@ -1721,55 +1508,13 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 						break;
 					}
 
-					m_pdblDisplayBufferTemp = (double *) malloc(sizeof(double)*(m_uintNMaxSamples));
-					if(m_pdblDisplayBufferTemp == NULL)
-					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("IDM_SAMPLE_START: Failed to allocate memory for m_pdblDisplayBufferTemp. (errno #)"), errno, TRUE);
-						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-						break;
-					}
-
-					// although the sample buffer shouldn't be bigger than about 100-150 samples
-					// the number of samples being stored temporarily spikes sometimes when the system
-					// is busy with other high-priority tasks (was 400 for 200 Hz, i.e., should be about 2*sampling frequency)
-					m_uintSampleBufferLength = m_cfgConfiguration.SamplingFrequency*3;
-					m_pshrSampleBuffer = (short **) malloc(sizeof(short *)*(EEGCHANNELS + ACCCHANNELS));
-					blnErrorOccured = FALSE;
-					if(m_pshrSampleBuffer != NULL)
-					{
-						for(i=0; i < (EEGCHANNELS + ACCCHANNELS); i++)
-						{
-							m_pshrSampleBuffer[i] = (short *) malloc(sizeof(short)*m_uintSampleBufferLength);
-							if(m_pshrSampleBuffer[i] == NULL)
-							{
-								blnErrorOccured = TRUE;
-								break;
-							}
-						}
-					}
-					else
-					{
-						blnErrorOccured = TRUE;
-					}
-					if(blnErrorOccured)
-					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to allocate memory for m_pshrSampleBuffer. (errno #)"), errno, TRUE);
-						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-						break;
-					}
-					for (i = 0; i < (EEGCHANNELS + ACCCHANNELS); i++)
-					{
-						for (j = 0; j < m_uintSampleBufferLength; j++)
-							m_pshrSampleBuffer [i][j] = 0;
-					}
-
-					pshrSampleBuffer = (short **) malloc(sizeof(short *)*(EEGCHANNELS + ACCCHANNELS));
-					if(pshrSampleBuffer != NULL)
+					m_pdblERPDisplayBuffer = (double **) calloc(EEGCHANNELS + ACCCHANNELS, sizeof(double *));
+					if(m_pdblERPDisplayBuffer != NULL)
 					{
 						for(i=0; i < (EEGCHANNELS + ACCCHANNELS); i++)
 						{
-							pshrSampleBuffer[i] = (short *) malloc(sizeof(short)*m_uintSampleBufferLength);
-							if(pshrSampleBuffer[i] == NULL)
+							m_pdblERPDisplayBuffer[i] = (double *) calloc(m_uintNMaxSamples, sizeof(double));
+							if(m_pdblERPDisplayBuffer[i] == NULL)
 							{
 								blnErrorOccured = TRUE;
 								break;
@@ -1782,75 +1527,21 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					}
 					if(blnErrorOccured)
 					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to allocate memory for pshrSampleBuffer. (errno #)"), errno, TRUE);
-						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-						break;
-					}
-					for (i = 0; i < (EEGCHANNELS + ACCCHANNELS); i++)
-					{
-						for (j = 0; j < m_uintSampleBufferLength; j++)
-							pshrSampleBuffer [i][j] = 0;
-					}
-
-					//
-					// signal storage thread to move to writing state
-					//
-					sttd.StopStorage = FALSE;
-					SignalObjectAndWait(sttd.hevStorageThread_Init_Start, sttd.hevStorageThread_Init_End, INFINITE, FALSE);
-					if(Storage_GetMainFSMState() != STS_Write)
-					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: An error occured while initializing the Storage thread."), 0, TRUE);
+						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to allocate memory for m_pdblERPDisplayBuffer. (errno #)"), errno, TRUE);
 						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
 						break;
 					}
+					for(i=0; i < (int) m_uintNEEGChannels; i++)
+						m_pdblERPAverage[i] = m_pdblERPDisplayBuffer[m_uintEEGChannelIDs[i]];
 
-					// initialize EDF+ record storage structures
-					if(edf_InitHeaderStructures(&m_piPatientInfo, &m_riRecordingInfo) != 0)
+					m_pdblDisplayBufferTemp = (double *) malloc(sizeof(double)*(m_uintNMaxSamples));
+					if(m_pdblDisplayBufferTemp == NULL)
 					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to initialize EDF+ header structures. (errno #)"), i, TRUE);
+						applog_logevent(SoftwareError, TEXT("Main"), TEXT("IDM_SAMPLE_START: Failed to allocate memory for m_pdblDisplayBufferTemp. (errno #)"), errno, TRUE);
 						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
 						break;
 					}
 
-					//
-					// store EDF+ header in temporary file and send to streaming server (if enabled)
-					//
-					// generate EDF+ header record
-					ushrEDFPlusHeaderBufferLenByt = edf_CalculateEDFplusHeaderRecord(EEGCHANNELS + ACCCHANNELS + 1);			// +1 for annotations signal
-					pEDFPlusHeaderBuffer = malloc(ushrEDFPlusHeaderBufferLenByt + 1);											// +1 for terminating null character
-					if(pEDFPlusHeaderBuffer != NULL)
-					{
-						tmRecordingStartDateTime = util_GetCurrentDateTime();
-
-						if(edf_GenerateEDFplusHeaderRecord(TRUE, m_piPatientInfo, m_riRecordingInfo, m_cfgConfiguration.SamplingFrequency,
-															m_intNDataRecords, EEGCHANNELS, ACCCHANNELS, m_cfgConfiguration.ElectrodeType,
-															(char *) pEDFPlusHeaderBuffer, ushrEDFPlusHeaderBufferLenByt + 1))	// +1 for terminating null character
-						{
-							// send to storage thread
-							if(!Storage_AddToQueue((BYTE *) pEDFPlusHeaderBuffer, ushrEDFPlusHeaderBufferLenByt, TRUE, sttd.hevStorageThread_Write))
-							{
-								applog_logevent(SoftwareError, TEXT("Main"), TEXT("IDM_SAMPLE_START: Unable to add EDF+ header record to the storage thread's write queue."), 0, TRUE);
-								MsgPrintf(hWnd, MB_ICONSTOP, TEXT("IDM_SAMPLE_START: Unable to add EDF+ header record to the storage thread's write queue."));
-								PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-								break;
-							}
-						}
-						else
-						{
-							applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Unable to generate EDF+ header record."), 0, TRUE);
-							MsgPrintf(hWnd, MB_ICONSTOP, TEXT("MainWndProc() - IDM_SAMPLE_START: Unable to generate EDF+ header record."));
-							PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-							break;
-						}
-					}
-					else
-					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to allocate memory for Buffer. (errno #)"), errno, TRUE);
-						MsgPrintf(hWnd, MB_ICONSTOP, TEXT("MainWndProc() - IDM_SAMPLE_START: Failed to allocate memory for Buffer. (errno #%d)."), errno);
-						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-						break;
-					}
-						
 					// enable/disable appropriate toolbar and menu commands
 					GUI_SetEnabledCommands(hWnd, TRUE, gui);
 
@@ -1880,55 +1571,6 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 						break;
 					}
 						
-					//
-					// generate final EDF+ file name and path
-					//
-					// get full path of temporary EDF+ file from storage thread
-					if(Storage_GetTemporaryEDFFilePath(strTempEDFFilePath, _countof(strTempEDFFilePath)))
-					{
-						main_GenerateFinalEDFFilePath(tmRecordingStartDateTime, strTempEDFFilePath, strFinalEDFFilePath, _countof(strFinalEDFFilePath));
-					}
-					else
-					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: An error occured while retrieving the full path of the temporary EDF+ file from Storage thread."), 0, TRUE);
-						MsgPrintf(hWnd, MB_ICONSTOP, TEXT("MainWndProc() - IDM_SAMPLE_START: An error occured while retrieving the full path of the temporary EDF+ file from Storage thread."));
-						PostMessage(hWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-						break;
-					}
-						
-					//
-					// signal streaming thread to start work (if streaming is enabled)
-					//
-					if(m_cfgConfiguration.Streaming_Enabled)
-					{
-						// check if thread encountered an error and exited prematurely
-						if(WaitForSingleObject(sctd.hevVortexClient_Exiting, 0) != WAIT_OBJECT_0)
-						{
-							// initialize StreamingClientThreadData structure
-							sctd.EndTransmission = FALSE;
-							sctd.ExitThread = FALSE;
-
-							// set EDF+ file name
-							wcstombs_s(&sztLength,
-										sctd.EDFFileName, sizeof(sctd.EDFFileName),
-										PathFindFileName(strFinalEDFFilePath), (_countof(sctd.EDFFileName) - 1)*sizeof(char));	// -1 because there has to be room for terminating NULL character
-
-							// signal streaming thread to start the connection process and wait until end of the process
-							SignalObjectAndWait(sctd.hevVortexClient_Connect_Start, sctd.hevVortexClient_Connecting_Start, INFINITE, FALSE);
-							
-							// send EDF+ header record
-							Streaming_SendPacket(EEGEMPacketType_EDFhdr, (BYTE *) pEDFPlusHeaderBuffer, ushrEDFPlusHeaderBufferLenByt, sctd.hevVortexClient_Transmit);
-						}
-						else
-						{
-							// log error
-							applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_START: Streaming thread has exited prematurely."), 0, TRUE);
-
-							// since connection was unsucessfull, disable streaming
-							m_cfgConfiguration.Streaming_Enabled = FALSE;
-						}
-					}
-
 					//
 					// initialize graphics engine
 					//
@@ -1950,23 +1592,6 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					rc.right++;
 					rc.bottom++;
 					RedrawWindow(hWnd, &rc, NULL, RDW_ERASE | RDW_INVALIDATE | RDW_UPDATENOW);
-					
-					//
-					// enable sampling
-					//
-					std.EndActivity = FALSE;
-					if(m_cfgConfiguration.SimulationMode)
-					{
-						std.Mode = SampleThreadMode_Simulation;
-						std.pModeData = &smd;
-					}
-					else
-					{
-						std.Mode = SampleThreadMode_Recording;
-						std.pModeData = NULL;
-					}
-					
-					SetEvent(std.hevSampleThread_Start);
 				break;
 
 				case IDM_SAMPLE_STOP_NORMAL:
@@ -1974,28 +1599,13 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 				break;
 
 				case IDM_SAMPLE_STOP:
-					blnErrorOccured = FALSE;
 					blnRecordingStarted = FALSE;
 
 					//
-					// wait for storage and streaming threads to reach idle states
+					// stop the acquisition threads and save the recording in the final EDF+ file (unless it is aborted)
 					//
-					// sample thread
-					if(Sample_GetMainFSMState() != SampleThreadState_Idle)
-					{
-						// signal Sampling thread to stop and wait until it does so
-						std.EndActivity = TRUE;
-						WaitForSingleObject(std.hevSampleThread_Idle, INFINITE);
-					}
+					blnErrorOccured = !engine_StopRecording(m_pesEngine, (StopCode) lParam, strFinalEDFFilePath, _countof(strFinalEDFFilePath));
 
-					// storage thread
-					if(Storage_GetMainFSMState() != STS_Idle)
-					{
-						// signal Storage thread to stop and wait until it does so
-						sttd.StopStorage = TRUE;
-						SignalObjectAndWait(sttd.hevStorageThread_Write, sttd.hevStorageThread_Idling, INFINITE, FALSE);
-					}
-					
 					//
 					// perform graphics engine clean-up
 					//
@@ -2005,100 +1615,18 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					//
 					// clean up signal processing module
 					//
-					sp_cleanup();
+					sp_DestroyContext(m_pspcDisplayFilters);
+					m_pspcDisplayFilters = NULL;
+					ica_cleanup();
 
 					//
-					// generate header record for the final EDF+ file
+					// Upload EDF+ file to SSH server (if enabled)
 					//
-					if(!edf_GenerateEDFplusHeaderRecord(FALSE, m_piPatientInfo, m_riRecordingInfo, m_cfgConfiguration.SamplingFrequency,
-														m_intNDataRecords, EEGCHANNELS, ACCCHANNELS, m_cfgConfiguration.ElectrodeType,
-														(char *) pEDFPlusHeaderBuffer, ushrEDFPlusHeaderBufferLenByt + 1))		// +1 for terminating null character
+					if(!blnErrorOccured && m_cfgConfiguration.SSH_AutomaticUpload)
 					{
-						applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_STOP: Unable to generate EDF+ header record for the final EDF+ file."), 0, TRUE);
-						free(pEDFPlusHeaderBuffer);
-						pEDFPlusHeaderBuffer = NULL;
-						ushrEDFPlusHeaderBufferLenByt = 0;
-					}
-
-					//
-					// transfer data from temporary EDF+ file to the final EDF+ file and update header record
-					//
-					blnErrorOccured = TRUE;
-					if(((StopCode) lParam == Stop_Normal) || (StopCode) lParam == Stop_Cancel)
-					{
-						// copy EDF+ from temporary file to its parsed filename and correct header record
-						if(CopyFile(strTempEDFFilePath, strFinalEDFFilePath, TRUE))
-						{
-							if(pEDFPlusHeaderBuffer != NULL)
-							{
-								// Open EDF+ file and correct header information
-								hEDFPlusFile = CreateFile(strFinalEDFFilePath,
-															GENERIC_WRITE | GENERIC_READ,
-															0,
-															NULL,
-															OPEN_EXISTING,
-															FILE_ATTRIBUTE_NORMAL,
-															NULL);
-								if(hEDFPlusFile != INVALID_HANDLE_VALUE)
-								{
-									// write header record to file
-									if(WriteFile(hEDFPlusFile, pEDFPlusHeaderBuffer, ushrEDFPlusHeaderBufferLenByt, &dwReturnValue, NULL))
-									{
-										if(dwReturnValue == ushrEDFPlusHeaderBufferLenByt)
-										{
-											blnErrorOccured = FALSE;
-										}
-										else
-										{
-											applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_STOP: Erroneous amount of bytes written while attemtping to store EDF+ header record."), 0, TRUE);
-										}
-									}
-									else
-									{
-										applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_STOP: Unable to store EDF+ header record in final EDF+ file (GetLastError() #)."), GetLastError(), TRUE);
-									}
-												
-									// close final EDF+ file
-									CloseHandle (hEDFPlusFile);
-								}
-								else
-								{
-									applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_STOP: Unable to open final EDF+ file (GetLastError() #)."), GetLastError(), TRUE);
-								}
-							}
-						}
-						else
-						{
-							applog_logevent(SoftwareError, TEXT("Main"), TEXT("MainWndProc() - IDM_SAMPLE_STOP: Unable to copy temporary EDF+ file into final EDF+ file (GetLastError() #)."), GetLastError(), TRUE);
-						}
-					}
-					
-					//
-					// send final EDF+ header record to streaming server (if enabled)
-					//
-					if(m_cfgConfiguration.Streaming_Enabled && pEDFPlusHeaderBuffer != NULL)
-					{
-						// signal that the following packet will be the last one
-						sctd.EndTransmission = TRUE;
-
-						// send header record
-						Streaming_SendPacket(EEGEMPacketType_EDFhdr,
-											 (BYTE *) pEDFPlusHeaderBuffer,
-											 ushrEDFPlusHeaderBufferLenByt,
-											 sctd.hevVortexClient_Transmit);
-
-						// wait for streaming thread to transition to an idle state
-						WaitForSingleObject(sctd.hevVortexClient_WaitingToConnect, INFINITE);
-					}
-
-					//
-					// Upload EDF+ file to SSH server (if enabled)
-					//
-					if(!blnErrorOccured && m_cfgConfiguration.SSH_AutomaticUpload)
-					{
-						// initialize members of UploadThreadData structure
-						utd.cfg = m_cfgConfiguration;
-						utd.pstrFinalEDFFilePath = strFinalEDFFilePath;
+						// initialize members of UploadThreadData structure
+						utd.cfg = m_cfgConfiguration;
+						utd.pstrFinalEDFFilePath = strFinalEDFFilePath;
 
 						// create streaming thread
 						hUploadThread = CreateThread (NULL,											// pointer to a SECURITY_ATTRIBUTES structure that determines whether the returned handle can be inherited by child processes
@@ -2122,17 +1650,6 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					//
 					// memory allocation clean-up
 					//
-					// free EDF+ header
-					if(pEDFPlusHeaderBuffer != NULL)
-						free(pEDFPlusHeaderBuffer);
-
-					// free EDF+ record storage structures
-					if(m_riRecordingInfo.Equipment != NULL)
-					{
-						free(m_riRecordingInfo.Equipment);
-						m_riRecordingInfo.Equipment = NULL;
-					}
-
 					// buffers
 					if(m_pdblEEGDisplayBuffer != NULL)
 					{
@@ -2154,29 +1671,20 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 						free(m_pdblAEEGDisplayBuffer);
 					}
 
-					if(m_pdblDisplayBufferTemp == NULL)
-					{
-						free(m_pdblDisplayBufferTemp);
-					}
-
-					if(m_pshrSampleBuffer != NULL)
+					if(m_pdblERPDisplayBuffer != NULL)
 					{
 						for(i=0; i < (EEGCHANNELS + ACCCHANNELS); i++)
 						{
-							free(m_pshrSampleBuffer[i]);
+							free(m_pdblERPDisplayBuffer[i]);
 						}
 
-						free(m_pshrSampleBuffer);
+						free(m_pdblERPDisplayBuffer);
+						m_pdblERPDisplayBuffer = NULL;
 					}
-					
-					if(pshrSampleBuffer != NULL)
-					{
-						for(i=0; i < (EEGCHANNELS + ACCCHANNELS); i++)
-						{
-							free(pshrSampleBuffer[i]);
-						}
 
-						free(pshrSampleBuffer);
+					if(m_pdblDisplayBufferTemp == NULL)
+					{
+						free(m_pdblDisplayBufferTemp);
 					}
 
 					//
@@ -2199,14 +1707,6 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 					SendMessage (gui.hwndStatusBar, SB_SETICON, SB_BATTERYICON_PART, (LPARAM) NULL);
 					SendMessage (gui.hwndStatusBar, SB_SETTEXT, SB_RECTIME_PART, (LPARAM) TEXT(""));
 
-					// log amount of lost packets and checksum errors
-					applog_logevent(SoftwareError, TEXT("Main"), TEXT("Number of packet checksum errors"), m_lngNPacketChecksumErrors, TRUE);
-					applog_logevent(SoftwareError, TEXT("Main"), TEXT("Number of lost packets"), m_intNPacketsLost, TRUE);
-
-					// log start of recording & mark end of recording in application log
-					applog_logevent(General, TEXT("Main"), TEXT("Recording Ended"), 0, TRUE);
-					applog_endgrouping();
-
 					// set exit status
 					PostMessage(hWnd, EEGEMMsg_ExitPermission_Clear, ExitPermission_Denied_Recording, 0);
 				break;
@@ -2288,7 +1788,7 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 				case VK_F7:
 				case VK_F8:
 					if(blnRecordingStarted)
-						main_InsertAnnotation(Regular, wParam - VK_F2, gui, hWnd);
+						engine_InsertAnnotation(m_pesEngine, Regular, wParam - VK_F2);
 				break;
 
 				case VK_F11:
@@ -2297,7 +1797,7 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 
 				case VK_SPACE:
 					if(blnRecordingStarted)
-						main_InsertAnnotation(Now, -1, gui, hWnd);
+						engine_InsertAnnotation(m_pesEngine, Now, -1);
 				break;
 		
 				default:
@@ -2367,21 +1867,18 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 									if(blnRecordingStarted)
 									{
 										// annotate event in EDF file
-										main_InsertAnnotation(CoordinatorInserted, 0, gui, hWnd);
+										engine_InsertAnnotation(m_pesEngine, CoordinatorInserted, 0);
 										
 										// log event
 										applog_logevent(HardwareError, TEXT("Main"), TEXT("WEEG coordinator re-inserted during recording."), 0, TRUE);
 
-										// restart sampling
-										WaitForSingleObject(std.hevSampleThread_Idle, INFINITE);
-										std.Mode = SampleThreadMode_Recording;
-										std.pModeData = NULL;
-										SetEvent(std.hevSampleThread_Start);
+										// the sample thread re-establishes the link without ending the recording
+										engine_SetCoordinatorPresent(m_pesEngine, TRUE);
 									}
 									else
 									{
 										SendMessage(gui.hwndStatusBar, SB_SETTEXT, SB_ANNOTATIONS_PART, (LPARAM) TEXT("Activity detected on WEEG COM port. WEEG system check in progress..."));
-										main_CheckWEEGSystem(NULL, 0, &std, gui);
+										main_CheckWEEGSystem(NULL, 0, gui);
 									}
 								break;
 								
@@ -2390,14 +1887,17 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 									if(blnRecordingStarted)
 									{
 										// annotate event in EDF file
-										main_InsertAnnotation(CoordinatorRemoved, 0, gui, hWnd);
+										engine_InsertAnnotation(m_pesEngine, CoordinatorRemoved, 0);
 
 										// log event
 										applog_logevent(HardwareError, TEXT("Main"), TEXT("WEEG coordinator removed during recording."), 0, TRUE);
+
+										// make the sample thread drop the port at once instead of waiting for the packet time-out
+										engine_SetCoordinatorPresent(m_pesEngine, FALSE);
 									}
 									else
 									{
-										main_CheckWEEGSystem(NULL, 0, &std, gui);
+										main_CheckWEEGSystem(NULL, 0, gui);
 									}
 								break;
 							}
@@ -2410,51 +1910,19 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 		break;
 
 		case WM_DESTROY:
-			// streaming thread
-			if(WaitForSingleObject(sctd.hevVortexClient_Exiting, 0) != WAIT_OBJECT_0)
-			{
-				sctd.ExitThread = TRUE;											// set flag that thread that should exist
-				SetEvent(sctd.hevVortexClient_Connect_Start);					// make thread exit the Waiting2Connect state
-				WaitForSingleObject(sctd.hevVortexClient_Exiting, INFINITE);	// wait for thread to exit
-			}
-			CloseHandle (hStreamingThread);
+			// acquisition threads
+			engine_DestroySession(m_pesEngine);
+			m_pesEngine = NULL;
 
 			//
 			// stop threads
 			//
-			CloseHandle (hStorageThread);
-			CloseHandle (hSampleThread);
 			CloseHandle (hWiFiThread);
 
 			// Delete icons
 			DestroyIcon(gui.hIconsBatteryStates[0]);
 			DestroyIcon(gui.hIconsBatteryStates[1]);
 			
-			// Release Mutex objects
-			CloseHandle(m_hMutexAnnotation);
-			CloseHandle(m_hMutexSampleBuffer);
-			
-			// release created events for sample thread
-			CloseHandle(std.hevSampleThread_Start);
-			CloseHandle(std.hevSampleThread_Idle);
-			CloseHandle(std.hevSampleThread_Init);
-
-			// release created events for storage thread
-			CloseHandle(sttd.hevStorageThread_Idling);
-			CloseHandle(sttd.hevStorageThread_Init_End);
-			CloseHandle(sttd.hevStorageThread_Init_Start);
-			CloseHandle(sttd.hevStorageThread_Write);
-			
-			// release created events for streaming thread
-			CloseHandle(sctd.hevThreadInit_Complete);
-			CloseHandle(sctd.hevVortexClient_Connecting_Start);
-			CloseHandle(sctd.hevVortexClient_Connecting_End);
-			CloseHandle(sctd.hevVortexClient_Connect_Start);
-			CloseHandle(sctd.hevVortexClient_Exiting);
-			CloseHandle(sctd.hevVortexClient_Transmit);
-			CloseHandle(sctd.hevVortexClient_WaitingToConnect);
-			CloseHandle(sctd.hevVortexClient_WaitingToTransmit);
-			
 			// reset screen saver configuration to its initial state
 			SystemParametersInfo(SPI_SETSCREENSAVEACTIVE, m_blnScreenSaverActive, 0, 0);
 		
@@ -2492,7 +1960,8 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 			else
 			{
 				mbstowcs_s(&sztLength, strBuffer, sizeof(strBuffer)/sizeof(WORD), (char *) lParam, _TRUNCATE);
-				_stprintf_s(strStatusBarAnnotation, _countof(strStatusBarAnnotation), TEXT("+%d: %s"), m_uintTimeKeepingTAL, strBuffer);
+				engine_GetStatus(m_pesEngine, &esStatus);
+				_stprintf_s(strStatusBarAnnotation, _countof(strStatusBarAnnotation), TEXT("+%d: %s"), esStatus.TimeKeepingTAL, strBuffer);
 			}
 			
 			PostMessage(gui.hwndStatusBar, SB_SETTEXT, SB_ANNOTATIONS_PART, (LPARAM) strStatusBarAnnotation);
@@ -2504,6 +1973,12 @@ static LRESULT APIENTRY MainWndProc (HWND hWnd, UINT message, UINT wParam, LONG
 			PostMessage(gui.hwndStatusBar, SB_SETTEXT, SB_STATUS_PART, (LPARAM) strStatusBarStatus);
 		break;
 
+		// display progress of the Simulation mode in the status part of the status bar
+		case EEGEMMsg_StatusBar_SetReplayStatus:
+			_stprintf_s(strStatusBarStatus, _countof(strStatusBarStatus), TEXT("Reading data record: %d/%d (%d records/s)"), (int) wParam, engine_GetNSimulationDataRecords(m_pesEngine), (int) lParam);
+			PostMessage(gui.hwndStatusBar, SB_SETTEXT, SB_STATUS_PART, (LPARAM) strStatusBarStatus);
+		break;
+
 		// update streaming thread status displayed on the second line of the rebar
 		case EEGEMMsg_Streaming_DisplayStatus:
 			switch((StreamingClientState) wParam)
@@ -2660,6 +2135,13 @@ static BOOL CALLBACK Dialog_Settings (HWND hwndDlg, UINT uMsg, WPARAM wParam, LP
 						}
 					}
 
+					// check that at least one measurement channel is selected
+					if (blnAllowDeactivation && (m_cfgConfiguration.DisplayChannelMask & MCHANNELMASK) == 0)
+					{
+						MsgPrintf (hwndDlg, MB_ICONSTOP, TEXT("No measurement channels selected! Please select at least one channel."));
+						blnAllowDeactivation = FALSE;
+					}
+
 					// check that the sampling frequency is valid, and if so, check that the channel limit is not exceeded
 					if (blnAllowDeactivation)
 					{
@@ -3802,7 +3284,7 @@ static void GUI_DisplayPropertySheet(HWND hwndOwner, GUIElements gui)
 	main_SaveCurrentSettings(gui);
 }
 
-static void GUI_DisplayAnnotationsContextMenu(HWND hwndOwner, int intXPos, int intYPos, GUIElements gui, HWND hwndMainWindow)
+static void GUI_DisplayAnnotationsContextMenu(HWND hwndOwner, int intXPos, int intYPos, GUIElements gui)
 {
 	int i, intNDisplayedAnnotations, intSelectedItem;
 	
@@ -3839,9 +3321,9 @@ static void GUI_DisplayAnnotationsContextMenu(HWND hwndOwner, int intXPos, int i
 		if(intSelectedItem > 0)
 		{
 			if(intSelectedItem < ANNOTATION_MAX_TYPES)
-				main_InsertAnnotation(Regular, intSelectedItem - 1, gui, hwndMainWindow);
+				engine_InsertAnnotation(m_pesEngine, Regular, intSelectedItem - 1);
 			else
-				main_InsertAnnotation(Now, -1, gui, hwndMainWindow);
+				engine_InsertAnnotation(m_pesEngine, Now, -1);
 
 			m_blnIsAnnotationsMenuDisplayed = FALSE;
 		}
@@ -4671,6 +4153,112 @@ static BOOL CALLBACK Dialog_About (HWND hwndDlg, UINT uintMsg, WPARAM wParam, LP
 	return (0);
 }
 
+static BOOL CALLBACK Dialog_LinkStatistics (HWND hwndDlg, UINT uintMsg, WPARAM wParam, LPARAM lParam)
+{
+	OPENFILENAME	ofn;
+	TCHAR			strFilePath[MAX_PATH + 1];
+
+	switch (uintMsg)
+	{
+		case WM_INITDIALOG:
+			CheckDlgButton (hwndDlg, IDC_LATENCYPROBES, latency_IsEnabled() ? BST_CHECKED : BST_UNCHECKED);
+			Dialog_LinkStatistics_Refresh(hwndDlg);
+
+			// statistics are refreshed while the dialog is open
+			if(SetTimer (hwndDlg, IDT_LINKSTATS_TIMER, 1000, (TIMERPROC) NULL) == 0)
+				applog_logevent(SoftwareError, TEXT("Main"), TEXT("Dialog_LinkStatistics - WM_INITDIALOG: Could not create refresh timer. (GetLastError #)"), GetLastError(), TRUE);
+		break;
+
+		case WM_TIMER:
+			if(wParam == IDT_LINKSTATS_TIMER)
+				Dialog_LinkStatistics_Refresh(hwndDlg);
+		break;
+
+		case WM_COMMAND:
+			switch (LOWORD (wParam))
+			{
+				// switch the latency probes on or off (the setting is kept in the configuration file)
+				case IDC_LATENCYPROBES:
+					m_cfgConfiguration.LatencyProbes = (IsDlgButtonChecked (hwndDlg, IDC_LATENCYPROBES) == BST_CHECKED);
+					latency_Enable(m_cfgConfiguration.LatencyProbes);
+					Dialog_LinkStatistics_Refresh(hwndDlg);
+				break;
+
+				// store the latency histograms in a CSV file
+				case IDC_LATENCYEXPORT:
+					SecureZeroMemory (&ofn, sizeof(ofn));
+					ofn.lStructSize = sizeof(ofn);
+					ofn.hwndOwner = hwndDlg;
+					ofn.lpstrFile = strFilePath;
+					ofn.lpstrFile[0] = TEXT('\0');
+					ofn.nMaxFile = sizeof(strFilePath)/sizeof(TCHAR);
+					ofn.lpstrFilter = TEXT("CSV File (*.CSV)\0*.CSV\0All Files (*.*)\0*.*\0");
+					ofn.nFilterIndex = 1;
+					ofn.lpstrDefExt = TEXT("csv");
+					ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+
+					if(GetSaveFileName(&ofn) == TRUE && !latency_Dump(ofn.lpstrFile))
+					{
+						applog_logevent(SoftwareError, TEXT("Main"), TEXT("Dialog_LinkStatistics - IDC_LATENCYEXPORT: Could not store latency histograms. (errno #)"), errno, TRUE);
+						MsgPrintf (hwndDlg, MB_ICONERROR, TEXT("Could not store the latency histograms in %s."), ofn.lpstrFile);
+					}
+				break;
+
+				case IDOK:
+				case IDCANCEL:
+					KillTimer (hwndDlg, IDT_LINKSTATS_TIMER);
+					EndDialog (hwndDlg, 0);
+				break;
+			}
+		break;
+
+		case WM_CLOSE:
+			KillTimer (hwndDlg, IDT_LINKSTATS_TIMER);
+			EndDialog (hwndDlg, 0);
+		break;
+	}
+
+	return (0);
+}
+
+/**
+ * \brief Displays a snapshot of the link statistics in the link statistics dialog.
+ *
+ * The scroll position of the text is preserved.
+ *
+ * \param[in]	hwndDlg		handle of the dialog
+ * \return Nothing.
+ */
+static void Dialog_LinkStatistics_Refresh (HWND hwndDlg)
+{
+	static LinkStatistics lsStatistics;
+	static ClockDriftEstimate cdeClockDrift;
+	static CoherenceMatrix cmCoherence;
+	static TCHAR strBuffer[8192];
+	HWND hwndControl;
+	int intFirstVisibleLine;
+	size_t sztLength;
+
+	// clock drift and latency first, then the link statistics and the coherence
+	clockdrift_Get(&cdeClockDrift);
+	clockdrift_Format(&cdeClockDrift, strBuffer, sizeof(strBuffer)/sizeof(TCHAR));
+	sztLength = _tcslen(strBuffer);
+	latency_Format(strBuffer + sztLength, sizeof(strBuffer)/sizeof(TCHAR) - sztLength);
+	sztLength = _tcslen(strBuffer);
+	linkstats_Get(&lsStatistics);
+	linkstats_Format(&lsStatistics, strBuffer + sztLength, sizeof(strBuffer)/sizeof(TCHAR) - sztLength);
+
+	// inter-channel coherence of the last completed epoch (if recording)
+	sztLength = _tcslen(strBuffer);
+	if(coh_GetMatrix(&cmCoherence))
+		coh_Format(&cmCoherence, strBuffer + sztLength, sizeof(strBuffer)/sizeof(TCHAR) - sztLength);
+
+	hwndControl = GetDlgItem(hwndDlg, IDC_LINKSTATISTICS);
+	intFirstVisibleLine = (int) SendMessage(hwndControl, EM_GETFIRSTVISIBLELINE, 0, 0);
+	SetWindowText(hwndControl, strBuffer);
+	SendMessage(hwndControl, EM_LINESCROLL, 0, intFirstVisibleLine);
+}
+
 static DWORD CALLBACK Dialog_About_EditStreamCallback(DWORD_PTR dwCookie, LPBYTE pbBuff, LONG cb, LONG *pcb)
 {
 	HANDLE hFile = (HANDLE)dwCookie;
@@ -5130,823 +4718,3 @@ static BOOL CALLBACK Dialog_SSHConfig (HWND hwndDlg, UINT uintMsg, WPARAM wParam
 
 	return (0);
 }
-
-//---------------------------------------------------------------------------------------------------------------------------------
-//   								Sample thread functions
-//---------------------------------------------------------------------------------------------------------------------------------
-/**
- * \brief Adds the 'Communication failure' annotation to the data record when a communication failure occurs.
- *
- * When a communication failure occurs, this function is called. The first time it is called, a 'Communication failure' annotation
- * containing a time stamp is added to the data record. The remainder of the the data record signal samples (both EEG and Gyro) are
- * filled with a default value. Once this is done, the data record is immediately saved to the EDF+ file.
- * On subsequent calls during a communication failure, this function returns without doing anything.
- *
- * \param[in]	pdrCurrentDataRecord	pointer to the SampleDataRecord structure where the measurement data of the current data record is being stored
- * \param[in]	pstd					pointer to the SampleThreadData structure that was passed to the thread upon its creation by the CreateThread function
- * \param[in]	hwndMainWindow			handle to the application's main window
- *
- * \return TRUE if succesfull, FALSE otherwise.
- */
-static BOOL Sample_DetectedCommunicationFailure(SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd, HWND hwndMainWindow)
-{
-	BOOL blnResult = TRUE;
-	GUIElements * pgui = pstd->pgui;
-
-	// Check if communication blackout is already in progress
-	if(!m_blnCommunicationBlackout)
-	{
-		m_blnCommunicationBlackout = TRUE;
-		
-		// add annotation indicating that a communication failer has occured
-		main_InsertAnnotation(CommunicationFailure, -1, *pgui, hwndMainWindow);
-		
-		// fill the data record with INVALID_DATA_SAMPLE samples
-		while(m_intNSamplesDatarecord < m_cfgConfiguration.SamplingFrequency)
-		{
-			pdrCurrentDataRecord->MeasurementData[0][m_intNSamplesDatarecord] = INVALID_ACC_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[1][m_intNSamplesDatarecord] = INVALID_ACC_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[2][m_intNSamplesDatarecord] = INVALID_ACC_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[3][m_intNSamplesDatarecord] = INVALID_EEG_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[4][m_intNSamplesDatarecord] = INVALID_EEG_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[5][m_intNSamplesDatarecord] = INVALID_EEG_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[6][m_intNSamplesDatarecord] = INVALID_EEG_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[7][m_intNSamplesDatarecord] = INVALID_EEG_SAMPLE;
-			pdrCurrentDataRecord->MeasurementData[8][m_intNSamplesDatarecord] = INVALID_EEG_SAMPLE;
-			m_intNSamplesDatarecord++;
-		}
-
-		// store and transmit data record
-		m_intNSamplesDatarecord = 0;
-		blnResult = Sample_StoreAndTransmitDataRecord(pdrCurrentDataRecord, pstd);
-	}
-	
-	return blnResult;
-}
-
-/**
- * \brief Returns the current state of the sample thread's main FSM.
- *
- * \return	A member of the SampleThreadState enumeration.
- */
- static SampleThreadState Sample_GetMainFSMState(void)
- {
-	 return m_stsCurrentSampleThreadState;
- }
-
-/**
- * \brief 
- *
- * Handle received data: construct display buffer for the scope and store data to the file.
- * If bInit is true, packet's number is stored and it is used to detect first skipped packets.
- *
- * \param[in]	Data
- * \param[in]	DataLength
- * \param[in]	ClusterSize
- * \param[in]	bInit
- * \return ... 
- */
-static BOOL Sample_ProcessDataPacket (tPacket_DATA * ptpMeasurementData, SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd, HWND hwndMainWindow)
-{
-	BOOL			blnResult;
-	GUIElements *	pgui;
-	int				j;
-
-	// variable initialization
-	blnResult = TRUE;
-	pgui = (GUIElements *) pstd->pgui;
-		
-	// if a communication failure was in progress, insert anotation that
-	// comunication has now resumed
-	if(m_blnCommunicationBlackout)
-	{
-		m_blnCommunicationBlackout = FALSE;
-		main_InsertAnnotation(CommunicationResume, -1, *pgui, hwndMainWindow);
-	}
-
-	// check battery voltage
-	if(ptpMeasurementData->BatteryLevel <= 3600)
-		m_blnBatteryLow = TRUE;
-	else
-		m_blnBatteryLow = FALSE;
-
-	//
-	// add data to display buffer
-	//
-	WaitForSingleObject(m_hMutexSampleBuffer, INFINITE);
-			
-	// Iterate through all samples from each channel
-	for (j = 0; j < mc_intSampleLengths [EEGCHANNELS]; j++) // SampleLength = number of measurements per channel
-	{ 
-		// store EEG channels in display buffer
-		m_pshrSampleBuffer [0][m_uintNNewSamples] = CAST_16b_US2S(ptpMeasurementData->Measurements [(EEGCHANNELS) * j]) + ((short) m_cfgConfiguration.ChannelDCOffset[0]);
-		m_pshrSampleBuffer [1][m_uintNNewSamples] = CAST_16b_US2S(ptpMeasurementData->Measurements [(EEGCHANNELS) * j + 1]) + ((short) m_cfgConfiguration.ChannelDCOffset[1]);
-		m_pshrSampleBuffer [2][m_uintNNewSamples] = CAST_16b_US2S(ptpMeasurementData->Measurements [(EEGCHANNELS) * j + 2]) + ((short) m_cfgConfiguration.ChannelDCOffset[2]);
-		m_pshrSampleBuffer [3][m_uintNNewSamples] = CAST_16b_US2S(ptpMeasurementData->Measurements [(EEGCHANNELS) * j + 3]) + ((short) m_cfgConfiguration.ChannelDCOffset[3]);
-		m_pshrSampleBuffer [4][m_uintNNewSamples] = CAST_16b_US2S(ptpMeasurementData->Measurements [(EEGCHANNELS) * j + 4]) + ((short) m_cfgConfiguration.ChannelDCOffset[4]);
-		m_pshrSampleBuffer [5][m_uintNNewSamples] = CAST_16b_US2S(ptpMeasurementData->Measurements [(EEGCHANNELS) * j + 5]) + ((short) m_cfgConfiguration.ChannelDCOffset[5]);
-
-		// store accelerometer channels in display buffer
-		m_pshrSampleBuffer [6][m_uintNNewSamples] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[0]);
-		m_pshrSampleBuffer [7][m_uintNNewSamples] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[1]);
-		m_pshrSampleBuffer [8][m_uintNNewSamples] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[2]);
-
-		// NOTE: reset to 0 -> should not be needed but is kept here just as an indication
-		// of a data bottleneck
-		if(++m_uintNNewSamples == m_uintSampleBufferLength)
-		{
-			applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_ProcessDataPacket: m_pshrSampleBuffer overflowed."), 0, TRUE);
-			m_uintNNewSamples = 0;
-		}
-	}
-
-	//
-	ReleaseMutex(m_hMutexSampleBuffer);
-
-	//
-	// add data to storage and streaming buffer
-	//
-	// Iterate through all samples from each channel again
-	for (j = 0; j < mc_intSampleLengths [EEGCHANNELS]; j++) // SampleLength = number of measurements per channel
-	{ 
-		//////// EDF+ ////////////////
-		// Fill the EDF+ buffer
-		pdrCurrentDataRecord->MeasurementData[0][m_intNSamplesDatarecord] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[0]);							// Acc - X
-		pdrCurrentDataRecord->MeasurementData[1][m_intNSamplesDatarecord] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[1]);							// Acc - Y
-		pdrCurrentDataRecord->MeasurementData[2][m_intNSamplesDatarecord] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[2]);							// Acc - Z
-		pdrCurrentDataRecord->MeasurementData[3][m_intNSamplesDatarecord] = CAST_16b_US2S(ptpMeasurementData->Measurements [EEGCHANNELS * j]);				// EEG - P10
-		pdrCurrentDataRecord->MeasurementData[4][m_intNSamplesDatarecord] = CAST_16b_US2S(ptpMeasurementData->Measurements [EEGCHANNELS * j + 1]);			// EEG - F8
-		pdrCurrentDataRecord->MeasurementData[5][m_intNSamplesDatarecord] = CAST_16b_US2S(ptpMeasurementData->Measurements [EEGCHANNELS * j + 2]);			// EEG - FP2
-		pdrCurrentDataRecord->MeasurementData[6][m_intNSamplesDatarecord] = CAST_16b_US2S(ptpMeasurementData->Measurements [EEGCHANNELS * j + 3]);			// EEG - FP1
-		pdrCurrentDataRecord->MeasurementData[7][m_intNSamplesDatarecord] = CAST_16b_US2S(ptpMeasurementData->Measurements [EEGCHANNELS * j + 4]);			// EEG - F7
-		pdrCurrentDataRecord->MeasurementData[8][m_intNSamplesDatarecord] = CAST_16b_US2S(ptpMeasurementData->Measurements [EEGCHANNELS * j + 5]);			// EEG - P9
-		
-		if (++m_intNSamplesDatarecord == m_cfgConfiguration.SamplingFrequency)
-		{
-			blnResult = Sample_StoreAndTransmitDataRecord(pdrCurrentDataRecord, pstd);
-			m_intNSamplesDatarecord = 0;
-		}
-	}
-	
-	return blnResult;
-} 
-
-/**
- * \brief Adds current data record to the write queue of the storage thread and the transmission queue of the streaming thread.
- *
- * \param[in]	pdrCurrentDataRecord	
- * \param[in]	pstd					
- *
- * \return TRUE if successsfull, FALSE otherwise. 
- */
-static BOOL Sample_StoreAndTransmitDataRecord(SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd)
-{
-	BOOL			blnResult = FALSE;
-	unsigned int	uintSignalLength;	///< length of acceleration/EEG signal per data record, in bytes
-	unsigned int	k;
-	
-	//
-	// copy data to from MeasurementData to WriteBuffer
-	//
-	// copy measurement data
-	uintSignalLength = m_cfgConfiguration.SamplingFrequency*sizeof(short);
-	for(k = 0; k < (EEGCHANNELS + ACCCHANNELS); k++)
-	{
-		memcpy_s(pdrCurrentDataRecord->WriteBuffer + k*uintSignalLength, uintSignalLength,
-				 pdrCurrentDataRecord->MeasurementData[k], uintSignalLength);
-	}
-
-	// copy annotations
-	WaitForSingleObject(m_hMutexAnnotation, INFINITE);
-	
-	memcpy_s(&pdrCurrentDataRecord->WriteBuffer[(EEGCHANNELS + ACCCHANNELS) * m_cfgConfiguration.SamplingFrequency * sizeof(short)], ANNOTATION_TOTAL_NCHARS*sizeof(char),
-			 m_strCurrentDRAnnotations, ANNOTATION_TOTAL_NCHARS*sizeof(char));
-	
-	m_uintTimeKeepingTAL += EDFDURATIONOFRECORD;
-	m_intNAnnotationsBuffered = 0;
-	main_InitAnnotationSignal(m_strCurrentDRAnnotations, _countof(m_strCurrentDRAnnotations), m_uintTimeKeepingTAL);
-	
-	ReleaseMutex(m_hMutexAnnotation);
-
-	//
-	// send data record to storage thread
-	//
-	blnResult = Storage_AddToQueue(pdrCurrentDataRecord->WriteBuffer, pdrCurrentDataRecord->WriteBufferLen, FALSE, pstd->hevStorageThread_Write);
-
-	//
-	// send data record to streaming thread (if enabled)
-	//
-	if(m_cfgConfiguration.Streaming_Enabled)
-	{
-		// send data record
-		if(!Streaming_SendPacket(EEGEMPacketType_EDFdr,
-							     pdrCurrentDataRecord->WriteBuffer,
-							     (unsigned short) pdrCurrentDataRecord->WriteBufferLen,
-							     pstd->hevVortexClient_Transmit))
-		{
-			// log error
-			applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Sample_StoreAndTransmitDataRecord(): Unable to send packet to streaming server."), 0, TRUE);
-
-			// since connection was unsucessfull, disable streaming
-			m_cfgConfiguration.Streaming_Enabled = FALSE;
-		}
-	}
-
-	// Reset value of current samples in data record and increase amount of total data records
-	++m_intNDataRecords;
-
-	return blnResult;
-}
-
-/**
- * \brief Function executed when sampling thread is created using the CreateThread function.
- *
- * \param[in]	lParam		thread data passed to the function using the lpParameter parameter of the CreateThread function
- *
- * \return Indicates success or failure of the function.
- */
-static long WINAPI Sample_Thread (LPARAM lParam)
-{
-	HWND						hwndMainWnd;
-	GUIElements	*				pgui;
-	SampleThreadData *			pstd;
-
-	// local variable init
-	pstd = (SampleThreadData *) lParam;
-	pgui = pstd->pgui;
-	hwndMainWnd = FindWindow (WINDOW_CLASSID_MAIN, NULL);
-
-	while (1)
-	{
-		switch (m_stsCurrentSampleThreadState)
-		{
-			case SampleThreadState_Idle:
-				// signal that state machine is in Idle state and wait for Start event
-				SignalObjectAndWait(pstd->hevSampleThread_Idle, pstd->hevSampleThread_Start, INFINITE, FALSE);
-
-				//
-				// state transition
-				//
-				m_stsCurrentSampleThreadState = SampleThreadState_Working;
-			break;
-
-			case SampleThreadState_Working:
-				// check requested mode and pass control to the appropriate FSM
-				switch(pstd->Mode)
-				{
-					case SampleThreadMode_Recording:
-						Sample_RecordingFSM(pstd, hwndMainWnd);
-					break;
-
-					case SampleThreadMode_WEEGSystemCheck:
-						Sample_WEEGSystemCheckFSM(pstd);
-					break;
-
-					case SampleThreadMode_Simulation:
-						Sample_SimulationFSM(pstd, hwndMainWnd);
-					break;
-
-					case SampleThreadMode_WEEGDCCalibration:
-						/// TODO
-					break;
-
-					default:
-						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_Thread(): Unknown sample thread mode detected."), 0, TRUE);
-				}
-
-				//
-				// state transition
-				//
-				m_stsCurrentSampleThreadState = SampleThreadState_Idle;
-			break;
-		}
-	}
-	
-	return (0);
-}
-
-static void Sample_SimulationFSM(SampleThreadData * pstd, HWND	hwndMainWnd)
-{
-	// code for simulating the reception of data
-	BOOL					blnStayInFSM;
-	BOOL					blnStateErrorOccured;
-	EDFFileHandle *			hEDFFile;				///< handle to the EDF+ file used as input for the simulation mode
-	int						intDRIndex;				///< one-based index of the data record currently being read from the EDF+ file (i.e., index of first DR is 0)
-	int						i;
-	int						intSamplingFrequency;
-	ledf_RetCode			rc;
-	tPacket_DATA			tpdMeasurementData;
-	SampleDataRecord		drCurrentDataRecord;
-	SimulationModeData *	psmd;
-	SimulationModeState		smsState;
-	TCHAR					strBuffer[80];
-	unsigned int			uintDRSampleCounter;	///< zero-based index indiciating sample being currently read from the data record
-
-	// variable initialization
-	blnStayInFSM = TRUE;
-	drCurrentDataRecord = mc_sdrEmpty;
-	smsState = SimulationModeState_Initialize;
-	psmd = (SimulationModeData *) pstd->pModeData;
-	intSamplingFrequency = *(pstd->pSamplingFrequency);
-
-	while (blnStayInFSM)
-	{
-		switch (smsState)
-		{
-			case SimulationModeState_Initialize:
-				blnStateErrorOccured = FALSE;
-
-				// set event to signaled state
-				SetEvent(pstd->hevSampleThread_Init);
-
-				// check if simulation file has been loaded
-				if(strlen(psmd->strSimulationEDFFile) > 0)
-				{
-					hEDFFile = libEDF_openFile(psmd->strSimulationEDFFile);
-					if(hEDFFile == NULL)
-					{
-						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: Could not load EDF+ file."), 0, TRUE);
-						MsgPrintf(hwndMainWnd, MB_ICONSTOP, TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: Could not load EDF+ file."), 0);
-						PostMessage(hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-						break;
-					}
-				}
-				else
-				{
-					applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: No simulation file loaded."), 0, TRUE);
-					MsgPrintf(hwndMainWnd, MB_ICONERROR, TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: No simulation file loaded."));
-					PostMessage(hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-					break;
-				}
-
-				// initialize data record linked list
-				if(!Sample_InitDataRecord(&drCurrentDataRecord, intSamplingFrequency))
-				{
-					applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: Failed to initialize data record structure."), 0, TRUE);
-					PostMessage (hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);	// Force stop
-					blnStateErrorOccured = TRUE;
-				}
-				
-				if(!blnStateErrorOccured)
-				{
-					if(hEDFFile->FileHeader.NSignalsPerDataRecord <= 0)
-					{
-						// get size of a data record, in bytes
-						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SampleThreadState_Initialize: EDF+ file contains no signals."), 0, TRUE);
-						PostMessage (hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);	// Force stop
-						blnStateErrorOccured = TRUE;
-					}
-				}
-
-				//
-				// state transition
-				//
-				if(blnStateErrorOccured)
-					smsState = SimulationModeState_CleanUp;
-				else
-					smsState = SimulationModeState_Acquire;
-			break;
-			
-			// Sampling state
-			case SimulationModeState_Acquire:
-				// simulate good battery level so that 'low battery' alarm doesn't get triggered
-				tpdMeasurementData.BatteryLevel = 4100;
-
-				// initialize DR sample coutner to the sampling frequency in order to trigger a read
-				uintDRSampleCounter = intSamplingFrequency;
-
-				// initilize data record index
-				intDRIndex = 0;
-
-				while(!pstd->EndActivity)
-				{
-					//
-					// fill tPacket_DATA structure with data samples from EDFFileHandle structure
-					//
-					for(i = 0; i < mc_intSampleLengths [EEGCHANNELS]; i++)
-					{
-						//
-						// if end of EDF+ data record has been reached, read new data record from EDF+ file
-						//
-						if(uintDRSampleCounter == intSamplingFrequency)
-						{
-							// if yes: reset reading indexes to beginning of next data record, read the next record
-							//		   and update status bar
-							uintDRSampleCounter = 0;
-
-							// get data record from file
-							rc = libEDF_getDataRecord(hEDFFile, intDRIndex + 1);
-							if(rc == LEDF_OK)
-							{
-								_stprintf_s (strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("Reading data record: %d/%d"), intDRIndex + 1, hEDFFile->FileHeader.NDataRecords);
-								SendMessage(hwndMainWnd, EEGEMMsg_StatusBar_SetStatus, 0, (LPARAM) strBuffer);
-							}
-
-							// increase data record index
-							intDRIndex = (intDRIndex++)%hEDFFile->FileHeader.NDataRecords;
-						}
-						
-						// transfer accelerometer and EEG signals but not the annotations signal
-						// (no easy way to transfer annotations from EDF+ being read to the one being stored)
-						tpdMeasurementData.Accelerometers[0] = CAST_10b_S2US(hEDFFile->DataRecord.Data[0][uintDRSampleCounter]);
-						tpdMeasurementData.Accelerometers[1] = CAST_10b_S2US(hEDFFile->DataRecord.Data[1][uintDRSampleCounter]);
-						tpdMeasurementData.Accelerometers[2] = CAST_10b_S2US(hEDFFile->DataRecord.Data[2][uintDRSampleCounter]);
-						tpdMeasurementData.Measurements [(EEGCHANNELS) * i] = CAST_16b_S2US(hEDFFile->DataRecord.Data[3][uintDRSampleCounter]);
-						tpdMeasurementData.Measurements [(EEGCHANNELS) * i + 1] = CAST_16b_S2US(hEDFFile->DataRecord.Data[4][uintDRSampleCounter]);
-						tpdMeasurementData.Measurements [(EEGCHANNELS) * i + 2] = CAST_16b_S2US(hEDFFile->DataRecord.Data[5][uintDRSampleCounter]);
-						tpdMeasurementData.Measurements [(EEGCHANNELS) * i + 3] = CAST_16b_S2US(hEDFFile->DataRecord.Data[6][uintDRSampleCounter]);
-						tpdMeasurementData.Measurements [(EEGCHANNELS) * i + 4] = CAST_16b_S2US(hEDFFile->DataRecord.Data[7][uintDRSampleCounter]);
-						tpdMeasurementData.Measurements [(EEGCHANNELS) * i + 5] = CAST_16b_S2US(hEDFFile->DataRecord.Data[8][uintDRSampleCounter]);
-
-						uintDRSampleCounter++;
-					}
-					
-					//
-					// send data to be processed
-					//
-					Sleep(20);
-					Sample_ProcessDataPacket(&tpdMeasurementData, &drCurrentDataRecord, pstd, hwndMainWnd);
-				}
-				
-				//
-				// state transition
-				//
-				smsState = SimulationModeState_CleanUp;
-			break;
-
-			case SimulationModeState_CleanUp:
-				if(hEDFFile != NULL)
-					libEDF_closeFile(hEDFFile);
-
-				Sample_FreeDataRecord(&drCurrentDataRecord);
-
-				blnStayInFSM = FALSE;
-			break;
-
-			default:
-				applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM(): Unknown state reached."), 0, TRUE);
-				smsState = SimulationModeState_CleanUp;
-		}
-	}
-
-	return;
-}
-
-static void Sample_WEEGSystemCheckFSM(SampleThreadData * pstd)
-{
-	BOOL						blnErrorOccured;
-	BOOL						blnStayInFSM;
-	DWORD						dwReturnCode;
-	int							intNRetries;
-	int							intTimeout;
-	int							intSamplingFrequency;
-	tReceivedData				trdReceivedData;
-	unsigned char				uchrNWEEGDevicesFound, uchrWEEGCOMPort;
-	unsigned int				uintNTestPackets;
-	WEEGSystemCheckModeState	wscmsState;
-
-	// variable initialization
-	m_wsccCheckCode = WEEGSystem_OK;
-	blnStayInFSM = TRUE;
-	blnErrorOccured = FALSE;
-	intSamplingFrequency = *(pstd->pSamplingFrequency);
-	wscmsState = WEEGSystemCheckModeState_Stage1;
-
-	while(blnStayInFSM)
-	{
-		switch(wscmsState)
-		{
-			// Configuration of measurement device for testing state
-			case WEEGSystemCheckModeState_Stage1:
-				// variable init
-				intNRetries = 0;
-								
-				//
-				// detect the WEEG coordinator's COM port
-				//
-				uchrNWEEGDevicesFound = serial_DetectWEEGPort(&uchrWEEGCOMPort, 1);
-				if(uchrNWEEGDevicesFound == 0)
-				{
-					m_wsccCheckCode = WEEGSystem_COORD_DC;
-					blnErrorOccured = TRUE;
-				}
-				else
-				{
-					m_cfgConfiguration.COMPortIndex = uchrWEEGCOMPort - 1;
-					
-					if(uchrNWEEGDevicesFound > 1)
-					{
-						m_wsccCheckCode = WEEGSystem_COORD_NCOM;
-						blnErrorOccured = TRUE;
-					}
-				}
-				
-				//
-				// open serial communication port
-				//
-				if(!blnErrorOccured)
-				{
-					dwReturnCode = serial_OpenPort (m_cfgConfiguration.COMPortIndex + 1);
-					if(dwReturnCode != ERROR_SUCCESS)
-					{
-						m_wsccCheckCode = WEEGSystem_COORD_COM;
-						blnErrorOccured = TRUE;
-					}
-				}
-
-				//
-				// configure WEEG system for measurement device test
-				// NOTE: even if this check succeeds, it doesn't mean that the WEEG measurment unit is on and recording
-				//
-				if(!blnErrorOccured)
-				{
-					dwReturnCode = serial_StartSampling(WEEG_DEVICENR, WEEG_NETNR, 0x00000000, MCHANNELMASK, intSamplingFrequency);
-					if(dwReturnCode != ERROR_SUCCESS)
-					{
-						m_wsccCheckCode = WEEGSystem_MEASDEV_CONFIG;
-						blnErrorOccured = TRUE;
-					}
-				}
-
-				//
-				// state transition
-				//
-				if(blnErrorOccured)
-					wscmsState = WEEGSystemCheckModeState_CleanUp;
-				else
-					wscmsState = WEEGSystemCheckModeState_Stage2;
-			break;
-
-			// Testing of measurement device state
-			case WEEGSystemCheckModeState_Stage2:
-				// variable initialization
-				uintNTestPackets = 0;
-				intTimeout = 0; intNRetries = 0;
-				
-				SecureZeroMemory(&trdReceivedData, sizeof(trdReceivedData));
-				while((uintNTestPackets < mc_uintNTestPacketsRequired) && m_wsccCheckCode == WEEGSystem_OK)
-				{
-					// Without this system will choke as this thread runs on high priority
-					Sleep(TRANSFER_IDLE);
-
-					switch (serial_ReceivedDataStateMachine (&trdReceivedData))
-					{
-						case ERR_NOERROR:
-							intTimeout = 0; intNRetries = 0;		
-							
-							// check if packet is valid
-							if (trdReceivedData.PacketType == SER_DATA)
-								uintNTestPackets++;
-						break;
-													    
-
-						case ERR_NODATA:
-							intTimeout++;		// No packet received?
-							
-							// check if timeout has occured
-							if(intTimeout > TRANSFER_PACKWAIT/TRANSFER_IDLE)
-							{
-								// yes: set appropriate WEEGSystemCheckCode and quit testing
-								m_wsccCheckCode = WEEGSystem_MEASDEV_TIMEOUT;
-								blnErrorOccured = TRUE;
-								break;
-							}
-						break;
-
-						case ERR_CHECKSUM:
-							intNRetries++;
-							
-							// check if max. number of checksum errors has been reached
-							if (intNRetries >= MAX_RETRIES)
-							{
-								// yes: set appropriate WEEGSystemCheckCode and quit testing
-								m_wsccCheckCode = WEEGSystem_MEASDEV_CHECKSUM;
-								blnErrorOccured = TRUE;
-								break;													   
-							}
-						break;
-					}
-				}
-
-				//
-				// state transition
-				//
-				wscmsState = WEEGSystemCheckModeState_CleanUp;
-			break;
-
-			case WEEGSystemCheckModeState_CleanUp:
-				// stop the WEEG measurement device
-				serial_StopSampling();
-
-				// close serial prot
-				serial_ClosePort();
-				
-				// exit the WEEG system check FSM
-				blnStayInFSM = FALSE;
-			break;
-			
-			default:
-				applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_WEEGSystemCheckFSM(): Unknown state reached."), 0, TRUE);
-				wscmsState = WEEGSystemCheckModeState_CleanUp;
-		}
-	}
-}
-
-static void Sample_RecordingFSM(SampleThreadData * pstd, HWND hwndMainWnd)
-{
-	BOOL						blnStayInFSM;
-	BOOL						blnStateErrorOccured;
-	DWORD						dwrdLastTimeStamp;
-	DWORD						dwrdReturnCode;
-	int							intNRetries;
-	int							intSamplingFrequency;
-	int							intTimeout;
-	RecordingModeState			rmsState;
-	SampleDataRecord			drCurrentDataRecord;
-	SerialCommunicationResult	scrResult;
-	TCHAR						strBuffer[256];
-	tPacket_DATA *				ptpMeasurementData;
-	tReceivedData				trdReceivedData;
-	
-	// variable initialization
-	blnStayInFSM = TRUE;
-	drCurrentDataRecord = mc_sdrEmpty;
-	intSamplingFrequency = *(pstd->pSamplingFrequency);
-	rmsState = RecordingModeState_Initialize;
-
-	while(blnStayInFSM)
-	{
-		switch(rmsState)
-		{
-			case RecordingModeState_Initialize:
-				blnStateErrorOccured = FALSE;
-
-				// set event to signaled state
-				SetEvent(pstd->hevSampleThread_Init);
-
-				// initialize data record structure
-				if(!Sample_InitDataRecord(&drCurrentDataRecord, intSamplingFrequency))
-				{
-					applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Failed to initialize data record structure."), 0, TRUE);
-					MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Failed to initialize data record structure."));
-					PostMessage (hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);	// Force stop
-					blnStateErrorOccured = TRUE;
-				}
-				
-				// open serial communication port
-				if(!blnStateErrorOccured)
-				{
-					dwrdReturnCode = serial_OpenPort (m_cfgConfiguration.COMPortIndex + 1);
-					if(dwrdReturnCode != ERROR_SUCCESS)
-					{
-						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Could not open/configure WEEG COM port. (GetLastError #)"), dwrdReturnCode, TRUE);
-						MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Could not open/configure WEEG COM port. (GetLastError #%d)"), dwrdReturnCode);
-						PostMessage (hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);	// Force stop
-						blnStateErrorOccured = TRUE;
-					}
-				}
-
-				// check if configuration was successfull
-				if(!blnStateErrorOccured)
-				{
-					dwrdReturnCode = serial_StartSampling(WEEG_DEVICENR, WEEG_NETNR, 0x00000000, MCHANNELMASK, intSamplingFrequency);
-					if(dwrdReturnCode != ERROR_SUCCESS)
-					{
-						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Unable to configure WEEG device and start recording."), 0, TRUE);
-						MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Unable to configure WEEG device and start recording."));
-						PostMessage (hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Abort);
-						blnStateErrorOccured = TRUE;
-					}
-				}
-
-				//
-				// state transition
-				//
-				if(blnStateErrorOccured)
-					rmsState = RecordingModeState_CleanUp;
-				else
-					rmsState = RecordingModeState_Acquire;
-			break;
-			
-			// Sampling state
-			case RecordingModeState_Acquire:
-				blnStateErrorOccured = FALSE;
-
-				// init variables for data aquisition state
-				SecureZeroMemory(&trdReceivedData, sizeof(trdReceivedData));
-				dwrdLastTimeStamp = 0x0000;
-				intTimeout = 0; intNRetries = 0;
-					
-				// initialize statistics variables
-				m_lngNPacketsReceived = 0;
-				m_lngNPacketChecksumErrors = 0;
-				m_intNPacketsLost = 0;
-
-				while(!(pstd->EndActivity))
-				{
-					// Without this system will choke as this thread runs on high priority
-					Sleep (TRANSFER_IDLE);
-
-					// check received packet buffer
-					while ((scrResult = serial_ReceivedDataStateMachine (&trdReceivedData)) != ERR_NODATA &&
-						   !blnStateErrorOccured)
-					{
-						//reset intTimeout variable
-						intTimeout = 0;
-
-						switch(scrResult)
-						{
-							case ERR_NOERROR:
-								intTimeout = 0; intNRetries = 0;		// Received valid packet?
-
-								if (trdReceivedData.PacketType == SER_DATA)
-								{
-									ptpMeasurementData = (tPacket_DATA *) trdReceivedData.PacketData;
-
-									// check the packet's time stamp
-									if(m_lngNPacketsReceived > 0)
-									{
-										if (ptpMeasurementData->TimeStamp <= dwrdLastTimeStamp)
-											break;
-										else if(ptpMeasurementData->TimeStamp > (dwrdLastTimeStamp + mc_intSampleLengths [EEGCHANNELS]))
-										{
-											_stprintf_s(strBuffer,
-														sizeof(strBuffer)/sizeof(TCHAR),
-														TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_NOERROR: Packet Timestamp Error: was expecting %u, received %u."),
-														dwrdLastTimeStamp + mc_intSampleLengths [EEGCHANNELS],
-														ptpMeasurementData->TimeStamp);
-											applog_logevent(SoftwareError, TEXT("SampleThread"), strBuffer, 0, TRUE);
-											m_intNPacketsLost += (ptpMeasurementData->TimeStamp - dwrdLastTimeStamp)/mc_intSampleLengths [EEGCHANNELS];
-										}
-									}
-									dwrdLastTimeStamp = ptpMeasurementData->TimeStamp;
-								
-									m_lngNPacketsReceived++;
-								
-									// Ok, handle data
-									if (!Sample_ProcessDataPacket (ptpMeasurementData, &drCurrentDataRecord, pstd, hwndMainWnd))
-									{
-										applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_NOERROR: Unable to process and store data record."), 0, TRUE);
-										MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_NOERROR: Unable to process and store data record."));
-										blnStateErrorOccured = TRUE;
-									}
-								}
-							break;
-
-							case ERR_CHECKSUM:
-								intNRetries++;
-								m_lngNPacketChecksumErrors++;
-
-								if (intNRetries >= MAX_RETRIES)
-								{
-									applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_CHECKSUM: Measurement aborted due to high number of checksum errors."), 0, TRUE);
-									MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_CHECKSUM: Measurement aborted due to high number of checksum errors."));
-									blnStateErrorOccured = TRUE;
-								}
-							break;
-
-							default:
-								applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: serial_ReceivedDataStateMachine() returned unhandled SerialCommunicationResult."), 0, TRUE);
-						}
-					}
-					
-					// check if canceling of measurement is requested
-					if(blnStateErrorOccured)
-					{
-						// post cancel message to main thread
-						PostMessage (hwndMainWnd, WM_COMMAND, IDM_SAMPLE_STOP, (LPARAM) Stop_Cancel);
-						break;
-					}
-					
-					// check if communication has timed out
-					if(++intTimeout > TRANSFER_PACKWAIT/TRANSFER_IDLE)
-					{
-						if (!Sample_DetectedCommunicationFailure(&drCurrentDataRecord, pstd, hwndMainWnd))
-						{
-							applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Unable to process and store communication blackout data record. (errno #)"), 0, TRUE);
-							MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Unable to process and store communication blackout data record. (errno #%d)"), 0);
-						}
-					}
-				}
-
-				//
-				// state transition
-				//
-				rmsState = RecordingModeState_CleanUp;
-			break;
-
-			case RecordingModeState_CleanUp:
-				serial_StopSampling();
-
-				serial_ClosePort();
-
-				Sample_FreeDataRecord(&drCurrentDataRecord);
-
-				blnStayInFSM = FALSE;
-			break;
-
-			default:
-				m_stsCurrentSampleThreadState = SampleThreadState_Idle;
-		}
-	}
-}
\ No newline at end of file
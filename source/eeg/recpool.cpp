@@ -0,0 +1,156 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		recpool.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Pool of reference-counted buffers in which the data records are shared by the acquisition threads.
+ *
+ * The sample thread decodes the samples of a data record straight into a buffer of the pool. Once the record is complete,
+ * the storage and streaming threads each take a reference to the same buffer instead of a copy of the record, and the
+ * sample thread continues in a new buffer; the buffer goes back to the pool when the last reference is released. The
+ * bytes in front of the record are reserved for the streaming thread, which writes the header of the EEGEM packet there
+ * so that the record can be sent without being copied into a packet.
+ *
+ * The released buffers are kept in an interlocked singly-linked list, so neither taking nor releasing a buffer waits for
+ * another thread.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <errno.h>
+#include <malloc.h>
+#include <string.h>
+
+// program headers
+#include "applog.h"
+#include "recpool.h"
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static SLIST_HEADER			m_slhFree;								///< released buffers that can be reused (a zeroed header is an empty list, so no initialization is needed)
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Takes a buffer from the pool (or allocates a new one if no free buffer is large enough).
+ *
+ * The buffer is returned with one reference, which belongs to the caller. Its Data is not initialized.
+ *
+ * \param[in]	uintLength	size of the record to be stored in the buffer, in bytes
+ * \return Pointer to the buffer if successful, NULL otherwise.
+ */
+RecordBuffer * recpool_Acquire(unsigned int uintLength)
+{
+	RecordBuffer * prbBuffer;
+
+	// free buffers that are too small (e.g. the ones that held a header record) are given back to the heap
+	while((prbBuffer = (RecordBuffer *) InterlockedPopEntrySList(&m_slhFree)) != NULL && prbBuffer->Capacity < uintLength)
+		_aligned_free(prbBuffer);
+
+	if(prbBuffer == NULL)
+	{
+		// the record is placed after the buffer's header and the bytes reserved for the streaming thread
+		prbBuffer = (RecordBuffer *) _aligned_malloc(sizeof(RecordBuffer) + RECPOOL_HEADROOM + uintLength, MEMORY_ALLOCATION_ALIGNMENT);
+		if(prbBuffer == NULL)
+		{
+			applog_logevent(SoftwareError, TEXT("RecordPool"), TEXT("recpool_Acquire(): Failed to allocate memory for the buffer. (errno #)"), errno, TRUE);
+			return NULL;
+		}
+
+		prbBuffer->Capacity = uintLength;
+		prbBuffer->Data = (BYTE *) (prbBuffer + 1) + RECPOOL_HEADROOM;
+	}
+
+	prbBuffer->RefCount = 1;
+	prbBuffer->Length = uintLength;
+	prbBuffer->ArrivalTime = 0;
+
+	return prbBuffer;
+}
+
+/**
+ * \brief Takes an additional reference to a buffer.
+ *
+ * \param[in]	prbBuffer	buffer
+ * \return Nothing.
+ */
+void recpool_AddRef(RecordBuffer * prbBuffer)
+{
+	InterlockedIncrement(&prbBuffer->RefCount);
+}
+
+/**
+ * \brief Takes a buffer from the pool and copies a record into it.
+ *
+ * \param[in]	pData		record
+ * \param[in]	uintLength	size of pData, in bytes
+ * \return Pointer to the buffer (with one reference, which belongs to the caller) if successful, NULL otherwise.
+ */
+RecordBuffer * recpool_Copy(const void * pData, unsigned int uintLength)
+{
+	RecordBuffer * prbBuffer;
+
+	prbBuffer = recpool_Acquire(uintLength);
+	if(prbBuffer != NULL)
+		memcpy_s(prbBuffer->Data, prbBuffer->Capacity, pData, uintLength);
+
+	return prbBuffer;
+}
+
+/**
+ * \brief Gives the free buffers of the pool back to the heap.
+ *
+ * The buffers that are still referenced are not affected; they go back to the pool when they are released.
+ *
+ * \return Nothing.
+ */
+void recpool_Destroy(void)
+{
+	RecordBuffer * prbBuffer;
+
+	while((prbBuffer = (RecordBuffer *) InterlockedPopEntrySList(&m_slhFree)) != NULL)
+		_aligned_free(prbBuffer);
+}
+
+/**
+ * \brief Releases a reference to a buffer. The buffer goes back to the pool when its last reference is released.
+ *
+ * \param[in]	prbBuffer	buffer (can be NULL)
+ * \return Nothing.
+ */
+void recpool_Release(RecordBuffer * prbBuffer)
+{
+	if(prbBuffer == NULL || InterlockedDecrement(&prbBuffer->RefCount) != 0)
+		return;
+
+	// keep a bounded number of free buffers (the sample thread needs only one at a time, but a consumer may release several at once)
+	if(QueryDepthSList(&m_slhFree) < RECPOOL_MAXFREE)
+		InterlockedPushEntrySList(&m_slhFree, &prbBuffer->ListEntry);
+	else
+		_aligned_free(prbBuffer);
+}
@@ -0,0 +1,53 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		recpool.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the pool of reference-counted buffers in which the data records are shared by the acquisition threads.
+ *
+ * $Id$
+ */
+
+# ifndef __RECPOOL_H__
+# define __RECPOOL_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define RECPOOL_HEADROOM				32						///< number of bytes in front of the Data of every buffer that are reserved for the header of the packet in which it is streamed
+# define RECPOOL_MAXFREE				16						///< maximum number of released buffers that are kept for reuse
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Buffer that holds one record. The buffer is released when the last of the threads that hold a reference to it calls
+ * recpool_Release(); until then, its Data must not be modified.
+ */
+typedef struct
+{
+	SLIST_ENTRY		ListEntry;										///< link of the list of free buffers (must be the first member)
+	volatile LONG	RefCount;										///< number of references held to the buffer
+	unsigned int	Capacity;										///< size of the memory allocated for Data, in bytes
+	unsigned int	Length;											///< size of the record stored in Data, in bytes
+	DWORD			ArrivalTime;									///< time at which the data that completed the record was received (see latency_Now(); 0 if not measured)
+	BYTE *			Data;											///< record (preceded by RECPOOL_HEADROOM bytes that belong to the streaming thread)
+}
+RecordBuffer;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+RecordBuffer *	recpool_Acquire(unsigned int uintLength);
+void			recpool_AddRef(RecordBuffer * prbBuffer);
+RecordBuffer *	recpool_Copy(const void * pData, unsigned int uintLength);
+void			recpool_Destroy(void);
+void			recpool_Release(RecordBuffer * prbBuffer);
+
+# endif
@@ -21,6 +21,7 @@
 #define IDM_TESTCONNSCRIPT              113
 #define IDI_ICON                        114
 #define IDT_RTC_TIMER                   114
+#define IDT_LINKSTATS_TIMER             115
 #define IDI_BATLOW1                     116
 #define IDD_RECORDINGINFORMATION        119
 #define IDI_BATLOW2                     122
@@ -92,12 +93,16 @@
 #define IDC_CONNECTIONSLISTBOX          1065
 #define IDC_ICC_CONNECTIONSLISTBOX      1065
 #define IDC_ICC_CONNSCRIPT_FILE         1066
+#define IDC_LINKSTATISTICS              1067
+#define IDC_LATENCYPROBES               1068
+#define IDC_LATENCYEXPORT               1069
 #define IDD_ANNOTATIONS                 3010
 #define IDD_SETTINGS                    3020
 #define IDD_SSHCONFIG                   3021
 #define IDD_ABOUTBOX                    3022
 #define IDD_STREAMINGCONFIG             3023
 #define IDD_INTERNETCONFIG              3024
+#define IDD_LINKSTATISTICS              3025
 #define IDA_CTRLS                       10202
 #define IDA_CTRLE                       10203
 #define IDC_NAME                        20401
@@ -141,7 +146,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        168
 #define _APS_NEXT_COMMAND_VALUE         40028
-#define _APS_NEXT_CONTROL_VALUE         1067
-#define _APS_NEXT_SYMED_VALUE           115
+#define _APS_NEXT_CONTROL_VALUE         1070
+#define _APS_NEXT_SYMED_VALUE           116
 #endif
 #endif
@@ -0,0 +1,300 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		samplering.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that passes the decoded samples from the sample thread to the display.
+ *
+ * The ring has a single producer (the sample thread) and a single consumer (the redraw timer of the GUI thread), so it
+ * needs no lock: each side owns one free-running index, which only it writes, and the two indices are kept on separate
+ * cache lines. The producer stores the samples of a whole DATA packet in every channel and then publishes them with a
+ * single index update; the consumer reads all of the published samples in place and hands them back once it is done
+ * with them. Neither thread ever waits for the other.
+ *
+ * Every sample is stored twice, at its position and one ring length further, so that the samples waiting to be read are
+ * always contiguous and can be handed to the signal processing functions without being copied.
+ *
+ * When the GUI falls behind by more than the length of the ring, the producer drops the newest samples instead of
+ * overwriting the ones that the consumer may be reading, and counts them.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <windows.h>
+
+// CRT libraries
+#include <stdlib.h>
+
+// program headers
+#include "samplering.h"
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * State of the producer (one cache line).
+ */
+typedef struct
+{
+	volatile ULONG	WriteIndex;										///< index of the next sample to be published (read by the consumer)
+	ULONG			PendingIndex;									///< index of the next sample to be written (not published yet)
+	ULONG			CachedReadIndex;								///< last value of ReadIndex seen by the producer
+	BOOL			Overrun;										///< TRUE while samples are being dropped
+	volatile ULONG	NSamplesWritten;
+	volatile ULONG	NSamplesDropped;
+	volatile ULONG	NOverruns;
+	volatile ULONG	MaxOccupancy;
+}
+SampleRingProducer;
+
+/**
+ * State of the consumer (one cache line).
+ */
+typedef struct
+{
+	volatile ULONG	ReadIndex;										///< index of the next sample to be read (read by the producer)
+}
+SampleRingConsumer;
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static DECLSPEC_ALIGN(SAMPLERING_CACHELINE) SampleRingProducer	m_srpProducer;
+static DECLSPEC_ALIGN(SAMPLERING_CACHELINE) SampleRingConsumer	m_srcConsumer;
+
+// set up by samplering_Create() and constant until samplering_Destroy()
+static DECLSPEC_ALIGN(SAMPLERING_CACHELINE) short *			m_pshrSamples;		///< samples of all channels (channel n starts at n*2*m_ulngLength)
+static ULONG												m_ulngLength;		///< number of samples per channel (power of 2)
+static unsigned int											m_uintNChannels;
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Starts a write of the producer.
+ *
+ * The samples that do not fit in the ring are dropped. The producer then writes each channel with
+ * samplering_WriteChannel() or samplering_FillChannel() and ends the write with samplering_EndWrite().
+ *
+ * \param[in]	uintNSamples	number of samples per channel that the producer wants to write
+ * \return Number of samples per channel that can be written.
+ */
+unsigned int samplering_BeginWrite(unsigned int uintNSamples)
+{
+	ULONG ulngNFree;
+
+	// the consumer's index is only re-read when the ring seems to be full
+	ulngNFree = m_ulngLength - (m_srpProducer.PendingIndex - m_srpProducer.CachedReadIndex);
+	if(ulngNFree < uintNSamples)
+	{
+		m_srpProducer.CachedReadIndex = m_srcConsumer.ReadIndex;
+		ulngNFree = m_ulngLength - (m_srpProducer.PendingIndex - m_srpProducer.CachedReadIndex);
+	}
+
+	if(ulngNFree < uintNSamples)
+	{
+		m_srpProducer.NSamplesDropped += uintNSamples - ulngNFree;
+		if(!m_srpProducer.Overrun)
+			m_srpProducer.NOverruns++;
+		m_srpProducer.Overrun = TRUE;
+		return ulngNFree;
+	}
+
+	m_srpProducer.Overrun = FALSE;
+	return uintNSamples;
+}
+
+/**
+ * \brief Creates the ring and clears all of its samples.
+ *
+ * Must be called before the sample thread starts producing.
+ *
+ * \param[in]	uintNChannels	number of channels
+ * \param[in]	uintMinLength	minimum number of samples per channel (rounded up to a power of 2)
+ * \return TRUE if successful, FALSE otherwise.
+ */
+BOOL samplering_Create(unsigned int uintNChannels, unsigned int uintMinLength)
+{
+	samplering_Destroy();
+
+	for(m_ulngLength = 1; m_ulngLength < uintMinLength; m_ulngLength <<= 1);
+	m_uintNChannels = uintNChannels;
+
+	m_pshrSamples = (short *) calloc(m_uintNChannels*2*m_ulngLength, sizeof(short));
+	if(m_pshrSamples == NULL)
+		return FALSE;
+
+	SecureZeroMemory((void *) &m_srpProducer, sizeof(m_srpProducer));
+	SecureZeroMemory((void *) &m_srcConsumer, sizeof(m_srcConsumer));
+
+	return TRUE;
+}
+
+/**
+ * \brief Releases the samples of the ring.
+ *
+ * Must only be called while neither the producer nor the consumer use the ring.
+ *
+ * \return Nothing.
+ */
+void samplering_Destroy(void)
+{
+	if(m_pshrSamples != NULL)
+	{
+		free(m_pshrSamples);
+		m_pshrSamples = NULL;
+	}
+}
+
+/**
+ * \brief Ends a write of the producer.
+ *
+ * The samples only become visible to the consumer with the next call to samplering_Publish().
+ *
+ * \param[in]	uintNSamples	number of samples per channel that were written (value returned by samplering_BeginWrite())
+ * \return Nothing.
+ */
+void samplering_EndWrite(unsigned int uintNSamples)
+{
+	ULONG ulngOccupancy;
+
+	m_srpProducer.PendingIndex += uintNSamples;
+	m_srpProducer.NSamplesWritten += uintNSamples;
+
+	ulngOccupancy = m_srpProducer.PendingIndex - m_srpProducer.CachedReadIndex;
+	if(ulngOccupancy > m_srpProducer.MaxOccupancy)
+		m_srpProducer.MaxOccupancy = ulngOccupancy;
+}
+
+/**
+ * \brief Writes the same value to a number of samples of a channel.
+ *
+ * \param[in]	uintChannel		channel
+ * \param[in]	shrValue		value of the samples
+ * \param[in]	uintNSamples	number of samples
+ * \return Nothing.
+ */
+void samplering_FillChannel(unsigned int uintChannel, short shrValue, unsigned int uintNSamples)
+{
+	short * pshrChannel;
+	ULONG i, ulngPosition;
+
+	pshrChannel = m_pshrSamples + uintChannel*2*m_ulngLength;
+	for(i = 0; i < uintNSamples; i++)
+	{
+		ulngPosition = (m_srpProducer.PendingIndex + i) & (m_ulngLength - 1);
+		pshrChannel[ulngPosition] = pshrChannel[ulngPosition + m_ulngLength] = shrValue;
+	}
+}
+
+/**
+ * \brief Reads the counters of the ring.
+ *
+ * Can be called from any thread (the counters are read one by one, so they may be slightly out of step with each other).
+ *
+ * \param[out]	psrsStatistics	buffer where the counters are to be stored
+ * \return Nothing.
+ */
+void samplering_GetStatistics(SampleRingStatistics * psrsStatistics)
+{
+	psrsStatistics->NSamplesWritten = m_srpProducer.NSamplesWritten;
+	psrsStatistics->NSamplesDropped = m_srpProducer.NSamplesDropped;
+	psrsStatistics->NOverruns = m_srpProducer.NOverruns;
+	psrsStatistics->MaxOccupancy = m_srpProducer.MaxOccupancy;
+	psrsStatistics->Length = m_ulngLength;
+}
+
+/**
+ * \brief Gives the consumer the samples that have been published and not yet released.
+ *
+ * The samples are not copied: the consumer reads (and may modify) them in place until it passes them back with
+ * samplering_Release().
+ *
+ * \param[out]	ppshrSpans		array where a pointer to the first waiting sample of each channel is to be stored
+ * \return Number of samples per channel that are waiting to be read.
+ */
+unsigned int samplering_Peek(short ** ppshrSpans)
+{
+	ULONG ulngNSamples, ulngPosition;
+	unsigned int i;
+
+	if(m_pshrSamples == NULL)
+		return 0;
+
+	// the samples must not be read before the index that publishes them
+	ulngNSamples = m_srpProducer.WriteIndex - m_srcConsumer.ReadIndex;
+	MemoryBarrier();
+
+	ulngPosition = m_srcConsumer.ReadIndex & (m_ulngLength - 1);
+	for(i = 0; i < m_uintNChannels; i++)
+		ppshrSpans[i] = m_pshrSamples + i*2*m_ulngLength + ulngPosition;
+
+	return (unsigned int) ulngNSamples;
+}
+
+/**
+ * \brief Makes the samples written since the last call visible to the consumer.
+ *
+ * \return Nothing.
+ */
+void samplering_Publish(void)
+{
+	// the samples have to be stored before the index that publishes them
+	MemoryBarrier();
+	m_srpProducer.WriteIndex = m_srpProducer.PendingIndex;
+}
+
+/**
+ * \brief Passes samples that the consumer is done with back to the producer.
+ *
+ * \param[in]	uintNSamples	number of samples per channel (at most the value returned by samplering_Peek())
+ * \return Nothing.
+ */
+void samplering_Release(unsigned int uintNSamples)
+{
+	// the samples have to be read before the producer may overwrite them
+	MemoryBarrier();
+	m_srcConsumer.ReadIndex += uintNSamples;
+}
+
+/**
+ * \brief Writes samples to a channel, adding an offset to each of them.
+ *
+ * \param[in]	uintChannel		channel
+ * \param[in]	pshrSamples		samples
+ * \param[in]	uintNSamples	number of samples
+ * \param[in]	shrOffset		offset to be added to each sample
+ * \return Nothing.
+ */
+void samplering_WriteChannel(unsigned int uintChannel, const short * pshrSamples, unsigned int uintNSamples, short shrOffset)
+{
+	short * pshrChannel;
+	ULONG i, ulngPosition;
+
+	pshrChannel = m_pshrSamples + uintChannel*2*m_ulngLength;
+	for(i = 0; i < uintNSamples; i++)
+	{
+		ulngPosition = (m_srpProducer.PendingIndex + i) & (m_ulngLength - 1);
+		pshrChannel[ulngPosition] = pshrChannel[ulngPosition + m_ulngLength] = pshrSamples[i] + shrOffset;
+	}
+}
@@ -0,0 +1,61 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		samplering.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that passes the decoded samples from the sample thread to the display.
+ *
+ * $Id$
+ */
+
+# ifndef __SAMPLERING_H__
+# define __SAMPLERING_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define SAMPLERING_CACHELINE			64						///< size of a cache line (the indices of the producer and the consumer are kept on separate lines)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Counters of the sample ring. The producer never waits for the consumer and never overwrites samples that have not been
+ * read: when the ring is full, the newest samples are dropped.
+ */
+typedef struct
+{
+	unsigned long	NSamplesWritten;								///< number of samples (per channel) stored in the ring
+	unsigned long	NSamplesDropped;								///< number of samples (per channel) dropped because the ring was full
+	unsigned long	NOverruns;										///< number of times the ring became full (consecutive drops count once)
+	unsigned long	MaxOccupancy;									///< largest number of samples waiting to be read (as last seen by the producer, so it may be overestimated)
+	unsigned long	Length;											///< capacity of the ring, in samples per channel
+}
+SampleRingStatistics;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+// life cycle
+BOOL			samplering_Create(unsigned int uintNChannels, unsigned int uintMinLength);
+void			samplering_Destroy(void);
+void			samplering_GetStatistics(SampleRingStatistics * psrsStatistics);
+
+// producer (sample thread)
+unsigned int	samplering_BeginWrite(unsigned int uintNSamples);
+void			samplering_EndWrite(unsigned int uintNSamples);
+void			samplering_FillChannel(unsigned int uintChannel, short shrValue, unsigned int uintNSamples);
+void			samplering_Publish(void);
+void			samplering_WriteChannel(unsigned int uintChannel, const short * pshrSamples, unsigned int uintNSamples, short shrOffset);
+
+// consumer (GUI thread)
+unsigned int	samplering_Peek(short ** ppshrSpans);
+void			samplering_Release(unsigned int uintNSamples);
+
+# endif
@@ -7,99 +7,314 @@
  * $Id: serialV4.cpp 76 2013-02-14 14:26:17Z jakab $
  */
 
+# include <stddef.h>
+# include <stdlib.h>
+# include <string.h>
+# ifndef _WIN32
+# include <dirent.h>
+# include <errno.h>
+# include <fcntl.h>
+# include <limits.h>
+# include <poll.h>
+# include <termios.h>
+# include <unistd.h>
+# endif
+
 # include "serialV4.h"
+# include "capture.h"
+# include "latency.h"
+# include "simd.h"
+
+static const Transport *	m_ptTransport;						// transport over which the link is run (selected with serial_SetTransport)
+static TransportType		m_ttTransportType = Transport_COMPort;
+static TCHAR				m_strTransportAddress [TRANSPORT_MAX_ADDRESS_LEN + 1];
+static BOOL					m_blnPortOpen;
+
+// reader thread & the single-producer/single-consumer ring buffer between it and the packet framer
+static HANDLE					m_hReaderThread;
+static HANDLE					m_hevReaderStop;			// signaled by serial_ClosePort() to stop the reader thread
+static HANDLE					m_hevDataAvailable;			// auto-reset event signaled by the reader thread after it has added data to the ring
+static BYTE						m_bytRing [SERBUF_RING];
+static volatile LONG			m_lngRingHead;				// total number of bytes written to the ring (modified only by the reader thread)
+static volatile LONG			m_lngRingTail;				// total number of bytes consumed from the ring (modified only by the framer)
+static volatile LONG			m_lngArrivalTime;			// time of the latest transport read (see latency_Now()); set before the data is published
+static volatile LONG			m_lngLinkClosed;			// TRUE once the transport has reported that the connection is gone (see serial_IsLinkClosed())
+static SerialReaderStatistics	m_srsStatistics;
+
+// state of one of the concurrent port probes of serial_ProbeWEEGPort(); released by whichever of the probe thread and the
+// caller finishes last, so that a probe stuck in the driver (e.g., a Bluetooth port that is connecting) can be abandoned
+typedef struct
+{
+	volatile LONG	RefCount;
+	unsigned char	Port;						// COM port number
+	HANDLE			hevStop;					// signaled by the caller to stop the probe
+	DWORD			Deadline;					// GetTickCount() value at which the probe gives up
+	LARGE_INTEGER	StartCounter;				// performance counter value when the probes were started
+	LARGE_INTEGER	Frequency;					// frequency of the performance counter
+	volatile LONG	Responded;					// TRUE once the coordinator has acknowledged the POLL packet
+	DWORD			ResponseTime;				// time from StartCounter until the ACK was received (microseconds)
+}
+SerialProbe;
+
+// POLL packet sent by the port probes and the coordinator's reply
+static const BYTE				mc_bytProbePoll [SERHDR_SIZE + 1] = {PREAMBLE, PREAMBLE, PREAMBLE, PREAMBLE, SER_POLL, 0, (BYTE) ~(SER_POLL + 0)};
+static const BYTE				mc_bytProbeAck [SERHDR_SIZE + 1] = {PREAMBLE, PREAMBLE, PREAMBLE, PREAMBLE, SER_ACK, 0, (BYTE) ~(SER_ACK + 0)};
+
+/**
+ * \brief Moves all of the data that the transport has received to the ring buffer.
+ *
+ * If the framer has fallen so far behind that the ring is full, the new data is discarded (and counted) so that the
+ * driver's queue does not overflow; the framer resynchronizes on the next preamble. Lossless transports (replay) are
+ * instead left unread until the framer has made room.
+ *
+ * If the transport reports that the connection is gone, the link is marked as closed and the framer is woken up.
+ *
+ * \return Nothing.
+ */
+static void serial_DrainPort (void)
+{
+	BYTE bytDiscard [256];
+	DWORD dwrdHead, dwrdFree, dwrdLength, dwrdNBytesRead, dwrdFill;
+
+	do
+	{
+		dwrdHead = (DWORD) m_lngRingHead;
+		dwrdFree = SERBUF_RING - (dwrdHead - (DWORD) m_lngRingTail);
+		if (dwrdFree == 0)
+		{
+			if (m_ptTransport->Lossless)
+				return;
+
+			dwrdNBytesRead = m_ptTransport->Read (bytDiscard, sizeof(bytDiscard));
+			if (dwrdNBytesRead == TRANSPORT_CLOSED)
+				break;
+			capture_Record (CaptureDirection_Received, bytDiscard, dwrdNBytesRead);
+			m_srsStatistics.NBytesDropped += dwrdNBytesRead;
+			continue;
+		}
 
-static HANDLE	m_hCOMPort;
+		// read up to the end of the free space or the end of the ring, whichever comes first
+		dwrdLength = SERBUF_RING - (dwrdHead & (SERBUF_RING - 1));
+		if (dwrdLength > dwrdFree)
+			dwrdLength = dwrdFree;
+		dwrdNBytesRead = m_ptTransport->Read (m_bytRing + (dwrdHead & (SERBUF_RING - 1)), dwrdLength);
+		if (dwrdNBytesRead == TRANSPORT_CLOSED)
+			break;
+		if (dwrdNBytesRead > 0)
+		{
+			capture_Record (CaptureDirection_Received, m_bytRing + (dwrdHead & (SERBUF_RING - 1)), dwrdNBytesRead);
+			m_lngArrivalTime = (LONG) latency_Now ();
+
+			// publish data (full memory barrier: the bytes are visible before the new head)
+			InterlockedExchange (&m_lngRingHead, (LONG) (dwrdHead + dwrdNBytesRead));
+			SetEvent (m_hevDataAvailable);
+
+			m_srsStatistics.NBytesReceived += dwrdNBytesRead;
+			dwrdFill = dwrdHead + dwrdNBytesRead - (DWORD) m_lngRingTail;
+			if (dwrdFill > (DWORD) m_srsStatistics.RingHighWaterMark)
+				m_srsStatistics.RingHighWaterMark = (LONG) dwrdFill;
+		}
+	}
+	while (dwrdNBytesRead > 0);
+
+	if (dwrdNBytesRead == TRANSPORT_CLOSED)
+	{
+		InterlockedExchange (&m_lngLinkClosed, TRUE);
+		SetEvent (m_hevDataAvailable);
+	}
+}
+
+/**
+ * \brief Function executed by the serial reader thread.
+ *
+ * The thread blocks in the transport's WaitForData() hook (e.g., an overlapped WaitCommEvent() for the COM port) until
+ * data arrives and then drains the transport into the ring buffer. A wait that times out (TRANSFER_CHARWAIT) only serves
+ * as a safety net, e.g. for drivers that coalesce notifications. Once the connection is gone, the thread only waits to
+ * be stopped (the port is reopened by serial_OpenPort()).
+ *
+ * \param[in]	lParam		not used
+ * \return 0.
+ */
+static long WINAPI serial_ReaderThread (LPARAM lParam)
+{
+	while (TRUE)
+	{
+		serial_DrainPort ();
+
+		if (m_lngLinkClosed)
+		{
+			WaitForSingleObject (m_hevReaderStop, INFINITE);
+			break;
+		}
+
+		// ring full & transport can wait: give the framer time to make room
+		if (m_ptTransport->Lossless && (DWORD) m_lngRingHead - (DWORD) m_lngRingTail == SERBUF_RING)
+		{
+			if (WaitForSingleObject (m_hevReaderStop, 1) == WAIT_OBJECT_0)
+				break;
+			continue;
+		}
+
+		// block until data arrives or the thread is asked to stop
+		if (m_ptTransport->WaitForData (m_hevReaderStop, TRANSFER_CHARWAIT) == WAIT_OBJECT_0 + 1)
+			break;
+		m_srsStatistics.NReaderWakeUps++;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Copies unconsumed data from the ring buffer.
+ *
+ * \param[out]	pbytBuffer		buffer where the data is to be stored
+ * \param[in]	dwrdLength		length of pbytBuffer
+ * \return Number of bytes copied.
+ */
+static DWORD serial_ReadRing (BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	DWORD dwrdTail, dwrdNBytes, dwrdFirst;
+
+	dwrdTail = (DWORD) m_lngRingTail;
+	dwrdNBytes = (DWORD) m_lngRingHead - dwrdTail;
+	if (dwrdNBytes > dwrdLength)
+		dwrdNBytes = dwrdLength;
+	if (dwrdNBytes == 0)
+		return 0;
+
+	// the data may wrap around the end of the ring
+	dwrdFirst = SERBUF_RING - (dwrdTail & (SERBUF_RING - 1));
+	if (dwrdFirst > dwrdNBytes)
+		dwrdFirst = dwrdNBytes;
+	memcpy (pbytBuffer, m_bytRing + (dwrdTail & (SERBUF_RING - 1)), dwrdFirst);
+	memcpy (pbytBuffer + dwrdFirst, m_bytRing, dwrdNBytes - dwrdFirst);
+
+	// release the space only after the bytes have been copied
+	InterlockedExchange (&m_lngRingTail, (LONG) (dwrdTail + dwrdNBytes));
+
+	return dwrdNBytes;
+}
+
+/**
+ * \brief Discards all of the received data that has not been framed yet, both in the transport and in the ring buffer.
+ *
+ * \return Nothing.
+ */
+static void serial_Purge (void)
+{
+	if (m_ptTransport->Purge())
+		InterlockedExchange (&m_lngRingTail, m_lngRingHead);
+}
+
+/**
+ * \brief Builds the path of a serial port from its number.
+ *
+ * \param[in]	intCOMPort		port number (1 - 256): COM<n> on Windows, /dev/ttyUSB<n - 1> on POSIX systems
+ * \param[out]	strPath			buffer where the path is to be stored
+ * \param[in]	sztPathLen		length of strPath, in characters
+ * \return Nothing.
+ */
+static void serial_GetPortPath (int intCOMPort, TCHAR * strPath, size_t sztPathLen)
+{
+#ifdef _WIN32
+	_stprintf_s (strPath, sztPathLen, TEXT("\\\\.\\COM%d"), intCOMPort);
+#else
+	_stprintf_s (strPath, sztPathLen, DEVICE_TTY_FORMAT, intCOMPort - 1);
+#endif
+}
+
+/**
+ * \brief Selects the transport over which the link is run by subsequent calls to serial_OpenPort().
+ *
+ * \param[in]	ttType			transport type
+ * \param[in]	strAddress		capture file path (Transport_File), host:port (Transport_TCP) or EDF+ file path (Transport_Emulator,
+ *								empty for synthetic signals); for Transport_COMPort, ignored on Windows, and on POSIX systems
+ *								an optional device path (e.g., a pseudo-terminal) that replaces the port number
+ * \param[in]	blnRealTime		TRUE to replay capture files at the link's speed, FALSE to replay them as fast as possible
+ * \return TRUE if successful, FALSE if \c ttType is invalid.
+ */
+BOOL serial_SetTransport (TransportType ttType, const TCHAR * strAddress, BOOL blnRealTime)
+{
+	if (transport_Get(ttType) == NULL)
+		return FALSE;
+
+	m_ttTransportType = ttType;
+	_tcsncpy_s (m_strTransportAddress, sizeof(m_strTransportAddress)/sizeof(TCHAR), strAddress, _TRUNCATE);
+	transport_SetReplaySpeed(blnRealTime);
+
+	return TRUE;
+}
+
+/**
+ * \brief Returns the transport over which the link is run.
+ *
+ * \return Transport type selected with serial_SetTransport().
+ */
+TransportType serial_GetTransport (void)
+{
+	return m_ttTransportType;
+}
 
 /**
- * \brief Open and initialize the requested serial port. Also, test selected serial port for suitability (must support baud rate of 230kbps).
+ * \brief Opens the selected transport, starts the reader thread and checks that a WEEG coordinator responds on it.
  *
- * The function first attempts to create a handle for the requested COM port (\cintCOMPort). If successfull,
- * it configures the port for 230400N81 serial communication and configures the size of the port's buffers.
- * Finally, it sets the port's read timeout.
+ * For the COM port transport, the port is configured for 230400N81 serial communication, its buffers are resized and
+ * its read timeout is set (see transport_COM_Open).
  *
- * \param[in]	intCOMPort		windows serial port number (1 - 256)
- * \return Handle to the COM port if the function is successful; otherwise, INVALID_HANDLE_VALUE.
+ * \param[in]	intCOMPort		serial port number (1 - 256, see serial_GetPortPath()); only used by the COM port transport
+ * \return ERROR_SUCCESS if successful, ERROR_BAD_UNIT if the coordinator did not respond, otherwise the error code
+ *		   returned by the transport.
  */
 DWORD serial_OpenPort (int intCOMPort)
 {
-	COMMTIMEOUTS ctTimeout;
 	DWORD dwReturnCode = ERROR_SUCCESS;
-	DCB dcbConfig;
 	int i, intRC;
-	TCHAR strCOMPort[10];
+	TCHAR strCOMPort[TRANSPORT_MAX_ADDRESS_LEN + 1];
 	tReceivedData trdReceivedData;
 		
 	//
 	// establish and configure communication link
 	//
-	// Open COM port
-	_stprintf_s (strCOMPort, sizeof(strCOMPort)/sizeof(TCHAR), TEXT("\\\\.\\COM%d"), intCOMPort);
-	m_hCOMPort = CreateFile (strCOMPort, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
-	if (m_hCOMPort == INVALID_HANDLE_VALUE)
+	m_ptTransport = transport_Get(m_ttTransportType);
+	if (m_ttTransportType == Transport_COMPort)
 	{
-		dwReturnCode = GetLastError();
-		return dwReturnCode;
+		serial_GetPortPath (intCOMPort, strCOMPort, sizeof(strCOMPort)/sizeof(TCHAR));
+#ifndef _WIN32
+		if (m_strTransportAddress[0] != TEXT('\0'))
+			_tcsncpy_s (strCOMPort, sizeof(strCOMPort)/sizeof(TCHAR), m_strTransportAddress, _TRUNCATE);
+#endif
+		dwReturnCode = m_ptTransport->Open (strCOMPort);
 	}
-	
-	// Retrieves the current control settings for COM port
-	SecureZeroMemory(&dcbConfig, sizeof(DCB));
-	dcbConfig.DCBlength = sizeof(DCB);
-	if(!GetCommState (m_hCOMPort, &dcbConfig))
-	{
-		dwReturnCode = GetLastError();
-		
-		CloseHandle(m_hCOMPort);
-		m_hCOMPort = INVALID_HANDLE_VALUE;
+	else
+		dwReturnCode = m_ptTransport->Open (m_strTransportAddress);
+	if (dwReturnCode != ERROR_SUCCESS)
 		return dwReturnCode;
-	}
+	m_blnPortOpen = TRUE;
 
-	// Set to 230400N81
-	dcbConfig.BaudRate = SERPORT_SPEED;
-	dcbConfig.StopBits = ONESTOPBIT;
-	dcbConfig.Parity = NOPARITY;
-	dcbConfig.ByteSize = 8;
-	dcbConfig.fOutxCtsFlow = FALSE;
-	dcbConfig.fOutxDsrFlow  = FALSE;
-	dcbConfig.fDtrControl = DTR_CONTROL_ENABLE;
-	dcbConfig.fDsrSensitivity = FALSE;
-	dcbConfig.fOutX = FALSE;
-	dcbConfig.fInX = FALSE;
-	dcbConfig.fNull = FALSE;
-	dcbConfig.fRtsControl = RTS_CONTROL_ENABLE;
-	dcbConfig.fAbortOnError = FALSE;
-	
-	// Configure COM port 
-	if (!SetCommState (m_hCOMPort, &dcbConfig))
+	//
+	// start reader thread
+	//
+	SecureZeroMemory(&m_srsStatistics, sizeof(m_srsStatistics));
+	m_lngRingHead = m_lngRingTail = 0;
+	m_lngLinkClosed = FALSE;
+	m_hevReaderStop = CreateEvent (NULL, TRUE, FALSE, NULL);
+	m_hevDataAvailable = CreateEvent (NULL, FALSE, FALSE, NULL);
+	if (m_hevReaderStop != NULL && m_hevDataAvailable != NULL)
 	{
-		dwReturnCode = GetLastError();
-		CloseHandle (m_hCOMPort);
-
-		m_hCOMPort = INVALID_HANDLE_VALUE;
-		return dwReturnCode;
+		m_hReaderThread = CreateThread (NULL,										// handle cannot be inherited by child processes
+										4096,										// initial size of the stack, in bytes
+										(LPTHREAD_START_ROUTINE) serial_ReaderThread,
+										NULL,										// no thread data
+										0,											// thread runs immediately after creation
+										NULL);										// thread identifier is not needed
 	}
-	
-	// Set serial port buffers
-	if (!SetupComm (m_hCOMPort, SERPORT_INQUEUE, SERPORT_OUTQUEUE))
+	if (m_hReaderThread == NULL)
 	{
 		dwReturnCode = GetLastError();
-		CloseHandle (m_hCOMPort);
-
-		m_hCOMPort = INVALID_HANDLE_VALUE;
-		return dwReturnCode;
-	}
-	
-	// Set COM port read timeout: return immediately with the bytes that have already been received, even if no bytes have been received.
-	SecureZeroMemory(&ctTimeout, sizeof (ctTimeout));
-	ctTimeout.ReadIntervalTimeout = MAXDWORD;     
-	if(!SetCommTimeouts (m_hCOMPort, &ctTimeout))
-	{
-		dwReturnCode = GetLastError();
-
-		CloseHandle(m_hCOMPort);
-		m_hCOMPort = INVALID_HANDLE_VALUE;
+		serial_ClosePort();
 		return dwReturnCode;
 	}
+	SetThreadPriority (m_hReaderThread, THREAD_PRIORITY_TIME_CRITICAL);
 
 	//
 	// poll coordinator
@@ -109,7 +324,7 @@ DWORD serial_OpenPort (int intCOMPort)
 	for (i = 0; i < MAX_RETRIES; i++)
 	{
 		// flush COM port buffers
-		PurgeComm(m_hCOMPort, PURGE_RXCLEAR | PURGE_TXCLEAR);
+		serial_Purge();
 		
 		// send poll packet
 		if(serial_SendPacket(SER_POLL) == ERROR_SUCCESS)
@@ -138,13 +353,89 @@ DWORD serial_OpenPort (int intCOMPort)
 
 void serial_ClosePort (void)
 {
-	if(m_hCOMPort != INVALID_HANDLE_VALUE)
+	// stop reader thread
+	if(m_hReaderThread != NULL)
+	{
+		SetEvent(m_hevReaderStop);
+		WaitForSingleObject(m_hReaderThread, INFINITE);
+		CloseHandle(m_hReaderThread);
+		m_hReaderThread = NULL;
+	}
+
+	if(m_blnPortOpen)
+	{
+		m_ptTransport->Close();
+		m_blnPortOpen = FALSE;
+	}
+
+	// release events
+	if(m_hevReaderStop != NULL)
 	{
-		CloseHandle(m_hCOMPort);
-		m_hCOMPort = INVALID_HANDLE_VALUE;
+		CloseHandle(m_hevReaderStop);
+		m_hevReaderStop = NULL;
+	}
+	if(m_hevDataAvailable != NULL)
+	{
+		CloseHandle(m_hevDataAvailable);
+		m_hevDataAvailable = NULL;
 	}
 }
 
+/**
+ * \brief Blocks the calling thread until the reader thread has received new data or until the timeout elapses.
+ *
+ * Replaces the fixed-interval polling of the acquisition loops: the caller wakes up as soon as data arrives and does not
+ * wake up at all while the link is idle (other than to honor \c dwrdTimeout).
+ *
+ * \param[in]	dwrdTimeout		maximum wait time, in milliseconds
+ * \return TRUE if unframed data is available, FALSE if the wait timed out.
+ */
+BOOL serial_WaitForData(DWORD dwrdTimeout)
+{
+	if((DWORD) m_lngRingHead != (DWORD) m_lngRingTail)
+		return TRUE;
+
+	if(m_hevDataAvailable == NULL || WaitForSingleObject(m_hevDataAvailable, dwrdTimeout) != WAIT_OBJECT_0)
+		return FALSE;
+
+	m_srsStatistics.NFramerWakeUps++;
+	return TRUE;
+}
+
+/**
+ * \brief Returns whether the transport has reported that the connection to the coordinator is gone.
+ *
+ * E.g., the USB serial adapter has been unplugged or the TCP peer has closed the connection. The link has to be closed
+ * and re-established; no more data will be received over it.
+ *
+ * \return TRUE if the connection is gone, FALSE otherwise (also while the port is closed).
+ */
+BOOL serial_IsLinkClosed (void)
+{
+	return m_blnPortOpen && m_lngLinkClosed;
+}
+
+/**
+ * \brief Retrieves the statistics of the serial reader thread since the port was last opened.
+ *
+ * \param[out]	psrsStatistics		buffer where the statistics are to be stored
+ * \return Nothing.
+ */
+void serial_GetReaderStatistics(SerialReaderStatistics * psrsStatistics)
+{
+	*psrsStatistics = m_srsStatistics;
+}
+
+/**
+ * \brief Returns the number of received bytes that are waiting in the ring buffer to be framed.
+ *
+ * \return Number of unconsumed bytes (0 to SERBUF_RING).
+ */
+DWORD serial_GetRingOccupancy (void)
+{
+	return (DWORD) m_lngRingHead - (DWORD) m_lngRingTail;
+}
+
 /**
  * \brief Construct and send a packet to the MCU.
  *
@@ -160,11 +451,11 @@ void serial_ClosePort (void)
 DWORD serial_SendPacket(WEEGPacketTypes wptPacketType, ...)
 {
 	BYTE * pbytPayload;
-	DWORD dwrdNBytesWritten, dwrdData;
+	BYTE bytWireData [SERHDR_SIZE + 255 + 1];
+	DWORD dwrdData, dwrdWireLength;
 	tPacket_Basic Packet;
 	tPacket_PARAMS Payload_Parameters[8];
 	tPacket_DEVMASK Payload_DeviceMask;
-	unsigned int i;
 	va_list vaArguments;
 
 	// initialize header fields
@@ -199,8 +490,9 @@ DWORD serial_SendPacket(WEEGPacketTypes wptPacketType, ...)
 			// initialize variable arguments
 			va_start( vaArguments, wptPacketType);
 
-			Payload_Parameters[0].ChannelMask = va_arg(vaArguments, BYTE);
-			Payload_Parameters[0].SampleRate = va_arg(vaArguments, WORD);
+			// BYTE & WORD arguments are promoted to int
+			Payload_Parameters[0].ChannelMask = (BYTE) va_arg(vaArguments, int);
+			Payload_Parameters[0].SampleRate = (WORD) va_arg(vaArguments, int);
 			
 			// reset variable arguments.
 			va_end(vaArguments);
@@ -218,8 +510,8 @@ DWORD serial_SendPacket(WEEGPacketTypes wptPacketType, ...)
 			// initialize variable arguments
 			va_start( vaArguments, wptPacketType);
 
-			Payload_DeviceMask.DeviceMask = va_arg(vaArguments, BYTE);
-			Payload_DeviceMask.NetworkNr = va_arg(vaArguments, WORD);
+			Payload_DeviceMask.DeviceMask = (BYTE) va_arg(vaArguments, int);
+			Payload_DeviceMask.NetworkNr = (WORD) va_arg(vaArguments, int);
 			
 			// reset variable arguments.
 			va_end(vaArguments);
@@ -253,15 +545,11 @@ DWORD serial_SendPacket(WEEGPacketTypes wptPacketType, ...)
 	// create checksum
 	//
 	// compute header checksum
-	for (i = sizeof (Packet.Preamble); i < SERHDR_SIZE; i++)
-		Packet.Checksum += ((LPBYTE) &Packet) [i];
+	Packet.Checksum = (BYTE) simd_ByteSum (((LPBYTE) &Packet) + sizeof (Packet.Preamble), SERHDR_SIZE - sizeof (Packet.Preamble));
 	
 	// compute data checksum
 	if(Packet.DataLength > 0)
-	{
-		for (i = 0; i < Packet.DataLength; i++)
-			Packet.Checksum += pbytPayload [i];
-	}
+		Packet.Checksum += (BYTE) simd_ByteSum (pbytPayload, Packet.DataLength);
 
 	// one's complement of checksum
 	Packet.Checksum = ~Packet.Checksum;
@@ -269,17 +557,21 @@ DWORD serial_SendPacket(WEEGPacketTypes wptPacketType, ...)
 	//
 	// send packet
 	//
-	// header
-	if(!WriteFile (m_hCOMPort, &Packet, SERHDR_SIZE, &dwrdNBytesWritten, NULL))
-		return GetLastError();
+	if(!m_blnPortOpen)
+		return ERROR_INVALID_HANDLE;
 
-	// payload (if any)
+	// assemble header, payload (if any) & checksum, so that the packet is sent (and captured) in one piece
+	memcpy(bytWireData, &Packet, SERHDR_SIZE);
+	dwrdWireLength = SERHDR_SIZE;
 	if(Packet.DataLength > 0)
-		if(!WriteFile (m_hCOMPort, pbytPayload, Packet.DataLength, &dwrdNBytesWritten, NULL))
-			return GetLastError();
+	{
+		memcpy(bytWireData + dwrdWireLength, pbytPayload, Packet.DataLength);
+		dwrdWireLength += Packet.DataLength;
+	}
+	bytWireData[dwrdWireLength++] = Packet.Checksum;
 
-	// checksum
-	if(!WriteFile (m_hCOMPort, &Packet.Checksum, 1, &dwrdNBytesWritten, NULL))
+	capture_Record(CaptureDirection_Sent, bytWireData, dwrdWireLength);
+	if(!m_ptTransport->Write (bytWireData, dwrdWireLength))
 		return GetLastError();
 
 	return ERROR_SUCCESS;
@@ -300,103 +592,71 @@ DWORD serial_StopSampling (void)
 }
 
 /**
- * \brief Function that reads serial data and assembles packets.
+ * \brief Reads the data that the reader thread has received and frames all of the complete packets that it contains.
  *
- * ...
+ * Bytes that have already been framed are discarded and the unframed tail (e.g., a partially received packet) is moved to
+ * the beginning of the buffer before new data is read. The buffer is then scanned for preambles and each complete packet
+ * is validated with a single checksum pass over its type, length and payload bytes. The packets are returned as views
+ * into the receive buffer, so their payload is not copied.
  *
- * \param[in]	RD
- * \param[in]	NReceived
- * \return ...
+ * \param[in,out]	RD					receive buffer (zero-initialized before the first call)
+ * \param[out]		ptpvPackets			buffer where the framed packets are to be stored
+ * \param[in]		uintMaxNPackets		number of elements in ptpvPackets
+ * \return Number of packets framed (0 if no complete packet has been received).
  */
-// Handles received characters
-SerialCommunicationResult serial_ReceivedDataStateMachine (tReceivedData * RD)
+unsigned int serial_ReceivePackets (tReceivedData * RD, tPacketView * ptpvPackets, unsigned int uintMaxNPackets)
 {
-	BYTE B;
+	DWORD dwrdNBytesRead;
+	unsigned int uintNPackets;
 
-	while (1)
+	uintNPackets = 0;
+	do
 	{
-		if (RD->BufferPos >= RD->BufferLen)
-		{
-			RD->BufferPos = 0;
-			ReadFile (m_hCOMPort, RD->Buffer, SERBUF_RECVSTATE, &RD->BufferLen, NULL);
-			
-			if (!RD->BufferLen)
-				return (ERR_NODATA);                                  // No more characters
-		}
+		serial_DiscardFramedBytes (RD);
 
-		for (; RD->BufferPos < RD->BufferLen; RD->BufferPos++)
+		// append the data received by the reader thread
+		dwrdNBytesRead = 0;
+		if (RD->BufferLen < SERBUF_RECVSTATE)
 		{
-			switch (RD->State)
-			{
-				case RPPS_PREAMBLE1:
-					if (RD->Buffer [RD->BufferPos] == PREAMBLE)
-						RD->State = RPPS_PREAMBLE2;
-				break;
-
-				case RPPS_PREAMBLE2:
-					if (RD->Buffer [RD->BufferPos] == PREAMBLE)
-						RD->State = RPPS_PREAMBLE3;
-					else
-						RD->State = RPPS_PREAMBLE1;
-				break;
-
-				case RPPS_PREAMBLE3:
-					if (RD->Buffer [RD->BufferPos] == PREAMBLE)
-						RD->State = RPPS_PREAMBLE4;
-					else
-						RD->State = RPPS_PREAMBLE1;
-				break;
+			dwrdNBytesRead = serial_ReadRing (RD->Buffer + RD->BufferLen, SERBUF_RECVSTATE - RD->BufferLen);
+			RD->BufferLen += dwrdNBytesRead;
 
-				case RPPS_PREAMBLE4:
-					if (RD->Buffer [RD->BufferPos] == PREAMBLE)
-						RD->State = RPPS_TYPE;
-					else
-						RD->State = RPPS_PREAMBLE1;
-				break;
+			// the stamp is at least as recent as the data read (it is stored before the data is published); packets that
+			// were already complete in the ring are stamped as if they had arrived with the latest read
+			if (dwrdNBytesRead > 0)
+				RD->ArrivalTime = (DWORD) m_lngArrivalTime;
+		}
 
-				case RPPS_TYPE:
-					RD->Checksum = RD->PacketType = RD->Buffer [RD->BufferPos];
-					RD->State = RPPS_LENGTH;
-				break;
+		uintNPackets = serial_FramePackets (RD, ptpvPackets, uintMaxNPackets, &m_srsStatistics);
+	}
+	while (uintNPackets == 0 && dwrdNBytesRead > 0);
 
-				case RPPS_LENGTH:
-					RD->PacketDataLen = RD->Buffer [RD->BufferPos];
-					RD->Checksum += RD->Buffer [RD->BufferPos]; 
-				
-					if (RD->PacketDataLen)
-						RD->State = RPPS_DATA;
-					else
-						RD->State = RPPS_CHECKSUM;
-					
-					RD->PacketDataPos = 0;
-				break;
+	return uintNPackets;
+}
 
-				case RPPS_DATA:
-					RD->PacketData [RD->PacketDataPos++] = RD->Buffer [RD->BufferPos];
-					RD->Checksum += RD->Buffer [RD->BufferPos];
-					
-					if (RD->PacketDataPos >= RD->PacketDataLen)
-						RD->State = RPPS_CHECKSUM;
-				break;
+/**
+ * \brief Function that reads serial data and returns the next received packet.
+ *
+ * Packets are framed one at a time with serial_ReceivePackets() and their payload is copied to \c RD->PacketData, which
+ * remains valid until the next call. Meant for the low-rate command/acknowledgement exchanges; the acquisition loop uses
+ * serial_ReceivePackets() directly.
+ *
+ * \param[in,out]	RD		receive buffer and packet variables
+ * \return ERR_NOERROR if a valid packet was received, ERR_CHECKSUM if a corrupted packet was received, ERR_NODATA if no
+ *		   complete packet is available.
+ */
+SerialCommunicationResult serial_ReceivedDataStateMachine (tReceivedData * RD)
+{
+	tPacketView tpvPacket;
 
-				case RPPS_CHECKSUM:
-					B = (~RD->Buffer [RD->BufferPos]) & 0xFF;
-					
-					// Start from next character next time
-					RD->State = RPPS_PREAMBLE1;    
-					RD->BufferPos++;
-					
-					if (RD->Checksum == B)
-						return (ERR_NOERROR);
-					else
-						return (ERR_CHECKSUM);
-				break;
+	if (serial_ReceivePackets (RD, &tpvPacket, 1) == 0)
+		return (ERR_NODATA);
 
-				default:
-					RD->State = RPPS_PREAMBLE1;
-			}
-		}
-	}
+	RD->PacketType = tpvPacket.PacketType;
+	RD->PacketDataLen = tpvPacket.PacketDataLen;
+	memcpy (RD->PacketData, tpvPacket.PacketData, tpvPacket.PacketDataLen);
+	
+	return tpvPacket.Result;
 }
 
 DWORD serial_StartSampling(BYTE bytDeviceMask, WORD wrdNetworkNr, DWORD drwdRadioChannelMask, BYTE bytMeasurementChannelMask, WORD wrdSampleRate)
@@ -407,13 +667,13 @@ DWORD serial_StartSampling(BYTE bytDeviceMask, WORD wrdNetworkNr, DWORD drwdRadi
 	
 	SecureZeroMemory(&trdReceivedData, sizeof(tReceivedData));
 
-	if(m_hCOMPort != INVALID_HANDLE_VALUE)
+	if(m_blnPortOpen)
 	{
 		// try to start sampling 3X
 		for (i = 0; i < MAX_RETRIES; i++)
 		{
 			// flush COM port buffers
-			PurgeComm(m_hCOMPort, PURGE_RXCLEAR | PURGE_TXCLEAR);
+			serial_Purge();
 			
 			//
 			// configure device mask
@@ -486,6 +746,14 @@ DWORD serial_StartSampling(BYTE bytDeviceMask, WORD wrdNetworkNr, DWORD drwdRadi
 	return ERR_OPERATIONFAIL;
 }
 
+/**
+ * \brief Lists the serial ports of the WEEG coordinator's USB driver (FTDI).
+ *
+ * \param[out]	puchrPortBuffer		buffer where the port numbers are to be stored (see serial_GetPortPath())
+ * \param[in]	uchrPortBufferLen	number of elements in puchrPortBuffer
+ * \return Number of ports found.
+ */
+#ifdef _WIN32
 unsigned char serial_DetectWEEGPort(unsigned char * puchrPortBuffer, unsigned char uchrPortBufferLen)
 {
 	TCHAR strBuf[4096], strTemp[4];
@@ -590,4 +858,390 @@ unsigned char serial_DetectWEEGPort(unsigned char * puchrPortBuffer, unsigned ch
 	}
 
 	return uchrNDevicesFound;
-}
\ No newline at end of file
+}
+#else
+unsigned char serial_DetectWEEGPort(unsigned char * puchrPortBuffer, unsigned char uchrPortBufferLen)
+{
+	TCHAR strLink [PATH_MAX + 1], strDevice [PATH_MAX + 1];
+	DIR * pdirByID;
+	struct dirent * pdeEntry;
+	int intTTY;
+	unsigned char uchrNDevicesFound;
+
+	uchrNDevicesFound = 0;
+
+	// the persistent names of the adapters contain the manufacturer (e.g., usb-FTDI_FT232R_USB_UART_A600bXYZ-if00-port0)
+	pdirByID = opendir (DEVICE_BY_ID_DIR);
+	if (pdirByID == NULL)
+		return 0;
+	while (uchrNDevicesFound < uchrPortBufferLen && (pdeEntry = readdir (pdirByID)) != NULL)
+	{
+		if (_tcsstr (pdeEntry->d_name, DEVICE_MANUFACTURER) == NULL)
+			continue;
+
+		// each entry is a link to the adapter's tty
+		_stprintf_s (strLink, sizeof(strLink)/sizeof(TCHAR), TEXT("%s/%s"), DEVICE_BY_ID_DIR, pdeEntry->d_name);
+		if (realpath (strLink, strDevice) != NULL && sscanf (strDevice, DEVICE_TTY_FORMAT, &intTTY) == 1 && intTTY >= 0 && intTTY < 255)
+			puchrPortBuffer[uchrNDevicesFound++] = (unsigned char) (intTTY + 1);
+	}
+	closedir (pdirByID);
+
+	return uchrNDevicesFound;
+}
+#endif
+
+/**
+ * \brief Returns the number of microseconds elapsed since the given performance counter value.
+ */
+static DWORD serial_GetElapsedTime(const LARGE_INTEGER * pliStartCounter, const LARGE_INTEGER * pliFrequency)
+{
+	LARGE_INTEGER liCounter;
+
+	QueryPerformanceCounter (&liCounter);
+
+	return (DWORD) ((liCounter.QuadPart - pliStartCounter->QuadPart) * 1000000 / pliFrequency->QuadPart);
+}
+
+#ifdef _WIN32
+/**
+ * \brief Waits for an overlapped operation of a port probe to complete.
+ *
+ * The operation is cancelled if the probe is stopped or if its deadline passes first (CancelIo only cancels the I/O
+ * issued by the calling thread, so this must be called by the probe thread).
+ *
+ * \param[in]	pspProbe		port probe
+ * \param[in]	hCOMPort		handle of the probed port
+ * \param[in]	povIO			overlapped structure of the operation
+ * \return TRUE if the operation completed successfully, FALSE otherwise.
+ */
+static BOOL serial_ProbeWait (SerialProbe * pspProbe, HANDLE hCOMPort, OVERLAPPED * povIO)
+{
+	DWORD dwrdNBytes, dwrdWaitTime;
+	HANDLE hEvents [2];
+	LONG lngTimeLeft;
+
+	lngTimeLeft = (LONG) (pspProbe->Deadline - GetTickCount());
+	dwrdWaitTime = (lngTimeLeft > 0) ? (DWORD) lngTimeLeft : 0;
+
+	hEvents[0] = povIO->hEvent;
+	hEvents[1] = pspProbe->hevStop;
+	if (WaitForMultipleObjects (2, hEvents, FALSE, dwrdWaitTime) == WAIT_OBJECT_0)
+		return GetOverlappedResult (hCOMPort, povIO, &dwrdNBytes, FALSE);
+
+	CancelIo (hCOMPort);
+	GetOverlappedResult (hCOMPort, povIO, &dwrdNBytes, TRUE);
+
+	return FALSE;
+}
+#endif
+
+/**
+ * \brief Releases a reference to a port probe, freeing it with the last reference.
+ */
+static void serial_ReleaseProbe (SerialProbe * pspProbe)
+{
+	if (InterlockedDecrement (&pspProbe->RefCount) == 0)
+	{
+		CloseHandle (pspProbe->hevStop);
+		free (pspProbe);
+	}
+}
+
+/**
+ * \brief Scans received bytes for the coordinator's reply to the POLL packet of a port probe.
+ *
+ * \param[in]		pbytData		received bytes
+ * \param[in]		dwrdLength		number of bytes
+ * \param[in,out]	puintNMatched	number of bytes of the reply matched so far (0 before the first call)
+ * \return TRUE once the whole reply has been matched, FALSE otherwise.
+ */
+static BOOL serial_ProbeScan (const BYTE * pbytData, DWORD dwrdLength, unsigned int * puintNMatched)
+{
+	DWORD i;
+
+	for (i = 0; i < dwrdLength && *puintNMatched < sizeof(mc_bytProbeAck); i++)
+	{
+		if (pbytData[i] == mc_bytProbeAck[*puintNMatched])
+			(*puintNMatched)++;
+		else if (pbytData[i] == PREAMBLE)
+			*puintNMatched = (*puintNMatched == 4) ? 4 : 1;			// a fifth preamble byte keeps the last four in place
+		else
+			*puintNMatched = 0;
+	}
+
+	return *puintNMatched == sizeof(mc_bytProbeAck);
+}
+
+/**
+ * \brief Thread that opens one COM port, sends a POLL packet and waits for the coordinator's ACK until the probe's deadline.
+ *
+ * \param[in]	lpParam			port probe (SerialProbe *)
+ * \return 0.
+ */
+#ifdef _WIN32
+static DWORD WINAPI serial_ProbeThread (LPVOID lpParam)
+{
+	BYTE bytBuffer [256];
+	DWORD dwrdEventMask, dwrdNBytes;
+	HANDLE hCOMPort;
+	OVERLAPPED ovIO;
+	SerialProbe * pspProbe;
+	TCHAR strCOMPort[10];
+	unsigned int uintNMatched;
+
+	pspProbe = (SerialProbe *) lpParam;
+
+	SecureZeroMemory(&ovIO, sizeof(ovIO));
+	serial_GetPortPath (pspProbe->Port, strCOMPort, sizeof(strCOMPort)/sizeof(TCHAR));
+	hCOMPort = CreateFile (strCOMPort, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+	if (hCOMPort != INVALID_HANDLE_VALUE)
+		ovIO.hEvent = CreateEvent (NULL, TRUE, FALSE, NULL);
+	if (ovIO.hEvent != NULL && transport_ConfigureCOMPort (hCOMPort) == ERROR_SUCCESS)
+	{
+		PurgeComm (hCOMPort, PURGE_RXCLEAR | PURGE_TXCLEAR);
+
+		// send POLL packet
+		if (WriteFile (hCOMPort, mc_bytProbePoll, sizeof(mc_bytProbePoll), &dwrdNBytes, &ovIO) ||
+			(GetLastError() == ERROR_IO_PENDING && serial_ProbeWait (pspProbe, hCOMPort, &ovIO)))
+		{
+			// scan the received bytes for the ACK until the deadline
+			uintNMatched = 0;
+			for (;;)
+			{
+				dwrdNBytes = 0;
+				if (!ReadFile (hCOMPort, bytBuffer, sizeof(bytBuffer), &dwrdNBytes, &ovIO) &&
+					(GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult (hCOMPort, &ovIO, &dwrdNBytes, TRUE)))
+					break;
+
+				if (serial_ProbeScan (bytBuffer, dwrdNBytes, &uintNMatched))
+				{
+					pspProbe->ResponseTime = serial_GetElapsedTime (&pspProbe->StartCounter, &pspProbe->Frequency);
+					InterlockedExchange (&pspProbe->Responded, TRUE);
+					break;
+				}
+
+				// wait for more bytes
+				if ((LONG) (pspProbe->Deadline - GetTickCount()) <= 0)
+					break;
+				if (!WaitCommEvent (hCOMPort, &dwrdEventMask, &ovIO))
+				{
+					if (GetLastError() == ERROR_IO_PENDING)
+					{
+						if (!serial_ProbeWait (pspProbe, hCOMPort, &ovIO))
+							break;
+					}
+					else if (WaitForSingleObject (pspProbe->hevStop, TRANSFER_IDLE) == WAIT_OBJECT_0)
+						break;
+				}
+			}
+		}
+	}
+
+	if (ovIO.hEvent != NULL)
+		CloseHandle (ovIO.hEvent);
+	if (hCOMPort != INVALID_HANDLE_VALUE)
+		CloseHandle (hCOMPort);
+
+	serial_ReleaseProbe (pspProbe);
+
+	return 0;
+}
+#else
+static DWORD WINAPI serial_ProbeThread (LPVOID lpParam)
+{
+	BYTE bytBuffer [256];
+	int intCOMPort;
+	LONG lngTimeLeft;
+	SerialProbe * pspProbe;
+	ssize_t sztNBytes;
+	struct pollfd pfdWait [2];
+	TCHAR strCOMPort[TRANSPORT_MAX_ADDRESS_LEN + 1];
+	unsigned int uintNMatched;
+
+	pspProbe = (SerialProbe *) lpParam;
+
+	serial_GetPortPath (pspProbe->Port, strCOMPort, sizeof(strCOMPort)/sizeof(TCHAR));
+	intCOMPort = open (strCOMPort, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (intCOMPort >= 0 && transport_ConfigureCOMPort (intCOMPort) == ERROR_SUCCESS)
+	{
+		tcflush (intCOMPort, TCIOFLUSH);
+
+		// send POLL packet (it fits into the empty output queue)
+		if (write (intCOMPort, mc_bytProbePoll, sizeof(mc_bytProbePoll)) == (ssize_t) sizeof(mc_bytProbePoll))
+		{
+			// scan the received bytes for the ACK until the deadline
+			uintNMatched = 0;
+			pfdWait[0].fd = intCOMPort;
+			pfdWait[0].events = POLLIN;
+			pfdWait[1].fd = compat_GetEventFD (pspProbe->hevStop);
+			pfdWait[1].events = POLLIN;
+			for (;;)
+			{
+				sztNBytes = read (intCOMPort, bytBuffer, sizeof(bytBuffer));
+				if (sztNBytes > 0)
+				{
+					if (serial_ProbeScan (bytBuffer, (DWORD) sztNBytes, &uintNMatched))
+					{
+						pspProbe->ResponseTime = serial_GetElapsedTime (&pspProbe->StartCounter, &pspProbe->Frequency);
+						InterlockedExchange (&pspProbe->Responded, TRUE);
+						break;
+					}
+					continue;
+				}
+
+				// the port has hung up
+				if (sztNBytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+					break;
+
+				// wait for more bytes
+				lngTimeLeft = (LONG) (pspProbe->Deadline - GetTickCount());
+				if (lngTimeLeft <= 0)
+					break;
+				if (poll (pfdWait, 2, (int) lngTimeLeft) < 0 && errno != EINTR)
+					break;
+				if (pfdWait[1].revents & POLLIN)
+					break;
+			}
+		}
+	}
+
+	if (intCOMPort >= 0)
+		close (intCOMPort);
+
+	serial_ReleaseProbe (pspProbe);
+
+	return 0;
+}
+#endif
+
+/**
+ * \brief Finds the COM port of the WEEG coordinator by polling all of the candidate ports concurrently.
+ *
+ * The candidates are the preferred port (normally the last port on which the coordinator was found, see the PortNumber
+ * key of the configuration file) and the ports of the coordinator's USB driver (see serial_DetectWEEGPort()). Each
+ * candidate is opened and sent a POLL packet by its own thread, and all of them share one deadline (SERPROBE_TIMEOUT), so
+ * the time until the port is known is bounded by the slowest poll round trip rather than by the sum of them. If the
+ * preferred port answers, the other probes are stopped at once. The ports are closed again before the function returns.
+ *
+ * \param[in]	uchrPreferredPort	number of the port that is probed first (0 if none)
+ * \param[out]	puchrPort			number of the port on which the coordinator answered (the preferred port, if it did)
+ * \param[out]	pspsStatistics		outcome and timing of the probe (may be NULL)
+ * \return Number of ports on which a coordinator answered.
+ */
+unsigned char serial_ProbeWEEGPort(unsigned char uchrPreferredPort, unsigned char * puchrPort, SerialProbeStatistics * pspsStatistics)
+{
+	BOOL blnStopped;
+	DWORD dwrdDeadline, dwrdWaitResult;
+	HANDLE hThreads [SERPROBE_MAXPORTS], hWaiting [SERPROBE_MAXPORTS];
+	LARGE_INTEGER liFrequency, liStartCounter;
+	LONG lngTimeLeft;
+	SerialProbe * pspProbes [SERPROBE_MAXPORTS];
+	SerialProbeStatistics spsStatistics;
+	unsigned char uchrPorts [SERPROBE_MAXPORTS], uchrNPorts, uchrNDetected, uchrNActive, uchrNWaiting;
+	unsigned int i, k;
+
+	SecureZeroMemory(&spsStatistics, sizeof(spsStatistics));
+	QueryPerformanceFrequency (&liFrequency);
+	QueryPerformanceCounter (&liStartCounter);
+
+	//
+	// candidate ports: the preferred port first, followed by the ports of the coordinator's driver
+	//
+	uchrNPorts = 0;
+	if (uchrPreferredPort > 0)
+		uchrPorts[uchrNPorts++] = uchrPreferredPort;
+	uchrNDetected = serial_DetectWEEGPort (uchrPorts + uchrNPorts, (unsigned char) (SERPROBE_MAXPORTS - uchrNPorts));
+	for (i = k = uchrNPorts; i < (unsigned int) (uchrNPorts + uchrNDetected); i++)
+	{
+		// the preferred port is already in the list
+		if (uchrPorts[i] != uchrPreferredPort)
+			uchrPorts[k++] = uchrPorts[i];
+	}
+	uchrNPorts = (unsigned char) k;
+	spsStatistics.EnumerationTime = serial_GetElapsedTime (&liStartCounter, &liFrequency);
+
+	//
+	// start one probe thread per candidate port
+	//
+	QueryPerformanceCounter (&liStartCounter);
+	dwrdDeadline = GetTickCount() + SERPROBE_TIMEOUT;
+	uchrNActive = 0;
+	for (i = 0; i < uchrNPorts; i++)
+	{
+		pspProbes[uchrNActive] = (SerialProbe *) calloc(1, sizeof(SerialProbe));
+		if (pspProbes[uchrNActive] == NULL)
+			continue;
+
+		pspProbes[uchrNActive]->RefCount = 2;
+		pspProbes[uchrNActive]->Port = uchrPorts[i];
+		pspProbes[uchrNActive]->Deadline = dwrdDeadline;
+		pspProbes[uchrNActive]->StartCounter = liStartCounter;
+		pspProbes[uchrNActive]->Frequency = liFrequency;
+		pspProbes[uchrNActive]->hevStop = CreateEvent (NULL, TRUE, FALSE, NULL);
+		hThreads[uchrNActive] = NULL;
+		if (pspProbes[uchrNActive]->hevStop != NULL)
+			hThreads[uchrNActive] = CreateThread (NULL, 4096, serial_ProbeThread, pspProbes[uchrNActive], 0, NULL);
+		if (hThreads[uchrNActive] == NULL)
+		{
+			if (pspProbes[uchrNActive]->hevStop != NULL)
+				CloseHandle (pspProbes[uchrNActive]->hevStop);
+			free (pspProbes[uchrNActive]);
+			continue;
+		}
+		hWaiting[uchrNActive] = hThreads[uchrNActive];
+		uchrNActive++;
+	}
+	spsStatistics.NCandidates = uchrNActive;
+
+	//
+	// wait for the probes until the deadline; as soon as the preferred port has answered, the others are not needed
+	//
+	blnStopped = FALSE;
+	uchrNWaiting = uchrNActive;
+	while (uchrNWaiting > 0)
+	{
+		lngTimeLeft = (LONG) (dwrdDeadline + SERPROBE_GRACE - GetTickCount());
+		dwrdWaitResult = WaitForMultipleObjects (uchrNWaiting, hWaiting, FALSE, (lngTimeLeft > 0) ? (DWORD) lngTimeLeft : 0);
+		if (dwrdWaitResult >= WAIT_OBJECT_0 + uchrNWaiting)
+			break;
+		hWaiting[dwrdWaitResult - WAIT_OBJECT_0] = hWaiting[--uchrNWaiting];
+
+		if (!blnStopped && uchrNActive > 0 && pspProbes[0]->Port == uchrPreferredPort && pspProbes[0]->Responded)
+		{
+			for (i = 0; i < uchrNActive; i++)
+				SetEvent (pspProbes[i]->hevStop);
+			blnStopped = TRUE;
+		}
+	}
+	spsStatistics.ProbeTime = serial_GetElapsedTime (&liStartCounter, &liFrequency);
+
+	//
+	// collect the outcome (probes that are still stuck in the driver are abandoned and free themselves)
+	//
+	*puchrPort = 0;
+	for (i = 0; i < uchrNActive; i++)
+	{
+		if (pspProbes[i]->Responded)
+		{
+			if (spsStatistics.NResponding++ == 0)
+			{
+				*puchrPort = pspProbes[i]->Port;
+				spsStatistics.PreferredResponded = (pspProbes[i]->Port == uchrPreferredPort);
+				spsStatistics.ResponseTime = pspProbes[i]->ResponseTime;
+			}
+		}
+
+		SetEvent (pspProbes[i]->hevStop);
+		CloseHandle (hThreads[i]);
+		serial_ReleaseProbe (pspProbes[i]);
+	}
+
+	// once the preferred port has answered, further answers of the stopped probes do not make the port ambiguous
+	if (blnStopped)
+		spsStatistics.NResponding = 1;
+
+	if (pspsStatistics != NULL)
+		*pspsStatistics = spsStatistics;
+
+	return spsStatistics.NResponding;
+}
@@ -23,12 +23,14 @@
 //---------------------------------------------------------------------------
 # include <stdio.h>
 # include <stdarg.h>
-# include <tchar.h>
 
-# include <windows.h>
+# include "compat.h"
+# ifdef _WIN32
 # include <Setupapi.h>
+# endif
 
 # include "globals.h"
+# include "transport.h"
 
 //---------------------------------------------------------------------------
 //   								Definitions
@@ -37,11 +39,13 @@
 # define SERPORT_INQUEUE		16384				// Serial receive buffer length 
 # define SERPORT_OUTQUEUE		256					// Serial transmit buffer length
 
-# define SERBUF_RECVSTATE		512					// Temporary buffer for the receive state machine
+# define SERBUF_RECVSTATE		4096				// Receive buffer of the packet framer
+# define SERBUF_MAXPACKETS		(SERBUF_RECVSTATE/(SERHDR_SIZE + 1))		// Maximum number of packets that can be framed from one receive buffer
+# define SERBUF_RING			65536				// Ring buffer between the reader thread and the packet framer (must be a power of two)
 
 # define SERHDR_SIZE			6					// # bytes in packet header (i.e. Preamble + PacketType + DataLength)
 
-# define PREAMBLE				0xFF				// preamble character
+# define PREAMBLE				0xFF				// preamble character (NOTE: 4 preamble characters may also occur inside a payload, e.g., two full-scale samples)
 
 # define SAMPLES_PER_PACKET		50					// Maximum number of 16b WORDs per packet
 
@@ -49,25 +53,25 @@
 # define DEVICE_FRIENDLY_NAME	TEXT("USB Serial Port (COM")
 # define DEVICE_MANUFACTURER	TEXT("FTDI")
 
-# define TRANSFER_IDLE			10							// Idle time between polling rounds in SampleThread (milliseconds)
+// POSIX: port n is the tty of USB serial adapter n - 1, whose persistent name (manufacturer, model, serial number) is
+// listed in the udev directory
+# define DEVICE_TTY_FORMAT		TEXT("/dev/ttyUSB%d")
+# define DEVICE_BY_ID_DIR		TEXT("/dev/serial/by-id")
+
+# define TRANSFER_IDLE			10							// Idle time between polling rounds if the serial driver does not support WaitCommEvent (milliseconds)
+# define TRANSFER_WAIT			100							// Maximum time that a thread blocks in serial_WaitForData() before re-checking its exit condition (milliseconds)
 # define TRANSFER_CHARWAIT		100							// Maximum wait time between characters when header is received
 # define TRANSFER_PACKWAIT		2500						// Maximum wait time between packets (milliseconds)
+# define TRANSFER_RECONNECT		250							// Interval between attempts to re-establish the link to an unplugged coordinator (milliseconds)
 # define MAX_RETRIES			3							// Maximum number of re-transmissions
 
+# define SERPROBE_MAXPORTS		16							// Maximum number of COM ports probed concurrently by serial_ProbeWEEGPort()
+# define SERPROBE_TIMEOUT		250							// Deadline shared by all of the port probes (milliseconds)
+# define SERPROBE_GRACE			50							// Additional time given to the probes to exit after the deadline (milliseconds)
+
 //----------------------------------------------------------------------------------------------------------
 //   								Enums
 //----------------------------------------------------------------------------------------------------------
-// received packet parsing state
-typedef enum {RPPS_PREAMBLE1	= 0x00,		// preamble byte 1
-			  RPPS_PREAMBLE2,				// preamble byte 2
-			  RPPS_PREAMBLE3,				// preamble byte 3
-			  RPPS_PREAMBLE4,				// preamble byte 4
-			  RPPS_TYPE,					// packet type byte
-			  RPPS_LENGTH,					// data length byte
-			  RPPS_DATA,					// data section
-			  RPPS_CHECKSUM,				// checksum byte
-			 } ReceivedPacketParseState;
-
 // WEEG serial packet types
 typedef enum {SER_POLL      = 0x00,				// POLL: existence check used for serial port autodetect (PC -> MC)
 			  SER_ACK       = 0x10,				// ACK: acknowledge received packet (PC <-> MC)
@@ -97,6 +101,31 @@ typedef enum {ERR_NOERROR		= 0,
 //----------------------------------------------------------------------------------------------------------
 //   								Structs
 //----------------------------------------------------------------------------------------------------------
+// statistics of the serial reader thread (reset by serial_OpenPort)
+typedef struct
+{
+	LONG NReaderWakeUps;						// number of times the reader thread woke up (comm event or safety timeout)
+	LONG NFramerWakeUps;						// number of times serial_WaitForData() returned because new data was signaled
+	LONG NBytesReceived;						// number of bytes read from the serial port
+	LONG NBytesDropped;							// number of bytes discarded because the ring buffer was full
+	LONG RingHighWaterMark;						// largest number of unconsumed bytes in the ring buffer
+	LONG NResyncs;								// number of times the framer had to skip bytes to find the next preamble
+	LONG NBytesSkipped;							// number of bytes skipped by the framer while searching for a preamble
+}
+SerialReaderStatistics;
+
+// outcome and timing of a COM port probe (see serial_ProbeWEEGPort)
+typedef struct
+{
+	unsigned char NCandidates;					// number of ports probed
+	unsigned char NResponding;					// number of ports on which a coordinator acknowledged the POLL packet
+	BOOL PreferredResponded;					// TRUE if the preferred (last known good) port acknowledged the POLL packet
+	DWORD EnumerationTime;						// time spent enumerating the candidate ports (microseconds)
+	DWORD ProbeTime;							// time from the start of the probes until the outcome was known (microseconds)
+	DWORD ResponseTime;							// round-trip time of the POLL packet on the selected port (microseconds, 0 if none responded)
+}
+SerialProbeStatistics;
+
 # pragma pack (push, 1)
 //
 // basic packet types
@@ -122,28 +151,6 @@ typedef struct
 }
 tPacket_Basic;
 
-// structure used for received serial packets
-typedef struct
-{
-	// state machine variables
-	BYTE	Buffer [SERBUF_RECVSTATE];			// buffer for the reception state machine
-	DWORD	BufferLen;							// amount of data in buffer
-	DWORD	BufferPos;							// current position within the buffer
-	ReceivedPacketParseState State;				// state representing the field being currently parsed in the received packet
-	BYTE	Checksum;							// checksum calculated thus far
-	BYTE	PacketDataPos;						// data buffer position 
-
-	// packet variables
-	BYTE PacketType;							// BYTE[1] specifying the packet type (see WEEGPacketTypes declaration)
-	
-	BYTE PacketDataLen;							// BYTE[1] specifies the payload length; for
-												// example, with packet 0x50 (CHMASK) the value is 4, because the actual channel
-												// mask is represented as a 32b bitfield. As the length byte doesnt specify the actual
-												// packet length, it can be zero.
-	
-	BYTE PacketData[256 + 1];					// extra data (parameters, measurements, etc.)
-}
-tReceivedData;
 
 //
 // packet payloads
@@ -198,6 +205,45 @@ typedef struct
 }
 tPacket_DATA;
 
+// packet framed by serial_ReceivePackets(); the payload is not copied, it points into the receive buffer
+typedef struct
+{
+	SerialCommunicationResult Result;			// ERR_NOERROR if the checksum matched, ERR_CHECKSUM otherwise
+
+	BYTE PacketType;							// BYTE[1] specifying the packet type (see WEEGPacketTypes declaration)
+
+	BYTE PacketDataLen;							// BYTE[1] specifies the payload length
+
+	const BYTE * PacketData;					// payload; valid until the next call to serial_ReceivePackets() with the same tReceivedData
+
+	DWORD ArrivalTime;							// time at which the reader thread read the packet from the transport (see latency_Now())
+}
+tPacketView;
+
+// structure used for received serial packets
+typedef struct
+{
+	// framer variables
+	BYTE	Buffer [SERBUF_RECVSTATE + sizeof(tPacket_DATA)];	// receive buffer (padded so that a short DATA packet can be read through a tPacket_DATA pointer)
+	DWORD	BufferLen;							// amount of data in buffer
+	DWORD	BufferPos;							// first byte that has not been framed yet
+	BOOL	LostSync;							// TRUE while the framer is skipping bytes in search of a preamble
+	DWORD	BadPacketEnd;						// end of the last packet that failed its checksum; preambles found before it are false
+	DWORD	LastPacketLength;					// length of the last packet that passed its checksum
+	DWORD	ArrivalTime;						// time of the latest transport read when data was last taken from the ring (see latency_Now())
+
+	// packet variables (filled in by serial_ReceivedDataStateMachine)
+	BYTE PacketType;							// BYTE[1] specifying the packet type (see WEEGPacketTypes declaration)
+	
+	BYTE PacketDataLen;							// BYTE[1] specifies the payload length; for
+												// example, with packet 0x50 (CHMASK) the value is 4, because the actual channel
+												// mask is represented as a 32b bitfield. As the length byte doesnt specify the actual
+												// packet length, it can be zero.
+	
+	BYTE PacketData[256 + 1];					// extra data (parameters, measurements, etc.)
+}
+tReceivedData;
+
 # pragma pack (pop)
 
 //---------------------------------------------------------------------------
@@ -205,10 +251,21 @@ tPacket_DATA;
 //---------------------------------------------------------------------------
 void						serial_ClosePort (void);
 unsigned char				serial_DetectWEEGPort(unsigned char * puchrPortBuffer, unsigned char uchrPortBufferLen);
+void						serial_DiscardFramedBytes (tReceivedData * RD);
+unsigned int				serial_FramePackets (tReceivedData * RD, tPacketView * ptpvPackets, unsigned int uintMaxNPackets, SerialReaderStatistics * psrsStatistics);
+void						serial_GetReaderStatistics(SerialReaderStatistics * psrsStatistics);
+DWORD						serial_GetRingOccupancy (void);
+TransportType				serial_GetTransport (void);
+BOOL						serial_IsLinkClosed (void);
+BOOL						serial_IsValidHeader (BYTE bytPacketType, BYTE bytDataLength);
 DWORD						serial_OpenPort (int intCOMPort);
+unsigned char				serial_ProbeWEEGPort(unsigned char uchrPreferredPort, unsigned char * puchrPort, SerialProbeStatistics * pspsStatistics);
 SerialCommunicationResult	serial_ReceivedDataStateMachine (tReceivedData * RD);
+unsigned int				serial_ReceivePackets (tReceivedData * RD, tPacketView * ptpvPackets, unsigned int uintMaxNPackets);
 DWORD						serial_SendPacket(WEEGPacketTypes wptPacketType, ...);
+BOOL						serial_SetTransport (TransportType ttType, const TCHAR * strAddress, BOOL blnRealTime);
 DWORD						serial_StartSampling(BYTE bytDeviceMask, WORD wrdNetworkNr, DWORD drwdRadioChannelMask, BYTE bytMeasurementChannelMask, WORD wrdSampleRate);
 DWORD						serial_StopSampling (void);
+BOOL						serial_WaitForData(DWORD dwrdTimeout);
 
 # endif
\ No newline at end of file
@@ -0,0 +1,250 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		serialframer.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Packet framer of the module that handles the serial port connection to the WEEG device.
+ *
+ * The framer only works on the receive buffer (see tReceivedData) and on the statistics passed to it; it does not touch the
+ * port, the reader thread or the ring buffer, so that it can also be built on its own (see the FramerHarness project, which
+ * fuzzes it and measures its throughput and resynchronization latency).
+ *
+ * $Id$
+ */
+
+# include <stddef.h>
+# include <string.h>
+
+# include "serialV4.h"
+# include "simd.h"
+
+//---------------------------------------------------------------------------
+//							Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Updates the resynchronization statistics after a preamble search.
+ *
+ * A resynchronization is counted once per run of skipped bytes, when the preamble that ends the run is found (the run may
+ * span several calls of serial_ReceivePackets()).
+ *
+ * \param[in,out]	RD					receive buffer
+ * \param[in]		dwrdPosition		position returned by serial_FindPreamble()
+ * \param[in]		blnPreambleFound	value returned by serial_FindPreamble()
+ * \param[in,out]	psrsStatistics		statistics to be updated
+ * \return Nothing.
+ */
+static void serial_CountSkippedBytes (tReceivedData * RD, DWORD dwrdPosition, BOOL blnPreambleFound, SerialReaderStatistics * psrsStatistics)
+{
+	if (dwrdPosition > RD->BufferPos)
+	{
+		psrsStatistics->NBytesSkipped += dwrdPosition - RD->BufferPos;
+		RD->LostSync = TRUE;
+	}
+
+	if (blnPreambleFound && RD->LostSync)
+	{
+		psrsStatistics->NResyncs++;
+		RD->LostSync = FALSE;
+	}
+}
+
+/**
+ * \brief Locates the next 4-byte preamble in the receive buffer.
+ *
+ * Candidate positions are found with memchr(), which scans many bytes per instruction, and only then checked for the
+ * full preamble.
+ *
+ * \param[in]	RD				receive buffer
+ * \param[out]	pdwrdPosition	position of the preamble if found; otherwise, position of the first byte that could still be
+ *								the start of a preamble once more data has been received
+ * \return TRUE if a complete preamble was found, FALSE otherwise.
+ */
+static BOOL serial_FindPreamble (tReceivedData * RD, DWORD * pdwrdPosition)
+{
+	BYTE * pbytCandidate;
+	DWORD dwrdPosition, i;
+
+	dwrdPosition = RD->BufferPos;
+	while (dwrdPosition < RD->BufferLen)
+	{
+		pbytCandidate = (BYTE *) memchr (RD->Buffer + dwrdPosition, PREAMBLE, RD->BufferLen - dwrdPosition);
+		if (pbytCandidate == NULL)
+		{
+			*pdwrdPosition = RD->BufferLen;
+			return FALSE;
+		}
+		dwrdPosition = (DWORD) (pbytCandidate - RD->Buffer);
+
+		// check the remaining preamble bytes
+		for (i = 1; i < 4 && dwrdPosition + i < RD->BufferLen && RD->Buffer [dwrdPosition + i] == PREAMBLE; i++);
+		
+		if (i == 4)
+		{
+			*pdwrdPosition = dwrdPosition;
+			return TRUE;
+		}
+		
+		// preamble may continue in the data that has not been received yet
+		if (dwrdPosition + i == RD->BufferLen)
+		{
+			*pdwrdPosition = dwrdPosition;
+			return FALSE;
+		}
+
+		dwrdPosition += i;
+	}
+
+	*pdwrdPosition = RD->BufferLen;
+	return FALSE;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Discards the bytes that have already been framed by moving the unframed tail (e.g., a partially received packet)
+ * to the beginning of the receive buffer.
+ *
+ * \param[in,out]	RD		receive buffer
+ * \return Nothing.
+ */
+void serial_DiscardFramedBytes (tReceivedData * RD)
+{
+	if (RD->BufferPos > 0)
+	{
+		memmove (RD->Buffer, RD->Buffer + RD->BufferPos, RD->BufferLen - RD->BufferPos);
+		RD->BufferLen -= RD->BufferPos;
+		RD->BadPacketEnd = (RD->BadPacketEnd > RD->BufferPos) ? RD->BadPacketEnd - RD->BufferPos : 0;
+		RD->BufferPos = 0;
+	}
+}
+
+/**
+ * \brief Frames the complete packets that the receive buffer contains.
+ *
+ * The buffer is scanned for preambles and each complete packet is validated with a single checksum pass over its type,
+ * length and payload bytes. The packets are returned as views into the receive buffer, so their payload is not copied;
+ * framing stops at the first incomplete packet, which is left in the buffer until more data has been appended.
+ *
+ * \param[in,out]	RD					receive buffer
+ * \param[out]		ptpvPackets			buffer where the framed packets are to be stored
+ * \param[in]		uintMaxNPackets		number of elements in ptpvPackets
+ * \param[in,out]	psrsStatistics		statistics whose resynchronization counters are to be updated
+ * \return Number of packets framed.
+ */
+unsigned int serial_FramePackets (tReceivedData * RD, tPacketView * ptpvPackets, unsigned int uintMaxNPackets, SerialReaderStatistics * psrsStatistics)
+{
+	BYTE bytChecksum, bytDataLength;
+	DWORD dwrdPacketLength, dwrdPosition;
+	unsigned int uintNPackets;
+
+	uintNPackets = 0;
+	while (uintNPackets < uintMaxNPackets)
+	{
+		if (!serial_FindPreamble (RD, &dwrdPosition))
+		{
+			serial_CountSkippedBytes (RD, dwrdPosition, FALSE, psrsStatistics);
+			RD->BufferPos = dwrdPosition;
+			break;
+		}
+		serial_CountSkippedBytes (RD, dwrdPosition, TRUE, psrsStatistics);
+		RD->BufferPos = dwrdPosition;
+
+		// wait until the whole packet has been received
+		if (RD->BufferLen - dwrdPosition < SERHDR_SIZE)
+			break;
+		bytDataLength = RD->Buffer [dwrdPosition + SERHDR_SIZE - 1];
+
+		// reject implausible headers and resynchronize on the next preamble
+		if (!serial_IsValidHeader (RD->Buffer [dwrdPosition + 4], bytDataLength))
+		{
+			psrsStatistics->NBytesSkipped++;
+			RD->LostSync = TRUE;
+			RD->BufferPos = dwrdPosition + 1;
+			continue;
+		}
+
+		dwrdPacketLength = SERHDR_SIZE + bytDataLength + 1;
+		if (RD->BufferLen - dwrdPosition < dwrdPacketLength)
+			break;
+
+		// checksum: one's complement of the sum of all bytes following the preamble
+		bytChecksum = (BYTE) simd_ByteSum (RD->Buffer + dwrdPosition + 4, SERHDR_SIZE - 4 + bytDataLength);
+
+		if (bytChecksum != (BYTE) ~RD->Buffer [dwrdPosition + dwrdPacketLength - 1])
+		{
+			// the length of a corrupted packet may be wrong as well, so the search for the next preamble continues right
+			// after its preamble. Measurement data can contain the preamble pattern (two consecutive 0xFFFF samples), so
+			// the search may then find a false preamble inside the corrupted packet; such a "packet" is skipped without
+			// being reported, otherwise a single corrupted packet could count as several checksum errors (MAX_RETRIES).
+			// A corrupted packet is assumed to be at least as long as the last valid one, because its own length field
+			// cannot be trusted and the packets of a stream have the same length.
+			RD->LostSync = TRUE;
+			RD->BufferPos = dwrdPosition + 4;
+			if (dwrdPosition < RD->BadPacketEnd)
+			{
+				psrsStatistics->NBytesSkipped += 4;
+				continue;
+			}
+			RD->BadPacketEnd = dwrdPosition + max (dwrdPacketLength, RD->LastPacketLength);
+			ptpvPackets [uintNPackets].Result = ERR_CHECKSUM;
+		}
+		else
+		{
+			RD->BufferPos = dwrdPosition + dwrdPacketLength;
+			RD->LastPacketLength = dwrdPacketLength;
+			ptpvPackets [uintNPackets].Result = ERR_NOERROR;
+		}
+
+		ptpvPackets [uintNPackets].PacketType = RD->Buffer [dwrdPosition + 4];
+		ptpvPackets [uintNPackets].PacketDataLen = bytDataLength;
+		ptpvPackets [uintNPackets].PacketData = RD->Buffer + dwrdPosition + SERHDR_SIZE;
+		ptpvPackets [uintNPackets].ArrivalTime = RD->ArrivalTime;
+		uintNPackets++;
+	}
+
+	return uintNPackets;
+}
+
+/**
+ * \brief Checks whether a packet header is plausible, i.e., whether its packet type is known and its payload length is
+ * possible for that type.
+ *
+ * The length byte of a corrupted header (or of a false preamble) must not be trusted: it would make the framer wait for,
+ * and then skip, up to 255 bytes that may contain valid packets.
+ *
+ * \param[in]	bytPacketType		packet type field of the header
+ * \param[in]	bytDataLength		payload length field of the header
+ * \return TRUE if the header is plausible, FALSE otherwise.
+ */
+BOOL serial_IsValidHeader (BYTE bytPacketType, BYTE bytDataLength)
+{
+	switch (bytPacketType)
+	{
+		case SER_DATA:
+			// the fixed fields must be present and the measurements must fit into tPacket_DATA
+			return bytDataLength >= offsetof (tPacket_DATA, Measurements) &&
+				   bytDataLength <= sizeof (tPacket_DATA) &&
+				   ((bytDataLength - offsetof (tPacket_DATA, Measurements)) & 1) == 0;
+
+		case SER_POLL:
+		case SER_ACK:
+		case SER_NACK:
+		case SER_PARAMS:
+		case SER_DEVMASK:
+		case SER_CHMASK:
+		case SER_BEACONCMD:
+		case SER_BEACONRPL:
+		case SER_STATUSQRY:
+		case SER_STATUSRPL:
+		case SER_CHANQRY:
+		case SER_CHANRPL:
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
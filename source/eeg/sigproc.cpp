@@ -23,6 +23,7 @@
 
 # include "globals.h"
 # include "sigproc.h"
+# include "simd.h"
 
 //----------------------------------------------------------------------------------------------------------
 //   								Constants
@@ -250,21 +251,30 @@ double m_dblBP[299] = { 0.0003340326743267,0.0004751593869308,0.0004718730150497
 						-0.0001525250517476,-0.0001007033633219,9.284306425212e-005,0.0003214763033752,
 						0.0004718730150497,0.0004751593869308,0.0003340326743267};
 #ifdef _DEBUG
-FILE * m_pflDebug;
 double temp = 0.0;
 #endif
 
 //----------------------------------------------------------------------------------------------------------
-//   								Module Variables
+//   								Structs
 //----------------------------------------------------------------------------------------------------------
-static int						m_intFilterBufferIndex;
-static double					m_dblFilterBuffer [EEGCHANNELS][LP_FILTER_BUFFER_LENGTH];
+struct _SigProcContext
+{
+	struct FIR_Filter		EEGFilters[EEGCHANNELS];		// low-pass filters of the EEG signals
+
+	// aEEG
+	struct FIR_Filter		AEEG_MA[EEGCHANNELS];
+	struct FIR_Filter		AEEG_AR[EEGCHANNELS];
+	struct FIR_Filter		AEEG_BP[EEGCHANNELS];
+	struct LocalMax			LocalMax[EEGCHANNELS];
 
-static struct FIR_Filter		m_EEGFilters[EEGCHANNELS];
+	// baseline removal
+	BOOL					RemoveBaseline;
+	struct Median_Filter	BaselineFilters[EEGCHANNELS];
 
-// aEEG
-struct FIR_Filter				m_AEEG_MA[EEGCHANNELS], m_AEEG_AR[EEGCHANNELS], m_AEEG_BP[EEGCHANNELS];
-struct LocalMax					m_LocalMax[EEGCHANNELS];
+#ifdef _DEBUG
+	FILE *					pflDebug;
+#endif
+};
 
 //----------------------------------------------------------------------------------------------------------
 //   								Locally-accessible Code
@@ -278,17 +288,11 @@ double sp_filter_FIR(struct FIR_Filter * pFilter,
 	// insert new sample
 	pFilter->Buffer[pFilter->BufferID] = dblNewSample;
 
-	// initialize output sample
-	dblValue = 0.0;
-		
-	// perform FIR filtering
-	for(j = 0; j < pFilter->Order; j++)
-	{
-		dblValue += pFilter->Buffer[pFilter->BufferID]*pFilter->Coefficients[j];
-		
-		// compute index of next-oldest sample
-		pFilter->BufferID = (pFilter->BufferID + 1)%pFilter->Order;
-	}
+	// perform FIR filtering: samples are stored from newest to oldest starting at BufferID and wrapping around the end of
+	// the buffer, so the convolution splits into two contiguous dot products
+	j = pFilter->Order - pFilter->BufferID;
+	dblValue = simd_DotProduct(pFilter->Buffer + pFilter->BufferID, pFilter->Coefficients, j) +
+			   simd_DotProduct(pFilter->Buffer, pFilter->Coefficients + j, pFilter->BufferID);
 
 	// update the filter buffer index for the next iteration so that it points to the oldest sample
 	if(pFilter->BufferID == 0)
@@ -299,137 +303,330 @@ double sp_filter_FIR(struct FIR_Filter * pFilter,
 	return dblValue;
 }
 
+/**
+ * \brief Returns TRUE if the element at heap position a should be above the element at position b.
+ */
+static BOOL sp_median_IsAbove(struct Median_Filter * pFilter, unsigned int * puintHeap, BOOL blnIsMaxHeap, unsigned int a, unsigned int b)
+{
+	if(blnIsMaxHeap)
+		return pFilter->Values[puintHeap[a]] > pFilter->Values[puintHeap[b]];
+	else
+		return pFilter->Values[puintHeap[a]] < pFilter->Values[puintHeap[b]];
+}
+
+/**
+ * \brief Exchanges two heap elements and updates their recorded positions.
+ */
+static void sp_median_Swap(struct Median_Filter * pFilter, unsigned int * puintHeap, BOOL blnIsMaxHeap, unsigned int a, unsigned int b)
+{
+	unsigned int uintTemp;
+
+	uintTemp = puintHeap[a];
+	puintHeap[a] = puintHeap[b];
+	puintHeap[b] = uintTemp;
+
+	pFilter->Position[puintHeap[a]] = blnIsMaxHeap ? (int) a : -((int) a) - 1;
+	pFilter->Position[puintHeap[b]] = blnIsMaxHeap ? (int) b : -((int) b) - 1;
+}
+
+/**
+ * \brief Restores the heap property around position i after the value stored there has changed (O(log W)).
+ */
+static void sp_median_Sift(struct Median_Filter * pFilter, BOOL blnIsMaxHeap, unsigned int i)
+{
+	unsigned int * puintHeap, uintNElements, uintChild;
+
+	puintHeap = blnIsMaxHeap ? pFilter->MaxHeap : pFilter->MinHeap;
+	uintNElements = blnIsMaxHeap ? pFilter->NMaxHeap : pFilter->NMinHeap;
+
+	// move up
+	while(i > 0 && sp_median_IsAbove(pFilter, puintHeap, blnIsMaxHeap, i, (i - 1)/2))
+	{
+		sp_median_Swap(pFilter, puintHeap, blnIsMaxHeap, i, (i - 1)/2);
+		i = (i - 1)/2;
+	}
+
+	// move down
+	while((uintChild = 2*i + 1) < uintNElements)
+	{
+		if(uintChild + 1 < uintNElements && sp_median_IsAbove(pFilter, puintHeap, blnIsMaxHeap, uintChild + 1, uintChild))
+			uintChild++;
+
+		if(!sp_median_IsAbove(pFilter, puintHeap, blnIsMaxHeap, uintChild, i))
+			break;
+
+		sp_median_Swap(pFilter, puintHeap, blnIsMaxHeap, i, uintChild);
+		i = uintChild;
+	}
+}
+
+/**
+ * \brief Makes sure that every element of the lower half is smaller or equal to every element of the upper half.
+ */
+static void sp_median_Balance(struct Median_Filter * pFilter)
+{
+	unsigned int uintTemp;
+
+	if(pFilter->NMinHeap > 0 && pFilter->Values[pFilter->MaxHeap[0]] > pFilter->Values[pFilter->MinHeap[0]])
+	{
+		uintTemp = pFilter->MaxHeap[0];
+		pFilter->MaxHeap[0] = pFilter->MinHeap[0];
+		pFilter->MinHeap[0] = uintTemp;
+		pFilter->Position[pFilter->MaxHeap[0]] = 0;
+		pFilter->Position[pFilter->MinHeap[0]] = -1;
+
+		sp_median_Sift(pFilter, TRUE, 0);
+		sp_median_Sift(pFilter, FALSE, 0);
+	}
+}
+
+static BOOL sp_median_init(struct Median_Filter * pFilter, unsigned int uintLength)
+{
+	pFilter->Length = uintLength;
+	pFilter->NSamples = 0;
+	pFilter->NMaxHeap = 0;
+	pFilter->NMinHeap = 0;
+	pFilter->BufferID = 0;
+	pFilter->Values = (short *) malloc(uintLength*sizeof(short));
+	pFilter->Position = (int *) malloc(uintLength*sizeof(int));
+	pFilter->MaxHeap = (unsigned int *) malloc((uintLength/2 + 1)*sizeof(unsigned int));
+	pFilter->MinHeap = (unsigned int *) malloc((uintLength/2 + 1)*sizeof(unsigned int));
+
+	return (pFilter->Values != NULL && pFilter->Position != NULL && pFilter->MaxHeap != NULL && pFilter->MinHeap != NULL);
+}
+
+static void sp_median_free(struct Median_Filter * pFilter)
+{
+	free(pFilter->Values);		pFilter->Values = NULL;
+	free(pFilter->Position);	pFilter->Position = NULL;
+	free(pFilter->MaxHeap);		pFilter->MaxHeap = NULL;
+	free(pFilter->MinHeap);		pFilter->MinHeap = NULL;
+}
+
+/**
+ * \brief Removes the baseline of a signal by subtracting the median of a sliding window centered on the output sample.
+ *
+ * The window is kept in a ring buffer and split into two heaps (lower and upper half) that hold the ring indices of the
+ * samples. Once the window is full, the new sample overwrites the oldest one in place and only the heap that contains it
+ * has to be re-sifted, so each sample costs O(log W). The output is delayed by half the window length.
+ *
+ * \param[in]	pFilter			filter state of the channel
+ * \param[in]	shrNewSample	new signal sample
+ *
+ * \return Baseline-free sample from the center of the window.
+ */
+double sp_filter_Median(struct Median_Filter * pFilter,
+						short shrNewSample)
+{
+	double dblMedian;
+	unsigned int uintID;
+
+	uintID = pFilter->BufferID;
+	pFilter->Values[uintID] = shrNewSample;
+
+	if(pFilter->NSamples < pFilter->Length)
+	{
+		// window not full yet: add sample to the smaller half
+		if(pFilter->NMaxHeap <= pFilter->NMinHeap)
+		{
+			pFilter->MaxHeap[pFilter->NMaxHeap] = uintID;
+			pFilter->Position[uintID] = (int) pFilter->NMaxHeap;
+			pFilter->NMaxHeap++;
+			sp_median_Sift(pFilter, TRUE, pFilter->NMaxHeap - 1);
+		}
+		else
+		{
+			pFilter->MinHeap[pFilter->NMinHeap] = uintID;
+			pFilter->Position[uintID] = -((int) pFilter->NMinHeap) - 1;
+			pFilter->NMinHeap++;
+			sp_median_Sift(pFilter, FALSE, pFilter->NMinHeap - 1);
+		}
+		pFilter->NSamples++;
+	}
+	else
+	{
+		// window full: new sample has replaced the oldest one at the same heap position
+		if(pFilter->Position[uintID] >= 0)
+			sp_median_Sift(pFilter, TRUE, (unsigned int) pFilter->Position[uintID]);
+		else
+			sp_median_Sift(pFilter, FALSE, (unsigned int) (-pFilter->Position[uintID] - 1));
+	}
+	sp_median_Balance(pFilter);
+
+	// compute median
+	if(pFilter->NMaxHeap > pFilter->NMinHeap)
+		dblMedian = pFilter->Values[pFilter->MaxHeap[0]];
+	else
+		dblMedian = 0.5*((double) pFilter->Values[pFilter->MaxHeap[0]] + (double) pFilter->Values[pFilter->MinHeap[0]]);
+
+	pFilter->BufferID = (pFilter->BufferID + 1)%pFilter->Length;
+
+	// output sample at the center of the window (i.e., Length/2 samples before the newest one)
+	if(pFilter->NSamples <= pFilter->Length/2)
+		return 0.0;
+
+	return ((double) pFilter->Values[(uintID + pFilter->Length - pFilter->Length/2)%pFilter->Length]) - dblMedian;
+}
+
 //----------------------------------------------------------------------------------------------------------
 //   								Globally-accessible Code
 //----------------------------------------------------------------------------------------------------------
 
-BOOL sp_init(void)
+/**
+ * \brief Creates the filters of one set of EEG signals.
+ *
+ * \param[in]	uintBaselineWindowLength	length, in samples, of the running-median window used for baseline removal (0 disables baseline removal)
+ *
+ * \return Pointer to the context if succesfull, NULL otherwise.
+ */
+SigProcContext * sp_CreateContext(unsigned int uintBaselineWindowLength)
 {
 	BOOL blnErrorOccured = FALSE;
+	SigProcContext * pspc;
 
 #ifdef _DEBUG
 	TCHAR strBuffer[MAX_PATH + 1];
 #endif
 	unsigned int i, j;
 
-	m_intFilterBufferIndex = 0;
-
-	// Initialize buffers
-	for (i = 0; i < EEGCHANNELS; i++)
-	{
-		for (j = 0; j < LP_FILTER_BUFFER_LENGTH; j++)
-			m_dblFilterBuffer [i][j] = 0.0;
-	}
+	// NOTE: the buffers are NULL until they have been allocated, so that sp_DestroyContext() can release a partially created context
+	pspc = (SigProcContext *) calloc(1, sizeof(SigProcContext));
+	if(pspc == NULL)
+		return NULL;
 
 	// initialize LP & aEEG filters
 	for(i = 0; i < EEGCHANNELS; i++)
 	{
 		// LP
-		m_EEGFilters[i].Coefficients = 0;
-		m_EEGFilters[i].Order = LP_FILTER_BUFFER_LENGTH;
-		m_EEGFilters[i].BufferID = 0;
-		m_EEGFilters[i].Buffer = (double *) malloc(m_EEGFilters[i].Order*sizeof(double));
-		if(m_EEGFilters[i].Buffer == NULL)
+		pspc->EEGFilters[i].Coefficients = 0;
+		pspc->EEGFilters[i].Order = LP_FILTER_BUFFER_LENGTH;
+		pspc->EEGFilters[i].BufferID = 0;
+		pspc->EEGFilters[i].Buffer = (double *) malloc(pspc->EEGFilters[i].Order*sizeof(double));
+		if(pspc->EEGFilters[i].Buffer == NULL)
 		{
 			blnErrorOccured = TRUE;
 			break;
 		}
 		else
 		{
-			for(j = 0; j < m_EEGFilters[i].Order; j++)
-				m_EEGFilters[i].Buffer[j] = 0.0;
+			for(j = 0; j < pspc->EEGFilters[i].Order; j++)
+				pspc->EEGFilters[i].Buffer[j] = 0.0;
 		}
 
 		// aEEG
-		m_AEEG_AR[i].Order = 12;
-		m_AEEG_AR[i].Coefficients = m_dblAR;
-		m_AEEG_AR[i].BufferID = 0;
-		m_AEEG_AR[i].Buffer = (double *) malloc(m_AEEG_AR[i].Order*sizeof(double));
-		if(m_AEEG_AR[i].Buffer == NULL)
+		pspc->AEEG_AR[i].Order = 12;
+		pspc->AEEG_AR[i].Coefficients = m_dblAR;
+		pspc->AEEG_AR[i].BufferID = 0;
+		pspc->AEEG_AR[i].Buffer = (double *) malloc(pspc->AEEG_AR[i].Order*sizeof(double));
+		if(pspc->AEEG_AR[i].Buffer == NULL)
 		{
 			blnErrorOccured = TRUE;
 			break;
 		}
 		else
 		{
-			for(j = 0; j < m_AEEG_AR[i].Order; j++)
-				m_AEEG_AR[i].Buffer[j] = 0.0;
+			for(j = 0; j < pspc->AEEG_AR[i].Order; j++)
+				pspc->AEEG_AR[i].Buffer[j] = 0.0;
 		}
 
-		m_AEEG_BP[i].Order = 299;
-		m_AEEG_BP[i].Coefficients = m_dblBP;
-		m_AEEG_BP[i].BufferID = 0;
-		m_AEEG_BP[i].Buffer = (double *) malloc(m_AEEG_BP[i].Order*sizeof(double));
-		if(m_AEEG_BP[i].Buffer == NULL)
+		pspc->AEEG_BP[i].Order = 299;
+		pspc->AEEG_BP[i].Coefficients = m_dblBP;
+		pspc->AEEG_BP[i].BufferID = 0;
+		pspc->AEEG_BP[i].Buffer = (double *) malloc(pspc->AEEG_BP[i].Order*sizeof(double));
+		if(pspc->AEEG_BP[i].Buffer == NULL)
 		{
 			blnErrorOccured = TRUE;
 			break;
 		}
 		else
 		{
-			for(j = 0; j < m_AEEG_BP[i].Order; j++)
-				m_AEEG_BP[i].Buffer[j] = 0.0;
+			for(j = 0; j < pspc->AEEG_BP[i].Order; j++)
+				pspc->AEEG_BP[i].Buffer[j] = 0.0;
 		}
 
-		m_AEEG_MA[i].Order = 4;
-		m_AEEG_MA[i].Coefficients = m_dblMA;
-		m_AEEG_MA[i].BufferID = 0;
-		m_AEEG_MA[i].Buffer = (double *) malloc(m_AEEG_MA[i].Order*sizeof(double));
-		if(m_AEEG_MA[i].Buffer == NULL)
+		pspc->AEEG_MA[i].Order = 4;
+		pspc->AEEG_MA[i].Coefficients = m_dblMA;
+		pspc->AEEG_MA[i].BufferID = 0;
+		pspc->AEEG_MA[i].Buffer = (double *) malloc(pspc->AEEG_MA[i].Order*sizeof(double));
+		if(pspc->AEEG_MA[i].Buffer == NULL)
 		{
 			blnErrorOccured = TRUE;
 			break;
 		}
 		else
 		{
-			for(j = 0; j < m_AEEG_MA[i].Order; j++)
-				m_AEEG_MA[i].Buffer[j] = 0.0;
+			for(j = 0; j < pspc->AEEG_MA[i].Order; j++)
+				pspc->AEEG_MA[i].Buffer[j] = 0.0;
 		}
 
 		// aEEG local max
-		m_LocalMax[i].Value = 0.0;
-		m_LocalMax[i].Count = 0;
+		pspc->LocalMax[i].Value = 0.0;
+		pspc->LocalMax[i].Count = 0;
+	}
+
+	// baseline removal
+	pspc->RemoveBaseline = (uintBaselineWindowLength > 0 && uintBaselineWindowLength <= MAX_BASELINE_WINDOW_LENGTH);
+	for(i = 0; i < EEGCHANNELS && pspc->RemoveBaseline && !blnErrorOccured; i++)
+	{
+		if(!sp_median_init(&pspc->BaselineFilters[i], uintBaselineWindowLength))
+			blnErrorOccured = TRUE;
 	}
 
 	// release memory if error has occured
 	if(blnErrorOccured)
-		sp_cleanup();
+	{
+		sp_DestroyContext(pspc);
+		return NULL;
+	}
 
 #ifdef _DEBUG
-	m_pflDebug = NULL;
+	pspc->pflDebug = NULL;
 	if(GetTempPath(sizeof(strBuffer)/sizeof(TCHAR),strBuffer))
 	{
 		_tcscat_s(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("\\debug-aEEG-EEGEM.csv"));
-		_tfopen_s(&m_pflDebug, strBuffer, TEXT("w"));
+		_tfopen_s(&pspc->pflDebug, strBuffer, TEXT("w"));
 	}
 #endif
 
-	return !blnErrorOccured;
+	return pspc;
 }
 
-void sp_cleanup(void)
+/**
+ * \brief Releases the filters created by sp_CreateContext().
+ *
+ * \param[in]	pspc	filter context (can be NULL)
+ */
+void sp_DestroyContext(SigProcContext * pspc)
 {
 	unsigned int i;
 
+	if(pspc == NULL)
+		return;
+
 	for(i = 0; i < EEGCHANNELS; i++)
 	{
-		if(m_EEGFilters[i].Buffer != NULL)
-			free(m_EEGFilters[i].Buffer);
-		if(m_AEEG_AR[i].Buffer != NULL)
-			free(m_AEEG_AR[i].Buffer);
-		if(m_AEEG_BP[i].Buffer != NULL)
-			free(m_AEEG_BP[i].Buffer);
-		if(m_AEEG_MA[i].Buffer != NULL)
-			free(m_AEEG_MA[i].Buffer);
+		if(pspc->EEGFilters[i].Buffer != NULL)
+			free(pspc->EEGFilters[i].Buffer);
+		if(pspc->AEEG_AR[i].Buffer != NULL)
+			free(pspc->AEEG_AR[i].Buffer);
+		if(pspc->AEEG_BP[i].Buffer != NULL)
+			free(pspc->AEEG_BP[i].Buffer);
+		if(pspc->AEEG_MA[i].Buffer != NULL)
+			free(pspc->AEEG_MA[i].Buffer);
+
+		sp_median_free(&pspc->BaselineFilters[i]);
 	}
 
 #ifdef _DEBUG
-	if(m_pflDebug)
-		fclose(m_pflDebug);
+	if(pspc->pflDebug)
+		fclose(pspc->pflDebug);
 #endif
+
+	free(pspc);
 }
 
-void sp_FilterAEEGSignal(short ** pshrSampleBuffer,
+void sp_FilterAEEGSignal(SigProcContext * pspc,
+						 short ** pshrSampleBuffer,
 						 double ** pdblDisplayBuffer,
 						 unsigned int uintDisplayBufferLength,
 						 unsigned int * puintDisplayBufferID,
@@ -453,10 +650,10 @@ void sp_FilterAEEGSignal(short ** pshrSampleBuffer,
 			// Asymmetric Bandpass Filtering
 			//
 			// filter the data using the AR parameters
-			dblOutput = sp_filter_FIR(&(m_AEEG_AR[n]), dblNewSample);
+			dblOutput = sp_filter_FIR(&(pspc->AEEG_AR[n]), dblNewSample);
 
 			// filter data with BP filter
-			dblOutput = sp_filter_FIR(&(m_AEEG_BP[n]), dblOutput);
+			dblOutput = sp_filter_FIR(&(pspc->AEEG_BP[n]), dblOutput);
 
 			//
 			// Rectifcation
@@ -476,18 +673,18 @@ void sp_FilterAEEGSignal(short ** pshrSampleBuffer,
 			}
 
 			// time compression
-			if(dblOutput > m_LocalMax[n].Value)
-				m_LocalMax[n].Value = dblOutput;
+			if(dblOutput > pspc->LocalMax[n].Value)
+				pspc->LocalMax[n].Value = dblOutput;
 			
-			m_LocalMax[n].Count = m_LocalMax[n].Count + 1;
-			if(m_LocalMax[n].Count == AEEG_TIME_INTERVAL)
+			pspc->LocalMax[n].Count = pspc->LocalMax[n].Count + 1;
+			if(pspc->LocalMax[n].Count == AEEG_TIME_INTERVAL)
 			{
-				pdblDisplayBuffer[n][k] = m_LocalMax[n].Value;
-				//dblDisplayBuffer[n][k] = sp_filter_FIR(&(m_AEEG_MA[n]), dblDisplayBuffer[n][k]);		// NOTE: was removed since its presence is questionable
+				pdblDisplayBuffer[n][k] = pspc->LocalMax[n].Value;
+				//dblDisplayBuffer[n][k] = sp_filter_FIR(&(pspc->AEEG_MA[n]), dblDisplayBuffer[n][k]);		// NOTE: was removed since its presence is questionable
 				k = (++k)%uintDisplayBufferLength;
 
-				m_LocalMax[n].Value = 0.0;
-				m_LocalMax[n].Count = 0;
+				pspc->LocalMax[n].Value = 0.0;
+				pspc->LocalMax[n].Count = 0;
 			}
 
 #ifdef _DEBUG
@@ -496,7 +693,7 @@ void sp_FilterAEEGSignal(short ** pshrSampleBuffer,
 			{
 				if(k > 0)
 					temp = pdblDisplayBuffer[n][k - 1];
-				_ftprintf(m_pflDebug, TEXT("%d;%f;%f\n"), pshrSampleBuffer[n][i], dblOutput, temp);
+				_ftprintf(pspc->pflDebug, TEXT("%d;%f;%f\n"), pshrSampleBuffer[n][i], dblOutput, temp);
 			}
 #endif
 		}
@@ -512,7 +709,9 @@ void sp_FilterAEEGSignal(short ** pshrSampleBuffer,
  * This function applies two FIR filters to all the EEG signals. The new signals samples are copied one by one from the \e shrSampleBuffer
  * buffer to the \e shrFilterBuffer. Then a low-pass FIR filter and a high-pass FIR filter are applied to the signals and the output
  * sample is stored in the \e shrDisplayBuffer buffer. This process is repeated for each sample present in the \e shrSampleBuffer buffer.
+ * If baseline removal was enabled in sp_CreateContext(), the running median of each signal is subtracted before the FIR filters are applied.
  *
+ * \param[in]	pspc					filter context of the signals
  * \param[in]	pshrSampleBuffer		Pointer to temporary buffer where signal samples are stored while awaiting processing by this function.
  * \param[out]	pdblDisplayBuffer		Pointer to circular output buffer where the signal samples that have been processed are stored
  * \param[in]	uintDisplayBufferLength
@@ -521,7 +720,8 @@ void sp_FilterAEEGSignal(short ** pshrSampleBuffer,
  *
  * \return Index of the oldest sample in \e shrDisplayBuffer.
  */
-void sp_FilterEEGSignal(short ** pshrSampleBuffer,
+void sp_FilterEEGSignal(SigProcContext * pspc,
+						short ** pshrSampleBuffer,
 						double ** pdblDisplayBuffer,
 						unsigned int uintDisplayBufferLength,
 						unsigned int * puintDisplayBufferID,
@@ -542,7 +742,10 @@ void sp_FilterEEGSignal(short ** pshrSampleBuffer,
 
 			for(j=0;j<uintNNewSamples;j++)
 			{
-				pdblDisplayBuffer[i][m] = pshrSampleBuffer [i][j];
+				if(pspc->RemoveBaseline)
+					pdblDisplayBuffer[i][m] = sp_filter_Median(&pspc->BaselineFilters[i], pshrSampleBuffer [i][j]);
+				else
+					pdblDisplayBuffer[i][m] = pshrSampleBuffer [i][j];
 				m = (++m)%uintDisplayBufferLength;
 			}
 		}
@@ -554,33 +757,18 @@ void sp_FilterEEGSignal(short ** pshrSampleBuffer,
 			m = *puintDisplayBufferID;
 
 			// set appropriate filter coefficients
-			m_EEGFilters[n].Coefficients = m_dblLPFilterPointers[intLPFilterIndex];
+			pspc->EEGFilters[n].Coefficients = m_dblLPFilterPointers[intLPFilterIndex];
 			
 			// filter each sample individually
 			for(i = 0; i < uintNNewSamples; i++)
 			{
-				// insert new sample
-				m_EEGFilters[n].Buffer[m_EEGFilters[n].BufferID] = pshrSampleBuffer[n][i];
-
-				// initialize output sample
-				pdblDisplayBuffer[n][m] = 0.0;
-				
-				// perform FIR filtering
-				for(j = 0; j < LP_FILTER_BUFFER_LENGTH; j++)
-				{
-					pdblDisplayBuffer[n][m] += m_EEGFilters[n].Buffer[m_EEGFilters[n].BufferID]*m_EEGFilters[n].Coefficients[j];
-					
-					// compute index of next-oldest sample
-					m_EEGFilters[n].BufferID = (m_EEGFilters[n].BufferID + 1)%m_EEGFilters[n].Order;
-				}
+				// filter new sample
+				if(pspc->RemoveBaseline)
+					pdblDisplayBuffer[n][m] = sp_filter_FIR(&pspc->EEGFilters[n], sp_filter_Median(&pspc->BaselineFilters[n], pshrSampleBuffer[n][i]));
+				else
+					pdblDisplayBuffer[n][m] = sp_filter_FIR(&pspc->EEGFilters[n], pshrSampleBuffer[n][i]);
 				
 				m = (++m)%uintDisplayBufferLength;
-
-				// update the filter buffer index for the next iteration so that it points to the oldest sample
-				if(m_EEGFilters[n].BufferID == 0)
-					m_EEGFilters[n].BufferID = m_EEGFilters[n].Order - 1;
-				else
-					m_EEGFilters[n].BufferID--;
 			}
 		}
 	}
@@ -588,7 +776,8 @@ void sp_FilterEEGSignal(short ** pshrSampleBuffer,
 	*puintDisplayBufferID = m;
 }
 
-void sp_FilterAllPass(short ** pshrSampleBuffer,
+void sp_FilterAllPass(SigProcContext * pspc,
+					  short ** pshrSampleBuffer,
 					  double ** pdblDisplayBuffer,
 					  unsigned int uintDisplayBufferLength,
 					  unsigned int * puintDisplayBufferID,
@@ -606,7 +795,10 @@ void sp_FilterAllPass(short ** pshrSampleBuffer,
 
 		for(j = 0; j < uintNNewSamples;j++)
 		{
-			pdblDisplayBuffer[i][m] = pshrSampleBuffer [i][j];
+			if(pspc->RemoveBaseline)
+				pdblDisplayBuffer[i][m] = sp_filter_Median(&pspc->BaselineFilters[i], pshrSampleBuffer [i][j]);
+			else
+				pdblDisplayBuffer[i][m] = pshrSampleBuffer [i][j];
 			m = (++m)%uintDisplayBufferLength;
 		}
 	}
@@ -23,6 +23,7 @@
 //---------------------------------------------------------------------------
 # define LP_FILTER_BUFFER_LENGTH		43
 # define NFILTER_STAGES_aEEG			3
+# define MAX_BASELINE_WINDOW_LENGTH		(10*1000)		// longest running-median window, in samples (10 s @ 1 kHz)
 
 //---------------------------------------------------------------------------
 //   								Constants
@@ -45,14 +46,33 @@ struct LocalMax
 	unsigned int Count;
 };
 
+struct Median_Filter
+{
+	short * Values;					// ring buffer with the samples that are currently in the window
+	int * Position;					// location of each ring element in the heaps (>= 0: index in MaxHeap, < 0: -(index in MinHeap) - 1)
+	unsigned int * MaxHeap;			// ring indices of the lower half of the window (largest value on top)
+	unsigned int * MinHeap;			// ring indices of the upper half of the window (smallest value on top)
+	unsigned int NMaxHeap;
+	unsigned int NMinHeap;
+	unsigned int Length;
+	unsigned int NSamples;
+	unsigned int BufferID;			// index of the oldest sample in the ring
+};
+
+/**
+ * State of the filters of one set of EEG signals (defined in sigproc.cpp). Each display, or each recording that is
+ * filtered, uses its own context, so that the filters of one do not see the samples of another.
+ */
+typedef struct _SigProcContext SigProcContext;
+
 //---------------------------------------------------------------------------
 //   								Prototypes
 //---------------------------------------------------------------------------
-BOOL	sp_init(void);
-void	sp_cleanup(void);
-void	sp_FilterAEEGSignal(short ** pshrSampleBuffer, double ** pdblDisplayBuffer, unsigned int uintDisplayBufferLength, unsigned int * puintDisplayBufferID, unsigned int uintNNewSamples);
-void	sp_FilterEEGSignal(short ** pshrSampleBuffer, double ** pdblDisplayBuffer, unsigned int uintDisplayBufferLength, unsigned int * puintDisplayBufferID, unsigned int uintNNewSamples, int intLPFilterIndex);
-void	sp_FilterAllPass(short ** pshrSampleBuffer, double ** pdblDisplayBuffer, unsigned int uintDisplayBufferLength, unsigned int * puintDisplayBufferID, unsigned int uintNNewSamples);
-void	sp_GetLPFiltersFc(float * pfltLPCutOffFrequenciesBuffer, unsigned int uintLPCutOffFrequenciesBufferLength);
+SigProcContext *	sp_CreateContext(unsigned int uintBaselineWindowLength);
+void				sp_DestroyContext(SigProcContext * pspc);
+void				sp_FilterAEEGSignal(SigProcContext * pspc, short ** pshrSampleBuffer, double ** pdblDisplayBuffer, unsigned int uintDisplayBufferLength, unsigned int * puintDisplayBufferID, unsigned int uintNNewSamples);
+void				sp_FilterEEGSignal(SigProcContext * pspc, short ** pshrSampleBuffer, double ** pdblDisplayBuffer, unsigned int uintDisplayBufferLength, unsigned int * puintDisplayBufferID, unsigned int uintNNewSamples, int intLPFilterIndex);
+void				sp_FilterAllPass(SigProcContext * pspc, short ** pshrSampleBuffer, double ** pdblDisplayBuffer, unsigned int uintDisplayBufferLength, unsigned int * puintDisplayBufferID, unsigned int uintNNewSamples);
+void				sp_GetLPFiltersFc(float * pfltLPCutOffFrequenciesBuffer, unsigned int uintLPCutOffFrequenciesBufferLength);
 
 # endif
\ No newline at end of file
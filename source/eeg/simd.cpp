@@ -0,0 +1,711 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		simd.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that selects, at run time, the fastest implementation of the numeric kernels supported by the
+ *				processor.
+ *
+ * Every kernel has a portable reference implementation and one implementation per supported instruction set. simd_init()
+ * queries the processor with CPUID once at startup, checks each candidate implementation against the reference one and
+ * points the kernel entry points at the fastest implementation that passed. Until simd_init() is called, the reference
+ * implementations are used.
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// CRT libraries
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// program headers
+#include "compat.h"
+#include "applog.h"
+#include "simd.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+#define SIMD_CPUID_EDX_SSE2				(1 << 26)			///< SSE2 support flag in EDX of CPUID leaf 1
+#define SIMD_CPUID_ECX_SSSE3			(1 << 9)			///< SSSE3 support flag in ECX of CPUID leaf 1
+#define SIMD_CPUID_ECX_OSXSAVE			(1 << 27)			///< XGETBV support flag (the OS saves the extended registers) in ECX of CPUID leaf 1
+#define SIMD_CPUID_ECX_AVX				(1 << 28)			///< AVX support flag in ECX of CPUID leaf 1
+#define SIMD_XCR0_YMM					0x06				///< XCR0 bits of the XMM and YMM register states (both must be saved by the OS)
+#define SIMD_SELFTEST_MAX_LENGTH		67					///< longest vector used to check the kernels (covers all remainder cases)
+#define SIMD_SELFTEST_TOLERANCE			1e-12				///< maximum relative difference allowed between floating-point results
+
+// GCC and Clang only emit the instructions of an instruction set in the functions that are compiled for it (MSVC emits
+// the instructions of any intrinsic that is used)
+#ifdef _MSC_VER
+#define SIMD_TARGET_SSSE3
+#define SIMD_TARGET_AVX
+#else
+#define SIMD_TARGET_SSSE3				__attribute__((target("ssse3")))
+#define SIMD_TARGET_AVX					__attribute__((target("avx")))
+#endif
+
+typedef double (*SIMDDotProductFunction)(const double *, const double *, unsigned int);
+typedef void (*SIMDShortToDoubleFunction)(const short *, double *, unsigned int);
+typedef unsigned int (*SIMDByteSumFunction)(const unsigned char *, unsigned int);
+typedef void (*SIMDDecodeSamplesFunction)(const WORD *, unsigned int, unsigned int, short * const *, unsigned int);
+typedef void (*SIMDWelfordUpdateFunction)(const double *, double *, double *, double, unsigned int);
+
+/**
+ * Implementations of the kernels for one instruction set.
+ */
+typedef struct
+{
+	SIMDDotProductFunction		DotProduct;
+	SIMDShortToDoubleFunction	ShortToDouble;
+	SIMDByteSumFunction			ByteSum;
+	SIMDDecodeSamplesFunction	DecodeSamples;
+	SIMDWelfordUpdateFunction	WelfordUpdate;
+}
+SIMDKernels;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+static double	simd_DotProduct_Scalar(const double * pdblA, const double * pdblB, unsigned int uintLength);
+static double	simd_DotProduct_SSE2(const double * pdblA, const double * pdblB, unsigned int uintLength);
+static void		simd_ShortToDouble_Scalar(const short * pshrSource, double * pdblDestination, unsigned int uintLength);
+static void		simd_ShortToDouble_SSE2(const short * pshrSource, double * pdblDestination, unsigned int uintLength);
+static unsigned int	simd_ByteSum_Scalar(const unsigned char * puchrData, unsigned int uintLength);
+static unsigned int	simd_ByteSum_SSE2(const unsigned char * puchrData, unsigned int uintLength);
+static void		simd_DecodeSamples_Scalar(const WORD * pwrdSource, unsigned int uintNChannels, unsigned int uintNSamples, short * const * ppshrDestination, unsigned int uintDestinationIndex);
+static void		simd_DecodeSamples_SSSE3(const WORD * pwrdSource, unsigned int uintNChannels, unsigned int uintNSamples, short * const * ppshrDestination, unsigned int uintDestinationIndex);
+static void		simd_WelfordUpdate_Scalar(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength);
+static void		simd_WelfordUpdate_SSE2(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength);
+static double	simd_DotProduct_AVX(const double * pdblA, const double * pdblB, unsigned int uintLength);
+static void		simd_ShortToDouble_AVX(const short * pshrSource, double * pdblDestination, unsigned int uintLength);
+static void		simd_WelfordUpdate_AVX(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength);
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static SIMDLevel					m_slLevel = SIMDLevel_Scalar;						///< instruction set of the kernels currently in use
+static SIMDLevel					m_slMaxLevel = SIMDLevel_Scalar;					///< fastest instruction set supported by the processor whose kernels passed the self test
+static SIMDDotProductFunction		m_pfnDotProduct = simd_DotProduct_Scalar;			///< current implementation of simd_DotProduct()
+static SIMDShortToDoubleFunction	m_pfnShortToDouble = simd_ShortToDouble_Scalar;		///< current implementation of simd_ShortToDouble()
+static SIMDByteSumFunction			m_pfnByteSum = simd_ByteSum_Scalar;					///< current implementation of simd_ByteSum()
+static SIMDDecodeSamplesFunction	m_pfnDecodeSamples = simd_DecodeSamples_Scalar;		///< current implementation of simd_DecodeSamples()
+static SIMDWelfordUpdateFunction	m_pfnWelfordUpdate = simd_WelfordUpdate_Scalar;		///< current implementation of simd_WelfordUpdate()
+
+/**
+ * PSHUFB masks used by simd_DecodeSamples_SSSE3(), indexed by [number of channels - 1][input vector][channel]. A block of 8
+ * samples of n interleaved channels occupies exactly n vectors; the mask moves the samples of one channel that are stored in
+ * one of the input vectors to their place in that channel's output vector and zeroes all other lanes.
+ */
+static __m128i						m_m128DeinterleaveMasks[SIMD_DECODE_MAX_CHANNELS][SIMD_DECODE_MAX_CHANNELS][SIMD_DECODE_MAX_CHANNELS];
+
+/**
+ * Kernels of each instruction set, indexed by SIMDLevel. An instruction set only replaces the kernels that it speeds up and
+ * keeps those of the previous one.
+ */
+static const SIMDKernels			mc_skKernels[SIMDLevel_Count] =
+{
+	{simd_DotProduct_Scalar, simd_ShortToDouble_Scalar, simd_ByteSum_Scalar, simd_DecodeSamples_Scalar, simd_WelfordUpdate_Scalar},
+	{simd_DotProduct_SSE2, simd_ShortToDouble_SSE2, simd_ByteSum_SSE2, simd_DecodeSamples_Scalar, simd_WelfordUpdate_SSE2},
+	{simd_DotProduct_SSE2, simd_ShortToDouble_SSE2, simd_ByteSum_SSE2, simd_DecodeSamples_SSSE3, simd_WelfordUpdate_SSE2},
+	{simd_DotProduct_AVX, simd_ShortToDouble_AVX, simd_ByteSum_SSE2, simd_DecodeSamples_SSSE3, simd_WelfordUpdate_AVX}
+};
+
+//---------------------------------------------------------------------------
+//   						Internally-accessible functions
+//---------------------------------------------------------------------------
+// reference implementations
+static double simd_DotProduct_Scalar(const double * pdblA, const double * pdblB, unsigned int uintLength)
+{
+	double			dblSum = 0.0;
+	unsigned int	i;
+
+	for(i = 0; i < uintLength; i++)
+		dblSum += pdblA[i]*pdblB[i];
+
+	return dblSum;
+}
+
+static void simd_ShortToDouble_Scalar(const short * pshrSource, double * pdblDestination, unsigned int uintLength)
+{
+	unsigned int i;
+
+	for(i = 0; i < uintLength; i++)
+		pdblDestination[i] = (double) pshrSource[i];
+}
+
+static unsigned int simd_ByteSum_Scalar(const unsigned char * puchrData, unsigned int uintLength)
+{
+	unsigned int i, uintSum = 0;
+
+	for(i = 0; i < uintLength; i++)
+		uintSum += puchrData[i];
+
+	return uintSum;
+}
+
+static void simd_DecodeSamples_Scalar(const WORD * pwrdSource, unsigned int uintNChannels, unsigned int uintNSamples, short * const * ppshrDestination, unsigned int uintDestinationIndex)
+{
+	unsigned int i, j;
+
+	for(i = 0; i < uintNSamples; i++)
+	{
+		for(j = 0; j < uintNChannels; j++)
+			ppshrDestination[j][uintDestinationIndex + i] = (short) (pwrdSource[i*uintNChannels + j] ^ 0x8000);
+	}
+}
+
+static void simd_WelfordUpdate_Scalar(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength)
+{
+	double			dblDelta;
+	unsigned int	i;
+
+	for(i = 0; i < uintLength; i++)
+	{
+		dblDelta = pdblSample[i] - pdblMean[i];
+		pdblMean[i] += dblDelta*dblReciprocalN;
+		pdblM2[i] += dblDelta*(pdblSample[i] - pdblMean[i]);
+	}
+}
+
+// SSE2 implementations
+static double simd_DotProduct_SSE2(const double * pdblA, const double * pdblB, unsigned int uintLength)
+{
+	__m128d			m128Sum0, m128Sum1;
+	double			dblSum[2];
+	unsigned int	i;
+
+	m128Sum0 = _mm_setzero_pd();
+	m128Sum1 = _mm_setzero_pd();
+
+	// two independent accumulators hide the latency of the additions
+	for(i = 0; i + 4 <= uintLength; i += 4)
+	{
+		m128Sum0 = _mm_add_pd(m128Sum0, _mm_mul_pd(_mm_loadu_pd(pdblA + i), _mm_loadu_pd(pdblB + i)));
+		m128Sum1 = _mm_add_pd(m128Sum1, _mm_mul_pd(_mm_loadu_pd(pdblA + i + 2), _mm_loadu_pd(pdblB + i + 2)));
+	}
+	_mm_storeu_pd(dblSum, _mm_add_pd(m128Sum0, m128Sum1));
+	dblSum[0] += dblSum[1];
+
+	for(; i < uintLength; i++)
+		dblSum[0] += pdblA[i]*pdblB[i];
+
+	return dblSum[0];
+}
+
+static void simd_ShortToDouble_SSE2(const short * pshrSource, double * pdblDestination, unsigned int uintLength)
+{
+	__m128i			m128Samples, m128Low, m128High;
+	unsigned int	i;
+
+	for(i = 0; i + 8 <= uintLength; i += 8)
+	{
+		// sign-extend 8 x 16 bit to 2 x (4 x 32 bit)
+		m128Samples = _mm_loadu_si128((const __m128i *) (pshrSource + i));
+		m128Low = _mm_srai_epi32(_mm_unpacklo_epi16(m128Samples, m128Samples), 16);
+		m128High = _mm_srai_epi32(_mm_unpackhi_epi16(m128Samples, m128Samples), 16);
+
+		// convert 2 x 32 bit at a time
+		_mm_storeu_pd(pdblDestination + i, _mm_cvtepi32_pd(m128Low));
+		_mm_storeu_pd(pdblDestination + i + 2, _mm_cvtepi32_pd(_mm_shuffle_epi32(m128Low, _MM_SHUFFLE(1, 0, 3, 2))));
+		_mm_storeu_pd(pdblDestination + i + 4, _mm_cvtepi32_pd(m128High));
+		_mm_storeu_pd(pdblDestination + i + 6, _mm_cvtepi32_pd(_mm_shuffle_epi32(m128High, _MM_SHUFFLE(1, 0, 3, 2))));
+	}
+
+	for(; i < uintLength; i++)
+		pdblDestination[i] = (double) pshrSource[i];
+}
+
+static unsigned int simd_ByteSum_SSE2(const unsigned char * puchrData, unsigned int uintLength)
+{
+	__m128i			m128Sum;
+	unsigned int	i, uintSum;
+
+	// sum of absolute differences against zero adds up each group of 8 bytes into a 64 bit lane
+	m128Sum = _mm_setzero_si128();
+	for(i = 0; i + 16 <= uintLength; i += 16)
+		m128Sum = _mm_add_epi64(m128Sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) (puchrData + i)), _mm_setzero_si128()));
+	uintSum = (unsigned int) _mm_cvtsi128_si32(m128Sum) + (unsigned int) _mm_cvtsi128_si32(_mm_srli_si128(m128Sum, 8));
+
+	for(; i < uintLength; i++)
+		uintSum += puchrData[i];
+
+	return uintSum;
+}
+
+static void simd_WelfordUpdate_SSE2(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength)
+{
+	__m128d			m128Sample, m128Mean, m128Delta, m128ReciprocalN;
+	unsigned int	i;
+
+	m128ReciprocalN = _mm_set1_pd(dblReciprocalN);
+	for(i = 0; i + 2 <= uintLength; i += 2)
+	{
+		m128Sample = _mm_loadu_pd(pdblSample + i);
+		m128Mean = _mm_loadu_pd(pdblMean + i);
+		m128Delta = _mm_sub_pd(m128Sample, m128Mean);
+		m128Mean = _mm_add_pd(m128Mean, _mm_mul_pd(m128Delta, m128ReciprocalN));
+		_mm_storeu_pd(pdblMean + i, m128Mean);
+		_mm_storeu_pd(pdblM2 + i, _mm_add_pd(_mm_loadu_pd(pdblM2 + i), _mm_mul_pd(m128Delta, _mm_sub_pd(m128Sample, m128Mean))));
+	}
+
+	simd_WelfordUpdate_Scalar(pdblSample + i, pdblMean + i, pdblM2 + i, dblReciprocalN, uintLength - i);
+}
+
+// SSSE3 implementations
+SIMD_TARGET_SSSE3 static void simd_DecodeSamples_SSSE3(const WORD * pwrdSource, unsigned int uintNChannels, unsigned int uintNSamples, short * const * ppshrDestination, unsigned int uintDestinationIndex)
+{
+	__m128i			m128Input[SIMD_DECODE_MAX_CHANNELS], m128Output, m128SignBit;
+	const __m128i *	pm128Masks;
+	unsigned int	i, j, k;
+
+	m128SignBit = _mm_set1_epi16((short) 0x8000);
+	pm128Masks = &m_m128DeinterleaveMasks[uintNChannels - 1][0][0];
+
+	for(i = 0; i + 8 <= uintNSamples; i += 8)
+	{
+		// load the block of 8 samples (uintNChannels vectors)
+		for(k = 0; k < uintNChannels; k++)
+			m128Input[k] = _mm_loadu_si128((const __m128i *) (pwrdSource + i*uintNChannels + 8*k));
+
+		// gather each channel's samples from all input vectors, then flip the sign bit (offset binary -> two's complement)
+		for(j = 0; j < uintNChannels; j++)
+		{
+			m128Output = _mm_shuffle_epi8(m128Input[0], pm128Masks[j]);
+			for(k = 1; k < uintNChannels; k++)
+				m128Output = _mm_or_si128(m128Output, _mm_shuffle_epi8(m128Input[k], pm128Masks[k*SIMD_DECODE_MAX_CHANNELS + j]));
+			_mm_storeu_si128((__m128i *) (ppshrDestination[j] + uintDestinationIndex + i), _mm_xor_si128(m128Output, m128SignBit));
+		}
+	}
+
+	simd_DecodeSamples_Scalar(pwrdSource + i*uintNChannels, uintNChannels, uintNSamples - i, ppshrDestination, uintDestinationIndex + i);
+}
+
+// AVX implementations (256-bit floating-point operations; the integer kernels would need AVX2 and stay at SSE2/SSSE3)
+SIMD_TARGET_AVX static double simd_DotProduct_AVX(const double * pdblA, const double * pdblB, unsigned int uintLength)
+{
+	__m256d			m256Sum0, m256Sum1;
+	__m128d			m128Sum;
+	double			dblSum;
+	unsigned int	i;
+
+	m256Sum0 = _mm256_setzero_pd();
+	m256Sum1 = _mm256_setzero_pd();
+
+	// two independent accumulators hide the latency of the additions
+	for(i = 0; i + 8 <= uintLength; i += 8)
+	{
+		m256Sum0 = _mm256_add_pd(m256Sum0, _mm256_mul_pd(_mm256_loadu_pd(pdblA + i), _mm256_loadu_pd(pdblB + i)));
+		m256Sum1 = _mm256_add_pd(m256Sum1, _mm256_mul_pd(_mm256_loadu_pd(pdblA + i + 4), _mm256_loadu_pd(pdblB + i + 4)));
+	}
+	m256Sum0 = _mm256_add_pd(m256Sum0, m256Sum1);
+	m128Sum = _mm_add_pd(_mm256_castpd256_pd128(m256Sum0), _mm256_extractf128_pd(m256Sum0, 1));
+	dblSum = _mm_cvtsd_f64(_mm_add_sd(m128Sum, _mm_unpackhi_pd(m128Sum, m128Sum)));
+
+	// avoids the penalty of mixing 256-bit and legacy SSE instructions in the caller
+	_mm256_zeroupper();
+
+	for(; i < uintLength; i++)
+		dblSum += pdblA[i]*pdblB[i];
+
+	return dblSum;
+}
+
+SIMD_TARGET_AVX static void simd_ShortToDouble_AVX(const short * pshrSource, double * pdblDestination, unsigned int uintLength)
+{
+	__m128i			m128Samples, m128Low, m128High;
+	unsigned int	i;
+
+	for(i = 0; i + 8 <= uintLength; i += 8)
+	{
+		// sign-extend 8 x 16 bit to 2 x (4 x 32 bit), then convert 4 x 32 bit at a time
+		m128Samples = _mm_loadu_si128((const __m128i *) (pshrSource + i));
+		m128Low = _mm_srai_epi32(_mm_unpacklo_epi16(m128Samples, m128Samples), 16);
+		m128High = _mm_srai_epi32(_mm_unpackhi_epi16(m128Samples, m128Samples), 16);
+		_mm256_storeu_pd(pdblDestination + i, _mm256_cvtepi32_pd(m128Low));
+		_mm256_storeu_pd(pdblDestination + i + 4, _mm256_cvtepi32_pd(m128High));
+	}
+	_mm256_zeroupper();
+
+	for(; i < uintLength; i++)
+		pdblDestination[i] = (double) pshrSource[i];
+}
+
+SIMD_TARGET_AVX static void simd_WelfordUpdate_AVX(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength)
+{
+	__m256d			m256Sample, m256Mean, m256Delta, m256ReciprocalN;
+	unsigned int	i;
+
+	m256ReciprocalN = _mm256_set1_pd(dblReciprocalN);
+	for(i = 0; i + 4 <= uintLength; i += 4)
+	{
+		m256Sample = _mm256_loadu_pd(pdblSample + i);
+		m256Mean = _mm256_loadu_pd(pdblMean + i);
+		m256Delta = _mm256_sub_pd(m256Sample, m256Mean);
+		m256Mean = _mm256_add_pd(m256Mean, _mm256_mul_pd(m256Delta, m256ReciprocalN));
+		_mm256_storeu_pd(pdblMean + i, m256Mean);
+		_mm256_storeu_pd(pdblM2 + i, _mm256_add_pd(_mm256_loadu_pd(pdblM2 + i), _mm256_mul_pd(m256Delta, _mm256_sub_pd(m256Sample, m256Mean))));
+	}
+	_mm256_zeroupper();
+
+	simd_WelfordUpdate_Scalar(pdblSample + i, pdblMean + i, pdblM2 + i, dblReciprocalN, uintLength - i);
+}
+
+/**
+ * \brief Executes the CPUID instruction.
+ *
+ * \param[out]	intCPUInfo		EAX, EBX, ECX and EDX returned by the instruction
+ * \param[in]	intLeaf			leaf (value of EAX) to be queried
+ */
+static void simd_CPUID(int intCPUInfo[4], int intLeaf)
+{
+#ifdef _MSC_VER
+	__cpuid(intCPUInfo, intLeaf);
+#else
+	unsigned int uintEAX, uintEBX, uintECX, uintEDX;
+
+	uintEAX = uintEBX = uintECX = uintEDX = 0;
+	__cpuid_count(intLeaf, 0, uintEAX, uintEBX, uintECX, uintEDX);
+	intCPUInfo[0] = (int) uintEAX;
+	intCPUInfo[1] = (int) uintEBX;
+	intCPUInfo[2] = (int) uintECX;
+	intCPUInfo[3] = (int) uintEDX;
+#endif
+}
+
+/**
+ * \brief Reads the XCR0 register, i.e., the register states that the operating system saves on context switches.
+ *
+ * Must only be called if CPUID reports OSXSAVE.
+ */
+static unsigned int simd_GetXCR0(void)
+{
+#ifdef _MSC_VER
+	return (unsigned int) _xgetbv(0);
+#else
+	unsigned int uintEAX, uintEDX;
+
+	__asm__ __volatile__ ("xgetbv" : "=a" (uintEAX), "=d" (uintEDX) : "c" (0));
+	return uintEAX;
+#endif
+}
+
+/**
+ * \brief Points the kernel entry points at the implementations of an instruction set.
+ */
+static void simd_SelectKernels(SIMDLevel slLevel)
+{
+	m_slLevel = slLevel;
+	m_pfnDotProduct = mc_skKernels[slLevel].DotProduct;
+	m_pfnShortToDouble = mc_skKernels[slLevel].ShortToDouble;
+	m_pfnByteSum = mc_skKernels[slLevel].ByteSum;
+	m_pfnDecodeSamples = mc_skKernels[slLevel].DecodeSamples;
+	m_pfnWelfordUpdate = mc_skKernels[slLevel].WelfordUpdate;
+}
+
+/**
+ * \brief Computes the PSHUFB masks of simd_DecodeSamples_SSSE3().
+ *
+ * \return Nothing.
+ */
+static void simd_InitDeinterleaveMasks(void)
+{
+	BYTE			bytMask[16];
+	unsigned int	uintNChannels, uintWord, i, j, k;
+
+	for(uintNChannels = 1; uintNChannels <= SIMD_DECODE_MAX_CHANNELS; uintNChannels++)
+	{
+		for(k = 0; k < uintNChannels; k++)
+		{
+			for(j = 0; j < uintNChannels; j++)
+			{
+				// sample i of channel j is the word i*uintNChannels + j of the block
+				memset(bytMask, 0x80, sizeof(bytMask));
+				for(i = 0; i < 8; i++)
+				{
+					uintWord = i*uintNChannels + j;
+					if(uintWord/8 == k)
+					{
+						bytMask[2*i] = (BYTE) (2*(uintWord%8));
+						bytMask[2*i + 1] = (BYTE) (2*(uintWord%8) + 1);
+					}
+				}
+				m_m128DeinterleaveMasks[uintNChannels - 1][k][j] = _mm_loadu_si128((const __m128i *) bytMask);
+			}
+		}
+	}
+}
+
+/**
+ * \brief Checks a set of kernel implementations against the reference implementations.
+ *
+ * Integer sums and integer-to-floating-point conversions have to match exactly. Sums may only differ by the rounding caused by the
+ * different order of the additions, and the running statistics only by the precision of the intermediate results.
+ *
+ * \param[in]	pskKernels		kernels to be checked
+ * \return TRUE if all kernels produced the same results as the reference implementations, FALSE otherwise.
+ */
+static BOOL simd_SelfTest(const SIMDKernels * pskKernels)
+{
+	double			dblA[SIMD_SELFTEST_MAX_LENGTH], dblB[SIMD_SELFTEST_MAX_LENGTH];
+	double			dblReference[SIMD_SELFTEST_MAX_LENGTH], dblResult[SIMD_SELFTEST_MAX_LENGTH];
+	double			dblReferenceM2[SIMD_SELFTEST_MAX_LENGTH], dblResultM2[SIMD_SELFTEST_MAX_LENGTH];
+	double			dblExpected, dblActual, dblMagnitude;
+	short			shrSource[SIMD_SELFTEST_MAX_LENGTH];
+	short			shrDecodedReference[SIMD_DECODE_MAX_CHANNELS][SIMD_SELFTEST_MAX_LENGTH + 1], shrDecodedResult[SIMD_DECODE_MAX_CHANNELS][SIMD_SELFTEST_MAX_LENGTH + 1];
+	short *			ppshrDecodedReference[SIMD_DECODE_MAX_CHANNELS], * ppshrDecodedResult[SIMD_DECODE_MAX_CHANNELS];
+	WORD			wrdInterleaved[SIMD_DECODE_MAX_CHANNELS*SIMD_SELFTEST_MAX_LENGTH];
+	unsigned int	i, uintLength, uintNChannels, uintSeed;
+
+	// deterministic pseudo-random test vectors (full 16 bit range for the conversions)
+	uintSeed = 12345;
+	for(i = 0; i < SIMD_SELFTEST_MAX_LENGTH; i++)
+	{
+		uintSeed = uintSeed*1103515245 + 12345;
+		shrSource[i] = (short) (uintSeed >> 16);
+		dblA[i] = ((double) shrSource[i])/1000.0;
+		uintSeed = uintSeed*1103515245 + 12345;
+		dblB[i] = ((double) ((short) (uintSeed >> 16)))/32768.0;
+	}
+	for(i = 0; i < SIMD_DECODE_MAX_CHANNELS*SIMD_SELFTEST_MAX_LENGTH; i++)
+	{
+		uintSeed = uintSeed*1103515245 + 12345;
+		wrdInterleaved[i] = (WORD) (uintSeed >> 16);
+	}
+	for(i = 0; i < SIMD_DECODE_MAX_CHANNELS; i++)
+	{
+		ppshrDecodedReference[i] = shrDecodedReference[i];
+		ppshrDecodedResult[i] = shrDecodedResult[i];
+	}
+
+	for(uintLength = 0; uintLength <= SIMD_SELFTEST_MAX_LENGTH; uintLength++)
+	{
+		// dot product
+		dblExpected = simd_DotProduct_Scalar(dblA, dblB, uintLength);
+		dblActual = pskKernels->DotProduct(dblA, dblB, uintLength);
+		dblMagnitude = 0.0;
+		for(i = 0; i < uintLength; i++)
+			dblMagnitude += fabs(dblA[i]*dblB[i]);
+		if(fabs(dblActual - dblExpected) > SIMD_SELFTEST_TOLERANCE*dblMagnitude)
+			return FALSE;
+
+		// conversion (destination is also checked for writes past its end)
+		for(i = 0; i < SIMD_SELFTEST_MAX_LENGTH; i++)
+			dblReference[i] = dblResult[i] = -1.5;
+		simd_ShortToDouble_Scalar(shrSource, dblReference, uintLength);
+		pskKernels->ShortToDouble(shrSource, dblResult, uintLength);
+		for(i = 0; i < SIMD_SELFTEST_MAX_LENGTH; i++)
+		{
+			if(dblResult[i] != dblReference[i])
+				return FALSE;
+		}
+
+		// running mean and variance update (destinations are also checked for writes past their end)
+		for(i = 0; i < SIMD_SELFTEST_MAX_LENGTH; i++)
+		{
+			dblReference[i] = dblResult[i] = dblB[i];
+			dblReferenceM2[i] = dblResultM2[i] = fabs(dblA[i]);
+		}
+		simd_WelfordUpdate_Scalar(dblA, dblReference, dblReferenceM2, 1.0/3.0, uintLength);
+		pskKernels->WelfordUpdate(dblA, dblResult, dblResultM2, 1.0/3.0, uintLength);
+		for(i = 0; i < SIMD_SELFTEST_MAX_LENGTH; i++)
+		{
+			if(fabs(dblResult[i] - dblReference[i]) > SIMD_SELFTEST_TOLERANCE*(fabs(dblA[i]) + fabs(dblB[i])) ||
+			   fabs(dblResultM2[i] - dblReferenceM2[i]) > SIMD_SELFTEST_TOLERANCE*(fabs(dblReferenceM2[i]) + fabs(dblA[i])))
+				return FALSE;
+		}
+
+		// byte sum
+		if(pskKernels->ByteSum((const unsigned char *) shrSource, uintLength) != simd_ByteSum_Scalar((const unsigned char *) shrSource, uintLength))
+			return FALSE;
+
+		// packet decoding, for every channel count (stored at an odd index; destination is also checked for writes outside of the range)
+		for(uintNChannels = 1; uintNChannels <= SIMD_DECODE_MAX_CHANNELS; uintNChannels++)
+		{
+			memset(shrDecodedReference, 0x55, sizeof(shrDecodedReference));
+			memset(shrDecodedResult, 0x55, sizeof(shrDecodedResult));
+			simd_DecodeSamples_Scalar(wrdInterleaved, uintNChannels, uintLength, ppshrDecodedReference, 1);
+			pskKernels->DecodeSamples(wrdInterleaved, uintNChannels, uintLength, ppshrDecodedResult, 1);
+			if(memcmp(shrDecodedReference, shrDecodedResult, sizeof(shrDecodedResult)) != 0)
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+//---------------------------------------------------------------------------
+//   						Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Detects the instruction sets supported by the processor and selects the kernel implementations to be used.
+ *
+ * Function should be called once at startup, before any of the kernels are used by other threads.
+ *
+ * \return Instruction set of the selected kernels.
+ */
+SIMDLevel simd_init(void)
+{
+	BOOL	blnSupported[SIMDLevel_Count];
+	int		intCPUInfo[4], intLevel;
+
+	m_slMaxLevel = SIMDLevel_Scalar;
+	memset(blnSupported, 0, sizeof(blnSupported));
+	blnSupported[SIMDLevel_Scalar] = TRUE;
+
+	// CPUID leaf 1: feature flags
+	simd_CPUID(intCPUInfo, 0);
+	if(intCPUInfo[0] >= 1)
+	{
+		simd_CPUID(intCPUInfo, 1);
+		blnSupported[SIMDLevel_SSE2] = (intCPUInfo[3] & SIMD_CPUID_EDX_SSE2) != 0;
+		blnSupported[SIMDLevel_SSSE3] = (intCPUInfo[2] & SIMD_CPUID_ECX_SSSE3) != 0;
+
+		// AVX also requires the operating system to save the YMM registers
+		blnSupported[SIMDLevel_AVX] = (intCPUInfo[2] & SIMD_CPUID_ECX_AVX) && (intCPUInfo[2] & SIMD_CPUID_ECX_OSXSAVE) &&
+									  (simd_GetXCR0() & SIMD_XCR0_YMM) == SIMD_XCR0_YMM;
+	}
+
+	// each instruction set builds on the previous ones, so the first one that is missing or fails the self test ends the search
+	for(intLevel = SIMDLevel_SSE2; intLevel < SIMDLevel_Count && blnSupported[intLevel]; intLevel++)
+	{
+		if(intLevel == SIMDLevel_SSSE3)
+			simd_InitDeinterleaveMasks();
+
+		if(!simd_SelfTest(&mc_skKernels[intLevel]))
+		{
+			applog_logevent(SoftwareError, TEXT("SIMD"), TEXT("simd_init(): Kernels do not match the reference kernels (instruction set)."), intLevel, TRUE);
+			break;
+		}
+		m_slMaxLevel = (SIMDLevel) intLevel;
+	}
+	simd_SelectKernels(m_slMaxLevel);
+
+	applog_logevent(General, TEXT("SIMD"), TEXT("simd_init(): Selected kernel instruction set (0 = scalar, 1 = SSE2, 2 = SSSE3, 3 = AVX)"), (int) m_slLevel, TRUE);
+
+	return m_slLevel;
+}
+
+/**
+ * \brief Returns the instruction set of the kernels currently in use.
+ */
+SIMDLevel simd_GetLevel(void)
+{
+	return m_slLevel;
+}
+
+/**
+ * \brief Selects the kernels of an instruction set other than the fastest one, e.g., to compare the implementations.
+ *
+ * Like simd_init(), function must not be called while other threads use the kernels.
+ *
+ * \param[in]	slLevel		instruction set whose kernels are to be used
+ * \return TRUE if the kernels were selected, FALSE if the processor does not support the instruction set or its kernels
+ * failed the self test of simd_init().
+ */
+BOOL simd_SetLevel(SIMDLevel slLevel)
+{
+	if(slLevel < SIMDLevel_Scalar || slLevel > m_slMaxLevel)
+		return FALSE;
+
+	simd_SelectKernels(slLevel);
+
+	return TRUE;
+}
+
+/**
+ * \brief Computes the dot product of two vectors.
+ *
+ * \param[in]	pdblA		first vector
+ * \param[in]	pdblB		second vector
+ * \param[in]	uintLength	number of elements in each vector
+ *
+ * \return Sum of the element-wise products.
+ */
+double simd_DotProduct(const double * pdblA, const double * pdblB, unsigned int uintLength)
+{
+	return m_pfnDotProduct(pdblA, pdblB, uintLength);
+}
+
+/**
+ * \brief Converts a vector of 16 bit samples to double precision.
+ *
+ * \param[in]	pshrSource			samples to convert
+ * \param[out]	pdblDestination		buffer where the converted samples are to be stored
+ * \param[in]	uintLength			number of samples
+ */
+void simd_ShortToDouble(const short * pshrSource, double * pdblDestination, unsigned int uintLength)
+{
+	m_pfnShortToDouble(pshrSource, pdblDestination, uintLength);
+}
+
+/**
+ * \brief Adds up a vector of bytes.
+ *
+ * \param[in]	puchrData	bytes to add up
+ * \param[in]	uintLength	number of bytes
+ *
+ * \return Sum of the bytes.
+ */
+unsigned int simd_ByteSum(const unsigned char * puchrData, unsigned int uintLength)
+{
+	return m_pfnByteSum(puchrData, uintLength);
+}
+
+/**
+ * \brief Decodes the samples of a DATA packet into channel-major buffers.
+ *
+ * The packet stores the samples sample-major (all channels of the first sample, then all channels of the second one, ...)
+ * as offset-binary 16 bit values. Each channel is written, as two's complement, to its own buffer; the order of the channels
+ * in the output is given by ppshrDestination alone, so that callers can reorder channels without copying them.
+ *
+ * \param[in]	pwrdSource				interleaved samples (uintNChannels*uintNSamples values)
+ * \param[in]	uintNChannels			number of interleaved channels (1 - SIMD_DECODE_MAX_CHANNELS)
+ * \param[in]	uintNSamples			number of samples per channel
+ * \param[out]	ppshrDestination		one buffer per channel
+ * \param[in]	uintDestinationIndex	index, in each channel buffer, where the first sample is to be stored
+ */
+void simd_DecodeSamples(const WORD * pwrdSource, unsigned int uintNChannels, unsigned int uintNSamples, short * const * ppshrDestination, unsigned int uintDestinationIndex)
+{
+	m_pfnDecodeSamples(pwrdSource, uintNChannels, uintNSamples, ppshrDestination, uintDestinationIndex);
+}
+
+/**
+ * \brief Folds one observation per element into a running mean and sum of squared deviations (Welford's method).
+ *
+ * \param[in]		pdblSample		new observation of each element
+ * \param[in,out]	pdblMean		running mean of each element
+ * \param[in,out]	pdblM2			running sum of squared deviations from the mean of each element
+ * \param[in]		dblReciprocalN	1/n, where n is the number of observations including the new one
+ * \param[in]		uintLength		number of elements
+ */
+void simd_WelfordUpdate(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength)
+{
+	m_pfnWelfordUpdate(pdblSample, pdblMean, pdblM2, dblReciprocalN, uintLength);
+}
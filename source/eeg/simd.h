@@ -0,0 +1,51 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		simd.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that selects, at run time, the fastest implementation of the numeric kernels
+ *				supported by the processor.
+ *
+ * $Id$
+ */
+
+# ifndef __SIMD_H__
+# define __SIMD_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define SIMD_DECODE_MAX_CHANNELS		8			///< maximum number of interleaved channels accepted by simd_DecodeSamples()
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+/**
+ * Instruction sets for which the kernels are implemented.
+ */
+typedef enum {SIMDLevel_Scalar = 0,		///< portable C implementation (reference)
+			  SIMDLevel_SSE2 = 1,		///< 128-bit SSE2 implementation
+			  SIMDLevel_SSSE3 = 2,		///< SSE2 implementation plus SSSE3 byte shuffles (packet decoding)
+			  SIMDLevel_AVX = 3,		///< SSSE3 implementation plus 256-bit AVX floating-point kernels
+			  SIMDLevel_Count = 4		///< number of instruction sets
+} SIMDLevel;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+SIMDLevel		simd_init(void);
+SIMDLevel		simd_GetLevel(void);
+BOOL			simd_SetLevel(SIMDLevel slLevel);
+double			simd_DotProduct(const double * pdblA, const double * pdblB, unsigned int uintLength);
+void			simd_ShortToDouble(const short * pshrSource, double * pdblDestination, unsigned int uintLength);
+unsigned int	simd_ByteSum(const unsigned char * puchrData, unsigned int uintLength);
+void			simd_DecodeSamples(const WORD * pwrdSource, unsigned int uintNChannels, unsigned int uintNSamples, short * const * ppshrDestination, unsigned int uintDestinationIndex);
+void			simd_WelfordUpdate(const double * pdblSample, double * pdblMean, double * pdblM2, double dblReciprocalN, unsigned int uintLength);
+
+# endif
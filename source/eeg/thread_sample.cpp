@@ -4,7 +4,8 @@
  * \author		Andrei Jakab (andrei.jakab@tut.fi)
  * \version		1.0.0
  *
- * \brief		???
+ * \brief		Sample thread: acquires the data of the WEEG measurement device (or replays an EDF+ file in the Simulation
+ *				mode), assembles the EDF+ data records and hands them to the storage and streaming threads.
  *
  * $Id: thread_sample.cpp 78 2013-02-21 17:23:21Z jakab $
  */
@@ -26,24 +27,45 @@
 //							Libraries
 //---------------------------------------------------------------------------
 // Windows libraries
+#pragma comment(lib, "winmm.lib")
 
+// custom
+#pragma comment(lib, "libEDF.lib")
 
 //---------------------------------------------------------------------------
 //   						Includes
 //------------------------------------------------------------ ---------------
 // Windows libaries
 #include <windows.h>
+#include <mmsystem.h>
 
 // CRT libraries
+#include <stdio.h>
 #include <stdlib.h>
+#include <tchar.h>
+#include <time.h>
 
 // custom libraries
 #include <eegem_beep.h>
+#include <libEDF.h>
 
 // program headers
 #include "globals.h"
+#include "annotqueue.h"
 #include "applog.h"
+#include "capture.h"
+#include "clockdrift.h"
+#include "coherence.h"
+#include "edfPlus.h"
+#include "devices.h"
+#include "engine.h"
+#include "erp.h"
+#include "latency.h"
+#include "linkstats.h"
+#include "recpool.h"
+#include "samplering.h"
 #include "serialV4.h"
+#include "simd.h"
 #include "thread_storage.h"
 #include "thread_stream.h"
 #include "util.h"
@@ -57,6 +79,33 @@
 //   						Structs/Enums
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+//   						Constants
+//---------------------------------------------------------------------------
+const SampleDataRecord			mc_sdrEmpty = {NULL, 0, NULL, NULL};	///< empty SampleDataRecord struct used to initialize all variables of this type
+
+// Samples per sampled channel as a function of channel count,
+// i.e. when there are 6 sampled channels, one packet contains
+// 8 groups of 6 channels
+const int						mc_intSampleLengths [9] = {0, 50, 25, 16, 12, 10, 8, 7, 6};
+
+// number of valid packets that must be received from the measurement device
+// during the system check
+const unsigned int				mc_uintNTestPacketsRequired = 3;
+
+//---------------------------------------------------------------------------
+//   						Prototypes
+//---------------------------------------------------------------------------
+static BOOL			Sample_DetectedCommunicationFailure(SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd);
+static BOOL			Sample_FillGap(unsigned int uintNSamples, SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd);
+static BOOL			Sample_ProcessDataPacket (tPacket_DATA * ptpMeasurementData, DWORD dwrdArrivalTime, SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd);
+static BOOL			Sample_ReconnectLink(int intSamplingFrequency, SampleThreadData * pstd);
+static void			Sample_RecordingFSM(SampleThreadData * pstd);
+static void			Sample_SimulationFSM(SampleThreadData * pstd);
+static BOOL			Sample_StoreAndTransmitDataRecord(SampleDataRecord * pdrCurrentDataRecord, DWORD dwrdArrivalTime, SampleThreadData * pstd);
+static BOOL			Sample_TransmitCoherence(SampleThreadData * pstd);
+static void			Sample_WEEGSystemCheckFSM(SampleThreadData * pstd);
+
 //---------------------------------------------------------------------------
 //							Global variables
 //---------------------------------------------------------------------------
@@ -64,7 +113,1111 @@
 //---------------------------------------------------------------------------
 //							Internally-accessible functions
 //---------------------------------------------------------------------------
+/**
+ * \brief Points the signals of the measurement data at their place in the write buffer of a SampleDataRecord structure.
+ *
+ * \param[in]	pdrDataRecord			pointer to the SampleDataRecord structure
+ * \param[in]	intSamplingFrequency	frequency at which the EEG and acceleration signals are sampled
+ * \param[in]	uintNEEGChannels		number of EEG signals in the data record (i.e., number of measured EEG channels)
+ */
+static void Sample_PointSignals(SampleDataRecord * pdrDataRecord, int intSamplingFrequency, unsigned int uintNEEGChannels)
+{
+	unsigned int i;
+
+	for(i = 0; i < (uintNEEGChannels + ACCCHANNELS); i++)
+		pdrDataRecord->MeasurementData[i] = (short *) (pdrDataRecord->WriteBuffer + i * intSamplingFrequency * sizeof(short));
+}
+
+/**
+ * \brief Adds the 'Communication failure' annotation to the data record when a communication failure occurs.
+ *
+ * When a communication failure occurs, this function is called. The first time it is called, a 'Communication failure' annotation
+ * containing a time stamp is added to the data record. The remainder of the the data record signal samples (both EEG and Gyro) are
+ * filled with a default value. Once this is done, the data record is immediately saved to the EDF+ file.
+ * On subsequent calls during a communication failure, this function returns without doing anything.
+ *
+ * \param[in]	pdrCurrentDataRecord	pointer to the SampleDataRecord structure where the measurement data of the current data record is being stored
+ * \param[in]	pstd					pointer to the SampleThreadData structure that was passed to the thread upon its creation by the CreateThread function
+ *
+ * \return TRUE if succesfull, FALSE otherwise.
+ */
+static BOOL Sample_DetectedCommunicationFailure(SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd)
+{
+	BOOL blnResult = TRUE;
+	int j;
+	unsigned int k;
+
+	// Check if communication blackout is already in progress
+	if(!pstd->CommunicationBlackout)
+	{
+		pstd->CommunicationBlackout = TRUE;
+		
+		// add annotation indicating that a communication failer has occured
+		Sample_InsertAnnotation(pstd, CommunicationFailure, -1);
+
+		// signal is no longer continuous so spectral estimates and averages have to start over
+		coh_reset();
+		erp_reset();
+		
+		// fill the data record with INVALID_DATA_SAMPLE samples
+		for(k = 0; k < (ACCCHANNELS + pstd->NEEGChannels); k++)
+		{
+			for(j = pstd->NSamplesDatarecord; j < pstd->pcfg->SamplingFrequency; j++)
+				pdrCurrentDataRecord->MeasurementData[k][j] = (k < ACCCHANNELS) ? INVALID_ACC_SAMPLE : INVALID_EEG_SAMPLE;
+		}
+
+		// store and transmit data record
+		pstd->NSamplesDatarecord = 0;
+		pstd->DataRecordHasGap = FALSE;
+		blnResult = Sample_StoreAndTransmitDataRecord(pdrCurrentDataRecord, 0, pstd);
+	}
+	
+	return blnResult;
+}
+
+/**
+ * \brief Fills a gap in the recorded signals with invalid samples.
+ *
+ * Used when the link to the WEEG coordinator has been re-established after the coordinator was unplugged: the gap is sized
+ * from the packets' time stamps, so the samples recorded after it stay aligned with the recording's time axis. Every data
+ * record that is completed by the gap is stored and transmitted.
+ *
+ * \param[in]	uintNSamples			number of samples (per signal) that are missing
+ * \param[in]	pdrCurrentDataRecord	pointer to the SampleDataRecord structure where the measurement data of the current data record is being stored
+ * \param[in]	pstd					pointer to the SampleThreadData structure that was passed to the thread upon its creation by the CreateThread function
+ *
+ * \return TRUE if succesfull, FALSE otherwise.
+ */
+static BOOL Sample_FillGap(unsigned int uintNSamples, SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd)
+{
+	BOOL blnResult = TRUE;
+	int j;
+	unsigned int k, uintNFilled;
+
+	// signal is no longer continuous so spectral estimates and averages have to start over
+	if(uintNSamples > 0)
+	{
+		coh_reset();
+		erp_reset();
+	}
+
+	for(; uintNSamples > 0 && blnResult; uintNSamples -= uintNFilled)
+	{
+		uintNFilled = min(uintNSamples, (unsigned int) (pstd->pcfg->SamplingFrequency - pstd->NSamplesDatarecord));
+		for(k = 0; k < (ACCCHANNELS + pstd->NEEGChannels); k++)
+		{
+			for(j = pstd->NSamplesDatarecord; j < pstd->NSamplesDatarecord + (int) uintNFilled; j++)
+				pdrCurrentDataRecord->MeasurementData[k][j] = (k < ACCCHANNELS) ? INVALID_ACC_SAMPLE : INVALID_EEG_SAMPLE;
+		}
+
+		pstd->NSamplesDatarecord += uintNFilled;
+		if(pstd->NSamplesDatarecord == pstd->pcfg->SamplingFrequency)
+		{
+			blnResult = Sample_StoreAndTransmitDataRecord(pdrCurrentDataRecord, 0, pstd);
+			pstd->NSamplesDatarecord = 0;
+		}
+	}
+
+	// the samples that follow the gap complete a record that must not be analyzed
+	pstd->DataRecordHasGap = (pstd->NSamplesDatarecord > 0);
+
+	return blnResult;
+}
+
+/**
+ * \brief 
+ *
+ * Handle received data: construct display buffer for the scope and store data to the file.
+ * If bInit is true, packet's number is stored and it is used to detect first skipped packets.
+ *
+ * \param[in]	Data
+ * \param[in]	DataLength
+ * \param[in]	ClusterSize
+ * \param[in]	bInit
+ * \return ... 
+ */
+static BOOL Sample_ProcessDataPacket (tPacket_DATA * ptpMeasurementData, DWORD dwrdArrivalTime, SampleDataRecord * pdrCurrentDataRecord, SampleThreadData * pstd)
+{
+	BOOL			blnResult, blnNewCoherenceEpoch;
+	int				j, k;
+	short			shrAccelerometers[ACCCHANNELS];
+	unsigned int	uintNSamples, uintFirstSample, uintNDecoded, uintNDisplayed;
+
+	// variable initialization
+	blnResult = TRUE;
+	uintNSamples = pstd->NSamplesPerPacket;
+	for (k = 0; k < ACCCHANNELS; k++)
+		shrAccelerometers[k] = CAST_10b_US2S(ptpMeasurementData->Accelerometers[k]);
+		
+	// if a communication failure was in progress, insert anotation that
+	// comunication has now resumed
+	if(pstd->CommunicationBlackout)
+	{
+		pstd->CommunicationBlackout = FALSE;
+		Sample_InsertAnnotation(pstd, CommunicationResume, -1);
+	}
+
+	// check battery voltage
+	if(ptpMeasurementData->BatteryLevel <= 3600)
+		pstd->BatteryLow = TRUE;
+	else
+		pstd->BatteryLow = FALSE;
+
+	//
+	// decode the packet once, straight into the data record (which is also the storage and streaming buffer); a packet
+	// that completes the data record is split in two
+	//
+	for (uintFirstSample = 0; uintFirstSample < uintNSamples && blnResult; uintFirstSample += uintNDecoded)
+	{
+		uintNDecoded = min(uintNSamples - uintFirstSample, (unsigned int) (pstd->pcfg->SamplingFrequency - pstd->NSamplesDatarecord));
+
+		// EEG signals: the EEG part of MeasurementData is a view of the record in packet channel order (ascending channel number)
+		simd_DecodeSamples(ptpMeasurementData->Measurements + uintFirstSample*pstd->NEEGChannels, pstd->NEEGChannels, uintNDecoded,
+						   &pdrCurrentDataRecord->MeasurementData[ACCCHANNELS], pstd->NSamplesDatarecord);
+
+		// acceleration signals: one value per packet
+		for (k = 0; k < ACCCHANNELS; k++)
+		{
+			for (j = 0; j < (int) uintNDecoded; j++)
+				pdrCurrentDataRecord->MeasurementData[k][pstd->NSamplesDatarecord + j] = shrAccelerometers[k];
+		}
+
+		//
+		// hand the decoded samples to the display (display buffer stores all EEG channels first, with DC offset correction;
+		// the rows of the channels that are not measured stay zero)
+		//
+		// NOTE: if the display has fallen behind by a whole sample ring, the samples that do not fit are not displayed
+		// (they are still recorded)
+		if(pstd->DisplaySamples)
+		{
+			uintNDisplayed = samplering_BeginWrite(uintNDecoded);
+			for (k = 0; k < (int) pstd->NEEGChannels; k++)
+				samplering_WriteChannel(pstd->EEGChannelIDs[k], &pdrCurrentDataRecord->MeasurementData[ACCCHANNELS + k][pstd->NSamplesDatarecord], uintNDisplayed,
+										(short) pstd->pcfg->ChannelDCOffset[pstd->EEGChannelIDs[k]]);
+			for (k = 0; k < ACCCHANNELS; k++)
+				samplering_FillChannel(EEGCHANNELS + k, shrAccelerometers[k], uintNDisplayed);
+			samplering_EndWrite(uintNDisplayed);
+		}
+
+		//
+		// store and stream the data record once it is complete
+		//
+		pstd->NSamplesDatarecord += uintNDecoded;
+		if (pstd->NSamplesDatarecord == pstd->pcfg->SamplingFrequency)
+		{
+			// the analyses only see data records without gap-fill samples (the ERP ring detects the skipped record as a gap)
+			blnNewCoherenceEpoch = FALSE;
+			if(!pstd->DataRecordHasGap)
+			{
+				// update inter-channel coherence with the EEG signals of the completed data record
+				blnNewCoherenceEpoch = coh_AddSamples(&pdrCurrentDataRecord->MeasurementData[ACCCHANNELS], pstd->pcfg->SamplingFrequency);
+
+				// add data record to the event-related potential ring (index of its first sample is used to detect gaps)
+				erp_AddSamples(&pdrCurrentDataRecord->MeasurementData[ACCCHANNELS], pstd->pcfg->SamplingFrequency,
+							   ((unsigned long) pstd->NDataRecords)*pstd->pcfg->SamplingFrequency);
+			}
+			pstd->DataRecordHasGap = FALSE;
+
+			blnResult = Sample_StoreAndTransmitDataRecord(pdrCurrentDataRecord, dwrdArrivalTime, pstd);
+			pstd->NSamplesDatarecord = 0;
+
+			// stream the coherence of the data record right after the record (if enabled)
+			if(blnNewCoherenceEpoch && pstd->pcfg->Streaming_Enabled && pstd->pcfg->Streaming_Coherence)
+				Sample_TransmitCoherence(pstd);
+		}
+	}
+
+	// the whole packet becomes visible to the display at once
+	if(pstd->DisplaySamples)
+	{
+		samplering_Publish();
+		latency_Defer(LatencyStage_Display, dwrdArrivalTime);
+	}
+	latency_Record(LatencyStage_Processing, dwrdArrivalTime);
+	
+	return blnResult;
+} 
+
+/**
+ * \brief Adds current data record to the write queue of the storage thread and the transmission queue of the streaming thread.
+ *
+ * \param[in]	pdrCurrentDataRecord	
+ * \param[in]	dwrdArrivalTime			time at which the packet that completed the data record was received (see latency_Now(); 0 if not measured)
+ * \param[in]	pstd					
+ *
+ * \return TRUE if successsfull, FALSE otherwise. 
+ */
+static BOOL Sample_StoreAndTransmitDataRecord(SampleDataRecord * pdrCurrentDataRecord, DWORD dwrdArrivalTime, SampleThreadData * pstd)
+{
+	BOOL			blnResult = FALSE;
+	
+	//
+	// complete the WriteBuffer (the signals of MeasurementData are already stored in it)
+	//
+	// annotations: time-keeping TAL and the queued annotations that fit (the others are carried over to the next record)
+	annotqueue_Pack((char *) &pdrCurrentDataRecord->WriteBuffer[(pstd->NEEGChannels + ACCCHANNELS) * pstd->pcfg->SamplingFrequency * sizeof(short)],
+					ANNOTATION_TOTAL_NCHARS*sizeof(char), pstd->TimeKeepingTAL);
+	pstd->TimeKeepingTAL += EDFDURATIONOFRECORD;
+	pdrCurrentDataRecord->pBuffer->ArrivalTime = dwrdArrivalTime;
+	latency_Record(LatencyStage_Sealing, dwrdArrivalTime);
+
+	//
+	// send data record to storage thread (the storage and streaming threads share the record's buffer instead of copying it)
+	//
+	blnResult = Storage_AddToQueue(pstd->pStorageSession, pdrCurrentDataRecord->pBuffer, FALSE, pstd->hevStorageThread_Write);
+	latency_Record(LatencyStage_StorageQueue, dwrdArrivalTime);
+
+	//
+	// send data record to streaming thread (if enabled)
+	//
+	if(pstd->pcfg->Streaming_Enabled)
+	{
+		// send data record
+		if(!Streaming_SendPacket(pstd->pStreamingSession,
+								 EEGEMPacketType_EDFdr,
+							     pdrCurrentDataRecord->pBuffer,
+							     pstd->hevVortexClient_Transmit))
+		{
+			// log error
+			applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Sample_StoreAndTransmitDataRecord(): Unable to send packet to streaming server."), 0, TRUE);
+
+			// since connection was unsucessfull, disable streaming
+			pstd->pcfg->Streaming_Enabled = FALSE;
+		}
+		else
+			latency_Record(LatencyStage_StreamQueue, dwrdArrivalTime);
+	}
+
+	//
+	// assemble the next data record in a new buffer, since the threads may still be reading this one
+	//
+	if(!Sample_RenewDataRecord(pdrCurrentDataRecord, pstd->pcfg->SamplingFrequency, pstd->NEEGChannels))
+		blnResult = FALSE;
+
+	// Reset value of current samples in data record and increase amount of total data records
+	++pstd->NDataRecords;
+
+	return blnResult;
+}
+
+/**
+ * \brief Adds the inter-channel coherence of the last completed epoch to the transmission queue of the streaming thread.
+ *
+ * \param[in]	pstd	pointer to the SampleThreadData structure that was passed to the thread upon its creation by the CreateThread function
+ *
+ * \return TRUE if successsfull, FALSE otherwise.
+ */
+static BOOL Sample_TransmitCoherence(SampleThreadData * pstd)
+{
+	static CoherenceMatrix	cmMatrix;					// static since the matrices are too large for the stack of the thread
+	BOOL					blnResult = FALSE;
+	RecordBuffer *			prbPayload;
+
+	if(!coh_GetMatrix(&cmMatrix))
+		return FALSE;
+
+	prbPayload = recpool_Acquire(COH_SERIALIZED_LENGTH(cmMatrix.NPairs));
+	if(prbPayload != NULL)
+	{
+		coh_Serialize(&cmMatrix, prbPayload->Data, prbPayload->Length);
+		blnResult = Streaming_SendPacket(pstd->pStreamingSession, EEGEMPacketType_Coherence, prbPayload, pstd->hevVortexClient_Transmit);
+		recpool_Release(prbPayload);
+	}
+
+	if(!blnResult)
+		applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Sample_TransmitCoherence(): Unable to send coherence packet to streaming server."), 0, TRUE);
+
+	return blnResult;
+}
+
+static void Sample_SimulationFSM(SampleThreadData * pstd)
+{
+	// code for simulating the reception of data
+	BOOL					blnStayInFSM;
+	BOOL					blnStateErrorOccured;
+	EDFFileHandle *			hEDFFile;				///< handle to the EDF+ file used as input for the simulation mode
+	int						intDRIndex;				///< one-based index of the data record currently being read from the EDF+ file (i.e., index of first DR is 0)
+	int						i;
+	int						intSamplingFrequency;
+	LARGE_INTEGER			liCounter, liFrequency;
+	LARGE_INTEGER			liClockStart;			///< time at which the packet llngClockStartPacket was due
+	LARGE_INTEGER			liReplayStart, liLastStatus;
+	ledf_RetCode			rc;
+	LONGLONG				llngNPackets;			///< number of packets replayed
+	LONGLONG				llngClockStartPacket;	///< packet at which the pacing clock was (re)started
+	LONGLONG				llngDue, llngElapsed;	///< time, in us since liClockStart, at which the next packet is due and that has elapsed
+	long					lngNDataRecordsRead;	///< number of data records read from the EDF+ file
+	tPacket_DATA			tpdMeasurementData;
+	SampleDataRecord		drCurrentDataRecord;
+	SimulationModeData *	psmd;
+	SimulationModeState		smsState;
+	unsigned int			uintDRSampleCounter;	///< zero-based index indiciating sample being currently read from the data record
+	unsigned int			k;
+
+	// variable initialization
+	blnStayInFSM = TRUE;
+	drCurrentDataRecord = mc_sdrEmpty;
+	smsState = SimulationModeState_Initialize;
+	psmd = (SimulationModeData *) pstd->pModeData;
+	intSamplingFrequency = *(pstd->pSamplingFrequency);
+
+	while (blnStayInFSM)
+	{
+		switch (smsState)
+		{
+			case SimulationModeState_Initialize:
+				blnStateErrorOccured = FALSE;
+
+				// set event to signaled state
+				SetEvent(pstd->hevSampleThread_Init);
+
+				// check if simulation file has been loaded
+				if(strlen(psmd->strSimulationEDFFile) > 0)
+				{
+					hEDFFile = libEDF_openFile(psmd->strSimulationEDFFile);
+					if(hEDFFile == NULL)
+					{
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: Could not load EDF+ file."), 0, TRUE);
+						engine_ReportError(MB_ICONSTOP, TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: Could not load EDF+ file."), 0);
+						engine_Notify(EngineEvent_Stop, Stop_Abort, 0);
+						break;
+					}
+				}
+				else
+				{
+					applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: No simulation file loaded."), 0, TRUE);
+					engine_ReportError(MB_ICONERROR, TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: No simulation file loaded."));
+					engine_Notify(EngineEvent_Stop, Stop_Abort, 0);
+					break;
+				}
+
+				// initialize data record linked list
+				if(!Sample_InitDataRecord(&drCurrentDataRecord, intSamplingFrequency, pstd->NEEGChannels))
+				{
+					applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Initialize: Failed to initialize data record structure."), 0, TRUE);
+					engine_Notify(EngineEvent_Stop, Stop_Abort, 0);	// Force stop
+					blnStateErrorOccured = TRUE;
+				}
+				
+				if(!blnStateErrorOccured)
+				{
+					// the EEG channels were derived from the file's signal labels by engine_StartRecording(); the file must still hold them
+					if(hEDFFile->FileHeader.NSignalsPerDataRecord < (int) (ACCCHANNELS + pstd->NEEGChannels))
+					{
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SampleThreadState_Initialize: EDF+ file does not contain the replayed signals."), 0, TRUE);
+						engine_Notify(EngineEvent_Stop, Stop_Abort, 0);	// Force stop
+						blnStateErrorOccured = TRUE;
+					}
+				}
+
+				//
+				// state transition
+				//
+				if(blnStateErrorOccured)
+					smsState = SimulationModeState_CleanUp;
+				else
+					smsState = SimulationModeState_Acquire;
+			break;
+			
+			// Sampling state
+			case SimulationModeState_Acquire:
+				// simulate good battery level so that 'low battery' alarm doesn't get triggered
+				tpdMeasurementData.BatteryLevel = 4100;
+
+				// initialize DR sample coutner to the sampling frequency in order to trigger a read
+				uintDRSampleCounter = intSamplingFrequency;
+
+				// initilize data record index
+				intDRIndex = 0;
+				lngNDataRecordsRead = 0;
+
+				// the pacing clock gives each packet an absolute due time, so that the time spent processing a packet
+				// and the timer resolution do not accumulate
+				llngNPackets = llngClockStartPacket = 0;
+				QueryPerformanceFrequency(&liFrequency);
+				QueryPerformanceCounter(&liClockStart);
+				liReplayStart = liLastStatus = liClockStart;
+				if(psmd->SpeedPercent > 0)
+					timeBeginPeriod(1);
+
+				while(!pstd->EndActivity)
+				{
+					// when replaying as fast as possible, the file is only replayed once
+					if(psmd->SpeedPercent <= 0 && lngNDataRecordsRead == hEDFFile->FileHeader.NDataRecords && uintDRSampleCounter == intSamplingFrequency)
+					{
+						engine_Notify(EngineEvent_Stop, Stop_Normal, 0);
+						break;
+					}
+
+					//
+					// fill tPacket_DATA structure with data samples from EDFFileHandle structure
+					//
+					for(i = 0; i < pstd->NSamplesPerPacket; i++)
+					{
+						//
+						// if end of EDF+ data record has been reached, read new data record from EDF+ file
+						//
+						if(uintDRSampleCounter == intSamplingFrequency)
+						{
+							// if yes: reset reading indexes to beginning of next data record and read the next record
+							uintDRSampleCounter = 0;
+
+							// get data record from file
+							rc = libEDF_getDataRecord(hEDFFile, intDRIndex + 1);
+							if(rc != LEDF_OK)
+								applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Acquire: Could not read data record. (data record #)"), intDRIndex + 1, TRUE);
+
+							// increase data record index
+							intDRIndex = (intDRIndex + 1)%hEDFFile->FileHeader.NDataRecords;
+							lngNDataRecordsRead++;
+						}
+						
+						// transfer accelerometer and EEG signals but not the annotations signal
+						// (no easy way to transfer annotations from EDF+ being read to the one being stored); the file
+						// holds the replayed EEG channels in ascending order, right after the acceleration signals
+						tpdMeasurementData.Accelerometers[0] = CAST_10b_S2US(hEDFFile->DataRecord.Data[0][uintDRSampleCounter]);
+						tpdMeasurementData.Accelerometers[1] = CAST_10b_S2US(hEDFFile->DataRecord.Data[1][uintDRSampleCounter]);
+						tpdMeasurementData.Accelerometers[2] = CAST_10b_S2US(hEDFFile->DataRecord.Data[2][uintDRSampleCounter]);
+						for(k = 0; k < pstd->NEEGChannels; k++)
+							tpdMeasurementData.Measurements [pstd->NEEGChannels * i + k] = CAST_16b_S2US(hEDFFile->DataRecord.Data[ACCCHANNELS + k][uintDRSampleCounter]);
+
+						uintDRSampleCounter++;
+					}
+					
+					//
+					// wait until the packet is due
+					//
+					if(psmd->SpeedPercent > 0)
+					{
+						llngDue = (llngNPackets - llngClockStartPacket)*pstd->NSamplesPerPacket*100000000/((LONGLONG) intSamplingFrequency*psmd->SpeedPercent);
+						while(!pstd->EndActivity)
+						{
+							QueryPerformanceCounter(&liCounter);
+							llngElapsed = (liCounter.QuadPart - liClockStart.QuadPart)*1000000/liFrequency.QuadPart;
+							if(llngElapsed >= llngDue)
+							{
+								// restart the clock rather than sending a burst of packets after a long stall
+								if(llngElapsed - llngDue > SIMULATION_MAXLAG*1000)
+								{
+									liClockStart = liCounter;
+									llngClockStartPacket = llngNPackets;
+								}
+								break;
+							}
+
+							// sleep until shortly before the packet is due, then yield until it is
+							if(llngDue - llngElapsed > SIMULATION_SPINTIME*1000)
+								Sleep((DWORD) ((llngDue - llngElapsed)/1000) - SIMULATION_SPINTIME);
+							else
+								SwitchToThread();
+						}
+					}
+					else
+					{
+						// when replaying as fast as possible, the rate is limited by the Storage thread
+						while(!pstd->EndActivity && Storage_GetNQueuedRecords(pstd->pStorageSession) > SIMULATION_MAXQUEUEDRECORDS)
+							Sleep(1);
+					}
+
+					//
+					// send data to be processed
+					//
+					// the packet is stamped as if it had been received when it was due
+					Sample_ProcessDataPacket(&tpdMeasurementData, latency_Now(), &drCurrentDataRecord, pstd);
+					llngNPackets++;
+
+					//
+					// report progress (rate-limited; the GUI posts it to the main window, so that it never holds back the replay)
+					//
+					QueryPerformanceCounter(&liCounter);
+					if(liCounter.QuadPart - liLastStatus.QuadPart >= liFrequency.QuadPart*SIMULATION_STATUSPERIOD/1000)
+					{
+						engine_Notify(EngineEvent_ReplayStatus,
+									  (intDRIndex == 0) ? hEDFFile->FileHeader.NDataRecords : intDRIndex,
+									  (LPARAM) (lngNDataRecordsRead*liFrequency.QuadPart/(liCounter.QuadPart - liReplayStart.QuadPart)));
+						liLastStatus = liCounter;
+					}
+				}
+
+				if(psmd->SpeedPercent > 0)
+					timeEndPeriod(1);
+
+				// log sustained replay rate
+				QueryPerformanceCounter(&liCounter);
+				if(liCounter.QuadPart > liReplayStart.QuadPart)
+					applog_logevent(General, TEXT("SampleThread"), TEXT("Sample_SimulationFSM() - SimulationModeState_Acquire: Data records replayed per second."), (int) (lngNDataRecordsRead*liFrequency.QuadPart/(liCounter.QuadPart - liReplayStart.QuadPart)), TRUE);
+				
+				//
+				// state transition
+				//
+				smsState = SimulationModeState_CleanUp;
+			break;
+
+			case SimulationModeState_CleanUp:
+				if(hEDFFile != NULL)
+					libEDF_closeFile(hEDFFile);
+
+				Sample_FreeDataRecord(&drCurrentDataRecord);
+
+				blnStayInFSM = FALSE;
+			break;
+
+			default:
+				applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_SimulationFSM(): Unknown state reached."), 0, TRUE);
+				smsState = SimulationModeState_CleanUp;
+		}
+	}
+
+	return;
+}
+
+static void Sample_WEEGSystemCheckFSM(SampleThreadData * pstd)
+{
+	BOOL						blnErrorOccured;
+	BOOL						blnStayInFSM;
+	DWORD						dwReturnCode;
+	DWORD						dwrdLastPacketTime;
+	int							intNRetries;
+	int							intSamplingFrequency;
+	SerialProbeStatistics		spsProbeStatistics;
+	tReceivedData				trdReceivedData;
+	unsigned char				uchrNWEEGDevicesFound, uchrWEEGCOMPort;
+	unsigned int				uintNTestPackets;
+	WEEGSystemCheckModeState	wscmsState;
 
+	// variable initialization
+	pstd->CheckCode = WEEGSystem_OK;
+	blnStayInFSM = TRUE;
+	blnErrorOccured = FALSE;
+	intSamplingFrequency = *(pstd->pSamplingFrequency);
+	wscmsState = WEEGSystemCheckModeState_Stage1;
+
+	while(blnStayInFSM)
+	{
+		switch(wscmsState)
+		{
+			// Configuration of measurement device for testing state
+			case WEEGSystemCheckModeState_Stage1:
+				// variable init
+				intNRetries = 0;
+								
+				//
+				// find the WEEG coordinator's COM port, starting with the last port on which it was found (not needed when
+				// the link is run over another transport)
+				//
+				if(serial_GetTransport() == Transport_COMPort)
+				{
+					uchrNWEEGDevicesFound = serial_ProbeWEEGPort((unsigned char) (pstd->pcfg->COMPortIndex + 1), &uchrWEEGCOMPort, &spsProbeStatistics);
+					applog_logevent(General, TEXT("SampleThread"), TEXT("COM port probe: candidate ports"), spsProbeStatistics.NCandidates, TRUE);
+					applog_logevent(General, TEXT("SampleThread"), TEXT("COM port probe: enumeration time (us)"), spsProbeStatistics.EnumerationTime, TRUE);
+					applog_logevent(General, TEXT("SampleThread"), TEXT("COM port probe: probe time (us)"), spsProbeStatistics.ProbeTime, TRUE);
+					applog_logevent(General, TEXT("SampleThread"), TEXT("COM port probe: POLL round trip (us)"), spsProbeStatistics.ResponseTime, TRUE);
+					applog_logevent(General, TEXT("SampleThread"), TEXT("COM port probe: last known port answered"), spsProbeStatistics.PreferredResponded, TRUE);
+				}
+				else
+				{
+					uchrNWEEGDevicesFound = 1;
+					uchrWEEGCOMPort = (unsigned char) (pstd->pcfg->COMPortIndex + 1);
+				}
+				if(uchrNWEEGDevicesFound == 0)
+				{
+					// no port of the coordinator's driver at all, or ports on which the coordinator does not answer
+					pstd->CheckCode = (spsProbeStatistics.NCandidates == 0) ? WEEGSystem_COORD_DC : WEEGSystem_COORD_NA;
+					blnErrorOccured = TRUE;
+				}
+				else
+				{
+					pstd->pcfg->COMPortIndex = uchrWEEGCOMPort - 1;
+					
+					if(uchrNWEEGDevicesFound > 1)
+					{
+						pstd->CheckCode = WEEGSystem_COORD_NCOM;
+						blnErrorOccured = TRUE;
+					}
+				}
+				
+				//
+				// open serial communication port
+				//
+				if(!blnErrorOccured)
+				{
+					dwReturnCode = serial_OpenPort (pstd->pcfg->COMPortIndex + 1);
+					if(dwReturnCode != ERROR_SUCCESS)
+					{
+						pstd->CheckCode = WEEGSystem_COORD_COM;
+						blnErrorOccured = TRUE;
+					}
+				}
+
+				//
+				// configure WEEG system for measurement device test
+				// NOTE: even if this check succeeds, it doesn't mean that the WEEG measurment unit is on and recording
+				//
+				if(!blnErrorOccured)
+				{
+					dwReturnCode = serial_StartSampling((BYTE) (1 << pstd->pcfg->Link_PrimaryDevice), WEEG_NETNR, 0x00000000, pstd->EEGChannelMask, intSamplingFrequency);
+					if(dwReturnCode != ERROR_SUCCESS)
+					{
+						pstd->CheckCode = WEEGSystem_MEASDEV_CONFIG;
+						blnErrorOccured = TRUE;
+					}
+				}
+
+				//
+				// state transition
+				//
+				if(blnErrorOccured)
+					wscmsState = WEEGSystemCheckModeState_CleanUp;
+				else
+					wscmsState = WEEGSystemCheckModeState_Stage2;
+			break;
+
+			// Testing of measurement device state
+			case WEEGSystemCheckModeState_Stage2:
+				// variable initialization
+				uintNTestPackets = 0;
+				intNRetries = 0;
+				dwrdLastPacketTime = GetTickCount();
+				
+				SecureZeroMemory(&trdReceivedData, sizeof(trdReceivedData));
+				while((uintNTestPackets < mc_uintNTestPacketsRequired) && pstd->CheckCode == WEEGSystem_OK)
+				{
+					switch (serial_ReceivedDataStateMachine (&trdReceivedData))
+					{
+						case ERR_NOERROR:
+							dwrdLastPacketTime = GetTickCount(); intNRetries = 0;
+							
+							// check if packet is valid
+							if (trdReceivedData.PacketType == SER_DATA)
+								uintNTestPackets++;
+						break;
+													    
+
+						case ERR_NODATA:
+							// No packet received: block until the reader thread receives more data
+							serial_WaitForData(TRANSFER_WAIT);
+							
+							// check if timeout has occured (or the connection is gone, in which case no more packets can arrive)
+							if(GetTickCount() - dwrdLastPacketTime > TRANSFER_PACKWAIT || serial_IsLinkClosed())
+							{
+								// yes: set appropriate WEEGSystemCheckCode and quit testing
+								pstd->CheckCode = WEEGSystem_MEASDEV_TIMEOUT;
+								blnErrorOccured = TRUE;
+								break;
+							}
+						break;
+
+						case ERR_CHECKSUM:
+							intNRetries++;
+							
+							// check if max. number of checksum errors has been reached
+							if (intNRetries >= MAX_RETRIES)
+							{
+								// yes: set appropriate WEEGSystemCheckCode and quit testing
+								pstd->CheckCode = WEEGSystem_MEASDEV_CHECKSUM;
+								blnErrorOccured = TRUE;
+								break;													   
+							}
+						break;
+					}
+				}
+
+				//
+				// state transition
+				//
+				wscmsState = WEEGSystemCheckModeState_CleanUp;
+			break;
+
+			case WEEGSystemCheckModeState_CleanUp:
+				// stop the WEEG measurement device
+				serial_StopSampling();
+
+				// close serial prot
+				serial_ClosePort();
+				
+				// exit the WEEG system check FSM
+				blnStayInFSM = FALSE;
+			break;
+			
+			default:
+				applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_WEEGSystemCheckFSM(): Unknown state reached."), 0, TRUE);
+				wscmsState = WEEGSystemCheckModeState_CleanUp;
+		}
+	}
+}
+
+/**
+ * \brief Re-establishes the link to the WEEG coordinator after it has been unplugged, and restarts sampling.
+ *
+ * The coordinator may come back on another COM port, so its port is probed again (the port it was on is tried first).
+ *
+ * \param[in]	intSamplingFrequency	sampling frequency of the recording
+ * \param[in]	pstd					pointer to the SampleThreadData structure that was passed to the thread upon its creation by the CreateThread function
+ *
+ * \return TRUE if the coordinator is sampling again, FALSE otherwise (the port is then left closed).
+ */
+static BOOL Sample_ReconnectLink(int intSamplingFrequency, SampleThreadData * pstd)
+{
+	unsigned char uchrWEEGCOMPort;
+
+	if(serial_GetTransport() == Transport_COMPort)
+	{
+		if(serial_ProbeWEEGPort((unsigned char) (pstd->pcfg->COMPortIndex + 1), &uchrWEEGCOMPort, NULL) == 0)
+			return FALSE;
+		pstd->pcfg->COMPortIndex = uchrWEEGCOMPort - 1;
+	}
+
+	if(serial_OpenPort(pstd->pcfg->COMPortIndex + 1) != ERROR_SUCCESS)
+		return FALSE;
+
+	if(serial_StartSampling((BYTE) pstd->pcfg->Link_DeviceMask, WEEG_NETNR, 0x00000000, pstd->EEGChannelMask, intSamplingFrequency) != ERROR_SUCCESS)
+	{
+		serial_ClosePort();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void Sample_RecordingFSM(SampleThreadData * pstd)
+{
+	BOOL						blnLinkDown;
+	BOOL						blnLinkRestored;
+	BOOL						blnStayInFSM;
+	BOOL						blnStateErrorOccured;
+	DWORD						dwrdLastPacketTime, dwrdLinkLostPacketTime;
+	DWORD						dwrdLastTimeStamp;
+	DWORD						dwrdReturnCode;
+	DWORD						dwrdTimeStampGap, dwrdWallClockGap;
+	ClockDriftEstimate			cdeClockDrift;
+	int							intNRetries;
+	int							intSamplingFrequency;
+	RecordingModeState			rmsState;
+	SampleDataRecord			drCurrentDataRecord;
+	struct tm					tmStartDateTime;
+	TCHAR						strBuffer[256], strFilePathPrefix[MAX_PATH + 1], strFilePath[MAX_PATH + 1];
+	tPacket_DATA *				ptpMeasurementData;
+	tPacketView					tpvPackets[SERBUF_MAXPACKETS];
+	tReceivedData				trdReceivedData;
+	unsigned int				i, uintNPackets;
+	
+	// variable initialization
+	blnStayInFSM = TRUE;
+	drCurrentDataRecord = mc_sdrEmpty;
+	intSamplingFrequency = *(pstd->pSamplingFrequency);
+	rmsState = RecordingModeState_Initialize;
+
+	while(blnStayInFSM)
+	{
+		switch(rmsState)
+		{
+			case RecordingModeState_Initialize:
+				blnStateErrorOccured = FALSE;
+
+				// set event to signaled state
+				SetEvent(pstd->hevSampleThread_Init);
+
+				// initialize data record structure
+				if(!Sample_InitDataRecord(&drCurrentDataRecord, intSamplingFrequency, pstd->NEEGChannels))
+				{
+					applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Failed to initialize data record structure."), 0, TRUE);
+					engine_ReportError(MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Failed to initialize data record structure."));
+					engine_Notify(EngineEvent_Stop, Stop_Abort, 0);	// Force stop
+					blnStateErrorOccured = TRUE;
+				}
+				
+				// path and base name of the files that are recorded alongside the primary device's EDF+ file
+				tmStartDateTime = util_GetCurrentDateTime();
+				_stprintf_s(strFilePathPrefix,
+							sizeof(strFilePathPrefix)/sizeof(TCHAR),
+							TEXT("%s\\%4d.%02d.%02d %02d-%02d-%02d"),
+							pstd->pcfg->DestinationFolder,
+							tmStartDateTime.tm_year+1900, tmStartDateTime.tm_mon+1, tmStartDateTime.tm_mday,
+							tmStartDateTime.tm_hour, tmStartDateTime.tm_min, tmStartDateTime.tm_sec);
+
+				// start capturing the link's traffic (failure is not fatal: the recording itself is not affected)
+				if(!blnStateErrorOccured && pstd->pcfg->Link_Capture)
+				{
+					_stprintf_s(strFilePath, sizeof(strFilePath)/sizeof(TCHAR), TEXT("%s.cap"), strFilePathPrefix);
+					if(!capture_Open(strFilePath))
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Could not create link capture file. (GetLastError #)"), GetLastError(), TRUE);
+				}
+
+				// open the streams of the additional measurement devices (each one is stored in an EDF+ file of its own)
+				if(!blnStateErrorOccured && (pstd->pcfg->Link_DeviceMask & ~(1 << pstd->pcfg->Link_PrimaryDevice)))
+				{
+					if(!device_Open((BYTE) (pstd->pcfg->Link_DeviceMask & ~(1 << pstd->pcfg->Link_PrimaryDevice)),
+									strFilePathPrefix, *(pstd->pRecordingInfo), intSamplingFrequency, pstd->EEGChannelMask, pstd->pcfg->ElectrodeType,
+									(unsigned int) (pstd->pcfg->BaselineWindowTime*intSamplingFrequency/1000)))
+					{
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Could not open the streams of the additional measurement devices."), 0, TRUE);
+						engine_ReportError(MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Could not open the streams of the additional measurement devices."));
+						engine_Notify(EngineEvent_Stop, Stop_Abort, 0);	// Force stop
+						blnStateErrorOccured = TRUE;
+					}
+				}
+
+				// open serial communication port
+				if(!blnStateErrorOccured)
+				{
+					dwrdReturnCode = serial_OpenPort (pstd->pcfg->COMPortIndex + 1);
+					if(dwrdReturnCode != ERROR_SUCCESS)
+					{
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Could not open/configure WEEG COM port. (GetLastError #)"), dwrdReturnCode, TRUE);
+						engine_ReportError(MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Could not open/configure WEEG COM port. (GetLastError #%d)"), dwrdReturnCode);
+						engine_Notify(EngineEvent_Stop, Stop_Abort, 0);	// Force stop
+						blnStateErrorOccured = TRUE;
+					}
+				}
+
+				// check if configuration was successfull
+				if(!blnStateErrorOccured)
+				{
+					dwrdReturnCode = serial_StartSampling((BYTE) pstd->pcfg->Link_DeviceMask, WEEG_NETNR, 0x00000000, pstd->EEGChannelMask, intSamplingFrequency);
+					if(dwrdReturnCode != ERROR_SUCCESS)
+					{
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Unable to configure WEEG device and start recording."), 0, TRUE);
+						engine_ReportError(MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Initialize: Unable to configure WEEG device and start recording."));
+						engine_Notify(EngineEvent_Stop, Stop_Abort, 0);
+						blnStateErrorOccured = TRUE;
+					}
+				}
+
+				//
+				// state transition
+				//
+				if(blnStateErrorOccured)
+					rmsState = RecordingModeState_CleanUp;
+				else
+					rmsState = RecordingModeState_Acquire;
+			break;
+			
+			// Sampling state
+			case RecordingModeState_Acquire:
+				blnStateErrorOccured = FALSE;
+
+				// init variables for data aquisition state
+				SecureZeroMemory(&trdReceivedData, sizeof(trdReceivedData));
+				dwrdLastTimeStamp = 0x0000;
+				dwrdLastPacketTime = dwrdLinkLostPacketTime = GetTickCount(); intNRetries = 0;
+				blnLinkDown = blnLinkRestored = FALSE;
+					
+				// initialize statistics variables
+				pstd->NPacketsReceived = 0;
+				pstd->NPacketChecksumErrors = 0;
+				pstd->NPacketsLost = 0;
+				linkstats_Reset(pstd->NSamplesPerPacket);
+				clockdrift_Reset(intSamplingFrequency);
+
+				while(!(pstd->EndActivity))
+				{
+					//
+					// coordinator hot-plugging: the port of an unplugged coordinator (or a connection that the transport
+					// reports as closed, e.g. by the TCP peer) is dropped at once, and the link is re-established in the
+					// background (when the port re-appears, or else every TRANSFER_RECONNECT ms) while the recording goes on
+					//
+					if(!blnLinkDown && (pstd->CoordinatorRemoved || serial_IsLinkClosed()))
+					{
+						if(!pstd->CoordinatorRemoved)
+							applog_logevent(General, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Connection to the WEEG coordinator closed by the transport. (ms since last packet)"), GetTickCount() - dwrdLastPacketTime, TRUE);
+						serial_ClosePort();
+						ResetEvent(pstd->hevCoordinatorArrival);
+						blnLinkDown = TRUE;
+					}
+					if(blnLinkDown)
+					{
+						WaitForSingleObject(pstd->hevCoordinatorArrival, TRANSFER_RECONNECT);
+						if(!(pstd->EndActivity) && Sample_ReconnectLink(intSamplingFrequency, pstd))
+						{
+							InterlockedExchange(&pstd->CoordinatorRemoved, FALSE);
+							SecureZeroMemory(&trdReceivedData, sizeof(trdReceivedData));
+							blnLinkDown = FALSE;
+							blnLinkRestored = TRUE;
+							applog_logevent(General, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Link to the WEEG coordinator re-established. (ms since last packet)"), GetTickCount() - dwrdLastPacketTime, TRUE);
+
+							// the packet time-out starts over with the new link
+							dwrdLinkLostPacketTime = dwrdLastPacketTime;
+							dwrdLastPacketTime = GetTickCount();
+						}
+						continue;
+					}
+
+					// block until the reader thread has received new data (or until the exit flag has to be re-checked)
+					serial_WaitForData (TRANSFER_WAIT);
+					linkstats_SampleLink();
+
+					// frame all of the packets that have been received since the last round
+					while (!blnStateErrorOccured &&
+						   (uintNPackets = serial_ReceivePackets (&trdReceivedData, tpvPackets, SERBUF_MAXPACKETS)) > 0)
+					{
+						for(i = 0; i < uintNPackets && !blnStateErrorOccured; i++)
+						{
+							switch(tpvPackets[i].Result)
+							{
+								case ERR_NOERROR:
+									intNRetries = 0;		// Received valid packet?
+
+									if (tpvPackets[i].PacketType == SER_DATA)
+									{
+										ptpMeasurementData = (tPacket_DATA *) tpvPackets[i].PacketData;
+										latency_Record(LatencyStage_Framing, tpvPackets[i].ArrivalTime);
+
+										// packets of the additional measurement devices are processed by their own streams
+										if (ptpMeasurementData->DeviceNr != pstd->pcfg->Link_PrimaryDevice)
+										{
+											device_Dispatch (ptpMeasurementData);
+											break;
+										}
+
+										// first packet after the coordinator was plugged back in: fill the gap with invalid samples, sized
+										// from the time stamps (or from the elapsed time if the device has restarted its time stamps);
+										// if the packet time-out expired meanwhile, the data record has already been completed as for
+										// any other communication blackout
+										if(blnLinkRestored && !pstd->CommunicationBlackout)
+										{
+											if(pstd->NPacketsReceived > 0)
+											{
+												dwrdWallClockGap = (DWORD) (((ULONGLONG) (GetTickCount() - dwrdLinkLostPacketTime))*intSamplingFrequency/1000);
+												dwrdTimeStampGap = ptpMeasurementData->TimeStamp - dwrdLastTimeStamp;
+												if(ptpMeasurementData->TimeStamp <= dwrdLastTimeStamp || dwrdTimeStampGap > dwrdWallClockGap + intSamplingFrequency)
+												{
+													// the device clock has started over
+													dwrdTimeStampGap = dwrdWallClockGap;
+													clockdrift_Reset(intSamplingFrequency);
+												}
+												dwrdTimeStampGap = (dwrdTimeStampGap > (DWORD) pstd->NSamplesPerPacket) ? dwrdTimeStampGap - pstd->NSamplesPerPacket : 0;
+
+												pstd->NPacketsLost += dwrdTimeStampGap/pstd->NSamplesPerPacket;
+												if(!Sample_FillGap(dwrdTimeStampGap, &drCurrentDataRecord, pstd))
+												{
+													applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_NOERROR: Unable to store the data records of a coordinator gap."), 0, TRUE);
+													blnStateErrorOccured = TRUE;
+												}
+											}
+										}
+
+										// reset timeout (only the primary device's packets count, the other devices have time-outs of their own)
+										dwrdLastPacketTime = GetTickCount();
+										linkstats_AddPacket (ptpMeasurementData->TimeStamp, ptpMeasurementData->BatteryLevel);
+
+										// check the packet's time stamp (not for the first packet of a re-established link, see above)
+										if(pstd->NPacketsReceived > 0 && !blnLinkRestored)
+										{
+											if (ptpMeasurementData->TimeStamp <= dwrdLastTimeStamp)
+												break;
+											else if(ptpMeasurementData->TimeStamp > (dwrdLastTimeStamp + pstd->NSamplesPerPacket))
+											{
+												_stprintf_s(strBuffer,
+															sizeof(strBuffer)/sizeof(TCHAR),
+															TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_NOERROR: Packet Timestamp Error: was expecting %u, received %u."),
+															dwrdLastTimeStamp + pstd->NSamplesPerPacket,
+															ptpMeasurementData->TimeStamp);
+												applog_logevent(SoftwareError, TEXT("SampleThread"), strBuffer, 0, TRUE);
+												pstd->NPacketsLost += (ptpMeasurementData->TimeStamp - dwrdLastTimeStamp)/pstd->NSamplesPerPacket;
+											}
+										}
+										dwrdLastTimeStamp = ptpMeasurementData->TimeStamp;
+										blnLinkRestored = FALSE;
+
+										// the packet's first sample is the next sample of the recording
+										clockdrift_AddPacket(ptpMeasurementData->TimeStamp, ((LONGLONG) pstd->NDataRecords)*pstd->pcfg->SamplingFrequency + pstd->NSamplesDatarecord);
+								
+										pstd->NPacketsReceived++;
+								
+										// Ok, handle data
+										if (!Sample_ProcessDataPacket(ptpMeasurementData, tpvPackets[i].ArrivalTime, &drCurrentDataRecord, pstd))
+										{
+											applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_NOERROR: Unable to process and store data record."), 0, TRUE);
+											engine_ReportError(MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_NOERROR: Unable to process and store data record."));
+											blnStateErrorOccured = TRUE;
+										}
+									}
+								break;
+
+								case ERR_CHECKSUM:
+									intNRetries++;
+									pstd->NPacketChecksumErrors++;
+									linkstats_AddChecksumError();
+
+									if (intNRetries >= MAX_RETRIES)
+									{
+										applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_CHECKSUM: Measurement aborted due to high number of checksum errors."), 0, TRUE);
+										engine_ReportError(MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire - ERR_CHECKSUM: Measurement aborted due to high number of checksum errors."));
+										blnStateErrorOccured = TRUE;
+									}
+								break;
+
+								default:
+									applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: serial_ReceivePackets() returned unhandled SerialCommunicationResult."), 0, TRUE);
+							}
+						}
+					}
+					
+					// check if canceling of measurement is requested
+					if(blnStateErrorOccured)
+					{
+						// post cancel message to main thread
+						engine_Notify(EngineEvent_Stop, Stop_Cancel, 0);
+						break;
+					}
+					
+					// check if communication has timed out
+					if(GetTickCount() - dwrdLastPacketTime > TRANSFER_PACKWAIT)
+					{
+						if (!Sample_DetectedCommunicationFailure(&drCurrentDataRecord, pstd))
+						{
+							applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Unable to process and store communication blackout data record. (errno #)"), 0, TRUE);
+							engine_ReportError(MB_ICONSTOP, TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Unable to process and store communication blackout data record. (errno #%d)"), 0);
+						}
+					}
+				}
+
+				// store the link-quality telemetry alongside the recording
+				linkstats_SampleLink();
+				_stprintf_s(strFilePath, sizeof(strFilePath)/sizeof(TCHAR), TEXT("%s.link.txt"), strFilePathPrefix);
+				if(!linkstats_Dump(strFilePath))
+					applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Could not store link statistics. (errno #)"), errno, TRUE);
+
+				// store the latency histograms alongside the recording (if they were measured)
+				if(latency_IsEnabled())
+				{
+					_stprintf_s(strFilePath, sizeof(strFilePath)/sizeof(TCHAR), TEXT("%s.latency.csv"), strFilePathPrefix);
+					if(!latency_Dump(strFilePath))
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Could not store latency histograms. (errno #)"), errno, TRUE);
+				}
+
+				// log the final clock drift and latency estimates
+				clockdrift_Get(&cdeClockDrift);
+				if(cdeClockDrift.NBlocks >= 2)
+					applog_logevent(General, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Drift of the device clock. (ppb)"), (int) (cdeClockDrift.DriftPPM*1000), TRUE);
+				applog_logevent(General, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Mean packet latency above the minimum. (us)"), (int) (cdeClockDrift.MeanLatency*1000), TRUE);
+				applog_logevent(General, TEXT("SampleThread"), TEXT("Sample_RecordingFSM() - RecordingModeState_Acquire: Maximum packet latency above the minimum. (us)"), (int) (cdeClockDrift.MaxLatency*1000), TRUE);
+
+				//
+				// state transition
+				//
+				rmsState = RecordingModeState_CleanUp;
+			break;
+
+			case RecordingModeState_CleanUp:
+				serial_StopSampling();
+
+				serial_ClosePort();
+
+				device_Close();
+
+				capture_Close();
+
+				Sample_FreeDataRecord(&drCurrentDataRecord);
+
+				blnStayInFSM = FALSE;
+			break;
+
+			default:
+				pstd->CurrentState = SampleThreadState_Idle;
+		}
+	}
+}
 
 //---------------------------------------------------------------------------
 //							Globally-accessible functions
@@ -76,17 +1229,25 @@
  */
 void Sample_FreeDataRecord(SampleDataRecord * pdrDataRecord)
 {	
+	// the signals are stored in the write buffer, MeasurementData only points into it
 	if(pdrDataRecord->MeasurementData != NULL)
-	{
-		if(pdrDataRecord->MeasurementData[0] != NULL)
-			free(pdrDataRecord->MeasurementData[0]);
-	
 		free(pdrDataRecord->MeasurementData);
-	}
 
-	// allocate memory for write buffer
-	if(pdrDataRecord->WriteBuffer != NULL)
-		free(pdrDataRecord->WriteBuffer);
+	// release write buffer (it goes back to the pool once the storage and streaming threads are done with it)
+	recpool_Release(pdrDataRecord->pBuffer);
+	pdrDataRecord->pBuffer = NULL;
+}
+
+/**
+ * \brief Returns the current state of the sample thread's main FSM.
+ *
+ * \param[in]	pstd	pointer to the SampleThreadData structure of the thread
+ *
+ * \return	A member of the SampleThreadState enumeration.
+ */
+SampleThreadState Sample_GetMainFSMState(SampleThreadData * pstd)
+{
+	return pstd->CurrentState;
 }
 
 /**
@@ -94,56 +1255,265 @@ void Sample_FreeDataRecord(SampleDataRecord * pdrDataRecord)
  *
  * \param[in]	pdrDataRecord			pointer to the SampleDataRecord structure to be initialized
  * \param[in]	intSamplingFrequency	frequency at which the EEG and acceleration signals are sampled
+ * \param[in]	uintNEEGChannels		number of EEG signals in the data record (i.e., number of measured EEG channels)
  *
  * \return TRUE if succesfull, FALSE otherwise.
  */
-BOOL Sample_InitDataRecord(SampleDataRecord * pdrDataRecord, int intSamplingFrequency)
+BOOL Sample_InitDataRecord(SampleDataRecord * pdrDataRecord, int intSamplingFrequency, unsigned int uintNEEGChannels)
 {
 	BOOL			blnResult = TRUE;
-	unsigned int	i;
 	
+	pdrDataRecord->MeasurementData = NULL;
+
 	//
-	// allocate memory for measurement data buffer
+	// take write buffer from the pool
 	//
-	pdrDataRecord->MeasurementData = (short **) malloc((EEGCHANNELS + ACCCHANNELS) * sizeof(short *));
-	if(pdrDataRecord->MeasurementData != NULL)
+	pdrDataRecord->WriteBufferLen = ((uintNEEGChannels + ACCCHANNELS) * intSamplingFrequency * sizeof(short)) + ANNOTATION_TOTAL_NCHARS*sizeof(char);
+	pdrDataRecord->pBuffer = recpool_Acquire(pdrDataRecord->WriteBufferLen);
+	if(pdrDataRecord->pBuffer != NULL)
 	{
-		pdrDataRecord->MeasurementData[0] = (short *) malloc((EEGCHANNELS + ACCCHANNELS) * intSamplingFrequency * sizeof(short));
-		if(pdrDataRecord->MeasurementData[0] != NULL)
-		{
-			SecureZeroMemory (pdrDataRecord->MeasurementData[0] , (EEGCHANNELS + ACCCHANNELS) * intSamplingFrequency * sizeof(short));
-
-			for(i = 1; i < (EEGCHANNELS + ACCCHANNELS); i++)
-				pdrDataRecord->MeasurementData[i] = pdrDataRecord->MeasurementData[0] + i * intSamplingFrequency;
-		}
-		else
-		{
-			free(pdrDataRecord->MeasurementData);
-			applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_InitDataRecord(): Failed to allocate memory for the contents of the MeasurementData member of the EEGEMDataRecord structure. (errno #)"), errno, TRUE);
-			blnResult = FALSE;
-		}
+		pdrDataRecord->WriteBuffer = pdrDataRecord->pBuffer->Data;
+		SecureZeroMemory (pdrDataRecord->WriteBuffer, pdrDataRecord->WriteBufferLen);
 	}
 	else
 	{
-		applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_InitDataRecord(): Failed to allocate memory for the pointers of the MeasurementData member of the EEGEMDataRecord structure. (errno #)"), errno, TRUE);
+		pdrDataRecord->WriteBuffer = NULL;
+		applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_InitDataRecord(): Failed to allocate memory for the WriteBuffer member of the EEGEMDataRecord structure. (errno #)"), errno, TRUE);
 		blnResult = FALSE;
 	}
-	
+
 	//
-	// allocate memory for write buffer
+	// point the signals of the measurement data at their place in the write buffer (samples are decoded straight into the
+	// data record, so no copy is needed before it is stored or streamed)
 	//
 	if(blnResult)
 	{
-		pdrDataRecord->WriteBufferLen = ((EEGCHANNELS + ACCCHANNELS) * intSamplingFrequency * sizeof(short)) + ANNOTATION_TOTAL_NCHARS*sizeof(char);
-		pdrDataRecord->WriteBuffer = (BYTE *) malloc(pdrDataRecord->WriteBufferLen);
-		if(pdrDataRecord->WriteBuffer != NULL)
-			SecureZeroMemory (pdrDataRecord->WriteBuffer, ((EEGCHANNELS + ACCCHANNELS) * intSamplingFrequency * sizeof(short)) + ANNOTATION_TOTAL_NCHARS*sizeof(char));
+		pdrDataRecord->MeasurementData = (short **) malloc((uintNEEGChannels + ACCCHANNELS) * sizeof(short *));
+		if(pdrDataRecord->MeasurementData != NULL)
+			Sample_PointSignals(pdrDataRecord, intSamplingFrequency, uintNEEGChannels);
 		else
 		{
-			applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_InitDataRecord(): Failed to allocate memory for the WriteBuffer member of the EEGEMDataRecord structure. (errno #)"), errno, TRUE);
+			recpool_Release(pdrDataRecord->pBuffer);
+			pdrDataRecord->pBuffer = NULL;
+			pdrDataRecord->WriteBuffer = NULL;
+			applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_InitDataRecord(): Failed to allocate memory for the pointers of the MeasurementData member of the EEGEMDataRecord structure. (errno #)"), errno, TRUE);
 			blnResult = FALSE;
 		}
 	}
 
 	return blnResult;
-}
\ No newline at end of file
+}
+
+/**
+ * \brief Queues an annotation, with the index of the sample being recorded at the time the annotation was made, for the sample thread to store. 
+ *
+ * Function called either by the host (through engine_InsertAnnotation()) or by the sample thread; never waits for the sample thread.
+ *
+ * \param[in]	pstd				pointer to the SampleThreadData structure of the thread
+ * \param[in]	atAnnotationType	member of the AnnotationType enum indicating the type of annotation to be stored
+ * \param[in]	intAnnotationId		additional annotation-specific (depends on atAnnotationType)
+ */
+void Sample_InsertAnnotation(SampleThreadData * pstd, AnnotationType atAnnotationType, int intAnnotationId)
+{
+	char		strCAnnotation[ANNOTATION_MAX_CHARS + 1];	///< buffer that stores char version of the annotation
+	char		strTemp[ANNOTATION_MAX_CHARS + 1];			///< temporary buffer used for converting TCHAR annotations stored stored in the CONFIGURATION structure to char strings (+1 for terminating NULL character)
+	LONGLONG	llngOnsetSample;							///< sample at which the annotation was made
+	LONGLONG	llngDeviceSample;							///< sample being acquired according to the device clock (-1 if not known)
+	size_t		sztNCharsConverted;							///< amount of characters converted by the wcstombs_s() function
+	struct tm	tmCurrentDateTime;							///< stores current date and time
+
+	// Variable initialization
+	tmCurrentDateTime = util_GetCurrentDateTime();
+	strCAnnotation[0] = '\0';
+	llngOnsetSample = ((LONGLONG) pstd->NDataRecords)*pstd->pcfg->SamplingFrequency + pstd->NSamplesDatarecord;
+
+	//
+	// parse annotation string
+	//
+	switch(atAnnotationType)
+	{
+		case CommunicationFailure:
+			sprintf_s(strCAnnotation, _countof(strCAnnotation),
+					  "%02d:%02d:%02d Communication failure",
+					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec);
+		break;
+		
+		case CommunicationResume:
+			sprintf_s(strCAnnotation, _countof(strCAnnotation),
+					  "%02d:%02d:%02d Communication restart",
+					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec);
+		break;
+
+		case CoordinatorInserted:
+			sprintf_s(strCAnnotation, _countof(strCAnnotation),
+					  "%02d:%02d:%02d Coordinator plugged-in",
+					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec);
+		break;
+
+		case CoordinatorRemoved:
+			sprintf_s(strCAnnotation, _countof(strCAnnotation),
+					  "%02d:%02d:%02d Coordinator removed",
+					  tmCurrentDateTime.tm_hour, tmCurrentDateTime.tm_min, tmCurrentDateTime.tm_sec);
+		break;
+
+		case Now:
+			sprintf_s(strCAnnotation, _countof(strCAnnotation),
+					  "Now %d",
+					  ++pstd->NNowAnnotations);
+		break;
+
+		case Regular:
+			wcstombs_s(&sztNCharsConverted, strTemp, sizeof(strTemp), pstd->pcfg->Annotations[intAnnotationId], sizeof(strTemp));
+			sprintf_s(strCAnnotation, _countof(strCAnnotation),
+					  "%s",
+					  strTemp);
+		break;
+	}
+
+	// user-inserted annotations are placed at the sample that the device is acquiring according to its own clock, if
+	// requested; otherwise at the next sample to be added to the current data record
+	if((atAnnotationType == Now || atAnnotationType == Regular) && pstd->pcfg->Link_CorrectAnnotationOnsets)
+	{
+		llngDeviceSample = clockdrift_GetRecordSample();
+		if(llngDeviceSample >= 0)
+			llngOnsetSample = llngDeviceSample;
+	}
+
+	// the annotation types selected in the configuration (by default, the user-inserted ones) trigger the averaging of an
+	// event-related potential epoch
+	if(pstd->pcfg->ERP_TriggerMask & (1 << atAnnotationType))
+	{
+		if(!erp_AddTrigger((unsigned long) llngOnsetSample))
+			applog_logevent(General, TEXT("SampleThread"), TEXT("Sample_InsertAnnotation(): Unable to register ERP trigger."), 0, TRUE);
+	}
+
+	// hand the annotation to the sample thread, which stores it with the next data record that has room for it
+	if(!annotqueue_Push(llngOnsetSample, strCAnnotation))
+		applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_InsertAnnotation(): Annotation queue full, annotation dropped."), 0, TRUE);
+
+	// display annotation in status bar
+	engine_Notify(EngineEvent_Annotation, 0, (LPARAM) strCAnnotation);
+}
+
+/**
+ * \brief Moves a SampleDataRecord structure to a new pooled buffer, so that the next data record can be assembled while the
+ * storage and streaming threads still hold references to the buffer of the previous one.
+ *
+ * The contents of the new buffer are not initialized, since every sample and the annotation signal of a data record are
+ * written before it is stored.
+ *
+ * \param[in]	pdrDataRecord			pointer to the SampleDataRecord structure (initialized with Sample_InitDataRecord())
+ * \param[in]	intSamplingFrequency	frequency at which the EEG and acceleration signals are sampled
+ * \param[in]	uintNEEGChannels		number of EEG signals in the data record (i.e., number of measured EEG channels)
+ *
+ * \return TRUE if succesfull, FALSE otherwise (the data record keeps its current buffer).
+ */
+BOOL Sample_RenewDataRecord(SampleDataRecord * pdrDataRecord, int intSamplingFrequency, unsigned int uintNEEGChannels)
+{
+	RecordBuffer * prbBuffer;
+
+	prbBuffer = recpool_Acquire(pdrDataRecord->WriteBufferLen);
+	if(prbBuffer == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_RenewDataRecord(): Failed to take a new write buffer from the pool."), 0, TRUE);
+		return FALSE;
+	}
+
+	recpool_Release(pdrDataRecord->pBuffer);
+	pdrDataRecord->pBuffer = prbBuffer;
+	pdrDataRecord->WriteBuffer = prbBuffer->Data;
+	Sample_PointSignals(pdrDataRecord, intSamplingFrequency, uintNEEGChannels);
+
+	return TRUE;
+}
+
+/**
+ * \brief Selects the EEG channels that are measured during the next recording or system check.
+ *
+ * The WEEG device sends the selected channels in ascending order and fills each DATA packet with as many samples per
+ * channel as fit into it, so both the layout of the packets and that of the data records follow from the mask.
+ *
+ * \param[in]	pstd			pointer to the SampleThreadData structure of the thread
+ * \param[in]	bytChannelMask	EEG channels to be measured (bit n = channel n)
+ *
+ * \return Nothing.
+ */
+void Sample_SetEEGChannelMask(SampleThreadData * pstd, BYTE bytChannelMask)
+{
+	unsigned int i;
+
+	pstd->EEGChannelMask = bytChannelMask & MCHANNELMASK;
+	pstd->NEEGChannels = 0;
+	for(i = 0; i < EEGCHANNELS; i++)
+	{
+		if(pstd->EEGChannelMask & (0x01 << i))
+			pstd->EEGChannelIDs[pstd->NEEGChannels++] = i;
+	}
+	pstd->NSamplesPerPacket = mc_intSampleLengths[pstd->NEEGChannels];
+}
+
+/**
+ * \brief Function executed when sampling thread is created using the CreateThread function.
+ *
+ * \param[in]	lParam		pointer to the SampleThreadData structure of the thread (passed using the lpParameter parameter of the CreateThread function)
+ *
+ * \return Indicates success or failure of the function.
+ */
+long WINAPI Sample_Thread (LPARAM lParam)
+{
+	SampleThreadData *			pstd;
+
+	// local variable init
+	pstd = (SampleThreadData *) lParam;
+
+	while (1)
+	{
+		switch (pstd->CurrentState)
+		{
+			case SampleThreadState_Idle:
+				// signal that state machine is in Idle state and wait for Start event
+				SignalObjectAndWait(pstd->hevSampleThread_Idle, pstd->hevSampleThread_Start, INFINITE, FALSE);
+
+				//
+				// state transition
+				//
+				if(pstd->ExitThread)
+					return (0);
+
+				pstd->CurrentState = SampleThreadState_Working;
+			break;
+
+			case SampleThreadState_Working:
+				// check requested mode and pass control to the appropriate FSM
+				switch(pstd->Mode)
+				{
+					case SampleThreadMode_Recording:
+						Sample_RecordingFSM(pstd);
+					break;
+
+					case SampleThreadMode_WEEGSystemCheck:
+						Sample_WEEGSystemCheckFSM(pstd);
+					break;
+
+					case SampleThreadMode_Simulation:
+						Sample_SimulationFSM(pstd);
+					break;
+
+					case SampleThreadMode_WEEGDCCalibration:
+						/// TODO
+					break;
+
+					default:
+						applog_logevent(SoftwareError, TEXT("SampleThread"), TEXT("Sample_Thread(): Unknown sample thread mode detected."), 0, TRUE);
+				}
+
+				//
+				// state transition
+				//
+				pstd->CurrentState = SampleThreadState_Idle;
+			break;
+		}
+	}
+	
+	return (0);
+}
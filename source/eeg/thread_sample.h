@@ -14,6 +14,17 @@
 //---------------------------------------------------------------------------
 //   								Definitions
 //---------------------------------------------------------------------------
+# define SIMULATION_STATUSPERIOD			250						///< minimum time between two status updates of the Simulation mode, in ms
+# define SIMULATION_SPINTIME			2						///< time before a packet is due during which the Simulation mode yields instead of sleeping, in ms
+# define SIMULATION_MAXLAG				1000					///< lag, in ms, above which a paced replay restarts its clock instead of catching up
+# define SIMULATION_MAXQUEUEDRECORDS	64						///< number of data records waiting to be stored above which an unpaced replay waits for the Storage thread
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+// invalid data samples (used to fill the data records of communication blackouts)
+const short INVALID_ACC_SAMPLE	= 0x01FF;
+const short INVALID_EEG_SAMPLE = 0x7FFF;
 
 //---------------------------------------------------------------------------
 //   								Enums/Structs
@@ -64,6 +75,7 @@ typedef enum {SampleThreadState_Idle,						///< idle state
 typedef struct
 {
 	char	strSimulationEDFFile[MAX_PATH + 1];				///< stores the full path to the EDF+ used during simulation mode
+	int		SpeedPercent;									///< replay speed, in percent of real time (0 = as fast as possible; the file is then replayed once)
 } SimulationModeData;
 
 /**
@@ -72,20 +84,51 @@ typedef struct
 typedef struct
 {
 	BOOL						EndActivity;				///< 
-	GUIElements	*				pgui;						///< 
+	BOOL						ExitThread;					///< flag used for signaling that the Sampling thread should exit (checked when it leaves the Idle state)
 	SampleThreadMode			Mode;						///< mode in which the sampling thread is operating
 	void *						pModeData;					///< pointer to data structure neeeded by the operating mode specified in Mode
+	BOOL						DisplaySamples;				///< TRUE if the decoded samples are handed to the display through the sample ring
 
 	// pointers to configuration variables
 	int *						pSamplingFrequency;			///< pointer to variable containing the sampling frequency of the current recording
+	CONFIGURATION *				pcfg;						///< configuration of the program (the thread updates the WEEG COM port index and disables streaming on errors)
+	RecordingIdentification *	pRecordingInfo;				///< recording identification stored in the EDF+ files of the additional measurement devices
+
+	// measurement channels (fixed from the start of a recording to its end, see Sample_SetEEGChannelMask())
+	BYTE						EEGChannelMask;				///< EEG channels sent by the WEEG device (bit n = channel n)
+	unsigned int				NEEGChannels;				///< number of EEG signals in DATA packets and data records
+	unsigned int				EEGChannelIDs[EEGCHANNELS];	///< channel number of each EEG signal, in the order in which the signals are sent
+	int							NSamplesPerPacket;			///< number of samples per channel in a DATA packet
+
+	// state of the thread and of the current recording
+	volatile SampleThreadState	CurrentState;				///< state of the thread's main FSM
+	WEEGSystemCheckCode			CheckCode;					///< result of the last WEEG system check
+	int							NSamplesDatarecord;			///< number of samples in the current data record
+	int							NDataRecords;				///< number of data records completed since the start of the recording
+	BOOL						CommunicationBlackout;		///< TRUE while no packets are received from the WEEG measurement device
+	BOOL						DataRecordHasGap;			///< TRUE if the current data record contains samples that fill a gap
+	BOOL						BatteryLow;					///< TRUE if the battery of the WEEG measurement device is low
+	unsigned int				TimeKeepingTAL;				///< annotation time-stamp (onset of the current data record)
+	int							NNowAnnotations;			///< amount of 'Now' annotations since the start of the current recording
+
+	// statistics
+	long						NPacketsReceived;			///< number of packets received
+	long						NPacketChecksumErrors;		///< number of packets received with a wrong checksum
+	long						NPacketsLost;				///< number of packets lost
 	
 	// Handles belonging to the Sampling thread
 	HANDLE						hevSampleThread_Start;		///< event used to start the Sampling thread activity
 	HANDLE						hevSampleThread_Idle;		///< event that signals that the Sampling thread is in the Idle state
 	HANDLE						hevSampleThread_Init;		///< event that signals that the Sampling thread is in the Init state
+	HANDLE						hevCoordinatorArrival;		///< event that signals the Sampling thread that the WEEG coordinator's port has (re-)appeared
+
+	// WEEG coordinator hot-plugging
+	volatile LONG				CoordinatorRemoved;			///< set by the main thread when the WEEG coordinator is unplugged during a recording, cleared by the Sampling thread once it has re-established the link
 	
 	// Handles belonging to other threads
+	StorageSession *			pStorageSession;			///< session of the Storage thread that stores the data records
 	HANDLE						hevStorageThread_Write;		///< event that signals the Storage thread that there are records to be stored
+	StreamingSession *			pStreamingSession;			///< session of the Streaming thread that streams the data records
 	HANDLE						hevVortexClient_Transmit;	///< event that signals the Streaming thread that there are records to be streamed
 } SampleThreadData;
 
@@ -94,9 +137,10 @@ typedef struct
  */
 typedef struct
 {
-	BYTE *						WriteBuffer;			///< contains all of the signals of the EEGEM EDF+ data record, as they will be written to the EDF+ file
+	BYTE *						WriteBuffer;			///< contains all of the signals of the EEGEM EDF+ data record, as they will be written to the EDF+ file (Data of pBuffer)
 	unsigned int				WriteBufferLen;			///< size of WriteBuffer, in bytes
-	short **					MeasurementData;		///< 
+	short **					MeasurementData;		///< signals of the data record (acceleration X/Y/Z, then the measured EEG channels in ascending order); each one points to its place in WriteBuffer
+	RecordBuffer *				pBuffer;				///< pooled buffer in which the data record is assembled (the record holds one reference to it)
 } SampleDataRecord;
 
 //---------------------------------------------------------------------------
@@ -114,9 +158,57 @@ void Sample_FreeDataRecord(SampleDataRecord * pdrDataRecord);
  *
  * \param[in]	pdrDataRecord			pointer to the SampleDataRecord structure to be initialized
  * \param[in]	intSamplingFrequency	frequency at which the EEG and acceleration signals are sampled
+ * \param[in]	uintNEEGChannels		number of EEG signals in the data record (i.e., number of measured EEG channels)
  *
  * \return TRUE if succesfull, FALSE otherwise.
  */
-BOOL Sample_InitDataRecord(SampleDataRecord * pdrSamplingDataRecord, int intSamplingFrequency);
+BOOL Sample_InitDataRecord(SampleDataRecord * pdrSamplingDataRecord, int intSamplingFrequency, unsigned int uintNEEGChannels);
+
+/**
+ * \brief Returns the current state of the sample thread's main FSM.
+ *
+ * \param[in]	pstd	pointer to the SampleThreadData structure of the thread
+ *
+ * \return	A member of the SampleThreadState enumeration.
+ */
+SampleThreadState Sample_GetMainFSMState(SampleThreadData * pstd);
+
+/**
+ * \brief Queues an annotation, with the index of the sample being recorded at the time the annotation was made, for the sample thread to store.
+ *
+ * \param[in]	pstd				pointer to the SampleThreadData structure of the thread
+ * \param[in]	atAnnotationType	member of the AnnotationType enum indicating the type of annotation to be stored
+ * \param[in]	intAnnotationId		additional annotation-specific (depends on atAnnotationType)
+ */
+void Sample_InsertAnnotation(SampleThreadData * pstd, AnnotationType atAnnotationType, int intAnnotationId);
+
+/**
+ * \brief Moves a SampleDataRecord structure to a new pooled buffer, so that the next data record can be assembled while the
+ * storage and streaming threads still hold references to the buffer of the previous one.
+ *
+ * \param[in]	pdrDataRecord			pointer to the SampleDataRecord structure (initialized with Sample_InitDataRecord())
+ * \param[in]	intSamplingFrequency	frequency at which the EEG and acceleration signals are sampled
+ * \param[in]	uintNEEGChannels		number of EEG signals in the data record (i.e., number of measured EEG channels)
+ *
+ * \return TRUE if succesfull, FALSE otherwise (the data record keeps its current buffer).
+ */
+BOOL Sample_RenewDataRecord(SampleDataRecord * pdrDataRecord, int intSamplingFrequency, unsigned int uintNEEGChannels);
+
+/**
+ * \brief Selects the EEG channels that are measured during the next recording or system check.
+ *
+ * \param[in]	pstd			pointer to the SampleThreadData structure of the thread
+ * \param[in]	bytChannelMask	EEG channels to be measured (bit n = channel n)
+ */
+void Sample_SetEEGChannelMask(SampleThreadData * pstd, BYTE bytChannelMask);
+
+/**
+ * \brief Function executed when sampling thread is created using the CreateThread function.
+ *
+ * \param[in]	lParam		pointer to the SampleThreadData structure of the thread
+ *
+ * \return Indicates success or failure of the function.
+ */
+long WINAPI Sample_Thread (LPARAM lParam);
 
 #endif
\ No newline at end of file
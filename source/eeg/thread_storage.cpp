@@ -45,7 +45,10 @@
 #include "globals.h"
 #include "applog.h"
 #include "edfPlus.h"
+#include "engine.h"
+#include "latency.h"
 #include "linkedlist.h"
+#include "recpool.h"
 #include "thread_stream.h"
 #include "util.h"
 #include "thread_storage.h"
@@ -70,8 +73,7 @@
  */
 typedef struct
 {
-	BYTE *						WriteBuffer;						///< contains all of the signals of the EEGEM EDF+ data record, as they will be written to the EDF+ file
-	unsigned int				WriteBufferLen;						///< size of WriteBuffer, in bytes
+	RecordBuffer *				pRecord;							///< record, as it will be written to the EDF+ file (the storage thread holds one reference to it)
 	OVERLAPPED *				pOverlapped;						///< contains information needed for asynchronous writing of temporary EDF+ file
 } StorageDataRecord;
 # pragma pack (pop)	// restore original alignment from stack
@@ -87,16 +89,19 @@ typedef struct
 	unsigned int				NDataRecords;						///< counter that tracks number of data records that have been added to the write-pending linked list (i.e., total amount of recors that have been written to the file, including those for which I/O completion packets are pending)
 } EDFFileProperties;
 
-//---------------------------------------------------------------------------
-//							Global variables
-//---------------------------------------------------------------------------
-static EDFFileProperties		m_EDFFileProperties;				///< stores some properties of the EDF+ file that are needed by the storage thread
-static HANDLE					m_hEDFTempFile;						///< handle to the temporary EDF+ file
-static HANDLE					m_hIOCP;							///< handle for the I/O completion port associated with the temporary EDF+ file
-static linkedlist *				m_pllIOCompletionPending;			///< linked list for records that have been written but for which the I/O completion packet hasn't been received
-static linkedlist *				m_pllWritePending;					///< linked list for records that are to be written
-static StorageThreadState		m_stsStorageThreadState;			///< keeps track of the main FSM's state
-static TCHAR					m_strTempEDFFilePath[MAX_PATH + 1];	///< NULL-terminated string that stores the full path of the temporary EDF+ file
+/**
+ * State of a storage session: the EDF+ file being stored by one storage thread and the records waiting to be written to it.
+ */
+struct _StorageSession
+{
+	EDFFileProperties			EDFFileProperties;					///< stores some properties of the EDF+ file that are needed by the storage thread
+	HANDLE						hEDFTempFile;						///< handle to the temporary EDF+ file
+	HANDLE						hIOCP;								///< handle for the I/O completion port associated with the temporary EDF+ file
+	linkedlist *				pllIOCompletionPending;				///< linked list for records that have been written but for which the I/O completion packet hasn't been received
+	linkedlist *				pllWritePending;					///< linked list for records that are to be written
+	volatile StorageThreadState	State;								///< keeps track of the main FSM's state
+	TCHAR						strTempEDFFilePath[MAX_PATH + 1];	///< NULL-terminated string that stores the full path of the temporary EDF+ file
+};
 
 //---------------------------------------------------------------------------
 //							Internally-accessible functions
@@ -110,9 +115,8 @@ static void Storage_FreeDataRecord(StorageDataRecord * pdrDataRecord)
 {
 	if(pdrDataRecord != NULL)
 	{
-		// allocate memory for write buffer
-		if(pdrDataRecord->WriteBuffer != NULL)
-			free(pdrDataRecord->WriteBuffer);
+		// release the record (it goes back to the pool once the streaming thread is done with it as well)
+		recpool_Release(pdrDataRecord->pRecord);
 
 		// asynchronous IO structures
 		if(pdrDataRecord->pOverlapped != NULL)
@@ -125,11 +129,13 @@ static void Storage_FreeDataRecord(StorageDataRecord * pdrDataRecord)
 /**
  * \brief Generates a new variable of the StorageDataRecord type and initializes its memebers.
  *
+ * \param[in]	pss						storage session in whose EDF+ file the record will be stored
+ * \param[in]	prbRecord				record to be stored (a reference to it is taken)
  * \param[in]	blnHeaderRecord			TRUE if pdrDataRecord will be used to store a header record, FALSE otherwise
  *
  * \return Pointer to the initialized variable if succesfull, NULL otherwise.
  */
-StorageDataRecord * Storage_InitDataRecord(BOOL blnHeaderRecord)
+static StorageDataRecord * Storage_InitDataRecord(StorageSession * pss, RecordBuffer * prbRecord, BOOL blnHeaderRecord)
 {
 	BOOL					blnResult = TRUE;
 	StorageDataRecord *		pdrDataRecord;
@@ -145,22 +151,12 @@ StorageDataRecord * Storage_InitDataRecord(BOOL blnHeaderRecord)
 	}
 
 	//
-	// allocate memory for write buffer
+	// reference the record instead of copying it
 	//
 	if(blnResult)
 	{
-		if(blnHeaderRecord)
-			pdrDataRecord->WriteBufferLen = m_EDFFileProperties.HeaderRecordSize;
-		else
-			pdrDataRecord->WriteBufferLen = m_EDFFileProperties.DataRecordSize;
-		pdrDataRecord->WriteBuffer = (BYTE *) malloc(pdrDataRecord->WriteBufferLen);
-		if(pdrDataRecord->WriteBuffer == NULL)
-		{
-			applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_InitDataRecord(): Failed to allocate memory for the WriteBuffer member of the StorageDataRecord structure. (errno #)"), errno, TRUE);
-			blnResult = FALSE;
-		}
-		else
-			SecureZeroMemory (pdrDataRecord->WriteBuffer, pdrDataRecord->WriteBufferLen);
+		recpool_AddRef(prbRecord);
+		pdrDataRecord->pRecord = prbRecord;
 	}
 
 	//
@@ -185,7 +181,7 @@ StorageDataRecord * Storage_InitDataRecord(BOOL blnHeaderRecord)
 			else
 			{
 				// compute offset of data record based on the data that has already been written to the EDF+ file
-				pdrDataRecord->pOverlapped->Offset = m_EDFFileProperties.HeaderRecordSize + m_EDFFileProperties.NDataRecords*m_EDFFileProperties.DataRecordSize;
+				pdrDataRecord->pOverlapped->Offset = pss->EDFFileProperties.HeaderRecordSize + pss->EDFFileProperties.NDataRecords*pss->EDFFileProperties.DataRecordSize;
 			}
 			
 			// 'OffsetHigh' is not used since it is assumed that all EEGEM EDF+ files will be less than 4,294,967,295 bytes
@@ -205,11 +201,12 @@ StorageDataRecord * Storage_InitDataRecord(BOOL blnHeaderRecord)
 /**
  * \brief Handle I/O completion packets available at the compleiton port.
  *
+ * \param[in]	pss				storage session
  * \param[in]	dwrdTimeout		amount of time to wait for a completion packet to appear at the completion port, in milliseconds
  *
  * \return TRUE if function completes successfully, FALSE otherwise.
  */
-static BOOL Storage_ProcessIOPackets(DWORD dwrdTimeout)
+static BOOL Storage_ProcessIOPackets(StorageSession * pss, DWORD dwrdTimeout)
 {
 	BOOL					blnIOSuccess;			///< return value of the GetQueuedCompletionStatus() function
 	BOOL					blnResult = TRUE;		///< stores function return value
@@ -222,7 +219,7 @@ static BOOL Storage_ProcessIOPackets(DWORD dwrdTimeout)
 	while(1)
 	{
 		// attempt to unqueue an I/O completion packet
-		blnIOSuccess = GetQueuedCompletionStatus(m_hIOCP,					// handle to the I/O completion port
+		blnIOSuccess = GetQueuedCompletionStatus(pss->hIOCP,					// handle to the I/O completion port
 												 &dwrdNBytesTransferred,	// pointer to a variable that receives the number of bytes transferred during an I/O operation that has completed
 												 &ulngCompletionKey,		// pointer to a variable that receives the completion key value associated with the file handle whose I/O operation has completed
 												 (LPOVERLAPPED *) &pop,		// pointer to a variable that receives the address of the OVERLAPPED structure that was specified when the completed I/O operation was started
@@ -233,14 +230,14 @@ static BOOL Storage_ProcessIOPackets(DWORD dwrdTimeout)
 			//
 			// traverse 'I/O completion pending' linked list looking for record associated with the dequeued I/O completion packet
 			//
-			pli = m_pllIOCompletionPending->head;
+			pli = pss->pllIOCompletionPending->head;
 			while(pli != NULL)
 			{
 				pdrCurrentDataRecord = (StorageDataRecord *) pli->value;
 				if(pdrCurrentDataRecord->pOverlapped == pop)
 				{
 					// associated StorageDataRecord found: remove from linked list and break out of loop
-					linkedlist_remove_element(m_pllIOCompletionPending, pli);
+					linkedlist_remove_element(pss->pllIOCompletionPending, pli);
 					break;
 				}
 				else
@@ -255,6 +252,7 @@ static BOOL Storage_ProcessIOPackets(DWORD dwrdTimeout)
 				if(blnIOSuccess)
 				{
 					// completion packet represents a successfull I/O operation, free resources associated with storage data record structure
+					latency_Record(LatencyStage_DiskWrite, pdrCurrentDataRecord->pRecord->ArrivalTime);
 					Storage_FreeDataRecord(pdrCurrentDataRecord);
 				}
 				else
@@ -266,7 +264,7 @@ static BOOL Storage_ProcessIOPackets(DWORD dwrdTimeout)
 					applog_logevent(General, TEXT("Storage"), TEXT("Storage_ProcessIOPackets(): Failed completion packet dequeued from completion port. (GetLastError() #)"), GetLastError(), TRUE);
 
 					// add record to the 'write pending' linked list
-					if(!linkedlist_add_element(m_pllWritePending, pdrCurrentDataRecord))
+					if(!linkedlist_add_element(pss->pllWritePending, pdrCurrentDataRecord))
 					{
 						applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_ProcessIOPackets(): Failed to add record back to the write pending linked list."), 0, TRUE);
 						blnResult = FALSE;
@@ -294,11 +292,11 @@ static BOOL Storage_ProcessIOPackets(DWORD dwrdTimeout)
 /**
  * \brief Asynchronously write records present in the write pending linked list (up to MAX_NRECORDS_STORE are stored in one call).
  *
- * \param[in]	pstd		pointer to struct containing data passed to the storage thread by the main thread
+ * \param[in]	pss			storage session
  *
  * \return TRUE if function completes successfully, FALSE otherwise.
  */
-static BOOL Storage_WriteRecords(void)
+static BOOL Storage_WriteRecords(StorageSession * pss)
 {
 	BOOL					blnSuccess = TRUE;			///< stores function return value
 	StorageDataRecord *		pdrCurrentDataRecord;		///< 
@@ -307,13 +305,13 @@ static BOOL Storage_WriteRecords(void)
 	do
 	{
 		// get one element from write pending linked list
-		pdrCurrentDataRecord = (StorageDataRecord *) linkedlist_remove_headelement(m_pllWritePending);
+		pdrCurrentDataRecord = (StorageDataRecord *) linkedlist_remove_headelement(pss->pllWritePending);
 		if(pdrCurrentDataRecord != NULL)
 		{
 			// write it in the temporary EDF+ file
-			if(!WriteFile (m_hEDFTempFile,
-						   pdrCurrentDataRecord->WriteBuffer,
-						   pdrCurrentDataRecord->WriteBufferLen,
+			if(!WriteFile (pss->hEDFTempFile,
+						   pdrCurrentDataRecord->pRecord->Data,
+						   pdrCurrentDataRecord->pRecord->Length,
 						   NULL,
 						   pdrCurrentDataRecord->pOverlapped) && GetLastError() != ERROR_IO_PENDING)
 			{
@@ -323,10 +321,10 @@ static BOOL Storage_WriteRecords(void)
 				// if the WriteFile function has failed and the error code is not I/O pending,
 				// there may be too many outstanding asynchronous I/O requests (or some other exotic error may have occured);
 				// cancel all pending I/O operations and don't attempt to write any more data for now
-				CancelIo(m_hEDFTempFile);
+				CancelIo(pss->hEDFTempFile);
 
 				// add pdrCurrentDataRecord back to write pending liked list so that additional attempts can be made to write it
-				if(!linkedlist_add_element(m_pllWritePending, pdrCurrentDataRecord))
+				if(!linkedlist_add_element(pss->pllWritePending, pdrCurrentDataRecord))
 				{
 					applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_WriteRecords(): Unable to add record back to the write pending linked list."), 0, TRUE);
 					blnSuccess = FALSE;
@@ -337,7 +335,7 @@ static BOOL Storage_WriteRecords(void)
 			else
 			{
 				// if call to write function is successfull, add record to 'I/O completion pending' linked list
-				if(!linkedlist_add_element(m_pllIOCompletionPending, pdrCurrentDataRecord))
+				if(!linkedlist_add_element(pss->pllIOCompletionPending, pdrCurrentDataRecord))
 				{
 					applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_WriteRecords(): Unable to add record to the I/O completion pending linked list."), 0, TRUE);
 					blnSuccess = FALSE;
@@ -349,7 +347,7 @@ static BOOL Storage_WriteRecords(void)
 		}
 		else
 			break;
-	} while(m_pllWritePending->count > 0 && uintNWriteOperations < NWRITEOPERATIONS_MAX);
+	} while(pss->pllWritePending->count > 0 && uintNWriteOperations < NWRITEOPERATIONS_MAX);
 
 	return blnSuccess;
 }
@@ -357,30 +355,32 @@ static BOOL Storage_WriteRecords(void)
 /**
  * \brief Attempts to write all outstanding records.
  *
+ * \param[in]	pss			storage session
+ *
  * \return TRUE if function completes successfully, FALSE otherwise.
  */
-static BOOL Storage_CleanUp(void)
+static BOOL Storage_CleanUp(StorageSession * pss)
 {
 	unsigned int	uintNTries = 0;
 	
-	while((m_pllWritePending->count != 0 || m_pllIOCompletionPending->count != 0) && uintNTries < NCLEANUPATTEMPTS_MAX)
+	while((pss->pllWritePending->count != 0 || pss->pllIOCompletionPending->count != 0) && uintNTries < NCLEANUPATTEMPTS_MAX)
 	{
 		// write remaining records
-		if(m_pllWritePending->count > 0)
-			Storage_WriteRecords();
+		if(pss->pllWritePending->count > 0)
+			Storage_WriteRecords(pss);
 	
 		// flushes the buffers of the temporary file and causes all buffered data to be written to the disk
-		FlushFileBuffers(m_hEDFTempFile);
+		FlushFileBuffers(pss->hEDFTempFile);
 
 		// handle I/O completion packets
-		if(m_pllIOCompletionPending->count > 0)
-			Storage_ProcessIOPackets((uintNTries + 1)*IOPACKETTIMEOUT);
+		if(pss->pllIOCompletionPending->count > 0)
+			Storage_ProcessIOPackets(pss, (uintNTries + 1)*IOPACKETTIMEOUT);
 
 		uintNTries++;
 	}
 	
 	// check if function was succesfull
-	if(m_pllWritePending->count == 0 && m_pllIOCompletionPending->count == 0)
+	if(pss->pllWritePending->count == 0 && pss->pllIOCompletionPending->count == 0)
 		return TRUE;
 	else
 		return FALSE;
@@ -392,32 +392,30 @@ static BOOL Storage_CleanUp(void)
  /**
  * \brief Adds record to the write queue of the storage thread. Function executes in the execution context of the calling thread.
  *
- * \param[in]	bytRecord				pointer to BYTE array that stores the record to be stored in the EDF+ file
- * \param[in]	uintRecordLen			size of bytRecord array, in bytes
- * \param[in]	blnHeaderRecord			TRUE if bytRecord is a header record, FALSE otherwise
+ * The record is not copied: the storage thread holds a reference to it until it has been written.
+ *
+ * \param[in]	pss						storage session to which the record is to be added
+ * \param[in]	prbRecord				record to be stored in the EDF+ file (must not be modified once it has been added)
+ * \param[in]	blnHeaderRecord			TRUE if prbRecord is a header record, FALSE otherwise
  * \param[in]	hEvent					event to be signaled once record has been added to linked list
  */
-BOOL Storage_AddToQueue(BYTE * bytRecord, unsigned int uintRecordLen, BOOL blnHeaderRecord, HANDLE hEvent)
+BOOL Storage_AddToQueue(StorageSession * pss, RecordBuffer * prbRecord, BOOL blnHeaderRecord, HANDLE hEvent)
 {
 	BOOL blnResult;
 	StorageDataRecord * psdr;
 	
-	if(m_stsStorageThreadState == STS_Write || m_stsStorageThreadState == STS_ProcessIOCompletionPackets)
+	if(pss->State == STS_Write || pss->State == STS_ProcessIOCompletionPackets)
 	{
 		// create and initialize StorageDataRecord variable for record
-		psdr = Storage_InitDataRecord(blnHeaderRecord);
+		psdr = Storage_InitDataRecord(pss, prbRecord, blnHeaderRecord);
 		if(psdr != NULL)
 		{
-			// copy record to the StorageDataRecord variable
-			memcpy_s(psdr->WriteBuffer, psdr->WriteBufferLen,
-					 bytRecord, uintRecordLen);
-
 			// if record to be stored is not a header record, increase 'number of data records in EDF+ file' counter
 			if(!blnHeaderRecord)
-				m_EDFFileProperties.NDataRecords++;
+				pss->EDFFileProperties.NDataRecords++;
 
 			// add to write pending linked list
-			if(linkedlist_add_element(m_pllWritePending, psdr) == NULL)
+			if(linkedlist_add_element(pss->pllWritePending, psdr) == NULL)
 			{
 				Storage_FreeDataRecord(psdr);
 				applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_AddToQueue(): Failed to add record to the write pending linked list."), 0, TRUE);
@@ -439,21 +437,76 @@ BOOL Storage_AddToQueue(BYTE * bytRecord, unsigned int uintRecordLen, BOOL blnHe
 	}
 	else
 	{
-		applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_AddToQueue(): Failed to add record to write queue since Storage thread is not in the correct state. (StorageThreadState #)"), m_stsStorageThreadState, TRUE);
+		applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_AddToQueue(): Failed to add record to write queue since Storage thread is not in the correct state. (StorageThreadState #)"), pss->State, TRUE);
 		blnResult = FALSE;
 	}
 
 	return blnResult;
 }
 
+/**
+ * \brief Creates the state of a storage session.
+ *
+ * The session is passed to the storage thread in the pSession member of StorageThreadData.
+ *
+ * \return Pointer to the session if successful, NULL otherwise.
+ */
+StorageSession * Storage_CreateSession(void)
+{
+	StorageSession * pss;
+
+	pss = (StorageSession *) calloc(1, sizeof(StorageSession));
+	if(pss == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_CreateSession(): Failed to allocate memory for the StorageSession structure. (errno #)"), errno, TRUE);
+		return NULL;
+	}
+
+	pss->hEDFTempFile = INVALID_HANDLE_VALUE;
+	pss->State = STS_Idle;
+
+	return pss;
+}
+
+/**
+ * \brief Releases the state of a storage session.
+ *
+ * Must only be called once the storage thread of the session is no longer running.
+ *
+ * \param[in]	pss		storage session (can be NULL)
+ */
+void Storage_DestroySession(StorageSession * pss)
+{
+	if(pss != NULL)
+		free(pss);
+}
+
+/**
+ * \brief Returns the number of records that have been queued but not yet written to the EDF+ file.
+ *
+ * \param[in]	pss		storage session
+ *
+ * \return Number of records waiting to be written or for the completion of their write operation.
+ */
+unsigned int Storage_GetNQueuedRecords(StorageSession * pss)
+{
+	// the linked lists are only valid while records can be queued
+	if(pss->State == STS_Write || pss->State == STS_ProcessIOCompletionPackets)
+		return pss->pllWritePending->count + pss->pllIOCompletionPending->count;
+
+	return 0;
+}
+
 /**
  * \brief Returns the current state of the storage client's main FSM.
  *
+ * \param[in]	pss		storage session
+ *
  * \return	A member of the StorageThreadState enumeration.
  */
- StorageThreadState Storage_GetMainFSMState(void)
+ StorageThreadState Storage_GetMainFSMState(StorageSession * pss)
  {
-	 return m_stsStorageThreadState;
+	 return pss->State;
  }
 
 /**
@@ -462,14 +515,15 @@ BOOL Storage_AddToQueue(BYTE * bytRecord, unsigned int uintRecordLen, BOOL blnHe
  * This function can be called even after the Storage thread's main FSM has entered the STS_Idle state since
  * the variable that stores the temporary EDF+ file path is reset at the beginning of the STS_Init state.
  *
+ * \param[in]	pss				storage session
  * \param[in]	strBuffer		pointer to buffer where the path should be stored
  * \param[in]	uintBufferLen	size of strBuffer, in TCHARs
  *
  * \return	TRUE if the function completes successfully and strBuffer contains the file path, FALSE otherwise.
  */
- BOOL Storage_GetTemporaryEDFFilePath(TCHAR * strBuffer, unsigned int uintBufferLen)
+ BOOL Storage_GetTemporaryEDFFilePath(StorageSession * pss, TCHAR * strBuffer, unsigned int uintBufferLen)
  {
-	 size_t sztPathLength = _tcslen(m_strTempEDFFilePath);
+	 size_t sztPathLength = _tcslen(pss->strTempEDFFilePath);
 
 #ifdef _DEBUG
 	// make sure buffer is actually as long as advertised
@@ -485,7 +539,7 @@ BOOL Storage_AddToQueue(BYTE * bytRecord, unsigned int uintRecordLen, BOOL blnHe
 		// check if buffer has enough space to store the path and the terminating NULL-terminating character
 		if(uintBufferLen > sztPathLength)
 		{
-			_stprintf_s(strBuffer, uintBufferLen, TEXT("%s"), m_strTempEDFFilePath);
+			_stprintf_s(strBuffer, uintBufferLen, TEXT("%s"), pss->strTempEDFFilePath);
 			return TRUE;
 		}
 		else
@@ -505,24 +559,25 @@ long WINAPI Storage_Thread (LPARAM lParam)
 {
 	BOOL				blnStateErrorOccured;				///< indicates whether an error has occured in a given state
 	CONFIGURATION *		pcfg;								///< pointer to the CONFIGURATION struct of the main module
-	HWND				hwndMainWnd;						///< handle to the main application window
 	struct tm			tmCurrentDateTime;					///< variable that stores the current tmCurrentDateTime and time
+	StorageSession *	pss;								///< session stored by the thread
 	StorageThreadData *	pstd;								///< pointer to struct containing data passed to the storage thread by the main thread
 	TCHAR *				strMeasurementFolder;				///< NULL-terminated string that stores the full path of the folder where the recorded EDF+ files will be stored
 	TCHAR *				strTemp;							///< pointer used to store temporary strings
 	UINT64				lngpFreeBytesAvailable;				///< variable that receives the total number of free bytes on a disk that are available to the user who is associated with the calling thread
+	unsigned int		uintNEEGChannels;					///< number of EEG signals in the data records of the recording
 
 	// variable initialization
-	hwndMainWnd = FindWindow (WINDOW_CLASSID_MAIN, NULL);
 	pstd = (StorageThreadData *) lParam;
 	pcfg = pstd->pcfg;
+	pss = pstd->pSession;
 	strMeasurementFolder = NULL;
-	m_stsStorageThreadState = STS_Idle;
-	m_strTempEDFFilePath[0] = L'\0';
+	pss->State = STS_Idle;
+	pss->strTempEDFFilePath[0] = L'\0';
 
 	while (1)
 	{
-		switch(m_stsStorageThreadState)
+		switch(pss->State)
 		{
 			case STS_Idle:
 				blnStateErrorOccured = FALSE;
@@ -533,7 +588,10 @@ long WINAPI Storage_Thread (LPARAM lParam)
 				//
 				// state transition
 				//
-				m_stsStorageThreadState = STS_Init;
+				if(pstd->ExitThread)
+					return (0);
+
+				pss->State = STS_Init;
 			break;
 
 			case STS_Init:
@@ -542,14 +600,15 @@ long WINAPI Storage_Thread (LPARAM lParam)
 				//
 				// initialize global variables
 				// 
-				m_EDFFileProperties.SamplingFrequency = pcfg->SamplingFrequency;
-				m_EDFFileProperties.DataRecordSize = ((EEGCHANNELS + ACCCHANNELS) * m_EDFFileProperties.SamplingFrequency * sizeof(short)) + ANNOTATION_TOTAL_NCHARS*sizeof(char);
-				m_EDFFileProperties.HeaderRecordSize = EDFFILEHEADERLENGTH + EDFSIGNALHEADERLENGTH*(EEGCHANNELS + ACCCHANNELS + 1);		// +1 for the annotations channel
-				m_EDFFileProperties.NDataRecords = 0;
-				m_hEDFTempFile = INVALID_HANDLE_VALUE;
-				m_hIOCP = NULL;
-				m_pllIOCompletionPending = m_pllWritePending = NULL;
-				m_strTempEDFFilePath[0] = L'\0';
+				pss->EDFFileProperties.SamplingFrequency = pcfg->SamplingFrequency;
+				uintNEEGChannels = util_GetNOfSelectedChannels(pcfg->DisplayChannelMask);
+				pss->EDFFileProperties.DataRecordSize = ((uintNEEGChannels + ACCCHANNELS) * pss->EDFFileProperties.SamplingFrequency * sizeof(short)) + ANNOTATION_TOTAL_NCHARS*sizeof(char);
+				pss->EDFFileProperties.HeaderRecordSize = EDFFILEHEADERLENGTH + EDFSIGNALHEADERLENGTH*(uintNEEGChannels + ACCCHANNELS + 1);		// +1 for the annotations channel
+				pss->EDFFileProperties.NDataRecords = 0;
+				pss->hEDFTempFile = INVALID_HANDLE_VALUE;
+				pss->hIOCP = NULL;
+				pss->pllIOCompletionPending = pss->pllWritePending = NULL;
+				pss->strTempEDFFilePath[0] = L'\0';
 
 				//
 				// initialize local variables
@@ -567,21 +626,21 @@ long WINAPI Storage_Thread (LPARAM lParam)
 						if(lngpFreeBytesAvailable < MIN_AVAILABLE_DISK_SPACE)
 						{
 							applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Insufficient HDD space available for recording."), 0, TRUE);
-							MsgPrintf (hwndMainWnd, 0, TEXT("Storage_Thread() - STS_Init: Insufficient HDD space available for recording.\nPlease free some space and try again."));
+							engine_ReportError(0, TEXT("Storage_Thread() - STS_Init: Insufficient HDD space available for recording.\nPlease free some space and try again."));
 							blnStateErrorOccured = TRUE;
 						}
 					}
 					else
 					{
 						applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to determine HDD space available for recording. (GetLastError #)"), GetLastError(), TRUE);
-						MsgPrintf (hwndMainWnd, 0, TEXT("Storage_Thread() - STS_Init: Unable to determine HDD space available for recording. (GetLastError #%d)!"), GetLastError());
+						engine_ReportError(0, TEXT("Storage_Thread() - STS_Init: Unable to determine HDD space available for recording. (GetLastError #%d)!"), GetLastError());
 						blnStateErrorOccured = TRUE;
 					}
 				}
 				else
 				{
 					applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to determine existance of destination folder. (GetLastError #)"), GetLastError(), TRUE);
-					MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to determine existance of destination folder. (GetLastError #)"), GetLastError());
+					engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to determine existance of destination folder. (GetLastError #)"), GetLastError());
 					blnStateErrorOccured = TRUE;
 				}
 				
@@ -605,14 +664,14 @@ long WINAPI Storage_Thread (LPARAM lParam)
 						if((CreateDirectory(strMeasurementFolder, NULL) == FALSE) && (GetLastError() != ERROR_ALREADY_EXISTS))
 						{
 							applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to create measurement folder for today's date. (GetLastError #)"), GetLastError(), TRUE);
-							MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create measurement folder for today's date. (GetLastError #%d).\nPlease make sure you have full read & write privileges for the destination folder."), GetLastError());
+							engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create measurement folder for today's date. (GetLastError #%d).\nPlease make sure you have full read & write privileges for the destination folder."), GetLastError());
 							blnStateErrorOccured = TRUE;
 						}
 					}
 					else
 					{
 						applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to allocate memory for string buffer. (errno #)"), errno, TRUE);
-						MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to allocate memory for string buffer. (errno #%d)."), errno);
+						engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to allocate memory for string buffer. (errno #%d)."), errno);
 						blnStateErrorOccured = TRUE;
 					}
 				}
@@ -630,17 +689,17 @@ long WINAPI Storage_Thread (LPARAM lParam)
 							_tcsncpy_s(strTemp, TMPFILE_PRFX_LEN + 1, FILEPREFIX, TMPFILE_PRFX_LEN);
 
 						// create unique temporary filename in given destination path
-						if (GetTempFileName(strMeasurementFolder, strTemp, 0, m_strTempEDFFilePath) == 0)
+						if (GetTempFileName(strMeasurementFolder, strTemp, 0, pss->strTempEDFFilePath) == 0)
 						{
 							applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to obtain unique temporary file name. (GetLastError #)"), GetLastError(), TRUE);
-							MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to obtain unique temporary file name. (GetLastError #%d)"), GetLastError());
+							engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to obtain unique temporary file name. (GetLastError #%d)"), GetLastError());
 							blnStateErrorOccured = TRUE;
 						}
 					}
 					else
 					{
 						applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to allocate memory for temporary string buffer. (errno #)"), errno, TRUE);
-						MsgPrintf (hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to allocate memory for temporary string buffer. (errno #%d)."), errno);
+						engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to allocate memory for temporary string buffer. (errno #%d)."), errno);
 						blnStateErrorOccured = TRUE;
 					}
 				}
@@ -651,27 +710,27 @@ long WINAPI Storage_Thread (LPARAM lParam)
 				if(!blnStateErrorOccured)
 				{
 					// Create the new file to write the upper-case version to.
-					m_hEDFTempFile = CreateFile((LPTSTR) m_strTempEDFFilePath,
+					pss->hEDFTempFile = CreateFile((LPTSTR) pss->strTempEDFFilePath,
 												GENERIC_READ | GENERIC_WRITE,					// R/W rights (no execute)
 												0,												// don't share file
 												NULL,											// default security descriptor
 												CREATE_ALWAYS,									// create new file, always
 												FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
 												NULL);
-					if (m_hEDFTempFile == INVALID_HANDLE_VALUE) 
+					if (pss->hEDFTempFile == INVALID_HANDLE_VALUE) 
 					{ 
 						applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to create temporary EDF+ file. (GetLastError #)"), GetLastError(), TRUE);
-						MsgPrintf(hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create temporary EDF+ file. (GetLastError #)"), GetLastError());
+						engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create temporary EDF+ file. (GetLastError #)"), GetLastError());
 						blnStateErrorOccured = TRUE;
 					}
 					else
 					{
 						// Create an I/O completion port for the temporary file
-						m_hIOCP = CreateIoCompletionPort(m_hEDFTempFile, NULL, TEMPFILECOMPLETIONKEY, 0);
-						if(m_hIOCP == NULL)
+						pss->hIOCP = CreateIoCompletionPort(pss->hEDFTempFile, NULL, TEMPFILECOMPLETIONKEY, 0);
+						if(pss->hIOCP == NULL)
 						{ 
 							applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to create I/O completion port. (GetLastError #)"), GetLastError(), TRUE);
-							MsgPrintf(hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create I/O completion port. (GetLastError #)"), GetLastError());
+							engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create I/O completion port. (GetLastError #)"), GetLastError());
 							blnStateErrorOccured = TRUE;
 						}
 					}
@@ -682,27 +741,27 @@ long WINAPI Storage_Thread (LPARAM lParam)
 				//
 				// create linked list for records that are to be written
 #ifdef _DEBUG
-				m_pllWritePending = linkedlist_create('W');
+				pss->pllWritePending = linkedlist_create('W');
 #else
-				m_pllWritePending = linkedlist_create(0);
+				pss->pllWritePending = linkedlist_create(0);
 #endif
-				if(m_pllWritePending == NULL)
+				if(pss->pllWritePending == NULL)
 				{
 					applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to create write pending linked list."), 0, TRUE);
-					MsgPrintf(hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create write pending linked list."));
+					engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create write pending linked list."));
 					blnStateErrorOccured = TRUE;
 				}
 
 				// create linked list for records that have been writtenare to be written
 #ifdef _DEBUG
-				m_pllIOCompletionPending = linkedlist_create('C');
+				pss->pllIOCompletionPending = linkedlist_create('C');
 #else
-				m_pllIOCompletionPending = linkedlist_create(0);
+				pss->pllIOCompletionPending = linkedlist_create(0);
 #endif
-				if(m_pllIOCompletionPending == NULL)
+				if(pss->pllIOCompletionPending == NULL)
 				{
 					applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_Init: Unable to create I/O completion pending linked list."), 0, TRUE);
-					MsgPrintf(hwndMainWnd, MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create I/O completion pending linked list."));
+					engine_ReportError(MB_ICONSTOP, TEXT("Storage_Thread() - STS_Init: Unable to create I/O completion pending linked list."));
 					blnStateErrorOccured = TRUE;
 				}
 
@@ -710,9 +769,9 @@ long WINAPI Storage_Thread (LPARAM lParam)
 				// state transition
 				//
 				if(blnStateErrorOccured)
-					m_stsStorageThreadState = STS_CleanUp;
+					pss->State = STS_CleanUp;
 				else
-					m_stsStorageThreadState = STS_Write;
+					pss->State = STS_Write;
 
 				// signal that main FSM has finished init state
 				SetEvent(pstd->hevStorageThread_Init_End);
@@ -725,47 +784,47 @@ long WINAPI Storage_Thread (LPARAM lParam)
 				WaitForSingleObject(pstd->hevStorageThread_Write, INFINITE);
 
 				// write records to temporary EDF+ file
-				if(m_pllWritePending->count > 0)
-					blnStateErrorOccured = !Storage_WriteRecords();
+				if(pss->pllWritePending->count > 0)
+					blnStateErrorOccured = !Storage_WriteRecords(pss);
 
 				//
 				// state transition
 				//
 				if(blnStateErrorOccured)
-					m_stsStorageThreadState = STS_CleanUp;
+					pss->State = STS_CleanUp;
 				else
-					m_stsStorageThreadState = STS_ProcessIOCompletionPackets;
+					pss->State = STS_ProcessIOCompletionPackets;
 			break;
 
 			case STS_ProcessIOCompletionPackets:
 				blnStateErrorOccured = FALSE;
 
 				// process I/O completion packets
-				blnStateErrorOccured = !Storage_ProcessIOPackets(IOPACKETTIMEOUT);
+				blnStateErrorOccured = !Storage_ProcessIOPackets(pss, IOPACKETTIMEOUT);
 
 				//
 				// state transition
 				//
 				if(pstd->StopStorage || blnStateErrorOccured)
-					m_stsStorageThreadState = STS_CleanUp;
+					pss->State = STS_CleanUp;
 				else
-					m_stsStorageThreadState = STS_Write;
+					pss->State = STS_Write;
 			break;
 
 			case STS_CleanUp:
 				//
 				// finish pending writes
 				//
-				if(!Storage_CleanUp())
+				if(!Storage_CleanUp(pss))
 					applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Storage_Thread() - STS_CleanUp: Unable to complete pending writes."), 0, TRUE);
 
 				//
 				// close temporary EDF+ file and associated I/O completion port
 				//
-				if(m_hEDFTempFile != INVALID_HANDLE_VALUE)
-					CloseHandle(m_hEDFTempFile);
-				if(m_hIOCP != NULL)
-					CloseHandle(m_hIOCP);
+				if(pss->hEDFTempFile != INVALID_HANDLE_VALUE)
+					CloseHandle(pss->hEDFTempFile);
+				if(pss->hIOCP != NULL)
+					CloseHandle(pss->hIOCP);
 
 				//
 				// free resources
@@ -777,18 +836,18 @@ long WINAPI Storage_Thread (LPARAM lParam)
 					free(strTemp);
 
 				// linked lists
-				linkedlist_free(m_pllWritePending);
-				linkedlist_free(m_pllIOCompletionPending);
+				linkedlist_free(pss->pllWritePending);
+				linkedlist_free(pss->pllIOCompletionPending);
 				
 				//
 				// state transition
 				//				
-				m_stsStorageThreadState = STS_Idle;
+				pss->State = STS_Idle;
 			break;
 
 			default:
 				applog_logevent(SoftwareError, TEXT("Storage"), TEXT("Main FSM: Unknown state reached."), 0, TRUE);
-				m_stsStorageThreadState = STS_CleanUp;
+				pss->State = STS_CleanUp;
 		}
 	}
 }
\ No newline at end of file
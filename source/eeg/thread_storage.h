@@ -14,6 +14,12 @@
 //---------------------------------------------------------------------------
 //   								Structs/Enums
 //---------------------------------------------------------------------------
+/**
+ * State of a storage session (defined in thread_storage.cpp), which is passed to the storage thread instead of being kept
+ * in module globals. The engine creates a single session (see engine_CreateSession()).
+ */
+typedef struct _StorageSession StorageSession;
+
 /**
  * States of the storage thread's main FSM.
  */
@@ -28,11 +34,13 @@ typedef enum {STS_Idle							= 0,
  * Structure used by main thread to control the storage thread.
  */
 typedef struct{ BOOL				StopStorage;					///< flag used for signaling that the storage of records should be stopped
+				BOOL				ExitThread;						///< flag used for signaling that the storage thread should exit (checked when it leaves the Idle state)
 				HANDLE				hevStorageThread_Idling;		///< event that signals that the Storage thread is in the Idle state
 				HANDLE				hevStorageThread_Init_Start;	///< event used to signal the main FSM of the Storage thread to transition to the Init state
 				HANDLE				hevStorageThread_Init_End;		///< event used to signal that the main FSM of the Storage thread has finished executing the instructions of the Init state
 				HANDLE				hevStorageThread_Write;			///< event that signals that there are records to be stored
 				CONFIGURATION *		pcfg;							///< pointer to the CONFIGURATION struct of the main module
+				StorageSession *	pSession;						///< session stored by the thread (see Storage_CreateSession())
 } StorageThreadData;
 
 //---------------------------------------------------------------------------
@@ -41,19 +49,44 @@ typedef struct{ BOOL				StopStorage;					///< flag used for signaling that the s
  /**
  * \brief Adds record to the write queue of the storage thread. Function executes in the execution context of the calling thread.
  *
- * \param[in]	bytRecord				pointer to BYTE array that stores the record to be stored in the EDF+ file
- * \param[in]	uintRecordLen			size of bytRecord array, in bytes
- * \param[in]	blnHeaderRecord			TRUE if bytRecord is a header record, FALSE otherwise
+ * \param[in]	pss						storage session to which the record is to be added
+ * \param[in]	prbRecord				record to be stored in the EDF+ file (a reference to it is held until it has been written)
+ * \param[in]	blnHeaderRecord			TRUE if prbRecord is a header record, FALSE otherwise
  * \param[in]	hEvent					event to be signaled once record has been added to linked list
  */
-BOOL Storage_AddToQueue(BYTE * bytRecord, unsigned int uintRecordLen, BOOL blnHeaderRecord, HANDLE hEvent);
+BOOL Storage_AddToQueue(StorageSession * pss, RecordBuffer * prbRecord, BOOL blnHeaderRecord, HANDLE hEvent);
+
+/**
+ * \brief Creates the state of a storage session.
+ *
+ * \return Pointer to the session if successful, NULL otherwise.
+ */
+StorageSession * Storage_CreateSession(void);
+
+/**
+ * \brief Releases the state of a storage session. Must only be called once the storage thread of the session is no longer running.
+ *
+ * \param[in]	pss		storage session (can be NULL)
+ */
+void Storage_DestroySession(StorageSession * pss);
+
+/**
+ * \brief Returns the number of records that have been queued but not yet written to the EDF+ file.
+ *
+ * \param[in]	pss		storage session
+ *
+ * \return Number of records waiting to be written or for the completion of their write operation.
+ */
+unsigned int Storage_GetNQueuedRecords(StorageSession * pss);
 
  /**
  * \brief Returns the current state of the storage client's main FSM.
  *
+ * \param[in]	pss		storage session
+ *
  * \return	A member of the StorageThreadState enumeration.
  */
-StorageThreadState Storage_GetMainFSMState(void);
+StorageThreadState Storage_GetMainFSMState(StorageSession * pss);
 
 /**
  * \brief Get full path of the temporary EDF+ file.
@@ -61,12 +94,13 @@ StorageThreadState Storage_GetMainFSMState(void);
  * This function can be called even after the Storage thread's main FSM has entered the STS_Idle state since
  * the variable that stores the temporary EDF+ file path is reset at the beginning of the STS_Init state.
  *
+ * \param[in]	pss				storage session
  * \param[in]	strBuffer		pointer to buffer where the path should be stored
  * \param[in]	uintBufferLen	size of strBuffer, in TCHARs
  *
  * \return	TRUE if the function completes successfully and strBuffer contains the file path, FALSE otherwise.
  */
- BOOL Storage_GetTemporaryEDFFilePath(TCHAR * strBuffer, unsigned int uintBufferLen);
+ BOOL Storage_GetTemporaryEDFFilePath(StorageSession * pss, TCHAR * strBuffer, unsigned int uintBufferLen);
 
 /**
  * \brief Function executed when sampling thread is created using the CreateThread function. This stores the EDF+ data records to the HDD and sends them to the streaming server.
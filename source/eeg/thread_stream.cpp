@@ -49,6 +49,10 @@
 // program headers
 #include "globals.h"
 #include "applog.h"
+#include "edfPlus.h"
+#include "engine.h"
+#include "latency.h"
+#include "recpool.h"
 #include "thread_stream.h"
 
 //---------------------------------------------------------------------------
@@ -78,100 +82,47 @@ typedef enum {VortexClientSPState_None = 0,						///<
 			  VortexClientSPState_ReportError,					///< 
 } VortexClientSPState;
 
-//---------------------------------------------------------------------------
-//							Global variables
-//---------------------------------------------------------------------------
-static unsigned int				m_uintFIFOElementSize;					///< size, in bytes, of the elements stored in the queue
-static volatile LONG			m_intFIFOReadId;						///< index of the element right after the element that was last read by the consumer
-static volatile LONG			m_intFIFOWriteId;						///< index of the element right after the element that was last written by the producer
-static volatile void *			m_FIFOQueue[FIFO_QUEUE_LENGTH];			///< FIFO queue
-static CRITICAL_SECTION			m_csFIFOGuard;							///< 
-
-static StreamingClientState		m_vcsState;								///< stores the current state of the main FSM
+/**
+ * State of a streaming session: the FIFO transmission queue and the state of the main FSM.
+ */
+struct _StreamingSession
+{
+	volatile LONG					FIFOReadId;							///< index of the element right after the element that was last read by the consumer
+	volatile LONG					FIFOWriteId;						///< index of the element right after the element that was last written by the producer
+	RecordBuffer * volatile			FIFOQueue[FIFO_QUEUE_LENGTH];		///< FIFO queue (each element holds a reference to the buffer of its packet)
+	CRITICAL_SECTION				csFIFOGuard;						///<
+	volatile StreamingClientState	State;								///< stores the current state of the main FSM
+	unsigned int					DataRecordID;						///< DataRecordID of the next data record packet
+};
 
 //---------------------------------------------------------------------------
 //							Internally-accessible functions
 //---------------------------------------------------------------------------
 /**
- * \brief Allocate memory for the FIFO elements and initialize indexing variables.
- *
- * \param[in]	intElementSize		size, in bytes, of the elements that will be stored in the queue
+ * \brief Reset FIFO queue to its empty state, releasing the packets that have not been sent.
  *
- * \return TRUE if memory was succesfully allocated, FALSE otherwise.
- */
-BOOL fifo_create(unsigned int intElementSize)
-{
-	BOOL blnResult = TRUE;
-	int i;
-
-	// initialize global variables
-	m_intFIFOReadId = m_intFIFOWriteId = 0;
-	m_uintFIFOElementSize = intElementSize;
-	InitializeCriticalSection(&m_csFIFOGuard);
-	
-	// allocate memory for FIFO elements
-	for(i = 0; i < FIFO_QUEUE_LENGTH; i++)
-	{
-		// perform memory allocation
-		m_FIFOQueue[i] = malloc(m_uintFIFOElementSize);
-
-		// break out of loop and return from function if memory allocation has failed
-		if(m_FIFOQueue[i] == NULL)
-		{
-			blnResult = FALSE;
-			break;
-		}
-	}
-
-	// in malloc failure has occured, deallocate memory that has already been allocated
-	if(!blnResult)
-	{
-		for(; i >= 0; i--)
-		{
-			if(m_FIFOQueue[i] != NULL)
-				free((void *) m_FIFOQueue[i]);
-		}
-		
-		DeleteCriticalSection(&m_csFIFOGuard);
-	}
-
-	return blnResult;
-}
-
-/**
- * \brief Deallocate memory that was assigned to FIFO queue elements.
+ * \param[in]	pss		streaming session
  */
-void fifo_destroy(void)
+void fifo_reset(StreamingSession * pss)
 {
-	unsigned int i;
-
-	for(i = 0; i < FIFO_QUEUE_LENGTH; i++)
-	{
-		// free allocated memory
-		free((void *) m_FIFOQueue[i]);
-	}
+	LONG i;
 
-	DeleteCriticalSection(&m_csFIFOGuard);
-}
+	for(i = pss->FIFOReadId; i != pss->FIFOWriteId; i = (i + 1) % FIFO_QUEUE_LENGTH)
+		recpool_Release(pss->FIFOQueue[i]);
 
-/**
- * \brief Reset FIFO queue to its empty state.
- */
-void fifo_reset(void)
-{
-	InterlockedExchange(&m_intFIFOWriteId, 0);
-	InterlockedExchange(&m_intFIFOReadId, 0);
+	InterlockedExchange(&pss->FIFOWriteId, 0);
+	InterlockedExchange(&pss->FIFOReadId, 0);
 }
 
 /**
  * \brief Store element in FIFO queue.
  *
- * \param[in]	Element		pointer to element to be added to the queue
- * \param[in]	ElementSize	size, in bytes, of element to be added to FIFO queue
+ * \param[in]	pss				streaming session
+ * \param[in]	Element			buffer of the packet to be added to the queue (the queue takes over the caller's reference if successful)
  *
  * \return TRUE if element was succesfully added to the queue, FALSE if queue is full.
  */
-BOOL fifo_pushElement(const void * Element, unsigned int ElementSize)
+BOOL fifo_pushElement(StreamingSession * pss, RecordBuffer * Element)
 {
 	BOOL blnResult = FALSE;
 	LONG intNextElementId;
@@ -179,23 +130,22 @@ BOOL fifo_pushElement(const void * Element, unsigned int ElementSize)
 #ifdef _DEBUG
 	TCHAR strBuffer[256];
 
-	_stprintf_s(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("Thread %u has entered fifo_pushElement(). m_intWriteId value: %d\n"), GetCurrentThreadId(), m_intFIFOWriteId);
+	_stprintf_s(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("Thread %u has entered fifo_pushElement(). FIFOWriteId value: %d\n"), GetCurrentThreadId(), pss->FIFOWriteId);
 	OutputDebugString(strBuffer);
 #endif
 
-	EnterCriticalSection(&m_csFIFOGuard);
+	EnterCriticalSection(&pss->csFIFOGuard);
 	__try
 	{
-		intNextElementId = (m_intFIFOWriteId + 1) % FIFO_QUEUE_LENGTH;
+		intNextElementId = (pss->FIFOWriteId + 1) % FIFO_QUEUE_LENGTH;
 		
-		if(intNextElementId != m_intFIFOReadId)
+		if(intNextElementId != pss->FIFOReadId)
 		{
 			// add element to queue
-			memcpy_s((void *) m_FIFOQueue[m_intFIFOWriteId], m_uintFIFOElementSize,
-					 Element, ElementSize);
+			pss->FIFOQueue[pss->FIFOWriteId] = Element;
 
 			// update write index to point to next array location
-			InterlockedExchange(&m_intFIFOWriteId, intNextElementId);
+			InterlockedExchange(&pss->FIFOWriteId, intNextElementId);
 
 			// indicate that store was succesfull
 			blnResult = TRUE;
@@ -203,11 +153,11 @@ BOOL fifo_pushElement(const void * Element, unsigned int ElementSize)
 	}
 	__finally
 	{
-		LeaveCriticalSection(&m_csFIFOGuard);
+		LeaveCriticalSection(&pss->csFIFOGuard);
 	}
 
 #ifdef _DEBUG
-	_stprintf_s(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("Thread %u has left fifo_pushElement(). m_intWriteId value: %d\n\n"), GetCurrentThreadId(), m_intFIFOWriteId);
+	_stprintf_s(strBuffer, sizeof(strBuffer)/sizeof(TCHAR), TEXT("Thread %u has left fifo_pushElement(). FIFOWriteId value: %d\n\n"), GetCurrentThreadId(), pss->FIFOWriteId);
 	OutputDebugString(strBuffer);
 #endif
 
@@ -215,41 +165,31 @@ BOOL fifo_pushElement(const void * Element, unsigned int ElementSize)
 }
 
 /**
- * \brief Remove oldest element from the FIFO and return it in the provided buffer.
+ * \brief Remove oldest element from the FIFO.
  *
- * \param[out]	Element		pointer to buffer where element is to be stored
- * \param[in]	ElementSize	length of Element buffer, in bytes
+ * \param[in]	pss		streaming session
  *
- * \return TRUE if an element was succesfully removed, FALSE otherwise.
+ * \return Buffer of the packet (the caller takes over the queue's reference to it) if an element was succesfully removed, NULL otherwise.
  */
-BOOL fifo_popElement(void * Element, unsigned int ElementSize)
+RecordBuffer * fifo_popElement(StreamingSession * pss)
 {
-	BOOL blnResult = FALSE;
+	RecordBuffer * Element = NULL;
 	int intNextElementId;
 
-#ifdef _DEBUG
-	// make sure buffer is actually as long as advertised
-	memset(Element, 0xAE, ElementSize);
-#endif
-
 	// check if there is a new element to be removed
-	if(m_intFIFOReadId != m_intFIFOWriteId)
+	if(pss->FIFOReadId != pss->FIFOWriteId)
 	{
 		// calculate next position of read index
-		intNextElementId = (m_intFIFOReadId + 1) % FIFO_QUEUE_LENGTH;
+		intNextElementId = (pss->FIFOReadId + 1) % FIFO_QUEUE_LENGTH;
 
 		// pop element from FIFO queue
-		memcpy_s(Element, ElementSize,
-				 (void *) m_FIFOQueue[m_intFIFOReadId], m_uintFIFOElementSize);
+		Element = pss->FIFOQueue[pss->FIFOReadId];
 
 		// set read index to next queue position
-		InterlockedExchange(&m_intFIFOReadId, intNextElementId);
-
-		// indicate that element removal was succesfull
-		blnResult = TRUE;
+		InterlockedExchange(&pss->FIFOReadId, intNextElementId);
 	}
 
-	return blnResult;
+	return Element;
 }
 
 //---------------------------------------------------------------------------
@@ -300,59 +240,112 @@ void process_tls_status (VortexConnection * connection, VortexStatus status, cha
 	return;
  }
 
+/**
+ * \brief Creates the state of a streaming session.
+ *
+ * \return Pointer to the session if successful, NULL otherwise.
+ */
+StreamingSession * Streaming_CreateSession(void)
+{
+	StreamingSession * pss;
+
+	pss = (StreamingSession *) calloc(1, sizeof(StreamingSession));
+	if(pss == NULL)
+	{
+		applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Streaming_CreateSession(): Failed to allocate memory for the StreamingSession structure. (errno #)"), errno, TRUE);
+		return NULL;
+	}
+
+	pss->State = StreamingClientState_None;
+	pss->DataRecordID = EEGEM_DATARECORDID_FIRST;
+	InitializeCriticalSection(&pss->csFIFOGuard);
+
+	return pss;
+}
+
+/**
+ * \brief Releases the state of a streaming session, including the packets that are still in its FIFO queue.
+ *
+ * \param[in]	pss		streaming session (can be NULL)
+ */
+void Streaming_DestroySession(StreamingSession * pss)
+{
+	if(pss != NULL)
+	{
+		fifo_reset(pss);
+		DeleteCriticalSection(&pss->csFIFOGuard);
+		free(pss);
+	}
+}
+
  /**
  * \brief Returns the current state of the streaming client's main FSM.
  *
+ * \param[in]	pss		streaming session
+ *
  * \return	A member of the StreamingClientState enumeration.
  */
- StreamingClientState Streaming_GetMainFSMState(void)
+ StreamingClientState Streaming_GetMainFSMState(StreamingSession * pss)
  {
-	 return m_vcsState;
+	 return pss->State;
  }
  
  /**
  * \brief Adds packet to the FIFO transmission queue of the streaming thread. Function executes in the execution context of the calling thread.
  *
+ * The payload is not copied: the header of the packet is written in the bytes that the pool reserves in front of the
+ * record, and the streaming thread holds a reference to the record until the packet has been sent.
+ *
+ * \param[in]	pss					streaming session to which the packet is to be added
  * \param[in]	PacketType			member of EEGEMPacketType that indicates type of packet to that is to be transmitted
- * \param[in]	bytPayload			packet payload
- * \param[in]	ushrPayloadLength	size of packet payload, in bytes
+ * \param[in]	prbPayload			packet payload (must not be modified once it has been added)
  * \param[in]	hEvent				event to be signaled once packet has been added to queue
  *
  * \return TRUE if packet was successfully added to the transmission queue, FALSE otherwise.
  */
-BOOL Streaming_SendPacket(EEGEMPacketType PacketType, BYTE * bytPayload, unsigned short ushrPayloadLength, HANDLE hEvent)
+BOOL Streaming_SendPacket(StreamingSession * pss, EEGEMPacketType PacketType, RecordBuffer * prbPayload, HANDLE hEvent)
 {
 	BOOL					blnResult = FALSE;
-	EEGEMPacket				packet;
-	static unsigned int		uintDataRecordID = 0;
+	EEGEMPacket *			pPacket;
 
-	if(m_vcsState == StreamingClientState_Connecting || m_vcsState == StreamingClientState_DataStreaming)
+	if(prbPayload->Length > EEGEM_PACKET_PAYLOAD_MAX_LENGTH_BYT || FIELD_OFFSET(EEGEMPacket, Payload) > RECPOOL_HEADROOM)
 	{
+		applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Streaming_SendPacket(): Payload does not fit in a packet. (payload length #)"), prbPayload->Length, TRUE);
+	}
+	else if(pss->State == StreamingClientState_Connecting || pss->State == StreamingClientState_DataStreaming)
+	{
+		// the payload of the packet is the record itself
+		pPacket = (EEGEMPacket *) (prbPayload->Data - FIELD_OFFSET(EEGEMPacket, Payload));
+
 		switch(PacketType)
 		{
 			case EEGEMPacketType_EDFhdr:
-				uintDataRecordID = EEGEM_DATARECORDID_FIRST;
-				packet.DataRecordID = 0;						// NOTE: the DataRecordID counter can be reset here since the header record is only sent at the beginning or end of a transmission
+				pss->DataRecordID = EEGEM_DATARECORDID_FIRST;
+				pPacket->DataRecordID = 0;						// NOTE: the DataRecordID counter can be reset here since the header record is only sent at the beginning or end of a transmission
 			break;
 
 			case EEGEMPacketType_EDFdr:
-				packet.DataRecordID = uintDataRecordID++;
+				pPacket->DataRecordID = pss->DataRecordID++;
+			break;
+
+			case EEGEMPacketType_Coherence:
+				pPacket->DataRecordID = pss->DataRecordID - 1;		// the coherence belongs to the data record that was sent last
 			break;
 		}
 
 		// assemble packet
-		packet.Type = PacketType;
-		packet.PayloadLength = ushrPayloadLength;
-		memcpy_s(packet.Payload,
-				 EEGEM_PACKET_PAYLOAD_MAX_LENGTH_BYT,
-				 bytPayload,
-				 packet.PayloadLength);
+		pPacket->Type = PacketType;
+		pPacket->PayloadLength = (unsigned short) prbPayload->Length;
 
 		// store packet in FIFO queue
-		if(fifo_pushElement(&packet, sizeof(EEGEMPacket)))
+		recpool_AddRef(prbPayload);
+		if(fifo_pushElement(pss, prbPayload))
 			blnResult = TRUE;
 		else
+		{
+			recpool_Release(prbPayload);
 			applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Streaming_SendPacket() - FIFO queue has overflowed."), 0, TRUE);
+		}
 
 		// signal streaming thread
 		SetEvent(hEvent);
@@ -360,7 +353,7 @@ BOOL Streaming_SendPacket(EEGEMPacketType PacketType, BYTE * bytPayload, unsigne
 	else
 	{
 		// log error
-		applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Streaming_SendPacket(): Unable to send packet to since server is not in the correct state. (StreamingClientState #)"), m_vcsState, TRUE);
+		applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Streaming_SendPacket(): Unable to send packet to since server is not in the correct state. (StreamingClientState #)"), pss->State, TRUE);
 	}
 
 	return blnResult;
@@ -379,14 +372,15 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 	BOOL						blnSendingPacket;						///<
 	char						strServerIPv4[16];						///<
 	char						strServerPort[6];						///<
-	EEGEMPacket					Packet;									///<
-	HWND						hwndMainWindow;							///< handle to main window
+	EEGEMPacket *				pPacket;								///< packet being sent (its payload is the record in prbPacket)
 	int							reply;									///<
 	int							msg_no;									///<
 	int							intNSendMsgFailures;					///<
 	int							intNWait4ReplyFailures;					///<
+	RecordBuffer *				prbPacket;								///< buffer of the packet being sent
 	size_t						sztReturnValue;							///<
 	StreamingClientThreadData *	pvctd;									///<
+	StreamingSession *			pss;									///< session streamed by the thread
 	TCHAR						strBuffer1[256];						///<
 	TCHAR						strBuffer2[256];						///<
 	VortexChannel *				channel;								///<
@@ -398,14 +392,12 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 	WaitReplyData *				wait_reply;								///<
 	unsigned int				uintEEGEMPacketHeaderLengthByt;			///<
 
-	// get handle to main window
-	hwndMainWindow = FindWindow (WINDOW_CLASSID_MAIN, NULL);
-		
 	// initialize variables
 	pvctd = (StreamingClientThreadData *) lParam;
+	pss = pvctd->pSession;
 	blnStateErrorOccured = FALSE;
 	connection = NULL;
-	m_vcsState = StreamingClientState_Init;
+	pss->State = StreamingClientState_Init;
 	vtlssd.hevTLSNegotiationComplete = CreateEvent(NULL, FALSE, FALSE, NULL);
 	if(vtlssd.hevTLSNegotiationComplete == NULL)
 	{
@@ -416,38 +408,28 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 
 	vtlssd.IsTLSEnabled = FALSE;
 	vtlssd.connection = NULL;
-	uintEEGEMPacketHeaderLengthByt = sizeof(Packet) - sizeof(Packet.Payload);
+	uintEEGEMPacketHeaderLengthByt = FIELD_OFFSET(EEGEMPacket, Payload);
 
 	// log libvortex version
 	applog_logevent(Version, TEXT("libvortex"), LIBVORTEX_VERSION, 0, FALSE);
 
-	// initialize FIFO queue
-	if(fifo_create(sizeof(EEGEMPacket)))
-	{
-		SetEvent(pvctd->hevThreadInit_Complete);
-	}
-	else
-	{
-		applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Streaming_Thread(): Unable to create FIFO queue."), 0, TRUE);
-		SetEvent(pvctd->hevThreadInit_Complete);
-		ExitThread(0);
-	}
+	SetEvent(pvctd->hevThreadInit_Complete);
 
 	//
 	// streaming client - main FSM
 	// 
 	while(1)
 	{
-		switch(m_vcsState)
+		switch(pss->State)
 		{
 			case StreamingClientState_Init:
 				// update status displayed in main window
-				PostMessage(hwndMainWindow, EEGEMMsg_Streaming_DisplayStatus, m_vcsState, 0);
+				engine_Notify(EngineEvent_StreamingStatus, pss->State, 0);
 
 				blnStateErrorOccured = FALSE;
 
 				// initialize fifo queue
-				fifo_reset();
+				fifo_reset(pss);
 
 				// init vortex library
 				ctx = vortex_ctx_new ();
@@ -468,14 +450,14 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 				// state transition
 				//
 				if(blnStateErrorOccured)
-					m_vcsState = StreamingClientState_Exit;
+					pss->State = StreamingClientState_Exit;
 				else
-					m_vcsState = StreamingClientState_Waiting2Connect;
+					pss->State = StreamingClientState_Waiting2Connect;
 			break;
 
 			case StreamingClientState_Waiting2Connect:
 				// update status displayed in main window
-				PostMessage(hwndMainWindow, EEGEMMsg_Streaming_DisplayStatus, m_vcsState, 0);
+				engine_Notify(EngineEvent_StreamingStatus, pss->State, 0);
 
 				// signal that thread is entering waiting mode
 				SetEvent(pvctd->hevVortexClient_WaitingToConnect);
@@ -487,14 +469,14 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 				// state transition
 				//
 				if(pvctd->ExitThread)
-					m_vcsState = StreamingClientState_Exit;
+					pss->State = StreamingClientState_Exit;
 				else
-					m_vcsState = StreamingClientState_Connecting;
+					pss->State = StreamingClientState_Connecting;
 			break;
 
 			case StreamingClientState_Connecting:
 				// update status displayed in main window
-				PostMessage(hwndMainWindow, EEGEMMsg_Streaming_DisplayStatus, m_vcsState, 0);
+				engine_Notify(EngineEvent_StreamingStatus, pss->State, 0);
 
 				// signal that main FSM has entered connecting state
 				SetEvent(pvctd->hevVortexClient_Connecting_Start);
@@ -571,9 +553,9 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 				// state transition
 				//
 				if(blnStateErrorOccured)
-					m_vcsState = StreamingClientState_Cleanup;
+					pss->State = StreamingClientState_Cleanup;
 				else
-					m_vcsState = StreamingClientState_DataStreaming;
+					pss->State = StreamingClientState_DataStreaming;
 
 				// signal that main FSM has finished connecting state
 				SetEvent(pvctd->hevVortexClient_Connecting_End);
@@ -581,7 +563,7 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 
 			case StreamingClientState_DataStreaming:
 				// update status displayed in main window
-				PostMessage(hwndMainWindow, EEGEMMsg_Streaming_DisplayStatus, m_vcsState, 0);
+				engine_Notify(EngineEvent_StreamingStatus, pss->State, 0);
 
 				blnStateErrorOccured = FALSE;
 
@@ -594,8 +576,10 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 				//
 				// send data
 				//
-				while(fifo_popElement(&Packet, sizeof(EEGEMPacket)) && !blnStateErrorOccured)
+				while(!blnStateErrorOccured && (prbPacket = fifo_popElement(pss)) != NULL)
 				{
+					pPacket = (EEGEMPacket *) (prbPacket->Data - uintEEGEMPacketHeaderLengthByt);
+
 					// initialize state machine variables
 					blnSendingPacket = TRUE;
 					vcspsState = VortexClientSPState_SendPacket;
@@ -613,11 +597,12 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 							case VortexClientSPState_SendPacket:
 								// send the message using msg_and_wait and start a wait_reply
 								if (vortex_channel_send_msg_and_wait (channel,													// channel where message will be sent
-																	  &Packet,													// message to be sent
-																	  uintEEGEMPacketHeaderLengthByt + Packet.PayloadLength,	// size of message to be sent
+																	  pPacket,													// message to be sent
+																	  uintEEGEMPacketHeaderLengthByt + pPacket->PayloadLength,	// size of message to be sent
 																	  &msg_no,													// required integer reference to store the message number used 
 																	  wait_reply))												// Wait Reply object (created using vortex_channel_create_wait_reply)
 								{
+									latency_Record(LatencyStage_StreamSend, prbPacket->ArrivalTime);
 									vcspsState = VortexClientSPState_Wait4Reply;
 								}
 								else
@@ -661,6 +646,7 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 									vortex_frame_unref(frame);
 									
 									// reply received successfully so we can stop trying to send current packet
+									latency_Record(LatencyStage_ServerReply, prbPacket->ArrivalTime);
 									blnSendingPacket = FALSE;
 								}
 								else
@@ -724,25 +710,28 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 								vcspsState = VortexClientSPState_ReportError;
 						}
 					} while(blnSendingPacket);
+
+					// the packet has been sent (or given up on)
+					recpool_Release(prbPacket);
 				}
 
 				//
 				// state transition
 				//
 				if(blnStateErrorOccured)
-					m_vcsState = StreamingClientState_Cleanup;
+					pss->State = StreamingClientState_Cleanup;
 				else
 				{
 					if(pvctd->ExitThread)
-						m_vcsState = StreamingClientState_Exit;
+						pss->State = StreamingClientState_Exit;
 					else if (pvctd->EndTransmission)
-						m_vcsState = StreamingClientState_Cleanup;
+						pss->State = StreamingClientState_Cleanup;
 				}
 			break;
 			
 			case StreamingClientState_Cleanup:
 				// update status displayed in main window
-				PostMessage(hwndMainWindow, EEGEMMsg_Streaming_DisplayStatus, m_vcsState, 0);
+				engine_Notify(EngineEvent_StreamingStatus, pss->State, 0);
 
 				//
 				// Vortex cleanup
@@ -760,15 +749,15 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 				//
 				// state transition
 				//
-				m_vcsState = StreamingClientState_Init;
+				pss->State = StreamingClientState_Init;
 			break;
 
 			case StreamingClientState_Exit:
 				// update status displayed in main window
-				// NOTE: this is done ONLY if main thread hasn't set the ExitThread because the hwndMainWindow becomes invalid
-				//       once the main window receives the WM_DESTROY message
+				// NOTE: this is done ONLY if main thread hasn't set the ExitThread because the handler of the GUI posts the
+				//       event to the main window, which becomes invalid once it receives the WM_DESTROY message
 				if(!(pvctd->ExitThread))
-					PostMessage(hwndMainWindow, EEGEMMsg_Streaming_DisplayStatus, m_vcsState, 0);
+					engine_Notify(EngineEvent_StreamingStatus, pss->State, 0);
 
 				//
 				// Vortex cleanup
@@ -787,9 +776,9 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 				vortex_ctx_free (ctx);
 
 				//
-				// free resources
+				// free resources (the session itself is released by the owner of the thread)
 				//
-				fifo_destroy();
+				fifo_reset(pss);
 
 				// signal main thread that thread is about to exit
 				SetEvent(pvctd->hevVortexClient_Exiting);
@@ -800,7 +789,7 @@ long WINAPI Streaming_Thread (LPARAM lParam)
 
 			default:
 				applog_logevent(SoftwareError, TEXT("Streaming"), TEXT("Streaming_Thread() - Main FSM: Unknown state reached."), 0, TRUE);
-				m_vcsState = StreamingClientState_Exit;
+				pss->State = StreamingClientState_Exit;
 		}
 	}
 }
\ No newline at end of file
@@ -16,9 +16,17 @@
 //---------------------------------------------------------------------------
 # define LIBVORTEX_VERSION			TEXT("1.1.12")
 
+# define EEGEMPacketType_Coherence	((EEGEMPacketType) 0x40)			///< packet whose payload is the inter-channel coherence of the last data record (see coh_Serialize(); extends the types of eegem_beep.h and is only sent to servers configured for it)
+
 //---------------------------------------------------------------------------
 //   								Structs/Enums
 //---------------------------------------------------------------------------
+/**
+ * State of a streaming session (defined in thread_stream.cpp), which is passed to the streaming thread instead of being
+ * kept in module globals. The engine creates a single session (see engine_CreateSession()).
+ */
+typedef struct _StreamingSession StreamingSession;
+
 /**
  * 
  */
@@ -40,6 +48,7 @@ typedef struct {BOOL				ExitThread;							///<
 				BYTE *				pServerIPv4Address_Field2;			///<
 				BYTE *				pServerIPv4Address_Field3;			///<
 				int	*				pServerPort;						///<
+				StreamingSession *	pSession;							///< session streamed by the thread (see Streaming_CreateSession())
 } StreamingClientThreadData;
 
 /**
@@ -57,24 +66,40 @@ typedef enum {StreamingClientState_None = 0,					///<
 //---------------------------------------------------------------------------
 //   								Prototypes
 //---------------------------------------------------------------------------
+/**
+ * \brief Creates the state of a streaming session.
+ *
+ * \return Pointer to the session if successful, NULL otherwise.
+ */
+StreamingSession * Streaming_CreateSession(void);
+
+/**
+ * \brief Releases the state of a streaming session. Must only be called once the streaming thread of the session has exited.
+ *
+ * \param[in]	pss		streaming session (can be NULL)
+ */
+void Streaming_DestroySession(StreamingSession * pss);
+
  /**
  * \brief Returns the current state of the streaming client's main FSM.
  *
+ * \param[in]	pss		streaming session
+ *
  * \return	A member of the StreamingClientState enumeration.
  */
- StreamingClientState Streaming_GetMainFSMState(void);
+ StreamingClientState Streaming_GetMainFSMState(StreamingSession * pss);
 
  /**
  * \brief Adds packet to the FIFO transmission queue of the streaming thread. Function executes in the execution context of the calling thread.
  *
+ * \param[in]	pss					streaming session to which the packet is to be added
  * \param[in]	PacketType			member of EEGEMPacketType that indicates type of packet to that is to be transmitted
- * \param[in]	bytPayload			packet payload
- * \param[in]	ushrPayloadLength	size of packet payload, in bytes
+ * \param[in]	prbPayload			packet payload (a reference to it is held until the packet has been sent)
  * \param[in]	hEvent				event to be signaled once packet has been added to queue
  *
  * \return TRUE if packet was successfully added to the transmission queue, FALSE otherwise.
  */
-BOOL Streaming_SendPacket(EEGEMPacketType PacketType, BYTE * bytPayload, unsigned short ushrPayloadLength, HANDLE hEvent);
+BOOL Streaming_SendPacket(StreamingSession * pss, EEGEMPacketType PacketType, RecordBuffer * prbPayload, HANDLE hEvent);
 
 /**
  * \brief Function executed when streaming thread is created using the CreateThread function.
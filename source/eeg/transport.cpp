@@ -0,0 +1,755 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		transport.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that implements the byte transports over which the WEEG link can be run.
+ *
+ * The serial module frames packets from, and sends packets to, an abstract byte transport (see the Transport struct).
+ * Four transports are implemented (see transport_posix.cpp for the POSIX versions):
+ *	- the Win32 COM port of the WEEG coordinator (overlapped I/O, the reader blocks in WaitCommEvent),
+ *	- a capture file (see capture.cpp) or a file containing the raw received byte stream, which is replayed either at the
+ *	  recorded times (the link's nominal speed for raw files) or as fast as the acquisition pipeline can consume it
+ *	  (anything sent to it is discarded),
+ *	- a TCP connection, e.g. to a serial-to-network bridge or to a coordinator emulator,
+ *	- the in-process coordinator emulator (see emulator.cpp).
+ *
+ * The latter three make it possible to run and benchmark the acquisition pipeline without WEEG hardware.
+ *
+ * A COM port that fails (e.g., the USB adapter has been unplugged) and a TCP connection that the peer has closed or reset
+ * are reported by Read() as TRANSPORT_CLOSED, so that the link can be re-established (see Sample_ReconnectLink()).
+ *
+ * $Id$
+ */
+
+//---------------------------------------------------------------------------
+//   					  Windows-related definitions
+//---------------------------------------------------------------------------
+// this macro prevents windows.h from including winsock.h for version 1.1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+// library requires at least Windows XP SP2
+#define WINVER			0x0502
+#define _WIN32_WINNT	0x0502
+#define _WIN32_IE		0x0600									// application requires  Comctl32.dll version 6.0 and later, and Shell32.dll and Shlwapi.dll version 6.0 and later
+
+//---------------------------------------------------------------------------
+//   								Libraries
+//---------------------------------------------------------------------------
+#pragma comment(lib, "ws2_32.lib")
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// Windows libaries
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+// CRT libraries
+#include <string.h>
+#include <tchar.h>
+
+// program headers
+#include "capture.h"
+#include "serialV4.h"
+#include "emulator.h"
+#include "transport.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+#define TRANSPORT_FILE_BYTES_PER_S		(SERPORT_SPEED/10)		///< rate at which a raw byte stream is replayed in real-time mode (8N1: 10 bits per byte)
+#define TRANSPORT_TCP_WRITE_TIMEOUT		1000					///< maximum time a write may wait for space in the socket's send buffer, in ms
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+static DWORD	transport_COM_Open(const TCHAR * strAddress);
+static void		transport_COM_Close(void);
+static DWORD	transport_COM_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+static BOOL		transport_COM_Write(const void * pBuffer, DWORD dwrdLength);
+static DWORD	transport_COM_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+static BOOL		transport_COM_Purge(void);
+
+static DWORD	transport_File_Open(const TCHAR * strAddress);
+static void		transport_File_Close(void);
+static DWORD	transport_File_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+static BOOL		transport_File_Write(const void * pBuffer, DWORD dwrdLength);
+static DWORD	transport_File_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+static BOOL		transport_File_Purge(void);
+
+static DWORD	transport_TCP_Open(const TCHAR * strAddress);
+static void		transport_TCP_Close(void);
+static DWORD	transport_TCP_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+static BOOL		transport_TCP_Write(const void * pBuffer, DWORD dwrdLength);
+static DWORD	transport_TCP_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+static BOOL		transport_TCP_Purge(void);
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static const Transport	mc_tTransports[Transport_NTypes] =
+{
+	{transport_COM_Open, transport_COM_Close, transport_COM_Read, transport_COM_Write, transport_COM_WaitForData, transport_COM_Purge, FALSE},
+	{transport_File_Open, transport_File_Close, transport_File_Read, transport_File_Write, transport_File_WaitForData, transport_File_Purge, TRUE},
+	{transport_TCP_Open, transport_TCP_Close, transport_TCP_Read, transport_TCP_Write, transport_TCP_WaitForData, transport_TCP_Purge, FALSE},
+	{emulator_Open, emulator_Close, emulator_Read, emulator_Write, emulator_WaitForData, emulator_Purge, FALSE}
+};
+
+// COM port
+static HANDLE		m_hCOMPort = INVALID_HANDLE_VALUE;
+static OVERLAPPED	m_ovCOMRead;						///< used by the reader thread for reads
+static OVERLAPPED	m_ovCOMWait;						///< used by the reader thread for WaitCommEvent
+static HANDLE		m_hevCOMWrite;						///< completion event of the writes
+static BOOL			m_blnCOMWaitPending;				///< TRUE if a WaitCommEvent has been issued but has not completed yet
+static DWORD		m_dwrdCOMEventMask;
+
+// capture file
+static HANDLE		m_hFile = INVALID_HANDLE_VALUE;
+static BOOL			m_blnFileRealTime = TRUE;			///< TRUE if the file is replayed at the link's speed, FALSE if as fast as possible
+static BOOL			m_blnFileEOF;
+static DWORD		m_dwrdFileStartTime;				///< GetTickCount() when the file was opened
+static ULONGLONG	m_ullngFileNBytesRead;
+static BOOL			m_blnFileIsCapture;					///< TRUE if the file is a capture (see capture.h), FALSE if it contains the received byte stream only
+static DWORD		m_dwrdRecordNBytesLeft;				///< number of bytes of the current capture record that have not been delivered yet
+static LONGLONG		m_llngRecordTime;					///< capture time of the current record, in us
+static LARGE_INTEGER	m_liFileFrequency;
+static LARGE_INTEGER	m_liFileStartCounter;
+
+// TCP
+static SOCKET		m_sckSocket = INVALID_SOCKET;
+static WSAEVENT		m_hevSocket = WSA_INVALID_EVENT;
+static BOOL			m_blnWSAStarted;
+static BOOL			m_blnTCPPeerClosed;					///< TRUE once FD_CLOSE has been reported for the socket
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Opens the COM port and configures it for 230400N81 overlapped communication.
+ *
+ * \param[in]	strAddress		path of the port (e.g., \\\\.\\COM4)
+ * \return ERROR_SUCCESS if successful, otherwise the error code returned by GetLastError.
+ */
+static DWORD transport_COM_Open(const TCHAR * strAddress)
+{
+	DWORD dwReturnCode;
+
+	m_hCOMPort = CreateFile (strAddress, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+	if (m_hCOMPort == INVALID_HANDLE_VALUE)
+		return GetLastError();
+
+	dwReturnCode = transport_ConfigureCOMPort (m_hCOMPort);
+	if (dwReturnCode != ERROR_SUCCESS)
+	{
+		transport_COM_Close();
+		return dwReturnCode;
+	}
+
+	// create the events of the overlapped operations
+	SecureZeroMemory(&m_ovCOMRead, sizeof(m_ovCOMRead));
+	SecureZeroMemory(&m_ovCOMWait, sizeof(m_ovCOMWait));
+	m_ovCOMRead.hEvent = CreateEvent (NULL, TRUE, FALSE, NULL);
+	m_ovCOMWait.hEvent = CreateEvent (NULL, TRUE, FALSE, NULL);
+	m_hevCOMWrite = CreateEvent (NULL, TRUE, FALSE, NULL);
+	if (m_ovCOMRead.hEvent == NULL || m_ovCOMWait.hEvent == NULL || m_hevCOMWrite == NULL)
+	{
+		dwReturnCode = GetLastError();
+		transport_COM_Close();
+		return dwReturnCode;
+	}
+
+	m_blnCOMWaitPending = FALSE;
+
+	return ERROR_SUCCESS;
+}
+
+static void transport_COM_Close(void)
+{
+	if (m_hCOMPort != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle (m_hCOMPort);
+		m_hCOMPort = INVALID_HANDLE_VALUE;
+	}
+
+	if (m_ovCOMRead.hEvent != NULL)
+	{
+		CloseHandle (m_ovCOMRead.hEvent);
+		m_ovCOMRead.hEvent = NULL;
+	}
+	if (m_ovCOMWait.hEvent != NULL)
+	{
+		CloseHandle (m_ovCOMWait.hEvent);
+		m_ovCOMWait.hEvent = NULL;
+	}
+	if (m_hevCOMWrite != NULL)
+	{
+		CloseHandle (m_hevCOMWrite);
+		m_hevCOMWrite = NULL;
+	}
+}
+
+/**
+ * \brief Reads the bytes that are waiting in the serial driver's receive queue.
+ *
+ * The port is opened with a zero read timeout, so the read completes immediately. A failed read means that the port is
+ * gone (the driver fails all I/O of an unplugged USB adapter).
+ */
+static DWORD transport_COM_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	DWORD dwrdNBytesRead;
+
+	dwrdNBytesRead = 0;
+	if (!ReadFile (m_hCOMPort, pbytBuffer, dwrdLength, &dwrdNBytesRead, &m_ovCOMRead))
+	{
+		if (GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult (m_hCOMPort, &m_ovCOMRead, &dwrdNBytesRead, TRUE))
+			return TRANSPORT_CLOSED;
+	}
+
+	return dwrdNBytesRead;
+}
+
+static BOOL transport_COM_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	DWORD dwrdNBytesWritten;
+	OVERLAPPED ovWrite;
+
+	SecureZeroMemory(&ovWrite, sizeof(ovWrite));
+	ovWrite.hEvent = m_hevCOMWrite;
+	if (!WriteFile (m_hCOMPort, pBuffer, dwrdLength, &dwrdNBytesWritten, &ovWrite))
+	{
+		if (GetLastError() != ERROR_IO_PENDING)
+			return FALSE;
+		if (!GetOverlappedResult (m_hCOMPort, &ovWrite, &dwrdNBytesWritten, TRUE))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Blocks in an overlapped WaitCommEvent() until the driver reports that characters have been received.
+ *
+ * The wait stays armed across timeouts. When the stop event is signaled, the pending wait is cancelled (CancelIo only
+ * cancels the I/O issued by the calling thread, which is why this is done here by the reader thread). If the driver does
+ * not support comm events, the function falls back to polling every TRANSFER_IDLE ms.
+ */
+static DWORD transport_COM_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	DWORD dwrdNBytes, dwrdWaitResult;
+	HANDLE hEvents [2];
+
+	// arm the comm event wait
+	if (!m_blnCOMWaitPending)
+	{
+		if (WaitCommEvent (m_hCOMPort, &m_dwrdCOMEventMask, &m_ovCOMWait))
+			return WAIT_OBJECT_0;
+
+		if (GetLastError() != ERROR_IO_PENDING)
+			return (WaitForSingleObject (hevStop, TRANSFER_IDLE) == WAIT_OBJECT_0) ? WAIT_OBJECT_0 + 1 : WAIT_OBJECT_0;
+		m_blnCOMWaitPending = TRUE;
+	}
+
+	hEvents[0] = m_ovCOMWait.hEvent;
+	hEvents[1] = hevStop;
+	dwrdWaitResult = WaitForMultipleObjects (2, hEvents, FALSE, dwrdTimeout);
+	switch (dwrdWaitResult)
+	{
+		case WAIT_OBJECT_0:
+			m_blnCOMWaitPending = FALSE;
+		break;
+
+		case WAIT_OBJECT_0 + 1:
+			CancelIo (m_hCOMPort);
+			GetOverlappedResult (m_hCOMPort, &m_ovCOMWait, &dwrdNBytes, TRUE);
+			m_blnCOMWaitPending = FALSE;
+		break;
+
+		default:
+			dwrdWaitResult = WAIT_TIMEOUT;
+	}
+
+	return dwrdWaitResult;
+}
+
+static BOOL transport_COM_Purge(void)
+{
+	PurgeComm (m_hCOMPort, PURGE_RXCLEAR | PURGE_TXCLEAR);
+	return TRUE;
+}
+
+/**
+ * \brief Opens a file for replay.
+ *
+ * The file is either a capture (see capture.h), whose received-data records are delivered at their recorded times, or a
+ * plain dump of the received byte stream, which is delivered at the link's nominal byte rate.
+ *
+ * \param[in]	strAddress		path of the file
+ * \return ERROR_SUCCESS if successful, otherwise the error code returned by GetLastError.
+ */
+static DWORD transport_File_Open(const TCHAR * strAddress)
+{
+	CaptureFileHeader cfhHeader;
+	DWORD dwrdNBytesRead;
+
+	m_hFile = CreateFile (strAddress, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return GetLastError();
+
+	// capture or raw byte stream?
+	m_blnFileIsCapture = ReadFile (m_hFile, &cfhHeader, sizeof(cfhHeader), &dwrdNBytesRead, NULL) &&
+						 dwrdNBytesRead == sizeof(cfhHeader) &&
+						 memcmp (cfhHeader.Magic, CAPTURE_MAGIC, sizeof(cfhHeader.Magic)) == 0 &&
+						 cfhHeader.Version == CAPTURE_VERSION;
+	if (!m_blnFileIsCapture)
+		SetFilePointer (m_hFile, 0, NULL, FILE_BEGIN);
+
+	m_blnFileEOF = FALSE;
+	m_dwrdFileStartTime = GetTickCount();
+	m_ullngFileNBytesRead = 0;
+	m_dwrdRecordNBytesLeft = 0;
+	m_llngRecordTime = 0;
+	QueryPerformanceFrequency (&m_liFileFrequency);
+	QueryPerformanceCounter (&m_liFileStartCounter);
+
+	return ERROR_SUCCESS;
+}
+
+static void transport_File_Close(void)
+{
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle (m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+}
+
+/**
+ * \brief Returns the time elapsed since the file was opened, in microseconds.
+ */
+static LONGLONG transport_File_GetTime(void)
+{
+	LARGE_INTEGER liCounter;
+
+	QueryPerformanceCounter (&liCounter);
+
+	return (liCounter.QuadPart - m_liFileStartCounter.QuadPart) * 1000000 / m_liFileFrequency.QuadPart;
+}
+
+/**
+ * \brief Advances to the next received-data record of a capture; the records of sent packets are skipped.
+ *
+ * \return TRUE if a record was found, FALSE at the end of the file.
+ */
+static BOOL transport_File_NextRecord(void)
+{
+	CaptureRecordHeader crhHeader;
+	DWORD dwrdNBytesRead;
+
+	while (TRUE)
+	{
+		if (!ReadFile (m_hFile, &crhHeader, sizeof(crhHeader), &dwrdNBytesRead, NULL) || dwrdNBytesRead != sizeof(crhHeader))
+		{
+			m_blnFileEOF = TRUE;
+			return FALSE;
+		}
+		m_llngRecordTime += crhHeader.TimeDelta;
+
+		if (crhHeader.Direction == CaptureDirection_Received && crhHeader.Length > 0)
+		{
+			m_dwrdRecordNBytesLeft = crhHeader.Length;
+			return TRUE;
+		}
+		SetFilePointer (m_hFile, crhHeader.Length, NULL, FILE_CURRENT);
+	}
+}
+
+/**
+ * \brief Reads the next bytes of the file.
+ *
+ * In real-time mode, only the bytes that the link delivered (capture) or would have delivered (raw byte stream) by now
+ * are returned. As fast as possible mode delivers the same byte stream, so a replay is deterministic in either mode.
+ */
+static DWORD transport_File_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	DWORD dwrdNBytesRead;
+	ULONGLONG ullngNBytesDue;
+
+	if (m_blnFileEOF)
+		return 0;
+
+	if (m_blnFileIsCapture)
+	{
+		if (m_dwrdRecordNBytesLeft == 0 && !transport_File_NextRecord())
+			return 0;
+		if (m_blnFileRealTime && transport_File_GetTime() < m_llngRecordTime)
+			return 0;
+		if (dwrdLength > m_dwrdRecordNBytesLeft)
+			dwrdLength = m_dwrdRecordNBytesLeft;
+	}
+	else if (m_blnFileRealTime)
+	{
+		ullngNBytesDue = (ULONGLONG) (GetTickCount() - m_dwrdFileStartTime) * TRANSPORT_FILE_BYTES_PER_S / 1000;
+		if (ullngNBytesDue <= m_ullngFileNBytesRead)
+			return 0;
+		if (ullngNBytesDue - m_ullngFileNBytesRead < dwrdLength)
+			dwrdLength = (DWORD) (ullngNBytesDue - m_ullngFileNBytesRead);
+	}
+
+	if (!ReadFile (m_hFile, pbytBuffer, dwrdLength, &dwrdNBytesRead, NULL) || dwrdNBytesRead == 0)
+	{
+		m_blnFileEOF = TRUE;
+		return 0;
+	}
+	m_ullngFileNBytesRead += dwrdNBytesRead;
+	if (m_blnFileIsCapture)
+		m_dwrdRecordNBytesLeft -= dwrdNBytesRead;
+
+	return dwrdNBytesRead;
+}
+
+static BOOL transport_File_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	// commands have no effect on a replay
+	return TRUE;
+}
+
+static DWORD transport_File_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	LONGLONG llngWaitTime;
+
+	// nothing more to deliver
+	if (m_blnFileEOF)
+		return (WaitForSingleObject (hevStop, dwrdTimeout) == WAIT_OBJECT_0) ? WAIT_OBJECT_0 + 1 : WAIT_TIMEOUT;
+
+	// real time: sleep until the next capture record is due (raw byte stream: deliver it in TRANSFER_IDLE ms slices);
+	// as fast as possible: only check whether the reader has to stop
+	llngWaitTime = 0;
+	if (m_blnFileRealTime)
+	{
+		if (m_blnFileIsCapture)
+		{
+			llngWaitTime = (m_llngRecordTime - transport_File_GetTime() + 999) / 1000;
+			if (llngWaitTime < 0)
+				llngWaitTime = 0;
+			else if (llngWaitTime > dwrdTimeout)
+				llngWaitTime = dwrdTimeout;
+		}
+		else
+			llngWaitTime = TRANSFER_IDLE;
+	}
+	if (WaitForSingleObject (hevStop, (DWORD) llngWaitTime) == WAIT_OBJECT_0)
+		return WAIT_OBJECT_0 + 1;
+
+	return WAIT_OBJECT_0;
+}
+
+static BOOL transport_File_Purge(void)
+{
+	// the replayed stream contains the coordinator's replies to the commands, so it must not be discarded
+	return FALSE;
+}
+
+/**
+ * \brief Connects to a TCP server.
+ *
+ * \param[in]	strAddress		address of the server in the form host:port
+ * \return ERROR_SUCCESS if successful, otherwise a Win32/Winsock error code.
+ */
+static DWORD transport_TCP_Open(const TCHAR * strAddress)
+{
+	ADDRINFOT aiHints, * paiResult, * pai;
+	BOOL blnNoDelay;
+	DWORD dwReturnCode;
+	TCHAR strHost [TRANSPORT_MAX_ADDRESS_LEN + 1];
+	const TCHAR * pstrPort;
+	WSADATA wsaData;
+
+	// split address into host & port
+	pstrPort = _tcsrchr (strAddress, TEXT(':'));
+	if (pstrPort == NULL || pstrPort == strAddress || (size_t) (pstrPort - strAddress) > TRANSPORT_MAX_ADDRESS_LEN)
+		return ERROR_INVALID_PARAMETER;
+	_tcsncpy_s (strHost, sizeof(strHost)/sizeof(TCHAR), strAddress, pstrPort - strAddress);
+	pstrPort++;
+
+	dwReturnCode = WSAStartup (MAKEWORD(2, 2), &wsaData);
+	if (dwReturnCode != 0)
+		return dwReturnCode;
+	m_blnWSAStarted = TRUE;
+
+	// resolve server address
+	SecureZeroMemory(&aiHints, sizeof(aiHints));
+	aiHints.ai_family = AF_UNSPEC;
+	aiHints.ai_socktype = SOCK_STREAM;
+	aiHints.ai_protocol = IPPROTO_TCP;
+	dwReturnCode = GetAddrInfo (strHost, pstrPort, &aiHints, &paiResult);
+	if (dwReturnCode != 0)
+	{
+		transport_TCP_Close();
+		return dwReturnCode;
+	}
+
+	// connect to the first address that accepts the connection
+	dwReturnCode = WSAECONNREFUSED;
+	for (pai = paiResult; pai != NULL; pai = pai->ai_next)
+	{
+		m_sckSocket = socket (pai->ai_family, pai->ai_socktype, pai->ai_protocol);
+		if (m_sckSocket == INVALID_SOCKET)
+		{
+			dwReturnCode = WSAGetLastError();
+			continue;
+		}
+
+		if (connect (m_sckSocket, pai->ai_addr, (int) pai->ai_addrlen) == 0)
+			break;
+
+		dwReturnCode = WSAGetLastError();
+		closesocket (m_sckSocket);
+		m_sckSocket = INVALID_SOCKET;
+	}
+	FreeAddrInfo (paiResult);
+	if (m_sckSocket == INVALID_SOCKET)
+	{
+		transport_TCP_Close();
+		return dwReturnCode;
+	}
+
+	m_blnTCPPeerClosed = FALSE;
+
+	// the commands are small and must not be delayed by Nagle's algorithm
+	blnNoDelay = TRUE;
+	setsockopt (m_sckSocket, IPPROTO_TCP, TCP_NODELAY, (const char *) &blnNoDelay, sizeof(blnNoDelay));
+
+	// get notified of received data (this also makes the socket non-blocking)
+	m_hevSocket = WSACreateEvent();
+	if (m_hevSocket == WSA_INVALID_EVENT || WSAEventSelect (m_sckSocket, m_hevSocket, FD_READ | FD_CLOSE) == SOCKET_ERROR)
+	{
+		dwReturnCode = WSAGetLastError();
+		transport_TCP_Close();
+		return dwReturnCode;
+	}
+
+	return ERROR_SUCCESS;
+}
+
+static void transport_TCP_Close(void)
+{
+	if (m_sckSocket != INVALID_SOCKET)
+	{
+		closesocket (m_sckSocket);
+		m_sckSocket = INVALID_SOCKET;
+	}
+
+	if (m_hevSocket != WSA_INVALID_EVENT)
+	{
+		WSACloseEvent (m_hevSocket);
+		m_hevSocket = WSA_INVALID_EVENT;
+	}
+
+	if (m_blnWSAStarted)
+	{
+		WSACleanup();
+		m_blnWSAStarted = FALSE;
+	}
+}
+
+/**
+ * \brief Reads the bytes that are waiting in the socket's receive buffer.
+ *
+ * recv() returns 0 once the peer has closed the connection and all of its data has been read, and fails if the connection
+ * has been reset; both are reported as TRANSPORT_CLOSED, as is an empty receive buffer after FD_CLOSE.
+ */
+static DWORD transport_TCP_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	int intNBytesRead;
+
+	intNBytesRead = recv (m_sckSocket, (char *) pbytBuffer, (int) dwrdLength, 0);
+	if (intNBytesRead > 0)
+		return (DWORD) intNBytesRead;
+
+	if (intNBytesRead == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK && !m_blnTCPPeerClosed)
+		return 0;
+
+	return TRANSPORT_CLOSED;
+}
+
+/**
+ * \brief Sends the whole buffer over the (non-blocking) socket.
+ *
+ * If the send buffer is full, the function waits in select() until the socket is writable again. The write fails with
+ * WSAETIMEDOUT if the whole buffer could not be sent within TRANSPORT_TCP_WRITE_TIMEOUT ms (e.g. the peer has stopped reading).
+ */
+static BOOL transport_TCP_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	const char * pchrData;
+	int intNBytesSent, intRC;
+	DWORD dwrdStartTime, dwrdElapsedTime;
+	fd_set fdsWrite;
+	struct timeval tvTimeout;
+
+	pchrData = (const char *) pBuffer;
+	dwrdStartTime = GetTickCount();
+	while (dwrdLength > 0)
+	{
+		intNBytesSent = send (m_sckSocket, pchrData, (int) dwrdLength, 0);
+		if (intNBytesSent == SOCKET_ERROR)
+		{
+			// the socket is non-blocking: wait for space in the send buffer
+			if (WSAGetLastError() != WSAEWOULDBLOCK)
+			{
+				SetLastError (WSAGetLastError());
+				return FALSE;
+			}
+
+			dwrdElapsedTime = GetTickCount() - dwrdStartTime;
+			if (dwrdElapsedTime >= TRANSPORT_TCP_WRITE_TIMEOUT)
+			{
+				SetLastError (WSAETIMEDOUT);
+				return FALSE;
+			}
+
+			FD_ZERO (&fdsWrite);
+			FD_SET (m_sckSocket, &fdsWrite);
+			tvTimeout.tv_sec = (TRANSPORT_TCP_WRITE_TIMEOUT - dwrdElapsedTime) / 1000;
+			tvTimeout.tv_usec = ((TRANSPORT_TCP_WRITE_TIMEOUT - dwrdElapsedTime) % 1000) * 1000;
+			intRC = select (0, NULL, &fdsWrite, NULL, &tvTimeout);
+			if (intRC == SOCKET_ERROR)
+			{
+				SetLastError (WSAGetLastError());
+				return FALSE;
+			}
+			if (intRC == 0)
+			{
+				SetLastError (WSAETIMEDOUT);
+				return FALSE;
+			}
+			continue;
+		}
+
+		pchrData += intNBytesSent;
+		dwrdLength -= intNBytesSent;
+	}
+
+	return TRUE;
+}
+
+static DWORD transport_TCP_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	DWORD dwrdWaitResult;
+	HANDLE hEvents [2];
+	WSANETWORKEVENTS wneEvents;
+
+	hEvents[0] = m_hevSocket;
+	hEvents[1] = hevStop;
+	dwrdWaitResult = WaitForMultipleObjects (2, hEvents, FALSE, dwrdTimeout);
+
+	// reset the socket's event; after FD_CLOSE, Read() reports the closure once the remaining data has been read
+	if (dwrdWaitResult == WAIT_OBJECT_0)
+	{
+		if (WSAEnumNetworkEvents (m_sckSocket, m_hevSocket, &wneEvents) == SOCKET_ERROR || (wneEvents.lNetworkEvents & FD_CLOSE))
+			m_blnTCPPeerClosed = TRUE;
+	}
+	else if (dwrdWaitResult != WAIT_OBJECT_0 + 1)
+		dwrdWaitResult = WAIT_TIMEOUT;
+
+	return dwrdWaitResult;
+}
+
+static BOOL transport_TCP_Purge(void)
+{
+	BYTE bytDiscard [256];
+	DWORD dwrdNBytesRead;
+
+	do
+		dwrdNBytesRead = transport_TCP_Read (bytDiscard, sizeof(bytDiscard));
+	while (dwrdNBytesRead > 0 && dwrdNBytesRead != TRANSPORT_CLOSED);
+
+	return TRUE;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Configures an open COM port for 230400N81 communication, zero read timeouts and EV_RXCHAR comm events.
+ *
+ * Used both by the COM port transport and by the port probe of the serial module (see serial_ProbeWEEGPort()).
+ *
+ * \param[in]	hCOMPort		handle of the port
+ * \return ERROR_SUCCESS if successful, otherwise the error code returned by GetLastError.
+ */
+DWORD transport_ConfigureCOMPort(HANDLE hCOMPort)
+{
+	COMMTIMEOUTS ctTimeout;
+	DCB dcbConfig;
+
+	// Retrieves the current control settings for COM port
+	SecureZeroMemory(&dcbConfig, sizeof(DCB));
+	dcbConfig.DCBlength = sizeof(DCB);
+	if(!GetCommState (hCOMPort, &dcbConfig))
+		return GetLastError();
+
+	// Set to 230400N81
+	dcbConfig.BaudRate = SERPORT_SPEED;
+	dcbConfig.StopBits = ONESTOPBIT;
+	dcbConfig.Parity = NOPARITY;
+	dcbConfig.ByteSize = 8;
+	dcbConfig.fOutxCtsFlow = FALSE;
+	dcbConfig.fOutxDsrFlow  = FALSE;
+	dcbConfig.fDtrControl = DTR_CONTROL_ENABLE;
+	dcbConfig.fDsrSensitivity = FALSE;
+	dcbConfig.fOutX = FALSE;
+	dcbConfig.fInX = FALSE;
+	dcbConfig.fNull = FALSE;
+	dcbConfig.fRtsControl = RTS_CONTROL_ENABLE;
+	dcbConfig.fAbortOnError = FALSE;
+
+	// Configure COM port
+	if (!SetCommState (hCOMPort, &dcbConfig))
+		return GetLastError();
+
+	// Set serial port buffers
+	if (!SetupComm (hCOMPort, SERPORT_INQUEUE, SERPORT_OUTQUEUE))
+		return GetLastError();
+
+	// Set COM port read timeout: return immediately with the bytes that have already been received, even if no bytes have been received.
+	SecureZeroMemory(&ctTimeout, sizeof (ctTimeout));
+	ctTimeout.ReadIntervalTimeout = MAXDWORD;
+	if(!SetCommTimeouts (hCOMPort, &ctTimeout))
+		return GetLastError();
+
+	SetCommMask (hCOMPort, EV_RXCHAR);
+
+	return ERROR_SUCCESS;
+}
+
+/**
+ * \brief Returns the operations of the requested transport.
+ *
+ * \param[in]	ttType		transport type
+ * \return Pointer to the transport's operations, or NULL if \c ttType is not a valid transport type.
+ */
+const Transport * transport_Get(TransportType ttType)
+{
+	if (ttType < 0 || ttType >= Transport_NTypes)
+		return NULL;
+
+	return &mc_tTransports[ttType];
+}
+
+/**
+ * \brief Sets the speed at which capture files are replayed.
+ *
+ * \param[in]	blnRealTime		TRUE to replay at the link's nominal speed, FALSE to replay as fast as the data is consumed
+ * \return Nothing.
+ */
+void transport_SetReplaySpeed(BOOL blnRealTime)
+{
+	m_blnFileRealTime = blnRealTime;
+}
@@ -0,0 +1,63 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		transport.h
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ *
+ * \brief		Header file of the module that implements the byte transports over which the WEEG link can be run.
+ *
+ * $Id$
+ */
+
+# ifndef __TRANSPORT_H__
+# define __TRANSPORT_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define TRANSPORT_MAX_ADDRESS_LEN		MAX_PATH			///< maximum length of a transport address (COM port path, capture file path, host:port or EDF+ file path)
+# define TRANSPORT_CLOSED				0xFFFFFFFF			///< returned by Read() once the connection has been closed by the peer or has failed (e.g., unplugged adapter)
+
+//---------------------------------------------------------------------------
+//   								Structs/Enums
+//---------------------------------------------------------------------------
+typedef enum {Transport_COMPort = 0,						///< serial port of the WEEG coordinator's USB adapter (Win32 COM port, POSIX tty or pseudo-terminal)
+			  Transport_File = 1,							///< capture file (see capture.h) or raw received byte stream, replayed either at the recorded speed or as fast as possible
+			  Transport_TCP = 2,							///< TCP connection (e.g., to a serial-to-network bridge or to a coordinator emulator)
+			  Transport_Emulator = 3,						///< in-process WEEG coordinator emulator (see emulator.h)
+			  Transport_NTypes
+			 } TransportType;
+
+/**
+ * Operations of a byte transport. Read() and WaitForData() are only called by the serial reader thread; the other
+ * operations are called by the thread that owns the link.
+ */
+typedef struct
+{
+	DWORD	(*Open) (const TCHAR * strAddress);							///< opens the transport; returns ERROR_SUCCESS or a Win32 error code
+	void	(*Close) (void);											///< closes the transport (the reader thread has already exited)
+	DWORD	(*Read) (BYTE * pbytBuffer, DWORD dwrdLength);				///< returns immediately with the bytes that are available (0 if none, TRANSPORT_CLOSED if the connection is gone)
+	BOOL	(*Write) (const void * pBuffer, DWORD dwrdLength);			///< sends the data; returns FALSE on failure (see GetLastError)
+	DWORD	(*WaitForData) (HANDLE hevStop, DWORD dwrdTimeout);			///< timing hook: blocks until data may be available or the connection has been closed (WAIT_OBJECT_0), hevStop is signaled (WAIT_OBJECT_0 + 1) or the timeout elapses (WAIT_TIMEOUT)
+	BOOL	(*Purge) (void);											///< discards unread input; returns FALSE if the input must not be discarded (replay)
+	BOOL	Lossless;													///< TRUE if the transport can be throttled (the reader waits for ring space instead of dropping data)
+}
+Transport;
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+# ifdef _WIN32
+DWORD				transport_ConfigureCOMPort(HANDLE hCOMPort);
+# else
+DWORD				transport_ConfigureCOMPort(int intFD);
+# endif
+const Transport *	transport_Get(TransportType ttType);
+void				transport_SetReplaySpeed(BOOL blnRealTime);
+
+# endif
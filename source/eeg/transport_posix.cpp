@@ -0,0 +1,672 @@
+/**
+ * \ingroup		grp_drivers
+ *
+ * \file		transport_posix.cpp
+ * \since		19.10.2026
+ * \author		Andrei Jakab (andrei.jakab@tut.fi)
+ * \version		1.0.0
+ *
+ * \brief		Module that implements the byte transports over which the WEEG link can be run, for POSIX systems.
+ *
+ * Counterpart of transport.cpp with the same Transport operations:
+ *	- the serial port of the WEEG coordinator: a tty (e.g., /dev/ttyUSB0) or a pseudo-terminal configured for raw
+ *	  230400N81 communication with termios; the reader blocks in poll(),
+ *	- a capture file (see capture.cpp) or a file containing the raw received byte stream, replayed as in transport.cpp,
+ *	- a TCP connection (BSD sockets; the reader blocks in poll()).
+ *
+ * The in-process coordinator emulator needs libEDF and is only available in the Win32 build; opening it fails with
+ * ERROR_NOT_SUPPORTED.
+ *
+ * The reader's stop event is waited for in the same poll() call as the port or socket (see compat_GetEventFD()). A hang-up
+ * of the port (unplugged adapter, closed pseudo-terminal master) and a TCP connection that the peer has closed or reset
+ * are reported by Read() as TRANSPORT_CLOSED.
+ *
+ * Not part of the Win32 build.
+ *
+ * $Id$
+ */
+
+# ifndef _WIN32
+
+//---------------------------------------------------------------------------
+//   							Includes
+//---------------------------------------------------------------------------
+// POSIX libraries
+# include <errno.h>
+# include <fcntl.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <poll.h>
+# include <sys/ioctl.h>
+# include <sys/socket.h>
+# include <termios.h>
+# include <unistd.h>
+
+// CRT libraries
+# include <string.h>
+
+// program headers
+# include "capture.h"
+# include "serialV4.h"
+# include "transport.h"
+
+//---------------------------------------------------------------------------
+//   								Definitions
+//---------------------------------------------------------------------------
+# define TRANSPORT_FILE_BYTES_PER_S		(SERPORT_SPEED/10)		///< rate at which a raw byte stream is replayed in real-time mode (8N1: 10 bits per byte)
+# define TRANSPORT_WRITE_TIMEOUT		1000					///< maximum time a write may wait for space in the output buffer of the port or socket, in ms
+
+// sockets must not raise SIGPIPE when the peer has closed the connection
+# ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL					0						// SO_NOSIGPIPE is set on the socket instead
+# endif
+
+//---------------------------------------------------------------------------
+//   								Prototypes
+//---------------------------------------------------------------------------
+static DWORD	transport_COM_Open(const TCHAR * strAddress);
+static void		transport_COM_Close(void);
+static DWORD	transport_COM_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+static BOOL		transport_COM_Write(const void * pBuffer, DWORD dwrdLength);
+static DWORD	transport_COM_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+static BOOL		transport_COM_Purge(void);
+
+static DWORD	transport_File_Open(const TCHAR * strAddress);
+static void		transport_File_Close(void);
+static DWORD	transport_File_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+static BOOL		transport_File_Write(const void * pBuffer, DWORD dwrdLength);
+static DWORD	transport_File_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+static BOOL		transport_File_Purge(void);
+
+static DWORD	transport_TCP_Open(const TCHAR * strAddress);
+static void		transport_TCP_Close(void);
+static DWORD	transport_TCP_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+static BOOL		transport_TCP_Write(const void * pBuffer, DWORD dwrdLength);
+static DWORD	transport_TCP_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+static BOOL		transport_TCP_Purge(void);
+
+static DWORD	transport_Emulator_Open(const TCHAR * strAddress);
+static void		transport_Emulator_Close(void);
+static DWORD	transport_Emulator_Read(BYTE * pbytBuffer, DWORD dwrdLength);
+static BOOL		transport_Emulator_Write(const void * pBuffer, DWORD dwrdLength);
+static DWORD	transport_Emulator_WaitForData(HANDLE hevStop, DWORD dwrdTimeout);
+static BOOL		transport_Emulator_Purge(void);
+
+//---------------------------------------------------------------------------
+//   								Global variables
+//---------------------------------------------------------------------------
+static const Transport	mc_tTransports[Transport_NTypes] =
+{
+	{transport_COM_Open, transport_COM_Close, transport_COM_Read, transport_COM_Write, transport_COM_WaitForData, transport_COM_Purge, FALSE},
+	{transport_File_Open, transport_File_Close, transport_File_Read, transport_File_Write, transport_File_WaitForData, transport_File_Purge, TRUE},
+	{transport_TCP_Open, transport_TCP_Close, transport_TCP_Read, transport_TCP_Write, transport_TCP_WaitForData, transport_TCP_Purge, FALSE},
+	{transport_Emulator_Open, transport_Emulator_Close, transport_Emulator_Read, transport_Emulator_Write, transport_Emulator_WaitForData, transport_Emulator_Purge, FALSE}
+};
+
+// serial port
+static int			m_intCOMPort = -1;
+
+// capture file
+static int			m_intFile = -1;
+static BOOL			m_blnFileRealTime = TRUE;			///< TRUE if the file is replayed at the link's speed, FALSE if as fast as possible
+static BOOL			m_blnFileEOF;
+static DWORD		m_dwrdFileStartTime;				///< GetTickCount() when the file was opened
+static ULONGLONG	m_ullngFileNBytesRead;
+static BOOL			m_blnFileIsCapture;					///< TRUE if the file is a capture (see capture.h), FALSE if it contains the received byte stream only
+static DWORD		m_dwrdRecordNBytesLeft;				///< number of bytes of the current capture record that have not been delivered yet
+static LONGLONG		m_llngRecordTime;					///< capture time of the current record, in us
+static LARGE_INTEGER	m_liFileFrequency;
+static LARGE_INTEGER	m_liFileStartCounter;
+
+// TCP
+static int			m_intSocket = -1;
+
+//---------------------------------------------------------------------------
+//						Internally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Blocks until a file descriptor is readable or has hung up, until the stop event is signaled or until the timeout elapses.
+ *
+ * \param[in]	intFD			port or socket
+ * \param[in]	hevStop			stop event of the reader thread
+ * \param[in]	dwrdTimeout		maximum wait time, in ms
+ * \return WAIT_OBJECT_0 (data or hang-up), WAIT_OBJECT_0 + 1 (stop) or WAIT_TIMEOUT.
+ */
+static DWORD transport_PollFD(int intFD, HANDLE hevStop, DWORD dwrdTimeout)
+{
+	struct pollfd pfdWait [2];
+
+	pfdWait[0].fd = intFD;
+	pfdWait[0].events = POLLIN;
+	pfdWait[0].revents = 0;
+	pfdWait[1].fd = compat_GetEventFD (hevStop);
+	pfdWait[1].events = POLLIN;
+	pfdWait[1].revents = 0;
+
+	if (poll (pfdWait, 2, (dwrdTimeout == INFINITE) ? -1 : (int) dwrdTimeout) <= 0)
+		return WAIT_TIMEOUT;
+
+	if (pfdWait[1].revents & POLLIN)
+		return WAIT_OBJECT_0 + 1;
+	if (pfdWait[0].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL))
+		return WAIT_OBJECT_0;
+
+	return WAIT_TIMEOUT;
+}
+
+/**
+ * \brief Writes the whole buffer to a non-blocking port or socket.
+ *
+ * If the output buffer is full, the function waits in poll() until there is space again. The write fails with ETIMEDOUT
+ * if the whole buffer could not be written within TRANSPORT_WRITE_TIMEOUT ms (e.g. the peer has stopped reading).
+ *
+ * \param[in]	intFD			port or socket
+ * \param[in]	pBuffer			data
+ * \param[in]	dwrdLength		number of bytes
+ * \param[in]	blnSocket		TRUE if intFD is a socket
+ * \return TRUE if successful, FALSE otherwise (see GetLastError).
+ */
+static BOOL transport_WriteFD(int intFD, const void * pBuffer, DWORD dwrdLength, BOOL blnSocket)
+{
+	const BYTE * pbytData;
+	ssize_t sztNBytesWritten;
+	DWORD dwrdStartTime, dwrdElapsedTime;
+	struct pollfd pfdWrite;
+
+	pbytData = (const BYTE *) pBuffer;
+	dwrdStartTime = GetTickCount();
+	while (dwrdLength > 0)
+	{
+		sztNBytesWritten = blnSocket ? send (intFD, pbytData, dwrdLength, MSG_NOSIGNAL) : write (intFD, pbytData, dwrdLength);
+		if (sztNBytesWritten < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				SetLastError ((DWORD) errno);
+				return FALSE;
+			}
+
+			// wait for space in the output buffer
+			dwrdElapsedTime = GetTickCount() - dwrdStartTime;
+			if (dwrdElapsedTime >= TRANSPORT_WRITE_TIMEOUT)
+			{
+				SetLastError (ETIMEDOUT);
+				return FALSE;
+			}
+
+			pfdWrite.fd = intFD;
+			pfdWrite.events = POLLOUT;
+			if (poll (&pfdWrite, 1, (int) (TRANSPORT_WRITE_TIMEOUT - dwrdElapsedTime)) < 0 && errno != EINTR)
+			{
+				SetLastError ((DWORD) errno);
+				return FALSE;
+			}
+			continue;
+		}
+
+		pbytData += sztNBytesWritten;
+		dwrdLength -= (DWORD) sztNBytesWritten;
+	}
+
+	return TRUE;
+}
+
+/**
+ * \brief Opens the serial port and configures it for 230400N81 non-blocking communication.
+ *
+ * \param[in]	strAddress		path of the port (e.g., /dev/ttyUSB0 or the slave side of a pseudo-terminal)
+ * \return ERROR_SUCCESS if successful, otherwise an errno value.
+ */
+static DWORD transport_COM_Open(const TCHAR * strAddress)
+{
+	DWORD dwReturnCode;
+
+	m_intCOMPort = open (strAddress, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (m_intCOMPort < 0)
+		return (DWORD) errno;
+	fcntl (m_intCOMPort, F_SETFD, FD_CLOEXEC);
+
+	dwReturnCode = transport_ConfigureCOMPort (m_intCOMPort);
+	if (dwReturnCode != ERROR_SUCCESS)
+	{
+		transport_COM_Close();
+		return dwReturnCode;
+	}
+
+	return ERROR_SUCCESS;
+}
+
+static void transport_COM_Close(void)
+{
+	if (m_intCOMPort >= 0)
+	{
+		close (m_intCOMPort);
+		m_intCOMPort = -1;
+	}
+}
+
+/**
+ * \brief Reads the bytes that are waiting in the port's input queue.
+ *
+ * The port is non-blocking, so an empty queue fails with EAGAIN. End of file and other errors mean that the port has
+ * hung up.
+ */
+static DWORD transport_COM_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	ssize_t sztNBytesRead;
+
+	sztNBytesRead = read (m_intCOMPort, pbytBuffer, dwrdLength);
+	if (sztNBytesRead > 0)
+		return (DWORD) sztNBytesRead;
+
+	if (sztNBytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return 0;
+
+	return TRANSPORT_CLOSED;
+}
+
+static BOOL transport_COM_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	return transport_WriteFD (m_intCOMPort, pBuffer, dwrdLength, FALSE);
+}
+
+static DWORD transport_COM_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	return transport_PollFD (m_intCOMPort, hevStop, dwrdTimeout);
+}
+
+static BOOL transport_COM_Purge(void)
+{
+	tcflush (m_intCOMPort, TCIOFLUSH);
+	return TRUE;
+}
+
+/**
+ * \brief Opens a file for replay (see transport.cpp).
+ *
+ * \param[in]	strAddress		path of the file
+ * \return ERROR_SUCCESS if successful, otherwise an errno value.
+ */
+static DWORD transport_File_Open(const TCHAR * strAddress)
+{
+	CaptureFileHeader cfhHeader;
+
+	m_intFile = open (strAddress, O_RDONLY);
+	if (m_intFile < 0)
+		return (DWORD) errno;
+	fcntl (m_intFile, F_SETFD, FD_CLOEXEC);
+
+	// capture or raw byte stream?
+	m_blnFileIsCapture = read (m_intFile, &cfhHeader, sizeof(cfhHeader)) == (ssize_t) sizeof(cfhHeader) &&
+						 memcmp (cfhHeader.Magic, CAPTURE_MAGIC, sizeof(cfhHeader.Magic)) == 0 &&
+						 cfhHeader.Version == CAPTURE_VERSION;
+	if (!m_blnFileIsCapture)
+		lseek (m_intFile, 0, SEEK_SET);
+
+	m_blnFileEOF = FALSE;
+	m_dwrdFileStartTime = GetTickCount();
+	m_ullngFileNBytesRead = 0;
+	m_dwrdRecordNBytesLeft = 0;
+	m_llngRecordTime = 0;
+	QueryPerformanceFrequency (&m_liFileFrequency);
+	QueryPerformanceCounter (&m_liFileStartCounter);
+
+	return ERROR_SUCCESS;
+}
+
+static void transport_File_Close(void)
+{
+	if (m_intFile >= 0)
+	{
+		close (m_intFile);
+		m_intFile = -1;
+	}
+}
+
+/**
+ * \brief Returns the time elapsed since the file was opened, in microseconds.
+ */
+static LONGLONG transport_File_GetTime(void)
+{
+	LARGE_INTEGER liCounter;
+
+	QueryPerformanceCounter (&liCounter);
+
+	return (liCounter.QuadPart - m_liFileStartCounter.QuadPart) * 1000000 / m_liFileFrequency.QuadPart;
+}
+
+/**
+ * \brief Advances to the next received-data record of a capture; the records of sent packets are skipped.
+ *
+ * \return TRUE if a record was found, FALSE at the end of the file.
+ */
+static BOOL transport_File_NextRecord(void)
+{
+	CaptureRecordHeader crhHeader;
+
+	while (TRUE)
+	{
+		if (read (m_intFile, &crhHeader, sizeof(crhHeader)) != (ssize_t) sizeof(crhHeader))
+		{
+			m_blnFileEOF = TRUE;
+			return FALSE;
+		}
+		m_llngRecordTime += crhHeader.TimeDelta;
+
+		if (crhHeader.Direction == CaptureDirection_Received && crhHeader.Length > 0)
+		{
+			m_dwrdRecordNBytesLeft = crhHeader.Length;
+			return TRUE;
+		}
+		lseek (m_intFile, crhHeader.Length, SEEK_CUR);
+	}
+}
+
+/**
+ * \brief Reads the next bytes of the file (see transport.cpp).
+ */
+static DWORD transport_File_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	ssize_t sztNBytesRead;
+	ULONGLONG ullngNBytesDue;
+
+	if (m_blnFileEOF)
+		return 0;
+
+	if (m_blnFileIsCapture)
+	{
+		if (m_dwrdRecordNBytesLeft == 0 && !transport_File_NextRecord())
+			return 0;
+		if (m_blnFileRealTime && transport_File_GetTime() < m_llngRecordTime)
+			return 0;
+		if (dwrdLength > m_dwrdRecordNBytesLeft)
+			dwrdLength = m_dwrdRecordNBytesLeft;
+	}
+	else if (m_blnFileRealTime)
+	{
+		ullngNBytesDue = (ULONGLONG) (GetTickCount() - m_dwrdFileStartTime) * TRANSPORT_FILE_BYTES_PER_S / 1000;
+		if (ullngNBytesDue <= m_ullngFileNBytesRead)
+			return 0;
+		if (ullngNBytesDue - m_ullngFileNBytesRead < dwrdLength)
+			dwrdLength = (DWORD) (ullngNBytesDue - m_ullngFileNBytesRead);
+	}
+
+	sztNBytesRead = read (m_intFile, pbytBuffer, dwrdLength);
+	if (sztNBytesRead <= 0)
+	{
+		m_blnFileEOF = TRUE;
+		return 0;
+	}
+	m_ullngFileNBytesRead += sztNBytesRead;
+	if (m_blnFileIsCapture)
+		m_dwrdRecordNBytesLeft -= (DWORD) sztNBytesRead;
+
+	return (DWORD) sztNBytesRead;
+}
+
+static BOOL transport_File_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	// commands have no effect on a replay
+	return TRUE;
+}
+
+static DWORD transport_File_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	LONGLONG llngWaitTime;
+
+	// nothing more to deliver
+	if (m_blnFileEOF)
+		return (WaitForSingleObject (hevStop, dwrdTimeout) == WAIT_OBJECT_0) ? WAIT_OBJECT_0 + 1 : WAIT_TIMEOUT;
+
+	// real time: sleep until the next capture record is due (raw byte stream: deliver it in TRANSFER_IDLE ms slices);
+	// as fast as possible: only check whether the reader has to stop
+	llngWaitTime = 0;
+	if (m_blnFileRealTime)
+	{
+		if (m_blnFileIsCapture)
+		{
+			llngWaitTime = (m_llngRecordTime - transport_File_GetTime() + 999) / 1000;
+			if (llngWaitTime < 0)
+				llngWaitTime = 0;
+			else if (llngWaitTime > dwrdTimeout)
+				llngWaitTime = dwrdTimeout;
+		}
+		else
+			llngWaitTime = TRANSFER_IDLE;
+	}
+	if (WaitForSingleObject (hevStop, (DWORD) llngWaitTime) == WAIT_OBJECT_0)
+		return WAIT_OBJECT_0 + 1;
+
+	return WAIT_OBJECT_0;
+}
+
+static BOOL transport_File_Purge(void)
+{
+	// the replayed stream contains the coordinator's replies to the commands, so it must not be discarded
+	return FALSE;
+}
+
+/**
+ * \brief Connects to a TCP server.
+ *
+ * \param[in]	strAddress		address of the server in the form host:port
+ * \return ERROR_SUCCESS if successful, otherwise an errno value (ERROR_INVALID_PARAMETER if the address is malformed or
+ *		   cannot be resolved).
+ */
+static DWORD transport_TCP_Open(const TCHAR * strAddress)
+{
+	struct addrinfo aiHints, * paiResult, * pai;
+	int intNoDelay;
+	DWORD dwReturnCode;
+	TCHAR strHost [TRANSPORT_MAX_ADDRESS_LEN + 1];
+	const TCHAR * pstrPort;
+
+	// split address into host & port
+	pstrPort = _tcsrchr (strAddress, TEXT(':'));
+	if (pstrPort == NULL || pstrPort == strAddress || (size_t) (pstrPort - strAddress) > TRANSPORT_MAX_ADDRESS_LEN)
+		return ERROR_INVALID_PARAMETER;
+	_tcsncpy_s (strHost, sizeof(strHost)/sizeof(TCHAR), strAddress, pstrPort - strAddress);
+	pstrPort++;
+
+	// resolve server address
+	SecureZeroMemory(&aiHints, sizeof(aiHints));
+	aiHints.ai_family = AF_UNSPEC;
+	aiHints.ai_socktype = SOCK_STREAM;
+	aiHints.ai_protocol = IPPROTO_TCP;
+	if (getaddrinfo (strHost, pstrPort, &aiHints, &paiResult) != 0)
+		return ERROR_INVALID_PARAMETER;
+
+	// connect to the first address that accepts the connection
+	dwReturnCode = ECONNREFUSED;
+	for (pai = paiResult; pai != NULL; pai = pai->ai_next)
+	{
+		m_intSocket = socket (pai->ai_family, pai->ai_socktype, pai->ai_protocol);
+		if (m_intSocket < 0)
+		{
+			dwReturnCode = (DWORD) errno;
+			continue;
+		}
+
+		if (connect (m_intSocket, pai->ai_addr, pai->ai_addrlen) == 0)
+			break;
+
+		dwReturnCode = (DWORD) errno;
+		close (m_intSocket);
+		m_intSocket = -1;
+	}
+	freeaddrinfo (paiResult);
+	if (m_intSocket < 0)
+		return dwReturnCode;
+	fcntl (m_intSocket, F_SETFD, FD_CLOEXEC);
+
+	// the commands are small and must not be delayed by Nagle's algorithm
+	intNoDelay = 1;
+	setsockopt (m_intSocket, IPPROTO_TCP, TCP_NODELAY, &intNoDelay, sizeof(intNoDelay));
+# ifdef SO_NOSIGPIPE
+	setsockopt (m_intSocket, SOL_SOCKET, SO_NOSIGPIPE, &intNoDelay, sizeof(intNoDelay));
+# endif
+
+	// the reader polls the socket
+	if (fcntl (m_intSocket, F_SETFL, fcntl (m_intSocket, F_GETFL) | O_NONBLOCK) < 0)
+	{
+		dwReturnCode = (DWORD) errno;
+		transport_TCP_Close();
+		return dwReturnCode;
+	}
+
+	return ERROR_SUCCESS;
+}
+
+static void transport_TCP_Close(void)
+{
+	if (m_intSocket >= 0)
+	{
+		close (m_intSocket);
+		m_intSocket = -1;
+	}
+}
+
+/**
+ * \brief Reads the bytes that are waiting in the socket's receive buffer.
+ *
+ * recv() returns 0 once the peer has closed the connection and all of its data has been read, and fails if the connection
+ * has been reset; both are reported as TRANSPORT_CLOSED.
+ */
+static DWORD transport_TCP_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	ssize_t sztNBytesRead;
+
+	sztNBytesRead = recv (m_intSocket, pbytBuffer, dwrdLength, 0);
+	if (sztNBytesRead > 0)
+		return (DWORD) sztNBytesRead;
+
+	if (sztNBytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return 0;
+
+	return TRANSPORT_CLOSED;
+}
+
+static BOOL transport_TCP_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	return transport_WriteFD (m_intSocket, pBuffer, dwrdLength, TRUE);
+}
+
+static DWORD transport_TCP_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	return transport_PollFD (m_intSocket, hevStop, dwrdTimeout);
+}
+
+static BOOL transport_TCP_Purge(void)
+{
+	BYTE bytDiscard [256];
+	DWORD dwrdNBytesRead;
+
+	do
+		dwrdNBytesRead = transport_TCP_Read (bytDiscard, sizeof(bytDiscard));
+	while (dwrdNBytesRead > 0 && dwrdNBytesRead != TRANSPORT_CLOSED);
+
+	return TRUE;
+}
+
+static DWORD transport_Emulator_Open(const TCHAR * strAddress)
+{
+	return ERROR_NOT_SUPPORTED;
+}
+
+static void transport_Emulator_Close(void)
+{
+}
+
+static DWORD transport_Emulator_Read(BYTE * pbytBuffer, DWORD dwrdLength)
+{
+	return TRANSPORT_CLOSED;
+}
+
+static BOOL transport_Emulator_Write(const void * pBuffer, DWORD dwrdLength)
+{
+	SetLastError (ERROR_NOT_SUPPORTED);
+	return FALSE;
+}
+
+static DWORD transport_Emulator_WaitForData(HANDLE hevStop, DWORD dwrdTimeout)
+{
+	return (WaitForSingleObject (hevStop, dwrdTimeout) == WAIT_OBJECT_0) ? WAIT_OBJECT_0 + 1 : WAIT_TIMEOUT;
+}
+
+static BOOL transport_Emulator_Purge(void)
+{
+	return TRUE;
+}
+
+//---------------------------------------------------------------------------
+//							Globally-accessible functions
+//---------------------------------------------------------------------------
+/**
+ * \brief Configures an open tty for raw 230400N81 communication without flow control.
+ *
+ * Used both by the serial port transport and by the port probe of the serial module (see serial_ProbeWEEGPort()). DTR and
+ * RTS are raised as on Windows; pseudo-terminals have no modem lines, so that step may fail.
+ *
+ * \param[in]	intFD			file descriptor of the port
+ * \return ERROR_SUCCESS if successful, otherwise an errno value (ENOTTY if intFD is not a terminal).
+ */
+DWORD transport_ConfigureCOMPort(int intFD)
+{
+	struct termios tioConfig;
+	int intModemLines;
+
+	if (tcgetattr (intFD, &tioConfig) != 0)
+		return (DWORD) errno;
+
+	// Set to 230400N81, raw
+	cfmakeraw (&tioConfig);
+	tioConfig.c_cflag |= CLOCAL | CREAD;
+	tioConfig.c_cflag &= ~(CSTOPB | PARENB);
+# ifdef CRTSCTS
+	tioConfig.c_cflag &= ~CRTSCTS;
+# endif
+	tioConfig.c_iflag &= ~(IXON | IXOFF | IXANY);
+	tioConfig.c_cc[VMIN] = 1;					// with O_NONBLOCK, an empty queue fails with EAGAIN (VMIN = 0 would return 0, i.e. end of file)
+	tioConfig.c_cc[VTIME] = 0;
+	if (cfsetispeed (&tioConfig, B230400) != 0 || cfsetospeed (&tioConfig, B230400) != 0)
+		return (DWORD) errno;
+
+	// Configure port
+	if (tcsetattr (intFD, TCSANOW, &tioConfig) != 0)
+		return (DWORD) errno;
+
+	intModemLines = TIOCM_DTR | TIOCM_RTS;
+	ioctl (intFD, TIOCMBIS, &intModemLines);
+
+	return ERROR_SUCCESS;
+}
+
+/**
+ * \brief Returns the operations of the requested transport.
+ *
+ * \param[in]	ttType		transport type
+ * \return Pointer to the transport's operations, or NULL if \c ttType is not a valid transport type.
+ */
+const Transport * transport_Get(TransportType ttType)
+{
+	if (ttType < 0 || ttType >= Transport_NTypes)
+		return NULL;
+
+	return &mc_tTransports[ttType];
+}
+
+/**
+ * \brief Sets the speed at which capture files are replayed.
+ *
+ * \param[in]	blnRealTime		TRUE to replay at the link's nominal speed, FALSE to replay as fast as the data is consumed
+ * \return Nothing.
+ */
+void transport_SetReplaySpeed(BOOL blnRealTime)
+{
+	m_blnFileRealTime = blnRealTime;
+}
+
+# endif